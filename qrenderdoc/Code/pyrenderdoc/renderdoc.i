@@ -61,6 +61,9 @@ CONTAINER_TYPEMAPS(rdctype::array)
 %ignore rdctype::str::operator=;
 %ignore rdctype::str::operator const char *;
 
+// ignore native helpers that take raw pointers to data, which python has no way to provide
+%ignore Maths_DecodeFormattedData;
+
 // add __str__ functions
 %feature("python:tp_str") ResourceId "resid_str";
 
@@ -810,6 +810,35 @@ void CacheDataForIteration(QVector<CachedElData> &cache, const QList<FormatEleme
   }
 }
 
+// decodes up to maxCount elements of a column to floats in one go, stopping at the end of the data.
+// Returns false if the column's format isn't one that can be decoded in bulk, in which case it must
+// be read per-row with GetVariants().
+static bool DecodeColumnData(const CachedElData &d, uint32_t maxCount,
+                             QVector<FloatVector> &decoded)
+{
+  const ResourceFormat &fmt = d.el->format;
+
+  // packed formats and matrices have their own interpretation in GetVariants, and typeless
+  // components aren't displayed at all
+  if(fmt.special || fmt.srgbCorrected || fmt.compType == CompType::Typeless ||
+     d.el->matrixdim > 1)
+    return false;
+
+  decoded.clear();
+
+  if(d.data == NULL || d.data + d.byteSize > d.end)
+    return true;
+
+  // per-instance data, or data with no stride, is the same element for every row
+  uint32_t count = 1;
+  if(!d.el->perinstance && d.stride > 0)
+    count = (uint32_t)qMin<uint64_t>(maxCount, (d.end - d.data - d.byteSize) / d.stride + 1);
+
+  decoded.resize(count);
+
+  return Maths_DecodeFormattedData(&fmt, d.data, count, (uint32_t)d.stride, decoded.data());
+}
+
 BufferViewer::BufferViewer(ICaptureContext &ctx, bool meshview, QWidget *parent)
     : QFrame(parent), ui(new Ui::BufferViewer), m_Ctx(ctx)
 {
@@ -1582,6 +1611,15 @@ void BufferViewer::calcBoundingData(CalcBoundingBoxData &bbox)
 
     CacheDataForIteration(cache, s.elements, s.buffers, bbox.inst);
 
+    QVector<QVector<FloatVector>> decoded(s.elements.count());
+    QVector<bool> bulkDecoded(s.elements.count());
+
+    // without indices only the first count vertices are read
+    uint32_t maxVertex = (s.indices && s.indices->data) ? ~0U : s.count;
+
+    for(int col = 0; col < s.elements.count(); col++)
+      bulkDecoded[col] = DecodeColumnData(cache[col], maxVertex, decoded[col]);
+
     // possible optimisation here if this shows up as a hot spot - sort and unique the indices and
     // iterate in ascending order, to be more cache friendly
 
@@ -1605,7 +1643,26 @@ void BufferViewer::calcBoundingData(CalcBoundingBoxData &bbox)
         float *minOut = (float *)&minOutputList[col];
         float *maxOut = (float *)&maxOutputList[col];
 
-        if(d.data)
+        if(bulkDecoded[col])
+        {
+          uint32_t elIdx = (el->perinstance || d.stride == 0) ? 0 : idx;
+
+          // out of bounds elements are skipped, as when GetVariants() reads off the end
+          if(elIdx >= (uint32_t)decoded[col].count())
+            continue;
+
+          const float *vals = &decoded[col].at(elIdx).x;
+
+          for(uint32_t comp = 0; comp < el->format.compCount; comp++)
+          {
+            if(qIsFinite(vals[comp]))
+            {
+              minOut[comp] = qMin(minOut[comp], vals[comp]);
+              maxOut[comp] = qMax(maxOut[comp], vals[comp]);
+            }
+          }
+        }
+        else if(d.data)
         {
           const byte *bytes = d.data;
 
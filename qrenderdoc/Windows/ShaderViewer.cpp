@@ -650,6 +650,10 @@ void ShaderViewer::runToCursor()
 
 int ShaderViewer::instructionForLine(sptr_t line)
 {
+  // SPIR-V debugging refers to disassembly lines directly
+  if(m_Ctx.APIProps().pipelineType == GraphicsAPI::Vulkan)
+    return (int)line;
+
   QString trimmed = m_DisassemblyView->getLine(line).trimmed();
 
   int colon = trimmed.indexOf(QChar(':'));
@@ -828,8 +832,7 @@ void ShaderViewer::updateDebugging()
 
   for(sptr_t i = 0; i < m_DisassemblyView->lineCount(); i++)
   {
-    if(QString::fromUtf8(m_DisassemblyView->getLine(i).trimmed())
-           .startsWith(QString("%1:").arg(nextInst)))
+    if(instructionForLine(i) == (int)nextInst)
     {
       m_DisassemblyView->markerAdd(i, done ? FINISHED_MARKER : CURRENT_MARKER);
       m_DisassemblyView->markerAdd(i, done ? FINISHED_MARKER + 1 : CURRENT_MARKER + 1);
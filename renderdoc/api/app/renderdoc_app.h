@@ -191,6 +191,16 @@ typedef enum {
   // 0 - API debugging is displayed as normal
   eRENDERDOC_Option_DebugOutputMute = 11,
 
+  // Compress the frame data in captures with zstd instead of LZ4. Captures are
+  // noticeably smaller, at the cost of more CPU time spent writing them.
+  //
+  // Default - 0
+  //
+  // 0 - Captures are compressed with LZ4
+  // N - Captures are compressed with zstd at compression level N, where higher
+  //     levels compress further but take longer
+  eRENDERDOC_Option_ZstdCompressionLevel = 12,
+
 } RENDERDOC_CaptureOption;
 
 // Sets an option that controls how RenderDoc behaves on capture.
@@ -178,4 +178,17 @@ Default - enabled
 ``False`` - API debugging is displayed as normal.
 )");
   bool32 DebugOutputMute;
+
+  DOCUMENT(R"(Compress the frame data in captures with zstd instead of LZ4, at the given level.
+
+Captures are noticeably smaller, at the cost of more CPU time spent writing them.
+
+Default - 0
+
+``0`` - Captures are compressed with LZ4.
+
+``N`` - Captures are compressed with zstd at compression level N, where higher levels compress
+further but take longer.
+)");
+  uint32_t ZstdCompressionLevel;
 };
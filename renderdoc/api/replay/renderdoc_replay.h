@@ -372,6 +372,22 @@ Should only be called for mesh outputs.
 )");
   virtual rdctype::pair<uint32_t, uint32_t> PickVertex(uint32_t eventID, uint32_t x, uint32_t y) = 0;
 
+  DOCUMENT(R"(Retrieves the triangle and instance that is under the cursor location, when viewed
+relative to the current window with the current mesh display configuration.
+
+Should only be called for mesh outputs. Only triangle topologies can be picked, and picking triangles
+is only supported on Vulkan and OpenGL.
+
+:param int eventID: The event ID to pick at.
+:param int x: The x co-ordinate to pick from.
+:param int y: The y co-ordinate to pick from.
+:return: A tuple with the first value being the index of the primitive in the mesh, and the second
+  value being the instance index. The values are set to :data:`NoResult` if no triangle was found.
+:rtype: ``tuple`` of ``int`` and ``int``
+)");
+  virtual rdctype::pair<uint32_t, uint32_t> PickTriangle(uint32_t eventID, uint32_t x,
+                                                         uint32_t y) = 0;
+
   static const uint32_t NoResult = ~0U;
 
 protected:
@@ -726,6 +742,19 @@ texture to something compatible with the target file format.
 )");
   virtual bool SaveTexture(const TextureSave &saveData, const char *path) = 0;
 
+  DOCUMENT(R"(Save several textures to files on disk, as with :meth:`SaveTexture`.
+
+This is faster than saving each texture in turn, as textures are converted and encoded on worker
+threads while the next ones are still being read back.
+
+:param list saveData: The :class:`TextureSave` configuration for each texture to save.
+:param list paths: The path to save each texture to, in the same order as ``saveData``.
+:return: ``True`` if every texture was saved successfully, ``False`` if any failed.
+:rtype: ``bool``
+)");
+  virtual bool SaveTextures(const rdctype::array<TextureSave> &saveData,
+                            const rdctype::array<rdctype::str> &paths) = 0;
+
   DOCUMENT(R"(Retrieve the generated data from one of the geometry processing shader stages.
 
 :param int instID: The index of the instance to retrieve data for.
@@ -1092,6 +1121,20 @@ by the :class:`ReplayController`.
   )");
   virtual rdctype::array<byte> GetThumbnail(FileType type, uint32_t maxsize) = 0;
 
+  DOCUMENT(R"(Writes a copy of the capture with its frame data recompressed.
+
+All other contents of the capture are copied unchanged.
+
+:param str filename: The path to write the new capture to. This must not be the same file.
+:param CaptureCompression compression: The compression to use for the frame data.
+:param int level: The compression level, only used for :data:`CaptureCompression.Zstd`. ``0``
+  selects the default level, and higher levels compress further at the expense of write speed.
+:return: The status of the conversion, whether success or failure.
+:rtype: ReplayStatus
+)");
+  virtual ReplayStatus Convert(const char *filename, CaptureCompression compression,
+                               int level) = 0;
+
 protected:
   ICaptureFile() = default;
   ~ICaptureFile() = default;
@@ -1145,6 +1188,24 @@ integer).
 )");
 extern "C" RENDERDOC_API uint16_t RENDERDOC_CC Maths_FloatToHalf(float flt);
 
+DOCUMENT(R"(A utility function that decodes a run of elements in the given format to floats, with
+any channels the format doesn't have set to ``(0, 0, 0, 1)``. This is much faster than decoding
+each component separately, so is intended for native code processing whole buffers.
+
+:param ResourceFormat fmt: The format of the elements.
+:param data: A pointer to the first element.
+:param int count: The number of elements to decode.
+:param int stride: The number of bytes between elements, or 0 if they are tightly packed.
+:param FloatVector output: An array of ``count`` vectors that receives the decoded elements.
+:return: ``True`` if the data was decoded, ``False`` if the format isn't supported.
+:rtype: ``bool``
+)");
+extern "C" RENDERDOC_API bool32 RENDERDOC_CC Maths_DecodeFormattedData(const ResourceFormat *fmt,
+                                                                      const void *data,
+                                                                      uint32_t count,
+                                                                      uint32_t stride,
+                                                                      FloatVector *output);
+
 DOCUMENT(R"(A utility function that returns the number of vertices in a primitive of a given
 topology.
 
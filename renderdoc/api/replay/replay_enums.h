@@ -946,6 +946,28 @@ enum class FileType : uint32_t
 
 ITERABLE_OPERATORS(FileType);
 
+DOCUMENT(R"(The compression used for the frame data when writing a capture file.
+
+.. data:: LZ4
+
+  LZ4 compression. This is what captures are written with by default, and is fastest to write.
+
+.. data:: Zstd
+
+  Zstandard compression. This is slower to write but gives noticeably smaller files, and is still
+  fast to decompress. Captures can be written with it directly by setting
+  :data:`CaptureOptions.ZstdCompressionLevel`.
+)");
+enum class CaptureCompression : uint32_t
+{
+  LZ4,
+  First = LZ4,
+  Zstd,
+  Count,
+};
+
+ITERABLE_OPERATORS(CaptureCompression);
+
 DOCUMENT(R"(What to do with the alpha channel from a texture while saving out to a file.
 
 .. data:: Discard
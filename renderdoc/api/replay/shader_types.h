@@ -209,7 +209,12 @@ struct ShaderDebugState
   rdctype::array<rdctype::array<ShaderVariable> > indexableTemps;
 
   DOCUMENT(R"(The next instruction to be executed after this state. The initial state before any
-shader execution happened will have ``nextInstruction == 0``.)");
+shader execution happened will have ``nextInstruction == 0``.
+
+For SPIR-V shaders this is instead the 0-based line in the disassembly of the statement that the
+next instruction is part of. Instructions that were folded into a later statement point at that
+statement's line.
+)");
   uint32_t nextInstruction;
 
   DOCUMENT("A set of :class:`ShaderEvents` flags that indicate what events happened on this step.");
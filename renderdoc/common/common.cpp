@@ -31,6 +31,14 @@
 #include "os/os_specific.h"
 #include "serialise/string_utils.h"
 
+#if ENABLED(RDOC_X86)
+#if ENABLED(RDOC_MSVS)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
 using std::string;
 
 //	for(int i=0; i < 256; i++)
@@ -252,6 +260,94 @@ uint64_t Log2Floor(uint64_t value)
 }
 #endif
 
+#if ENABLED(RDOC_X86)
+
+static void CPUID(uint32_t leaf, uint32_t subleaf, uint32_t regs[4])
+{
+#if ENABLED(RDOC_MSVS)
+  __cpuidex((int *)regs, (int)leaf, (int)subleaf);
+#else
+  regs[0] = regs[1] = regs[2] = regs[3] = 0;
+  if(leaf <= __get_cpuid_max(0, NULL))
+    __cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+bool CPUSupportsSSE2()
+{
+#if ENABLED(RDOC_X64)
+  return true;
+#else
+  uint32_t regs[4];
+  CPUID(1, 0, regs);
+  return (regs[3] & (1 << 26)) != 0;
+#endif
+}
+
+bool CPUSupportsAVX()
+{
+  uint32_t regs[4];
+  CPUID(1, 0, regs);
+
+  // the OS must save the YMM registers as well as the CPU supporting AVX
+  const uint32_t osxsave = 1 << 27;
+  const uint32_t avx = 1 << 28;
+  if((regs[2] & (osxsave | avx)) != (osxsave | avx))
+    return false;
+
+#if ENABLED(RDOC_MSVS)
+  return (_xgetbv(0) & 0x6) == 0x6;
+#else
+  uint32_t xcr0 = 0, xcr0hi = 0;
+  __asm__("xgetbv" : "=a"(xcr0), "=d"(xcr0hi) : "c"(0));
+  return (xcr0 & 0x6) == 0x6;
+#endif
+}
+
+bool CPUSupportsAVX2()
+{
+  if(!CPUSupportsAVX())
+    return false;
+
+  uint32_t regs[4];
+  CPUID(7, 0, regs);
+  return (regs[1] & (1 << 5)) != 0;
+}
+
+bool CPUSupportsF16C()
+{
+  if(!CPUSupportsAVX())
+    return false;
+
+  uint32_t regs[4];
+  CPUID(1, 0, regs);
+  return (regs[2] & (1 << 29)) != 0;
+}
+
+#else
+
+bool CPUSupportsSSE2()
+{
+  return false;
+}
+
+bool CPUSupportsAVX()
+{
+  return false;
+}
+
+bool CPUSupportsAVX2()
+{
+  return false;
+}
+
+bool CPUSupportsF16C()
+{
+  return false;
+}
+
+#endif    // ENABLED(RDOC_X86)
+
 static string logfile;
 static void *logfileHandle = NULL;
 
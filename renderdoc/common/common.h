@@ -99,6 +99,13 @@
 #define CONCAT2(a, b) a##b
 #define CONCAT(a, b) CONCAT2(a, b)
 
+// a [start, end) range of bytes, see FindDiffRanges
+struct DiffRange
+{
+  size_t start;
+  size_t end;
+};
+
 #include "os/os_specific.h"
 
 #define RDCEraseMem(a, b) memset(a, 0, b)
@@ -156,6 +163,34 @@ inline T AlignUpPtr(T x, A a)
   (((uint32_t)(d) << 24) | ((uint32_t)(c) << 16) | ((uint32_t)(b) << 8) | (uint32_t)(a))
 
 bool FindDiffRange(void *a, void *b, size_t bufSize, size_t &diffStart, size_t &diffEnd);
+
+// below this many identical bytes, it's cheaper to serialise them as part of a larger range than
+// to split into two ranges with their own chunks
+static const size_t DefaultDiffMergeGap = 4096;
+
+// finds every [start, end) range of bytes where a and b differ, in order. Ranges separated by no
+// more than mergeGap identical bytes are returned as one range. Large buffers are compared on
+// several threads. Returns true if any differences were found.
+bool FindDiffRanges(const void *a, const void *b, size_t bufSize, std::vector<DiffRange> &ranges,
+                    size_t mergeGap = DefaultDiffMergeGap);
+
+// runtime checks for x86 instruction set extensions, to pick between SIMD implementations. These
+// always return false on other architectures.
+bool CPUSupportsSSE2();
+bool CPUSupportsAVX();
+bool CPUSupportsAVX2();
+bool CPUSupportsF16C();
+
+#if ENABLED(RDOC_X86)
+// MSVC allows any intrinsics to be used without changing the target. Elsewhere functions using
+// extensions beyond the compiler's baseline must be marked with the extensions they need.
+#if ENABLED(RDOC_MSVS)
+#define SIMD_TARGET(t)
+#else
+#define SIMD_TARGET(t) __attribute__((target(t)))
+#endif
+#endif
+
 uint32_t CalcNumMips(int Width, int Height, int Depth);
 
 uint32_t Log2Floor(uint32_t value);
@@ -0,0 +1,331 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015-2017 Baldur Karlsson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+
+#include <string.h>
+#include "common.h"
+#include "os/os_specific.h"
+
+#if ENABLED(RDOC_X86)
+#include <immintrin.h>
+#endif
+
+// memory is compared in units of this many bytes, and only refined to individual bytes at the
+// start and end of each range.
+static const size_t DiffUnit = 32;
+
+// buffers larger than this are split across several threads
+static const size_t DiffParallelThreshold = 32 * 1024 * 1024;
+static const size_t DiffMinSliceSize = 8 * 1024 * 1024;
+static const uint32_t DiffMaxThreads = 8;
+
+// returns the index of the first unit where whether a and b differ matches findDiff, or numUnits if
+// there isn't one.
+typedef size_t (*DiffScanFunc)(const byte *a, const byte *b, size_t numUnits, bool findDiff);
+
+static size_t DiffScan_Scalar(const byte *a, const byte *b, size_t numUnits, bool findDiff)
+{
+  for(size_t i = 0; i < numUnits; i++)
+  {
+    const byte *ua = a + i * DiffUnit;
+    const byte *ub = b + i * DiffUnit;
+
+    uint64_t diff = 0;
+    for(size_t w = 0; w < DiffUnit; w += sizeof(uint64_t))
+    {
+      uint64_t wa, wb;
+      memcpy(&wa, ua + w, sizeof(uint64_t));
+      memcpy(&wb, ub + w, sizeof(uint64_t));
+      diff |= wa ^ wb;
+    }
+
+    if((diff != 0) == findDiff)
+      return i;
+  }
+
+  return numUnits;
+}
+
+#if ENABLED(RDOC_X86)
+
+SIMD_TARGET("sse2")
+static size_t DiffScan_SSE2(const byte *a, const byte *b, size_t numUnits, bool findDiff)
+{
+  const __m128i zero = _mm_setzero_si128();
+
+  size_t i = 0;
+
+  // most memory is unchanged, so when looking for a difference skip over four units at a time
+  if(findDiff)
+  {
+    for(; i + 4 <= numUnits; i += 4)
+    {
+      const __m128i *va = (const __m128i *)(a + i * DiffUnit);
+      const __m128i *vb = (const __m128i *)(b + i * DiffUnit);
+
+      __m128i diff = zero;
+      for(int v = 0; v < 8; v++)
+        diff = _mm_or_si128(diff, _mm_xor_si128(_mm_loadu_si128(va + v), _mm_loadu_si128(vb + v)));
+
+      if(_mm_movemask_epi8(_mm_cmpeq_epi8(diff, zero)) != 0xffff)
+        break;
+    }
+  }
+
+  for(; i < numUnits; i++)
+  {
+    const __m128i *va = (const __m128i *)(a + i * DiffUnit);
+    const __m128i *vb = (const __m128i *)(b + i * DiffUnit);
+
+    __m128i diff = _mm_or_si128(_mm_xor_si128(_mm_loadu_si128(va), _mm_loadu_si128(vb)),
+                                _mm_xor_si128(_mm_loadu_si128(va + 1), _mm_loadu_si128(vb + 1)));
+
+    bool differs = _mm_movemask_epi8(_mm_cmpeq_epi8(diff, zero)) != 0xffff;
+
+    if(differs == findDiff)
+      return i;
+  }
+
+  return numUnits;
+}
+
+SIMD_TARGET("avx2")
+static size_t DiffScan_AVX2(const byte *a, const byte *b, size_t numUnits, bool findDiff)
+{
+  size_t i = 0;
+
+  if(findDiff)
+  {
+    for(; i + 4 <= numUnits; i += 4)
+    {
+      const __m256i *va = (const __m256i *)(a + i * DiffUnit);
+      const __m256i *vb = (const __m256i *)(b + i * DiffUnit);
+
+      __m256i diff = _mm256_xor_si256(_mm256_loadu_si256(va), _mm256_loadu_si256(vb));
+      for(int v = 1; v < 4; v++)
+        diff = _mm256_or_si256(
+            diff, _mm256_xor_si256(_mm256_loadu_si256(va + v), _mm256_loadu_si256(vb + v)));
+
+      if(!_mm256_testz_si256(diff, diff))
+        break;
+    }
+  }
+
+  for(; i < numUnits; i++)
+  {
+    __m256i diff = _mm256_xor_si256(_mm256_loadu_si256((const __m256i *)(a + i * DiffUnit)),
+                                    _mm256_loadu_si256((const __m256i *)(b + i * DiffUnit)));
+
+    bool differs = !_mm256_testz_si256(diff, diff);
+
+    if(differs == findDiff)
+      return i;
+  }
+
+  return numUnits;
+}
+
+#endif    // ENABLED(RDOC_X86)
+
+static DiffScanFunc GetDiffScan()
+{
+  // detection is idempotent so it doesn't matter if several threads race to do this
+  static DiffScanFunc scan = NULL;
+
+  if(scan)
+    return scan;
+
+  DiffScanFunc ret = &DiffScan_Scalar;
+
+#if ENABLED(RDOC_X86)
+  if(CPUSupportsAVX2())
+    ret = &DiffScan_AVX2;
+  else if(CPUSupportsSSE2())
+    ret = &DiffScan_SSE2;
+#endif
+
+  scan = ret;
+
+  return ret;
+}
+
+// returns the first differing byte in [offs, end), or end if there are none
+static size_t NextDiff(const byte *a, const byte *b, size_t offs, size_t end, DiffScanFunc scan)
+{
+  while(offs < end && offs % DiffUnit != 0)
+  {
+    if(a[offs] != b[offs])
+      return offs;
+    offs++;
+  }
+
+  size_t numUnits = (end - offs) / DiffUnit;
+  offs += scan(a + offs, b + offs, numUnits, true) * DiffUnit;
+
+  // we're either in the first differing unit, or in the trailing bytes after the last unit
+  while(offs < end && a[offs] == b[offs])
+    offs++;
+
+  return offs;
+}
+
+// returns the start of the first completely identical unit at or after offs, or end if there are
+// none
+static size_t NextEqualUnit(const byte *a, const byte *b, size_t offs, size_t end,
+                            DiffScanFunc scan)
+{
+  offs = AlignUp(offs, DiffUnit);
+
+  if(offs >= end)
+    return end;
+
+  size_t numUnits = (end - offs) / DiffUnit;
+  size_t unit = scan(a + offs, b + offs, numUnits, false);
+
+  if(unit == numUnits)
+    return end;
+
+  return offs + unit * DiffUnit;
+}
+
+static void FindDiffRangesSerial(const byte *a, const byte *b, size_t begin, size_t end,
+                                 size_t mergeGap, std::vector<DiffRange> &ranges)
+{
+  DiffScanFunc scan = GetDiffScan();
+
+  size_t offs = NextDiff(a, b, begin, end, scan);
+
+  while(offs < end)
+  {
+    DiffRange range;
+    range.start = offs;
+
+    size_t cur = offs + 1;
+
+    for(;;)
+    {
+      size_t equal = NextEqualUnit(a, b, cur, end, scan);
+
+      // walk back to be byte-accurate about where the differences stop
+      size_t diffEnd = equal;
+      while(diffEnd > cur && a[diffEnd - 1] == b[diffEnd - 1])
+        diffEnd--;
+
+      size_t next = NextDiff(a, b, equal, end, scan);
+
+      if(next >= end || next - diffEnd > mergeGap)
+      {
+        range.end = diffEnd;
+        offs = next;
+        break;
+      }
+
+      cur = next + 1;
+    }
+
+    ranges.push_back(range);
+  }
+}
+
+struct DiffSlice
+{
+  const byte *a;
+  const byte *b;
+  size_t begin;
+  size_t end;
+  size_t mergeGap;
+  std::vector<DiffRange> ranges;
+};
+
+static void DiffSliceThread(void *s)
+{
+  DiffSlice *slice = (DiffSlice *)s;
+  FindDiffRangesSerial(slice->a, slice->b, slice->begin, slice->end, slice->mergeGap,
+                       slice->ranges);
+}
+
+bool FindDiffRanges(const void *a, const void *b, size_t bufSize, std::vector<DiffRange> &ranges,
+                    size_t mergeGap)
+{
+  ranges.clear();
+
+  const byte *abytes = (const byte *)a;
+  const byte *bbytes = (const byte *)b;
+
+  uint32_t numThreads = 1;
+
+  if(bufSize >= DiffParallelThreshold)
+    numThreads = (uint32_t)RDCMIN(RDCMIN((uint64_t)Threading::NumberOfCores(),
+                                         (uint64_t)DiffMaxThreads),
+                                  (uint64_t)(bufSize / DiffMinSliceSize));
+
+  if(numThreads <= 1)
+  {
+    FindDiffRangesSerial(abytes, bbytes, 0, bufSize, mergeGap, ranges);
+    return !ranges.empty();
+  }
+
+  std::vector<DiffSlice> slices(numThreads);
+  std::vector<Threading::ThreadHandle> threads(numThreads);
+
+  size_t sliceSize = AlignUp(bufSize / numThreads, DiffUnit);
+
+  for(uint32_t i = 0; i < numThreads; i++)
+  {
+    DiffSlice &slice = slices[i];
+    slice.a = abytes;
+    slice.b = bbytes;
+    slice.begin = RDCMIN(bufSize, sliceSize * i);
+    slice.end = (i + 1 == numThreads) ? bufSize : RDCMIN(bufSize, sliceSize * (i + 1));
+    slice.mergeGap = mergeGap;
+  }
+
+  // the first slice is done on this thread
+  for(uint32_t i = 1; i < numThreads; i++)
+    threads[i] = Threading::CreateThread(&DiffSliceThread, &slices[i]);
+
+  DiffSliceThread(&slices[0]);
+
+  for(uint32_t i = 1; i < numThreads; i++)
+  {
+    Threading::JoinThread(threads[i]);
+    Threading::CloseThread(threads[i]);
+  }
+
+  // stitch the slices together, merging ranges across slice boundaries where they're close enough
+  for(uint32_t i = 0; i < numThreads; i++)
+  {
+    for(size_t r = 0; r < slices[i].ranges.size(); r++)
+    {
+      const DiffRange &range = slices[i].ranges[r];
+
+      if(!ranges.empty() && range.start - ranges.back().end <= mergeGap)
+        ranges.back().end = range.end;
+      else
+        ranges.push_back(range);
+    }
+  }
+
+  return !ranges.empty();
+}
@@ -0,0 +1,295 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015-2017 Baldur Karlsson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include <utility>
+#include "common.h"
+
+// hashes the bytes of a key. Keys are expected to be small plain values such as ResourceId, integer
+// IDs or pointers, which are compared with operator== and have no padding.
+template <typename Key>
+inline uint64_t FlatHashKey(const Key &key)
+{
+  uint64_t h = 0;
+
+  if(sizeof(Key) == sizeof(uint64_t))
+  {
+    memcpy(&h, &key, sizeof(uint64_t));
+  }
+  else if(sizeof(Key) == sizeof(uint32_t))
+  {
+    uint32_t h32 = 0;
+    memcpy(&h32, &key, sizeof(uint32_t));
+    h = h32;
+  }
+  else
+  {
+    // FNV-1a for anything else
+    const byte *bytes = (const byte *)&key;
+    h = 14695981039346656037ULL;
+    for(size_t i = 0; i < sizeof(Key); i++)
+      h = (h ^ bytes[i]) * 1099511628211ULL;
+  }
+
+  // IDs are sequential and pointers share their low bits, so mix well before masking off the low
+  // bits for a bucket (splitmix64 finaliser)
+  h ^= h >> 30;
+  h *= 0xbf58476d1ce4e5b9ULL;
+  h ^= h >> 27;
+  h *= 0x94d049bb133111ebULL;
+  h ^= h >> 31;
+
+  return h;
+}
+
+// an open-addressing hash map with linear probing, for lookups that are hit on every API call where
+// a std::map's pointer chasing is too expensive. The interface is the subset of std::map that we
+// use, but iteration is in no particular order.
+//
+// Erasing leaves a tombstone rather than moving entries, so like std::map it's safe to erase
+// elements while iterating (as long as nothing is inserted). Inserting may rehash, which
+// invalidates all iterators.
+template <typename Key, typename Value>
+class FlatHashMap
+{
+public:
+  typedef std::pair<Key, Value> value_type;
+
+  template <typename MapType, typename ElemType>
+  class iterator_base
+  {
+  public:
+    iterator_base() : m_Map(NULL), m_Idx(0) {}
+    iterator_base(MapType *map, size_t idx) : m_Map(map), m_Idx(idx) {}
+    ElemType &operator*() const { return m_Map->m_Elems[m_Idx]; }
+    ElemType *operator->() const { return &m_Map->m_Elems[m_Idx]; }
+    iterator_base &operator++()
+    {
+      m_Idx = m_Map->NextFull(m_Idx + 1);
+      return *this;
+    }
+    iterator_base operator++(int)
+    {
+      iterator_base ret = *this;
+      ++(*this);
+      return ret;
+    }
+    bool operator==(const iterator_base &o) const { return m_Idx == o.m_Idx; }
+    bool operator!=(const iterator_base &o) const { return m_Idx != o.m_Idx; }
+  private:
+    friend class FlatHashMap;
+    MapType *m_Map;
+    size_t m_Idx;
+  };
+
+  typedef iterator_base<FlatHashMap, value_type> iterator;
+  typedef iterator_base<const FlatHashMap, const value_type> const_iterator;
+
+  FlatHashMap() : m_Elems(NULL), m_State(NULL), m_Capacity(0), m_Size(0), m_Used(0) {}
+  ~FlatHashMap()
+  {
+    delete[] m_Elems;
+    delete[] m_State;
+  }
+
+  FlatHashMap(const FlatHashMap &o)
+      : m_Elems(NULL), m_State(NULL), m_Capacity(0), m_Size(0), m_Used(0)
+  {
+    *this = o;
+  }
+
+  FlatHashMap &operator=(const FlatHashMap &o)
+  {
+    if(this == &o)
+      return *this;
+
+    clear();
+    for(const_iterator it = o.begin(); it != o.end(); ++it)
+      (*this)[it->first] = it->second;
+
+    return *this;
+  }
+
+  size_t size() const { return m_Size; }
+  bool empty() const { return m_Size == 0; }
+  iterator begin() { return iterator(this, NextFull(0)); }
+  iterator end() { return iterator(this, m_Capacity); }
+  const_iterator begin() const { return const_iterator(this, NextFull(0)); }
+  const_iterator end() const { return const_iterator(this, m_Capacity); }
+  iterator find(const Key &key) { return iterator(this, FindIndex(key)); }
+  const_iterator find(const Key &key) const { return const_iterator(this, FindIndex(key)); }
+  size_t count(const Key &key) const { return FindIndex(key) != m_Capacity ? 1 : 0; }
+  Value &operator[](const Key &key)
+  {
+    size_t idx = FindIndex(key);
+
+    if(idx == m_Capacity)
+      idx = Insert(key);
+
+    return m_Elems[idx].second;
+  }
+
+  void erase(iterator it)
+  {
+    RDCASSERT(it.m_Idx < m_Capacity && m_State[it.m_Idx] == Full);
+
+    m_Elems[it.m_Idx] = value_type();
+    m_State[it.m_Idx] = Deleted;
+    m_Size--;
+  }
+
+  size_t erase(const Key &key)
+  {
+    size_t idx = FindIndex(key);
+
+    if(idx == m_Capacity)
+      return 0;
+
+    erase(iterator(this, idx));
+    return 1;
+  }
+
+  void swap(FlatHashMap &o)
+  {
+    std::swap(m_Elems, o.m_Elems);
+    std::swap(m_State, o.m_State);
+    std::swap(m_Capacity, o.m_Capacity);
+    std::swap(m_Size, o.m_Size);
+    std::swap(m_Used, o.m_Used);
+  }
+
+  void clear()
+  {
+    delete[] m_Elems;
+    delete[] m_State;
+    m_Elems = NULL;
+    m_State = NULL;
+    m_Capacity = m_Size = m_Used = 0;
+  }
+
+private:
+  enum SlotState
+  {
+    Empty = 0,
+    Full,
+    Deleted,
+  };
+
+  static const size_t MinCapacity = 16;
+
+  // slots are kept in separate arrays so probing past other keys only touches the state bytes
+  value_type *m_Elems;
+  byte *m_State;
+
+  // always a power of two, or 0 before the first insert
+  size_t m_Capacity;
+
+  // number of full slots, and full plus deleted slots. Deleted slots still lengthen probes so they
+  // count towards the load factor until the next rehash
+  size_t m_Size;
+  size_t m_Used;
+
+  size_t NextFull(size_t idx) const
+  {
+    while(idx < m_Capacity && m_State[idx] != Full)
+      idx++;
+    return idx;
+  }
+
+  size_t FindIndex(const Key &key) const
+  {
+    if(m_Capacity == 0)
+      return 0;
+
+    size_t mask = m_Capacity - 1;
+    size_t idx = size_t(FlatHashKey(key)) & mask;
+
+    // load factor is kept below 1 so there is always an empty slot to stop at
+    while(m_State[idx] != Empty)
+    {
+      if(m_State[idx] == Full && m_Elems[idx].first == key)
+        return idx;
+
+      idx = (idx + 1) & mask;
+    }
+
+    return m_Capacity;
+  }
+
+  // inserts a key that isn't present, returning its index
+  size_t Insert(const Key &key)
+  {
+    // grow at 75% load. If most of the used slots are tombstones, rehash at the same size instead
+    if((m_Used + 1) * 4 > m_Capacity * 3)
+    {
+      if(m_Size * 2 >= m_Capacity / 2)
+        Rehash(RDCMAX(m_Capacity * 2, (size_t)MinCapacity));
+      else
+        Rehash(m_Capacity);
+    }
+
+    size_t mask = m_Capacity - 1;
+    size_t idx = size_t(FlatHashKey(key)) & mask;
+
+    while(m_State[idx] == Full)
+      idx = (idx + 1) & mask;
+
+    if(m_State[idx] == Empty)
+      m_Used++;
+
+    m_State[idx] = Full;
+    m_Elems[idx].first = key;
+    m_Size++;
+
+    return idx;
+  }
+
+  void Rehash(size_t capacity)
+  {
+    value_type *oldElems = m_Elems;
+    byte *oldState = m_State;
+    size_t oldCapacity = m_Capacity;
+
+    m_Elems = new value_type[capacity];
+    m_State = new byte[capacity];
+    memset(m_State, Empty, capacity);
+    m_Capacity = capacity;
+    m_Size = m_Used = 0;
+
+    for(size_t i = 0; i < oldCapacity; i++)
+    {
+      if(oldState[i] == Full)
+      {
+        size_t idx = Insert(oldElems[i].first);
+        m_Elems[idx].second = oldElems[i].second;
+      }
+    }
+
+    delete[] oldElems;
+    delete[] oldState;
+  }
+};
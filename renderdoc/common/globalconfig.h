@@ -43,6 +43,12 @@
 #define RDOC_X64 OPTION_OFF
 #endif
 
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define RDOC_X86 OPTION_ON
+#else
+#define RDOC_X86 OPTION_OFF
+#endif
+
 #if defined(RELEASE) || defined(_RELEASE)
 #define RDOC_RELEASE OPTION_ON
 #define RDOC_DEVEL OPTION_OFF
@@ -135,6 +141,10 @@ enum
 // force debugbreaks regardless of debug/release mode
 #define FORCE_DEBUGBREAK OPTION_OFF
 
+// compute texture min/max and histograms on the CPU as well as the GPU, and log any differences.
+// Slow, since every query reads the whole subresource back
+#define VALIDATE_TEXTURE_STATS OPTION_OFF
+
 /////////////////////////////////////////////////
 // Logging configuration
 
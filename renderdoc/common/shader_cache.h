@@ -26,9 +26,10 @@
 
 #include "os/os_specific.h"
 
-template <typename ResultType, typename ShaderCallbacks>
+// entries are keyed by a hash, stored in the file at the size of KeyType
+template <typename KeyType, typename ResultType, typename ShaderCallbacks>
 bool LoadShaderCache(const char *filename, const uint32_t magicNumber, const uint32_t versionNumber,
-                     std::map<uint32_t, ResultType> &resultCache, const ShaderCallbacks &callbacks)
+                     std::map<KeyType, ResultType> &resultCache, const ShaderCallbacks &callbacks)
 {
   string shadercache = FileIO::GetAppFolderFilename(filename);
 
@@ -74,16 +75,17 @@ bool LoadShaderCache(const char *filename, const uint32_t magicNumber, const uin
 
       for(uint32_t i = 0; i < numentries; i++)
       {
-        if((size_t)bufsize < sizeof(uint32_t))
+        if((size_t)bufsize < sizeof(KeyType))
         {
           RDCERR("Invalid shader cache - truncated, not enough data for shader hash");
           ret = false;
           break;
         }
 
-        uint32_t hash = *(uint32_t *)ptr;
-        ptr += sizeof(uint32_t);
-        bufsize -= sizeof(uint32_t);
+        KeyType hash;
+        memcpy(&hash, ptr, sizeof(hash));
+        ptr += sizeof(KeyType);
+        bufsize -= sizeof(KeyType);
 
         if((size_t)bufsize < sizeof(uint32_t))
         {
@@ -137,13 +139,17 @@ bool LoadShaderCache(const char *filename, const uint32_t magicNumber, const uin
   return ret;
 }
 
-template <typename ResultType, typename ShaderCallbacks>
+template <typename KeyType, typename ResultType, typename ShaderCallbacks>
 void SaveShaderCache(const char *filename, uint32_t magicNumber, uint32_t versionNumber,
-                     const std::map<uint32_t, ResultType> &cache, const ShaderCallbacks &callbacks)
+                     const std::map<KeyType, ResultType> &cache, const ShaderCallbacks &callbacks)
 {
   string shadercache = FileIO::GetAppFolderFilename(filename);
 
-  FILE *f = FileIO::fopen(shadercache.c_str(), "wb");
+  // write to a temporary file and rename it over the cache, so that a crash or another instance
+  // saving at the same time can't leave a half-written cache behind
+  string tempcache = shadercache + ".tmp";
+
+  FILE *f = FileIO::fopen(tempcache.c_str(), "wb");
 
   if(!f)
   {
@@ -158,7 +164,7 @@ void SaveShaderCache(const char *filename, uint32_t magicNumber, uint32_t versio
 
   for(auto it = cache.begin(); it != cache.end(); ++it)
   {
-    uint32_t hash = it->first;
+    KeyType hash = it->first;
     uint32_t len = callbacks.GetSize(it->second);
     byte *data = callbacks.GetData(it->second);
     FileIO::fwrite(&hash, 1, sizeof(hash), f);
@@ -170,5 +176,11 @@ void SaveShaderCache(const char *filename, uint32_t magicNumber, uint32_t versio
 
   FileIO::fclose(f);
 
+  if(!FileIO::Move(tempcache.c_str(), shadercache.c_str(), true))
+  {
+    FileIO::Delete(tempcache.c_str());
+    return;
+  }
+
   RDCDEBUG("Successfully wrote %u shaders to shader cache", numentries);
 }
@@ -0,0 +1,315 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016-2017 Baldur Karlsson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+
+#include "capture_thumbnail.h"
+#include <math.h>
+#include "common/common.h"
+#include "jpeg-compressor/jpge.h"
+#include "maths/formatpacking.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define THUMBNAIL_SSE2 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define THUMBNAIL_NEON 1
+#endif
+
+CaptureThumbnailPixels::CaptureThumbnailPixels(byte *pixels, uint32_t w, uint32_t h, bool flip)
+    : m_Pixels(pixels)
+{
+  width = w;
+  height = h;
+  rowPitch = w * 3;
+  flipY = flip;
+
+  format.special = false;
+  format.compCount = 3;
+  format.compByteWidth = 1;
+  format.compType = CompType::UNorm;
+}
+
+CaptureThumbnailPixels::CaptureThumbnailPixels(byte *pixels, uint32_t w, uint32_t h, uint32_t pitch,
+                                               const ResourceFormat &fmt)
+    : m_Pixels(pixels)
+{
+  width = w;
+  height = h;
+  rowPitch = pitch;
+  format = fmt;
+}
+
+CaptureThumbnailPixels::~CaptureThumbnailPixels()
+{
+  SAFE_DELETE_ARRAY(m_Pixels);
+}
+
+// source rows are summed into 16-bit accumulators, so at most this many can go into one output row
+static const uint32_t MaxRowsPerBox = 256;
+
+static byte LinearToSRGB8(float linear)
+{
+  linear = RDCCLAMP(linear, 0.0f, 1.0f);
+
+  if(linear < 0.0031308f)
+    return byte(255.0f * (12.92f * linear));
+
+  return byte(255.0f * (1.055f * powf(linear, 1.0f / 2.4f) - 0.055f));
+}
+
+// converts a row of a format without 8-bit channels to RGBA8. Returns false if the format isn't
+// one a backbuffer is expected to have.
+static bool DecodeRow(const ResourceFormat &fmt, const byte *src, uint32_t width, byte *dst)
+{
+  if(fmt.special)
+  {
+    switch(fmt.specialFormat)
+    {
+      case SpecialFormat::R10G10B10A2:
+        for(uint32_t x = 0; x < width; x++, dst += 4)
+        {
+          Vec4f unorm = ConvertFromR10G10B10A2(((const uint32_t *)src)[x]);
+          dst[0] = (byte)(unorm.x * 255.0f);
+          dst[1] = (byte)(unorm.y * 255.0f);
+          dst[2] = (byte)(unorm.z * 255.0f);
+        }
+        return true;
+      case SpecialFormat::R5G6B5:
+        for(uint32_t x = 0; x < width; x++, dst += 4)
+        {
+          Vec3f unorm = ConvertFromB5G6R5(((const uint16_t *)src)[x]);
+          dst[0] = (byte)(unorm.z * 255.0f);
+          dst[1] = (byte)(unorm.y * 255.0f);
+          dst[2] = (byte)(unorm.x * 255.0f);
+        }
+        return true;
+      case SpecialFormat::R5G5B5A1:
+        for(uint32_t x = 0; x < width; x++, dst += 4)
+        {
+          Vec4f unorm = ConvertFromB5G5R5A1(((const uint16_t *)src)[x]);
+          dst[0] = (byte)(unorm.z * 255.0f);
+          dst[1] = (byte)(unorm.y * 255.0f);
+          dst[2] = (byte)(unorm.x * 255.0f);
+        }
+        return true;
+      default: return false;
+    }
+  }
+
+  // R16G16B16A16 float backbuffers are linear, so convert to sRGB to match the others
+  if(fmt.compByteWidth == 2 && fmt.compCount >= 3 && fmt.compType == CompType::Float)
+  {
+    const uint16_t *src16 = (const uint16_t *)src;
+
+    for(uint32_t x = 0; x < width; x++, dst += 4, src16 += fmt.compCount)
+    {
+      dst[0] = LinearToSRGB8(ConvertFromHalf(src16[0]));
+      dst[1] = LinearToSRGB8(ConvertFromHalf(src16[1]));
+      dst[2] = LinearToSRGB8(ConvertFromHalf(src16[2]));
+    }
+    return true;
+  }
+
+  return false;
+}
+
+// acc[i] += src[i] for count bytes
+static void AccumulateRow(uint16_t *acc, const byte *src, size_t count)
+{
+  size_t i = 0;
+
+#if defined(THUMBNAIL_SSE2)
+  const __m128i zero = _mm_setzero_si128();
+
+  for(; i + 16 <= count; i += 16)
+  {
+    __m128i s = _mm_loadu_si128((const __m128i *)(src + i));
+    __m128i *a = (__m128i *)(acc + i);
+
+    _mm_storeu_si128(a, _mm_add_epi16(_mm_loadu_si128(a), _mm_unpacklo_epi8(s, zero)));
+    _mm_storeu_si128(a + 1, _mm_add_epi16(_mm_loadu_si128(a + 1), _mm_unpackhi_epi8(s, zero)));
+  }
+#elif defined(THUMBNAIL_NEON)
+  for(; i + 16 <= count; i += 16)
+  {
+    uint8x16_t s = vld1q_u8(src + i);
+
+    vst1q_u16(acc + i, vaddw_u8(vld1q_u16(acc + i), vget_low_u8(s)));
+    vst1q_u16(acc + i + 8, vaddw_u8(vld1q_u16(acc + i + 8), vget_high_u8(s)));
+  }
+#endif
+
+  for(; i < count; i++)
+    acc[i] += src[i];
+}
+
+// box-filters the thumbnail down to at most maxSize pixels wide as tightly packed RGB8
+static bool DownscaleThumbnail(CaptureThumbnail *thumb, uint32_t maxSize,
+                               std::vector<byte> &thpixels, uint32_t &thwidth, uint32_t &thheight)
+{
+  thpixels.clear();
+  thwidth = thheight = 0;
+
+  if(thumb == NULL || thumb->width == 0 || thumb->height == 0)
+    return false;
+
+  const byte *pixels = thumb->GetPixels();
+
+  if(pixels == NULL)
+    return false;
+
+  const ResourceFormat &fmt = thumb->format;
+  const uint32_t width = thumb->width;
+  const uint32_t height = thumb->height;
+
+  // formats with 8-bit channels are filtered in place, anything else is converted a row at a time
+  bool direct = !fmt.special && fmt.compByteWidth == 1 && fmt.compCount >= 3;
+  bool bgra = direct && fmt.bgraOrder;
+  uint32_t channels = direct ? fmt.compCount : 4;
+
+  std::vector<byte> decoded;
+  if(!direct)
+  {
+    decoded.resize(width * 4);
+
+    if(!DecodeRow(fmt, pixels, width, &decoded[0]))
+    {
+      RDCWARN("Unsupported backbuffer format for thumbnail: %s", fmt.strname.c_str());
+      return false;
+    }
+  }
+
+  // clamp dimensions to a width of maxSize
+  thwidth = RDCMIN(maxSize, width);
+  thheight = RDCMAX(1U, uint32_t(uint64_t(height) * thwidth / width));
+
+  // the source columns covered by each output pixel
+  std::vector<uint32_t> colStart(thwidth + 1);
+  for(uint32_t x = 0; x <= thwidth; x++)
+    colStart[x] = uint32_t(uint64_t(x) * width / thwidth);
+
+  std::vector<uint16_t> acc(width * channels);
+  thpixels.resize(thwidth * thheight * 3);
+
+  byte *dst = &thpixels[0];
+
+  for(uint32_t y = 0; y < thheight; y++)
+  {
+    uint32_t y0 = uint32_t(uint64_t(y) * height / thheight);
+    uint32_t y1 = RDCMAX(y0 + 1, uint32_t(uint64_t(y + 1) * height / thheight));
+
+    // when shrinking a very tall image, only sample evenly spaced rows so the sums can't overflow
+    uint32_t step = (y1 - y0 + MaxRowsPerBox - 1) / MaxRowsPerBox;
+    uint32_t numRows = 0;
+
+    memset(&acc[0], 0, acc.size() * sizeof(uint16_t));
+
+    for(uint32_t r = y0; r < y1; r += step, numRows++)
+    {
+      const byte *row = pixels + size_t(thumb->flipY ? height - 1 - r : r) * thumb->rowPitch;
+
+      if(!direct)
+      {
+        DecodeRow(fmt, row, width, &decoded[0]);
+        row = &decoded[0];
+      }
+
+      AccumulateRow(&acc[0], row, acc.size());
+    }
+
+    for(uint32_t x = 0; x < thwidth; x++, dst += 3)
+    {
+      uint32_t x0 = colStart[x];
+      uint32_t x1 = RDCMAX(x0 + 1, colStart[x + 1]);
+
+      uint32_t sum[3] = {0, 0, 0};
+
+      for(uint32_t c = x0; c < x1; c++)
+      {
+        const uint16_t *px = &acc[c * channels];
+        sum[0] += px[0];
+        sum[1] += px[1];
+        sum[2] += px[2];
+      }
+
+      uint32_t count = numRows * (x1 - x0);
+
+      dst[0] = byte((sum[bgra ? 2 : 0] + count / 2) / count);
+      dst[1] = byte((sum[1] + count / 2) / count);
+      dst[2] = byte((sum[bgra ? 0 : 2] + count / 2) / count);
+    }
+  }
+
+  return true;
+}
+
+CaptureThumbnail *ShrinkCaptureThumbnail(CaptureThumbnail *thumb, uint32_t maxSize)
+{
+  std::vector<byte> thpixels;
+  uint32_t thwidth = 0, thheight = 0;
+
+  if(!DownscaleThumbnail(thumb, maxSize, thpixels, thwidth, thheight))
+    return NULL;
+
+  byte *pixels = new byte[thpixels.size()];
+  memcpy(pixels, &thpixels[0], thpixels.size());
+
+  return new CaptureThumbnailPixels(pixels, thwidth, thheight, false);
+}
+
+bool EncodeCaptureThumbnail(CaptureThumbnail *thumb, uint32_t maxSize, std::vector<byte> &jpg,
+                            uint32_t &thwidth, uint32_t &thheight)
+{
+  jpg.clear();
+
+  std::vector<byte> thpixels;
+
+  if(!DownscaleThumbnail(thumb, maxSize, thpixels, thwidth, thheight))
+    return false;
+
+  // the compressed image is only ever a fraction of the raw size, but tiny images have a fixed
+  // overhead for the headers and tables
+  int len = int(thpixels.size()) + 1024;
+  jpg.resize(len);
+
+  jpge::params p;
+  p.m_quality = 80;
+
+  bool success = jpge::compress_image_to_jpeg_file_in_memory(&jpg[0], len, thwidth, thheight, 3,
+                                                             &thpixels[0], p);
+
+  if(!success)
+  {
+    RDCERR("Failed to compress to jpg");
+    jpg.clear();
+    thwidth = 0;
+    thheight = 0;
+    return false;
+  }
+
+  jpg.resize(len);
+
+  return true;
+}
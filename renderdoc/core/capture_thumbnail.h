@@ -0,0 +1,77 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016-2017 Baldur Karlsson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+#pragma once
+
+#include <vector>
+#include "api/replay/renderdoc_replay.h"
+
+// the backbuffer as it was at the end of a captured frame, to become the capture's thumbnail.
+// Drivers can subclass this to leave the readback in flight, so that waiting for it as well as
+// downscaling and compressing the image all happen on the capture writer thread rather than in
+// the frame that ended the capture.
+class CaptureThumbnail
+{
+public:
+  CaptureThumbnail() : width(0), height(0), rowPitch(0), flipY(false) {}
+  // releases the readback, which may happen on the writer thread
+  virtual ~CaptureThumbnail() {}
+  // returns the top-left of the image, waiting for the readback to finish if needed. Returns NULL
+  // if the readback failed.
+  virtual const byte *GetPixels() = 0;
+
+  uint32_t width, height;
+  uint32_t rowPitch;
+  ResourceFormat format;
+
+  // rows are stored bottom-to-top, as glReadPixels returns them
+  bool flipY;
+};
+
+// a thumbnail that's already been read back to the CPU. It takes ownership of the pixels, which
+// were allocated with new[].
+class CaptureThumbnailPixels : public CaptureThumbnail
+{
+public:
+  // tightly packed RGB8 pixels
+  CaptureThumbnailPixels(byte *pixels, uint32_t w, uint32_t h, bool flip);
+  CaptureThumbnailPixels(byte *pixels, uint32_t w, uint32_t h, uint32_t pitch,
+                         const ResourceFormat &fmt);
+  ~CaptureThumbnailPixels();
+  const byte *GetPixels() { return m_Pixels; }
+private:
+  byte *m_Pixels;
+};
+
+// thumbnails are never wider than this
+static const uint32_t MaxCaptureThumbnailSize = 2048;
+
+// returns a copy of the thumbnail scaled down to at most maxSize pixels wide, for keeping around
+// more cheaply than the full readback. Returns NULL if there's no image.
+CaptureThumbnail *ShrinkCaptureThumbnail(CaptureThumbnail *thumb, uint32_t maxSize);
+
+// box-filters the thumbnail down to at most maxSize pixels wide, keeping its aspect ratio, and
+// compresses it to a JPEG. Returns false and leaves jpg empty if there's no image to encode.
+bool EncodeCaptureThumbnail(CaptureThumbnail *thumb, uint32_t maxSize, std::vector<byte> &jpg,
+                            uint32_t &thwidth, uint32_t &thheight);
@@ -29,6 +29,7 @@
 #include "api/replay/version.h"
 #include "common/common.h"
 #include "common/dds_readwrite.h"
+#include "core/capture_thumbnail.h"
 #include "hooks/hooks.h"
 #include "replay/replay_driver.h"
 #include "serialise/serialiser.h"
@@ -220,6 +221,8 @@ RenderDoc::RenderDoc()
   m_RemoteIdent = 0;
   m_RemoteThread = 0;
 
+  m_PendingCaptureWrites = 0;
+
   m_Replay = false;
 
   m_Cap = 0;
@@ -349,6 +352,11 @@ RenderDoc::~RenderDoc()
   for(auto it = m_ShutdownFunctions.begin(); it != m_ShutdownFunctions.end(); ++it)
     (*it)();
 
+  // unlike the target control thread below, capture writing threads can be joined here. Each one
+  // holds a reference on the module, so if the module is being unloaded they've already exited,
+  // and if the process is exiting on windows they've already been terminated.
+  WaitForCaptureWrites();
+
   for(size_t i = 0; i < m_Captures.size(); i++)
   {
     if(m_Captures[i].retrieved)
@@ -401,6 +409,8 @@ void RenderDoc::Shutdown()
     Threading::CloseThread(m_RemoteThread);
     m_RemoteThread = 0;
   }
+
+  WaitForCaptureWrites();
 }
 
 bool RenderDoc::MatchClosestWindow(void *&dev, void *&wnd)
@@ -475,6 +485,7 @@ void RenderDoc::StartFrameCapture(void *dev, void *wnd)
   IFrameCapturer *frameCap = MatchFrameCapturer(dev, wnd);
   if(frameCap)
   {
+    Chunk::BeginFrameArena();
     frameCap->StartFrameCapture(dev, wnd);
     m_CapturesActive++;
   }
@@ -500,7 +511,14 @@ bool RenderDoc::EndFrameCapture(void *dev, void *wnd)
   if(frameCap)
   {
     m_CapturesActive--;
-    return frameCap->EndFrameCapture(dev, wnd);
+    bool ret = frameCap->EndFrameCapture(dev, wnd);
+    Chunk::EndFrameArena();
+
+    RDCLOG("%llu chunks live using %.2f MB, %.2f MB in arena pages", Chunk::NumLiveChunks(),
+           float(Chunk::TotalMem()) / 1024.0f / 1024.0f,
+           float(Chunk::ArenaMem()) / 1024.0f / 1024.0f);
+
+    return ret;
   }
   return false;
 }
@@ -691,8 +709,56 @@ bool RenderDoc::ShouldTriggerCapture(uint32_t frameNumber)
   return ret;
 }
 
-Serialiser *RenderDoc::OpenWriteSerialiser(uint32_t frameNum, RDCInitParams *params, void *thpixels,
-                                           size_t thlen, uint32_t thwidth, uint32_t thheight)
+// the thumbnail chunk at the start of a capture, which is only encoded once the writer thread
+// reaches it
+class ThumbnailChunk : public DeferredChunk
+{
+public:
+  ThumbnailChunk(CaptureThumbnail *thumb, bool debugSerialiser)
+      : m_Thumb(thumb), m_DebugSerialiser(debugSerialiser)
+  {
+  }
+  ~ThumbnailChunk() { SAFE_DELETE(m_Thumb); }
+  Chunk *Create()
+  {
+    std::vector<byte> jpg;
+    uint32_t thwidth = 0;
+    uint32_t thheight = 0;
+
+    bool HasThumbnail =
+        EncodeCaptureThumbnail(m_Thumb, MaxCaptureThumbnailSize, jpg, thwidth, thheight);
+
+    // release the readback as soon as it's no longer needed
+    SAFE_DELETE(m_Thumb);
+
+    Serialiser ser(NULL, Serialiser::WRITING, m_DebugSerialiser);
+
+    // this runs on the capture writer thread, whose callstack means nothing to the user
+    ser.SetCollectCallstacks(false);
+
+    ScopedContext scope(&ser, "Thumbnail", THUMBNAIL_DATA, false);
+
+    ser.Serialise("HasThumbnail", HasThumbnail);
+
+    if(HasThumbnail)
+    {
+      byte *buf = &jpg[0];
+      size_t len = jpg.size();
+      ser.Serialise("ThumbWidth", thwidth);
+      ser.Serialise("ThumbHeight", thheight);
+      ser.SerialiseBuffer("ThumbnailPixels", buf, len);
+    }
+
+    return scope.Get(true);
+  }
+
+private:
+  CaptureThumbnail *m_Thumb;
+  bool m_DebugSerialiser;
+};
+
+Serialiser *RenderDoc::OpenWriteSerialiser(uint32_t frameNum, RDCInitParams *params,
+                                           CaptureThumbnail *thumb)
 {
   RDCASSERT(m_CurrentDriver != RDC_Unknown);
 
@@ -707,24 +773,17 @@ Serialiser *RenderDoc::OpenWriteSerialiser(uint32_t frameNum, RDCInitParams *par
   Serialiser *fileSerialiser =
       new Serialiser(m_CurrentLogFile.c_str(), Serialiser::WRITING, debugSerialiser);
 
-  Serialiser *chunkSerialiser = new Serialiser(NULL, Serialiser::WRITING, debugSerialiser);
-
-  {
-    ScopedContext scope(chunkSerialiser, "Thumbnail", THUMBNAIL_DATA, false);
+  if(m_Options.ZstdCompressionLevel > 0)
+    fileSerialiser->SetCompression(Serialiser::eSectionFlag_ZstdCompressed,
+                                   (int)m_Options.ZstdCompressionLevel);
 
-    bool HasThumbnail = (thpixels != NULL && thwidth > 0 && thheight > 0);
-    chunkSerialiser->Serialise("HasThumbnail", HasThumbnail);
+  // chunks are compressed and written as they're inserted, so the frame doesn't have to wait for
+  // the whole capture to be written once it ends
+  fileSerialiser->StartAsyncWrite();
 
-    if(HasThumbnail)
-    {
-      byte *buf = (byte *)thpixels;
-      chunkSerialiser->Serialise("ThumbWidth", thwidth);
-      chunkSerialiser->Serialise("ThumbHeight", thheight);
-      chunkSerialiser->SerialiseBuffer("ThumbnailPixels", buf, thlen);
-    }
+  fileSerialiser->InsertDeferred(new ThumbnailChunk(thumb, debugSerialiser));
 
-    fileSerialiser->Insert(scope.Get(true));
-  }
+  Serialiser *chunkSerialiser = new Serialiser(NULL, Serialiser::WRITING, debugSerialiser);
 
   {
     ScopedContext scope(chunkSerialiser, "Capture Create Parameters", CREATE_PARAMS, false);
@@ -1016,11 +1075,113 @@ void RenderDoc::SetProgress(LoadProgressSection section, float delta)
   *m_ProgressPtr = progress;
 }
 
-void RenderDoc::SuccessfullyWrittenLog(uint32_t frameNumber)
+struct CaptureWriteJob
+{
+  Serialiser *ser;
+  string logfile;
+  uint32_t frameNumber;
+};
+
+void RenderDoc::FinishWriteSerialiser(Serialiser *fileSerialiser, uint32_t frameNumber)
+{
+  CaptureWriteJob *job = new CaptureWriteJob;
+  job->ser = fileSerialiser;
+  job->logfile = m_CurrentLogFile;
+  job->frameNumber = frameNumber;
+
+  // if chunks weren't handed to a writer thread as they were inserted, the serialiser still points
+  // at chunks the driver is about to free, so it has to be flushed now
+  if(!fileSerialiser->IsWritingAsync())
+  {
+    {
+      SCOPED_LOCK(m_CaptureWriteLock);
+      m_PendingCaptureWrites++;
+    }
+
+    CaptureWriteThread(job);
+    return;
+  }
+
+  {
+    SCOPED_LOCK(m_CaptureWriteLock);
+
+    // tidy up the handles of any earlier writes, which have all completed
+    if(m_PendingCaptureWrites == 0)
+    {
+      for(size_t i = 0; i < m_CaptureWriteThreads.size(); i++)
+      {
+        Threading::JoinThread(m_CaptureWriteThreads[i]);
+        Threading::CloseThread(m_CaptureWriteThreads[i]);
+      }
+
+      m_CaptureWriteThreads.clear();
+    }
+
+    m_PendingCaptureWrites++;
+
+    Threading::ThreadHandle thread =
+        Threading::CreateThread(&RenderDoc::CaptureWriteThreadEntry, job);
+
+    if(thread)
+    {
+      m_CaptureWriteThreads.push_back(thread);
+      return;
+    }
+  }
+
+  RDCWARN("Couldn't start thread to finish writing capture, writing immediately");
+  CaptureWriteThread(job);
+}
+
+void RenderDoc::CaptureWriteThread(void *j)
+{
+  CaptureWriteJob *job = (CaptureWriteJob *)j;
+
+  job->ser->FlushToDisk();
+
+  if(!job->ser->HasError())
+    RenderDoc::Inst().SuccessfullyWrittenLog(job->logfile, job->frameNumber);
+
+  SAFE_DELETE(job->ser);
+
+  {
+    SCOPED_LOCK(RenderDoc::Inst().m_CaptureWriteLock);
+    RenderDoc::Inst().m_PendingCaptureWrites--;
+  }
+
+  SAFE_DELETE(job);
+}
+
+void RenderDoc::CaptureWriteThreadEntry(void *job)
+{
+  Threading::KeepModuleAlive();
+
+  CaptureWriteThread(job);
+
+  Threading::ReleaseModuleExitThread();
+}
+
+void RenderDoc::WaitForCaptureWrites()
+{
+  vector<Threading::ThreadHandle> threads;
+
+  {
+    SCOPED_LOCK(m_CaptureWriteLock);
+    threads.swap(m_CaptureWriteThreads);
+  }
+
+  for(size_t i = 0; i < threads.size(); i++)
+  {
+    Threading::JoinThread(threads[i]);
+    Threading::CloseThread(threads[i]);
+  }
+}
+
+void RenderDoc::SuccessfullyWrittenLog(const string &logfile, uint32_t frameNumber)
 {
-  RDCLOG("Written to disk: %s", m_CurrentLogFile.c_str());
+  RDCLOG("Written to disk: %s", logfile.c_str());
 
-  CaptureData cap(m_CurrentLogFile, Timing::GetUnixTimestamp(), frameNumber);
+  CaptureData cap(logfile, Timing::GetUnixTimestamp(), frameNumber);
   {
     SCOPED_LOCK(m_CaptureLock);
     m_Captures.push_back(cap);
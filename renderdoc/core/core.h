@@ -45,6 +45,7 @@ using std::set;
 
 class Serialiser;
 class Chunk;
+class CaptureThumbnail;
 
 // not provided by tinyexr, just do by hand
 bool is_exr_file(FILE *f);
@@ -207,9 +208,17 @@ public:
   void RecreateCrashHandler();
   void UnloadCrashHandler();
   ICrashHandler *GetCrashHandler() const { return m_ExHandler; }
-  Serialiser *OpenWriteSerialiser(uint32_t frameNum, RDCInitParams *params, void *thpixels,
-                                  size_t thlen, uint32_t thwidth, uint32_t thheight);
-  void SuccessfullyWrittenLog(uint32_t frameNumber);
+  // takes ownership of thumb, which may be NULL. It's encoded on the capture writer thread so
+  // that the frame ending the capture doesn't wait for it.
+  Serialiser *OpenWriteSerialiser(uint32_t frameNum, RDCInitParams *params,
+                                  CaptureThumbnail *thumb);
+  // hands a finished capture's serialiser off to be flushed and deleted on a background thread.
+  // The capture is only listed once it's completely on disk.
+  void FinishWriteSerialiser(Serialiser *fileSerialiser, uint32_t frameNumber);
+  // blocks until every capture handed to FinishWriteSerialiser is on disk. Drivers call this
+  // before tearing down anything a pending capture's thumbnail might still be reading from.
+  void WaitForCaptureWrites();
+  void SuccessfullyWrittenLog(const string &logfile, uint32_t frameNumber);
 
   void AddChildProcess(uint32_t pid, uint32_t ident)
   {
@@ -364,6 +373,14 @@ private:
   Threading::CriticalSection m_CaptureLock;
   vector<CaptureData> m_Captures;
 
+  static void CaptureWriteThread(void *job);
+  static void CaptureWriteThreadEntry(void *job);
+
+  // threads flushing captures to disk, and how many of them haven't finished yet
+  Threading::CriticalSection m_CaptureWriteLock;
+  vector<Threading::ThreadHandle> m_CaptureWriteThreads;
+  int32_t m_PendingCaptureWrites;
+
   Threading::CriticalSection m_ChildLock;
   vector<pair<uint32_t, uint32_t> > m_Children;
 
@@ -120,9 +120,10 @@ public:
   {
     m_Proxy->PickPixel(m_TextureID, x, y, sliceFace, mip, sample, typeHint, pixel);
   }
-  uint32_t PickVertex(uint32_t eventID, const MeshDisplay &cfg, uint32_t x, uint32_t y)
+  uint32_t PickVertex(uint32_t eventID, const MeshDisplay &cfg, uint32_t x, uint32_t y,
+                      uint32_t *primitive)
   {
-    return m_Proxy->PickVertex(eventID, cfg, x, y);
+    return m_Proxy->PickVertex(eventID, cfg, x, y, primitive);
   }
   void BuildCustomShader(string source, string entry, const uint32_t compileFlags, ShaderStage type,
                          ResourceId *id, string *errors)
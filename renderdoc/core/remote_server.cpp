@@ -82,7 +82,10 @@ void Serialiser::Serialise(const char *name, EnvironmentModification &el)
   Serialise("value", el.value);
 }
 
-static const uint32_t RemoteServerProtocolVersion = 1;
+static const uint32_t RemoteServerProtocolVersion = 4;
+
+// whether capture copies to and from the server are LZ4 compressed in transit
+static const bool CompressCaptureTransfers = true;
 
 enum RemoteServerPacket
 {
@@ -137,6 +140,56 @@ static void ProgressTicker(void *d)
   }
 }
 
+// partial copies older than this are assumed to be abandoned and are deleted when the server starts
+static const uint64_t RemoteCopyExpirySeconds = 7 * 24 * 60 * 60;
+
+static string RemoteCopyFolder()
+{
+  string cap_file;
+  string dummy, dummy2;
+  FileIO::GetDefaultFiles("remotecopy", cap_file, dummy, dummy2);
+  return dirname(cap_file);
+}
+
+// a copy is identified by every property of the client's file we have, so unrelated files can't
+// share a partial copy. The name is sanitised for the filesystem and hashed to keep it unique.
+static string RemoteCopyFilename(const string &name, uint64_t fileLength, uint64_t lastmod)
+{
+  string safename = name.substr(0, 64);
+  for(size_t i = 0; i < safename.size(); i++)
+  {
+    char c = safename[i];
+    if(!(c >= 'a' && c <= 'z') && !(c >= 'A' && c <= 'Z') && !(c >= '0' && c <= '9') && c != '-')
+      safename[i] = '_';
+  }
+
+  return RemoteCopyFolder() + StringFormat::Fmt("/remotecopy_%s_%08x_%llu_%llu.rdc",
+                                                safename.c_str(), strhash(name.c_str()),
+                                                fileLength, lastmod);
+}
+
+static void ExpireRemoteCopies()
+{
+  string folder = RemoteCopyFolder();
+  uint64_t now = Timing::GetUnixTimestamp();
+
+  std::vector<PathEntry> files = FileIO::GetFilesInDirectory(folder.c_str());
+
+  for(size_t i = 0; i < files.size(); i++)
+  {
+    string filename = files[i].filename.c_str();
+
+    if((files[i].flags & PathProperty::Directory) || filename.find("remotecopy_") != 0)
+      continue;
+
+    if(files[i].lastmod + RemoteCopyExpirySeconds < now)
+    {
+      RDCLOG("Deleting stale partial copy '%s'", filename.c_str());
+      FileIO::Delete((folder + "/" + filename).c_str());
+    }
+  }
+}
+
 struct ClientThread
 {
   ClientThread()
@@ -303,34 +356,48 @@ static void ActiveRemoteClientThread(void *data)
       else if(type == eRemoteServer_CopyCaptureFromRemote)
       {
         string path;
+        uint64_t resumeOffset = 0, resumeChecksum = 0;
+        bool compress = false;
         recvser->Serialise("path", path);
+        recvser->Serialise("resumeOffset", resumeOffset);
+        recvser->Serialise("resumeChecksum", resumeChecksum);
+        recvser->Serialise("compress", compress);
 
-        if(!SendChunkedFile(client, eRemoteServer_CopyCaptureFromRemote, path.c_str(), sendSer, NULL))
+        if(!SendResumableFile(client, eRemoteServer_CopyCaptureFromRemote, path.c_str(),
+                              resumeOffset, resumeChecksum, compress, NULL))
         {
           RDCERR("Network error sending file");
           SAFE_DELETE(recvser);
           break;
         }
-
-        sendSer.Rewind();
       }
       else if(type == eRemoteServer_CopyCaptureToRemote)
       {
-        string cap_file;
-        string dummy, dummy2;
-        FileIO::GetDefaultFiles("remotecopy", cap_file, dummy, dummy2);
+        string name;
+        uint64_t fileLength = 0, lastmod = 0;
+        recvser->Serialise("name", name);
+        recvser->Serialise("fileLength", fileLength);
+        recvser->Serialise("lastmod", lastmod);
+
+        // the local path is derived from what identifies the client's file, so that if a previous
+        // copy of the same file was interrupted we can find the partial copy and resume it. The
+        // partial file is deliberately not deleted on failure, stale ones are expired on startup.
+        string cap_file = RemoteCopyFilename(name, fileLength, lastmod);
 
-        Serialiser *fileRecv = NULL;
+        uint64_t resumeOffset = 0, resumeChecksum = 0;
+        GetResumePoint(cap_file.c_str(), resumeOffset, resumeChecksum);
+
+        Serialiser resumeSer("", Serialiser::WRITING, false);
+        resumeSer.Serialise("resumeOffset", resumeOffset);
+        resumeSer.Serialise("resumeChecksum", resumeChecksum);
 
         RDCLOG("Copying file to local path '%s'.", cap_file.c_str());
 
-        if(!RecvChunkedFile(client, type, cap_file.c_str(), fileRecv, NULL))
+        if(!SendPacket(client, eRemoteServer_CopyCaptureToRemote, resumeSer) ||
+           !RecvResumableFile(client, eRemoteServer_CopyCaptureToRemote, cap_file.c_str(), NULL))
         {
-          FileIO::Delete(cap_file.c_str());
-
           RDCERR("Network error receiving file");
 
-          SAFE_DELETE(fileRecv);
           SAFE_DELETE(recvser);
           break;
         }
@@ -339,8 +406,6 @@ static void ActiveRemoteClientThread(void *data)
 
         tempFiles.push_back(cap_file);
 
-        SAFE_DELETE(fileRecv);
-
         sendType = eRemoteServer_CopyCaptureToRemote;
         sendSer.Serialise("path", cap_file);
       }
@@ -504,6 +569,8 @@ void RenderDoc::BecomeRemoteServer(const char *listenhost, uint16_t port, volati
   if(sock == NULL)
     return;
 
+  ExpireRemoteCopies();
+
   std::vector<std::pair<uint32_t, uint32_t> > listenRanges;
   bool allowExecution = true;
 
@@ -926,45 +993,87 @@ public:
 
   void CopyCaptureFromRemote(const char *remotepath, const char *localpath, float *progress)
   {
+    // receive into a partial file next to the destination and only rename it into place once it's
+    // complete. If an earlier copy to the same path was interrupted the server can resume from the
+    // end of its partial file, if the contents match
+    string partialpath = string(localpath) + ".partial";
+
+    uint64_t resumeOffset = 0, resumeChecksum = 0;
+    GetResumePoint(partialpath.c_str(), resumeOffset, resumeChecksum);
+
     string path = remotepath;
+    bool compress = CompressCaptureTransfers;
     Serialiser sendData("", Serialiser::WRITING, false);
     sendData.Serialise("path", path);
+    sendData.Serialise("resumeOffset", resumeOffset);
+    sendData.Serialise("resumeChecksum", resumeChecksum);
+    sendData.Serialise("compress", compress);
     Send(eRemoteServer_CopyCaptureFromRemote, sendData);
 
     float dummy = 0.0f;
     if(progress == NULL)
       progress = &dummy;
 
-    Serialiser *fileRecv = NULL;
-
-    if(!RecvChunkedFile(m_Socket, eRemoteServer_CopyCaptureFromRemote, localpath, fileRecv, progress))
+    if(!RecvResumableFile(m_Socket, eRemoteServer_CopyCaptureFromRemote, partialpath.c_str(),
+                          progress))
     {
-      SAFE_DELETE(fileRecv);
       RDCERR("Network error receiving file");
       return;
     }
-    SAFE_DELETE(fileRecv);
+
+    FileIO::Move(partialpath.c_str(), localpath, true);
   }
 
   rdctype::str CopyCaptureToRemote(const char *filename, float *progress)
   {
+    // identify the file by name, size and modification time, so the server can find a partial
+    // copy of it from an earlier interrupted transfer. The contents are checked before resuming.
+    uint64_t fileLength = 0;
+    {
+      FILE *f = FileIO::fopen(filename, "rb");
+      if(f)
+      {
+        FileIO::fseek64(f, 0, SEEK_END);
+        fileLength = FileIO::ftell64(f);
+        FileIO::fclose(f);
+      }
+    }
+
+    string name = basename(string(filename));
+    uint64_t lastmod = FileIO::GetModifiedTimestamp(filename);
+
     Serialiser sendData("", Serialiser::WRITING, false);
+    sendData.Serialise("name", name);
+    sendData.Serialise("fileLength", fileLength);
+    sendData.Serialise("lastmod", lastmod);
     Send(eRemoteServer_CopyCaptureToRemote, sendData);
 
     float dummy = 0.0f;
     if(progress == NULL)
       progress = &dummy;
 
-    sendData.Rewind();
+    RemoteServerPacket type = eRemoteServer_Noop;
+    Serialiser *ser = NULL;
+    Get(type, &ser);
+
+    if(type != eRemoteServer_CopyCaptureToRemote || ser == NULL)
+    {
+      SAFE_DELETE(ser);
+      return "";
+    }
+
+    uint64_t resumeOffset = 0, resumeChecksum = 0;
+    ser->Serialise("resumeOffset", resumeOffset);
+    ser->Serialise("resumeChecksum", resumeChecksum);
+    SAFE_DELETE(ser);
 
-    if(!SendChunkedFile(m_Socket, eRemoteServer_CopyCaptureToRemote, filename, sendData, progress))
+    if(!SendResumableFile(m_Socket, eRemoteServer_CopyCaptureToRemote, filename, resumeOffset,
+                          resumeChecksum, CompressCaptureTransfers, progress))
     {
       SAFE_DELETE(m_Socket);
       return "";
     }
 
-    RemoteServerPacket type = eRemoteServer_Noop;
-    Serialiser *ser = NULL;
     Get(type, &ser);
 
     if(type == eRemoteServer_CopyCaptureToRemote && ser)
@@ -25,6 +25,7 @@
 
 #include "replay_proxy.h"
 #include "lz4/lz4.h"
+#include "zstd/common/xxhash.h"
 
 // these functions do compile time asserts on the size of the structure, to
 // help prevent the structure changing without these functions being updated.
@@ -2089,15 +2090,21 @@ void ReplayProxy::EnsureTexCached(ResourceId texid, uint32_t arrayIdx, uint32_t
 
     const ProxyTextureProperties &proxy = m_ProxyTextures[texid];
 
-    size_t size;
-    byte *data = GetTextureData(texid, arrayIdx, mip, proxy.params, size);
+    ProxyData &cached = m_ProxyTextureData[entry];
+    vector<byte> &data = cached.data;
 
-    if(data)
-      m_Proxy->SetProxyTextureData(proxy.id, arrayIdx, mip, data, size);
+    m_ProxyDataSize -= data.size();
+    cached.lastUse = ++m_ProxyDataUse;
 
-    delete[] data;
+    // the proxy texture still has the previous contents, so only upload if something changed
+    if(GetTextureDataDelta(texid, arrayIdx, mip, proxy.params, data) && !data.empty())
+      m_Proxy->SetProxyTextureData(proxy.id, arrayIdx, mip, &data[0], data.size());
+
+    m_ProxyDataSize += data.size();
 
     m_TextureProxyCache.insert(entry);
+
+    TrimProxyData();
   }
 }
 
@@ -2116,16 +2123,87 @@ void ReplayProxy::EnsureBufCached(ResourceId bufid)
 
     ResourceId proxyid = m_ProxyBufferIds[bufid];
 
-    vector<byte> data;
-    GetBufferData(bufid, 0, 0, data);
+    ProxyData &cached = m_ProxyBufferData[bufid];
+    vector<byte> &data = cached.data;
 
-    if(!data.empty())
+    m_ProxyDataSize -= data.size();
+    cached.lastUse = ++m_ProxyDataUse;
+
+    if(GetBufferDataDelta(bufid, data) && !data.empty())
       m_Proxy->SetProxyBufferData(proxyid, &data[0], data.size());
 
+    m_ProxyDataSize += data.size();
+
     m_BufferProxyCache.insert(bufid);
+
+    TrimProxyData();
   }
 }
 
+void ReplayProxy::TrimProxyData()
+{
+  while(m_ProxyDataSize > MaxProxyDataSize)
+  {
+    auto oldestTex = m_ProxyTextureData.end();
+    auto oldestBuf = m_ProxyBufferData.end();
+
+    for(auto it = m_ProxyTextureData.begin(); it != m_ProxyTextureData.end(); ++it)
+      if(oldestTex == m_ProxyTextureData.end() || it->second.lastUse < oldestTex->second.lastUse)
+        oldestTex = it;
+
+    for(auto it = m_ProxyBufferData.begin(); it != m_ProxyBufferData.end(); ++it)
+      if(oldestBuf == m_ProxyBufferData.end() || it->second.lastUse < oldestBuf->second.lastUse)
+        oldestBuf = it;
+
+    if(oldestBuf != m_ProxyBufferData.end() &&
+       (oldestTex == m_ProxyTextureData.end() ||
+        oldestBuf->second.lastUse < oldestTex->second.lastUse))
+    {
+      m_ProxyDataSize -= oldestBuf->second.data.size();
+      m_ProxyBufferData.erase(oldestBuf);
+    }
+    else if(oldestTex != m_ProxyTextureData.end())
+    {
+      m_ProxyDataSize -= oldestTex->second.data.size();
+      m_ProxyTextureData.erase(oldestTex);
+    }
+    else
+    {
+      break;
+    }
+  }
+}
+
+void ReplayProxy::FreeProxyData(ResourceId id)
+{
+  for(auto it = m_ProxyTextureData.begin(); it != m_ProxyTextureData.end();)
+  {
+    if(it->first.replayid == id)
+    {
+      m_ProxyDataSize -= it->second.data.size();
+      it = m_ProxyTextureData.erase(it);
+    }
+    else
+    {
+      ++it;
+    }
+  }
+
+  auto buf = m_ProxyBufferData.find(id);
+  if(buf != m_ProxyBufferData.end())
+  {
+    m_ProxyDataSize -= buf->second.data.size();
+    m_ProxyBufferData.erase(buf);
+  }
+}
+
+void ReplayProxy::ClearProxyData()
+{
+  m_ProxyTextureData.clear();
+  m_ProxyBufferData.clear();
+  m_ProxyDataSize = 0;
+}
+
 bool ReplayProxy::Tick(int type, Serialiser *incomingPacket)
 {
   if(!m_RemoteServer)
@@ -2191,6 +2269,18 @@ bool ReplayProxy::Tick(int type, Serialiser *incomingPacket)
       GetTextureData(ResourceId(), 0, 0, GetTextureDataParams(), dummy);
       break;
     }
+    case eReplayProxy_GetBufferDataDelta:
+    {
+      vector<byte> dummy;
+      GetBufferDataDelta(ResourceId(), dummy);
+      break;
+    }
+    case eReplayProxy_GetTextureDataDelta:
+    {
+      vector<byte> dummy;
+      GetTextureDataDelta(ResourceId(), 0, 0, GetTextureDataParams(), dummy);
+      break;
+    }
     case eReplayProxy_InitPostVS: InitPostVSBuffers(0); break;
     case eReplayProxy_InitPostVSVec:
     {
@@ -2715,6 +2805,208 @@ byte *ReplayProxy::GetTextureData(ResourceId tex, uint32_t arrayIdx, uint32_t mi
   return NULL;
 }
 
+// Delta transfers split the data into fixed size blocks. The local side sends a hash of each block
+// in its previous copy, and the remote side sends back only the blocks that differ from its current
+// data, LZ4 compressed. Blocks are linear ranges of the data rather than 2D tiles, since the layout
+// varies by format - for a texture each block covers a band of rows.
+static const size_t DeltaBlockSize = 64 * 1024;
+
+static void HashDeltaBlocks(const byte *data, size_t size, vector<uint64_t> &hashes)
+{
+  hashes.resize((size + DeltaBlockSize - 1) / DeltaBlockSize);
+
+  for(size_t i = 0; i < hashes.size(); i++)
+  {
+    size_t offs = i * DeltaBlockSize;
+    hashes[i] = XXH64(data + offs, RDCMIN((size_t)DeltaBlockSize, size - offs), 0);
+  }
+}
+
+static void WriteDataDelta(Serialiser *ser, const byte *data, size_t size, uint64_t baseSize,
+                           const vector<uint64_t> &baseHashes)
+{
+  vector<uint64_t> hashes;
+  HashDeltaBlocks(data, size, hashes);
+
+  // if the size has changed, send everything
+  bool sizeChanged = (baseSize != (uint64_t)size);
+
+  vector<uint32_t> changedBlocks;
+  for(size_t i = 0; i < hashes.size(); i++)
+    if(sizeChanged || i >= baseHashes.size() || hashes[i] != baseHashes[i])
+      changedBlocks.push_back((uint32_t)i);
+
+  byte *changed = NULL;
+  size_t changedSize = 0;
+
+  if(!changedBlocks.empty())
+  {
+    changed = new byte[changedBlocks.size() * DeltaBlockSize];
+
+    for(size_t i = 0; i < changedBlocks.size(); i++)
+    {
+      size_t offs = changedBlocks[i] * DeltaBlockSize;
+      size_t len = RDCMIN((size_t)DeltaBlockSize, size - offs);
+      memcpy(changed + changedSize, data + offs, len);
+      changedSize += len;
+    }
+  }
+
+  byte *compressed = new byte[LZ4_COMPRESSBOUND(changedSize)];
+
+  uint32_t uncompressedSize = (uint32_t)changedSize;
+  uint32_t compressedSize = 0;
+  if(changedSize > 0)
+    compressedSize = (uint32_t)LZ4_compress_default((const char *)changed, (char *)compressed,
+                                                    (int)uncompressedSize,
+                                                    LZ4_COMPRESSBOUND(changedSize));
+
+  uint64_t totalSize = size;
+  ser->Serialise("", totalSize);
+  ser->Serialise("", changedBlocks);
+  ser->Serialise("", uncompressedSize);
+  ser->Serialise("", compressedSize);
+  ser->RawWriteBytes(compressed, (size_t)compressedSize);
+
+  delete[] changed;
+  delete[] compressed;
+}
+
+// applies a delta written by WriteDataDelta, returns true if anything changed
+static bool ReadDataDelta(Serialiser *ser, vector<byte> &data)
+{
+  uint64_t totalSize = 0;
+  vector<uint32_t> changedBlocks;
+  uint32_t uncompressedSize = 0;
+  uint32_t compressedSize = 0;
+
+  ser->Serialise("", totalSize);
+  ser->Serialise("", changedBlocks);
+  ser->Serialise("", uncompressedSize);
+  ser->Serialise("", compressedSize);
+
+  byte *compressed = (byte *)ser->RawReadBytes((size_t)compressedSize);
+
+  bool sizeChanged = (totalSize != (uint64_t)data.size());
+
+  if(changedBlocks.empty() && !sizeChanged)
+    return false;
+
+  data.resize((size_t)totalSize);
+
+  if(uncompressedSize == 0)
+    return true;
+
+  byte *changed = new byte[uncompressedSize];
+
+  int decompSize = LZ4_decompress_safe((const char *)compressed, (char *)changed,
+                                       (int)compressedSize, (int)uncompressedSize);
+
+  if(decompSize != (int)uncompressedSize)
+  {
+    RDCERR("Failed to decompress delta data");
+    delete[] changed;
+    data.clear();
+    return true;
+  }
+
+  size_t changedOffs = 0;
+
+  for(size_t i = 0; i < changedBlocks.size(); i++)
+  {
+    size_t offs = changedBlocks[i] * DeltaBlockSize;
+
+    if(offs >= data.size())
+      break;
+
+    size_t len = RDCMIN((size_t)DeltaBlockSize, data.size() - offs);
+
+    if(changedOffs + len > uncompressedSize)
+      break;
+
+    memcpy(&data[offs], changed + changedOffs, len);
+    changedOffs += len;
+  }
+
+  delete[] changed;
+
+  return true;
+}
+
+bool ReplayProxy::GetBufferDataDelta(ResourceId buff, vector<byte> &data)
+{
+  uint64_t baseSize = data.size();
+  vector<uint64_t> baseHashes;
+
+  if(!m_RemoteServer && !data.empty())
+    HashDeltaBlocks(&data[0], data.size(), baseHashes);
+
+  m_ToReplaySerialiser->Serialise("", buff);
+  m_ToReplaySerialiser->Serialise("", baseSize);
+  m_ToReplaySerialiser->Serialise("", baseHashes);
+
+  if(m_RemoteServer)
+  {
+    vector<byte> retData;
+    m_Remote->GetBufferData(buff, 0, 0, retData);
+
+    WriteDataDelta(m_FromReplaySerialiser, retData.empty() ? NULL : &retData[0], retData.size(),
+                   baseSize, baseHashes);
+  }
+  else
+  {
+    if(!SendReplayCommand(eReplayProxy_GetBufferDataDelta))
+      return false;
+
+    return ReadDataDelta(m_FromReplaySerialiser, data);
+  }
+
+  return false;
+}
+
+bool ReplayProxy::GetTextureDataDelta(ResourceId tex, uint32_t arrayIdx, uint32_t mip,
+                                      const GetTextureDataParams &_params, vector<byte> &data)
+{
+  GetTextureDataParams params = _params;    // Serialiser is non-const
+
+  uint64_t baseSize = data.size();
+  vector<uint64_t> baseHashes;
+
+  if(!m_RemoteServer && !data.empty())
+    HashDeltaBlocks(&data[0], data.size(), baseHashes);
+
+  m_ToReplaySerialiser->Serialise("", tex);
+  m_ToReplaySerialiser->Serialise("", arrayIdx);
+  m_ToReplaySerialiser->Serialise("", mip);
+  m_ToReplaySerialiser->Serialise("", params.forDiskSave);
+  m_ToReplaySerialiser->Serialise("", params.typeHint);
+  m_ToReplaySerialiser->Serialise("", params.resolve);
+  m_ToReplaySerialiser->Serialise("", params.remap);
+  m_ToReplaySerialiser->Serialise("", params.blackPoint);
+  m_ToReplaySerialiser->Serialise("", params.whitePoint);
+  m_ToReplaySerialiser->Serialise("", baseSize);
+  m_ToReplaySerialiser->Serialise("", baseHashes);
+
+  if(m_RemoteServer)
+  {
+    size_t size = 0;
+    byte *texData = m_Remote->GetTextureData(tex, arrayIdx, mip, params, size);
+
+    WriteDataDelta(m_FromReplaySerialiser, texData, texData ? size : 0, baseSize, baseHashes);
+
+    delete[] texData;
+  }
+  else
+  {
+    if(!SendReplayCommand(eReplayProxy_GetTextureDataDelta))
+      return false;
+
+    return ReadDataDelta(m_FromReplaySerialiser, data);
+  }
+
+  return false;
+}
+
 void ReplayProxy::InitPostVSBuffers(uint32_t eventID)
 {
   m_ToReplaySerialiser->Serialise("", eventID);
@@ -2846,6 +3138,8 @@ void ReplayProxy::FreeTargetResource(ResourceId id)
 {
   m_ToReplaySerialiser->Serialise("", id);
 
+  FreeProxyData(id);
+
   if(m_RemoteServer)
   {
     m_Remote->FreeTargetResource(id);
@@ -2962,6 +3256,9 @@ void ReplayProxy::ReplaceResource(ResourceId from, ResourceId to)
   m_ToReplaySerialiser->Serialise("", from);
   m_ToReplaySerialiser->Serialise("", to);
 
+  // a replacement can change the contents of anything downstream, so old data is a poor base
+  ClearProxyData();
+
   if(m_RemoteServer)
   {
     m_Remote->ReplaceResource(from, to);
@@ -2977,6 +3274,8 @@ void ReplayProxy::RemoveReplacement(ResourceId id)
 {
   m_ToReplaySerialiser->Serialise("", id);
 
+  ClearProxyData();
+
   if(m_RemoteServer)
   {
     m_Remote->RemoveReplacement(id);
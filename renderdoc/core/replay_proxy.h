@@ -30,6 +30,13 @@
 #include "serialise/serialiser.h"
 #include "socket_helpers.h"
 
+// defined with the other replay type serialisers in replay_proxy.cpp, and also used to store
+// reflection outside of the proxy
+template <>
+void Serialiser::Serialise(const char *name, ShaderReflection &el);
+template <>
+void Serialiser::Serialise(const char *name, ShaderBindpointMapping &el);
+
 enum ReplayProxyPacket
 {
   // we offset these packet numbers so that it can co-exist
@@ -85,6 +92,9 @@ enum ReplayProxyPacket
   eReplayProxy_GetAPIProperties,
 
   eReplayProxy_PixelHistory,
+
+  eReplayProxy_GetBufferDataDelta,
+  eReplayProxy_GetTextureDataDelta,
 };
 
 // This class implements IReplayDriver and StackResolver. On the local machine where the UI
@@ -102,6 +112,7 @@ public:
     m_FromReplaySerialiser = NULL;
     m_ToReplaySerialiser = new Serialiser(NULL, Serialiser::WRITING, false);
     m_RemoteHasResolver = false;
+    m_ProxyDataSize = m_ProxyDataUse = 0;
 
     GetAPIProperties();
   }
@@ -112,6 +123,7 @@ public:
     m_ToReplaySerialiser = NULL;
     m_FromReplaySerialiser = new Serialiser(NULL, Serialiser::WRITING, false);
     m_RemoteHasResolver = false;
+    m_ProxyDataSize = m_ProxyDataUse = 0;
 
     RDCEraseEl(m_APIProps);
   }
@@ -313,8 +325,12 @@ public:
     }
   }
 
-  uint32_t PickVertex(uint32_t eventID, const MeshDisplay &cfg, uint32_t x, uint32_t y)
+  uint32_t PickVertex(uint32_t eventID, const MeshDisplay &cfg, uint32_t x, uint32_t y,
+                      uint32_t *primitive)
   {
+    if(primitive)
+      *primitive = ~0U;
+
     if(m_Proxy && cfg.position.buf != ResourceId())
     {
       MeshDisplay proxiedCfg = cfg;
@@ -337,7 +353,7 @@ public:
         proxiedCfg.position.idxbuf = m_ProxyBufferIds[proxiedCfg.position.idxbuf];
       }
 
-      return m_Proxy->PickVertex(eventID, proxiedCfg, x, y);
+      return m_Proxy->PickVertex(eventID, proxiedCfg, x, y, primitive);
     }
 
     return ~0U;
@@ -487,6 +503,12 @@ private:
   void RemapProxyTextureIfNeeded(ResourceFormat &format, GetTextureDataParams &params);
   void EnsureBufCached(ResourceId bufid);
 
+  // fetch the contents of a buffer or texture subresource, given our previous copy of it in data.
+  // Only the blocks that have changed since that copy are sent over the network.
+  bool GetBufferDataDelta(ResourceId buff, vector<byte> &data);
+  bool GetTextureDataDelta(ResourceId tex, uint32_t arrayIdx, uint32_t mip,
+                           const GetTextureDataParams &params, vector<byte> &data);
+
   struct TextureCacheEntry
   {
     ResourceId replayid;
@@ -503,6 +525,25 @@ private:
     }
   };
   set<TextureCacheEntry> m_TextureProxyCache;
+
+  // the last data fetched for each proxied subresource and buffer, which the next fetch after the
+  // cache is cleared is delta'd against. Evicting one only costs a full fetch next time, so the
+  // total is kept under MaxProxyDataSize by dropping the least recently used.
+  struct ProxyData
+  {
+    vector<byte> data;
+    uint64_t lastUse;
+  };
+  map<TextureCacheEntry, ProxyData> m_ProxyTextureData;
+  map<ResourceId, ProxyData> m_ProxyBufferData;
+  uint64_t m_ProxyDataSize;
+  uint64_t m_ProxyDataUse;
+
+  static const uint64_t MaxProxyDataSize = 256 * 1024 * 1024;
+
+  void TrimProxyData();
+  void FreeProxyData(ResourceId id);
+  void ClearProxyData();
   set<ResourceId> m_LocalTextures;
 
   struct ProxyTextureProperties
@@ -66,6 +66,11 @@ void ResourceRecord::AddResourceReferences(ResourceRecordHandler *mgr)
 
 void ResourceRecord::Delete(ResourceRecordHandler *mgr)
 {
+  // frame references still buffered on any thread only take their reference on the record when
+  // merged, so merge before the last reference could be released
+  if(RefCount == 1)
+    mgr->MergeThreadReferences();
+
   int32_t ref = Atomic::Dec32(&RefCount);
   RDCASSERT(ref >= 0);
   if(ref <= 0)
@@ -25,9 +25,11 @@
 
 #pragma once
 
+#include <algorithm>
 #include <map>
 #include <set>
 #include "api/replay/renderdoc_replay.h"
+#include "common/flat_hash_map.h"
 #include "common/threading.h"
 #include "core/core.h"
 #include "os/os_specific.h"
@@ -73,6 +75,7 @@ public:
   virtual void MarkPendingDirty(ResourceId id) = 0;
   virtual void RemoveResourceRecord(ResourceId id) = 0;
   virtual void MarkResourceFrameReferenced(ResourceId id, FrameRefType refType) = 0;
+  virtual void MergeThreadReferences() = 0;
   virtual void DestroyResourceRecord(ResourceRecord *record) = 0;
 };
 
@@ -217,6 +220,26 @@ struct ResourceRecord
     UnlockChunks();
   }
 
+  // detach chunks from arena pages, recording where any moved data went
+  void DetachChunksFromArena(std::map<byte *, byte *> &moved)
+  {
+    LockChunks();
+    for(auto it = m_Chunks.begin(); it != m_Chunks.end(); ++it)
+    {
+      byte *data = it->second->GetData();
+      if(it->second->DetachFromArena())
+        moved[data] = it->second->GetData();
+    }
+    UnlockChunks();
+  }
+
+  void RemapDataPtr(const std::map<byte *, byte *> &moved)
+  {
+    auto it = moved.find(DataPtr);
+    if(DataPtr && it != moved.end())
+      DataPtr = it->second;
+  }
+
   void DeleteChunks()
   {
     LockChunks();
@@ -243,6 +266,11 @@ struct ResourceRecord
   bool HasDataPtr() { return DataPtr != NULL; }
   void SetDataOffset(uint64_t offs) { DataOffset = offs; }
   void SetDataPtr(byte *ptr) { DataPtr = ptr; }
+  void AddDataPointers(std::set<byte *> &ptrs)
+  {
+    if(DataPtr)
+      ptrs.insert(DataPtr);
+  }
   bool MarkResourceFrameReferenced(ResourceId id, FrameRefType refType);
   void AddResourceReferences(ResourceRecordHandler *mgr);
   void AddReferencedIDs(std::set<ResourceId> &ids)
@@ -278,7 +306,7 @@ protected:
   std::map<int32_t, Chunk *> m_Chunks;
   Threading::CriticalSection *m_ChunkLock;
 
-  map<ResourceId, FrameRefType> m_FrameRefs;
+  FlatHashMap<ResourceId, FrameRefType> m_FrameRefs;
 };
 
 // the resource manager is a utility class that's not required but is likely wanted by any API
@@ -325,6 +353,9 @@ public:
   inline void RemoveResourceRecord(ResourceId id);
   void DestroyResourceRecord(ResourceRecord *record);
 
+  // apply the frame references and dirty marks buffered by every thread
+  void MergeThreadReferences();
+
   // while capturing or replaying, resources and their live IDs
   void AddCurrentResource(ResourceId id, WrappedResourceType res);
   bool HasCurrentResource(ResourceId id);
@@ -340,6 +371,10 @@ public:
   // mark resource records as unwritten, ready to be written to a new logfile.
   void MarkUnwrittenResources();
 
+  // once a frame capture has finished, move chunks that resource records keep out of the frame's
+  // arena pages so they can be freed.
+  void DetachRecordChunksFromArena();
+
   // clear the list of frame-referenced resources - e.g. if you're about to recapture a frame
   void ClearReferencedResources();
 
@@ -365,6 +400,8 @@ public:
 
   InitialContentData GetInitialContents(ResourceId id);
   void SetInitialContents(ResourceId id, InitialContentData contents);
+  // on replay, the original IDs of every resource that has initial contents
+  void GetInitialContentIDs(vector<ResourceId> &ids);
   void SetInitialChunk(ResourceId id, Chunk *chunk);
 
   // generate chunks for initial contents and insert.
@@ -376,8 +413,11 @@ public:
   void Serialise_InitialContentsNeeded();
 
   // handle marking a resource referenced for read or write and storing RAW access etc.
-  static bool MarkReferenced(map<ResourceId, FrameRefType> &refs, ResourceId id,
-                             FrameRefType refType);
+  template <typename RefMap>
+  static bool MarkReferenced(RefMap &refs, ResourceId id, FrameRefType refType);
+  // combine a reference state that was tracked separately, with no known ordering against refs
+  template <typename RefMap>
+  static bool MergeReferenced(RefMap &refs, ResourceId id, FrameRefType refType);
 
   // mark resource referenced somewhere in the main frame-affecting calls.
   // That means this resource should be included in the final serialise out
@@ -450,43 +490,100 @@ protected:
   // operation is looking up data.
   Threading::CriticalSection m_Lock;
 
-  // easy optimisation win - don't use maps everywhere. It's convenient but not optimal, and
-  // profiling will
-  // likely prove that some or all of these could be a problem
+  // lookups by ResourceId happen on nearly every wrapped call or replay lookup, so those use flat
+  // hash maps. Anything that relies on iterating in ID order must stay a std::map.
 
   // used during capture - map from real resource to its wrapper (other way can be done just with an
   // Unwrap)
   map<RealResourceType, WrappedResourceType> m_WrapperMap;
 
   // used during capture - holds resources referenced in current frame (and how they're referenced)
-  map<ResourceId, FrameRefType> m_FrameReferencedResources;
+  FlatHashMap<ResourceId, FrameRefType> m_FrameReferencedResources;
 
   // used during capture - holds resources marked as dirty, needing initial contents
   set<ResourceId> m_DirtyResources;
   set<ResourceId> m_PendingDirtyResources;
 
+  // frame references and dirty marks happen on nearly every API call, so rather than contending
+  // on m_Lock each thread appends them to its own log, found through a TLS slot. Appending takes
+  // no locks. The logs are merged into the sets above under m_Lock whenever those are read.
+  //
+  // Each log is a list of fixed-size blocks with one writer (the owning thread) and one reader
+  // (whoever holds m_Lock). The writer publishes each entry by incrementing the block's count,
+  // and once the block is full it links the next block and increments count past Size to publish
+  // the link. The reader frees blocks it has finished that have been linked past, which the writer
+  // never touches again.
+  enum ThreadReferenceType
+  {
+    eThreadRef_Frame,
+    eThreadRef_Dirty,
+    eThreadRef_PendingDirty,
+  };
+
+  struct ThreadReference
+  {
+    bool operator==(const ThreadReference &o) const
+    {
+      return id == o.id && type == o.type && refType == o.refType;
+    }
+
+    ResourceId id;
+    ThreadReferenceType type;
+    FrameRefType refType;
+  };
+
+  struct ThreadReferenceBlock
+  {
+    enum
+    {
+      Size = 1024
+    };
+
+    ThreadReferenceBlock() : count(0), next(NULL) {}
+    ThreadReference entries[Size];
+    volatile int32_t count;
+    ThreadReferenceBlock *next;
+  };
+
+  struct ThreadReferences
+  {
+    // only used by the merging thread
+    ThreadReferenceBlock *head;
+    int32_t read;
+    // only used by the owning thread
+    ThreadReferenceBlock *tail;
+  };
+
+  ThreadReferences *GetThreadReferences();
+  void AppendThreadReference(ResourceId id, ThreadReferenceType type, FrameRefType refType);
+
+  uint64_t m_ThreadRefsSlot;
+  vector<ThreadReferences *> m_ThreadRefs;
+  // scratch for combining one thread's frame references in order while merging
+  FlatHashMap<ResourceId, FrameRefType> m_MergeRefs;
+
   // used during capture or replay - holds initial contents
-  map<ResourceId, InitialContentData> m_InitialContents;
+  FlatHashMap<ResourceId, InitialContentData> m_InitialContents;
   // on capture, if a chunk was prepared in Prepare_InitialContents and added, don't re-serialise.
   // Some initial contents may not need the delayed readback.
-  map<ResourceId, Chunk *> m_InitialChunks;
+  FlatHashMap<ResourceId, Chunk *> m_InitialChunks;
 
   // used during capture or replay - map of resources currently alive with their real IDs, used in
   // capture and replay.
-  map<ResourceId, WrappedResourceType> m_CurrentResourceMap;
+  FlatHashMap<ResourceId, WrappedResourceType> m_CurrentResourceMap;
 
   // used during replay - maps back and forth from original id to live id and vice-versa
-  map<ResourceId, ResourceId> m_OriginalIDs, m_LiveIDs;
+  FlatHashMap<ResourceId, ResourceId> m_OriginalIDs, m_LiveIDs;
 
   // used during replay - holds resources allocated and the original id that they represent
   // for a) in-frame creations and b) pre-frame creations respectively.
-  map<ResourceId, WrappedResourceType> m_InframeResourceMap, m_LiveResourceMap;
+  FlatHashMap<ResourceId, WrappedResourceType> m_InframeResourceMap, m_LiveResourceMap;
 
   // used during capture - holds resource records by id.
-  map<ResourceId, RecordType *> m_ResourceRecords;
+  FlatHashMap<ResourceId, RecordType *> m_ResourceRecords;
 
   // used during replay - holds current resource replacements
-  map<ResourceId, ResourceId> m_Replacements;
+  FlatHashMap<ResourceId, ResourceId> m_Replacements;
 };
 
 template <typename WrappedResourceType, typename RealResourceType, typename RecordType>
@@ -500,6 +597,8 @@ ResourceManager<WrappedResourceType, RealResourceType, RecordType>::ResourceMana
   m_pSerialiser = ser;
 
   m_InFrame = false;
+
+  m_ThreadRefsSlot = Threading::AllocateTLSSlot();
 }
 
 template <typename WrappedResourceType, typename RealResourceType, typename RecordType>
@@ -540,13 +639,27 @@ ResourceManager<WrappedResourceType, RealResourceType, RecordType>::~ResourceMan
   RDCASSERT(m_InitialContents.empty());
   RDCASSERT(m_ResourceRecords.empty());
 
+  for(size_t i = 0; i < m_ThreadRefs.size(); i++)
+  {
+    ThreadReferenceBlock *block = m_ThreadRefs[i]->head;
+    while(block)
+    {
+      ThreadReferenceBlock *next = block->next;
+      delete block;
+      block = next;
+    }
+
+    SAFE_DELETE(m_ThreadRefs[i]);
+  }
+
   if(RenderDoc::Inst().GetCrashHandler())
     RenderDoc::Inst().GetCrashHandler()->UnregisterMemoryRegion(this);
 }
 
 template <typename WrappedResourceType, typename RealResourceType, typename RecordType>
+template <typename RefMap>
 bool ResourceManager<WrappedResourceType, RealResourceType, RecordType>::MarkReferenced(
-    map<ResourceId, FrameRefType> &refs, ResourceId id, FrameRefType refType)
+    RefMap &refs, ResourceId id, FrameRefType refType)
 {
   if(refs.find(id) == refs.end())
   {
@@ -588,28 +701,170 @@ bool ResourceManager<WrappedResourceType, RealResourceType, RecordType>::MarkRef
 }
 
 template <typename WrappedResourceType, typename RealResourceType, typename RecordType>
-void ResourceManager<WrappedResourceType, RealResourceType, RecordType>::MarkResourceFrameReferenced(
-    ResourceId id, FrameRefType refType)
+template <typename RefMap>
+bool ResourceManager<WrappedResourceType, RealResourceType, RecordType>::MergeReferenced(
+    RefMap &refs, ResourceId id, FrameRefType refType)
 {
-  SCOPED_LOCK(m_Lock);
+  auto it = refs.find(id);
 
-  if(id == ResourceId())
+  if(it == refs.end())
+  {
+    refs[id] = refType;
+    return true;
+  }
+
+  // references made on different threads can't be ordered against each other, so if either side
+  // read the resource and the other wrote it, assume the read came first
+  if(refType == eFrameRef_Unknown)
+  {
+    // nothing
+  }
+  else if(it->second == eFrameRef_Unknown)
+  {
+    it->second = refType;
+  }
+  else if(it->second != refType)
+  {
+    it->second = eFrameRef_ReadBeforeWrite;
+  }
+
+  return false;
+}
+
+template <typename WrappedResourceType, typename RealResourceType, typename RecordType>
+typename ResourceManager<WrappedResourceType, RealResourceType, RecordType>::ThreadReferences
+    *ResourceManager<WrappedResourceType, RealResourceType, RecordType>::GetThreadReferences()
+{
+  ThreadReferences *refs = (ThreadReferences *)Threading::GetTLSValue(m_ThreadRefsSlot);
+
+  if(refs == NULL)
+  {
+    refs = new ThreadReferences;
+    refs->head = refs->tail = new ThreadReferenceBlock;
+    refs->read = 0;
+    Threading::SetTLSValue(m_ThreadRefsSlot, refs);
+
+    SCOPED_LOCK(m_Lock);
+    m_ThreadRefs.push_back(refs);
+  }
+
+  return refs;
+}
+
+template <typename WrappedResourceType, typename RealResourceType, typename RecordType>
+void ResourceManager<WrappedResourceType, RealResourceType, RecordType>::AppendThreadReference(
+    ResourceId id, ThreadReferenceType type, FrameRefType refType)
+{
+  ThreadReferences *refs = GetThreadReferences();
+  ThreadReferenceBlock *block = refs->tail;
+
+  ThreadReference ref;
+  ref.id = id;
+  ref.type = type;
+  ref.refType = refType;
+
+  // only this thread writes count, so it can be read directly
+  int32_t count = block->count;
+
+  // the same call repeated back to back is common, and applying it twice changes nothing
+  if(count > 0 && count <= ThreadReferenceBlock::Size && block->entries[count - 1] == ref)
     return;
 
-  bool newRef = MarkReferenced(m_FrameReferencedResources, id, refType);
+  if(count == ThreadReferenceBlock::Size)
+  {
+    ThreadReferenceBlock *next = new ThreadReferenceBlock;
+    block->next = next;
+    // publishes the link. After this the block belongs to the merging thread
+    Atomic::Inc32(&block->count);
 
-  if(newRef)
+    refs->tail = block = next;
+    count = 0;
+  }
+
+  block->entries[count] = ref;
+  // publishes the entry
+  Atomic::Inc32(&block->count);
+}
+
+template <typename WrappedResourceType, typename RealResourceType, typename RecordType>
+void ResourceManager<WrappedResourceType, RealResourceType, RecordType>::MergeThreadReferences()
+{
+  SCOPED_LOCK(m_Lock);
+
+  for(size_t i = 0; i < m_ThreadRefs.size(); i++)
   {
-    RecordType *record = GetResourceRecord(id);
+    ThreadReferences *refs = m_ThreadRefs[i];
 
-    if(record)
-      record->AddRef();
+    m_MergeRefs.clear();
+
+    while(refs->head)
+    {
+      ThreadReferenceBlock *block = refs->head;
+
+      // atomic read, that sees every entry published before the count
+      int32_t count = Atomic::CmpExch32(&block->count, 0, 0);
+
+      int32_t written = RDCMIN(count, (int32_t)ThreadReferenceBlock::Size);
+
+      for(; refs->read < written; refs->read++)
+      {
+        const ThreadReference &ref = block->entries[refs->read];
+
+        if(ref.type == eThreadRef_Frame)
+          MarkReferenced(m_MergeRefs, ref.id, ref.refType);
+        else if(ref.type == eThreadRef_Dirty)
+          m_DirtyResources.insert(ref.id);
+        else
+          m_PendingDirtyResources.insert(ref.id);
+      }
+
+      // the writer is still filling this block
+      if(count <= ThreadReferenceBlock::Size)
+        break;
+
+      refs->head = block->next;
+      refs->read = 0;
+      delete block;
+    }
+
+    // within a thread references were combined in order, but they can't be ordered against other
+    // threads' references
+    for(auto it = m_MergeRefs.begin(); it != m_MergeRefs.end(); ++it)
+    {
+      bool newRef = MergeReferenced(m_FrameReferencedResources, it->first, it->second);
+
+      // hold the record until the frame references are cleared, so it stays alive for the capture
+      // even if the resource is destroyed
+      if(newRef)
+      {
+        RecordType *record = GetResourceRecord(it->first);
+
+        if(record)
+          record->AddRef();
+      }
+    }
   }
+
+  m_MergeRefs.clear();
+}
+
+template <typename WrappedResourceType, typename RealResourceType, typename RecordType>
+void ResourceManager<WrappedResourceType, RealResourceType, RecordType>::MarkResourceFrameReferenced(
+    ResourceId id, FrameRefType refType)
+{
+  if(id == ResourceId())
+    return;
+
+  AppendThreadReference(id, eThreadRef_Frame, refType);
 }
 
 template <typename WrappedResourceType, typename RealResourceType, typename RecordType>
 bool ResourceManager<WrappedResourceType, RealResourceType, RecordType>::ReadBeforeWrite(ResourceId id)
 {
+  SCOPED_LOCK(m_Lock);
+
+  MergeThreadReferences();
+
   if(m_FrameReferencedResources.find(id) != m_FrameReferencedResources.end())
     return m_FrameReferencedResources[id] == eFrameRef_ReadBeforeWrite ||
            m_FrameReferencedResources[id] == eFrameRef_ReadOnly;
@@ -620,23 +875,19 @@ bool ResourceManager<WrappedResourceType, RealResourceType, RecordType>::ReadBef
 template <typename WrappedResourceType, typename RealResourceType, typename RecordType>
 void ResourceManager<WrappedResourceType, RealResourceType, RecordType>::MarkDirtyResource(ResourceId res)
 {
-  SCOPED_LOCK(m_Lock);
-
   if(res == ResourceId())
     return;
 
-  m_DirtyResources.insert(res);
+  AppendThreadReference(res, eThreadRef_Dirty, eFrameRef_Unknown);
 }
 
 template <typename WrappedResourceType, typename RealResourceType, typename RecordType>
 void ResourceManager<WrappedResourceType, RealResourceType, RecordType>::MarkPendingDirty(ResourceId res)
 {
-  SCOPED_LOCK(m_Lock);
-
   if(res == ResourceId())
     return;
 
-  m_PendingDirtyResources.insert(res);
+  AppendThreadReference(res, eThreadRef_PendingDirty, eFrameRef_Unknown);
 }
 
 template <typename WrappedResourceType, typename RealResourceType, typename RecordType>
@@ -644,6 +895,8 @@ void ResourceManager<WrappedResourceType, RealResourceType, RecordType>::FlushPe
 {
   SCOPED_LOCK(m_Lock);
 
+  MergeThreadReferences();
+
   m_DirtyResources.insert(m_PendingDirtyResources.begin(), m_PendingDirtyResources.end());
   m_PendingDirtyResources.clear();
 }
@@ -651,11 +904,13 @@ void ResourceManager<WrappedResourceType, RealResourceType, RecordType>::FlushPe
 template <typename WrappedResourceType, typename RealResourceType, typename RecordType>
 bool ResourceManager<WrappedResourceType, RealResourceType, RecordType>::IsResourceDirty(ResourceId res)
 {
-  SCOPED_LOCK(m_Lock);
-
   if(res == ResourceId())
     return false;
 
+  SCOPED_LOCK(m_Lock);
+
+  MergeThreadReferences();
+
   return m_DirtyResources.find(res) != m_DirtyResources.end();
 }
 
@@ -693,6 +948,22 @@ void ResourceManager<WrappedResourceType, RealResourceType, RecordType>::SetInit
   m_InitialContents[id] = contents;
 }
 
+template <typename WrappedResourceType, typename RealResourceType, typename RecordType>
+void ResourceManager<WrappedResourceType, RealResourceType, RecordType>::GetInitialContentIDs(
+    vector<ResourceId> &ids)
+{
+  SCOPED_LOCK(m_Lock);
+
+  ids.clear();
+  ids.reserve(m_InitialContents.size());
+
+  for(auto it = m_InitialContents.begin(); it != m_InitialContents.end(); ++it)
+    ids.push_back(it->first);
+
+  // the hash map isn't ordered, but the contents are serialised in this order
+  std::sort(ids.begin(), ids.end());
+}
+
 template <typename WrappedResourceType, typename RealResourceType, typename RecordType>
 void ResourceManager<WrappedResourceType, RealResourceType, RecordType>::SetInitialChunk(ResourceId id,
                                                                                          Chunk *chunk)
@@ -735,10 +1006,14 @@ void ResourceManager<WrappedResourceType, RealResourceType, RecordType>::Seriali
 {
   SCOPED_LOCK(m_Lock);
 
+  MergeThreadReferences();
+
   struct WrittenRecord
   {
     ResourceId id;
     bool written;
+
+    bool operator<(const WrittenRecord &o) const { return id < o.id; }
   };
   vector<WrittenRecord> written;
 
@@ -769,6 +1044,9 @@ void ResourceManager<WrappedResourceType, RealResourceType, RecordType>::Seriali
     }
   }
 
+  // frame references are in a hash map, so sort to keep captures deterministic
+  std::sort(written.begin(), written.end());
+
   uint32_t numWritten = (uint32_t)written.size();
   m_pSerialiser->Serialise("NumWrittenResources", numWritten);
 
@@ -782,14 +1060,13 @@ void ResourceManager<WrappedResourceType, RealResourceType, RecordType>::Seriali
 template <typename WrappedResourceType, typename RealResourceType, typename RecordType>
 void ResourceManager<WrappedResourceType, RealResourceType, RecordType>::FreeInitialContents()
 {
-  while(!m_InitialContents.empty())
+  for(auto it = m_InitialContents.begin(); it != m_InitialContents.end(); ++it)
   {
-    auto it = m_InitialContents.begin();
     ResourceTypeRelease(it->second.resource);
     Serialiser::FreeAlignedBuffer(it->second.blob);
-    if(!m_InitialContents.empty())
-      m_InitialContents.erase(m_InitialContents.begin());
   }
+
+  m_InitialContents.clear();
 }
 
 template <typename WrappedResourceType, typename RealResourceType, typename RecordType>
@@ -864,6 +1141,27 @@ void ResourceManager<WrappedResourceType, RealResourceType, RecordType>::MarkUnw
   }
 }
 
+template <typename WrappedResourceType, typename RealResourceType, typename RecordType>
+void ResourceManager<WrappedResourceType, RealResourceType, RecordType>::DetachRecordChunksFromArena()
+{
+  SCOPED_LOCK(m_Lock);
+
+  std::map<byte *, byte *> moved;
+
+  for(auto it = m_ResourceRecords.begin(); it != m_ResourceRecords.end(); ++it)
+    it->second->DetachChunksFromArena(moved);
+
+  if(moved.empty())
+    return;
+
+  RDCDEBUG("Moved %u resource record chunks out of the frame arena", (uint32_t)moved.size());
+
+  // records can point their data at a chunk belonging to another record (e.g. D3D11 subresources
+  // at their parent's chunks), so only remap once every record has moved its chunks
+  for(auto it = m_ResourceRecords.begin(); it != m_ResourceRecords.end(); ++it)
+    it->second->RemapDataPtr(moved);
+}
+
 template <typename WrappedResourceType, typename RealResourceType, typename RecordType>
 void ResourceManager<WrappedResourceType, RealResourceType, RecordType>::InsertReferencedChunks(
     Serialiser *fileSer)
@@ -872,6 +1170,8 @@ void ResourceManager<WrappedResourceType, RealResourceType, RecordType>::InsertR
 
   SCOPED_LOCK(m_Lock);
 
+  MergeThreadReferences();
+
   RDCDEBUG("%u frame resource records", (uint32_t)m_FrameReferencedResources.size());
 
   if(RenderDoc::Inst().GetCaptureOptions().RefAllResources)
@@ -896,9 +1196,21 @@ void ResourceManager<WrappedResourceType, RealResourceType, RecordType>::InsertR
 
   RDCDEBUG("%u frame resource chunks", (uint32_t)sortedChunks.size());
 
+  // records can point their CPU-side contents at a chunk's data and update it in place once the
+  // capture ends. The background writer would see those updates, so those chunks are copied.
+  std::set<byte *> dataPtrs;
+  if(fileSer->IsWritingAsync())
+  {
+    for(auto it = m_ResourceRecords.begin(); it != m_ResourceRecords.end(); ++it)
+      it->second->AddDataPointers(dataPtrs);
+  }
+
   for(auto it = sortedChunks.begin(); it != sortedChunks.end(); it++)
   {
-    fileSer->Insert(it->second);
+    if(dataPtrs.find(it->second->GetData()) != dataPtrs.end())
+      fileSer->InsertSnapshot(it->second);
+    else
+      fileSer->Insert(it->second);
   }
 
   RDCDEBUG("inserted to serialiser");
@@ -909,6 +1221,8 @@ void ResourceManager<WrappedResourceType, RealResourceType, RecordType>::Prepare
 {
   SCOPED_LOCK(m_Lock);
 
+  MergeThreadReferences();
+
   RDCDEBUG("Preparing up to %u potentially dirty resources", (uint32_t)m_DirtyResources.size());
   uint32_t prepared = 0;
 
@@ -959,6 +1273,8 @@ void ResourceManager<WrappedResourceType, RealResourceType, RecordType>::InsertI
 {
   SCOPED_LOCK(m_Lock);
 
+  MergeThreadReferences();
+
   uint32_t dirty = 0;
   uint32_t skipped = 0;
 
@@ -1044,10 +1360,20 @@ void ResourceManager<WrappedResourceType, RealResourceType, RecordType>::InsertI
 
   dirty = 0;
 
+  // the current resources are in a hash map, so visit them in ID order to keep the order of the
+  // initial contents chunks deterministic
+  vector<ResourceId> currentIds;
+  currentIds.reserve(m_CurrentResourceMap.size());
+
   for(auto it = m_CurrentResourceMap.begin(); it != m_CurrentResourceMap.end(); ++it)
+    if(it->second != (WrappedResourceType)RecordType::NullResource)
+      currentIds.push_back(it->first);
+
+  std::sort(currentIds.begin(), currentIds.end());
+
+  for(size_t i = 0; i < currentIds.size(); i++)
   {
-    if(it->second == (WrappedResourceType)RecordType::NullResource)
-      continue;
+    auto it = m_CurrentResourceMap.find(currentIds[i]);
 
     if(Force_InitialState(it->second, false))
     {
@@ -1101,15 +1427,19 @@ void ResourceManager<WrappedResourceType, RealResourceType, RecordType>::ClearRe
 {
   SCOPED_LOCK(m_Lock);
 
-  for(auto it = m_FrameReferencedResources.begin(); it != m_FrameReferencedResources.end(); ++it)
+  MergeThreadReferences();
+
+  // releasing a record can merge references made since, which belong to the next frame
+  FlatHashMap<ResourceId, FrameRefType> frameRefs;
+  frameRefs.swap(m_FrameReferencedResources);
+
+  for(auto it = frameRefs.begin(); it != frameRefs.end(); ++it)
   {
     RecordType *record = GetResourceRecord(it->first);
 
     if(record)
       record->Delete(this);
   }
-
-  m_FrameReferencedResources.clear();
 }
 
 template <typename WrappedResourceType, typename RealResourceType, typename RecordType>
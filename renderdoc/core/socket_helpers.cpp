@@ -0,0 +1,441 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015-2017 Baldur Karlsson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+#include "3rdparty/lz4/lz4.h"
+#include "3rdparty/zstd/common/xxhash.h"
+#include "common/threading.h"
+#include "os/os_specific.h"
+#include "serialise/serialiser.h"
+#include "socket_helpers.h"
+
+// amount of file data in each block, before compression
+static const uint32_t TransferBlockSize = 4 * 1024 * 1024;
+
+// how many blocks the read-ahead thread can get ahead of the socket
+static const uint32_t TransferReadAhead = 4;
+
+static uint64_t ChecksumFilePrefix(FILE *f, uint64_t length)
+{
+  XXH64_state_t *state = XXH64_createState();
+  XXH64_reset(state, 0);
+
+  byte *buf = new byte[TransferBlockSize];
+
+  FileIO::fseek64(f, 0, SEEK_SET);
+
+  while(length > 0)
+  {
+    size_t chunkSize = (size_t)RDCMIN(length, (uint64_t)TransferBlockSize);
+    size_t numRead = FileIO::fread(buf, 1, chunkSize, f);
+
+    XXH64_update(state, buf, numRead);
+
+    if(numRead != chunkSize)
+      break;
+
+    length -= chunkSize;
+  }
+
+  delete[] buf;
+
+  uint64_t ret = XXH64_digest(state);
+  XXH64_freeState(state);
+
+  return ret;
+}
+
+void GetResumePoint(const char *filename, uint64_t &offset, uint64_t &checksum)
+{
+  offset = checksum = 0;
+
+  FILE *f = FileIO::fopen(filename, "rb");
+
+  if(f == NULL)
+    return;
+
+  FileIO::fseek64(f, 0, SEEK_END);
+  offset = FileIO::ftell64(f);
+
+  if(offset > 0)
+    checksum = ChecksumFilePrefix(f, offset);
+
+  FileIO::fclose(f);
+}
+
+namespace
+{
+struct TransferBlock
+{
+  byte *raw;
+  byte *compressed;
+  uint32_t rawSize;
+
+  // points to either the raw or compressed data, whichever is going to be sent
+  byte *data;
+  uint32_t dataSize;
+};
+
+struct FileReadAhead
+{
+  FILE *f;
+  uint64_t remaining;
+  bool compress;
+
+  TransferBlock blocks[TransferReadAhead];
+
+  // the reader fills blocks[produced % TransferReadAhead] and the sender empties
+  // blocks[consumed % TransferReadAhead].
+  Threading::CriticalSection lock;
+  uint32_t produced;
+  uint32_t consumed;
+  bool readFailed;
+  bool abort;
+};
+}
+
+// reads and compresses the next block of the file
+static bool ReadBlock(FileReadAhead &r, TransferBlock &block)
+{
+  block.rawSize = (uint32_t)RDCMIN(r.remaining, (uint64_t)TransferBlockSize);
+
+  if(FileIO::fread(block.raw, 1, block.rawSize, r.f) != block.rawSize)
+    return false;
+
+  r.remaining -= block.rawSize;
+
+  block.data = block.raw;
+  block.dataSize = block.rawSize;
+
+  if(r.compress)
+  {
+    int compSize = LZ4_compress_default((const char *)block.raw, (char *)block.compressed,
+                                        (int)block.rawSize, LZ4_compressBound(TransferBlockSize));
+
+    // captures are mostly compressed already, so only send compressed data if it's smaller
+    if(compSize > 0 && (uint32_t)compSize < block.rawSize)
+    {
+      block.data = block.compressed;
+      block.dataSize = (uint32_t)compSize;
+    }
+  }
+
+  return true;
+}
+
+static void ReadAheadThread(void *userData)
+{
+  FileReadAhead &r = *(FileReadAhead *)userData;
+
+  while(r.remaining > 0)
+  {
+    for(;;)
+    {
+      {
+        SCOPED_LOCK(r.lock);
+
+        if(r.abort)
+          return;
+
+        if(r.produced - r.consumed < TransferReadAhead)
+          break;
+      }
+
+      Threading::Sleep(1);
+    }
+
+    // only this thread modifies produced, so it's safe to read without the lock
+    if(!ReadBlock(r, r.blocks[r.produced % TransferReadAhead]))
+    {
+      SCOPED_LOCK(r.lock);
+      r.readFailed = true;
+      return;
+    }
+
+    {
+      SCOPED_LOCK(r.lock);
+      r.produced++;
+    }
+  }
+}
+
+bool SendResumableFile(Network::Socket *sock, uint32_t packetType, const char *filename,
+                       uint64_t resumeOffset, uint64_t resumeChecksum, bool compress,
+                       float *progress)
+{
+  if(sock == NULL)
+    return false;
+
+  FILE *f = FileIO::fopen(filename, "rb");
+
+  bool valid = (f != NULL);
+  uint64_t fileLength = 0;
+  uint64_t startOffset = 0;
+
+  if(f)
+  {
+    FileIO::fseek64(f, 0, SEEK_END);
+    fileLength = FileIO::ftell64(f);
+
+    if(resumeOffset > 0 && resumeOffset <= fileLength &&
+       ChecksumFilePrefix(f, resumeOffset) == resumeChecksum)
+      startOffset = resumeOffset;
+  }
+
+  // always send the header, even on failure, so the receiver isn't left waiting
+  Serialiser header("", Serialiser::WRITING, false);
+  header.Serialise("valid", valid);
+  header.Serialise("fileLength", fileLength);
+  header.Serialise("startOffset", startOffset);
+
+  if(!SendPacket(sock, packetType, header) || !valid)
+  {
+    if(f)
+      FileIO::fclose(f);
+    return false;
+  }
+
+  if(startOffset > 0)
+    RDCLOG("Resuming transfer of '%s' at %llu of %llu bytes", filename, startOffset, fileLength);
+
+  FileIO::fseek64(f, startOffset, SEEK_SET);
+
+  FileReadAhead r;
+  r.f = f;
+  r.remaining = fileLength - startOffset;
+  r.compress = compress;
+  r.produced = r.consumed = 0;
+  r.readFailed = r.abort = false;
+
+  for(uint32_t i = 0; i < TransferReadAhead; i++)
+  {
+    r.blocks[i].raw = new byte[TransferBlockSize];
+    r.blocks[i].compressed = compress ? new byte[LZ4_compressBound(TransferBlockSize)] : NULL;
+  }
+
+  Threading::ThreadHandle thread = Threading::CreateThread(&ReadAheadThread, &r);
+
+  // without the thread, each block is read just before it's sent
+  if(thread == 0)
+    RDCWARN("Couldn't create read-ahead thread, reading '%s' synchronously", filename);
+
+  if(progress)
+    *progress = RDCMAX(0.0001f, fileLength > 0 ? float(startOffset) / float(fileLength) : 0.0f);
+
+  bool success = true;
+  uint64_t sent = startOffset;
+
+  while(success && sent < fileLength)
+  {
+    if(thread == 0)
+    {
+      if(ReadBlock(r, r.blocks[r.produced % TransferReadAhead]))
+      {
+        r.produced++;
+      }
+      else
+      {
+        RDCERR("Failed to read from '%s'", filename);
+        success = false;
+        break;
+      }
+    }
+
+    for(;;)
+    {
+      {
+        SCOPED_LOCK(r.lock);
+
+        if(r.produced > r.consumed)
+          break;
+
+        if(r.readFailed)
+        {
+          RDCERR("Failed to read from '%s'", filename);
+          success = false;
+          break;
+        }
+      }
+
+      Threading::Sleep(1);
+    }
+
+    if(!success)
+      break;
+
+    const TransferBlock &block = r.blocks[r.consumed % TransferReadAhead];
+
+    // each packet holds the uncompressed size, followed by the data. If the data is smaller than
+    // the uncompressed size, it's LZ4 compressed
+    uint32_t payloadLength = sizeof(uint32_t) + block.dataSize;
+
+    if(!sock->SendDataBlocking(&packetType, sizeof(packetType)) ||
+       !sock->SendDataBlocking(&payloadLength, sizeof(payloadLength)) ||
+       !sock->SendDataBlocking(&block.rawSize, sizeof(block.rawSize)) ||
+       !sock->SendDataBlocking(block.data, block.dataSize))
+    {
+      success = false;
+      break;
+    }
+
+    sent += block.rawSize;
+
+    {
+      SCOPED_LOCK(r.lock);
+      r.consumed++;
+    }
+
+    if(progress)
+      *progress = float(sent) / float(fileLength);
+  }
+
+  if(thread)
+  {
+    {
+      SCOPED_LOCK(r.lock);
+      r.abort = true;
+    }
+
+    Threading::JoinThread(thread);
+    Threading::CloseThread(thread);
+  }
+
+  for(uint32_t i = 0; i < TransferReadAhead; i++)
+  {
+    SAFE_DELETE_ARRAY(r.blocks[i].raw);
+    SAFE_DELETE_ARRAY(r.blocks[i].compressed);
+  }
+
+  FileIO::fclose(f);
+
+  return success;
+}
+
+bool RecvResumableFile(Network::Socket *sock, uint32_t packetType, const char *filename,
+                       float *progress)
+{
+  if(sock == NULL)
+    return false;
+
+  vector<byte> payload;
+  uint32_t type = 0;
+
+  if(!RecvPacket(sock, type, payload) || type != packetType || payload.empty())
+    return false;
+
+  bool valid = false;
+  uint64_t fileLength = 0;
+  uint64_t startOffset = 0;
+
+  {
+    Serialiser header(payload.size(), &payload[0], false);
+    header.Serialise("valid", valid);
+    header.Serialise("fileLength", fileLength);
+    header.Serialise("startOffset", startOffset);
+  }
+
+  if(!valid)
+    return false;
+
+  FILE *f = FileIO::fopen(filename, startOffset > 0 ? "ab" : "wb");
+
+  if(f == NULL)
+    return false;
+
+  // the sender only resumes from the offset we gave it, so the file should still be that size
+  if(startOffset > 0)
+  {
+    FileIO::fseek64(f, 0, SEEK_END);
+    if(FileIO::ftell64(f) != startOffset)
+    {
+      RDCERR("'%s' changed size during transfer", filename);
+      FileIO::fclose(f);
+      return false;
+    }
+
+    RDCLOG("Resuming transfer to '%s' at %llu of %llu bytes", filename, startOffset, fileLength);
+  }
+
+  if(progress)
+    *progress = RDCMAX(0.0001f, fileLength > 0 ? float(startOffset) / float(fileLength) : 0.0f);
+
+  byte *decompressed = new byte[TransferBlockSize];
+
+  bool success = true;
+  uint64_t received = startOffset;
+
+  while(received < fileLength)
+  {
+    if(!RecvPacket(sock, type, payload) || type != packetType || payload.size() <= sizeof(uint32_t))
+    {
+      success = false;
+      break;
+    }
+
+    uint32_t rawSize = 0;
+    memcpy(&rawSize, &payload[0], sizeof(uint32_t));
+
+    const byte *data = &payload[sizeof(uint32_t)];
+    uint32_t dataSize = uint32_t(payload.size() - sizeof(uint32_t));
+
+    if(rawSize > TransferBlockSize || rawSize > fileLength - received || dataSize > rawSize)
+    {
+      RDCERR("Invalid block received for '%s'", filename);
+      success = false;
+      break;
+    }
+
+    if(dataSize < rawSize)
+    {
+      int decompSize = LZ4_decompress_safe((const char *)data, (char *)decompressed, (int)dataSize,
+                                           (int)rawSize);
+
+      if(decompSize != (int)rawSize)
+      {
+        RDCERR("Failed to decompress block received for '%s'", filename);
+        success = false;
+        break;
+      }
+
+      data = decompressed;
+    }
+
+    if(FileIO::fwrite(data, 1, rawSize, f) != rawSize)
+    {
+      RDCERR("Failed to write to '%s'", filename);
+      success = false;
+      break;
+    }
+
+    received += rawSize;
+
+    if(progress)
+      *progress = float(received) / float(fileLength);
+  }
+
+  delete[] decompressed;
+
+  FileIO::fclose(f);
+
+  return success;
+}
@@ -252,3 +252,25 @@ bool SendChunkedFile(Network::Socket *sock, PacketTypeEnum type, const char *log
 
   return true;
 }
+
+// Resumable file transfers, used for copying captures to and from a remote server.
+//
+// The receiving side first calls GetResumePoint() on whatever partial copy it has and sends the
+// result to the other end. The sending side then calls SendResumableFile(), which checks the
+// receiver's data against its own copy of the file and only sends the remainder if they match, or
+// the whole file if not. The receiver calls RecvResumableFile() to get the data, appending to its
+// partial copy where possible. If a transfer fails part-way, the partial file is left behind so
+// that the next attempt can pick up from where it stopped.
+//
+// Data is sent in blocks that can optionally be LZ4 compressed, and on the sending side a
+// read-ahead thread reads and compresses blocks while earlier ones are being sent.
+
+// returns the size of the file and a checksum of its contents, or 0 for both if it doesn't exist
+void GetResumePoint(const char *filename, uint64_t &offset, uint64_t &checksum);
+
+bool SendResumableFile(Network::Socket *sock, uint32_t packetType, const char *filename,
+                       uint64_t resumeOffset, uint64_t resumeChecksum, bool compress,
+                       float *progress);
+
+bool RecvResumableFile(Network::Socket *sock, uint32_t packetType, const char *filename,
+                       float *progress);
@@ -41,6 +41,9 @@
 
 // over this number of cycles and things get problematic
 #define SHADER_DEBUG_WARN_THRESHOLD 100000
+// upper bound on the instructions executed across all threads when simulating a whole threadgroup,
+// as each one copies a thread's full state
+#define SHADER_DEBUG_MAX_GROUP_STEPS 4000000U
 
 bool PromptDebugTimeout(DXBC::ProgramType prog, uint32_t cycleCounter)
 {
@@ -2112,117 +2115,20 @@ ShaderDebugTrace D3D11DebugManager::DebugPixel(uint32_t eventID, uint32_t x, uin
 
   states.push_back((State)quad[destIdx]);
 
-  // ping pong between so that we can have 'current' quad to update into new one
-  State quad2[4];
-
-  State *curquad = quad;
-  State *newquad = quad2;
-
-  // marks any threads stalled waiting for others to catch up
-  bool activeMask[4] = {true, true, true, true};
+  LaneGroup lanes(dxbc, vector<State>(quad, quad + 4), true);
 
   int cycleCounter = 0;
 
   D3D11MarkerRegion simloop("Simulation Loop");
 
-  // simulate lockstep until all threads are finished
-  bool finished = true;
-  do
+  // simulate lockstep until our destination pixel is finished
+  while(!lanes.GetLane(destIdx).Finished())
   {
-    for(size_t i = 0; i < 4; i++)
-    {
-      if(activeMask[i])
-        newquad[i] = curquad[i].GetNext(global, curquad);
-      else
-        newquad[i] = curquad[i];
-    }
-
-    State *a = curquad;
-    curquad = newquad;
-    newquad = a;
-
-    // if our destination quad is paused don't record multiple identical states.
-    if(activeMask[destIdx])
-      states.push_back((State)curquad[destIdx]);
-
-    // we need to make sure that control flow which converges stays in lockstep so that
-    // derivatives are still valid. While diverged, we don't have to keep threads in lockstep
-    // since using derivatives is invalid.
-
-    // Threads diverge either in ifs, loops, or switches. Due to the nature of the bytecode,
-    // all threads *must* pass through the same exit instruction for each, there's no jumping
-    // around with gotos. Note also for the same reason, the only time threads are on earlier
-    // instructions is if they are still catching up to a thread that has exited the control
-    // flow.
-
-    // So the scheme is as follows:
-    // * If all threads have the same nextInstruction, just continue we are still in lockstep.
-    // * If threads are out of lockstep, find any thread which has nextInstruction pointing
-    //   immediately *after* an ENDIF, ENDLOOP or ENDSWITCH. Pointing directly at one is not
-    //   an indication the thread is done, as the next step for an ENDLOOP will jump back to
-    //   the matching LOOP and continue iterating.
-    // * Pause any thread matching the above until all threads are pointing to the same
-    //   instruction. By the assumption above, all threads will eventually pass through this
-    //   terminating instruction so we just pause any other threads and don't do anything
-    //   until the control flow has converged and we can continue stepping in lockstep.
-
-    // mark all threads as active again.
-    // if we've converged, or we were never diverged, this keeps everything ticking
-    activeMask[0] = activeMask[1] = activeMask[2] = activeMask[3] = true;
-
-    if(curquad[0].nextInstruction != curquad[1].nextInstruction ||
-       curquad[0].nextInstruction != curquad[2].nextInstruction ||
-       curquad[0].nextInstruction != curquad[3].nextInstruction)
-    {
-      // this isn't *perfect* but it will still eventually continue. We look for the most
-      // advanced thread, and check to see if it's just finished a control flow. If it has
-      // then we assume it's at the convergence point and wait for every other thread to
-      // catch up, pausing any threads that reach the convergence point before others.
-
-      // Note this might mean we don't have any threads paused even within divergent flow.
-      // This is fine and all we care about is pausing to make sure threads don't run ahead
-      // into code that should be lockstep. We don't care at all about what they do within
-      // the code that is divergent.
-
-      // The reason this isn't perfect is that the most advanced thread could be on an
-      // inner loop or inner if, not the convergence point, and we could be pausing it
-      // fruitlessly. Worse still - it could be on a branch none of the other threads will
-      // take so they will never reach that exact instruction.
-      // But we know that all threads will eventually go through the convergence point, so
-      // even in that worst case if we didn't pick the right waiting point, another thread
-      // will overtake and become the new most advanced thread and the previous waiting
-      // thread will resume. So in this case we caused a thread to wait more than it should
-      // have but that's not a big deal as it's within divergent flow so they don't have to
-      // stay in lockstep. Also if all threads will eventually pass that point we picked,
-      // we just waited to converge even in technically divergent code which is also
-      // harmless.
-
-      // Phew!
-
-      uint32_t convergencePoint = 0;
-
-      // find which thread is most advanced
-      for(size_t i = 0; i < 4; i++)
-        if(curquad[i].nextInstruction > convergencePoint)
-          convergencePoint = curquad[i].nextInstruction;
-
-      if(convergencePoint > 0)
-      {
-        OpcodeType op = dxbc->GetInstruction(convergencePoint - 1).operation;
-
-        // if the most advnaced thread hasn't just finished control flow, then all
-        // threads are still running, so don't converge
-        if(op != OPCODE_ENDIF && op != OPCODE_ENDLOOP && op != OPCODE_ENDSWITCH)
-          convergencePoint = 0;
-      }
-
-      // pause any threads at that instruction (could be none)
-      for(size_t i = 0; i < 4; i++)
-        if(curquad[i].nextInstruction == convergencePoint)
-          activeMask[i] = false;
-    }
+    lanes.Step(global);
 
-    finished = curquad[destIdx].Finished();
+    // if our destination lane is paused don't record multiple identical states.
+    if(lanes.Stepped(destIdx))
+      states.push_back((State)lanes.GetLane(destIdx));
 
     cycleCounter++;
 
@@ -2231,7 +2137,7 @@ ShaderDebugTrace D3D11DebugManager::DebugPixel(uint32_t eventID, uint32_t x, uin
       if(PromptDebugTimeout(DXBC::TYPE_VERTEX, cycleCounter))
         break;
     }
-  } while(!finished);
+  }
 
   traces[destIdx].states = states;
 
@@ -2292,19 +2198,130 @@ ShaderDebugTrace D3D11DebugManager::DebugThread(uint32_t eventID, uint32_t group
 
   states.push_back((State)initialState);
 
-  for(int cycleCounter = 0;; cycleCounter++)
+  uint32_t numthreads[3] = {1, 1, 1};
+
+  for(size_t i = 0; i < dxbc->GetNumDeclarations(); i++)
   {
-    if(initialState.Finished())
-      break;
+    const ASMDecl &decl = dxbc->GetDeclaration(i);
 
-    initialState = initialState.GetNext(global, NULL);
+    if(decl.declaration == OPCODE_DCL_THREAD_GROUP)
+    {
+      numthreads[0] = decl.groupSize[0];
+      numthreads[1] = decl.groupSize[1];
+      numthreads[2] = decl.groupSize[2];
+    }
+  }
 
-    states.push_back((State)initialState);
+  // other threads can only affect this one if they write groupshared memory and there's a barrier
+  // to order those writes against this thread's reads. Anything else is a race, so the thread can
+  // be traced on its own.
+  bool groupsharedWrite = false;
+  bool threadSync = false;
 
-    if(cycleCounter == SHADER_DEBUG_WARN_THRESHOLD)
+  for(size_t i = 0; i < dxbc->GetNumInstructions(); i++)
+  {
+    const ASMOperation &op = dxbc->GetInstruction(i);
+
+    if(op.operation == OPCODE_SYNC && (op.syncFlags & SYNC_THREADS))
+      threadSync = true;
+
+    // stores and atomics are the only instructions with groupshared operands other than loads
+    if(op.operation == OPCODE_LD_RAW || op.operation == OPCODE_LD_STRUCTURED)
+      continue;
+
+    for(size_t o = 0; o < op.operands.size(); o++)
+      if(op.operands[o].type == TYPE_THREAD_GROUP_SHARED_MEMORY)
+        groupsharedWrite = true;
+  }
+
+  bool simulateGroup = groupsharedWrite && threadSync;
+
+  if(simulateGroup)
+  {
+    // the results depend on what other threads write to groupshared memory, so simulate the whole
+    // group in lockstep and record the requested thread.
+    vector<State> groupLanes;
+    groupLanes.reserve(numthreads[0] * numthreads[1] * numthreads[2]);
+
+    size_t destIdx = ~size_t(0);
+
+    for(uint32_t z = 0; z < numthreads[2]; z++)
     {
-      if(PromptDebugTimeout(DXBC::TYPE_VERTEX, cycleCounter))
+      for(uint32_t y = 0; y < numthreads[1]; y++)
+      {
+        for(uint32_t x = 0; x < numthreads[0]; x++)
+        {
+          if(x == threadid[0] && y == threadid[1] && z == threadid[2])
+            destIdx = groupLanes.size();
+
+          groupLanes.push_back(initialState);
+          groupLanes.back().semantics.ThreadID[0] = x;
+          groupLanes.back().semantics.ThreadID[1] = y;
+          groupLanes.back().semantics.ThreadID[2] = z;
+        }
+      }
+    }
+
+    if(destIdx == ~size_t(0))
+    {
+      RDCERR("Thread (%u, %u, %u) is outside the %ux%ux%u threadgroup", threadid[0], threadid[1],
+             threadid[2], numthreads[0], numthreads[1], numthreads[2]);
+      return empty;
+    }
+
+    LaneGroup lanes(dxbc, groupLanes, false);
+
+    uint64_t laneSteps = 0;
+
+    // nothing the other threads do after this one finishes can affect it
+    for(int cycleCounter = 0; !lanes.Finished(destIdx); cycleCounter++)
+    {
+      lanes.Step(global);
+
+      laneSteps += lanes.NumStepped();
+
+      if(lanes.Stepped(destIdx))
+        states.push_back((State)lanes.GetLane(destIdx));
+
+      if(laneSteps > SHADER_DEBUG_MAX_GROUP_STEPS)
+      {
+        RDCWARN(
+            "Simulating the %ux%ux%u threadgroup took over %u steps, tracing the thread on its own. "
+            "Groupshared memory won't contain other threads' writes.",
+            numthreads[0], numthreads[1], numthreads[2], SHADER_DEBUG_MAX_GROUP_STEPS);
+
+        // start again from scratch, the other threads may have written to UAVs
+        states.resize(1);
+        global = GlobalState();
+        CreateShaderGlobalState(global, dxbc, 0, rs->CSUAVs, rs->CS.SRVs);
+        simulateGroup = false;
         break;
+      }
+
+      if(cycleCounter == SHADER_DEBUG_WARN_THRESHOLD)
+      {
+        if(PromptDebugTimeout(DXBC::TYPE_COMPUTE, cycleCounter))
+          break;
+      }
+    }
+  }
+
+  if(!simulateGroup)
+  {
+    for(int cycleCounter = 0;; cycleCounter++)
+    {
+      if(initialState.Finished())
+        break;
+
+      initialState = initialState.GetNext(global, NULL);
+
+      states.push_back((State)initialState);
+
+      if(cycleCounter == SHADER_DEBUG_WARN_THRESHOLD)
+      {
+        if(PromptDebugTimeout(DXBC::TYPE_VERTEX, cycleCounter))
+          break;
+      }
     }
   }
 
@@ -24,13 +24,12 @@
  ******************************************************************************/
 
 #include "driver/d3d11/d3d11_device.h"
+#include "core/capture_thumbnail.h"
 #include "core/core.h"
 #include "driver/d3d11/d3d11_context.h"
 #include "driver/d3d11/d3d11_renderstate.h"
 #include "driver/d3d11/d3d11_resources.h"
 #include "driver/dxgi/dxgi_wrapped.h"
-#include "jpeg-compressor/jpge.h"
-#include "maths/formatpacking.h"
 #include "serialise/string_utils.h"
 
 const char *D3D11ChunkNames[] = {
@@ -2814,11 +2813,7 @@ bool WrappedID3D11Device::EndFrameCapture(void *dev, void *wnd)
       }
     }
 
-    const uint32_t maxSize = 2048;
-
-    byte *thpixels = NULL;
-    uint32_t thwidth = 0;
-    uint32_t thheight = 0;
+    CaptureThumbnail *thumb = NULL;
 
     if(swap != NULL)
     {
@@ -2885,8 +2880,6 @@ bool WrappedID3D11Device::EndFrameCapture(void *dev, void *wnd)
 
         if(tex)
         {
-          ResourceFormat fmt = MakeResourceFormat(desc.Format);
-
           D3D11_MAPPED_SUBRESOURCE mapped;
           hr = m_pImmediateContext->GetReal()->Map(stagingTex, 0, D3D11_MAP_READ, 0, &mapped);
 
@@ -2896,89 +2889,13 @@ bool WrappedID3D11Device::EndFrameCapture(void *dev, void *wnd)
           }
           else
           {
-            byte *data = (byte *)mapped.pData;
-
-            float aspect = float(desc.Width) / float(desc.Height);
-
-            thwidth = RDCMIN(maxSize, desc.Width);
-            thwidth &= ~0x7;    // align down to multiple of 8
-            thheight = uint32_t(float(thwidth) / aspect);
-
-            thpixels = new byte[3 * thwidth * thheight];
-
-            float widthf = float(desc.Width);
-            float heightf = float(desc.Height);
-
-            uint32_t stride = fmt.compByteWidth * fmt.compCount;
-
-            bool buf1010102 = false;
-            bool bufBGRA = (fmt.bgraOrder != false);
+            // only take a copy while the texture is mapped, converting and scaling it down
+            // happens on the capture writer thread
+            byte *pixels = new byte[mapped.RowPitch * desc.Height];
+            memcpy(pixels, mapped.pData, mapped.RowPitch * desc.Height);
 
-            if(fmt.special && fmt.specialFormat == SpecialFormat::R10G10B10A2)
-            {
-              stride = 4;
-              buf1010102 = true;
-            }
-
-            byte *dst = thpixels;
-
-            for(uint32_t y = 0; y < thheight; y++)
-            {
-              for(uint32_t x = 0; x < thwidth; x++)
-              {
-                float xf = float(x) / float(thwidth);
-                float yf = float(y) / float(thheight);
-
-                byte *src =
-                    &data[stride * uint32_t(xf * widthf) + mapped.RowPitch * uint32_t(yf * heightf)];
-
-                if(buf1010102)
-                {
-                  uint32_t *src1010102 = (uint32_t *)src;
-                  Vec4f unorm = ConvertFromR10G10B10A2(*src1010102);
-                  dst[0] = (byte)(unorm.x * 255.0f);
-                  dst[1] = (byte)(unorm.y * 255.0f);
-                  dst[2] = (byte)(unorm.z * 255.0f);
-                }
-                else if(bufBGRA)
-                {
-                  dst[0] = src[2];
-                  dst[1] = src[1];
-                  dst[2] = src[0];
-                }
-                else if(fmt.compByteWidth == 2)    // R16G16B16A16 backbuffer
-                {
-                  uint16_t *src16 = (uint16_t *)src;
-
-                  float linearR = RDCCLAMP(ConvertFromHalf(src16[0]), 0.0f, 1.0f);
-                  float linearG = RDCCLAMP(ConvertFromHalf(src16[1]), 0.0f, 1.0f);
-                  float linearB = RDCCLAMP(ConvertFromHalf(src16[2]), 0.0f, 1.0f);
-
-                  if(linearR < 0.0031308f)
-                    dst[0] = byte(255.0f * (12.92f * linearR));
-                  else
-                    dst[0] = byte(255.0f * (1.055f * powf(linearR, 1.0f / 2.4f) - 0.055f));
-
-                  if(linearG < 0.0031308f)
-                    dst[1] = byte(255.0f * (12.92f * linearG));
-                  else
-                    dst[1] = byte(255.0f * (1.055f * powf(linearG, 1.0f / 2.4f) - 0.055f));
-
-                  if(linearB < 0.0031308f)
-                    dst[2] = byte(255.0f * (12.92f * linearB));
-                  else
-                    dst[2] = byte(255.0f * (1.055f * powf(linearB, 1.0f / 2.4f) - 0.055f));
-                }
-                else
-                {
-                  dst[0] = src[0];
-                  dst[1] = src[1];
-                  dst[2] = src[2];
-                }
-
-                dst += 3;
-              }
-            }
+            thumb = new CaptureThumbnailPixels(pixels, desc.Width, desc.Height, mapped.RowPitch,
+                                               MakeResourceFormat(desc.Format));
 
             m_pImmediateContext->GetReal()->Unmap(stagingTex, 0);
           }
@@ -2988,33 +2905,8 @@ bool WrappedID3D11Device::EndFrameCapture(void *dev, void *wnd)
       }
     }
 
-    byte *jpgbuf = NULL;
-    int len = thwidth * thheight;
-
-    if(wnd)
-    {
-      jpgbuf = new byte[len];
-
-      jpge::params p;
-      p.m_quality = 80;
-
-      bool success = jpge::compress_image_to_jpeg_file_in_memory(jpgbuf, len, thwidth, thheight, 3,
-                                                                 thpixels, p);
-
-      if(!success)
-      {
-        RDCERR("Failed to compress to jpg");
-        SAFE_DELETE_ARRAY(jpgbuf);
-        thwidth = 0;
-        thheight = 0;
-      }
-    }
-
-    Serialiser *m_pFileSerialiser = RenderDoc::Inst().OpenWriteSerialiser(
-        m_FrameCounter, &m_InitParams, jpgbuf, len, thwidth, thheight);
-
-    SAFE_DELETE_ARRAY(jpgbuf);
-    SAFE_DELETE(thpixels);
+    Serialiser *m_pFileSerialiser =
+        RenderDoc::Inst().OpenWriteSerialiser(m_FrameCounter, &m_InitParams, thumb);
 
     {
       SCOPED_SERIALISE_CONTEXT(DEVICE_INIT);
@@ -3061,14 +2953,11 @@ bool WrappedID3D11Device::EndFrameCapture(void *dev, void *wnd)
       RDCDEBUG("Done");
     }
 
-    m_pFileSerialiser->FlushToDisk();
+    RenderDoc::Inst().FinishWriteSerialiser(m_pFileSerialiser, m_FrameCounter);
+    m_pFileSerialiser = NULL;
 
     UnlockForChunkFlushing();
 
-    SAFE_DELETE(m_pFileSerialiser);
-
-    RenderDoc::Inst().SuccessfullyWrittenLog(m_FrameCounter);
-
     m_State = WRITING_IDLE;
 
     m_pImmediateContext->CleanupCapture();
@@ -3089,6 +2978,8 @@ bool WrappedID3D11Device::EndFrameCapture(void *dev, void *wnd)
 
     GetResourceManager()->ClearReferencedResources();
 
+    GetResourceManager()->DetachRecordChunksFromArena();
+
     return true;
   }
   else
@@ -3142,6 +3033,8 @@ bool WrappedID3D11Device::EndFrameCapture(void *dev, void *wnd)
 
     GetResourceManager()->ClearReferencedResources();
 
+    GetResourceManager()->DetachRecordChunksFromArena();
+
     // if it's a capture triggered from application code, immediately
     // give up as it's not reasonable to expect applications to detect and retry.
     // otherwise we can retry in case the next frame works.
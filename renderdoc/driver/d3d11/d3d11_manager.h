@@ -131,6 +131,30 @@ struct D3D11ResourceRecord : public ResourceRecord
       SubResources[i]->SetDataPtr(ptr);
   }
 
+  void DetachChunksFromArena(std::map<byte *, byte *> &moved)
+  {
+    ResourceRecord::DetachChunksFromArena(moved);
+
+    for(int i = 0; i < NumSubResources; i++)
+      SubResources[i]->DetachChunksFromArena(moved);
+  }
+
+  void RemapDataPtr(const std::map<byte *, byte *> &moved)
+  {
+    ResourceRecord::RemapDataPtr(moved);
+
+    for(int i = 0; i < NumSubResources; i++)
+      SubResources[i]->RemapDataPtr(moved);
+  }
+
+  void AddDataPointers(std::set<byte *> &ptrs)
+  {
+    ResourceRecord::AddDataPointers(ptrs);
+
+    for(int i = 0; i < NumSubResources; i++)
+      SubResources[i]->AddDataPointers(ptrs);
+  }
+
   void Insert(map<int32_t, Chunk *> &recordlist)
   {
     bool dataWritten = DataWritten;
@@ -1547,8 +1547,13 @@ ShaderDebugTrace D3D11Replay::DebugThread(uint32_t eventID, uint32_t groupid[3],
   return m_pDevice->GetDebugManager()->DebugThread(eventID, groupid, threadid);
 }
 
-uint32_t D3D11Replay::PickVertex(uint32_t eventID, const MeshDisplay &cfg, uint32_t x, uint32_t y)
+uint32_t D3D11Replay::PickVertex(uint32_t eventID, const MeshDisplay &cfg, uint32_t x, uint32_t y,
+                                 uint32_t *primitive)
 {
+  // picking on the GPU only finds the closest vertex, not the triangle
+  if(primitive)
+    *primitive = ~0U;
+
   return m_pDevice->GetDebugManager()->PickVertex(eventID, cfg, x, y);
 }
 
@@ -539,25 +539,34 @@ void STDMETHODCALLTYPE WrappedID3D12CommandQueue::ExecuteCommandLists(
           continue;
         }
 
-        size_t diffStart = 0, diffEnd = 0;
+        vector<DiffRange> ranges;
         bool found = true;
 
         byte *ref = res->GetShadow(subres);
         byte *data = res->GetMap(subres);
 
         if(ref)
-          found = FindDiffRange(data, ref, size, diffStart, diffEnd);
+        {
+          found = FindDiffRanges(data, ref, size, ranges);
+        }
         else
-          diffEnd = size;
+        {
+          DiffRange whole = {0, size};
+          ranges.push_back(whole);
+        }
 
         if(found)
         {
-          RDCLOG("Persistent map flush forced for %llu (%llu -> %llu)", res->GetResourceID(),
-                 (uint64_t)diffStart, (uint64_t)diffEnd);
+          RDCLOG("Persistent map flush forced for %llu (%llu -> %llu in %u ranges)",
+                 res->GetResourceID(), (uint64_t)ranges.front().start,
+                 (uint64_t)ranges.back().end, (uint32_t)ranges.size());
 
-          D3D12_RANGE range = {diffStart, diffEnd};
+          for(size_t r = 0; r < ranges.size(); r++)
+          {
+            D3D12_RANGE range = {ranges[r].start, ranges[r].end};
 
-          m_pDevice->MapDataWrite(res, subres, data, range);
+            m_pDevice->MapDataWrite(res, subres, data, range);
+          }
 
           if(ref == NULL)
           {
@@ -255,13 +255,21 @@ void WrappedID3D12CommandQueue::ClearAfterCapture()
 
 APIEvent WrappedID3D12CommandQueue::GetEvent(uint32_t eventID)
 {
-  for(size_t i = m_Cmd.m_Events.size() - 1; i > 0; i--)
+  // m_Events is sorted by eventID once the log has been read, so binary search for the last
+  // event at or before eventID
+  size_t lo = 1, hi = m_Cmd.m_Events.size();
+
+  while(lo < hi)
   {
-    if(m_Cmd.m_Events[i].eventID <= eventID)
-      return m_Cmd.m_Events[i];
+    size_t mid = lo + (hi - lo) / 2;
+
+    if(m_Cmd.m_Events[mid].eventID <= eventID)
+      lo = mid + 1;
+    else
+      hi = mid;
   }
 
-  return m_Cmd.m_Events[0];
+  return m_Cmd.m_Events[lo - 1];
 }
 
 void WrappedID3D12CommandQueue::ProcessChunk(uint64_t offset, D3D12ChunkType chunk)
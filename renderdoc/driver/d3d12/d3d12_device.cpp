@@ -23,11 +23,10 @@
  ******************************************************************************/
 
 #include "d3d12_device.h"
+#include "core/capture_thumbnail.h"
 #include "core/core.h"
 #include "driver/dxgi/dxgi_common.h"
 #include "driver/dxgi/dxgi_wrapped.h"
-#include "jpeg-compressor/jpge.h"
-#include "maths/formatpacking.h"
 #include "serialise/string_utils.h"
 #include "d3d12_command_list.h"
 #include "d3d12_command_queue.h"
@@ -1338,6 +1337,60 @@ void WrappedID3D12Device::StartFrameCapture(void *dev, void *wnd)
   RDCLOG("Starting capture, frame %u", m_FrameCounter);
 }
 
+// the backbuffer copied into a readback buffer at the end of a capture. The copy is left in flight
+// and only waited for when the capture writer thread encodes the thumbnail.
+class D3D12Thumbnail : public CaptureThumbnail
+{
+public:
+  D3D12Thumbnail(ID3D12Resource *readback, ID3D12Fence *fence)
+      : m_Readback(readback), m_Fence(fence), m_Data(NULL)
+  {
+  }
+
+  ~D3D12Thumbnail()
+  {
+    // the copy has to be finished before the buffer can be released, even if it was never read
+    WaitForCopy();
+
+    if(m_Data)
+      m_Readback->Unmap(0, NULL);
+
+    SAFE_RELEASE(m_Readback);
+    SAFE_RELEASE(m_Fence);
+  }
+
+  const byte *GetPixels()
+  {
+    if(m_Data == NULL)
+    {
+      WaitForCopy();
+
+      HRESULT hr = m_Readback->Map(0, NULL, (void **)&m_Data);
+
+      if(FAILED(hr) || m_Data == NULL)
+      {
+        RDCERR("Couldn't map readback buffer: 0x%08x", hr);
+        m_Data = NULL;
+        return NULL;
+      }
+    }
+
+    return m_Data;
+  }
+
+private:
+  void WaitForCopy()
+  {
+    // with no event, this blocks until the fence is signalled
+    if(m_Fence && m_Fence->GetCompletedValue() < 1)
+      m_Fence->SetEventOnCompletion(1, NULL);
+  }
+
+  ID3D12Resource *m_Readback;
+  ID3D12Fence *m_Fence;
+  byte *m_Data;
+};
+
 bool WrappedID3D12Device::EndFrameCapture(void *dev, void *wnd)
 {
   if(m_State != WRITING_CAPFRAME)
@@ -1398,14 +1451,11 @@ bool WrappedID3D12Device::EndFrameCapture(void *dev, void *wnd)
         it->res->FreeShadow();
     }
 
-    byte *thpixels = NULL;
-    uint32_t thwidth = 0;
-    uint32_t thheight = 0;
-
-    const uint32_t maxSize = 2048;
+    D3D12Thumbnail *thumb = NULL;
 
-    // gather backbuffer screenshot
-    if(backbuffer != NULL)
+    // gather backbuffer screenshot. Captures that weren't for a particular window don't get a
+    // thumbnail, even though the last swapchain is still used to end the frame
+    if(wnd && backbuffer != NULL)
     {
       D3D12_HEAP_PROPERTIES heapProps;
       heapProps.Type = D3D12_HEAP_TYPE_READBACK;
@@ -1475,105 +1525,31 @@ bool WrappedID3D12Device::EndFrameCapture(void *dev, void *wnd)
         list->Close();
 
         ExecuteLists();
-        FlushLists();
 
-        byte *data = NULL;
-        hr = copyDst->Map(0, NULL, (void **)&data);
+        // rather than waiting for the copy here, signal a fence once it's done and let the capture
+        // writer thread wait for it before downscaling and compressing the image
+        ID3D12Fence *fence = NULL;
+        hr = m_pDevice->CreateFence(0, D3D12_FENCE_FLAG_NONE, __uuidof(ID3D12Fence),
+                                    (void **)&fence);
 
-        if(SUCCEEDED(hr) && data)
+        // the fence is never wrapped, so it's signalled on the real queue
+        if(SUCCEEDED(hr))
         {
-          ResourceFormat fmt = MakeResourceFormat(desc.Format);
-
-          float aspect = float(desc.Width) / float(desc.Height);
-
-          thwidth = RDCMIN(maxSize, (uint32_t)desc.Width);
-          thwidth &= ~0x7;    // align down to multiple of 8
-          thheight = uint32_t(float(thwidth) / aspect);
-
-          thpixels = new byte[3 * thwidth * thheight];
-
-          float widthf = float(desc.Width);
-          float heightf = float(desc.Height);
-
-          uint32_t stride = fmt.compByteWidth * fmt.compCount;
-
-          bool buf1010102 = false;
-          bool bufBGRA = (fmt.bgraOrder != false);
-
-          if(fmt.special && fmt.specialFormat == SpecialFormat::R10G10B10A2)
-          {
-            stride = 4;
-            buf1010102 = true;
-          }
-
-          byte *dstPixels = thpixels;
-
-          for(uint32_t y = 0; y < thheight; y++)
-          {
-            for(uint32_t x = 0; x < thwidth; x++)
-            {
-              float xf = float(x) / float(thwidth);
-              float yf = float(y) / float(thheight);
-
-              byte *srcPixels = &data[stride * uint32_t(xf * widthf) +
-                                      layout.Footprint.RowPitch * uint32_t(yf * heightf)];
-
-              if(buf1010102)
-              {
-                uint32_t *src1010102 = (uint32_t *)srcPixels;
-                Vec4f unorm = ConvertFromR10G10B10A2(*src1010102);
-                dstPixels[0] = (byte)(unorm.x * 255.0f);
-                dstPixels[1] = (byte)(unorm.y * 255.0f);
-                dstPixels[2] = (byte)(unorm.z * 255.0f);
-              }
-              else if(bufBGRA)
-              {
-                dstPixels[0] = srcPixels[2];
-                dstPixels[1] = srcPixels[1];
-                dstPixels[2] = srcPixels[0];
-              }
-              else if(fmt.compByteWidth == 2)    // R16G16B16A16 backbuffer
-              {
-                uint16_t *src16 = (uint16_t *)srcPixels;
-
-                float linearR = RDCCLAMP(ConvertFromHalf(src16[0]), 0.0f, 1.0f);
-                float linearG = RDCCLAMP(ConvertFromHalf(src16[1]), 0.0f, 1.0f);
-                float linearB = RDCCLAMP(ConvertFromHalf(src16[2]), 0.0f, 1.0f);
-
-                if(linearR < 0.0031308f)
-                  dstPixels[0] = byte(255.0f * (12.92f * linearR));
-                else
-                  dstPixels[0] = byte(255.0f * (1.055f * powf(linearR, 1.0f / 2.4f) - 0.055f));
-
-                if(linearG < 0.0031308f)
-                  dstPixels[1] = byte(255.0f * (12.92f * linearG));
-                else
-                  dstPixels[1] = byte(255.0f * (1.055f * powf(linearG, 1.0f / 2.4f) - 0.055f));
-
-                if(linearB < 0.0031308f)
-                  dstPixels[2] = byte(255.0f * (12.92f * linearB));
-                else
-                  dstPixels[2] = byte(255.0f * (1.055f * powf(linearB, 1.0f / 2.4f) - 0.055f));
-              }
-              else
-              {
-                dstPixels[0] = srcPixels[0];
-                dstPixels[1] = srcPixels[1];
-                dstPixels[2] = srcPixels[2];
-              }
-
-              dstPixels += 3;
-            }
-          }
-
-          copyDst->Unmap(0, NULL);
+          GetQueue()->GetReal()->Signal(fence, 1);
         }
         else
         {
-          RDCERR("Couldn't map readback buffer: 0x%08x", hr);
+          RDCERR("Couldn't create thumbnail readback fence: 0x%08x", hr);
+          fence = NULL;
+          FlushLists();
         }
 
-        SAFE_RELEASE(copyDst);
+        // the thumbnail takes ownership of the readback buffer and fence
+        thumb = new D3D12Thumbnail(copyDst, fence);
+        thumb->width = (uint32_t)desc.Width;
+        thumb->height = desc.Height;
+        thumb->rowPitch = layout.Footprint.RowPitch;
+        thumb->format = MakeResourceFormat(desc.Format);
       }
       else
       {
@@ -1581,30 +1557,8 @@ bool WrappedID3D12Device::EndFrameCapture(void *dev, void *wnd)
       }
     }
 
-    byte *jpgbuf = NULL;
-    int len = thwidth * thheight;
-
-    if(wnd && thpixels)
-    {
-      jpgbuf = new byte[len];
-
-      jpge::params p;
-      p.m_quality = 80;
-
-      bool success = jpge::compress_image_to_jpeg_file_in_memory(jpgbuf, len, thwidth, thheight, 3,
-                                                                 thpixels, p);
-
-      if(!success)
-      {
-        RDCERR("Failed to compress to jpg");
-        SAFE_DELETE_ARRAY(jpgbuf);
-        thwidth = 0;
-        thheight = 0;
-      }
-    }
-
-    m_pFileSerialiser = RenderDoc::Inst().OpenWriteSerialiser(m_FrameCounter, &m_InitParams, jpgbuf,
-                                                              len, thwidth, thheight);
+    m_pFileSerialiser =
+        RenderDoc::Inst().OpenWriteSerialiser(m_FrameCounter, &m_InitParams, thumb);
 
     queues = m_Queues;
 
@@ -1683,11 +1637,8 @@ bool WrappedID3D12Device::EndFrameCapture(void *dev, void *wnd)
     RDCDEBUG("Done");
   }
 
-  m_pFileSerialiser->FlushToDisk();
-
-  RenderDoc::Inst().SuccessfullyWrittenLog(m_FrameCounter);
-
-  SAFE_DELETE(m_pFileSerialiser);
+  RenderDoc::Inst().FinishWriteSerialiser(m_pFileSerialiser, m_FrameCounter);
+  m_pFileSerialiser = NULL;
   SAFE_DELETE(m_HeaderChunk);
 
   m_State = WRITING_IDLE;
@@ -1699,6 +1650,8 @@ bool WrappedID3D12Device::EndFrameCapture(void *dev, void *wnd)
 
   GetResourceManager()->ClearReferencedResources();
 
+  GetResourceManager()->DetachRecordChunksFromArena();
+
   GetResourceManager()->FreeInitialContents();
 
   GetResourceManager()->FlushPendingDirty();
@@ -1469,8 +1469,13 @@ MeshFormat D3D12Replay::GetPostVSBuffers(uint32_t eventID, uint32_t instID, Mesh
   return m_pDevice->GetDebugManager()->GetPostVSBuffers(eventID, instID, stage);
 }
 
-uint32_t D3D12Replay::PickVertex(uint32_t eventID, const MeshDisplay &cfg, uint32_t x, uint32_t y)
+uint32_t D3D12Replay::PickVertex(uint32_t eventID, const MeshDisplay &cfg, uint32_t x, uint32_t y,
+                                 uint32_t *primitive)
 {
+  // picking on the GPU only finds the closest vertex, not the triangle
+  if(primitive)
+    *primitive = ~0U;
+
   return m_pDevice->GetDebugManager()->PickVertex(eventID, cfg, x, y);
 }
 
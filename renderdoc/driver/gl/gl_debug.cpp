@@ -30,6 +30,7 @@
 #include "maths/camera.h"
 #include "maths/formatpacking.h"
 #include "maths/matrix.h"
+#include "replay/texture_stats.h"
 #include "serialise/string_utils.h"
 #include "gl_driver.h"
 #include "gl_replay.h"
@@ -246,6 +247,7 @@ void GLReplay::InitDebugData()
     return;
 
   m_HighlightCache.driver = m_pDriver->GetReplay();
+  m_MeshPickCache.driver = m_pDriver->GetReplay();
 
   RenderDoc::Inst().SetProgress(DebugManagerInit, 0.0f);
 
@@ -559,40 +561,8 @@ void GLReplay::InitDebugData()
                                "GL_ARB_compute_shader not supported, disabling 2DMS save/load.");
   }
 
-  if(glesShadersAreComplete && HasExt[ARB_compute_shader])
-  {
-    string defines =
-        "#extension GL_ARB_compute_shader : require\n"
-        "#extension GL_ARB_shader_storage_buffer_object : require";
-    GenerateGLSLShader(cs, shaderType, defines, GetEmbeddedResource(glsl_mesh_comp), glslCSVer);
-    DebugData.meshPickProgram = CreateCShaderProgram(cs);
-  }
-  else
-  {
-    DebugData.meshPickProgram = 0;
-    RDCWARN("GL_ARB_compute_shader not supported, disabling mesh picking.");
-    m_pDriver->AddDebugMessage(MessageCategory::Portability, MessageSeverity::Medium,
-                               MessageSource::RuntimeWarning,
-                               "GL_ARB_compute_shader not supported, disabling mesh picking.");
-  }
-
   RenderDoc::Inst().SetProgress(DebugManagerInit, 0.8f);
 
-  DebugData.pickResultBuf = 0;
-
-  if(DebugData.meshPickProgram)
-  {
-    gl.glGenBuffers(1, &DebugData.pickResultBuf);
-    gl.glBindBuffer(eGL_SHADER_STORAGE_BUFFER, DebugData.pickResultBuf);
-    gl.glNamedBufferDataEXT(DebugData.pickResultBuf,
-                            sizeof(Vec4f) * DebugRenderData::maxMeshPicks + sizeof(uint32_t) * 4,
-                            NULL, eGL_DYNAMIC_READ);
-
-    // sized/created on demand
-    DebugData.pickVBBuf = DebugData.pickIBBuf = 0;
-    DebugData.pickVBSize = DebugData.pickIBSize = 0;
-  }
-
   gl.glGenVertexArrays(1, &DebugData.meshVAO);
   gl.glBindVertexArray(DebugData.meshVAO);
 
@@ -776,11 +746,6 @@ void GLReplay::DeleteDebugData()
     }
   }
 
-  gl.glDeleteProgram(DebugData.meshPickProgram);
-  gl.glDeleteBuffers(1, &DebugData.pickIBBuf);
-  gl.glDeleteBuffers(1, &DebugData.pickVBBuf);
-  gl.glDeleteBuffers(1, &DebugData.pickResultBuf);
-
   gl.glDeleteProgram(DebugData.Array2MS);
   gl.glDeleteProgram(DebugData.MS2Array);
 
@@ -805,8 +770,9 @@ bool GLReplay::GetMinMax(ResourceId texid, uint32_t sliceFace, uint32_t mip, uin
   if(texid == ResourceId() || m_pDriver->m_Textures.find(texid) == m_pDriver->m_Textures.end())
     return false;
 
+  // without compute shaders, calculate it on the CPU instead
   if(!HasExt[ARB_compute_shader])
-    return false;
+    return GetSoftwareMinMax(this, texid, sliceFace, mip, sample, typeHint, minval, maxval);
 
   auto &texDetails = m_pDriver->m_Textures[texid];
 
@@ -980,7 +946,8 @@ bool GLReplay::GetHistogram(ResourceId texid, uint32_t sliceFace, uint32_t mip,
     return false;
 
   if(!HasExt[ARB_compute_shader])
-    return false;
+    return GetSoftwareHistogram(this, texid, sliceFace, mip, sample, typeHint, minval, maxval,
+                                channels, histogram);
 
   auto &texDetails = m_pDriver->m_Textures[texid];
 
@@ -1151,366 +1118,13 @@ bool GLReplay::GetHistogram(ResourceId texid, uint32_t sliceFace, uint32_t mip,
   return true;
 }
 
-uint32_t GLReplay::PickVertex(uint32_t eventID, const MeshDisplay &cfg, uint32_t x, uint32_t y)
+uint32_t GLReplay::PickVertex(uint32_t eventID, const MeshDisplay &cfg, uint32_t x, uint32_t y,
+                              uint32_t *primitive)
 {
-  WrappedOpenGL &gl = *m_pDriver;
-
-  if(!HasExt[ARB_compute_shader])
-    return ~0U;
-
   MakeCurrentReplayContext(m_DebugCtx);
 
-  gl.glUseProgram(DebugData.meshPickProgram);
-
-  Matrix4f projMat =
-      Matrix4f::Perspective(90.0f, 0.1f, 100000.0f, DebugData.outWidth / DebugData.outHeight);
-
-  Matrix4f camMat = cfg.cam ? cfg.cam->GetMatrix() : Matrix4f::Identity();
-  Matrix4f pickMVP = projMat.Mul(camMat);
-
-  ResourceFormat resFmt;
-  resFmt.compByteWidth = cfg.position.compByteWidth;
-  resFmt.compCount = cfg.position.compCount;
-  resFmt.compType = cfg.position.compType;
-  resFmt.special = false;
-  if(cfg.position.specialFormat != SpecialFormat::Unknown)
-  {
-    resFmt.special = true;
-    resFmt.specialFormat = cfg.position.specialFormat;
-  }
-
-  Matrix4f pickMVPProj;
-  if(cfg.position.unproject)
-  {
-    // the derivation of the projection matrix might not be right (hell, it could be an
-    // orthographic projection). But it'll be close enough likely.
-    Matrix4f guessProj =
-        cfg.position.farPlane != FLT_MAX
-            ? Matrix4f::Perspective(cfg.fov, cfg.position.nearPlane, cfg.position.farPlane, cfg.aspect)
-            : Matrix4f::ReversePerspective(cfg.fov, cfg.position.nearPlane, cfg.aspect);
-
-    if(cfg.ortho)
-      guessProj = Matrix4f::Orthographic(cfg.position.nearPlane, cfg.position.farPlane);
-
-    pickMVPProj = projMat.Mul(camMat.Mul(guessProj.Inverse()));
-    ;
-  }
-
-  vec3 rayPos;
-  vec3 rayDir;
-  // convert mouse pos to world space ray
-  {
-    Matrix4f inversePickMVP = pickMVP.Inverse();
-
-    float pickX = ((float)x) / ((float)DebugData.outWidth);
-    float pickXCanonical = RDCLERP(-1.0f, 1.0f, pickX);
-
-    float pickY = ((float)y) / ((float)DebugData.outHeight);
-    // flip the Y axis
-    float pickYCanonical = RDCLERP(1.0f, -1.0f, pickY);
-
-    vec3 cameraToWorldNearPosition =
-        inversePickMVP.Transform(Vec3f(pickXCanonical, pickYCanonical, -1), 1);
-
-    vec3 cameraToWorldFarPosition =
-        inversePickMVP.Transform(Vec3f(pickXCanonical, pickYCanonical, 1), 1);
-
-    vec3 testDir = (cameraToWorldFarPosition - cameraToWorldNearPosition);
-    testDir.Normalise();
-
-    /* Calculate the ray direction first in the regular way (above), so we can use the
-       the output for testing if the ray we are picking is negative or not. This is similar
-       to checking against the forward direction of the camera, but more robust
-    */
-    if(cfg.position.unproject)
-    {
-      Matrix4f inversePickMVPGuess = pickMVPProj.Inverse();
-
-      vec3 nearPosProj = inversePickMVPGuess.Transform(Vec3f(pickXCanonical, pickYCanonical, -1), 1);
-
-      vec3 farPosProj = inversePickMVPGuess.Transform(Vec3f(pickXCanonical, pickYCanonical, 1), 1);
-
-      rayDir = (farPosProj - nearPosProj);
-      rayDir.Normalise();
-
-      if(testDir.z < 0)
-      {
-        rayDir = -rayDir;
-      }
-      rayPos = nearPosProj;
-    }
-    else
-    {
-      rayDir = testDir;
-      rayPos = cameraToWorldNearPosition;
-    }
-  }
-
-  gl.glBindBufferBase(eGL_UNIFORM_BUFFER, 0, DebugData.UBOs[0]);
-  MeshPickUBOData *cdata =
-      (MeshPickUBOData *)gl.glMapBufferRange(eGL_UNIFORM_BUFFER, 0, sizeof(MeshPickUBOData),
-                                             GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
-
-  cdata->rayPos = rayPos;
-  cdata->rayDir = rayDir;
-  cdata->use_indices = cfg.position.idxByteWidth ? 1U : 0U;
-  cdata->numVerts = cfg.position.numVerts;
-  bool isTriangleMesh = true;
-  switch(cfg.position.topo)
-  {
-    case Topology::TriangleList:
-    {
-      cdata->meshMode = MESH_TRIANGLE_LIST;
-      break;
-    };
-    case Topology::TriangleStrip:
-    {
-      cdata->meshMode = MESH_TRIANGLE_STRIP;
-      break;
-    };
-    case Topology::TriangleFan:
-    {
-      cdata->meshMode = MESH_TRIANGLE_FAN;
-      break;
-    };
-    case Topology::TriangleList_Adj:
-    {
-      cdata->meshMode = MESH_TRIANGLE_LIST_ADJ;
-      break;
-    };
-    case Topology::TriangleStrip_Adj:
-    {
-      cdata->meshMode = MESH_TRIANGLE_STRIP_ADJ;
-      break;
-    };
-    default:    // points, lines, patchlists, unknown
-    {
-      cdata->meshMode = MESH_OTHER;
-      isTriangleMesh = false;
-    };
-  }
-
-  // line/point data
-  cdata->unproject = cfg.position.unproject;
-  cdata->mvp = cfg.position.unproject ? pickMVPProj : pickMVP;
-  cdata->coords = Vec2f((float)x, (float)y);
-  cdata->viewport = Vec2f(DebugData.outWidth, DebugData.outHeight);
-
-  gl.glUnmapBuffer(eGL_UNIFORM_BUFFER);
-
-  GLuint ib = 0;
-
-  if(cfg.position.idxByteWidth && cfg.position.idxbuf != ResourceId())
-    ib = m_pDriver->GetResourceManager()->GetCurrentResource(cfg.position.idxbuf).name;
-
-  // We copy into our own buffers to promote to the target type (uint32) that the
-  // shader expects. Most IBs will be 16-bit indices, most VBs will not be float4.
-
-  if(ib)
-  {
-    // resize up on demand
-    if(DebugData.pickIBBuf == 0 || DebugData.pickIBSize < cfg.position.numVerts * sizeof(uint32_t))
-    {
-      gl.glDeleteBuffers(1, &DebugData.pickIBBuf);
-
-      gl.glGenBuffers(1, &DebugData.pickIBBuf);
-      gl.glBindBuffer(eGL_SHADER_STORAGE_BUFFER, DebugData.pickIBBuf);
-      gl.glNamedBufferDataEXT(DebugData.pickIBBuf, cfg.position.numVerts * sizeof(uint32_t), NULL,
-                              eGL_STREAM_DRAW);
-
-      DebugData.pickIBSize = cfg.position.numVerts * sizeof(uint32_t);
-    }
-
-    byte *idxs = new byte[cfg.position.numVerts * cfg.position.idxByteWidth];
-    memset(idxs, 0, cfg.position.numVerts * cfg.position.idxByteWidth);
-    uint32_t *outidxs = NULL;
-
-    if(cfg.position.idxByteWidth < 4)
-      outidxs = new uint32_t[cfg.position.numVerts];
-
-    gl.glBindBuffer(eGL_COPY_READ_BUFFER, ib);
-
-    GLint bufsize = 0;
-    gl.glGetBufferParameteriv(eGL_COPY_READ_BUFFER, eGL_BUFFER_SIZE, &bufsize);
-
-    gl.glGetBufferSubData(eGL_COPY_READ_BUFFER, (GLintptr)cfg.position.idxoffs,
-                          RDCMIN(uint32_t(bufsize) - uint32_t(cfg.position.idxoffs),
-                                 cfg.position.numVerts * cfg.position.idxByteWidth),
-                          idxs);
-
-    uint16_t *idxs16 = (uint16_t *)idxs;
-
-    if(cfg.position.idxByteWidth == 1)
-    {
-      for(uint32_t i = 0; i < cfg.position.numVerts; i++)
-        outidxs[i] = idxs[i];
-
-      gl.glBindBuffer(eGL_SHADER_STORAGE_BUFFER, DebugData.pickIBBuf);
-      gl.glBufferSubData(eGL_SHADER_STORAGE_BUFFER, 0, cfg.position.numVerts * sizeof(uint32_t),
-                         outidxs);
-    }
-    else if(cfg.position.idxByteWidth == 2)
-    {
-      for(uint32_t i = 0; i < cfg.position.numVerts; i++)
-        outidxs[i] = idxs16[i];
-
-      gl.glBindBuffer(eGL_SHADER_STORAGE_BUFFER, DebugData.pickIBBuf);
-      gl.glBufferSubData(eGL_SHADER_STORAGE_BUFFER, 0, cfg.position.numVerts * sizeof(uint32_t),
-                         outidxs);
-    }
-    else
-    {
-      gl.glBindBuffer(eGL_SHADER_STORAGE_BUFFER, DebugData.pickIBBuf);
-      gl.glBufferSubData(eGL_SHADER_STORAGE_BUFFER, 0, cfg.position.numVerts * sizeof(uint32_t),
-                         idxs);
-    }
-
-    SAFE_DELETE_ARRAY(outidxs);
-  }
-
-  if(DebugData.pickVBBuf == 0 || DebugData.pickVBSize < cfg.position.numVerts * sizeof(Vec4f))
-  {
-    gl.glDeleteBuffers(1, &DebugData.pickVBBuf);
-
-    gl.glGenBuffers(1, &DebugData.pickVBBuf);
-    gl.glBindBuffer(eGL_SHADER_STORAGE_BUFFER, DebugData.pickVBBuf);
-    gl.glNamedBufferDataEXT(DebugData.pickVBBuf, cfg.position.numVerts * sizeof(Vec4f), NULL,
-                            eGL_DYNAMIC_DRAW);
-
-    DebugData.pickVBSize = cfg.position.numVerts * sizeof(Vec4f);
-  }
-
-  // unpack and linearise the data
-  {
-    FloatVector *vbData = new FloatVector[cfg.position.numVerts];
-
-    vector<byte> oldData;
-    GetBufferData(cfg.position.buf, cfg.position.offset, 0, oldData);
-
-    byte *data = &oldData[0];
-    byte *dataEnd = data + oldData.size();
-
-    bool valid;
-
-    uint32_t idxclamp = 0;
-    if(cfg.position.baseVertex < 0)
-      idxclamp = uint32_t(-cfg.position.baseVertex);
-
-    for(uint32_t i = 0; i < cfg.position.numVerts; i++)
-    {
-      uint32_t idx = i;
-
-      // apply baseVertex but clamp to 0 (don't allow index to become negative)
-      if(idx < idxclamp)
-        idx = 0;
-      else if(cfg.position.baseVertex < 0)
-        idx -= idxclamp;
-      else if(cfg.position.baseVertex > 0)
-        idx += cfg.position.baseVertex;
-
-      vbData[i] = HighlightCache::InterpretVertex(data, idx, cfg, dataEnd, valid);
-    }
-
-    gl.glBindBuffer(eGL_SHADER_STORAGE_BUFFER, DebugData.pickVBBuf);
-    gl.glBufferSubData(eGL_SHADER_STORAGE_BUFFER, 0, cfg.position.numVerts * sizeof(Vec4f), vbData);
-
-    delete[] vbData;
-  }
-
-  uint32_t reset[4] = {};
-  gl.glBindBufferBase(eGL_SHADER_STORAGE_BUFFER, 0, DebugData.pickResultBuf);
-  gl.glBufferSubData(eGL_SHADER_STORAGE_BUFFER, 0, sizeof(uint32_t) * 4, &reset);
-
-  gl.glBindBufferBase(eGL_SHADER_STORAGE_BUFFER, 1, DebugData.pickVBBuf);
-  gl.glBindBufferRange(
-      eGL_SHADER_STORAGE_BUFFER, 2, DebugData.pickIBBuf, (GLintptr)cfg.position.idxoffs,
-      (GLsizeiptr)(cfg.position.idxoffs + sizeof(uint32_t) * cfg.position.numVerts));
-  gl.glBindBufferBase(eGL_SHADER_STORAGE_BUFFER, 3, DebugData.pickResultBuf);
-
-  gl.glDispatchCompute(GLuint((cfg.position.numVerts) / 128 + 1), 1, 1);
-  gl.glMemoryBarrier(GL_ATOMIC_COUNTER_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
-
-  uint32_t numResults = 0;
-
-  gl.glBindBuffer(eGL_COPY_READ_BUFFER, DebugData.pickResultBuf);
-  gl.glGetBufferSubData(eGL_COPY_READ_BUFFER, 0, sizeof(uint32_t), &numResults);
-
-  if(numResults > 0)
-  {
-    if(isTriangleMesh)
-    {
-      struct PickResult
-      {
-        uint32_t vertid;
-        vec3 intersectionPoint;
-      };
-
-      byte *mapped = (byte *)gl.glMapNamedBufferEXT(DebugData.pickResultBuf, eGL_READ_ONLY);
-
-      mapped += sizeof(uint32_t) * 4;
-
-      PickResult *pickResults = (PickResult *)mapped;
-
-      PickResult *closest = pickResults;
-      // distance from raycast hit to nearest worldspace position of the mouse
-      float closestPickDistance = (closest->intersectionPoint - rayPos).Length();
-
-      // min with size of results buffer to protect against overflows
-      for(uint32_t i = 1; i < RDCMIN((uint32_t)DebugRenderData::maxMeshPicks, numResults); i++)
-      {
-        float pickDistance = (pickResults[i].intersectionPoint - rayPos).Length();
-        if(pickDistance < closestPickDistance)
-        {
-          closest = pickResults + i;
-        }
-      }
-
-      gl.glUnmapNamedBufferEXT(DebugData.pickResultBuf);
-
-      return closest->vertid;
-    }
-    else
-    {
-      struct PickResult
-      {
-        uint32_t vertid;
-        uint32_t idx;
-        float len;
-        float depth;
-      };
-
-      byte *mapped = (byte *)gl.glMapNamedBufferEXT(DebugData.pickResultBuf, eGL_READ_ONLY);
-
-      mapped += sizeof(uint32_t) * 4;
-
-      PickResult *pickResults = (PickResult *)mapped;
-
-      PickResult *closest = pickResults;
-
-      // min with size of results buffer to protect against overflows
-      for(uint32_t i = 1; i < RDCMIN((uint32_t)DebugRenderData::maxMeshPicks, numResults); i++)
-      {
-        // We need to keep the picking order consistent in the face
-        // of random buffer appends, when multiple vertices have the
-        // identical position (e.g. if UVs or normals are different).
-        //
-        // We could do something to try and disambiguate, but it's
-        // never going to be intuitive, it's just going to flicker
-        // confusingly.
-        if(pickResults[i].len < closest->len ||
-           (pickResults[i].len == closest->len && pickResults[i].depth < closest->depth) ||
-           (pickResults[i].len == closest->len && pickResults[i].depth == closest->depth &&
-            pickResults[i].vertid < closest->vertid))
-          closest = pickResults + i;
-      }
-
-      gl.glUnmapNamedBufferEXT(DebugData.pickResultBuf);
-
-      return closest->vertid;
-    }
-  }
-
-  return ~0U;
+  return m_MeshPickCache.PickVertex(eventID, cfg, x, y, DebugData.outWidth, DebugData.outHeight,
+                                    false, primitive);
 }
 
 void GLReplay::PickPixel(ResourceId texture, uint32_t x, uint32_t y, uint32_t sliceFace,
@@ -3270,6 +2884,10 @@ ResourceId GLReplay::RenderOverlay(ResourceId texid, CompType typeHint, DebugOve
 
   rs.ApplyState(m_pDriver->GetCtx(), m_pDriver);
 
+  // overlays replay draws with their own state and can clear the real targets, so whatever replay
+  // comes next has to start over
+  m_pDriver->MarkReplayStateDirty();
+
   return m_pDriver->GetResourceManager()->GetID(TextureRes(ctx, DebugData.overlayTex));
 }
 
@@ -26,9 +26,9 @@
 #include "gl_driver.h"
 #include <algorithm>
 #include "common/common.h"
+#include "core/capture_thumbnail.h"
 #include "data/glsl_shaders.h"
 #include "driver/shaders/spirv/spirv_common.h"
-#include "jpeg-compressor/jpge.h"
 #include "maths/matrix.h"
 #include "maths/vec.h"
 #include "replay/type_helpers.h"
@@ -768,6 +768,7 @@ WrappedOpenGL::WrappedOpenGL(const char *logfile, const GLHookSet &funcs, GLPlat
   m_CurDrawcallID = 0;
   m_FirstEventID = 0;
   m_LastEventID = ~0U;
+  m_ReplayedEventID = 0;
 
   m_FetchCounters = false;
 
@@ -2401,7 +2402,17 @@ void WrappedOpenGL::SwapBuffers(void *windowHandle)
   }
 
   if(m_State == WRITING_CAPFRAME && m_AppControlledCapture)
-    m_BackbufferImages[windowHandle] = SaveBackbufferImage();
+  {
+    // this happens on every present while capturing, so only keep a scaled down copy per window
+    // rather than the whole backbuffer
+    CaptureThumbnail *bbim = SaveBackbufferImage();
+
+    CaptureThumbnail *&saved = m_BackbufferImages[windowHandle];
+    SAFE_DELETE(saved);
+    saved = ShrinkCaptureThumbnail(bbim, MaxCaptureThumbnailSize);
+
+    SAFE_DELETE(bbim);
+  }
 
   if(!activeWindow)
     return;
@@ -2544,7 +2555,7 @@ bool WrappedOpenGL::EndFrameCapture(void *dev, void *wnd)
     ContextEndFrame();
     FinishCapture();
 
-    BackbufferImage *bbim = NULL;
+    CaptureThumbnail *bbim = NULL;
 
     // if the specified context isn't current, try and see if we've saved
     // an appropriate backbuffer image during capture.
@@ -2564,10 +2575,9 @@ bool WrappedOpenGL::EndFrameCapture(void *dev, void *wnd)
     if(bbim == NULL)
       bbim = SaveBackbufferImage();
 
-    Serialiser *m_pFileSerialiser = RenderDoc::Inst().OpenWriteSerialiser(
-        m_FrameCounter, &m_InitParams, bbim->jpgbuf, bbim->len, bbim->thwidth, bbim->thheight);
-
-    SAFE_DELETE(bbim);
+    // the serialiser takes ownership of the backbuffer image
+    Serialiser *m_pFileSerialiser =
+        RenderDoc::Inst().OpenWriteSerialiser(m_FrameCounter, &m_InitParams, bbim);
 
     for(auto it = m_BackbufferImages.begin(); it != m_BackbufferImages.end(); ++it)
       delete it->second;
@@ -2616,11 +2626,8 @@ bool WrappedOpenGL::EndFrameCapture(void *dev, void *wnd)
       RDCDEBUG("Done");
     }
 
-    m_pFileSerialiser->FlushToDisk();
-
-    RenderDoc::Inst().SuccessfullyWrittenLog(m_FrameCounter);
-
-    SAFE_DELETE(m_pFileSerialiser);
+    RenderDoc::Inst().FinishWriteSerialiser(m_pFileSerialiser, m_FrameCounter);
+    m_pFileSerialiser = NULL;
 
     m_State = WRITING_IDLE;
 
@@ -2628,6 +2635,8 @@ bool WrappedOpenGL::EndFrameCapture(void *dev, void *wnd)
 
     GetResourceManager()->ClearReferencedResources();
 
+    GetResourceManager()->DetachRecordChunksFromArena();
+
     if(switchctx.ctx != prevctx.ctx)
     {
       m_Platform.MakeContextCurrent(prevctx);
@@ -2675,6 +2684,8 @@ bool WrappedOpenGL::EndFrameCapture(void *dev, void *wnd)
 
     GetResourceManager()->ClearReferencedResources();
 
+    GetResourceManager()->DetachRecordChunksFromArena();
+
     // if it's a capture triggered from application code, immediately
     // give up as it's not reasonable to expect applications to detect and retry.
     // otherwise we can retry in case the next frame works.
@@ -2712,13 +2723,9 @@ bool WrappedOpenGL::EndFrameCapture(void *dev, void *wnd)
   }
 }
 
-WrappedOpenGL::BackbufferImage *WrappedOpenGL::SaveBackbufferImage()
+CaptureThumbnail *WrappedOpenGL::SaveBackbufferImage()
 {
-  const uint32_t maxSize = 2048;
-
-  byte *thpixels = NULL;
-  uint32_t thwidth = 0;
-  uint32_t thheight = 0;
+  CaptureThumbnail *bbim = NULL;
 
   if(m_Real.glGetIntegerv && m_Real.glReadBuffer && m_Real.glBindFramebuffer &&
      m_Real.glBindBuffer && m_Real.glReadPixels)
@@ -2746,34 +2753,15 @@ WrappedOpenGL::BackbufferImage *WrappedOpenGL::SaveBackbufferImage()
     m_Real.glPixelStorei(eGL_PACK_SKIP_PIXELS, 0);
     m_Real.glPixelStorei(eGL_PACK_ALIGNMENT, 1);
 
-    thwidth = m_InitParams.width;
-    thheight = m_InitParams.height;
+    uint32_t thwidth = m_InitParams.width;
+    uint32_t thheight = m_InitParams.height;
 
-    thpixels = new byte[thwidth * thheight * 3];
+    byte *thpixels = new byte[thwidth * thheight * 3];
 
     m_Real.glReadPixels(0, 0, thwidth, thheight, eGL_RGB, eGL_UNSIGNED_BYTE, thpixels);
 
-    // flip the image in-place
-    for(uint32_t y = 0; y <= thheight / 2; y++)
-    {
-      uint32_t flipY = (thheight - 1 - y);
-
-      for(uint32_t x = 0; x < thwidth; x++)
-      {
-        byte save[3];
-        save[0] = thpixels[y * (thwidth * 3) + x * 3 + 0];
-        save[1] = thpixels[y * (thwidth * 3) + x * 3 + 1];
-        save[2] = thpixels[y * (thwidth * 3) + x * 3 + 2];
-
-        thpixels[y * (thwidth * 3) + x * 3 + 0] = thpixels[flipY * (thwidth * 3) + x * 3 + 0];
-        thpixels[y * (thwidth * 3) + x * 3 + 1] = thpixels[flipY * (thwidth * 3) + x * 3 + 1];
-        thpixels[y * (thwidth * 3) + x * 3 + 2] = thpixels[flipY * (thwidth * 3) + x * 3 + 2];
-
-        thpixels[flipY * (thwidth * 3) + x * 3 + 0] = save[0];
-        thpixels[flipY * (thwidth * 3) + x * 3 + 1] = save[1];
-        thpixels[flipY * (thwidth * 3) + x * 3 + 2] = save[2];
-      }
-    }
+    // the image is flipped and scaled down later, off this thread
+    bbim = new CaptureThumbnailPixels(thpixels, thwidth, thheight, true);
 
     m_Real.glBindBuffer(eGL_PIXEL_PACK_BUFFER, packBufBind);
     m_Real.glBindFramebuffer(eGL_READ_FRAMEBUFFER, prevBuf);
@@ -2782,73 +2770,8 @@ WrappedOpenGL::BackbufferImage *WrappedOpenGL::SaveBackbufferImage()
     m_Real.glPixelStorei(eGL_PACK_SKIP_ROWS, prevPackSkipRows);
     m_Real.glPixelStorei(eGL_PACK_SKIP_PIXELS, prevPackSkipPixels);
     m_Real.glPixelStorei(eGL_PACK_ALIGNMENT, prevPackAlignment);
-
-    // scale down if necessary using simple point sampling
-    if(thwidth > maxSize)
-    {
-      float widthf = float(thwidth);
-      float heightf = float(thheight);
-
-      float aspect = widthf / heightf;
-
-      // clamp dimensions to a width of maxSize
-      thwidth = maxSize;
-      thheight = uint32_t(float(thwidth) / aspect);
-
-      byte *src = thpixels;
-      byte *dst = thpixels = new byte[3 * thwidth * thheight];
-
-      for(uint32_t y = 0; y < thheight; y++)
-      {
-        for(uint32_t x = 0; x < thwidth; x++)
-        {
-          float xf = float(x) / float(thwidth);
-          float yf = float(y) / float(thheight);
-
-          byte *pixelsrc =
-              &src[3 * uint32_t(xf * widthf) + m_InitParams.width * 3 * uint32_t(yf * heightf)];
-
-          memcpy(dst, pixelsrc, 3);
-
-          dst += 3;
-        }
-      }
-
-      // src is the raw unscaled pixels, which is no longer needed
-      SAFE_DELETE_ARRAY(src);
-    }
   }
 
-  byte *jpgbuf = NULL;
-  int len = thwidth * thheight;
-
-  if(len > 0)
-  {
-    jpgbuf = new byte[len];
-
-    jpge::params p;
-    p.m_quality = 80;
-
-    bool success =
-        jpge::compress_image_to_jpeg_file_in_memory(jpgbuf, len, thwidth, thheight, 3, thpixels, p);
-
-    if(!success)
-    {
-      RDCERR("Failed to compress to jpg");
-      SAFE_DELETE_ARRAY(jpgbuf);
-      thwidth = 0;
-      thheight = 0;
-    }
-  }
-
-  SAFE_DELETE_ARRAY(thpixels);
-
-  BackbufferImage *bbim = new BackbufferImage();
-  bbim->jpgbuf = jpgbuf;
-  bbim->len = len;
-  bbim->thwidth = thwidth;
-  bbim->thheight = thheight;
-
   return bbim;
 }
 
@@ -3783,6 +3706,7 @@ void WrappedOpenGL::ContextReplayLog(LogState readType, uint32_t startEventID, u
     m_CurEventID = 1;
     m_CurDrawcallID = 1;
     m_FirstEventID = 0;
+    m_ReplayedEventID = 0;
     m_LastEventID = ~0U;
   }
 
@@ -4236,13 +4160,21 @@ void WrappedOpenGL::AddEvent(string description)
 
 APIEvent WrappedOpenGL::GetEvent(uint32_t eventID)
 {
-  for(size_t i = m_Events.size() - 1; i > 0; i--)
+  // events are added in order as the log is read, so binary search for the last event at or
+  // before eventID
+  size_t lo = 1, hi = m_Events.size();
+
+  while(lo < hi)
   {
-    if(m_Events[i].eventID <= eventID)
-      return m_Events[i];
+    size_t mid = lo + (hi - lo) / 2;
+
+    if(m_Events[mid].eventID <= eventID)
+      lo = mid + 1;
+    else
+      hi = mid;
   }
 
-  return m_Events[0];
+  return m_Events[lo - 1];
 }
 
 const DrawcallDescription *WrappedOpenGL::GetDrawcall(uint32_t eventID)
@@ -4255,10 +4187,6 @@ const DrawcallDescription *WrappedOpenGL::GetDrawcall(uint32_t eventID)
 
 void WrappedOpenGL::ReplayLog(uint32_t startEventID, uint32_t endEventID, ReplayLogType replayType)
 {
-  uint64_t offs = m_FrameRecord.frameInfo.fileOffset;
-
-  m_pSerialiser->SetOffset(offs);
-
   bool partial = true;
 
   if(startEventID == 0 && (replayType == eReplay_WithoutDraw || replayType == eReplay_Full))
@@ -4267,6 +4195,47 @@ void WrappedOpenGL::ReplayLog(uint32_t startEventID, uint32_t endEventID, Replay
     partial = false;
   }
 
+  // the last event that has been executed once this replay is done
+  const uint32_t lastEventID =
+      replayType == eReplay_WithoutDraw ? RDCMAX(1U, endEventID) - 1 : endEventID;
+
+  // if the replayed state is already at an earlier event, only the events after it need to be
+  // executed instead of starting over from the beginning of the frame.
+  bool continuing = false;
+
+  if(m_ReplayedEventID != 0)
+  {
+    if(!partial && m_ReplayedEventID <= lastEventID)
+    {
+      // IDs without an event of their own, like pop markers, don't replay anything
+      uint32_t nextEventID = m_ReplayedEventID + 1;
+      while(nextEventID <= lastEventID && GetEvent(nextEventID).eventID != nextEventID)
+        nextEventID++;
+
+      if(nextEventID > lastEventID)
+      {
+        m_ReplayedEventID = lastEventID;
+        return;
+      }
+
+      startEventID = nextEventID;
+      endEventID = lastEventID;
+      replayType = eReplay_Full;
+      partial = true;
+      continuing = true;
+    }
+    else if(partial && replayType == eReplay_OnlyDraw &&
+            (startEventID == 0 || startEventID == endEventID) &&
+            endEventID == m_ReplayedEventID + 1 && GetEvent(endEventID).eventID == endEventID)
+    {
+      continuing = true;
+    }
+  }
+
+  uint64_t offs = m_FrameRecord.frameInfo.fileOffset;
+
+  m_pSerialiser->SetOffset(offs);
+
   GLChunkType header = (GLChunkType)m_pSerialiser->PushContext(NULL, NULL, 1, false);
 
   RDCASSERTEQUAL(header, CAPTURE_SCOPE);
@@ -4304,4 +4273,10 @@ void WrappedOpenGL::ReplayLog(uint32_t startEventID, uint32_t endEventID, Replay
   {
     RDCFATAL("Unexpected replay type");
   }
+
+  // any other partial replay might replay events out of order, so the next replay has to start over
+  if(!partial || continuing)
+    m_ReplayedEventID = lastEventID;
+  else
+    m_ReplayedEventID = 0;
 }
@@ -233,6 +233,10 @@ private:
   uint32_t m_FirstEventID;
   uint32_t m_LastEventID;
 
+  // the last event that the replayed state has executed everything up to, or 0 if the state
+  // doesn't match the frame at any event. Replaying forward from here only needs the events after.
+  uint32_t m_ReplayedEventID;
+
   DrawcallTreeNode m_ParentDrawcall;
 
   list<DrawcallTreeNode *> m_DrawcallStack;
@@ -496,18 +500,10 @@ private:
   void RenderOverlayText(float x, float y, const char *fmt, ...);
   void RenderOverlayStr(float x, float y, const char *str);
 
-  struct BackbufferImage
-  {
-    BackbufferImage() : jpgbuf(NULL), len(0), thwidth(0), thheight(0) {}
-    ~BackbufferImage() { SAFE_DELETE_ARRAY(jpgbuf); }
-    byte *jpgbuf;
-    size_t len;
-    uint32_t thwidth;
-    uint32_t thheight;
-  };
-
-  BackbufferImage *SaveBackbufferImage();
-  map<void *, BackbufferImage *> m_BackbufferImages;
+  // reads back the current backbuffer, which is scaled and compressed on the capture writer
+  // thread. Returns NULL if it can't be read.
+  CaptureThumbnail *SaveBackbufferImage();
+  map<void *, CaptureThumbnail *> m_BackbufferImages;
 
   vector<string> globalExts;
   void GetGLExtensions();
@@ -547,6 +543,9 @@ public:
   void Initialise(GLInitParams &params);
   void ReplayLog(uint32_t startEventID, uint32_t endEventID, ReplayLogType replayType);
   void ReadLogInitialisation();
+  // called when the replayed state is modified outside of the frame's events, e.g. by an overlay,
+  // so that the next replay starts over instead of continuing on
+  void MarkReplayStateDirty() { m_ReplayedEventID = 0; }
 
   Serialiser *GetSerialiser() { return m_pSerialiser; }
   GLuint GetFakeBBFBO() { return m_FakeBB_FBO; }
@@ -2789,12 +2789,19 @@ void GLReplay::ReplaceResource(ResourceId from, ResourceId to)
 {
   MakeCurrentReplayContext(&m_ReplayCtx);
   m_pDriver->ReplaceResource(from, to);
+
+  // replacing a shader can change the post-transform data that was picked in
+  m_MeshPickCache.Clear();
+  m_pDriver->MarkReplayStateDirty();
 }
 
 void GLReplay::RemoveReplacement(ResourceId id)
 {
   MakeCurrentReplayContext(&m_ReplayCtx);
   m_pDriver->RemoveReplacement(id);
+
+  m_MeshPickCache.Clear();
+  m_pDriver->MarkReplayStateDirty();
 }
 
 void GLReplay::FreeTargetResource(ResourceId id)
@@ -3165,6 +3172,9 @@ void GLReplay::SetProxyBufferData(ResourceId bufid, byte *data, size_t dataSize)
   GLuint buf = m_pDriver->GetResourceManager()->GetCurrentResource(bufid).name;
 
   m_pDriver->glNamedBufferSubDataEXT(buf, 0, dataSize, data);
+
+  // proxied buffers are refreshed in place, so anything picked from them is stale
+  m_MeshPickCache.Clear();
 }
 
 vector<EventUsage> GLReplay::GetUsage(ResourceId id)
@@ -27,6 +27,7 @@
 
 #include "api/replay/renderdoc_replay.h"
 #include "core/core.h"
+#include "replay/mesh_pick.h"
 #include "replay/replay_driver.h"
 #include "gl_common.h"
 
@@ -199,7 +200,8 @@ public:
   ShaderDebugTrace DebugThread(uint32_t eventID, uint32_t groupid[3], uint32_t threadid[3]);
   void PickPixel(ResourceId texture, uint32_t x, uint32_t y, uint32_t sliceFace, uint32_t mip,
                  uint32_t sample, CompType typeHint, float pixel[4]);
-  uint32_t PickVertex(uint32_t eventID, const MeshDisplay &cfg, uint32_t x, uint32_t y);
+  uint32_t PickVertex(uint32_t eventID, const MeshDisplay &cfg, uint32_t x, uint32_t y,
+                      uint32_t *primitive);
 
   ResourceId RenderOverlay(ResourceId id, CompType typeHint, DebugOverlay overlay, uint32_t eventID,
                            const vector<uint32_t> &passEvents);
@@ -306,13 +308,6 @@ private:
     GLuint customTex;
     ResourceId CustomShaderTexID;
 
-    static const int maxMeshPicks = 500;
-
-    GLuint meshPickProgram;
-    GLuint pickIBBuf, pickVBBuf;
-    uint32_t pickIBSize, pickVBSize;
-    GLuint pickResultBuf;
-
     GLuint MS2Array, Array2MS;
 
     GLuint pointSampler;
@@ -361,6 +356,7 @@ private:
   bool m_Degraded;
 
   HighlightCache m_HighlightCache;
+  MeshPickCache m_MeshPickCache;
 
   // eventID -> data
   map<uint32_t, GLPostVSData> m_PostVSData;
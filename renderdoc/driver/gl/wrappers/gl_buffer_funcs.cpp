@@ -2497,11 +2497,14 @@ void WrappedOpenGL::PersistentMapMemoryBarrier(const set<GLResourceRecord *> &ma
 
     RDCASSERT(record && record->Map.persistentPtr);
 
-    size_t diffStart = 0, diffEnd = 0;
-    bool found = FindDiffRange(record->GetShadowPtr(0), record->GetShadowPtr(1),
-                               (size_t)record->Length, diffStart, diffEnd);
-    if(found)
+    vector<DiffRange> ranges;
+    FindDiffRanges(record->GetShadowPtr(0), record->GetShadowPtr(1), (size_t)record->Length,
+                   ranges);
+
+    for(size_t r = 0; r < ranges.size(); r++)
     {
+      size_t diffStart = ranges[r].start, diffEnd = ranges[r].end;
+
       // update the modified region in the 'comparison' shadow buffer for next check
       memcpy(record->GetShadowPtr(1) + diffStart, record->GetShadowPtr(0) + diffStart,
              diffEnd - diffStart);
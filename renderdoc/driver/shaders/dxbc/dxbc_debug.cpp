@@ -32,6 +32,10 @@
 #include "maths/formatpacking.h"
 #include "dxbc_inspect.h"
 
+#if ENABLED(RDOC_X86)
+#include <immintrin.h>
+#endif
+
 using namespace DXBC;
 
 namespace ShaderDebug
@@ -4631,4 +4635,641 @@ State State::GetNext(GlobalState &global, State quad[4]) const
   return s;
 }
 
+#if ENABLED(RDOC_X86)
+
+SIMD_TARGET("sse2")
+static inline __m128i Select_SSE2(__m128i mask, __m128i a, __m128i b)
+{
+  return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+// applies an operand modifier the same way as abs() and neg() do for the operation's type
+SIMD_TARGET("sse2")
+static void ApplyModifier_SSE2(OperandModifier modifier, VarType type, const uint32_t *src,
+                               uint32_t *dst, size_t count)
+{
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i sign = _mm_set1_epi32((int)0x80000000);
+
+  for(size_t l = 0; l < count; l += 4)
+  {
+    __m128i v = _mm_loadu_si128((const __m128i *)(src + l));
+
+    if(type == VarType::Float)
+    {
+      if(modifier == OPERAND_MODIFIER_ABS || modifier == OPERAND_MODIFIER_ABSNEG)
+        v = Select_SSE2(_mm_castps_si128(_mm_cmpgt_ps(_mm_castsi128_ps(v), _mm_setzero_ps())), v,
+                        _mm_xor_si128(v, sign));
+      if(modifier == OPERAND_MODIFIER_NEG || modifier == OPERAND_MODIFIER_ABSNEG)
+        v = _mm_xor_si128(v, sign);
+    }
+    else if(type == VarType::Int)
+    {
+      if(modifier == OPERAND_MODIFIER_ABS || modifier == OPERAND_MODIFIER_ABSNEG)
+        v = Select_SSE2(_mm_cmpgt_epi32(v, zero), v, _mm_sub_epi32(zero, v));
+      if(modifier == OPERAND_MODIFIER_NEG || modifier == OPERAND_MODIFIER_ABSNEG)
+        v = _mm_sub_epi32(zero, v);
+    }
+
+    _mm_storeu_si128((__m128i *)(dst + l), v);
+  }
+}
+
+// executes one of the opcodes accepted by LaneGroup::CanExecuteSIMD over count lanes. src[i][c] is
+// the row for component c of source operand i, and res[c] receives component c of the result.
+// Each case matches the corresponding scalar implementation in State::GetNext bit for bit.
+SIMD_TARGET("sse2")
+static void ExecuteLanes_SSE2(OpcodeType opcode, const uint32_t *const src[3][4],
+                              uint32_t *const res[4], bool saturate, size_t count)
+{
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i ones = _mm_set1_epi32(-1);
+  const __m128i sign = _mm_set1_epi32((int)0x80000000);
+
+  for(size_t l = 0; l < count; l += 4)
+  {
+    __m128i r[4];
+
+    if(opcode == OPCODE_DP2 || opcode == OPCODE_DP3 || opcode == OPCODE_DP4)
+    {
+      int n = opcode == OPCODE_DP2 ? 2 : (opcode == OPCODE_DP3 ? 3 : 4);
+
+      // sum in the same order as the scalar path so rounding is identical
+      __m128 sum = _mm_mul_ps(_mm_loadu_ps((const float *)src[0][0] + l),
+                              _mm_loadu_ps((const float *)src[1][0] + l));
+      for(int c = 1; c < n; c++)
+        sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps((const float *)src[0][c] + l),
+                                         _mm_loadu_ps((const float *)src[1][c] + l)));
+
+      r[0] = r[1] = r[2] = r[3] = _mm_castps_si128(sum);
+    }
+    else
+    {
+      for(int c = 0; c < 4; c++)
+      {
+        __m128i a = _mm_loadu_si128((const __m128i *)(src[0][c] + l));
+        __m128i b = _mm_loadu_si128((const __m128i *)(src[1][c] + l));
+        __m128i d = _mm_loadu_si128((const __m128i *)(src[2][c] + l));
+        __m128 fa = _mm_castsi128_ps(a);
+        __m128 fb = _mm_castsi128_ps(b);
+
+        switch(opcode)
+        {
+          case OPCODE_MOV: r[c] = a; break;
+          case OPCODE_MOVC: r[c] = Select_SSE2(_mm_cmpeq_epi32(a, zero), d, b); break;
+          case OPCODE_ADD: r[c] = _mm_castps_si128(_mm_add_ps(fa, fb)); break;
+          case OPCODE_MUL: r[c] = _mm_castps_si128(_mm_mul_ps(fa, fb)); break;
+          case OPCODE_MAD:
+            r[c] = _mm_castps_si128(_mm_add_ps(_mm_mul_ps(fa, fb), _mm_castsi128_ps(d)));
+            break;
+          // min/max select rather than use minps/maxps so that signed zeros and NaNs pick the same
+          // operand as the scalar comparisons
+          case OPCODE_MIN: r[c] = Select_SSE2(_mm_castps_si128(_mm_cmplt_ps(fa, fb)), a, b); break;
+          case OPCODE_MAX: r[c] = Select_SSE2(_mm_castps_si128(_mm_cmpge_ps(fa, fb)), a, b); break;
+          case OPCODE_EQ: r[c] = _mm_castps_si128(_mm_cmpeq_ps(fa, fb)); break;
+          case OPCODE_NE: r[c] = _mm_castps_si128(_mm_cmpneq_ps(fa, fb)); break;
+          case OPCODE_LT: r[c] = _mm_castps_si128(_mm_cmplt_ps(fa, fb)); break;
+          case OPCODE_GE: r[c] = _mm_castps_si128(_mm_cmpge_ps(fa, fb)); break;
+          case OPCODE_FTOI: r[c] = _mm_cvttps_epi32(fa); break;
+          case OPCODE_ITOF: r[c] = _mm_castps_si128(_mm_cvtepi32_ps(a)); break;
+          case OPCODE_IADD: r[c] = _mm_add_epi32(a, b); break;
+          case OPCODE_INEG: r[c] = _mm_sub_epi32(zero, a); break;
+          case OPCODE_AND: r[c] = _mm_and_si128(a, b); break;
+          case OPCODE_OR: r[c] = _mm_or_si128(a, b); break;
+          case OPCODE_XOR: r[c] = _mm_xor_si128(a, b); break;
+          case OPCODE_NOT: r[c] = _mm_xor_si128(a, ones); break;
+          case OPCODE_IEQ: r[c] = _mm_cmpeq_epi32(a, b); break;
+          case OPCODE_INE: r[c] = _mm_xor_si128(_mm_cmpeq_epi32(a, b), ones); break;
+          case OPCODE_ILT: r[c] = _mm_cmplt_epi32(a, b); break;
+          case OPCODE_IGE: r[c] = _mm_xor_si128(_mm_cmplt_epi32(a, b), ones); break;
+          // SSE2 only has signed compares, so flip the sign bits to compare unsigned
+          case OPCODE_ULT:
+            r[c] = _mm_cmplt_epi32(_mm_xor_si128(a, sign), _mm_xor_si128(b, sign));
+            break;
+          case OPCODE_UGE:
+            r[c] = _mm_xor_si128(_mm_cmplt_epi32(_mm_xor_si128(a, sign), _mm_xor_si128(b, sign)),
+                                 ones);
+            break;
+          default: r[c] = zero; break;
+        }
+      }
+    }
+
+    for(int c = 0; c < 4; c++)
+    {
+      if(saturate)
+      {
+        // like sat(), NaNs fail both compares and pass through unchanged
+        __m128 f = _mm_castsi128_ps(r[c]);
+        __m128i lo = _mm_castps_si128(_mm_cmplt_ps(f, _mm_setzero_ps()));
+        __m128i hi = _mm_castps_si128(_mm_cmpgt_ps(f, _mm_set1_ps(1.0f)));
+        r[c] = Select_SSE2(hi, _mm_castps_si128(_mm_set1_ps(1.0f)), r[c]);
+        r[c] = Select_SSE2(lo, zero, r[c]);
+      }
+
+      _mm_storeu_si128((__m128i *)(res[c] + l), r[c]);
+    }
+  }
+}
+
+#endif
+
+LaneGroup::LaneGroup(DXBC::DXBCFile *dxbc, const vector<State> &lanes, bool quads)
+    : m_DXBC(dxbc), m_Quads(quads), m_Cur(lanes), m_NumStepped(0)
+{
+  RDCASSERT(!quads || (lanes.size() % 4) == 0);
+
+  if(quads)
+    m_Next.resize(lanes.size());
+
+  m_Active.resize(lanes.size(), true);
+  m_Stepped.resize(lanes.size(), false);
+  m_Executed.resize(lanes.size(), false);
+
+  m_SIMD = false;
+  m_NumTemps = 0;
+  m_LaneStride = 0;
+
+#if ENABLED(RDOC_X86)
+  // quads need each lane's previous State for derivatives, so only whole groups use SIMD
+  m_SIMD = !quads && !lanes.empty() && CPUSupportsSSE2();
+#endif
+
+  if(m_SIMD)
+  {
+    m_NumTemps = (uint32_t)lanes[0].registers.count;
+    m_LaneStride = AlignUp4(lanes.size());
+
+    m_Temps.resize(m_NumTemps * 4 * m_LaneStride, 0);
+    // three sources, the result, and a row of zeros for missing sources
+    m_Scratch.resize(17 * m_LaneStride, 0);
+    m_SIMDInstruction.resize(dxbc->GetNumInstructions(), -1);
+
+    for(size_t i = 0; i < lanes.size(); i++)
+    {
+      RDCASSERT((uint32_t)lanes[i].registers.count == m_NumTemps);
+      StoreLane(i);
+    }
+  }
+
+  if(!quads)
+    UpdateBarrierActive();
+}
+
+void LaneGroup::Step(GlobalState &global)
+{
+  m_NumStepped = 0;
+
+  if(m_Quads)
+  {
+    // every lane in a quad must step from the same previous state so that derivatives read
+    // consistent values, so step into a separate array and copy back afterwards. Helper lanes are
+    // 'finished' but still need to step to provide derivatives.
+    for(size_t i = 0; i < m_Cur.size(); i++)
+    {
+      m_Stepped[i] = m_Active[i];
+      if(m_Active[i])
+      {
+        m_Next[i] = m_Cur[i].GetNext(global, &m_Cur[i & ~size_t(3)]);
+        m_NumStepped++;
+      }
+    }
+
+    for(size_t i = 0; i < m_Cur.size(); i++)
+      if(m_Stepped[i])
+        m_Cur[i] = m_Next[i];
+
+    for(size_t q = 0; q < m_Cur.size(); q += 4)
+      UpdateQuadActive(q);
+  }
+  else
+  {
+    // lanes never read each other's registers, so they can step in place
+    for(size_t i = 0; i < m_Cur.size(); i++)
+    {
+      m_Stepped[i] = m_Active[i] && !m_Cur[i].Finished();
+      m_Executed[i] = false;
+      if(m_Stepped[i])
+        m_NumStepped++;
+    }
+
+    for(size_t i = 0; i < m_Cur.size(); i++)
+    {
+      if(!m_Stepped[i] || m_Executed[i])
+        continue;
+
+      if(m_SIMD)
+      {
+        if(CanExecuteSIMD(m_Cur[i].nextInstruction))
+        {
+          ExecuteSIMD(m_DXBC->GetInstruction((size_t)m_Cur[i].nextInstruction), i);
+          continue;
+        }
+
+        LoadLane(i);
+        m_Cur[i] = m_Cur[i].GetNext(global, NULL);
+        StoreLane(i);
+      }
+      else
+      {
+        m_Cur[i] = m_Cur[i].GetNext(global, NULL);
+      }
+
+      m_Executed[i] = true;
+    }
+
+    UpdateBarrierActive();
+  }
+}
+
+void LaneGroup::UpdateQuadActive(size_t quad)
+{
+  const State *lanes = &m_Cur[quad];
+
+  // we need to make sure that control flow which converges stays in lockstep so that
+  // derivatives are still valid. While diverged, we don't have to keep threads in lockstep
+  // since using derivatives is invalid.
+
+  // Threads diverge either in ifs, loops, or switches. Due to the nature of the bytecode,
+  // all threads *must* pass through the same exit instruction for each, there's no jumping
+  // around with gotos. Note also for the same reason, the only time threads are on earlier
+  // instructions is if they are still catching up to a thread that has exited the control
+  // flow.
+
+  // So the scheme is as follows:
+  // * If all threads have the same nextInstruction, just continue we are still in lockstep.
+  // * If threads are out of lockstep, find any thread which has nextInstruction pointing
+  //   immediately *after* an ENDIF, ENDLOOP or ENDSWITCH. Pointing directly at one is not
+  //   an indication the thread is done, as the next step for an ENDLOOP will jump back to
+  //   the matching LOOP and continue iterating.
+  // * Pause any thread matching the above until all threads are pointing to the same
+  //   instruction. By the assumption above, all threads will eventually pass through this
+  //   terminating instruction so we just pause any other threads and don't do anything
+  //   until the control flow has converged and we can continue stepping in lockstep.
+
+  // mark all threads as active again.
+  // if we've converged, or we were never diverged, this keeps everything ticking
+  for(size_t i = 0; i < 4; i++)
+    m_Active[quad + i] = true;
+
+  if(lanes[0].nextInstruction != lanes[1].nextInstruction ||
+     lanes[0].nextInstruction != lanes[2].nextInstruction ||
+     lanes[0].nextInstruction != lanes[3].nextInstruction)
+  {
+    // this isn't *perfect* but it will still eventually continue. We look for the most
+    // advanced thread, and check to see if it's just finished a control flow. If it has
+    // then we assume it's at the convergence point and wait for every other thread to
+    // catch up, pausing any threads that reach the convergence point before others.
+
+    // Note this might mean we don't have any threads paused even within divergent flow.
+    // This is fine and all we care about is pausing to make sure threads don't run ahead
+    // into code that should be lockstep. We don't care at all about what they do within
+    // the code that is divergent.
+
+    // The reason this isn't perfect is that the most advanced thread could be on an
+    // inner loop or inner if, not the convergence point, and we could be pausing it
+    // fruitlessly. Worse still - it could be on a branch none of the other threads will
+    // take so they will never reach that exact instruction.
+    // But we know that all threads will eventually go through the convergence point, so
+    // even in that worst case if we didn't pick the right waiting point, another thread
+    // will overtake and become the new most advanced thread and the previous waiting
+    // thread will resume. So in this case we caused a thread to wait more than it should
+    // have but that's not a big deal as it's within divergent flow so they don't have to
+    // stay in lockstep. Also if all threads will eventually pass that point we picked,
+    // we just waited to converge even in technically divergent code which is also
+    // harmless.
+
+    // Phew!
+
+    uint32_t convergencePoint = 0;
+
+    // find which thread is most advanced
+    for(size_t i = 0; i < 4; i++)
+      if(lanes[i].nextInstruction > convergencePoint)
+        convergencePoint = lanes[i].nextInstruction;
+
+    if(convergencePoint > 0)
+    {
+      OpcodeType op = m_DXBC->GetInstruction(convergencePoint - 1).operation;
+
+      // if the most advnaced thread hasn't just finished control flow, then all
+      // threads are still running, so don't converge
+      if(op != OPCODE_ENDIF && op != OPCODE_ENDLOOP && op != OPCODE_ENDSWITCH)
+        convergencePoint = 0;
+    }
+
+    // pause any threads at that instruction (could be none)
+    for(size_t i = 0; i < 4; i++)
+      if(lanes[i].nextInstruction == convergencePoint)
+        m_Active[quad + i] = false;
+  }
+}
+
+void LaneGroup::UpdateBarrierActive()
+{
+  bool anyRunning = false;
+  bool allAtBarrier = true;
+
+  for(size_t i = 0; i < m_Cur.size(); i++)
+  {
+    const State &lane = m_Cur[i];
+
+    m_Active[i] = true;
+
+    if(lane.Finished())
+      continue;
+
+    anyRunning = true;
+
+    const ASMOperation &op = m_DXBC->GetInstruction((size_t)lane.nextInstruction);
+
+    // a lane waits if its next instruction is a sync that includes the thread sync flag
+    if(op.operation == OPCODE_SYNC && (op.syncFlags & SYNC_THREADS))
+      m_Active[i] = false;
+    else
+      allAtBarrier = false;
+  }
+
+  // once every lane that's still running has arrived, release them all together
+  if(anyRunning && allAtBarrier)
+    m_Active.assign(m_Active.size(), true);
+}
+
+void LaneGroup::LoadLane(size_t lane)
+{
+  State &s = m_Cur[lane];
+
+  for(uint32_t r = 0; r < m_NumTemps; r++)
+    for(uint32_t c = 0; c < 4; c++)
+      s.registers[r].value.uv[c] = m_Temps[(r * 4 + c) * m_LaneStride + lane];
+}
+
+void LaneGroup::StoreLane(size_t lane)
+{
+  const State &s = m_Cur[lane];
+
+  for(uint32_t r = 0; r < m_NumTemps; r++)
+    for(uint32_t c = 0; c < 4; c++)
+      m_Temps[(r * 4 + c) * m_LaneStride + lane] = s.registers[r].value.uv[c];
+}
+
+static bool IsAbsoluteIndexed(const ASMOperand &oper)
+{
+  for(size_t i = 0; i < oper.indices.size(); i++)
+    if(!oper.indices[i].absolute || oper.indices[i].relative)
+      return false;
+
+  return true;
+}
+
+bool LaneGroup::CanExecuteSIMD(uint32_t instruction)
+{
+  if(instruction >= m_SIMDInstruction.size())
+    return false;
+
+  if(m_SIMDInstruction[instruction] >= 0)
+    return m_SIMDInstruction[instruction] == 1;
+
+  const ASMOperation &op = m_DXBC->GetInstruction(instruction);
+
+  bool ret = false;
+
+  switch(op.operation)
+  {
+    case OPCODE_MOV:
+    case OPCODE_MOVC:
+    case OPCODE_ADD:
+    case OPCODE_MUL:
+    case OPCODE_MAD:
+    case OPCODE_MIN:
+    case OPCODE_MAX:
+    case OPCODE_DP2:
+    case OPCODE_DP3:
+    case OPCODE_DP4:
+    case OPCODE_EQ:
+    case OPCODE_NE:
+    case OPCODE_LT:
+    case OPCODE_GE:
+    case OPCODE_FTOI:
+    case OPCODE_ITOF:
+    case OPCODE_IADD:
+    case OPCODE_INEG:
+    case OPCODE_AND:
+    case OPCODE_OR:
+    case OPCODE_XOR:
+    case OPCODE_NOT:
+    case OPCODE_IEQ:
+    case OPCODE_INE:
+    case OPCODE_ILT:
+    case OPCODE_IGE:
+    case OPCODE_ULT:
+    case OPCODE_UGE: ret = true; break;
+    default: break;
+  }
+
+  size_t numOperands = m_DXBC->NumOperands(op.operation);
+
+  if(op.operands.size() != numOperands || numOperands < 2)
+    ret = false;
+
+  // sat() on integer types clamps differently, leave those to the scalar path
+  if(op.saturate && m_Cur[0].OperationType(op.operation) != VarType::Float)
+    ret = false;
+
+  if(ret)
+  {
+    const ASMOperand &dst = op.operands[0];
+
+    if(dst.type == TYPE_TEMP)
+      ret = dst.indices.size() == 1 && IsAbsoluteIndexed(dst) &&
+            dst.indices[0].index < m_NumTemps;
+    else if(dst.type != TYPE_NULL)
+      ret = false;
+
+    int numDstComps = 0;
+    for(int c = 0; c < 4; c++)
+      if(dst.comps[c] != 0xff)
+        numDstComps++;
+
+    for(size_t i = 1; ret && i < numOperands; i++)
+    {
+      const ASMOperand &src = op.operands[i];
+
+      // scalar operands only have their first component computed and modified, which is only
+      // valid when a single component is written
+      bool scalar = src.comps[0] != 0xff && src.comps[1] == 0xff && src.comps[2] == 0xff &&
+                    src.comps[3] == 0xff;
+
+      if(scalar && (numDstComps > 1 || op.operation == OPCODE_DP2 ||
+                    op.operation == OPCODE_DP3 || op.operation == OPCODE_DP4))
+        ret = false;
+
+      if(src.type == TYPE_TEMP)
+        ret = ret && src.indices.size() == 1 && IsAbsoluteIndexed(src) &&
+              src.indices[0].index < m_NumTemps;
+      // these are the same for every lane, as long as no temps are used to index them
+      else if(src.type == TYPE_IMMEDIATE32 || src.type == TYPE_CONSTANT_BUFFER ||
+              src.type == TYPE_IMMEDIATE_CONSTANT_BUFFER)
+        ret = ret && IsAbsoluteIndexed(src);
+      else
+        ret = false;
+    }
+  }
+
+  m_SIMDInstruction[instruction] = ret ? 1 : 0;
+
+  return ret;
+}
+
+void LaneGroup::ExecuteSIMD(const ASMOperation &op, size_t firstLane)
+{
+#if ENABLED(RDOC_X86)
+  const State &first = m_Cur[firstLane];
+  const uint32_t instruction = first.nextInstruction;
+  const VarType optype = first.OperationType(op.operation);
+
+  const uint32_t *src[3][4];
+  uint32_t *res[4];
+
+  bool src0Float = false;
+
+  for(size_t i = 0; i < 3; i++)
+  {
+    if(i + 1 >= op.operands.size())
+    {
+      for(int c = 0; c < 4; c++)
+        src[i][c] = &m_Scratch[16 * m_LaneStride];
+      continue;
+    }
+
+    const ASMOperand &oper = op.operands[i + 1];
+    bool isFloat = false;
+
+    if(oper.type == TYPE_TEMP)
+    {
+      uint32_t reg = (uint32_t)oper.indices[0].index;
+
+      for(uint32_t c = 0; c < 4; c++)
+      {
+        uint32_t comp = oper.comps[c] == 0xff ? c : oper.comps[c];
+        src[i][c] = &m_Temps[(reg * 4 + comp) * m_LaneStride];
+      }
+
+      isFloat = first.registers[reg].type == VarType::Float;
+
+      if(oper.modifier != OPERAND_MODIFIER_NONE)
+      {
+        for(int c = 0; c < 4; c++)
+        {
+          uint32_t *row = &m_Scratch[(i * 4 + c) * m_LaneStride];
+          ApplyModifier_SSE2(oper.modifier, optype, src[i][c], row, m_LaneStride);
+          src[i][c] = row;
+        }
+
+        // abs() and neg() retype the value to the operation's type
+        isFloat = optype == VarType::Float;
+      }
+    }
+    else
+    {
+      ShaderVariable v = first.GetSrc(oper, op);
+
+      for(int c = 0; c < 4; c++)
+      {
+        uint32_t *row = &m_Scratch[(i * 4 + c) * m_LaneStride];
+        std::fill(row, row + m_LaneStride, v.value.uv[c]);
+        src[i][c] = row;
+      }
+
+      isFloat = v.type == VarType::Float;
+    }
+
+    if(i == 0)
+      src0Float = isFloat;
+  }
+
+  for(int c = 0; c < 4; c++)
+    res[c] = &m_Scratch[(12 + c) * m_LaneStride];
+
+  ExecuteLanes_SSE2(op.operation, src, res, op.saturate, m_LaneStride);
+
+  // AssignValue only checks for NaNs and infinities when the result is float typed
+  bool resultFloat = false;
+
+  switch(op.operation)
+  {
+    case OPCODE_MOV: resultFloat = src0Float; break;
+    case OPCODE_ADD:
+    case OPCODE_MUL:
+    case OPCODE_MAD:
+    case OPCODE_MIN:
+    case OPCODE_MAX:
+    case OPCODE_DP2:
+    case OPCODE_DP3:
+    case OPCODE_DP4:
+    case OPCODE_ITOF: resultFloat = true; break;
+    default: break;
+  }
+
+  const ASMOperand &dst = op.operands[0];
+
+  // same masking as SetDst - a scalar mask writes the first result component, and a vector mask
+  // writes matching components
+  uint32_t dstComps[4] = {0}, resComps[4] = {0};
+  int numWrites = 0;
+
+  if(dst.comps[0] != 0xff && dst.comps[1] == 0xff && dst.comps[2] == 0xff && dst.comps[3] == 0xff)
+  {
+    dstComps[0] = dst.comps[0];
+    numWrites = 1;
+  }
+  else
+  {
+    for(int c = 0; c < 4; c++)
+    {
+      if(dst.comps[c] != 0xff)
+      {
+        dstComps[numWrites] = resComps[numWrites] = dst.comps[c];
+        numWrites++;
+      }
+    }
+
+    if(numWrites == 0)
+      numWrites = 1;
+  }
+
+  // writing a NULL destination is skipped entirely, including the NaN check
+  if(dst.type != TYPE_TEMP)
+    numWrites = 0;
+
+  uint32_t reg = dst.type == TYPE_TEMP ? (uint32_t)dst.indices[0].index : 0;
+
+  // every remaining lane that's stepping from this instruction has now executed it
+  for(size_t l = firstLane; l < m_Cur.size(); l++)
+  {
+    State &lane = m_Cur[l];
+
+    if(!m_Stepped[l] || m_Executed[l] || lane.nextInstruction != instruction)
+      continue;
+
+    m_Executed[l] = true;
+
+    lane.nextInstruction++;
+    lane.flags = ShaderEvents::NoEvent;
+
+    for(int w = 0; w < numWrites; w++)
+    {
+      uint32_t val = res[resComps[w]][l];
+
+      if(resultFloat && (val & 0x7f800000) == 0x7f800000)
+        lane.flags |= ShaderEvents::GeneratedNanOrInf;
+
+      m_Temps[(reg * 4 + dstComps[w]) * m_LaneStride + l] = val;
+    }
+  }
+#else
+  RDCERR("SIMD lane execution is not available on this architecture");
+#endif
+}
+
 };    // namespace ShaderDebug
@@ -162,6 +162,8 @@ public:
   State GetNext(GlobalState &global, State quad[4]) const;
 
 private:
+  friend class LaneGroup;
+
   // index in the pixel quad
   int quadIndex;
 
@@ -192,4 +194,66 @@ private:
   WrappedID3D11Device *device;
 };
 
+// Steps a set of threads in lockstep, executing each instruction across every lane before any lane
+// moves on. Used for pixel quads, so that neighbouring pixels are available for derivatives, and
+// for whole compute threadgroups so that groupshared memory sees the writes of other threads.
+//
+// In quad mode lanes are grouped in fours, and a quad's lanes that diverge are paused where their
+// control flow reconverges. Otherwise any lane that reaches a thread sync waits until every other
+// running lane has reached one too.
+//
+// Outside of quad mode the lanes' temporary registers are stored structure-of-arrays, so that
+// simple ALU instructions on temps, immediates and constants are executed for every lane at the
+// same instruction together with SIMD. Anything else steps each lane's full State as before.
+// Callers should only use a whole group when other threads can actually affect the result.
+class LaneGroup
+{
+public:
+  LaneGroup(DXBC::DXBCFile *dxbc, const vector<State> &lanes, bool quads);
+
+  size_t NumLanes() const { return m_Cur.size(); }
+  const State &GetLane(size_t i)
+  {
+    if(m_SIMD)
+      LoadLane(i);
+    return m_Cur[i];
+  }
+  bool Finished(size_t i) const { return m_Cur[i].Finished(); }
+  // whether the lane executed an instruction in the last Step(). Paused lanes are unchanged.
+  bool Stepped(size_t i) const { return m_Stepped[i]; }
+  size_t NumStepped() const { return m_NumStepped; }
+
+  void Step(GlobalState &global);
+
+private:
+  void UpdateQuadActive(size_t quad);
+  void UpdateBarrierActive();
+
+  // copy a lane's temps between its State and m_Temps
+  void LoadLane(size_t lane);
+  void StoreLane(size_t lane);
+
+  bool CanExecuteSIMD(uint32_t instruction);
+  // executes the instruction for firstLane and every later lane stepping from the same instruction
+  void ExecuteSIMD(const DXBC::ASMOperation &op, size_t firstLane);
+
+  DXBC::DXBCFile *m_DXBC;
+  bool m_Quads;
+
+  vector<State> m_Cur, m_Next;
+  vector<bool> m_Active, m_Stepped, m_Executed;
+  size_t m_NumStepped;
+
+  bool m_SIMD;
+  uint32_t m_NumTemps;
+  // component c of r# for lane l is at m_Temps[(r * 4 + c) * m_LaneStride + l]. The stride is
+  // rounded up so that every row can be processed in whole SIMD registers.
+  size_t m_LaneStride;
+  vector<uint32_t> m_Temps;
+  // rows of m_LaneStride values for operands that aren't plain temps, and for results
+  vector<uint32_t> m_Scratch;
+  // 1 if the instruction can be executed with SIMD, 0 if not, -1 if not checked yet
+  vector<int8_t> m_SIMDInstruction;
+};
+
 };    // namespace ShaderDebug
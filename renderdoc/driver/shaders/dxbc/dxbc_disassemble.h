@@ -335,6 +335,15 @@ enum ResinfoRetType
   NUM_RETTYPES,
 };
 
+// flags in ASMOperation::syncFlags for OPCODE_SYNC
+enum SyncFlag
+{
+  SYNC_THREADS = 0x1,
+  SYNC_THREAD_GROUP_SHARED_MEMORY = 0x2,
+  SYNC_UAV_GROUP = 0x4,
+  SYNC_UAV_GLOBAL = 0x8,
+};
+
 enum ExtendedOpcodeType
 {
   EXTENDED_OPCODE_EMPTY = 0,
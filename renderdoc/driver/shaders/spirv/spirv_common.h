@@ -85,7 +85,9 @@ struct SPVModule
   vector<SPVInstruction *> structs;          // struct types
 
   SPVInstruction *GetByID(uint32_t id);
-  string Disassemble(const string &entryPoint);
+  // if instructionLines is given it's filled with the disassembly line of each instruction's
+  // statement, indexed like operations
+  string Disassemble(const string &entryPoint, vector<uint32_t> *instructionLines = NULL);
 
   void MakeReflection(ShaderStage stage, const string &entryPoint, ShaderReflection *reflection,
                       ShaderBindpointMapping *mapping);
@@ -0,0 +1,2252 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015-2017 Baldur Karlsson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+#include "spirv_debug.h"
+#include <math.h>
+#include <cmath>
+#include "3rdparty/glslang/SPIRV/GLSL.std.450.h"
+#include "maths/half_convert.h"
+
+namespace
+{
+inline float F(uint32_t u)
+{
+  float f;
+  memcpy(&f, &u, sizeof(f));
+  return f;
+}
+
+inline uint32_t U(float f)
+{
+  uint32_t u;
+  memcpy(&u, &f, sizeof(u));
+  return u;
+}
+
+inline int32_t S(uint32_t u)
+{
+  return (int32_t)u;
+}
+
+string ReadString(const uint32_t *words, uint32_t numWords)
+{
+  const char *str = (const char *)words;
+  size_t len = 0;
+  while(len < numWords * sizeof(uint32_t) && str[len])
+    len++;
+  return string(str, str + len);
+}
+
+bool HasResult(spv::Op opcode)
+{
+  switch(opcode)
+  {
+    case spv::OpNop:
+    case spv::OpStore:
+    case spv::OpCopyMemory:
+    case spv::OpCopyMemorySized:
+    case spv::OpBranch:
+    case spv::OpBranchConditional:
+    case spv::OpSwitch:
+    case spv::OpReturn:
+    case spv::OpReturnValue:
+    case spv::OpKill:
+    case spv::OpUnreachable:
+    case spv::OpSelectionMerge:
+    case spv::OpLoopMerge:
+    case spv::OpControlBarrier:
+    case spv::OpMemoryBarrier:
+    case spv::OpImageWrite:
+    case spv::OpEmitVertex:
+    case spv::OpEndPrimitive:
+    case spv::OpEmitStreamVertex:
+    case spv::OpEndStreamPrimitive:
+    case spv::OpAtomicStore:
+    case spv::OpLifetimeStart:
+    case spv::OpLifetimeStop:
+    case spv::OpLine:
+    case spv::OpNoLine: return false;
+    default: break;
+  }
+
+  return true;
+}
+
+// ops that only give structure and don't do anything when executed. These are stepped over along
+// with the preceding op so that they don't each get a state in the trace
+bool IsStructural(uint16_t opcode)
+{
+  switch(opcode)
+  {
+    case spv::OpLabel:
+    case spv::OpSelectionMerge:
+    case spv::OpLoopMerge:
+    case spv::OpFunction:
+    case spv::OpVariable:
+    case spv::OpNop: return true;
+    default: break;
+  }
+
+  return false;
+}
+
+bool IsImageOp(uint16_t opcode)
+{
+  switch(opcode)
+  {
+    case spv::OpImageSampleImplicitLod:
+    case spv::OpImageSampleExplicitLod:
+    case spv::OpImageSampleDrefImplicitLod:
+    case spv::OpImageSampleDrefExplicitLod:
+    case spv::OpImageSampleProjImplicitLod:
+    case spv::OpImageSampleProjExplicitLod:
+    case spv::OpImageSampleProjDrefImplicitLod:
+    case spv::OpImageSampleProjDrefExplicitLod:
+    case spv::OpImageFetch:
+    case spv::OpImageGather:
+    case spv::OpImageDrefGather:
+    case spv::OpImageRead:
+    case spv::OpImageWrite:
+    case spv::OpImageQueryFormat:
+    case spv::OpImageQueryOrder:
+    case spv::OpImageQuerySizeLod:
+    case spv::OpImageQuerySize:
+    case spv::OpImageQueryLod:
+    case spv::OpImageQueryLevels:
+    case spv::OpImageQuerySamples:
+    case spv::OpImageTexelPointer: return true;
+    default: break;
+  }
+
+  return false;
+}
+
+// Gaussian elimination with partial pivoting for the GLSL determinant and inverse functions.
+// Matrices are square and at most 4x4, the layout doesn't matter as det(M) == det(transpose(M))
+// and inverse(transpose(M)) == transpose(inverse(M))
+float Determinant(const uint32_t *m, uint32_t dim)
+{
+  float a[16];
+  for(uint32_t i = 0; i < dim * dim; i++)
+    a[i] = F(m[i]);
+
+  float det = 1.0f;
+  for(uint32_t c = 0; c < dim; c++)
+  {
+    uint32_t pivot = c;
+    for(uint32_t r = c + 1; r < dim; r++)
+      if(fabsf(a[r * dim + c]) > fabsf(a[pivot * dim + c]))
+        pivot = r;
+
+    if(a[pivot * dim + c] == 0.0f)
+      return 0.0f;
+
+    if(pivot != c)
+    {
+      for(uint32_t k = 0; k < dim; k++)
+        std::swap(a[pivot * dim + k], a[c * dim + k]);
+      det = -det;
+    }
+
+    det *= a[c * dim + c];
+
+    for(uint32_t r = c + 1; r < dim; r++)
+    {
+      float f = a[r * dim + c] / a[c * dim + c];
+      for(uint32_t k = c; k < dim; k++)
+        a[r * dim + k] -= f * a[c * dim + k];
+    }
+  }
+
+  return det;
+}
+
+void Inverse(const uint32_t *m, uint32_t dim, uint32_t *out)
+{
+  float a[16], inv[16];
+  for(uint32_t i = 0; i < dim * dim; i++)
+  {
+    a[i] = F(m[i]);
+    inv[i] = (i / dim) == (i % dim) ? 1.0f : 0.0f;
+  }
+
+  for(uint32_t c = 0; c < dim; c++)
+  {
+    uint32_t pivot = c;
+    for(uint32_t r = c + 1; r < dim; r++)
+      if(fabsf(a[r * dim + c]) > fabsf(a[pivot * dim + c]))
+        pivot = r;
+
+    if(pivot != c)
+    {
+      for(uint32_t k = 0; k < dim; k++)
+      {
+        std::swap(a[pivot * dim + k], a[c * dim + k]);
+        std::swap(inv[pivot * dim + k], inv[c * dim + k]);
+      }
+    }
+
+    // singular matrices are undefined, this will give infs/NaNs like a naive implementation would
+    float p = a[c * dim + c];
+    for(uint32_t k = 0; k < dim; k++)
+    {
+      a[c * dim + k] /= p;
+      inv[c * dim + k] /= p;
+    }
+
+    for(uint32_t r = 0; r < dim; r++)
+    {
+      if(r == c)
+        continue;
+
+      float f = a[r * dim + c];
+      for(uint32_t k = 0; k < dim; k++)
+      {
+        a[r * dim + k] -= f * a[c * dim + k];
+        inv[r * dim + k] -= f * inv[c * dim + k];
+      }
+    }
+  }
+
+  for(uint32_t i = 0; i < dim * dim; i++)
+    out[i] = U(inv[i]);
+}
+
+uint32_t FindMSB(uint32_t v)
+{
+  if(v == 0)
+    return ~0U;
+
+  uint32_t ret = 31;
+  while((v & (1U << ret)) == 0)
+    ret--;
+  return ret;
+}
+
+uint32_t FindLSB(uint32_t v)
+{
+  if(v == 0)
+    return ~0U;
+
+  uint32_t ret = 0;
+  while((v & (1U << ret)) == 0)
+    ret++;
+  return ret;
+}
+
+uint32_t CountBits(uint32_t v)
+{
+  uint32_t ret = 0;
+  for(; v; v &= v - 1)
+    ret++;
+  return ret;
+}
+}
+
+namespace SPIRVDebug
+{
+Debugger::Debugger()
+{
+  m_IdBound = 0;
+  m_GLSLSet = 0;
+  m_EntryFunc = 0;
+  m_CurLabel = m_PrevLabel = 0;
+  m_Killed = false;
+  m_WarnedImage = false;
+}
+
+bool Debugger::Init(SPVModule &module, const string &entryPoint, string &error)
+{
+  const vector<uint32_t> &spirv = module.spirv;
+
+  // states report the line in the entry point's disassembly rather than the instruction index, so
+  // the viewers don't need the disassembly to be numbered
+  vector<uint32_t> instructionLines;
+  module.Disassemble(entryPoint, &instructionLines);
+
+  if(spirv.size() < 5 || spirv[0] != (uint32_t)spv::MagicNumber)
+  {
+    error = "Invalid SPIR-V module";
+    return false;
+  }
+
+  m_IdBound = spirv[3];
+
+  m_TypeIndex.assign(m_IdBound, ~0U);
+  m_IdType.assign(m_IdBound, ~0U);
+  m_RegOffset.assign(m_IdBound, ~0U);
+  m_LabelOp.assign(m_IdBound, ~0U);
+  m_FuncOp.assign(m_IdBound, ~0U);
+  m_VarIndex.assign(m_IdBound, ~0U);
+
+  uint32_t curFunc = 0;
+  uint32_t instruction = 0;
+
+  size_t it = 5;
+  while(it < spirv.size())
+  {
+    uint32_t count = spirv[it] >> spv::WordCountShift;
+    spv::Op opcode = spv::Op(spirv[it] & spv::OpCodeMask);
+
+    if(count == 0 || it + count > spirv.size())
+    {
+      error = "Malformed SPIR-V module";
+      return false;
+    }
+
+    const uint32_t *w = spirv.data() + it + 1;
+    uint32_t n = count - 1;
+
+    it += count;
+
+    size_t numOps = m_Ops.size();
+
+    switch(opcode)
+    {
+      case spv::OpExtInstImport:
+        if(ReadString(w + 1, n - 1) == "GLSL.std.450")
+          m_GLSLSet = w[0];
+        break;
+      case spv::OpEntryPoint:
+        if(ReadString(w + 2, n - 2) == entryPoint)
+          m_EntryFunc = w[1];
+        break;
+      case spv::OpName: m_Names[w[0]] = ReadString(w + 1, n - 1); break;
+      case spv::OpMemberName:
+      {
+        vector<string> &names = m_MemberNames[w[0]];
+        if(names.size() <= w[1])
+          names.resize(w[1] + 1);
+        names[w[1]] = ReadString(w + 2, n - 2);
+        break;
+      }
+      case spv::OpDecorate:
+      {
+        Decorations &d = m_Decorations[w[0]];
+        uint32_t val = n > 2 ? w[2] : 0;
+        switch(spv::Decoration(w[1]))
+        {
+          case spv::DecorationLocation: d.location = val; break;
+          case spv::DecorationDescriptorSet: d.set = val; break;
+          case spv::DecorationBinding: d.binding = val; break;
+          case spv::DecorationArrayStride: d.arrayStride = val; break;
+          case spv::DecorationSpecId: d.specId = val; break;
+          case spv::DecorationBuiltIn: d.builtin = spv::BuiltIn(val); break;
+          case spv::DecorationBlock: d.block = true; break;
+          case spv::DecorationBufferBlock: d.bufferBlock = true; break;
+          case spv::DecorationFlat: d.flat = true; break;
+          case spv::DecorationNoPerspective: d.noPerspective = true; break;
+          default: break;
+        }
+        break;
+      }
+      case spv::OpMemberDecorate:
+      {
+        Decorations &d = m_Decorations[w[0]];
+        uint32_t val = n > 3 ? w[3] : 0;
+        switch(spv::Decoration(w[2]))
+        {
+          case spv::DecorationOffset: d.memberOffset[w[1]] = val; break;
+          case spv::DecorationMatrixStride: d.memberMatrixStride[w[1]] = val; break;
+          case spv::DecorationRowMajor: d.memberRowMajor[w[1]] = true; break;
+          case spv::DecorationColMajor: d.memberRowMajor[w[1]] = false; break;
+          default: break;
+        }
+        break;
+      }
+      case spv::OpTypeVoid:
+      case spv::OpTypeBool:
+      case spv::OpTypeInt:
+      case spv::OpTypeFloat:
+      case spv::OpTypeVector:
+      case spv::OpTypeMatrix:
+      case spv::OpTypeImage:
+      case spv::OpTypeSampler:
+      case spv::OpTypeSampledImage:
+      case spv::OpTypeArray:
+      case spv::OpTypeRuntimeArray:
+      case spv::OpTypeStruct:
+      case spv::OpTypeOpaque:
+      case spv::OpTypePointer:
+      case spv::OpTypeFunction:
+      case spv::OpTypeEvent:
+      case spv::OpTypeDeviceEvent:
+      case spv::OpTypeReserveId:
+      case spv::OpTypeQueue:
+      case spv::OpTypePipe:
+        if(!DecodeType(opcode, w, n, error))
+          return false;
+        break;
+      case spv::OpConstant:
+      case spv::OpSpecConstant:
+        m_ConstLiterals[w[1]] = w[2];
+      // fall through
+      case spv::OpConstantTrue:
+      case spv::OpConstantFalse:
+      case spv::OpConstantComposite:
+      case spv::OpConstantNull:
+      case spv::OpSpecConstantTrue:
+      case spv::OpSpecConstantFalse:
+      case spv::OpSpecConstantComposite:
+      {
+        m_IdType[w[1]] = w[0];
+
+        std::map<uint32_t, Decorations>::iterator dec = m_Decorations.find(w[1]);
+        if(dec != m_Decorations.end() && dec->second.specId != ~0U)
+          m_SpecIds[w[1]] = dec->second.specId;
+
+        AddOp(m_ConstOps, opcode, w[0], w[1], w + 2, n - 2);
+        break;
+      }
+      case spv::OpSpecConstantOp:
+        // executed like the op it wraps
+        m_IdType[w[1]] = w[0];
+        AddOp(m_ConstOps, w[2], w[0], w[1], w + 3, n - 3);
+        break;
+      case spv::OpUndef: m_IdType[w[1]] = w[0]; break;
+      case spv::OpVariable:
+        m_IdType[w[1]] = w[0];
+        AddVariable(w[0], w[1], spv::StorageClass(w[2]), n > 3 ? w[3] : 0);
+
+        // function variables are initialised when they're declared, each time the function runs
+        if(curFunc != 0)
+          AddOp(m_Ops, opcode, w[0], w[1], w + 2, n - 2);
+        break;
+      case spv::OpFunction:
+        curFunc = w[1];
+        m_FuncOp[w[1]] = (uint32_t)m_Ops.size();
+        AddOp(m_Ops, opcode, w[0], 0, NULL, 0);
+        break;
+      case spv::OpFunctionParameter:
+        m_IdType[w[1]] = w[0];
+        m_FuncParams[curFunc].push_back(w[1]);
+        break;
+      case spv::OpFunctionEnd:
+        AddOp(m_Ops, opcode, 0, 0, NULL, 0);
+        curFunc = 0;
+        break;
+      case spv::OpLabel:
+        m_LabelOp[w[0]] = (uint32_t)m_Ops.size();
+        AddOp(m_Ops, opcode, 0, w[0], NULL, 0);
+        break;
+      case spv::OpLine:
+      case spv::OpNoLine:
+      case spv::OpNop: break;
+      default:
+      {
+        // anything else outside of a function is debug info or a mode we don't care about
+        if(curFunc == 0)
+          break;
+
+        if(HasResult(opcode))
+        {
+          m_IdType[w[1]] = w[0];
+          AddOp(m_Ops, opcode, w[0], w[1], w + 2, n - 2);
+        }
+        else
+        {
+          AddOp(m_Ops, opcode, 0, 0, w, n);
+        }
+        break;
+      }
+    }
+
+    if(m_Ops.size() > numOps)
+      m_Ops.back().instruction =
+          instruction < instructionLines.size() ? instructionLines[instruction] : 0;
+
+    instruction++;
+  }
+
+  if(m_EntryFunc == 0 || m_FuncOp[m_EntryFunc] == ~0U)
+  {
+    error = StringFormat::Fmt("Couldn't find entry point '%s'", entryPoint.c_str());
+    return false;
+  }
+
+  // give every ID with a value a fixed slot in the register file
+  uint32_t numRegWords = 0;
+  for(uint32_t id = 0; id < m_IdBound; id++)
+  {
+    uint32_t type = m_IdType[id];
+    if(type == ~0U || type >= m_IdBound || m_TypeIndex[type] == ~0U)
+      continue;
+
+    m_RegOffset[id] = numRegWords;
+    numRegWords += Type(type).numWords;
+  }
+
+  // pad so that IDs with no value can still safely point somewhere
+  m_Regs.resize(numRegWords + 1);
+
+  // every state shows the same set of registers. Unnamed results are left out since there are far
+  // too many to copy on each step, and they're normally temporaries folded into the disassembly
+  vector<bool> display(m_IdBound, false);
+
+  for(size_t i = 0; i < m_Vars.size(); i++)
+  {
+    const Variable &v = m_Vars[i];
+    if(v.buffer < 0 && Type(v.type).numWords > 0 &&
+       (v.storage == spv::StorageClassFunction || v.storage == spv::StorageClassPrivate ||
+        v.storage == spv::StorageClassWorkgroup))
+      display[v.id] = true;
+  }
+
+  for(size_t i = 0; i < m_Ops.size(); i++)
+  {
+    uint32_t id = m_Ops[i].result;
+    if(id != 0 && m_Ops[i].opcode != spv::OpVariable)
+      display[id] = true;
+  }
+
+  for(std::map<uint32_t, vector<uint32_t> >::iterator params = m_FuncParams.begin();
+      params != m_FuncParams.end(); ++params)
+    for(size_t i = 0; i < params->second.size(); i++)
+      display[params->second[i]] = true;
+
+  m_DisplayIndex.assign(m_IdBound, ~0U);
+
+  for(uint32_t id = 0; id < m_IdBound; id++)
+  {
+    if(!display[id] || m_RegOffset[id] == ~0U)
+      continue;
+
+    if(m_VarIndex[id] == ~0U)
+    {
+      std::map<uint32_t, string>::iterator name = m_Names.find(id);
+      TypeKind kind = Type(m_IdType[id]).kind;
+
+      if(name == m_Names.end() || name->second.empty() || kind == TypeKind::Pointer ||
+         kind == TypeKind::Opaque || Type(m_IdType[id]).numWords == 0)
+        continue;
+    }
+
+    m_DisplayIndex[id] = (uint32_t)m_DisplayRegs.size();
+    m_DisplayRegs.push_back(id);
+  }
+
+  // decoding info isn't needed any more, except names which are fetched lazily
+  m_Decorations.clear();
+  m_MemberNames.clear();
+  m_ConstLiterals.clear();
+
+  return true;
+}
+
+bool Debugger::DecodeType(spv::Op opcode, const uint32_t *w, uint32_t n, string &error)
+{
+  TypeInfo t;
+  t.kind = TypeKind::Void;
+  t.scalar = VarType::UInt;
+  t.elem = 0;
+  t.count = 1;
+  t.numWords = 0;
+  t.arrayStride = 0;
+  t.block = false;
+  t.storage = spv::StorageClassMax;
+
+  uint32_t id = w[0];
+
+  Decorations dec;
+  std::map<uint32_t, Decorations>::iterator it = m_Decorations.find(id);
+  if(it != m_Decorations.end())
+    dec = it->second;
+
+  switch(opcode)
+  {
+    case spv::OpTypeVoid: t.kind = TypeKind::Void; break;
+    case spv::OpTypeBool:
+      t.kind = TypeKind::Boolean;
+      t.numWords = 1;
+      break;
+    case spv::OpTypeInt:
+    case spv::OpTypeFloat:
+      if(w[1] != 32)
+      {
+        error = StringFormat::Fmt("%u-bit types are not supported", w[1]);
+        return false;
+      }
+      t.kind = TypeKind::Scalar;
+      if(opcode == spv::OpTypeFloat)
+        t.scalar = VarType::Float;
+      else
+        t.scalar = w[2] ? VarType::Int : VarType::UInt;
+      t.numWords = 1;
+      break;
+    case spv::OpTypeVector:
+    case spv::OpTypeMatrix:
+      t.kind = opcode == spv::OpTypeVector ? TypeKind::Vector : TypeKind::Matrix;
+      t.elem = w[1];
+      t.count = w[2];
+      t.scalar = Type(t.elem).scalar;
+      t.numWords = t.count * Type(t.elem).numWords;
+      break;
+    case spv::OpTypeImage:
+    case spv::OpTypeSampler:
+    case spv::OpTypeSampledImage:
+      t.kind = TypeKind::Opaque;
+      t.numWords = 1;
+      break;
+    case spv::OpTypeArray:
+    case spv::OpTypeRuntimeArray:
+      t.kind = opcode == spv::OpTypeArray ? TypeKind::Array : TypeKind::RuntimeArray;
+      t.elem = w[1];
+      t.count = opcode == spv::OpTypeArray ? m_ConstLiterals[w[2]] : 0;
+      t.scalar = Type(t.elem).scalar;
+      t.numWords = t.count * Type(t.elem).numWords;
+      t.arrayStride = dec.arrayStride;
+      break;
+    case spv::OpTypeStruct:
+    {
+      t.kind = TypeKind::Struct;
+      t.count = n - 1;
+      t.block = dec.block || dec.bufferBlock;
+
+      const vector<string> &names = m_MemberNames[id];
+
+      t.members.resize(n - 1);
+      for(uint32_t m = 0; m + 1 < n; m++)
+      {
+        TypeInfo::Member &mem = t.members[m];
+        mem.type = w[m + 1];
+        mem.wordOffset = t.numWords;
+        mem.byteOffset = dec.memberOffset[m];
+        mem.matrixStride = dec.memberMatrixStride[m];
+        mem.rowMajor = dec.memberRowMajor[m];
+        if(m < names.size() && !names[m].empty())
+          mem.name = names[m];
+        else
+          mem.name = StringFormat::Fmt("_child%u", m);
+
+        t.numWords += Type(mem.type).numWords;
+      }
+      break;
+    }
+    case spv::OpTypePointer:
+      t.kind = TypeKind::Pointer;
+      t.storage = spv::StorageClass(w[1]);
+      t.elem = w[2];
+      t.numWords = PtrWords;
+      break;
+    case spv::OpTypeFunction: t.kind = TypeKind::Function; break;
+    default: error = "Unsupported type in SPIR-V module"; return false;
+  }
+
+  m_TypeIndex[id] = (uint32_t)m_Types.size();
+  m_Types.push_back(t);
+
+  return true;
+}
+
+void Debugger::AddVariable(uint32_t type, uint32_t id, spv::StorageClass storage,
+                           uint32_t initializer)
+{
+  Variable v;
+  v.id = id;
+  v.type = PointeeType(type);
+  v.storage = storage;
+  v.dataOffset = 0;
+  v.buffer = v.input = v.output = -1;
+  v.initializer = initializer;
+
+  Decorations dec;
+  std::map<uint32_t, Decorations>::iterator it = m_Decorations.find(id);
+  if(it != m_Decorations.end())
+    dec = it->second;
+
+  InterfaceVariable info;
+  info.name = Name(id);
+  info.storage = storage;
+  info.builtin = dec.builtin;
+  info.location = dec.location;
+  info.set = dec.set;
+  info.binding = dec.binding;
+  info.arraySize = 1;
+  info.numWords = Type(v.type).numWords;
+  info.type = Type(v.type).scalar;
+  info.flat = dec.flat;
+  info.noPerspective = dec.noPerspective;
+
+  if(storage == spv::StorageClassUniform || storage == spv::StorageClassPushConstant)
+  {
+    Buffer b;
+    b.var = (uint32_t)m_Vars.size();
+    b.blockType = v.type;
+
+    if(Type(v.type).kind == TypeKind::Array)
+    {
+      info.arraySize = Type(v.type).count;
+      b.blockType = Type(v.type).elem;
+    }
+
+    b.data.resize(info.arraySize);
+    info.numWords = 0;
+
+    v.buffer = (int32_t)m_Buffers.size();
+    m_Buffers.push_back(b);
+    m_BufferInfo.push_back(info);
+  }
+  else if(storage != spv::StorageClassUniformConstant)
+  {
+    v.dataOffset = (uint32_t)m_VarData.size();
+    m_VarData.resize(m_VarData.size() + Type(v.type).numWords);
+
+    if(storage == spv::StorageClassInput)
+    {
+      // blocks of builtins like gl_PerVertex are flagged with the first member's builtin
+      if(info.builtin == spv::BuiltInMax && Type(v.type).kind == TypeKind::Struct)
+      {
+        info.type = Type(Type(v.type).members[0].type).scalar;
+      }
+
+      v.input = (int32_t)m_InputInfo.size();
+      m_InputInfo.push_back(info);
+      m_InputData.push_back(vector<uint32_t>());
+    }
+    else if(storage == spv::StorageClassOutput)
+    {
+      v.output = (int32_t)m_OutputVars.size();
+      m_OutputVars.push_back((uint32_t)m_Vars.size());
+    }
+  }
+
+  m_VarIndex[id] = (uint32_t)m_Vars.size();
+  m_Vars.push_back(v);
+}
+
+void Debugger::AddOp(vector<Op> &ops, uint32_t opcode, uint32_t resultType, uint32_t result,
+                     const uint32_t *args, uint32_t numArgs)
+{
+  Op op;
+  op.opcode = (uint16_t)opcode;
+  op.numArgs = (uint16_t)numArgs;
+  op.resultType = resultType;
+  op.result = result;
+  op.args = (uint32_t)m_Args.size();
+  op.instruction = 0;
+
+  m_Args.insert(m_Args.end(), args, args + numArgs);
+
+  ops.push_back(op);
+}
+
+void Debugger::SetInput(size_t idx, const uint32_t *data, size_t numWords)
+{
+  if(idx < m_InputData.size())
+    m_InputData[idx].assign(data, data + numWords);
+}
+
+void Debugger::SetBufferData(size_t idx, uint32_t arrayIdx, const vector<byte> &data)
+{
+  if(idx < m_Buffers.size() && arrayIdx < m_Buffers[idx].data.size())
+    m_Buffers[idx].data[arrayIdx] = data;
+}
+
+void Debugger::SetSpecConstant(uint32_t specId, const byte *data, size_t size)
+{
+  vector<uint32_t> &val = m_SpecValues[specId];
+  val.resize((size + 3) / 4);
+  if(size > 0)
+    memcpy(&val[0], data, size);
+}
+
+void Debugger::GetBufferVariables(size_t idx, rdctype::array<ShaderVariable> &vars)
+{
+  if(idx >= m_Buffers.size() || m_Buffers[idx].data.empty())
+    return;
+
+  const Buffer &b = m_Buffers[idx];
+  const TypeInfo &t = Type(b.blockType);
+
+  vector<uint32_t> words(t.numWords + 1);
+  LoadMemory(b.blockType, b.data[0], 0, 0, &words[0]);
+
+  vector<ShaderVariable> members;
+  for(size_t m = 0; m < t.members.size(); m++)
+  {
+    // runtime arrays have no fixed size to display
+    if(Type(t.members[m].type).kind == TypeKind::RuntimeArray)
+      continue;
+
+    members.push_back(ShaderVariable());
+    MakeVariable(members.back(), t.members[m].name, t.members[m].type,
+                 &words[t.members[m].wordOffset]);
+  }
+
+  vars = members;
+}
+
+uint32_t Debugger::NumComps(uint32_t typeId) const
+{
+  const TypeInfo &t = Type(typeId);
+  return t.kind == TypeKind::Vector ? t.count : t.numWords;
+}
+
+uint32_t Debugger::MatrixRows(uint32_t typeId) const
+{
+  return Type(Type(typeId).elem).count;
+}
+
+const string &Debugger::Name(uint32_t id)
+{
+  if(m_DisplayNames.size() < m_IdBound)
+    m_DisplayNames.resize(m_IdBound);
+
+  string &name = m_DisplayNames[id];
+  if(name.empty())
+  {
+    std::map<uint32_t, string>::iterator it = m_Names.find(id);
+    if(it != m_Names.end() && !it->second.empty())
+      name = it->second;
+    else
+      name = StringFormat::Fmt("_%u", id);
+  }
+
+  return name;
+}
+
+void Debugger::LoadMemory(uint32_t type, const vector<byte> &mem, size_t offs, uint32_t matLayout,
+                          uint32_t *out)
+{
+  const TypeInfo &t = Type(type);
+
+  uint32_t stride = matLayout & ~RowMajorBit;
+  bool rowMajor = (matLayout & RowMajorBit) != 0;
+
+  switch(t.kind)
+  {
+    case TypeKind::Boolean:
+    case TypeKind::Scalar:
+    case TypeKind::Opaque:
+      out[0] = 0;
+      if(offs + sizeof(uint32_t) <= mem.size())
+        memcpy(out, &mem[offs], sizeof(uint32_t));
+      break;
+    case TypeKind::Vector:
+      // a column of a row major matrix has its components a row apart
+      for(uint32_t i = 0; i < t.count; i++)
+        LoadMemory(t.elem, mem, offs + i * (rowMajor ? stride : 4), 0, out + i);
+      break;
+    case TypeKind::Matrix:
+    {
+      uint32_t rows = MatrixRows(type);
+      if(stride == 0)
+        stride = 16;
+      for(uint32_t c = 0; c < t.count; c++)
+        for(uint32_t r = 0; r < rows; r++)
+          LoadMemory(Type(t.elem).elem, mem,
+                     offs + (rowMajor ? r * stride + c * 4 : c * stride + r * 4), 0,
+                     out + c * rows + r);
+      break;
+    }
+    case TypeKind::Array:
+    {
+      uint32_t elemWords = Type(t.elem).numWords;
+      for(uint32_t i = 0; i < t.count; i++)
+        LoadMemory(t.elem, mem, offs + i * t.arrayStride, matLayout, out + i * elemWords);
+      break;
+    }
+    case TypeKind::Struct:
+      for(size_t m = 0; m < t.members.size(); m++)
+      {
+        const TypeInfo::Member &member = t.members[m];
+        LoadMemory(member.type, mem, offs + member.byteOffset,
+                   member.matrixStride | (member.rowMajor ? RowMajorBit : 0),
+                   out + member.wordOffset);
+      }
+      break;
+    default: break;
+  }
+}
+
+void Debugger::StoreMemory(uint32_t type, vector<byte> &mem, size_t offs, uint32_t matLayout,
+                           const uint32_t *in)
+{
+  const TypeInfo &t = Type(type);
+
+  uint32_t stride = matLayout & ~RowMajorBit;
+  bool rowMajor = (matLayout & RowMajorBit) != 0;
+
+  switch(t.kind)
+  {
+    case TypeKind::Boolean:
+    case TypeKind::Scalar:
+    case TypeKind::Opaque:
+      if(offs + sizeof(uint32_t) <= mem.size())
+        memcpy(&mem[offs], in, sizeof(uint32_t));
+      break;
+    case TypeKind::Vector:
+      for(uint32_t i = 0; i < t.count; i++)
+        StoreMemory(t.elem, mem, offs + i * (rowMajor ? stride : 4), 0, in + i);
+      break;
+    case TypeKind::Matrix:
+    {
+      uint32_t rows = MatrixRows(type);
+      if(stride == 0)
+        stride = 16;
+      for(uint32_t c = 0; c < t.count; c++)
+        for(uint32_t r = 0; r < rows; r++)
+          StoreMemory(Type(t.elem).elem, mem,
+                      offs + (rowMajor ? r * stride + c * 4 : c * stride + r * 4), 0,
+                      in + c * rows + r);
+      break;
+    }
+    case TypeKind::Array:
+    {
+      uint32_t elemWords = Type(t.elem).numWords;
+      for(uint32_t i = 0; i < t.count; i++)
+        StoreMemory(t.elem, mem, offs + i * t.arrayStride, matLayout, in + i * elemWords);
+      break;
+    }
+    case TypeKind::Struct:
+      for(size_t m = 0; m < t.members.size(); m++)
+      {
+        const TypeInfo::Member &member = t.members[m];
+        StoreMemory(member.type, mem, offs + member.byteOffset,
+                    member.matrixStride | (member.rowMajor ? RowMajorBit : 0),
+                    in + member.wordOffset);
+      }
+      break;
+    default: break;
+  }
+}
+
+void Debugger::Load(const uint32_t *ptr, uint32_t type, uint32_t *out)
+{
+  const Variable &v = m_Vars[ptr[PtrVar]];
+  uint32_t numWords = Type(type).numWords;
+
+  if(v.buffer >= 0)
+  {
+    const Buffer &b = m_Buffers[v.buffer];
+    if(ptr[PtrArrayIdx] < b.data.size())
+    {
+      LoadMemory(type, b.data[ptr[PtrArrayIdx]], ptr[PtrOffset], ptr[PtrMatLayout], out);
+      return;
+    }
+  }
+  else if(v.storage != spv::StorageClassUniformConstant)
+  {
+    size_t offs = v.dataOffset + ptr[PtrOffset];
+    if(offs + numWords <= m_VarData.size())
+    {
+      memcpy(out, &m_VarData[offs], numWords * sizeof(uint32_t));
+      return;
+    }
+  }
+
+  memset(out, 0, numWords * sizeof(uint32_t));
+}
+
+void Debugger::Store(const uint32_t *ptr, uint32_t type, const uint32_t *in)
+{
+  const Variable &v = m_Vars[ptr[PtrVar]];
+  uint32_t numWords = Type(type).numWords;
+
+  if(v.buffer >= 0)
+  {
+    Buffer &b = m_Buffers[v.buffer];
+    if(ptr[PtrArrayIdx] < b.data.size())
+      StoreMemory(type, b.data[ptr[PtrArrayIdx]], ptr[PtrOffset], ptr[PtrMatLayout], in);
+  }
+  else if(v.storage != spv::StorageClassUniformConstant)
+  {
+    size_t offs = v.dataOffset + ptr[PtrOffset];
+    if(offs + numWords <= m_VarData.size())
+      memcpy(&m_VarData[offs], in, numWords * sizeof(uint32_t));
+  }
+}
+
+void Debugger::AccessChain(const Op &op)
+{
+  const uint32_t *args = &m_Args[op.args];
+  uint32_t *res = Reg(op.result);
+
+  memcpy(res, Reg(args[0]), PtrWords * sizeof(uint32_t));
+
+  const Variable &v = m_Vars[res[PtrVar]];
+  bool memory = v.buffer >= 0;
+
+  uint32_t type = PointeeType(m_IdType[args[0]]);
+  uint32_t i = 1;
+
+  // the first index into an array of blocks selects which descriptor to use
+  if(memory && type == v.type && type != m_Buffers[v.buffer].blockType && op.numArgs > 1)
+  {
+    res[PtrArrayIdx] = Reg(args[1])[0];
+    type = Type(type).elem;
+    i = 2;
+  }
+
+  for(; i < op.numArgs; i++)
+  {
+    uint32_t idx = Reg(args[i])[0];
+    const TypeInfo &t = Type(type);
+
+    uint32_t stride = res[PtrMatLayout] & ~RowMajorBit;
+    bool rowMajor = (res[PtrMatLayout] & RowMajorBit) != 0;
+
+    switch(t.kind)
+    {
+      case TypeKind::Struct:
+      {
+        if(idx >= t.members.size())
+          idx = 0;
+        const TypeInfo::Member &mem = t.members[idx];
+        if(memory)
+        {
+          res[PtrOffset] += mem.byteOffset;
+          res[PtrMatLayout] = mem.matrixStride | (mem.rowMajor ? RowMajorBit : 0);
+        }
+        else
+        {
+          res[PtrOffset] += mem.wordOffset;
+        }
+        type = mem.type;
+        break;
+      }
+      case TypeKind::Array:
+      case TypeKind::RuntimeArray:
+        res[PtrOffset] += idx * (memory ? t.arrayStride : Type(t.elem).numWords);
+        type = t.elem;
+        break;
+      case TypeKind::Matrix:
+        if(memory)
+        {
+          if(stride == 0)
+            stride = 16;
+
+          // columns of row major matrices stay strided, column major columns are contiguous
+          if(rowMajor)
+          {
+            res[PtrOffset] += idx * 4;
+          }
+          else
+          {
+            res[PtrOffset] += idx * stride;
+            res[PtrMatLayout] = 0;
+          }
+        }
+        else
+        {
+          res[PtrOffset] += idx * Type(t.elem).numWords;
+        }
+        type = t.elem;
+        break;
+      case TypeKind::Vector:
+        if(memory)
+          res[PtrOffset] += idx * (rowMajor ? stride : 4);
+        else
+          res[PtrOffset] += idx;
+        res[PtrMatLayout] = 0;
+        type = t.elem;
+        break;
+      default: RDCERR("Invalid access chain into non-composite type"); return;
+    }
+  }
+}
+
+void Debugger::MakeVariable(ShaderVariable &var, const string &name, uint32_t type,
+                            const uint32_t *words)
+{
+  const TypeInfo &t = Type(type);
+
+  var.name = name;
+  var.type = t.scalar == VarType::Float ? VarType::Float : t.scalar;
+  var.rows = var.columns = 0;
+
+  switch(t.kind)
+  {
+    case TypeKind::Boolean:
+    case TypeKind::Scalar:
+    case TypeKind::Opaque:
+      var.rows = var.columns = 1;
+      var.value.uv[0] = words[0];
+      break;
+    case TypeKind::Vector:
+      var.rows = 1;
+      var.columns = RDCMIN(t.count, 16U);
+      memcpy(var.value.uv, words, var.columns * sizeof(uint32_t));
+      break;
+    case TypeKind::Matrix:
+    {
+      // registers are column major, ShaderVariable is row major
+      uint32_t rows = MatrixRows(type);
+      var.rows = rows;
+      var.columns = t.count;
+      for(uint32_t c = 0; c < t.count; c++)
+        for(uint32_t r = 0; r < rows; r++)
+          if(r * t.count + c < 16)
+            var.value.uv[r * t.count + c] = words[c * rows + r];
+      break;
+    }
+    case TypeKind::Array:
+    {
+      vector<ShaderVariable> members(t.count);
+      uint32_t elemWords = Type(t.elem).numWords;
+      for(uint32_t i = 0; i < t.count; i++)
+        MakeVariable(members[i], StringFormat::Fmt("%s[%u]", name.c_str(), i), t.elem,
+                     words + i * elemWords);
+      var.members = members;
+      break;
+    }
+    case TypeKind::Struct:
+    {
+      var.isStruct = true;
+      vector<ShaderVariable> members(t.members.size());
+      for(size_t m = 0; m < t.members.size(); m++)
+        MakeVariable(members[m], t.members[m].name, t.members[m].type,
+                     words + t.members[m].wordOffset);
+      var.members = members;
+      break;
+    }
+    default: break;
+  }
+}
+
+void Debugger::UpdateRegister(uint32_t id)
+{
+  uint32_t idx = m_DisplayIndex[id];
+
+  // nothing is displayed while the constants are set up
+  if(idx >= m_RegisterFile.size())
+    return;
+
+  if(m_VarIndex[id] != ~0U)
+  {
+    const Variable &v = m_Vars[m_VarIndex[id]];
+    MakeVariable(m_RegisterFile[idx], Name(id), v.type, &m_VarData[v.dataOffset]);
+  }
+  else
+  {
+    MakeVariable(m_RegisterFile[idx], Name(id), m_IdType[id], Reg(id));
+  }
+}
+
+void Debugger::RecordStore(const uint32_t *ptr)
+{
+  const Variable &v = m_Vars[ptr[PtrVar]];
+
+  if(v.buffer >= 0 || v.storage == spv::StorageClassUniformConstant)
+    return;
+
+  UpdateRegister(v.id);
+
+  if(v.output >= 0 && (size_t)v.output < m_OutputFile.size())
+    MakeVariable(m_OutputFile[v.output], Name(v.id), v.type, &m_VarData[v.dataOffset]);
+}
+
+void Debugger::ExecuteConstants()
+{
+  ShaderDebugState dummy;
+
+  for(size_t i = 0; i < m_ConstOps.size(); i++)
+  {
+    const Op &op = m_ConstOps[i];
+    const uint32_t *args = &m_Args[op.args];
+    uint32_t *res = Reg(op.result);
+
+    std::map<uint32_t, uint32_t>::iterator specId = m_SpecIds.find(op.result);
+    const vector<uint32_t> *spec = NULL;
+    if(specId != m_SpecIds.end() && m_SpecValues.find(specId->second) != m_SpecValues.end())
+      spec = &m_SpecValues[specId->second];
+
+    switch(op.opcode)
+    {
+      case spv::OpConstantTrue: res[0] = 1; break;
+      case spv::OpConstantFalse:
+      case spv::OpConstantNull:
+        memset(res, 0, Type(op.resultType).numWords * sizeof(uint32_t));
+        break;
+      case spv::OpSpecConstantTrue:
+      case spv::OpSpecConstantFalse:
+        res[0] = spec && !spec->empty() ? (spec->at(0) != 0) : op.opcode == spv::OpSpecConstantTrue;
+        break;
+      case spv::OpConstant:
+      case spv::OpSpecConstant:
+        res[0] = spec && !spec->empty() ? spec->at(0) : args[0];
+        break;
+      case spv::OpConstantComposite:
+      case spv::OpSpecConstantComposite:
+      {
+        uint32_t offs = 0;
+        for(uint16_t a = 0; a < op.numArgs; a++)
+        {
+          uint32_t words = Type(m_IdType[args[a]]).numWords;
+          memcpy(res + offs, Reg(args[a]), words * sizeof(uint32_t));
+          offs += words;
+        }
+        break;
+      }
+      default:
+        // OpSpecConstantOp
+        Execute(op, ~0U, dummy);
+        break;
+    }
+  }
+}
+
+ShaderDebugTrace Debugger::Run(uint32_t maxSteps)
+{
+  ShaderDebugTrace trace;
+
+  memset(&m_Regs[0], 0, m_Regs.size() * sizeof(uint32_t));
+
+  m_RegisterFile.clear();
+  m_OutputFile.clear();
+
+  for(size_t i = 0; i < m_Vars.size(); i++)
+  {
+    uint32_t *ptr = Reg(m_Vars[i].id);
+    ptr[PtrVar] = (uint32_t)i;
+  }
+
+  ExecuteConstants();
+
+  memset(&m_VarData[0], 0, m_VarData.size() * sizeof(uint32_t));
+
+  vector<ShaderVariable> inputs;
+
+  for(size_t i = 0; i < m_Vars.size(); i++)
+  {
+    const Variable &v = m_Vars[i];
+    if(v.input >= 0)
+    {
+      const vector<uint32_t> &data = m_InputData[v.input];
+      uint32_t numWords = RDCMIN(Type(v.type).numWords, (uint32_t)data.size());
+      if(numWords > 0)
+        memcpy(&m_VarData[v.dataOffset], &data[0], numWords * sizeof(uint32_t));
+
+      inputs.push_back(ShaderVariable());
+      MakeVariable(inputs.back(), Name(v.id), v.type, &m_VarData[v.dataOffset]);
+    }
+    else if(v.initializer && v.buffer < 0 && v.storage != spv::StorageClassUniformConstant &&
+            v.storage != spv::StorageClassFunction)
+    {
+      memcpy(&m_VarData[v.dataOffset], Reg(v.initializer),
+             Type(v.type).numWords * sizeof(uint32_t));
+    }
+  }
+
+  trace.inputs = inputs;
+
+  m_CallStack.clear();
+  m_CurLabel = m_PrevLabel = 0;
+  m_Killed = false;
+
+  vector<ShaderDebugState> states;
+
+  m_RegisterFile.resize(m_DisplayRegs.size());
+  for(size_t i = 0; i < m_DisplayRegs.size(); i++)
+    UpdateRegister(m_DisplayRegs[i]);
+
+  m_OutputFile.resize(m_OutputVars.size());
+  for(size_t o = 0; o < m_OutputVars.size(); o++)
+  {
+    const Variable &out = m_Vars[m_OutputVars[o]];
+    MakeVariable(m_OutputFile[o], Name(out.id), out.type, &m_VarData[out.dataOffset]);
+  }
+
+  uint32_t pc = m_FuncOp[m_EntryFunc];
+
+  // the function and variable declarations at the start run in the first step, so point at the
+  // first op that does anything
+  {
+    uint32_t first = pc;
+    while(first < m_Ops.size() && IsStructural(m_Ops[first].opcode))
+      first++;
+
+    ShaderDebugState initial;
+    initial.nextInstruction = first < m_Ops.size() ? m_Ops[first].instruction : 0;
+    initial.flags = ShaderEvents::NoEvent;
+    initial.registers = m_RegisterFile;
+    initial.outputs = m_OutputFile;
+
+    states.push_back(initial);
+  }
+
+  uint32_t steps = 0;
+  while(pc < m_Ops.size())
+  {
+    if(steps >= maxSteps)
+    {
+      RDCWARN("Shader debugging stopped after %u steps", steps);
+      break;
+    }
+
+    ShaderDebugState state;
+    state.flags = ShaderEvents::NoEvent;
+
+    // the final state points one past the line of the last statement that was executed
+    state.nextInstruction = m_Ops[pc].instruction + 1;
+
+    pc = Execute(m_Ops[pc], pc, state);
+
+    while(pc < m_Ops.size() && IsStructural(m_Ops[pc].opcode))
+      pc = Execute(m_Ops[pc], pc, state);
+
+    if(pc < m_Ops.size())
+      state.nextInstruction = m_Ops[pc].instruction;
+
+    state.registers = m_RegisterFile;
+    state.outputs = m_OutputFile;
+    states.push_back(state);
+
+    steps++;
+  }
+
+  trace.states = states;
+
+  return trace;
+}
+
+#define UNARY_OP(opname, expr)       \
+  case spv::opname:                  \
+  {                                  \
+    const uint32_t *a = Reg(args[0]); \
+    for(uint32_t i = 0; i < n; i++)   \
+      res[i] = (expr);               \
+    break;                           \
+  }
+
+#define BINARY_OP(opname, expr)                           \
+  case spv::opname:                                       \
+  {                                                       \
+    const uint32_t *a = Reg(args[0]), *b = Reg(args[1]);   \
+    for(uint32_t i = 0; i < n; i++)                        \
+      res[i] = (expr);                                    \
+    break;                                                \
+  }
+
+uint32_t Debugger::Execute(const Op &op, uint32_t opIdx, ShaderDebugState &state)
+{
+  const uint32_t *args = op.numArgs > 0 ? &m_Args[op.args] : NULL;
+  uint32_t next = opIdx + 1;
+
+  uint32_t *res = NULL;
+  uint32_t n = 0;
+  if(op.result != 0 && m_RegOffset[op.result] != ~0U)
+  {
+    res = Reg(op.result);
+    n = NumComps(op.resultType);
+  }
+
+  // whether res should be recorded in the state
+  bool record = res != NULL;
+
+  switch(op.opcode)
+  {
+    //////////////////////////////////////////////////////////////////////////
+    // control flow
+
+    case spv::OpLabel:
+      m_PrevLabel = m_CurLabel;
+      m_CurLabel = op.result;
+      break;
+    case spv::OpSelectionMerge:
+    case spv::OpLoopMerge:
+    case spv::OpFunction:
+    case spv::OpNop:
+    case spv::OpControlBarrier:
+    case spv::OpMemoryBarrier: break;
+    case spv::OpBranch: next = m_LabelOp[args[0]]; break;
+    case spv::OpBranchConditional: next = m_LabelOp[Reg(args[0])[0] ? args[1] : args[2]]; break;
+    case spv::OpSwitch:
+    {
+      uint32_t sel = Reg(args[0])[0];
+      next = m_LabelOp[args[1]];
+      for(uint16_t i = 2; i + 1 < op.numArgs; i += 2)
+      {
+        if(args[i] == sel)
+        {
+          next = m_LabelOp[args[i + 1]];
+          break;
+        }
+      }
+      break;
+    }
+    case spv::OpPhi:
+    {
+      // all phis at the start of a block take effect at once, so evaluate them all before writing
+      // any results in case one phi reads another
+      uint32_t last = opIdx;
+      while(last + 1 < m_Ops.size() && m_Ops[last + 1].opcode == spv::OpPhi)
+        last++;
+
+      vector<uint32_t> values;
+      for(uint32_t p = opIdx; p <= last; p++)
+      {
+        const Op &phi = m_Ops[p];
+        const uint32_t *phiArgs = &m_Args[phi.args];
+        uint32_t numWords = Type(phi.resultType).numWords;
+        size_t offs = values.size();
+        values.resize(offs + numWords);
+
+        for(uint16_t i = 0; i + 1 < phi.numArgs; i += 2)
+        {
+          if(phiArgs[i + 1] == m_PrevLabel)
+          {
+            memcpy(&values[offs], Reg(phiArgs[i]), numWords * sizeof(uint32_t));
+            break;
+          }
+        }
+      }
+
+      size_t offs = 0;
+      for(uint32_t p = opIdx; p <= last; p++)
+      {
+        const Op &phi = m_Ops[p];
+        uint32_t numWords = Type(phi.resultType).numWords;
+        memcpy(Reg(phi.result), &values[offs], numWords * sizeof(uint32_t));
+        offs += numWords;
+
+        UpdateRegister(phi.result);
+      }
+
+      return last + 1;
+    }
+    case spv::OpFunctionCall:
+    {
+      uint32_t func = args[0];
+      const vector<uint32_t> &params = m_FuncParams[func];
+      for(size_t i = 0; i < params.size() && i + 1 < op.numArgs; i++)
+      {
+        memcpy(Reg(params[i]), Reg(args[i + 1]),
+               Type(m_IdType[params[i]]).numWords * sizeof(uint32_t));
+        UpdateRegister(params[i]);
+      }
+
+      Frame frame;
+      frame.returnOp = next;
+      frame.result = res ? op.result : 0;
+      frame.curLabel = m_CurLabel;
+      frame.prevLabel = m_PrevLabel;
+      m_CallStack.push_back(frame);
+
+      next = m_FuncOp[func];
+      record = false;
+      break;
+    }
+    case spv::OpReturn:
+    case spv::OpReturnValue:
+    case spv::OpFunctionEnd:
+    {
+      if(m_CallStack.empty())
+        return ~0U;
+
+      Frame frame = m_CallStack.back();
+      m_CallStack.pop_back();
+
+      if(op.opcode == spv::OpReturnValue && frame.result != 0)
+      {
+        uint32_t type = m_IdType[frame.result];
+        memcpy(Reg(frame.result), Reg(args[0]), Type(type).numWords * sizeof(uint32_t));
+        UpdateRegister(frame.result);
+      }
+
+      m_CurLabel = frame.curLabel;
+      m_PrevLabel = frame.prevLabel;
+      next = frame.returnOp;
+      break;
+    }
+    case spv::OpKill:
+      m_Killed = true;
+      return ~0U;
+    case spv::OpUnreachable: return ~0U;
+
+    //////////////////////////////////////////////////////////////////////////
+    // memory
+
+    case spv::OpVariable:
+    {
+      const Variable &v = m_Vars[m_VarIndex[op.result]];
+      uint32_t numWords = Type(v.type).numWords;
+      if(numWords > 0)
+      {
+        if(v.initializer)
+          memcpy(&m_VarData[v.dataOffset], Reg(v.initializer), numWords * sizeof(uint32_t));
+        else
+          memset(&m_VarData[v.dataOffset], 0, numWords * sizeof(uint32_t));
+      }
+      UpdateRegister(op.result);
+      record = false;
+      break;
+    }
+    case spv::OpLoad:
+      Load(Reg(args[0]), op.resultType, res);
+      break;
+    case spv::OpStore:
+      Store(Reg(args[0]), PointeeType(m_IdType[args[0]]), Reg(args[1]));
+      RecordStore(Reg(args[0]));
+      break;
+    case spv::OpCopyMemory:
+    {
+      uint32_t type = PointeeType(m_IdType[args[1]]);
+      vector<uint32_t> tmp(Type(type).numWords + 1);
+      Load(Reg(args[1]), type, &tmp[0]);
+      Store(Reg(args[0]), type, &tmp[0]);
+      RecordStore(Reg(args[0]));
+      break;
+    }
+    case spv::OpAccessChain:
+    case spv::OpInBoundsAccessChain:
+      AccessChain(op);
+      record = false;
+      break;
+    case spv::OpArrayLength:
+    {
+      const uint32_t *ptr = Reg(args[0]);
+      const Variable &v = m_Vars[ptr[PtrVar]];
+      res[0] = 0;
+      if(v.buffer >= 0 && ptr[PtrArrayIdx] < m_Buffers[v.buffer].data.size())
+      {
+        const TypeInfo &t = Type(PointeeType(m_IdType[args[0]]));
+        const TypeInfo::Member &mem = t.members[args[1]];
+        size_t start = ptr[PtrOffset] + mem.byteOffset;
+        size_t size = m_Buffers[v.buffer].data[ptr[PtrArrayIdx]].size();
+        uint32_t stride = Type(mem.type).arrayStride;
+        if(size > start && stride > 0)
+          res[0] = uint32_t((size - start) / stride);
+      }
+      break;
+    }
+    case spv::OpAtomicLoad: Load(Reg(args[0]), op.resultType, res); break;
+    case spv::OpAtomicStore:
+      Store(Reg(args[0]), PointeeType(m_IdType[args[0]]), Reg(args[3]));
+      break;
+    case spv::OpAtomicExchange:
+    case spv::OpAtomicCompareExchange:
+    case spv::OpAtomicIIncrement:
+    case spv::OpAtomicIDecrement:
+    case spv::OpAtomicIAdd:
+    case spv::OpAtomicISub:
+    case spv::OpAtomicSMin:
+    case spv::OpAtomicUMin:
+    case spv::OpAtomicSMax:
+    case spv::OpAtomicUMax:
+    case spv::OpAtomicAnd:
+    case spv::OpAtomicOr:
+    case spv::OpAtomicXor:
+    {
+      // only one invocation runs, so atomics are plain read-modify-writes
+      const uint32_t *ptr = Reg(args[0]);
+      uint32_t orig = 0;
+      Load(ptr, op.resultType, &orig);
+
+      uint32_t val = op.numArgs > 3 ? Reg(args[3])[0] : 0;
+      uint32_t result = orig;
+
+      switch(op.opcode)
+      {
+        case spv::OpAtomicExchange: result = val; break;
+        case spv::OpAtomicCompareExchange:
+          if(orig == Reg(args[5])[0])
+            result = Reg(args[4])[0];
+          break;
+        case spv::OpAtomicIIncrement: result = orig + 1; break;
+        case spv::OpAtomicIDecrement: result = orig - 1; break;
+        case spv::OpAtomicIAdd: result = orig + val; break;
+        case spv::OpAtomicISub: result = orig - val; break;
+        case spv::OpAtomicSMin: result = (uint32_t)RDCMIN(S(orig), S(val)); break;
+        case spv::OpAtomicUMin: result = RDCMIN(orig, val); break;
+        case spv::OpAtomicSMax: result = (uint32_t)RDCMAX(S(orig), S(val)); break;
+        case spv::OpAtomicUMax: result = RDCMAX(orig, val); break;
+        case spv::OpAtomicAnd: result = orig & val; break;
+        case spv::OpAtomicOr: result = orig | val; break;
+        case spv::OpAtomicXor: result = orig ^ val; break;
+        default: break;
+      }
+
+      Store(ptr, op.resultType, &result);
+      res[0] = orig;
+      break;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    // composites
+
+    case spv::OpCopyObject:
+    case spv::OpBitcast:
+    case spv::OpUConvert:
+    case spv::OpSConvert:
+    case spv::OpFConvert:
+    case spv::OpQuantizeToF16:
+      // only 32-bit types are supported so these are all copies
+      memcpy(res, Reg(args[0]), Type(op.resultType).numWords * sizeof(uint32_t));
+      if(op.opcode == spv::OpQuantizeToF16)
+        for(uint32_t i = 0; i < n; i++)
+          res[i] = U(ConvertFromHalf(ConvertToHalf(F(res[i]))));
+      break;
+    case spv::OpCompositeConstruct:
+    {
+      uint32_t offs = 0;
+      for(uint16_t a = 0; a < op.numArgs; a++)
+      {
+        uint32_t words = Type(m_IdType[args[a]]).numWords;
+        memcpy(res + offs, Reg(args[a]), words * sizeof(uint32_t));
+        offs += words;
+      }
+      break;
+    }
+    case spv::OpCompositeExtract:
+    case spv::OpCompositeInsert:
+    {
+      bool insert = op.opcode == spv::OpCompositeInsert;
+      uint32_t composite = insert ? args[1] : args[0];
+      uint32_t type = m_IdType[composite];
+      uint32_t offs = 0;
+      for(uint16_t i = insert ? 2 : 1; i < op.numArgs; i++)
+      {
+        const TypeInfo &t = Type(type);
+        if(t.kind == TypeKind::Struct)
+        {
+          offs += t.members[args[i]].wordOffset;
+          type = t.members[args[i]].type;
+        }
+        else
+        {
+          offs += args[i] * Type(t.elem).numWords;
+          type = t.elem;
+        }
+      }
+
+      if(insert)
+      {
+        memcpy(res, Reg(composite), Type(op.resultType).numWords * sizeof(uint32_t));
+        memcpy(res + offs, Reg(args[0]), Type(type).numWords * sizeof(uint32_t));
+      }
+      else
+      {
+        memcpy(res, Reg(composite) + offs, Type(type).numWords * sizeof(uint32_t));
+      }
+      break;
+    }
+    case spv::OpVectorExtractDynamic:
+    {
+      uint32_t idx = Reg(args[1])[0];
+      res[0] = idx < NumComps(m_IdType[args[0]]) ? Reg(args[0])[idx] : 0;
+      break;
+    }
+    case spv::OpVectorInsertDynamic:
+    {
+      uint32_t idx = Reg(args[2])[0];
+      memcpy(res, Reg(args[0]), n * sizeof(uint32_t));
+      if(idx < n)
+        res[idx] = Reg(args[1])[0];
+      break;
+    }
+    case spv::OpVectorShuffle:
+    {
+      const uint32_t *a = Reg(args[0]), *b = Reg(args[1]);
+      uint32_t na = NumComps(m_IdType[args[0]]);
+      uint32_t tmp[16] = {};
+      for(uint32_t i = 0; i < n && i + 2 < op.numArgs; i++)
+      {
+        uint32_t c = args[i + 2];
+        if(c != ~0U)
+          tmp[i] = c < na ? a[c] : b[c - na];
+      }
+      memcpy(res, tmp, n * sizeof(uint32_t));
+      break;
+    }
+    case spv::OpTranspose:
+    {
+      const uint32_t *m = Reg(args[0]);
+      uint32_t cols = Type(op.resultType).count, rows = MatrixRows(op.resultType);
+      // the input has rows columns of cols rows
+      for(uint32_t c = 0; c < cols; c++)
+        for(uint32_t r = 0; r < rows; r++)
+          res[c * rows + r] = m[r * cols + c];
+      break;
+    }
+    case spv::OpSelect:
+    {
+      const uint32_t *cond = Reg(args[0]), *a = Reg(args[1]), *b = Reg(args[2]);
+      bool scalarCond = NumComps(m_IdType[args[0]]) == 1;
+      uint32_t numWords = Type(op.resultType).numWords;
+      for(uint32_t i = 0; i < numWords; i++)
+        res[i] = cond[scalarCond ? 0 : i] ? a[i] : b[i];
+      break;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    // arithmetic
+
+    UNARY_OP(OpSNegate, uint32_t(-S(a[i])));
+    UNARY_OP(OpFNegate, U(-F(a[i])));
+    UNARY_OP(OpNot, ~a[i]);
+    UNARY_OP(OpLogicalNot, a[i] ? 0 : 1);
+    UNARY_OP(OpConvertFToU, uint32_t(F(a[i])));
+    UNARY_OP(OpConvertFToS, uint32_t(int32_t(F(a[i]))));
+    UNARY_OP(OpConvertSToF, U(float(S(a[i]))));
+    UNARY_OP(OpConvertUToF, U(float(a[i])));
+    UNARY_OP(OpIsNan, std::isnan(F(a[i])) ? 1 : 0);
+    UNARY_OP(OpIsInf, std::isfinite(F(a[i])) || std::isnan(F(a[i])) ? 0 : 1);
+    UNARY_OP(OpBitCount, CountBits(a[i]));
+
+    BINARY_OP(OpIAdd, a[i] + b[i]);
+    BINARY_OP(OpISub, a[i] - b[i]);
+    BINARY_OP(OpIMul, a[i] * b[i]);
+    BINARY_OP(OpUDiv, b[i] ? a[i] / b[i] : 0);
+    BINARY_OP(OpSDiv, b[i] && (S(a[i]) != INT32_MIN || S(b[i]) != -1) ? S(a[i]) / S(b[i]) : 0);
+    BINARY_OP(OpUMod, b[i] ? a[i] % b[i] : 0);
+    BINARY_OP(OpSRem, b[i] && S(b[i]) != -1 ? S(a[i]) % S(b[i]) : 0);
+    BINARY_OP(OpSMod, b[i] && S(b[i]) != -1
+                          ? uint32_t((S(a[i]) % S(b[i]) + S(b[i])) % S(b[i]))
+                          : 0);
+    BINARY_OP(OpFAdd, U(F(a[i]) + F(b[i])));
+    BINARY_OP(OpFSub, U(F(a[i]) - F(b[i])));
+    BINARY_OP(OpFMul, U(F(a[i]) * F(b[i])));
+    BINARY_OP(OpFDiv, U(F(a[i]) / F(b[i])));
+    BINARY_OP(OpFRem, U(fmodf(F(a[i]), F(b[i]))));
+    BINARY_OP(OpFMod, U(F(a[i]) - F(b[i]) * floorf(F(a[i]) / F(b[i]))));
+    BINARY_OP(OpShiftRightLogical, a[i] >> (b[i] & 31));
+    BINARY_OP(OpShiftRightArithmetic, uint32_t(S(a[i]) >> (b[i] & 31)));
+    BINARY_OP(OpShiftLeftLogical, a[i] << (b[i] & 31));
+    BINARY_OP(OpBitwiseOr, a[i] | b[i]);
+    BINARY_OP(OpBitwiseXor, a[i] ^ b[i]);
+    BINARY_OP(OpBitwiseAnd, a[i] & b[i]);
+    BINARY_OP(OpLogicalOr, (a[i] || b[i]) ? 1 : 0);
+    BINARY_OP(OpLogicalAnd, (a[i] && b[i]) ? 1 : 0);
+    BINARY_OP(OpLogicalEqual, (!a[i] == !b[i]) ? 1 : 0);
+    BINARY_OP(OpLogicalNotEqual, (!a[i] != !b[i]) ? 1 : 0);
+    BINARY_OP(OpIEqual, a[i] == b[i] ? 1 : 0);
+    BINARY_OP(OpINotEqual, a[i] != b[i] ? 1 : 0);
+    BINARY_OP(OpUGreaterThan, a[i] > b[i] ? 1 : 0);
+    BINARY_OP(OpSGreaterThan, S(a[i]) > S(b[i]) ? 1 : 0);
+    BINARY_OP(OpUGreaterThanEqual, a[i] >= b[i] ? 1 : 0);
+    BINARY_OP(OpSGreaterThanEqual, S(a[i]) >= S(b[i]) ? 1 : 0);
+    BINARY_OP(OpULessThan, a[i] < b[i] ? 1 : 0);
+    BINARY_OP(OpSLessThan, S(a[i]) < S(b[i]) ? 1 : 0);
+    BINARY_OP(OpULessThanEqual, a[i] <= b[i] ? 1 : 0);
+    BINARY_OP(OpSLessThanEqual, S(a[i]) <= S(b[i]) ? 1 : 0);
+    // ordered comparisons are false if either side is NaN, which is what C++ comparisons give.
+    // Unordered comparisons are the negation of the opposite ordered comparison
+    BINARY_OP(OpFOrdEqual, F(a[i]) == F(b[i]) ? 1 : 0);
+    BINARY_OP(OpFUnordEqual, !(F(a[i]) < F(b[i]) || F(a[i]) > F(b[i])) ? 1 : 0);
+    BINARY_OP(OpFOrdNotEqual, (F(a[i]) < F(b[i]) || F(a[i]) > F(b[i])) ? 1 : 0);
+    BINARY_OP(OpFUnordNotEqual, F(a[i]) != F(b[i]) ? 1 : 0);
+    BINARY_OP(OpFOrdLessThan, F(a[i]) < F(b[i]) ? 1 : 0);
+    BINARY_OP(OpFUnordLessThan, !(F(a[i]) >= F(b[i])) ? 1 : 0);
+    BINARY_OP(OpFOrdGreaterThan, F(a[i]) > F(b[i]) ? 1 : 0);
+    BINARY_OP(OpFUnordGreaterThan, !(F(a[i]) <= F(b[i])) ? 1 : 0);
+    BINARY_OP(OpFOrdLessThanEqual, F(a[i]) <= F(b[i]) ? 1 : 0);
+    BINARY_OP(OpFUnordLessThanEqual, !(F(a[i]) > F(b[i])) ? 1 : 0);
+    BINARY_OP(OpFOrdGreaterThanEqual, F(a[i]) >= F(b[i]) ? 1 : 0);
+    BINARY_OP(OpFUnordGreaterThanEqual, !(F(a[i]) < F(b[i])) ? 1 : 0);
+
+    case spv::OpBitReverse:
+    {
+      const uint32_t *a = Reg(args[0]);
+      for(uint32_t i = 0; i < n; i++)
+      {
+        uint32_t v = a[i], r = 0;
+        for(uint32_t b = 0; b < 32; b++)
+          r |= ((v >> b) & 1) << (31 - b);
+        res[i] = r;
+      }
+      break;
+    }
+    case spv::OpBitFieldInsert:
+    case spv::OpBitFieldSExtract:
+    case spv::OpBitFieldUExtract:
+    {
+      bool insert = op.opcode == spv::OpBitFieldInsert;
+      const uint32_t *base = Reg(args[0]);
+      uint32_t offset = Reg(args[insert ? 2 : 1])[0] & 31;
+      uint32_t count = RDCMIN(Reg(args[insert ? 3 : 2])[0], 32U - offset);
+      uint32_t mask = count == 32 ? ~0U : ((1U << count) - 1);
+
+      for(uint32_t i = 0; i < n; i++)
+      {
+        if(insert)
+        {
+          res[i] = (base[i] & ~(mask << offset)) | ((Reg(args[1])[i] & mask) << offset);
+        }
+        else
+        {
+          res[i] = (base[i] >> offset) & mask;
+          if(op.opcode == spv::OpBitFieldSExtract && count > 0 && count < 32 &&
+             (res[i] & (1U << (count - 1))))
+            res[i] |= ~mask;
+        }
+      }
+      break;
+    }
+    case spv::OpAny:
+    case spv::OpAll:
+    {
+      const uint32_t *a = Reg(args[0]);
+      uint32_t na = NumComps(m_IdType[args[0]]);
+      bool any = false, all = true;
+      for(uint32_t i = 0; i < na; i++)
+      {
+        any |= a[i] != 0;
+        all &= a[i] != 0;
+      }
+      res[0] = (op.opcode == spv::OpAny ? any : all) ? 1 : 0;
+      break;
+    }
+    case spv::OpDot:
+    {
+      const uint32_t *a = Reg(args[0]), *b = Reg(args[1]);
+      uint32_t na = NumComps(m_IdType[args[0]]);
+      float dot = 0.0f;
+      for(uint32_t i = 0; i < na; i++)
+        dot += F(a[i]) * F(b[i]);
+      res[0] = U(dot);
+      break;
+    }
+    case spv::OpVectorTimesScalar:
+    case spv::OpMatrixTimesScalar:
+    {
+      const uint32_t *a = Reg(args[0]);
+      float s = F(Reg(args[1])[0]);
+      uint32_t numWords = Type(op.resultType).numWords;
+      for(uint32_t i = 0; i < numWords; i++)
+        res[i] = U(F(a[i]) * s);
+      break;
+    }
+    case spv::OpMatrixTimesVector:
+    {
+      const uint32_t *m = Reg(args[0]), *v = Reg(args[1]);
+      uint32_t cols = Type(m_IdType[args[0]]).count, rows = n;
+      float tmp[4] = {};
+      for(uint32_t r = 0; r < rows && r < 4; r++)
+        for(uint32_t c = 0; c < cols; c++)
+          tmp[r] += F(m[c * rows + r]) * F(v[c]);
+      for(uint32_t r = 0; r < rows && r < 4; r++)
+        res[r] = U(tmp[r]);
+      break;
+    }
+    case spv::OpVectorTimesMatrix:
+    {
+      const uint32_t *v = Reg(args[0]), *m = Reg(args[1]);
+      uint32_t rows = MatrixRows(m_IdType[args[1]]), cols = n;
+      float tmp[4] = {};
+      for(uint32_t c = 0; c < cols && c < 4; c++)
+        for(uint32_t r = 0; r < rows; r++)
+          tmp[c] += F(v[r]) * F(m[c * rows + r]);
+      for(uint32_t c = 0; c < cols && c < 4; c++)
+        res[c] = U(tmp[c]);
+      break;
+    }
+    case spv::OpMatrixTimesMatrix:
+    {
+      const uint32_t *a = Reg(args[0]), *b = Reg(args[1]);
+      uint32_t rows = MatrixRows(op.resultType), cols = Type(op.resultType).count;
+      uint32_t inner = Type(m_IdType[args[0]]).count;
+      float tmp[16] = {};
+      for(uint32_t c = 0; c < cols; c++)
+        for(uint32_t r = 0; r < rows; r++)
+          for(uint32_t k = 0; k < inner; k++)
+            tmp[c * rows + r] += F(a[k * rows + r]) * F(b[c * inner + k]);
+      for(uint32_t i = 0; i < rows * cols && i < 16; i++)
+        res[i] = U(tmp[i]);
+      break;
+    }
+    case spv::OpOuterProduct:
+    {
+      const uint32_t *a = Reg(args[0]), *b = Reg(args[1]);
+      uint32_t rows = MatrixRows(op.resultType), cols = Type(op.resultType).count;
+      for(uint32_t c = 0; c < cols; c++)
+        for(uint32_t r = 0; r < rows; r++)
+          res[c * rows + r] = U(F(a[r]) * F(b[c]));
+      break;
+    }
+    case spv::OpDPdx:
+    case spv::OpDPdy:
+    case spv::OpFwidth:
+    case spv::OpDPdxFine:
+    case spv::OpDPdyFine:
+    case spv::OpFwidthFine:
+    case spv::OpDPdxCoarse:
+    case spv::OpDPdyCoarse:
+    case spv::OpFwidthCoarse:
+      // would need neighbouring invocations in the quad
+      memset(res, 0, n * sizeof(uint32_t));
+      break;
+    case spv::OpExtInst: ExecuteExtInst(op, state); break;
+    case spv::OpSampledImage:
+    case spv::OpImage:
+      // images are opaque handles with no data
+      res[0] = 0;
+      record = false;
+      break;
+    default:
+    {
+      if(IsImageOp(op.opcode))
+      {
+        if(!m_WarnedImage)
+        {
+          RDCWARN("Image operations are not supported when debugging SPIR-V, returning 0");
+          m_WarnedImage = true;
+        }
+
+        if(res)
+          memset(res, 0, Type(op.resultType).numWords * sizeof(uint32_t));
+
+        state.flags |= ShaderEvents::SampleLoadGather;
+        break;
+      }
+
+      RDCERR("Unsupported SPIR-V op %u, stopping debugging", op.opcode);
+      return ~0U;
+    }
+  }
+
+  if(record && Type(op.resultType).kind != TypeKind::Pointer &&
+     Type(op.resultType).kind != TypeKind::Opaque)
+  {
+    if(Type(op.resultType).scalar == VarType::Float && op.opcode != spv::OpLoad)
+    {
+      uint32_t numWords = Type(op.resultType).numWords;
+      for(uint32_t i = 0; i < numWords; i++)
+      {
+        float f = F(res[i]);
+        if(std::isnan(f) || !std::isfinite(f))
+        {
+          state.flags |= ShaderEvents::GeneratedNanOrInf;
+          break;
+        }
+      }
+    }
+
+    UpdateRegister(op.result);
+  }
+
+  return next;
+}
+
+void Debugger::ExecuteExtInst(const Op &op, ShaderDebugState &state)
+{
+  const uint32_t *args = &m_Args[op.args];
+  uint32_t *res = Reg(op.result);
+  uint32_t n = NumComps(op.resultType);
+
+  if(args[0] != m_GLSLSet)
+  {
+    RDCERR("Unsupported extended instruction set");
+    memset(res, 0, Type(op.resultType).numWords * sizeof(uint32_t));
+    return;
+  }
+
+  GLSLstd450 inst = GLSLstd450(args[1]);
+  args += 2;
+
+  const uint32_t *a = op.numArgs > 2 ? Reg(args[0]) : NULL;
+  const uint32_t *b = op.numArgs > 3 ? Reg(args[1]) : NULL;
+  const uint32_t *c = op.numArgs > 4 ? Reg(args[2]) : NULL;
+
+  // vector inputs to scalar results (length etc)
+  uint32_t na = op.numArgs > 2 ? NumComps(m_IdType[args[0]]) : 0;
+
+  uint32_t tmp[16] = {};
+
+#define FLOAT_FUNC(name, expr)        \
+  case name:                          \
+    for(uint32_t i = 0; i < n; i++)   \
+    {                                 \
+      float x = F(a[i]);              \
+      (void)x;                        \
+      tmp[i] = U(expr);               \
+    }                                 \
+    break;
+
+  switch(inst)
+  {
+    FLOAT_FUNC(GLSLstd450Round, roundf(x));
+    FLOAT_FUNC(GLSLstd450RoundEven, rintf(x));
+    FLOAT_FUNC(GLSLstd450Trunc, truncf(x));
+    FLOAT_FUNC(GLSLstd450FAbs, fabsf(x));
+    FLOAT_FUNC(GLSLstd450FSign, x > 0.0f ? 1.0f : (x < 0.0f ? -1.0f : 0.0f));
+    FLOAT_FUNC(GLSLstd450Floor, floorf(x));
+    FLOAT_FUNC(GLSLstd450Ceil, ceilf(x));
+    FLOAT_FUNC(GLSLstd450Fract, x - floorf(x));
+    FLOAT_FUNC(GLSLstd450Radians, x * 0.01745329251994329577f);
+    FLOAT_FUNC(GLSLstd450Degrees, x * 57.2957795130823208768f);
+    FLOAT_FUNC(GLSLstd450Sin, sinf(x));
+    FLOAT_FUNC(GLSLstd450Cos, cosf(x));
+    FLOAT_FUNC(GLSLstd450Tan, tanf(x));
+    FLOAT_FUNC(GLSLstd450Asin, asinf(x));
+    FLOAT_FUNC(GLSLstd450Acos, acosf(x));
+    FLOAT_FUNC(GLSLstd450Atan, atanf(x));
+    FLOAT_FUNC(GLSLstd450Sinh, sinhf(x));
+    FLOAT_FUNC(GLSLstd450Cosh, coshf(x));
+    FLOAT_FUNC(GLSLstd450Tanh, tanhf(x));
+    FLOAT_FUNC(GLSLstd450Asinh, asinhf(x));
+    FLOAT_FUNC(GLSLstd450Acosh, acoshf(x));
+    FLOAT_FUNC(GLSLstd450Atanh, atanhf(x));
+    FLOAT_FUNC(GLSLstd450Atan2, atan2f(x, F(b[i])));
+    FLOAT_FUNC(GLSLstd450Pow, powf(x, F(b[i])));
+    FLOAT_FUNC(GLSLstd450Exp, expf(x));
+    FLOAT_FUNC(GLSLstd450Log, logf(x));
+    FLOAT_FUNC(GLSLstd450Exp2, exp2f(x));
+    FLOAT_FUNC(GLSLstd450Log2, log2f(x));
+    FLOAT_FUNC(GLSLstd450Sqrt, sqrtf(x));
+    FLOAT_FUNC(GLSLstd450InverseSqrt, 1.0f / sqrtf(x));
+    FLOAT_FUNC(GLSLstd450FMin, F(b[i]) < x ? F(b[i]) : x);
+    FLOAT_FUNC(GLSLstd450FMax, x < F(b[i]) ? F(b[i]) : x);
+    FLOAT_FUNC(GLSLstd450NMin, fminf(x, F(b[i])));
+    FLOAT_FUNC(GLSLstd450NMax, fmaxf(x, F(b[i])));
+    FLOAT_FUNC(GLSLstd450FClamp, RDCMIN(RDCMAX(x, F(b[i])), F(c[i])));
+    FLOAT_FUNC(GLSLstd450NClamp, fminf(fmaxf(x, F(b[i])), F(c[i])));
+    FLOAT_FUNC(GLSLstd450FMix, x * (1.0f - F(c[i])) + F(b[i]) * F(c[i]));
+    FLOAT_FUNC(GLSLstd450Step, F(b[i]) < x ? 0.0f : 1.0f);
+    FLOAT_FUNC(GLSLstd450Fma, x * F(b[i]) + F(c[i]));
+    FLOAT_FUNC(GLSLstd450Ldexp, ldexpf(x, S(b[i])));
+
+    case GLSLstd450SmoothStep:
+      for(uint32_t i = 0; i < n; i++)
+      {
+        float t = (F(c[i]) - F(a[i])) / (F(b[i]) - F(a[i]));
+        t = RDCMIN(RDCMAX(t, 0.0f), 1.0f);
+        tmp[i] = U(t * t * (3.0f - 2.0f * t));
+      }
+      break;
+    case GLSLstd450SAbs:
+      for(uint32_t i = 0; i < n; i++)
+        tmp[i] = S(a[i]) < 0 ? uint32_t(-S(a[i])) : a[i];
+      break;
+    case GLSLstd450SSign:
+      for(uint32_t i = 0; i < n; i++)
+        tmp[i] = uint32_t(S(a[i]) > 0 ? 1 : (S(a[i]) < 0 ? -1 : 0));
+      break;
+    case GLSLstd450UMin:
+      for(uint32_t i = 0; i < n; i++)
+        tmp[i] = RDCMIN(a[i], b[i]);
+      break;
+    case GLSLstd450UMax:
+      for(uint32_t i = 0; i < n; i++)
+        tmp[i] = RDCMAX(a[i], b[i]);
+      break;
+    case GLSLstd450SMin:
+      for(uint32_t i = 0; i < n; i++)
+        tmp[i] = (uint32_t)RDCMIN(S(a[i]), S(b[i]));
+      break;
+    case GLSLstd450SMax:
+      for(uint32_t i = 0; i < n; i++)
+        tmp[i] = (uint32_t)RDCMAX(S(a[i]), S(b[i]));
+      break;
+    case GLSLstd450UClamp:
+      for(uint32_t i = 0; i < n; i++)
+        tmp[i] = RDCMIN(RDCMAX(a[i], b[i]), c[i]);
+      break;
+    case GLSLstd450SClamp:
+      for(uint32_t i = 0; i < n; i++)
+        tmp[i] = (uint32_t)RDCMIN(RDCMAX(S(a[i]), S(b[i])), S(c[i]));
+      break;
+    case GLSLstd450IMix:
+      for(uint32_t i = 0; i < n; i++)
+        tmp[i] = c[i] ? b[i] : a[i];
+      break;
+    case GLSLstd450Modf:
+    case GLSLstd450ModfStruct:
+    case GLSLstd450Frexp:
+    case GLSLstd450FrexpStruct:
+    {
+      bool isStruct = inst == GLSLstd450ModfStruct || inst == GLSLstd450FrexpStruct;
+      bool isModf = inst == GLSLstd450Modf || inst == GLSLstd450ModfStruct;
+      if(isStruct)
+        n = na;
+
+      uint32_t second[4] = {};
+      for(uint32_t i = 0; i < n && i < 4; i++)
+      {
+        if(isModf)
+        {
+          float whole = 0.0f;
+          tmp[i] = U(modff(F(a[i]), &whole));
+          second[i] = U(whole);
+        }
+        else
+        {
+          int e = 0;
+          tmp[i] = U(frexpf(F(a[i]), &e));
+          second[i] = uint32_t(e);
+        }
+      }
+
+      if(isStruct)
+      {
+        memcpy(tmp + n, second, n * sizeof(uint32_t));
+        n *= 2;
+      }
+      else
+      {
+        Store(b, PointeeType(m_IdType[args[1]]), second);
+        RecordStore(b);
+      }
+      break;
+    }
+    case GLSLstd450Determinant: tmp[0] = U(Determinant(a, Type(m_IdType[args[0]]).count)); break;
+    case GLSLstd450MatrixInverse:
+      n = Type(op.resultType).numWords;
+      Inverse(a, Type(op.resultType).count, tmp);
+      break;
+    case GLSLstd450PackSnorm4x8:
+    case GLSLstd450PackUnorm4x8:
+    {
+      bool snorm = inst == GLSLstd450PackSnorm4x8;
+      for(uint32_t i = 0; i < 4; i++)
+      {
+        float f = F(a[i]);
+        int32_t v = snorm ? (int32_t)roundf(RDCCLAMP(f, -1.0f, 1.0f) * 127.0f)
+                          : (int32_t)roundf(RDCCLAMP(f, 0.0f, 1.0f) * 255.0f);
+        tmp[0] |= (uint32_t(v) & 0xff) << (i * 8);
+      }
+      break;
+    }
+    case GLSLstd450PackSnorm2x16:
+    case GLSLstd450PackUnorm2x16:
+    case GLSLstd450PackHalf2x16:
+    {
+      for(uint32_t i = 0; i < 2; i++)
+      {
+        float f = F(a[i]);
+        uint32_t v = 0;
+        if(inst == GLSLstd450PackSnorm2x16)
+          v = uint32_t((int32_t)roundf(RDCCLAMP(f, -1.0f, 1.0f) * 32767.0f));
+        else if(inst == GLSLstd450PackUnorm2x16)
+          v = uint32_t((int32_t)roundf(RDCCLAMP(f, 0.0f, 1.0f) * 65535.0f));
+        else
+          v = ConvertToHalf(f);
+        tmp[0] |= (v & 0xffff) << (i * 16);
+      }
+      break;
+    }
+    case GLSLstd450UnpackSnorm4x8:
+    case GLSLstd450UnpackUnorm4x8:
+      for(uint32_t i = 0; i < 4; i++)
+      {
+        uint32_t v = (a[0] >> (i * 8)) & 0xff;
+        if(inst == GLSLstd450UnpackSnorm4x8)
+          tmp[i] = U(RDCCLAMP(float(int8_t(v)) / 127.0f, -1.0f, 1.0f));
+        else
+          tmp[i] = U(float(v) / 255.0f);
+      }
+      break;
+    case GLSLstd450UnpackSnorm2x16:
+    case GLSLstd450UnpackUnorm2x16:
+    case GLSLstd450UnpackHalf2x16:
+      for(uint32_t i = 0; i < 2; i++)
+      {
+        uint32_t v = (a[0] >> (i * 16)) & 0xffff;
+        if(inst == GLSLstd450UnpackSnorm2x16)
+          tmp[i] = U(RDCCLAMP(float(int16_t(v)) / 32767.0f, -1.0f, 1.0f));
+        else if(inst == GLSLstd450UnpackUnorm2x16)
+          tmp[i] = U(float(v) / 65535.0f);
+        else
+          tmp[i] = U(ConvertFromHalf(uint16_t(v)));
+      }
+      break;
+    case GLSLstd450Length:
+    case GLSLstd450Distance:
+    {
+      float len = 0.0f;
+      for(uint32_t i = 0; i < na; i++)
+      {
+        float d = inst == GLSLstd450Distance ? F(a[i]) - F(b[i]) : F(a[i]);
+        len += d * d;
+      }
+      tmp[0] = U(sqrtf(len));
+      break;
+    }
+    case GLSLstd450Normalize:
+    {
+      float len = 0.0f;
+      for(uint32_t i = 0; i < n; i++)
+        len += F(a[i]) * F(a[i]);
+      len = sqrtf(len);
+      for(uint32_t i = 0; i < n; i++)
+        tmp[i] = U(F(a[i]) / len);
+      break;
+    }
+    case GLSLstd450Cross:
+      tmp[0] = U(F(a[1]) * F(b[2]) - F(a[2]) * F(b[1]));
+      tmp[1] = U(F(a[2]) * F(b[0]) - F(a[0]) * F(b[2]));
+      tmp[2] = U(F(a[0]) * F(b[1]) - F(a[1]) * F(b[0]));
+      break;
+    case GLSLstd450FaceForward:
+    {
+      // N, I, Nref
+      float dot = 0.0f;
+      for(uint32_t i = 0; i < n; i++)
+        dot += F(c[i]) * F(b[i]);
+      for(uint32_t i = 0; i < n; i++)
+        tmp[i] = dot < 0.0f ? a[i] : U(-F(a[i]));
+      break;
+    }
+    case GLSLstd450Reflect:
+    case GLSLstd450Refract:
+    {
+      // I, N[, eta]
+      float dot = 0.0f;
+      for(uint32_t i = 0; i < n; i++)
+        dot += F(b[i]) * F(a[i]);
+
+      if(inst == GLSLstd450Reflect)
+      {
+        for(uint32_t i = 0; i < n; i++)
+          tmp[i] = U(F(a[i]) - 2.0f * dot * F(b[i]));
+      }
+      else
+      {
+        float eta = F(c[0]);
+        float k = 1.0f - eta * eta * (1.0f - dot * dot);
+        for(uint32_t i = 0; i < n; i++)
+          tmp[i] = k < 0.0f ? 0 : U(eta * F(a[i]) - (eta * dot + sqrtf(k)) * F(b[i]));
+      }
+      break;
+    }
+    case GLSLstd450FindILsb:
+      for(uint32_t i = 0; i < n; i++)
+        tmp[i] = FindLSB(a[i]);
+      break;
+    case GLSLstd450FindSMsb:
+      for(uint32_t i = 0; i < n; i++)
+        tmp[i] = FindMSB(S(a[i]) < 0 ? ~a[i] : a[i]);
+      break;
+    case GLSLstd450FindUMsb:
+      for(uint32_t i = 0; i < n; i++)
+        tmp[i] = FindMSB(a[i]);
+      break;
+    case GLSLstd450InterpolateAtCentroid:
+    case GLSLstd450InterpolateAtSample:
+    case GLSLstd450InterpolateAtOffset:
+      // inputs are only known at the pixel being debugged
+      Load(a, op.resultType, tmp);
+      break;
+    default:
+      RDCERR("Unsupported GLSL.std.450 instruction %u", inst);
+      n = 0;
+      break;
+  }
+
+#undef FLOAT_FUNC
+
+  memset(res, 0, Type(op.resultType).numWords * sizeof(uint32_t));
+  memcpy(res, tmp, RDCMIN(n, 16U) * sizeof(uint32_t));
+}
+}
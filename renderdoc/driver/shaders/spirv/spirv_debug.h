@@ -0,0 +1,302 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015-2017 Baldur Karlsson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+#pragma once
+
+#include <map>
+#include "api/replay/renderdoc_replay.h"
+#include "common/common.h"
+#include "spirv_common.h"
+
+namespace SPIRVDebug
+{
+// an input variable or buffer that the shader declares, which the caller fills in before running
+struct InterfaceVariable
+{
+  string name;
+  spv::StorageClass storage;
+
+  // spv::BuiltInMax if this isn't a builtin
+  spv::BuiltIn builtin;
+
+  // for inputs, ~0U if there's no location decoration
+  uint32_t location;
+
+  // for buffers
+  uint32_t set, binding;
+
+  // the number of descriptors for an array of buffers, otherwise 1
+  uint32_t arraySize;
+
+  // for inputs, the size of the variable in 32-bit words and the type of its components
+  uint32_t numWords;
+  VarType type;
+
+  // for inputs, the Flat and NoPerspective interpolation decorations
+  bool flat, noPerspective;
+};
+
+// Executes a single invocation of a SPIR-V shader on the CPU and records each step.
+//
+// The module is decoded once up front into a flat array of ops with pre-resolved operands and
+// branch targets, and every result ID gets a fixed slot in one array of 32-bit words, so running
+// the shader never touches the SPVModule's disassembly structures or allocates per-instruction.
+//
+// Only 32-bit scalar types are supported. Image operations and derivatives can't be evaluated for
+// a single invocation so they return 0 and flag the step.
+class Debugger
+{
+public:
+  Debugger();
+
+  // returns false and fills in error if the entry point can't be debugged
+  bool Init(SPVModule &module, const string &entryPoint, string &error);
+
+  const vector<InterfaceVariable> &GetInputs() const { return m_InputInfo; }
+  const vector<InterfaceVariable> &GetBuffers() const { return m_BufferInfo; }
+  // input data is tightly packed 32-bit words in the order of the variable's flattened members
+  void SetInput(size_t idx, const uint32_t *data, size_t numWords);
+  void SetBufferData(size_t idx, uint32_t arrayIdx, const vector<byte> &data);
+  void SetSpecConstant(uint32_t specId, const byte *data, size_t size);
+
+  // interprets a buffer's data with its declared layout, for display
+  void GetBufferVariables(size_t idx, rdctype::array<ShaderVariable> &vars);
+
+  // runs the shader to completion, or until maxSteps steps have been executed
+  ShaderDebugTrace Run(uint32_t maxSteps);
+
+private:
+  enum class TypeKind : uint8_t
+  {
+    Void,
+    Boolean,
+    Scalar,
+    Vector,
+    Matrix,
+    Array,
+    RuntimeArray,
+    Struct,
+    Pointer,
+    Opaque,
+    Function,
+  };
+
+  struct TypeInfo
+  {
+    TypeKind kind;
+    VarType scalar;
+
+    // vector component, matrix column, array element or pointee type
+    uint32_t elem;
+
+    // vector components, matrix columns or array length
+    uint32_t count;
+
+    // size when flattened into registers
+    uint32_t numWords;
+
+    // explicit layout decorations for types in memory-backed blocks
+    uint32_t arrayStride;
+    bool block;
+    spv::StorageClass storage;
+
+    struct Member
+    {
+      uint32_t type;
+      uint32_t wordOffset;
+      uint32_t byteOffset;
+      uint32_t matrixStride;
+      bool rowMajor;
+      string name;
+    };
+    vector<Member> members;
+  };
+
+  struct Op
+  {
+    uint16_t opcode;
+    uint16_t numArgs;
+    uint32_t resultType;
+    uint32_t result;
+    uint32_t args;
+
+    // line of the instruction's statement in the disassembly
+    uint32_t instruction;
+  };
+
+  struct Variable
+  {
+    uint32_t id;
+    uint32_t type;
+    spv::StorageClass storage;
+
+    // offset in m_VarData for variables stored in registers
+    uint32_t dataOffset;
+
+    // index in m_Buffers for memory-backed blocks, or -1
+    int32_t buffer;
+
+    // index in m_InputInfo/m_OutputVars, or -1
+    int32_t input;
+    int32_t output;
+
+    uint32_t initializer;
+  };
+
+  struct Buffer
+  {
+    uint32_t var;
+    uint32_t blockType;
+    vector<vector<byte> > data;
+  };
+
+  struct Frame
+  {
+    uint32_t returnOp;
+    uint32_t result;
+    uint32_t curLabel, prevLabel;
+  };
+
+  // pointers are stored in registers as {variable, descriptor array index, offset, matrix layout}
+  // where offset is in words for register variables and in bytes for buffers, and the matrix layout
+  // is the matrix stride with the top bit set for row major
+  enum
+  {
+    PtrVar = 0,
+    PtrArrayIdx,
+    PtrOffset,
+    PtrMatLayout,
+    PtrWords
+  };
+
+  static const uint32_t RowMajorBit = 0x80000000U;
+
+  // decoding
+  bool DecodeType(spv::Op opcode, const uint32_t *words, uint32_t count, string &error);
+  void AddVariable(uint32_t type, uint32_t id, spv::StorageClass storage, uint32_t initializer);
+  void AddOp(vector<Op> &ops, uint32_t opcode, uint32_t resultType, uint32_t result,
+             const uint32_t *args, uint32_t numArgs);
+
+  // helpers
+  const TypeInfo &Type(uint32_t typeId) const { return m_Types[m_TypeIndex[typeId]]; }
+  uint32_t *Reg(uint32_t id) { return &m_Regs[m_RegOffset[id]]; }
+  uint32_t NumComps(uint32_t typeId) const;
+  uint32_t MatrixRows(uint32_t typeId) const;
+  const string &Name(uint32_t id);
+
+  void LoadMemory(uint32_t type, const vector<byte> &mem, size_t offs, uint32_t matLayout,
+                  uint32_t *out);
+  void StoreMemory(uint32_t type, vector<byte> &mem, size_t offs, uint32_t matLayout,
+                   const uint32_t *in);
+  uint32_t PointeeType(uint32_t ptrTypeId) const { return Type(ptrTypeId).elem; }
+  void Load(const uint32_t *ptr, uint32_t type, uint32_t *out);
+  void Store(const uint32_t *ptr, uint32_t type, const uint32_t *in);
+  void AccessChain(const Op &op);
+
+  void MakeVariable(ShaderVariable &var, const string &name, uint32_t type, const uint32_t *words);
+  void UpdateRegister(uint32_t id);
+  void RecordStore(const uint32_t *ptr);
+
+  void ExecuteConstants();
+  uint32_t Execute(const Op &op, uint32_t opIdx, ShaderDebugState &state);
+  void ExecuteExtInst(const Op &op, ShaderDebugState &state);
+
+  uint32_t m_IdBound;
+
+  vector<TypeInfo> m_Types;
+  vector<uint32_t> m_TypeIndex;
+
+  // result type and register slot for every ID, or ~0U
+  vector<uint32_t> m_IdType;
+  vector<uint32_t> m_RegOffset;
+  vector<uint32_t> m_Regs;
+
+  vector<Op> m_Ops;
+  vector<uint32_t> m_Args;
+
+  // ops to set up constants, executed before the entry point
+  vector<Op> m_ConstOps;
+  std::map<uint32_t, uint32_t> m_SpecIds;
+  std::map<uint32_t, vector<uint32_t> > m_SpecValues;
+
+  // op index of each label and function, and each function's parameters
+  vector<uint32_t> m_LabelOp;
+  vector<uint32_t> m_FuncOp;
+  std::map<uint32_t, vector<uint32_t> > m_FuncParams;
+
+  vector<Variable> m_Vars;
+  vector<uint32_t> m_VarIndex;
+  vector<uint32_t> m_VarData;
+  vector<Buffer> m_Buffers;
+  vector<InterfaceVariable> m_BufferInfo;
+  vector<InterfaceVariable> m_InputInfo;
+  vector<vector<uint32_t> > m_InputData;
+  vector<uint32_t> m_OutputVars;
+
+  // the IDs shown as registers in every state: function and private variables and named results
+  vector<uint32_t> m_DisplayRegs;
+  vector<uint32_t> m_DisplayIndex;
+
+  // the current contents of the displayed registers and outputs, copied into each state
+  vector<ShaderVariable> m_RegisterFile;
+  vector<ShaderVariable> m_OutputFile;
+
+  // decorations and names, only needed while decoding
+  struct Decorations
+  {
+    Decorations()
+        : location(~0U),
+          set(0),
+          binding(0),
+          arrayStride(0),
+          specId(~0U),
+          builtin(spv::BuiltInMax),
+          block(false),
+          bufferBlock(false),
+          flat(false),
+          noPerspective(false)
+    {
+    }
+    uint32_t location, set, binding, arrayStride, specId;
+    spv::BuiltIn builtin;
+    bool block, bufferBlock, flat, noPerspective;
+    std::map<uint32_t, uint32_t> memberOffset, memberMatrixStride;
+    std::map<uint32_t, bool> memberRowMajor;
+  };
+  std::map<uint32_t, Decorations> m_Decorations;
+  std::map<uint32_t, string> m_Names;
+  std::map<uint32_t, vector<string> > m_MemberNames;
+  std::map<uint32_t, uint32_t> m_ConstLiterals;
+  vector<string> m_DisplayNames;
+
+  uint32_t m_GLSLSet;
+  uint32_t m_EntryFunc;
+
+  // execution state
+  uint32_t m_CurLabel, m_PrevLabel;
+  vector<Frame> m_CallStack;
+  bool m_Killed;
+  bool m_WarnedImage;
+};
+}
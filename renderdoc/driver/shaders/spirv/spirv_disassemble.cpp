@@ -897,7 +897,8 @@ struct SPVInstruction
   spv::Op opcode;
   uint32_t id;
 
-  // line number in disassembly (used for stepping when debugging)
+  // index of this instruction in the module (used to map instructions to disassembly lines when
+  // debugging)
   int line;
 
   struct
@@ -2039,6 +2040,45 @@ void SPVOperation::GetArg(const vector<SPVInstruction *> &ids, size_t idx, strin
   }
 }
 
+// a single disassembled statement can come from several funcops, e.g. a merge and branch are
+// printed as an if(), so it's numbered with the last one that actually executes anything
+static int StatementLine(const vector<SPVInstruction *> &funcops, size_t from, size_t to)
+{
+  int line = -1;
+
+  for(size_t o = from; o < to && o < funcops.size(); o++)
+  {
+    SPVInstruction *instr = funcops[o];
+
+    if(instr->opcode == spv::OpLabel)
+    {
+      // a loop header is printed with its label, but the condition is tested by the branch
+      if(instr->block && instr->block->mergeFlow && instr->block->exitFlow &&
+         instr->block->mergeFlow->opcode == spv::OpLoopMerge)
+        line = instr->block->exitFlow->line;
+    }
+    else if(instr->opcode != spv::OpSelectionMerge && instr->opcode != spv::OpLoopMerge)
+    {
+      line = instr->line;
+    }
+  }
+
+  return line;
+}
+
+// records the instruction index, or -1, for any complete lines in text that haven't been numbered
+static void NumberStatements(vector<int> &lineInstructions, const string &text, size_t &upTo,
+                             int line)
+{
+  size_t eol = text.find('\n', upTo);
+  while(eol != string::npos)
+  {
+    lineInstructions.push_back(line);
+    upTo = eol + 1;
+    eol = text.find('\n', upTo);
+  }
+}
+
 static bool IsUnmodified(SPVFunction *func, SPVInstruction *from, SPVInstruction *to)
 {
   // if it's not a variable (e.g. constant or something), just return true,
@@ -2158,10 +2198,13 @@ void FindFirstInstructionUse(SPVInstruction *op, SPVInstruction *search, SPVInst
   }
 }
 
-string SPVModule::Disassemble(const string &entryPoint)
+string SPVModule::Disassemble(const string &entryPoint, vector<uint32_t> *instructionLines)
 {
   string retDisasm = "";
 
+  if(instructionLines)
+    instructionLines->assign(operations.size(), ~0U);
+
   // TODO filter to only functions/resources used by entryPoint
 
   retDisasm = StringFormat::Fmt("SPIR-V %u.%u:\n\n", moduleVersion.major, moduleVersion.minor);
@@ -2933,8 +2976,18 @@ string SPVModule::Disassemble(const string &entryPoint)
 
     string funcDisassembly = "";
 
+    // each line is numbered with the instruction it comes from once it's complete, so that the
+    // debugger can step through the statements
+    vector<int> lineInstructions;
+    size_t numberedUpTo = 0;
+    size_t stmtStart = 0;
+
     for(size_t o = 0; o < funcops.size(); o++)
     {
+      NumberStatements(lineInstructions, funcDisassembly, numberedUpTo,
+                       StatementLine(funcops, stmtStart, o));
+      stmtStart = o;
+
       if(funcops[o]->opcode == spv::OpLabel)
       {
         bool handled = false;
@@ -3291,15 +3344,12 @@ string SPVModule::Disassemble(const string &entryPoint)
           funcDisassembly +=
               loadhit->Disassemble(ids, true);    // inline compositeinsert includes ' = '
           funcDisassembly += ";\n";
-
-          loadhit->line = (int)o;
         }
         else
         {
           // print separately
           funcDisassembly += string(indent, ' ');
           funcDisassembly += funcops[o]->Disassemble(ids, false) + ";\n";
-          funcops[o]->line = (int)o;
 
           o++;
 
@@ -3400,10 +3450,11 @@ string SPVModule::Disassemble(const string &entryPoint)
         funcDisassembly += string(indent, ' ');
         funcDisassembly += funcops[o]->Disassemble(ids, false) + ";\n";
       }
-
-      funcops[o]->line = (int)o;
     }
 
+    NumberStatements(lineInstructions, funcDisassembly, numberedUpTo,
+                     StatementLine(funcops, stmtStart, funcops.size()));
+
     RDCASSERT(switchstack.empty());
     RDCASSERT(selectionstack.empty());
     RDCASSERT(elsestack.empty());
@@ -3428,6 +3479,21 @@ string SPVModule::Disassemble(const string &entryPoint)
       retDisasm += "\n";
 #endif
 
+    if(instructionLines)
+    {
+      uint32_t firstLine = (uint32_t)std::count(retDisasm.begin(), retDisasm.end(), '\n');
+
+      for(size_t l = 0; l < lineInstructions.size(); l++)
+      {
+        int inst = lineInstructions[l];
+
+        // statements that span several lines are reported at their first line
+        if(inst >= 0 && (size_t)inst < instructionLines->size() &&
+           (*instructionLines)[inst] == ~0U)
+          (*instructionLines)[inst] = firstLine + (uint32_t)l;
+      }
+    }
+
     retDisasm += funcDisassembly;
 
     SAFE_DELETE_ARRAY(varDeclared);
@@ -3435,6 +3501,31 @@ string SPVModule::Disassemble(const string &entryPoint)
     retDisasm += StringFormat::Fmt("} // %s\n\n", funcs[f]->str.c_str());
   }
 
+  if(instructionLines)
+  {
+    // instructions that were folded into a later statement are reported at that statement's line,
+    // and any after the last statement at the last line
+    vector<uint32_t> &lines = *instructionLines;
+
+    uint32_t next = ~0U;
+    for(size_t i = lines.size(); i > 0; i--)
+    {
+      if(lines[i - 1] == ~0U)
+        lines[i - 1] = next;
+      else
+        next = lines[i - 1];
+    }
+
+    uint32_t prev = 0;
+    for(size_t i = 0; i < lines.size(); i++)
+    {
+      if(lines[i] == ~0U)
+        lines[i] = prev;
+      else
+        prev = lines[i];
+    }
+  }
+
   return retDisasm;
 }
 
@@ -4446,6 +4537,7 @@ void ParseSPIRV(uint32_t *spirv, size_t spirvLength, SPVModule &module)
     SPVInstruction &op = *module.operations.back();
 
     op.opcode = spv::Op(spirv[it] & spv::OpCodeMask);
+    op.line = int(module.operations.size() - 1);
 
     bool mathop = false;
 
@@ -0,0 +1,776 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2017 Baldur Karlsson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+#include <algorithm>
+#include "vk_core.h"
+
+// Every replay to an event normally starts over from the initial contents at the start of the
+// frame, so selecting an event late in a long frame replays everything before it each time.
+// Checkpoints snapshot the resources that change during the frame at points part of the way
+// through, and a later replay restores the closest one instead and only replays from there.
+//
+// Replay can only resume from a top-level position just after a queue submit, where no command
+// buffer recorded before that point is submitted after it - otherwise partial replay and the
+// re-recording of command buffers wouldn't see the recording. These positions are found when the
+// frame is first read, and a checkpoint is taken at one the first time a replay passes it.
+//
+// A checkpoint holds a copy of every image and device memory with initial contents, the image
+// layouts, and the bindings of descriptor sets that are updated during the frame. They are
+// kept at least replay.checkpoint.interval events apart and the total GPU memory they use is
+// limited to replay.checkpoint.budgetMB, evicting the least recently used.
+
+static const uint32_t DefaultCheckpointInterval = 500;
+static const uint64_t DefaultCheckpointBudgetMB = 256;
+
+// layouts we can't transition into, or don't know, are treated as GENERAL for our own barriers
+static VkImageLayout CheckpointSrcLayout(VkImageLayout layout)
+{
+  if(layout == UNKNOWN_PREV_IMG_LAYOUT)
+    return VK_IMAGE_LAYOUT_UNDEFINED;
+  return layout;
+}
+
+static VkImageLayout CheckpointDstLayout(VkImageLayout layout)
+{
+  if(layout == UNKNOWN_PREV_IMG_LAYOUT || layout == VK_IMAGE_LAYOUT_UNDEFINED ||
+     layout == VK_IMAGE_LAYOUT_PREINITIALIZED)
+    return VK_IMAGE_LAYOUT_GENERAL;
+  return layout;
+}
+
+static VkImageAspectFlags CheckpointAspects(VkFormat fmt)
+{
+  if(IsStencilOnlyFormat(fmt))
+    return VK_IMAGE_ASPECT_STENCIL_BIT;
+  else if(IsDepthOnlyFormat(fmt))
+    return VK_IMAGE_ASPECT_DEPTH_BIT;
+  else if(IsDepthOrStencilFormat(fmt))
+    return VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT;
+
+  return VK_IMAGE_ASPECT_COLOR_BIT;
+}
+
+static bool SameLayouts(const ImageLayouts &a, const ImageLayouts &b)
+{
+  if(a.subresourceStates.size() != b.subresourceStates.size())
+    return false;
+
+  for(size_t i = 0; i < a.subresourceStates.size(); i++)
+  {
+    const ImageRegionState &x = a.subresourceStates[i];
+    const ImageRegionState &y = b.subresourceStates[i];
+
+    if(x.newLayout != y.newLayout || x.subresourceRange.aspectMask != y.subresourceRange.aspectMask ||
+       x.subresourceRange.baseMipLevel != y.subresourceRange.baseMipLevel ||
+       x.subresourceRange.levelCount != y.subresourceRange.levelCount ||
+       x.subresourceRange.baseArrayLayer != y.subresourceRange.baseArrayLayer ||
+       x.subresourceRange.layerCount != y.subresourceRange.layerCount)
+      return false;
+  }
+
+  return true;
+}
+
+void WrappedVulkan::FinaliseCheckpointPositions()
+{
+  m_CheckpointInterval = DefaultCheckpointInterval;
+  m_CheckpointBudget = DefaultCheckpointBudgetMB * 1024 * 1024;
+  m_CheckpointsUnsupported = false;
+
+  const string &interval = RenderDoc::Inst().GetConfigSetting("replay.checkpoint.interval");
+  const string &budget = RenderDoc::Inst().GetConfigSetting("replay.checkpoint.budgetMB");
+
+  if(!interval.empty())
+    m_CheckpointInterval = (uint32_t)RDCMAX(0, atoi(interval.c_str()));
+  if(!budget.empty())
+    m_CheckpointBudget = uint64_t(RDCMAX(0, atoi(budget.c_str()))) * 1024 * 1024;
+
+  RDCASSERTEQUAL(m_CheckpointPositions.size(), m_CheckpointSubmitRecords.size());
+
+  if(m_CheckpointPositions.size() != m_CheckpointSubmitRecords.size())
+  {
+    m_CheckpointPositions.clear();
+    m_CheckpointSubmitRecords.clear();
+    return;
+  }
+
+  // walk backwards keeping the earliest recording used by any later submit. A position is only
+  // usable if that recording comes after it.
+  vector<CheckpointPosition> valid;
+  uint64_t firstLaterRecord = ~0ULL;
+
+  for(size_t i = m_CheckpointPositions.size(); i > 0; i--)
+  {
+    if(firstLaterRecord > m_CheckpointPositions[i - 1].fileOffset)
+      valid.push_back(m_CheckpointPositions[i - 1]);
+
+    firstLaterRecord = RDCMIN(firstLaterRecord, m_CheckpointSubmitRecords[i - 1]);
+  }
+
+  std::reverse(valid.begin(), valid.end());
+
+  RDCDEBUG("%u of %u queue submits can be replay checkpoints", (uint32_t)valid.size(),
+           (uint32_t)m_CheckpointPositions.size());
+
+  m_CheckpointPositions.swap(valid);
+  m_CheckpointSubmitRecords.clear();
+}
+
+bool WrappedVulkan::CheckpointsEnabled()
+{
+  // drawcall callbacks re-record and modify command buffers, so those replays neither take nor use
+  // checkpoints
+  return m_CheckpointInterval > 0 && m_CheckpointBudget > 0 && !m_CheckpointsUnsupported &&
+         m_DrawcallCallback == NULL && !m_CheckpointPositions.empty();
+}
+
+WrappedVulkan::ReplayCheckpoint *WrappedVulkan::FindCheckpoint(uint32_t eventID)
+{
+  if(!CheckpointsEnabled())
+    return NULL;
+
+  ReplayCheckpoint *ret = NULL;
+
+  for(size_t i = 0; i < m_Checkpoints.size(); i++)
+  {
+    if(m_Checkpoints[i]->pos.eventID <= eventID &&
+       (ret == NULL || m_Checkpoints[i]->pos.eventID > ret->pos.eventID))
+      ret = m_Checkpoints[i];
+  }
+
+  if(ret)
+  {
+    ret->lastUse = ++m_CheckpointTick;
+
+    m_CheckpointStats.hits++;
+    m_CheckpointStats.skippedEvents += ret->pos.eventID - 1;
+
+#if ENABLED(VERBOSE_PARTIAL_REPLAY)
+    RDCDEBUG("Replaying to %u from checkpoint at %u", eventID, ret->pos.eventID);
+#endif
+  }
+  else
+  {
+    m_CheckpointStats.misses++;
+  }
+
+  return ret;
+}
+
+void WrappedVulkan::CheckpointReplayPosition(uint64_t offset)
+{
+  if(!CheckpointsEnabled())
+    return;
+
+  struct OffsetCompare
+  {
+    bool operator()(const CheckpointPosition &a, uint64_t b) { return a.fileOffset < b; }
+  };
+
+  auto it = std::lower_bound(m_CheckpointPositions.begin(), m_CheckpointPositions.end(), offset,
+                             OffsetCompare());
+
+  if(it == m_CheckpointPositions.end() || it->fileOffset != offset)
+    return;
+
+  const CheckpointPosition &pos = *it;
+
+  // the start of the frame counts as a checkpoint too
+  if(pos.eventID <= m_CheckpointInterval)
+    return;
+
+  for(size_t i = 0; i < m_Checkpoints.size(); i++)
+  {
+    uint32_t eid = m_Checkpoints[i]->pos.eventID;
+    uint32_t dist = eid > pos.eventID ? eid - pos.eventID : pos.eventID - eid;
+
+    if(dist < m_CheckpointInterval)
+      return;
+  }
+
+  ReplayCheckpoint *checkpoint = TakeCheckpoint(pos);
+
+  if(checkpoint == NULL)
+    return;
+
+  // every checkpoint snapshots the same resources, so if one doesn't fit none will
+  if(checkpoint->size > m_CheckpointBudget)
+  {
+    RDCLOG("Disabling replay checkpoints - %llu MB needed for each is over the %llu MB budget",
+           uint64_t(checkpoint->size / (1024 * 1024)), m_CheckpointBudget / (1024 * 1024));
+
+    FreeCheckpoint(checkpoint);
+    m_CheckpointsUnsupported = true;
+    return;
+  }
+
+  while(!m_Checkpoints.empty() && m_CheckpointUsage + checkpoint->size > m_CheckpointBudget)
+  {
+    size_t lru = 0;
+    for(size_t i = 1; i < m_Checkpoints.size(); i++)
+      if(m_Checkpoints[i]->lastUse < m_Checkpoints[lru]->lastUse)
+        lru = i;
+
+    m_CheckpointUsage -= m_Checkpoints[lru]->size;
+    FreeCheckpoint(m_Checkpoints[lru]);
+    m_Checkpoints.erase(m_Checkpoints.begin() + lru);
+
+    m_CheckpointStats.evicted++;
+  }
+
+  checkpoint->lastUse = ++m_CheckpointTick;
+
+  m_Checkpoints.push_back(checkpoint);
+  m_CheckpointUsage += checkpoint->size;
+  m_CheckpointStats.created++;
+}
+
+WrappedVulkan::ReplayCheckpoint *WrappedVulkan::TakeCheckpoint(const CheckpointPosition &pos)
+{
+  VkDevice d = GetDev();
+  VkResult vkr = VK_SUCCESS;
+
+  vector<ResourceId> ids;
+  GetResourceManager()->GetInitialContentIDs(ids);
+
+  ReplayCheckpoint *checkpoint = new ReplayCheckpoint;
+  checkpoint->pos = pos;
+  checkpoint->lastUse = 0;
+  checkpoint->mem = VK_NULL_HANDLE;
+  checkpoint->size = 0;
+  checkpoint->memContents = VK_NULL_HANDLE;
+
+  VkDeviceSize memSize = 0;
+
+  for(size_t i = 0; i < ids.size(); i++)
+  {
+    if(!GetResourceManager()->HasLiveResource(ids[i]))
+      continue;
+
+    WrappedVkRes *live = GetResourceManager()->GetLiveResource(ids[i]);
+    ResourceId liveid = GetResourceManager()->GetID(live);
+
+    VkResourceType type = IdentifyTypeByPtr(live);
+
+    if(type == eResDeviceMemory)
+    {
+      memSize = AlignUp(memSize, (VkDeviceSize)16);
+      checkpoint->memOffsets.push_back(std::make_pair(liveid, memSize));
+      memSize += m_CreationInfo.m_Memory[liveid].size;
+    }
+    else if(type == eResImage || type == eResBuffer)
+    {
+      // buffers only have initial contents when they're sparse, and sparse images keep their
+      // contents in a blob. Restoring page bindings isn't supported.
+      if(type == eResBuffer || GetResourceManager()->GetInitialContents(ids[i]).blob != NULL)
+      {
+        RDCLOG("Disabling replay checkpoints - frame uses sparse resources");
+        m_CheckpointsUnsupported = true;
+        FreeCheckpoint(checkpoint);
+        return NULL;
+      }
+
+      if(m_ImageLayouts.find(liveid) == m_ImageLayouts.end())
+        continue;
+
+      checkpoint->images.push_back(std::make_pair(liveid, VkImage(VK_NULL_HANDLE)));
+    }
+  }
+
+  // create the snapshot objects and lay them all out in one allocation, with the buffer last so
+  // it's separated from the optimally tiled images by the buffer-image granularity
+  uint32_t memoryTypeBits = ~0U;
+  vector<VkDeviceSize> offsets;
+
+  for(size_t i = 0; i < checkpoint->images.size(); i++)
+  {
+    VulkanCreationInfo::Image &c = m_CreationInfo.m_Image[checkpoint->images[i].first];
+
+    VkImageCreateInfo imInfo = {
+        VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+        NULL,
+        0,
+        c.type,
+        c.format,
+        c.extent,
+        (uint32_t)c.mipLevels,
+        (uint32_t)c.arrayLayers,
+        c.samples,
+        VK_IMAGE_TILING_OPTIMAL,
+        VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+        VK_SHARING_MODE_EXCLUSIVE,
+        0,
+        NULL,
+        VK_IMAGE_LAYOUT_UNDEFINED,
+    };
+
+    vkr = ObjDisp(d)->CreateImage(Unwrap(d), &imInfo, NULL, &checkpoint->images[i].second);
+    RDCASSERTEQUAL(vkr, VK_SUCCESS);
+
+    VkMemoryRequirements mrq = {0};
+    ObjDisp(d)->GetImageMemoryRequirements(Unwrap(d), checkpoint->images[i].second, &mrq);
+
+    checkpoint->size = AlignUp(checkpoint->size, mrq.alignment);
+    offsets.push_back(checkpoint->size);
+    checkpoint->size += mrq.size;
+    memoryTypeBits &= mrq.memoryTypeBits;
+  }
+
+  VkDeviceSize bufOffset = 0;
+
+  if(memSize > 0)
+  {
+    VkBufferCreateInfo bufInfo = {
+        VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+        NULL,
+        0,
+        memSize,
+        VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+    };
+
+    vkr = ObjDisp(d)->CreateBuffer(Unwrap(d), &bufInfo, NULL, &checkpoint->memContents);
+    RDCASSERTEQUAL(vkr, VK_SUCCESS);
+
+    VkMemoryRequirements mrq = {0};
+    ObjDisp(d)->GetBufferMemoryRequirements(Unwrap(d), checkpoint->memContents, &mrq);
+
+    bufOffset = AlignUp(checkpoint->size, RDCMAX(mrq.alignment,
+                                                 GetDeviceProps().limits.bufferImageGranularity));
+    checkpoint->size = bufOffset + mrq.size;
+    memoryTypeBits &= mrq.memoryTypeBits;
+  }
+
+  if(checkpoint->size == 0)
+  {
+    // nothing is dirty, there's no point taking checkpoints
+    m_CheckpointsUnsupported = true;
+    FreeCheckpoint(checkpoint);
+    return NULL;
+  }
+
+  if(memoryTypeBits == 0)
+  {
+    RDCLOG("Disabling replay checkpoints - no memory type is usable for all snapshot resources");
+    m_CheckpointsUnsupported = true;
+    FreeCheckpoint(checkpoint);
+    return NULL;
+  }
+
+  VkMemoryAllocateInfo allocInfo = {
+      VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO, NULL, checkpoint->size,
+      GetGPULocalMemoryIndex(memoryTypeBits),
+  };
+
+  vkr = ObjDisp(d)->AllocateMemory(Unwrap(d), &allocInfo, NULL, &checkpoint->mem);
+
+  if(vkr != VK_SUCCESS)
+  {
+    // not fatal, we just replay from the start of the frame as normal
+    RDCWARN("Couldn't allocate %llu bytes for replay checkpoint: 0x%08x", checkpoint->size, vkr);
+    checkpoint->mem = VK_NULL_HANDLE;
+    FreeCheckpoint(checkpoint);
+    return NULL;
+  }
+
+  for(size_t i = 0; i < checkpoint->images.size(); i++)
+  {
+    vkr = ObjDisp(d)->BindImageMemory(Unwrap(d), checkpoint->images[i].second, checkpoint->mem,
+                                      offsets[i]);
+    RDCASSERTEQUAL(vkr, VK_SUCCESS);
+  }
+
+  if(checkpoint->memContents != VK_NULL_HANDLE)
+  {
+    vkr = ObjDisp(d)->BindBufferMemory(Unwrap(d), checkpoint->memContents, checkpoint->mem,
+                                       bufOffset);
+    RDCASSERTEQUAL(vkr, VK_SUCCESS);
+  }
+
+  // the work replayed so far has to be complete before we copy its results
+  ObjDisp(d)->DeviceWaitIdle(Unwrap(d));
+
+  VkCommandBuffer cmd = GetNextCmd();
+
+  VkCommandBufferBeginInfo beginInfo = {VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO, NULL,
+                                        VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT};
+
+  vkr = ObjDisp(cmd)->BeginCommandBuffer(Unwrap(cmd), &beginInfo);
+  RDCASSERTEQUAL(vkr, VK_SUCCESS);
+
+  VkMemoryBarrier memBarrier = {
+      VK_STRUCTURE_TYPE_MEMORY_BARRIER, NULL, VK_ACCESS_ALL_WRITE_BITS, VK_ACCESS_ALL_READ_BITS,
+  };
+
+  DoPipelineBarrier(cmd, 1, &memBarrier);
+
+  for(size_t i = 0; i < checkpoint->memOffsets.size(); i++)
+  {
+    VulkanCreationInfo::Memory &m = m_CreationInfo.m_Memory[checkpoint->memOffsets[i].first];
+
+    VkBufferCopy region = {0, checkpoint->memOffsets[i].second, m.size};
+
+    ObjDisp(cmd)->CmdCopyBuffer(Unwrap(cmd), Unwrap(m.wholeMemBuf), checkpoint->memContents, 1,
+                                &region);
+  }
+
+  for(size_t i = 0; i < checkpoint->images.size(); i++)
+  {
+    ResourceId id = checkpoint->images[i].first;
+    VkImage snapshot = checkpoint->images[i].second;
+    VkImage live = Unwrap(GetResourceManager()->GetCurrentHandle<VkImage>(id));
+
+    VulkanCreationInfo::Image &c = m_CreationInfo.m_Image[id];
+    ImageLayouts &layouts = m_ImageLayouts[id];
+
+    VkImageAspectFlags aspectFlags = CheckpointAspects(c.format);
+
+    VkImageMemoryBarrier barrier = {
+        VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+        NULL,
+        VK_ACCESS_ALL_WRITE_BITS,
+        VK_ACCESS_TRANSFER_READ_BIT,
+        VK_IMAGE_LAYOUT_UNDEFINED,
+        VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+        VK_QUEUE_FAMILY_IGNORED,
+        VK_QUEUE_FAMILY_IGNORED,
+        live,
+        {aspectFlags, 0, VK_REMAINING_MIP_LEVELS, 0, VK_REMAINING_ARRAY_LAYERS},
+    };
+
+    for(size_t si = 0; si < layouts.subresourceStates.size(); si++)
+    {
+      barrier.subresourceRange = layouts.subresourceStates[si].subresourceRange;
+      barrier.oldLayout = CheckpointSrcLayout(layouts.subresourceStates[si].newLayout);
+      DoPipelineBarrier(cmd, 1, &barrier);
+    }
+
+    VkImageMemoryBarrier snapBarrier = {
+        VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+        NULL,
+        0,
+        VK_ACCESS_TRANSFER_WRITE_BIT,
+        VK_IMAGE_LAYOUT_UNDEFINED,
+        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        VK_QUEUE_FAMILY_IGNORED,
+        VK_QUEUE_FAMILY_IGNORED,
+        snapshot,
+        {aspectFlags, 0, VK_REMAINING_MIP_LEVELS, 0, VK_REMAINING_ARRAY_LAYERS},
+    };
+
+    DoPipelineBarrier(cmd, 1, &snapBarrier);
+
+    vector<VkImageCopy> regions;
+
+    VkExtent3D extent = c.extent;
+
+    for(int m = 0; m < c.mipLevels; m++)
+    {
+      VkImageCopy region = {
+          {aspectFlags, (uint32_t)m, 0, (uint32_t)c.arrayLayers},
+          {0, 0, 0},
+          {aspectFlags, (uint32_t)m, 0, (uint32_t)c.arrayLayers},
+          {0, 0, 0},
+          extent,
+      };
+
+      regions.push_back(region);
+
+      extent.width = RDCMAX(extent.width >> 1, 1U);
+      extent.height = RDCMAX(extent.height >> 1, 1U);
+      extent.depth = RDCMAX(extent.depth >> 1, 1U);
+    }
+
+    ObjDisp(cmd)->CmdCopyImage(Unwrap(cmd), live, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, snapshot,
+                               VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, (uint32_t)regions.size(),
+                               &regions[0]);
+
+    // put the live image back how it was
+    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+    for(size_t si = 0; si < layouts.subresourceStates.size(); si++)
+    {
+      barrier.subresourceRange = layouts.subresourceStates[si].subresourceRange;
+      barrier.newLayout = CheckpointDstLayout(layouts.subresourceStates[si].newLayout);
+      barrier.dstAccessMask = MakeAccessMask(barrier.newLayout);
+      DoPipelineBarrier(cmd, 1, &barrier);
+    }
+
+    // the snapshot stays as a copy source from now on
+    snapBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    snapBarrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    snapBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    snapBarrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+    DoPipelineBarrier(cmd, 1, &snapBarrier);
+  }
+
+  vkr = ObjDisp(cmd)->EndCommandBuffer(Unwrap(cmd));
+  RDCASSERTEQUAL(vkr, VK_SUCCESS);
+
+  SubmitCmds();
+  FlushQ();
+
+  checkpoint->layouts = m_ImageLayouts;
+
+  for(auto it = m_CheckpointDescSets.begin(); it != m_CheckpointDescSets.end(); ++it)
+  {
+    auto setit = m_DescriptorSetState.find(*it);
+
+    if(setit == m_DescriptorSetState.end() || !GetResourceManager()->HasCurrentResource(*it))
+      continue;
+
+    const DescSetLayout &layout = m_CreationInfo.m_DescSetLayout[setit->second.layout];
+    const vector<DescriptorSetSlot *> &bindings = setit->second.currentBindings;
+
+    checkpoint->descSets.push_back(std::make_pair(*it, vector<DescriptorSetSlot>()));
+    vector<DescriptorSetSlot> &slots = checkpoint->descSets.back().second;
+
+    for(size_t b = 0; b < layout.bindings.size() && b < bindings.size(); b++)
+      slots.insert(slots.end(), bindings[b], bindings[b] + layout.bindings[b].descriptorCount);
+  }
+
+  RDCDEBUG("Took replay checkpoint at %u: %u images, %u memories, %u descriptor sets, %llu bytes",
+           pos.eventID, (uint32_t)checkpoint->images.size(),
+           (uint32_t)checkpoint->memOffsets.size(), (uint32_t)checkpoint->descSets.size(),
+           checkpoint->size);
+
+  return checkpoint;
+}
+
+void WrappedVulkan::ApplyCheckpoint(ReplayCheckpoint *checkpoint)
+{
+  VkResult vkr = VK_SUCCESS;
+
+  VkCommandBuffer cmd = GetNextCmd();
+
+  VkCommandBufferBeginInfo beginInfo = {VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO, NULL,
+                                        VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT};
+
+  vkr = ObjDisp(cmd)->BeginCommandBuffer(Unwrap(cmd), &beginInfo);
+  RDCASSERTEQUAL(vkr, VK_SUCCESS);
+
+  // same blunt synchronisation as when applying initial contents
+  VkMemoryBarrier memBarrier = {
+      VK_STRUCTURE_TYPE_MEMORY_BARRIER, NULL, VK_ACCESS_ALL_WRITE_BITS, VK_ACCESS_ALL_READ_BITS,
+  };
+
+  DoPipelineBarrier(cmd, 1, &memBarrier);
+
+  // memory goes first, so that images bound to it then get their own contents back on top
+  for(size_t i = 0; i < checkpoint->memOffsets.size(); i++)
+  {
+    VulkanCreationInfo::Memory &m = m_CreationInfo.m_Memory[checkpoint->memOffsets[i].first];
+
+    VkBufferCopy region = {checkpoint->memOffsets[i].second, 0, m.size};
+
+    ObjDisp(cmd)->CmdCopyBuffer(Unwrap(cmd), checkpoint->memContents, Unwrap(m.wholeMemBuf), 1,
+                                &region);
+  }
+
+  DoPipelineBarrier(cmd, 1, &memBarrier);
+
+  // move images from their current layouts to those at the checkpoint. Their regions may be split
+  // differently, so go through GENERAL for the whole image.
+  for(auto it = checkpoint->layouts.begin(); it != checkpoint->layouts.end(); ++it)
+  {
+    auto cur = m_ImageLayouts.find(it->first);
+
+    if(cur == m_ImageLayouts.end() || !GetResourceManager()->HasCurrentResource(it->first))
+      continue;
+
+    if(SameLayouts(cur->second, it->second))
+      continue;
+
+    VkImageMemoryBarrier barrier = {
+        VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+        NULL,
+        VK_ACCESS_ALL_WRITE_BITS,
+        VK_ACCESS_ALL_READ_BITS,
+        VK_IMAGE_LAYOUT_UNDEFINED,
+        VK_IMAGE_LAYOUT_GENERAL,
+        VK_QUEUE_FAMILY_IGNORED,
+        VK_QUEUE_FAMILY_IGNORED,
+        Unwrap(GetResourceManager()->GetCurrentHandle<VkImage>(it->first)),
+        {VK_IMAGE_ASPECT_COLOR_BIT, 0, VK_REMAINING_MIP_LEVELS, 0, VK_REMAINING_ARRAY_LAYERS},
+    };
+
+    for(size_t si = 0; si < cur->second.subresourceStates.size(); si++)
+    {
+      barrier.subresourceRange = cur->second.subresourceStates[si].subresourceRange;
+      barrier.oldLayout = CheckpointSrcLayout(cur->second.subresourceStates[si].newLayout);
+      DoPipelineBarrier(cmd, 1, &barrier);
+    }
+
+    barrier.oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+    for(size_t si = 0; si < it->second.subresourceStates.size(); si++)
+    {
+      barrier.subresourceRange = it->second.subresourceStates[si].subresourceRange;
+      barrier.newLayout = CheckpointDstLayout(it->second.subresourceStates[si].newLayout);
+      DoPipelineBarrier(cmd, 1, &barrier);
+    }
+
+    cur->second = it->second;
+  }
+
+  for(size_t i = 0; i < checkpoint->images.size(); i++)
+  {
+    ResourceId id = checkpoint->images[i].first;
+    VkImage snapshot = checkpoint->images[i].second;
+    VkImage live = Unwrap(GetResourceManager()->GetCurrentHandle<VkImage>(id));
+
+    VulkanCreationInfo::Image &c = m_CreationInfo.m_Image[id];
+    ImageLayouts &layouts = m_ImageLayouts[id];
+
+    VkImageAspectFlags aspectFlags = CheckpointAspects(c.format);
+
+    VkImageMemoryBarrier barrier = {
+        VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+        NULL,
+        VK_ACCESS_ALL_WRITE_BITS,
+        VK_ACCESS_TRANSFER_WRITE_BIT,
+        VK_IMAGE_LAYOUT_UNDEFINED,
+        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        VK_QUEUE_FAMILY_IGNORED,
+        VK_QUEUE_FAMILY_IGNORED,
+        live,
+        {aspectFlags, 0, VK_REMAINING_MIP_LEVELS, 0, VK_REMAINING_ARRAY_LAYERS},
+    };
+
+    for(size_t si = 0; si < layouts.subresourceStates.size(); si++)
+    {
+      barrier.subresourceRange = layouts.subresourceStates[si].subresourceRange;
+      barrier.oldLayout = CheckpointSrcLayout(layouts.subresourceStates[si].newLayout);
+      DoPipelineBarrier(cmd, 1, &barrier);
+    }
+
+    vector<VkImageCopy> regions;
+
+    VkExtent3D extent = c.extent;
+
+    for(int m = 0; m < c.mipLevels; m++)
+    {
+      VkImageCopy region = {
+          {aspectFlags, (uint32_t)m, 0, (uint32_t)c.arrayLayers},
+          {0, 0, 0},
+          {aspectFlags, (uint32_t)m, 0, (uint32_t)c.arrayLayers},
+          {0, 0, 0},
+          extent,
+      };
+
+      regions.push_back(region);
+
+      extent.width = RDCMAX(extent.width >> 1, 1U);
+      extent.height = RDCMAX(extent.height >> 1, 1U);
+      extent.depth = RDCMAX(extent.depth >> 1, 1U);
+    }
+
+    ObjDisp(cmd)->CmdCopyImage(Unwrap(cmd), snapshot, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, live,
+                               VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, (uint32_t)regions.size(),
+                               &regions[0]);
+
+    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+
+    for(size_t si = 0; si < layouts.subresourceStates.size(); si++)
+    {
+      barrier.subresourceRange = layouts.subresourceStates[si].subresourceRange;
+      barrier.newLayout = CheckpointDstLayout(layouts.subresourceStates[si].newLayout);
+      barrier.dstAccessMask = VK_ACCESS_ALL_READ_BITS | MakeAccessMask(barrier.newLayout);
+      DoPipelineBarrier(cmd, 1, &barrier);
+    }
+  }
+
+  DoPipelineBarrier(cmd, 1, &memBarrier);
+
+  vkr = ObjDisp(cmd)->EndCommandBuffer(Unwrap(cmd));
+  RDCASSERTEQUAL(vkr, VK_SUCCESS);
+
+  // the caller has waited for the device to be idle, so the sets can be written directly. This
+  // also updates our tracking of their current bindings.
+  for(size_t i = 0; i < checkpoint->descSets.size(); i++)
+  {
+    ResourceId id = checkpoint->descSets[i].first;
+    vector<DescriptorSetSlot> &slots = checkpoint->descSets[i].second;
+
+    if(slots.empty() || !GetResourceManager()->HasCurrentResource(id))
+      continue;
+
+    WrappedVkRes *live = GetResourceManager()->GetCurrentResource(id);
+
+    const DescSetLayout &layout = m_CreationInfo.m_DescSetLayout[m_DescriptorSetState[id].layout];
+
+    uint32_t validBinds = 0;
+    byte *blob = MakeDescriptorSetWrites(ToHandle<VkDescriptorSet>(live), layout, &slots[0],
+                                         (uint32_t)slots.size(), validBinds);
+
+    Apply_InitialState(live, VulkanResourceManager::InitialContentData(NULL, validBinds, blob));
+
+    Serialiser::FreeAlignedBuffer(blob);
+  }
+}
+
+void WrappedVulkan::FreeCheckpoint(ReplayCheckpoint *checkpoint)
+{
+  VkDevice d = GetDev();
+
+  for(size_t i = 0; i < checkpoint->images.size(); i++)
+    if(checkpoint->images[i].second != VK_NULL_HANDLE)
+      ObjDisp(d)->DestroyImage(Unwrap(d), checkpoint->images[i].second, NULL);
+
+  if(checkpoint->memContents != VK_NULL_HANDLE)
+    ObjDisp(d)->DestroyBuffer(Unwrap(d), checkpoint->memContents, NULL);
+
+  if(checkpoint->mem != VK_NULL_HANDLE)
+    ObjDisp(d)->FreeMemory(Unwrap(d), checkpoint->mem, NULL);
+
+  delete checkpoint;
+}
+
+void WrappedVulkan::ClearReplayCheckpoints()
+{
+  if(m_CheckpointStats.hits + m_CheckpointStats.misses > 0)
+    RDCLOG(
+        "Replay checkpoints: %u hits, %u misses, %llu events skipped. %u created, %u evicted, "
+        "%u live using %llu MB",
+        m_CheckpointStats.hits, m_CheckpointStats.misses, m_CheckpointStats.skippedEvents,
+        m_CheckpointStats.created, m_CheckpointStats.evicted, (uint32_t)m_Checkpoints.size(),
+        m_CheckpointUsage / (1024 * 1024));
+
+  // the resources being snapshotted may have changed, so give checkpoints another chance
+  m_CheckpointsUnsupported = false;
+
+  if(m_Checkpoints.empty())
+    return;
+
+  // checkpoints may still be in use by copies in flight
+  ObjDisp(GetDev())->DeviceWaitIdle(Unwrap(GetDev()));
+
+  for(size_t i = 0; i < m_Checkpoints.size(); i++)
+    FreeCheckpoint(m_Checkpoints[i]);
+
+  m_Checkpoints.clear();
+  m_CheckpointUsage = 0;
+}
@@ -23,8 +23,7 @@
  ******************************************************************************/
 
 #include "vk_core.h"
-#include "jpeg-compressor/jpge.h"
-#include "maths/formatpacking.h"
+#include "core/capture_thumbnail.h"
 #include "serialise/string_utils.h"
 #include "vk_debug.h"
 
@@ -303,6 +302,16 @@ WrappedVulkan::WrappedVulkan(const char *logFilename) : m_RenderState(&m_Creatio
 
   m_DrawcallCallback = NULL;
 
+  m_ResumeCheckpoint = NULL;
+  m_CheckpointInterval = 0;
+  m_CheckpointBudget = 0;
+  m_CheckpointUsage = 0;
+  m_CheckpointTick = 0;
+  m_CheckpointsUnsupported = false;
+  RDCEraseEl(m_CheckpointStats);
+
+  m_ReplayedEventID = 0;
+
   m_CurChunkOffset = 0;
   m_AddedDrawcall = false;
 
@@ -1160,6 +1169,63 @@ void WrappedVulkan::StartFrameCapture(void *dev, void *wnd)
   RDCLOG("Starting capture, frame %u", m_FrameCounter);
 }
 
+// the backbuffer copied into a linear image at the end of a capture. The copy is left in flight
+// and only waited for when the capture writer thread encodes the thumbnail. None of these objects
+// are wrapped.
+class VulkanThumbnail : public CaptureThumbnail
+{
+public:
+  VulkanThumbnail(VkDevice dev, VkImage im, VkDeviceMemory mem, VkFence f, VkDeviceSize offset)
+      : m_Device(dev), m_Image(im), m_Memory(mem), m_Fence(f), m_Offset(offset), m_Data(NULL)
+  {
+  }
+
+  ~VulkanThumbnail()
+  {
+    const VkLayerDispatchTable *vt = ObjDisp(m_Device);
+
+    // the copy has to be finished before the image can be destroyed, even if it was never read
+    vt->WaitForFences(Unwrap(m_Device), 1, &m_Fence, VK_TRUE, UINT64_MAX);
+
+    if(m_Data)
+      vt->UnmapMemory(Unwrap(m_Device), m_Memory);
+
+    vt->DestroyImage(Unwrap(m_Device), m_Image, NULL);
+    vt->FreeMemory(Unwrap(m_Device), m_Memory, NULL);
+    vt->DestroyFence(Unwrap(m_Device), m_Fence, NULL);
+  }
+
+  const byte *GetPixels()
+  {
+    if(m_Data == NULL)
+    {
+      const VkLayerDispatchTable *vt = ObjDisp(m_Device);
+
+      VkResult vkr = vt->WaitForFences(Unwrap(m_Device), 1, &m_Fence, VK_TRUE, UINT64_MAX);
+      RDCASSERTEQUAL(vkr, VK_SUCCESS);
+
+      vkr = vt->MapMemory(Unwrap(m_Device), m_Memory, 0, VK_WHOLE_SIZE, 0, (void **)&m_Data);
+      RDCASSERTEQUAL(vkr, VK_SUCCESS);
+
+      if(vkr != VK_SUCCESS || m_Data == NULL)
+      {
+        m_Data = NULL;
+        return NULL;
+      }
+    }
+
+    return m_Data + m_Offset;
+  }
+
+private:
+  VkDevice m_Device;
+  VkImage m_Image;
+  VkDeviceMemory m_Memory;
+  VkFence m_Fence;
+  VkDeviceSize m_Offset;
+  byte *m_Data;
+};
+
 bool WrappedVulkan::EndFrameCapture(void *dev, void *wnd)
 {
   if(m_State != WRITING_CAPFRAME)
@@ -1240,21 +1306,25 @@ bool WrappedVulkan::EndFrameCapture(void *dev, void *wnd)
       SCOPED_LOCK(m_CoherentMapsLock);
       for(auto it = m_CoherentMaps.begin(); it != m_CoherentMaps.end(); ++it)
       {
-        Serialiser::FreeAlignedBuffer((*it)->memMapState->refData);
-        (*it)->memMapState->refData = NULL;
-        (*it)->memMapState->needRefData = false;
+        MemMapState *state = (*it)->memMapState;
+
+        Serialiser::FreeAlignedBuffer(state->refData);
+        state->refData = NULL;
+        state->needRefData = false;
+
+        if(state->writeTracked)
+        {
+          WriteTracking::Untrack(state->mappedPtr + (size_t)state->mapOffset);
+          state->writeTracked = false;
+        }
       }
     }
   }
 
-  byte *thpixels = NULL;
-  uint32_t thwidth = 0;
-  uint32_t thheight = 0;
+  VulkanThumbnail *thumb = NULL;
 
   // gather backbuffer screenshot
-  const uint32_t maxSize = 2048;
-
-  if(swap != VK_NULL_HANDLE)
+  if(swap != VK_NULL_HANDLE && m_Queue != VK_NULL_HANDLE)
   {
     VkDevice device = GetDev();
     VkCommandBuffer cmd = GetNextCmd();
@@ -1265,10 +1335,10 @@ bool WrappedVulkan::EndFrameCapture(void *dev, void *wnd)
 
     const SwapchainInfo &swapInfo = *swaprecord->swapInfo;
 
-    // since these objects are very short lived (only this scope), we
-    // don't wrap them.
+    // these objects are only used to read back the thumbnail, so we don't wrap them.
     VkImage readbackIm = VK_NULL_HANDLE;
     VkDeviceMemory readbackMem = VK_NULL_HANDLE;
+    VkFence readbackFence = VK_NULL_HANDLE;
 
     VkResult vkr = VK_SUCCESS;
 
@@ -1369,168 +1439,27 @@ bool WrappedVulkan::EndFrameCapture(void *dev, void *wnd)
     RDCASSERTEQUAL(vkr, VK_SUCCESS);
 
     SubmitCmds();
-    FlushQ();    // need to wait so we can readback
 
-    // map memory and readback
-    byte *pData = NULL;
-    vkr = vt->MapMemory(Unwrap(device), readbackMem, 0, VK_WHOLE_SIZE, 0, (void **)&pData);
-    RDCASSERTEQUAL(vkr, VK_SUCCESS);
-
-    RDCASSERT(pData != NULL);
-
-    // point sample info into raw buffer
-    {
-      ResourceFormat fmt = MakeResourceFormat(imInfo.format);
+    // rather than waiting for the copy here, signal a fence once it's done and let the capture
+    // writer thread wait for it before downscaling and compressing the image
+    VkFenceCreateInfo fenceInfo = {VK_STRUCTURE_TYPE_FENCE_CREATE_INFO, NULL, 0};
 
-      byte *data = (byte *)pData;
-
-      data += layout.offset;
-
-      float widthf = float(imInfo.extent.width);
-      float heightf = float(imInfo.extent.height);
-
-      float aspect = widthf / heightf;
-
-      thwidth = RDCMIN(maxSize, imInfo.extent.width);
-      thwidth &= ~0x7;    // align down to multiple of 8
-      thheight = uint32_t(float(thwidth) / aspect);
-
-      thpixels = new byte[3 * thwidth * thheight];
-
-      uint32_t stride = fmt.compByteWidth * fmt.compCount;
-
-      bool buf1010102 = false;
-      bool buf565 = false, buf5551 = false;
-      bool bufBGRA = (fmt.bgraOrder != false);
-
-      if(fmt.special)
-      {
-        switch(fmt.specialFormat)
-        {
-          case SpecialFormat::R10G10B10A2:
-            stride = 4;
-            buf1010102 = true;
-            break;
-          case SpecialFormat::R5G6B5:
-            stride = 2;
-            buf565 = true;
-            break;
-          case SpecialFormat::R5G5B5A1:
-            stride = 2;
-            buf5551 = true;
-            break;
-          default: break;
-        }
-      }
-
-      byte *dst = thpixels;
-
-      for(uint32_t y = 0; y < thheight; y++)
-      {
-        for(uint32_t x = 0; x < thwidth; x++)
-        {
-          float xf = float(x) / float(thwidth);
-          float yf = float(y) / float(thheight);
-
-          byte *src =
-              &data[stride * uint32_t(xf * widthf) + layout.rowPitch * uint32_t(yf * heightf)];
-
-          if(buf1010102)
-          {
-            uint32_t *src1010102 = (uint32_t *)src;
-            Vec4f unorm = ConvertFromR10G10B10A2(*src1010102);
-            dst[0] = (byte)(unorm.x * 255.0f);
-            dst[1] = (byte)(unorm.y * 255.0f);
-            dst[2] = (byte)(unorm.z * 255.0f);
-          }
-          else if(buf565)
-          {
-            uint16_t *src565 = (uint16_t *)src;
-            Vec3f unorm = ConvertFromB5G6R5(*src565);
-            dst[0] = (byte)(unorm.z * 255.0f);
-            dst[1] = (byte)(unorm.y * 255.0f);
-            dst[2] = (byte)(unorm.x * 255.0f);
-          }
-          else if(buf5551)
-          {
-            uint16_t *src5551 = (uint16_t *)src;
-            Vec4f unorm = ConvertFromB5G5R5A1(*src5551);
-            dst[0] = (byte)(unorm.z * 255.0f);
-            dst[1] = (byte)(unorm.y * 255.0f);
-            dst[2] = (byte)(unorm.x * 255.0f);
-          }
-          else if(bufBGRA)
-          {
-            dst[0] = src[2];
-            dst[1] = src[1];
-            dst[2] = src[0];
-          }
-          else if(fmt.compByteWidth == 2)    // R16G16B16A16 backbuffer
-          {
-            uint16_t *src16 = (uint16_t *)src;
-
-            float linearR = RDCCLAMP(ConvertFromHalf(src16[0]), 0.0f, 1.0f);
-            float linearG = RDCCLAMP(ConvertFromHalf(src16[1]), 0.0f, 1.0f);
-            float linearB = RDCCLAMP(ConvertFromHalf(src16[2]), 0.0f, 1.0f);
-
-            if(linearR < 0.0031308f)
-              dst[0] = byte(255.0f * (12.92f * linearR));
-            else
-              dst[0] = byte(255.0f * (1.055f * powf(linearR, 1.0f / 2.4f) - 0.055f));
-
-            if(linearG < 0.0031308f)
-              dst[1] = byte(255.0f * (12.92f * linearG));
-            else
-              dst[1] = byte(255.0f * (1.055f * powf(linearG, 1.0f / 2.4f) - 0.055f));
-
-            if(linearB < 0.0031308f)
-              dst[2] = byte(255.0f * (12.92f * linearB));
-            else
-              dst[2] = byte(255.0f * (1.055f * powf(linearB, 1.0f / 2.4f) - 0.055f));
-          }
-          else
-          {
-            dst[0] = src[0];
-            dst[1] = src[1];
-            dst[2] = src[2];
-          }
-
-          dst += 3;
-        }
-      }
-    }
+    vkr = vt->CreateFence(Unwrap(device), &fenceInfo, NULL, &readbackFence);
+    RDCASSERTEQUAL(vkr, VK_SUCCESS);
 
-    vt->UnmapMemory(Unwrap(device), readbackMem);
+    vkr = ObjDisp(m_Queue)->QueueSubmit(Unwrap(m_Queue), 0, NULL, readbackFence);
+    RDCASSERTEQUAL(vkr, VK_SUCCESS);
 
-    // delete all
-    vt->DestroyImage(Unwrap(device), readbackIm, NULL);
-    vt->FreeMemory(Unwrap(device), readbackMem, NULL);
+    thumb = new VulkanThumbnail(device, readbackIm, readbackMem, readbackFence, layout.offset);
+    thumb->width = imInfo.extent.width;
+    thumb->height = imInfo.extent.height;
+    thumb->rowPitch = (uint32_t)layout.rowPitch;
+    thumb->format = MakeResourceFormat(imInfo.format);
   }
 
-  byte *jpgbuf = NULL;
-  int len = thwidth * thheight;
+  Serialiser *m_pFileSerialiser =
+      RenderDoc::Inst().OpenWriteSerialiser(m_FrameCounter, &m_InitParams, thumb);
 
-  if(wnd)
-  {
-    jpgbuf = new byte[len];
-
-    jpge::params p;
-    p.m_quality = 80;
-
-    bool success =
-        jpge::compress_image_to_jpeg_file_in_memory(jpgbuf, len, thwidth, thheight, 3, thpixels, p);
-
-    if(!success)
-    {
-      RDCERR("Failed to compress to jpg");
-      SAFE_DELETE_ARRAY(jpgbuf);
-      thwidth = 0;
-      thheight = 0;
-    }
-  }
-
-  Serialiser *m_pFileSerialiser = RenderDoc::Inst().OpenWriteSerialiser(
-      m_FrameCounter, &m_InitParams, jpgbuf, len, thwidth, thheight);
 
   {
     CACHE_THREAD_SERIALISER();
@@ -1591,11 +1520,8 @@ bool WrappedVulkan::EndFrameCapture(void *dev, void *wnd)
     RDCDEBUG("Done");
   }
 
-  m_pFileSerialiser->FlushToDisk();
-
-  RenderDoc::Inst().SuccessfullyWrittenLog(m_FrameCounter);
-
-  SAFE_DELETE(m_pFileSerialiser);
+  RenderDoc::Inst().FinishWriteSerialiser(m_pFileSerialiser, m_FrameCounter);
+  m_pFileSerialiser = NULL;
   SAFE_DELETE(m_HeaderChunk);
 
   m_State = WRITING_IDLE;
@@ -1610,6 +1536,8 @@ bool WrappedVulkan::EndFrameCapture(void *dev, void *wnd)
 
   GetResourceManager()->ClearReferencedResources();
 
+  GetResourceManager()->DetachRecordChunksFromArena();
+
   GetResourceManager()->FreeInitialContents();
 
   GetResourceManager()->FlushPendingDirty();
@@ -1626,23 +1554,16 @@ void WrappedVulkan::ReadLogInitialisation()
 
   m_pSerialiser->SetDebugText(true);
 
-  m_pSerialiser->Rewind();
+  // find the capture chunks from the index rather than walking the whole log
+  const vector<Serialiser::ChunkIndexEntry> &chunkIndex = m_pSerialiser->GetChunkIndex();
 
-  while(!m_pSerialiser->AtEnd())
+  for(size_t i = 0; i < chunkIndex.size(); i++)
   {
-    m_pSerialiser->SkipToChunk(CAPTURE_SCOPE);
-
-    // found a capture chunk
-    if(!m_pSerialiser->AtEnd())
+    if(chunkIndex[i].chunkType == CAPTURE_SCOPE)
     {
-      lastFrame = m_pSerialiser->GetOffset();
+      lastFrame = chunkIndex[i].offset;
       if(firstFrame == 0)
-        firstFrame = m_pSerialiser->GetOffset();
-
-      // skip this chunk
-      m_pSerialiser->PushContext(NULL, NULL, CAPTURE_SCOPE, false);
-      m_pSerialiser->SkipCurrentChunk();
-      m_pSerialiser->PopContext(CAPTURE_SCOPE);
+        firstFrame = chunkIndex[i].offset;
     }
   }
 
@@ -1662,6 +1583,10 @@ void WrappedVulkan::ReadLogInitialisation()
 
   SCOPED_TIMER("chunk initialisation");
 
+  // shader modules are parsed in the background while we continue loading, and only reflected
+  // when a pipeline using them is first inspected
+  m_CreationInfo.BeginShaderParsing();
+
   for(;;)
   {
     PerformanceTimer timer;
@@ -1706,6 +1631,8 @@ void WrappedVulkan::ReadLogInitialisation()
     }
   }
 
+  m_CreationInfo.EndShaderParsing();
+
 #if ENABLED(RDOC_DEVEL)
   for(auto it = chunkInfos.begin(); it != chunkInfos.end(); ++it)
   {
@@ -1756,6 +1683,15 @@ void WrappedVulkan::ContextReplayLog(LogState readType, uint32_t startEventID, u
     SubmitCmds();
     FlushQ();
   }
+  else if(m_ResumeCheckpoint)
+  {
+    // images are now in their layouts from the start of the frame, and are moved to the
+    // checkpoint's layouts as its contents are restored.
+    ApplyCheckpoint(m_ResumeCheckpoint);
+
+    SubmitCmds();
+    FlushQ();
+  }
 
   m_pSerialiser->PopContext(header);
 
@@ -1772,6 +1708,13 @@ void WrappedVulkan::ContextReplayLog(LogState readType, uint32_t startEventID, u
     if(partial)
       m_pSerialiser->SetOffset(ev.fileOffset);
 
+    // resuming from a checkpoint skips everything before it, all of which is already applied.
+    if(m_ResumeCheckpoint)
+    {
+      m_RootEventID = m_ResumeCheckpoint->pos.eventID;
+      m_pSerialiser->SetOffset(m_ResumeCheckpoint->pos.fileOffset);
+    }
+
     m_FirstEventID = startEventID;
     m_LastEventID = endEventID;
 
@@ -1787,6 +1730,13 @@ void WrappedVulkan::ContextReplayLog(LogState readType, uint32_t startEventID, u
     m_RootDrawcallID = 1;
     m_FirstEventID = 0;
     m_LastEventID = ~0U;
+
+    m_ReplayedEventID = 0;
+
+    // only updates inside the frame matter to checkpoints
+    m_CheckpointDescSets.clear();
+    m_CheckpointPositions.clear();
+    m_CheckpointSubmitRecords.clear();
   }
 
   for(;;)
@@ -1800,6 +1750,9 @@ void WrappedVulkan::ContextReplayLog(LogState readType, uint32_t startEventID, u
 
     uint64_t offset = m_pSerialiser->GetOffset();
 
+    if(m_State == EXECUTING && !partial)
+      CheckpointReplayPosition(offset);
+
     VulkanChunkType context = (VulkanChunkType)m_pSerialiser->PushContext(NULL, NULL, 1, false);
 
     m_LastCmdBufferID = ResourceId();
@@ -1827,7 +1780,15 @@ void WrappedVulkan::ContextReplayLog(LogState readType, uint32_t startEventID, u
       m_RootEventID++;
 
       if(startEventID > 1)
+      {
+        // skip over IDs that have no event of their own, like pop markers, instead of going back
+        // and replaying the previous event's chunk again
+        while(m_RootEventID <= endEventID && m_RootEventID < GetMaxEID() &&
+              GetEvent(m_RootEventID).eventID != m_RootEventID)
+          m_RootEventID++;
+
         m_pSerialiser->SetOffset(GetEvent(m_RootEventID).fileOffset);
+      }
     }
     else
     {
@@ -1835,10 +1796,19 @@ void WrappedVulkan::ContextReplayLog(LogState readType, uint32_t startEventID, u
       if(context != BEGIN_CMD_BUFFER && context != END_CMD_BUFFER)
         m_BakedCmdBufferInfo[m_LastCmdBufferID].curEventID++;
     }
+
+    // every submit is a potential checkpoint, filtered once the whole frame has been read
+    if(m_State == READING && context == QUEUE_SUBMIT)
+    {
+      CheckpointPosition pos = {m_pSerialiser->GetOffset(), m_RootEventID};
+      m_CheckpointPositions.push_back(pos);
+    }
   }
 
   if(m_State == READING)
   {
+    FinaliseCheckpointPositions();
+
     GetFrameRecord().drawcallList = m_ParentDrawcall.Bake();
 
     SetupDrawcallPointers(&m_Drawcalls, GetFrameRecord().drawcallList, NULL, NULL);
@@ -1881,6 +1851,8 @@ void WrappedVulkan::ContextReplayLog(LogState readType, uint32_t startEventID, u
 
   m_RerecordCmds.clear();
 
+  m_ResumeCheckpoint = NULL;
+
   m_State = READING;
 }
 
@@ -2322,12 +2294,19 @@ void WrappedVulkan::ProcessChunk(uint64_t offset, VulkanChunkType context)
   }
 }
 
-void WrappedVulkan::ReplayLog(uint32_t startEventID, uint32_t endEventID, ReplayLogType replayType)
+bool WrappedVulkan::CanContinueReplay(uint32_t eventID)
 {
-  uint64_t offs = m_FrameRecord.frameInfo.fileOffset;
+  // following events can only be recorded on from the tracked state inside the command buffer that
+  // the last replay ended in. Secondary command buffers are executed as a whole by their
+  // vkCmdExecuteCommands, so their events can't be stepped through one at a time.
+  const PartialReplayData &p = m_Partial[Primary];
 
-  m_pSerialiser->SetOffset(offs);
+  return p.baseEvent != 0 && !p.executesSecondaries && p.baseEvent <= m_ReplayedEventID &&
+         eventID < p.baseEvent + p.eventCount;
+}
 
+void WrappedVulkan::ReplayLog(uint32_t startEventID, uint32_t endEventID, ReplayLogType replayType)
+{
   bool partial = true;
 
   if(startEventID == 0 && (replayType == eReplay_WithoutDraw || replayType == eReplay_Full))
@@ -2336,6 +2315,51 @@ void WrappedVulkan::ReplayLog(uint32_t startEventID, uint32_t endEventID, Replay
     partial = false;
   }
 
+  // the last event that has been executed once this replay is done
+  const uint32_t lastEventID =
+      replayType == eReplay_WithoutDraw ? RDCMAX(1U, endEventID) - 1 : endEventID;
+
+  // if the replayed state is already at an earlier event, only the events after it need to be
+  // executed instead of starting over from the beginning of the frame.
+  bool continuing = false;
+
+  if(m_ReplayedEventID != 0 && m_DrawcallCallback == NULL)
+  {
+    if(!partial && m_ReplayedEventID <= lastEventID)
+    {
+      // IDs without an event of their own, like pop markers, don't replay anything
+      uint32_t nextEventID = m_ReplayedEventID + 1;
+      while(nextEventID <= lastEventID && GetEvent(nextEventID).eventID != nextEventID)
+        nextEventID++;
+
+      if(nextEventID > lastEventID)
+      {
+        m_ReplayedEventID = lastEventID;
+        return;
+      }
+
+      if(CanContinueReplay(lastEventID))
+      {
+        startEventID = nextEventID;
+        endEventID = lastEventID;
+        replayType = eReplay_Full;
+        partial = true;
+        continuing = true;
+      }
+    }
+    else if(partial && replayType == eReplay_OnlyDraw &&
+            (startEventID == 0 || startEventID == endEventID) &&
+            endEventID == m_ReplayedEventID + 1 && GetEvent(endEventID).eventID == endEventID &&
+            CanContinueReplay(endEventID))
+    {
+      continuing = true;
+    }
+  }
+
+  uint64_t offs = m_FrameRecord.frameInfo.fileOffset;
+
+  m_pSerialiser->SetOffset(offs);
+
   VulkanChunkType header = (VulkanChunkType)m_pSerialiser->PushContext(NULL, NULL, 1, false);
 
   RDCASSERTEQUAL(header, CAPTURE_SCOPE);
@@ -2346,7 +2370,12 @@ void WrappedVulkan::ReplayLog(uint32_t startEventID, uint32_t endEventID, Replay
 
   if(!partial)
   {
-    ApplyInitialContents();
+    m_ResumeCheckpoint = FindCheckpoint(
+        replayType == eReplay_WithoutDraw ? RDCMAX(1U, endEventID) - 1 : endEventID);
+
+    // the checkpoint is applied after the frame's image layouts have been restored
+    if(m_ResumeCheckpoint == NULL)
+      ApplyInitialContents();
 
     SubmitCmds();
     FlushQ();
@@ -2448,15 +2477,32 @@ void WrappedVulkan::ReplayLog(uint32_t startEventID, uint32_t endEventID, Replay
       if(m_Partial[Primary].renderPassActive)
         m_RenderState.EndRenderPass(cmd);
 
+      // a single draw doesn't move the state on if it began or ended a render pass, as we want
+      // to keep the partial replay data state intact for it to be replayed again.
+      if(replayType == eReplay_OnlyDraw && m_Partial[Primary].renderPassActive != rpWasActive)
+        continuing = false;
+
       // we might have replayed a CmdBeginRenderPass or CmdEndRenderPass,
       // but we want to keep the partial replay data state intact, so restore
-      // whether or not a render pass was active.
-      m_Partial[Primary].renderPassActive = rpWasActive;
+      // whether or not a render pass was active. If we're carrying the state
+      // on to a later event, the render pass stays as it now is.
+      if(!continuing)
+        m_Partial[Primary].renderPassActive = rpWasActive;
 
       ObjDisp(cmd)->EndCommandBuffer(Unwrap(cmd));
 
       SubmitCmds();
 
+      // the barriers recorded into our command buffer have now happened. When carrying the state
+      // on, the tracked layouts must match so the next step's implicit barriers start from them.
+      vector<pair<ResourceId, ImageRegionState> > &barriers =
+          m_BakedCmdBufferInfo[GetResID(cmd)].imgbarriers;
+
+      if(continuing)
+        GetResourceManager()->ApplyBarriers(barriers, m_ImageLayouts);
+
+      barriers.clear();
+
       m_Partial[Primary].outsideCmdBuffer = VK_NULL_HANDLE;
     }
 
@@ -2464,6 +2510,13 @@ void WrappedVulkan::ReplayLog(uint32_t startEventID, uint32_t endEventID, Replay
     SubmitCmds();
 #endif
   }
+
+  // a drawcall callback can modify what's replayed, and any other partial replay might replay
+  // events out of order, so in those cases the next replay has to start over.
+  if(m_DrawcallCallback == NULL && (!partial || continuing))
+    m_ReplayedEventID = lastEventID;
+  else
+    m_ReplayedEventID = 0;
 }
 
 void WrappedVulkan::Serialise_DebugMessages(Serialiser *localSerialiser, bool isDrawcall)
@@ -2868,7 +2921,10 @@ void WrappedVulkan::AddUsage(VulkanDrawcallTreeNode &drawNode, vector<DebugMessa
     const vector<BakedCmdBufferInfo::CmdBufferState::DescriptorAndOffsets> &descSets =
         (shad == 5 ? state.computeDescSets : state.graphicsDescSets);
 
-    RDCASSERT(sh.mapping);
+    ShaderBindpointMapping *mapping = sh.GetMapping();
+    ShaderReflection *refl = sh.GetReflection();
+
+    RDCASSERT(mapping);
 
     struct ResUsageType
     {
@@ -2878,9 +2934,9 @@ void WrappedVulkan::AddUsage(VulkanDrawcallTreeNode &drawNode, vector<DebugMessa
     };
 
     ResUsageType types[] = {
-        ResUsageType(sh.mapping->ReadOnlyResources, ResourceUsage::VS_Resource),
-        ResUsageType(sh.mapping->ReadWriteResources, ResourceUsage::VS_RWResource),
-        ResUsageType(sh.mapping->ConstantBlocks, ResourceUsage::VS_Constants),
+        ResUsageType(mapping->ReadOnlyResources, ResourceUsage::VS_Resource),
+        ResUsageType(mapping->ReadWriteResources, ResourceUsage::VS_RWResource),
+        ResUsageType(mapping->ConstantBlocks, ResourceUsage::VS_Constants),
     };
 
     DebugMessage msg;
@@ -2898,7 +2954,7 @@ void WrappedVulkan::AddUsage(VulkanDrawcallTreeNode &drawNode, vector<DebugMessa
           continue;
 
         // ignore push constants
-        if(t == 2 && !sh.refl->ConstantBlocks[i].bufferBacked)
+        if(t == 2 && !refl->ConstantBlocks[i].bufferBacked)
           continue;
 
         int32_t bindset = types[t].bindmap[i].bindset;
@@ -3075,13 +3131,21 @@ void WrappedVulkan::AddEvent(string description)
 
 APIEvent WrappedVulkan::GetEvent(uint32_t eventID)
 {
-  for(size_t i = m_Events.size() - 1; i > 0; i--)
+  // m_Events is sorted by eventID once the log has been read, so binary search for the last
+  // event at or before eventID
+  size_t lo = 1, hi = m_Events.size();
+
+  while(lo < hi)
   {
-    if(m_Events[i].eventID <= eventID)
-      return m_Events[i];
+    size_t mid = lo + (hi - lo) / 2;
+
+    if(m_Events[mid].eventID <= eventID)
+      lo = mid + 1;
+    else
+      hi = mid;
   }
 
-  return m_Events[0];
+  return m_Events[lo - 1];
 }
 
 const DrawcallDescription *WrappedVulkan::GetDrawcall(uint32_t eventID)
@@ -397,7 +397,8 @@ private:
           curEventID(0),
           drawCount(0),
           level(VK_COMMAND_BUFFER_LEVEL_PRIMARY),
-          beginFlags(0)
+          beginFlags(0),
+          recordOffset(0)
     {
     }
     ~BakedCmdBufferInfo() { SAFE_DELETE(draw); }
@@ -437,6 +438,7 @@ private:
     uint32_t eventCount;             // how many events are in this cmd buffer, for quick skipping
     uint32_t curEventID;             // current event ID while reading or executing
     uint32_t drawCount;              // similar to above
+    uint64_t recordOffset;           // file offset of the vkBeginCommandBuffer that recorded this
   };
 
   // on replay, the current command buffer for the last chunk we
@@ -480,6 +482,8 @@ private:
       outsideCmdBuffer = VK_NULL_HANDLE;
       partialParent = ResourceId();
       baseEvent = 0;
+      eventCount = 0;
+      executesSecondaries = false;
       renderPassActive = false;
     }
 
@@ -528,6 +532,12 @@ private:
     // event ID by subtracting this, to know how far to record
     uint32_t baseEvent;
 
+    // The number of events in the partial command buffer after baseEvent, and whether it executes
+    // any secondary command buffers. Lets a later replay know if it can carry on from inside the
+    // same command buffer.
+    uint32_t eventCount;
+    bool executesSecondaries;
+
     // If we're doing a partial record this bool tells us when we
     // reach the vkEndCommandBuffer that we also need to end a render
     // pass.
@@ -629,9 +639,74 @@ private:
                                 VulkanResourceManager::InitialContentData contents);
   bool Apply_SparseInitialState(WrappedVkImage *im,
                                 VulkanResourceManager::InitialContentData contents);
+  byte *MakeDescriptorSetWrites(VkDescriptorSet set, const DescSetLayout &layout,
+                                const DescriptorSetSlot *slots, uint32_t numElems,
+                                uint32_t &validBinds);
 
   void ApplyInitialContents();
 
+  // replay checkpoints, in vk_checkpoint.cpp. A checkpoint is a snapshot of the frame's dirty
+  // resources at a point between two queue submits, so that a replay to a later event can start
+  // from there instead of from the initial contents at the start of the frame.
+  struct CheckpointPosition
+  {
+    uint64_t fileOffset;
+    uint32_t eventID;
+  };
+
+  struct ReplayCheckpoint
+  {
+    CheckpointPosition pos;
+    uint64_t lastUse;
+
+    // a single allocation backs the snapshot images and the buffer holding memory contents
+    VkDeviceMemory mem;
+    VkDeviceSize size;
+
+    VkBuffer memContents;
+    vector<pair<ResourceId, VkDeviceSize> > memOffsets;
+    vector<pair<ResourceId, VkImage> > images;
+
+    map<ResourceId, ImageLayouts> layouts;
+    vector<pair<ResourceId, vector<DescriptorSetSlot> > > descSets;
+  };
+
+  struct CheckpointStats
+  {
+    uint32_t hits, misses, created, evicted;
+    uint64_t skippedEvents;
+  };
+
+  // places that replay can resume from, in file order
+  vector<CheckpointPosition> m_CheckpointPositions;
+  // while reading, the earliest command buffer recording used by each queue submit
+  vector<uint64_t> m_CheckpointSubmitRecords;
+  // descriptor sets that are updated during the frame, and so need to be snapshotted
+  std::set<ResourceId> m_CheckpointDescSets;
+
+  vector<ReplayCheckpoint *> m_Checkpoints;
+  ReplayCheckpoint *m_ResumeCheckpoint;
+  uint32_t m_CheckpointInterval;
+  uint64_t m_CheckpointBudget;
+  uint64_t m_CheckpointUsage;
+  uint64_t m_CheckpointTick;
+  bool m_CheckpointsUnsupported;
+  CheckpointStats m_CheckpointStats;
+
+  void FinaliseCheckpointPositions();
+  bool CheckpointsEnabled();
+  ReplayCheckpoint *FindCheckpoint(uint32_t eventID);
+  void CheckpointReplayPosition(uint64_t offset);
+  ReplayCheckpoint *TakeCheckpoint(const CheckpointPosition &pos);
+  void ApplyCheckpoint(ReplayCheckpoint *checkpoint);
+  void FreeCheckpoint(ReplayCheckpoint *checkpoint);
+
+  // the last event that the replayed state has executed everything up to, or 0 if the state
+  // doesn't match the frame at any event. Replaying forward from here only needs the events after.
+  uint32_t m_ReplayedEventID;
+
+  bool CanContinueReplay(uint32_t eventID);
+
   vector<APIEvent> m_RootEvents, m_Events;
   bool m_AddedDrawcall;
 
@@ -708,6 +783,10 @@ public:
   void Shutdown();
   void ReplayLog(uint32_t startEventID, uint32_t endEventID, ReplayLogType replayType);
   void ReadLogInitialisation();
+  void ClearReplayCheckpoints();
+  // called when the replayed state is modified outside of the frame's events, e.g. by an overlay,
+  // so that the next replay starts over instead of continuing on
+  void MarkReplayStateDirty() { m_ReplayedEventID = 0; }
 
   FrameRecord &GetFrameRecord() { return m_FrameRecord; }
   APIEvent GetEvent(uint32_t eventID);
@@ -328,11 +328,6 @@ VulkanDebugManager::VulkanDebugManager(WrappedVulkan *driver, VkDevice dev)
   m_MeshFetchDescSetLayout = VK_NULL_HANDLE;
   m_MeshFetchDescSet = VK_NULL_HANDLE;
 
-  m_MeshPickDescSetLayout = VK_NULL_HANDLE;
-  m_MeshPickDescSet = VK_NULL_HANDLE;
-  m_MeshPickLayout = VK_NULL_HANDLE;
-  m_MeshPickPipeline = VK_NULL_HANDLE;
-
   m_FontCharSize = 1.0f;
   m_FontCharAspect = 1.0f;
 
@@ -1396,35 +1391,6 @@ VulkanDebugManager::VulkanDebugManager(WrappedVulkan *driver, VkDevice dev)
     RDCASSERTEQUAL(vkr, VK_SUCCESS);
   }
 
-  {
-    VkDescriptorSetLayoutBinding layoutBinding[] = {
-        {
-            0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, VK_SHADER_STAGE_ALL, NULL,
-        },
-        {
-            1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_ALL, NULL,
-        },
-        {
-            2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_ALL, NULL,
-        },
-        {
-            3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_ALL, NULL,
-        },
-    };
-
-    VkDescriptorSetLayoutCreateInfo descsetLayoutInfo = {
-        VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
-        NULL,
-        0,
-        ARRAY_COUNT(layoutBinding),
-        &layoutBinding[0],
-    };
-
-    vkr = m_pDriver->vkCreateDescriptorSetLayout(dev, &descsetLayoutInfo, NULL,
-                                                 &m_MeshPickDescSetLayout);
-    RDCASSERTEQUAL(vkr, VK_SUCCESS);
-  }
-
   {
     VkDescriptorSetLayoutBinding layoutBinding[] = {
         {
@@ -1635,11 +1601,6 @@ VulkanDebugManager::VulkanDebugManager(WrappedVulkan *driver, VkDevice dev)
   vkr = m_pDriver->vkCreatePipelineLayout(dev, &pipeLayoutInfo, NULL, &m_HistogramPipeLayout);
   RDCASSERTEQUAL(vkr, VK_SUCCESS);
 
-  pipeLayoutInfo.pSetLayouts = &m_MeshPickDescSetLayout;
-
-  vkr = m_pDriver->vkCreatePipelineLayout(dev, &pipeLayoutInfo, NULL, &m_MeshPickLayout);
-  RDCASSERTEQUAL(vkr, VK_SUCCESS);
-
   descSetAllocInfo.pSetLayouts = &m_CheckerboardDescSetLayout;
   vkr = m_pDriver->vkAllocateDescriptorSets(dev, &descSetAllocInfo, &m_CheckerboardDescSet);
   RDCASSERTEQUAL(vkr, VK_SUCCESS);
@@ -1678,23 +1639,6 @@ VulkanDebugManager::VulkanDebugManager(WrappedVulkan *driver, VkDevice dev)
   vkr = m_pDriver->vkAllocateDescriptorSets(dev, &descSetAllocInfo, &m_MeshFetchDescSet);
   RDCASSERTEQUAL(vkr, VK_SUCCESS);
 
-  descSetAllocInfo.pSetLayouts = &m_MeshPickDescSetLayout;
-  vkr = m_pDriver->vkAllocateDescriptorSets(dev, &descSetAllocInfo, &m_MeshPickDescSet);
-  RDCASSERTEQUAL(vkr, VK_SUCCESS);
-
-  // sizes are always 0 so that these buffers are created on demand
-  m_MeshPickIBSize = 0;
-  m_MeshPickVBSize = 0;
-
-  m_MeshPickUBO.Create(driver, dev, 128, 1, 0);
-  RDCCOMPILE_ASSERT(sizeof(MeshPickUBOData) <= 128, "mesh pick UBO size");
-
-  const size_t meshPickResultSize = maxMeshPicks * sizeof(FloatVector) + sizeof(uint32_t);
-
-  m_MeshPickResult.Create(driver, dev, meshPickResultSize, 1,
-                          GPUBuffer::eGPUBufferGPULocal | GPUBuffer::eGPUBufferSSBO);
-  m_MeshPickResultReadback.Create(driver, dev, meshPickResultSize, 1, GPUBuffer::eGPUBufferReadback);
-
   m_ReadbackWindow.Create(driver, dev, STAGE_BUFFER_BYTE_SIZE, 1, GPUBuffer::eGPUBufferReadback);
 
   m_OutlineUBO.Create(driver, dev, 128, 10, 0);
@@ -1712,15 +1656,14 @@ VulkanDebugManager::VulkanDebugManager(WrappedVulkan *driver, VkDevice dev)
       GetEmbeddedResource(glsl_minmaxtile_comp),  GetEmbeddedResource(glsl_minmaxresult_comp),
       GetEmbeddedResource(glsl_histogram_comp),   GetEmbeddedResource(glsl_outline_frag),
       GetEmbeddedResource(glsl_quadresolve_frag), GetEmbeddedResource(glsl_quadwrite_frag),
-      GetEmbeddedResource(glsl_mesh_comp),        GetEmbeddedResource(glsl_ms2array_comp),
-      GetEmbeddedResource(glsl_array2ms_comp),    GetEmbeddedResource(glsl_trisize_geom),
-      GetEmbeddedResource(glsl_trisize_frag),
+      GetEmbeddedResource(glsl_ms2array_comp),    GetEmbeddedResource(glsl_array2ms_comp),
+      GetEmbeddedResource(glsl_trisize_geom),     GetEmbeddedResource(glsl_trisize_frag),
   };
 
   SPIRVShaderStage shaderStages[] = {
       eSPIRVVertex,  eSPIRVFragment, eSPIRVFragment, eSPIRVVertex,   eSPIRVGeometry, eSPIRVFragment,
       eSPIRVCompute, eSPIRVCompute,  eSPIRVCompute,  eSPIRVFragment, eSPIRVFragment, eSPIRVFragment,
-      eSPIRVCompute, eSPIRVCompute,  eSPIRVCompute,  eSPIRVGeometry, eSPIRVFragment,
+      eSPIRVCompute, eSPIRVCompute,  eSPIRVGeometry, eSPIRVFragment,
   };
 
   enum shaderIdx
@@ -1737,7 +1680,6 @@ VulkanDebugManager::VulkanDebugManager(WrappedVulkan *driver, VkDevice dev)
     OUTLINEFS,
     QUADRESOLVEFS,
     QUADWRITEFS,
-    MESHCS,
     MS2ARRAYCS,
     ARRAY2MSCS,
     TRISIZEGS,
@@ -1974,15 +1916,6 @@ VulkanDebugManager::VulkanDebugManager(WrappedVulkan *driver, VkDevice dev)
     }
   }
 
-  {
-    compPipeInfo.stage.module = module[MESHCS];
-    compPipeInfo.layout = m_MeshPickLayout;
-
-    vkr = m_pDriver->vkCreateComputePipelines(dev, VK_NULL_HANDLE, 1, &compPipeInfo, NULL,
-                                              &m_MeshPickPipeline);
-    RDCASSERTEQUAL(vkr, VK_SUCCESS);
-  }
-
   if(!texelFetchBrokenDriver && m_pDriver->GetDeviceFeatures().shaderStorageImageMultisample &&
      m_pDriver->GetDeviceFeatures().shaderStorageImageWriteWithoutFormat)
   {
@@ -2417,8 +2350,6 @@ VulkanDebugManager::VulkanDebugManager(WrappedVulkan *driver, VkDevice dev)
   m_MeshUBO.FillDescriptor(bufInfo[1]);
   m_OutlineUBO.FillDescriptor(bufInfo[2]);
   m_OverdrawRampUBO.FillDescriptor(bufInfo[3]);
-  m_MeshPickUBO.FillDescriptor(bufInfo[4]);
-  m_MeshPickResult.FillDescriptor(bufInfo[5]);
 
   VkWriteDescriptorSet analysisSetWrites[] = {
       {VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET, NULL, Unwrap(m_CheckerboardDescSet), 0, 0, 1,
@@ -2429,10 +2360,6 @@ VulkanDebugManager::VulkanDebugManager(WrappedVulkan *driver, VkDevice dev)
        VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, NULL, &bufInfo[2], NULL},
       {VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET, NULL, Unwrap(m_QuadDescSet), 1, 0, 1,
        VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, NULL, &bufInfo[3], NULL},
-      {VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET, NULL, Unwrap(m_MeshPickDescSet), 0, 0, 1,
-       VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, NULL, &bufInfo[4], NULL},
-      {VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET, NULL, Unwrap(m_MeshPickDescSet), 3, 0, 1,
-       VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, NULL, &bufInfo[5], NULL},
       {VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET, NULL, Unwrap(m_TriSizeDescSet), 1, 0, 1,
        VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, NULL, &bufInfo[3], NULL},
   };
@@ -2588,18 +2515,6 @@ VulkanDebugManager::~VulkanDebugManager()
 
   m_OverdrawRampUBO.Destroy();
 
-  m_MeshPickUBO.Destroy();
-  m_MeshPickIB.Destroy();
-  m_MeshPickIBUpload.Destroy();
-  m_MeshPickVB.Destroy();
-  m_MeshPickVBUpload.Destroy();
-  m_MeshPickResult.Destroy();
-  m_MeshPickResultReadback.Destroy();
-
-  m_pDriver->vkDestroyDescriptorSetLayout(dev, m_MeshPickDescSetLayout, NULL);
-  m_pDriver->vkDestroyPipelineLayout(dev, m_MeshPickLayout, NULL);
-  m_pDriver->vkDestroyPipeline(dev, m_MeshPickPipeline, NULL);
-
   m_pDriver->vkDestroyDescriptorSetLayout(dev, m_MeshFetchDescSetLayout, NULL);
   m_pDriver->vkDestroyFramebuffer(dev, m_OverlayNoDepthFB, NULL);
   m_pDriver->vkDestroyRenderPass(dev, m_OverlayNoDepthRP, NULL);
@@ -3874,435 +3789,6 @@ void VulkanDebugManager::CopyDepthArrayToTex2DMS(VkImage destMS, VkImage srcArra
   SAFE_DELETE_ARRAY(fb);
 }
 
-// TODO: Point meshes don't pick correctly
-uint32_t VulkanDebugManager::PickVertex(uint32_t eventID, const MeshDisplay &cfg, uint32_t x,
-                                        uint32_t y, uint32_t w, uint32_t h)
-{
-  VkDevice dev = m_pDriver->GetDev();
-  const VkLayerDispatchTable *vt = ObjDisp(dev);
-
-  Matrix4f projMat = Matrix4f::Perspective(90.0f, 0.1f, 100000.0f, float(w) / float(h));
-
-  Matrix4f camMat = cfg.cam ? cfg.cam->GetMatrix() : Matrix4f::Identity();
-  Matrix4f pickMVP = projMat.Mul(camMat);
-
-  ResourceFormat resFmt;
-  resFmt.compByteWidth = cfg.position.compByteWidth;
-  resFmt.compCount = cfg.position.compCount;
-  resFmt.compType = cfg.position.compType;
-  resFmt.special = false;
-  if(cfg.position.specialFormat != SpecialFormat::Unknown)
-  {
-    resFmt.special = true;
-    resFmt.specialFormat = cfg.position.specialFormat;
-  }
-
-  Matrix4f pickMVPProj;
-  if(cfg.position.unproject)
-  {
-    // the derivation of the projection matrix might not be right (hell, it could be an
-    // orthographic projection). But it'll be close enough likely.
-    Matrix4f guessProj =
-        cfg.position.farPlane != FLT_MAX
-            ? Matrix4f::Perspective(cfg.fov, cfg.position.nearPlane, cfg.position.farPlane, cfg.aspect)
-            : Matrix4f::ReversePerspective(cfg.fov, cfg.position.nearPlane, cfg.aspect);
-
-    if(cfg.ortho)
-      guessProj = Matrix4f::Orthographic(cfg.position.nearPlane, cfg.position.farPlane);
-
-    pickMVPProj = projMat.Mul(camMat.Mul(guessProj.Inverse()));
-  }
-
-  vec3 rayPos;
-  vec3 rayDir;
-  // convert mouse pos to world space ray
-  {
-    Matrix4f inversePickMVP = pickMVP.Inverse();
-
-    float pickX = ((float)x) / ((float)w);
-    float pickXCanonical = RDCLERP(-1.0f, 1.0f, pickX);
-
-    float pickY = ((float)y) / ((float)h);
-    // flip the Y axis
-    float pickYCanonical = RDCLERP(1.0f, -1.0f, pickY);
-
-    vec3 cameraToWorldNearPosition =
-        inversePickMVP.Transform(Vec3f(pickXCanonical, pickYCanonical, -1), 1);
-
-    vec3 cameraToWorldFarPosition =
-        inversePickMVP.Transform(Vec3f(pickXCanonical, pickYCanonical, 1), 1);
-
-    vec3 testDir = (cameraToWorldFarPosition - cameraToWorldNearPosition);
-    testDir.Normalise();
-
-    /* Calculate the ray direction first in the regular way (above), so we can use the
-    the output for testing if the ray we are picking is negative or not. This is similar
-    to checking against the forward direction of the camera, but more robust
-    */
-    if(cfg.position.unproject)
-    {
-      Matrix4f inversePickMVPGuess = pickMVPProj.Inverse();
-
-      vec3 nearPosProj = inversePickMVPGuess.Transform(Vec3f(pickXCanonical, pickYCanonical, -1), 1);
-
-      vec3 farPosProj = inversePickMVPGuess.Transform(Vec3f(pickXCanonical, pickYCanonical, 1), 1);
-
-      rayDir = (farPosProj - nearPosProj);
-      rayDir.Normalise();
-
-      if(testDir.z < 0)
-      {
-        rayDir = -rayDir;
-      }
-      rayPos = nearPosProj;
-    }
-    else
-    {
-      rayDir = testDir;
-      rayPos = cameraToWorldNearPosition;
-    }
-  }
-
-  MeshPickUBOData *ubo = (MeshPickUBOData *)m_MeshPickUBO.Map();
-
-  ubo->rayPos = rayPos;
-  ubo->rayDir = rayDir;
-  ubo->use_indices = cfg.position.idxByteWidth ? 1U : 0U;
-  ubo->numVerts = cfg.position.numVerts;
-  bool isTriangleMesh = true;
-
-  switch(cfg.position.topo)
-  {
-    case Topology::TriangleList:
-    {
-      ubo->meshMode = MESH_TRIANGLE_LIST;
-      break;
-    };
-    case Topology::TriangleStrip:
-    {
-      ubo->meshMode = MESH_TRIANGLE_STRIP;
-      break;
-    };
-    case Topology::TriangleFan:
-    {
-      ubo->meshMode = MESH_TRIANGLE_FAN;
-      break;
-    };
-    case Topology::TriangleList_Adj:
-    {
-      ubo->meshMode = MESH_TRIANGLE_LIST_ADJ;
-      break;
-    };
-    case Topology::TriangleStrip_Adj:
-    {
-      ubo->meshMode = MESH_TRIANGLE_STRIP_ADJ;
-      break;
-    };
-    default:    // points, lines, patchlists, unknown
-    {
-      ubo->meshMode = MESH_OTHER;
-      isTriangleMesh = false;
-    };
-  }
-
-  // line/point data
-  ubo->unproject = cfg.position.unproject;
-  ubo->mvp = cfg.position.unproject ? pickMVPProj : pickMVP;
-  ubo->coords = Vec2f((float)x, (float)y);
-  ubo->viewport = Vec2f((float)w, (float)h);
-
-  m_MeshPickUBO.Unmap();
-
-  vector<byte> idxs;
-
-  if(cfg.position.idxByteWidth && cfg.position.idxbuf != ResourceId())
-    GetBufferData(cfg.position.idxbuf, cfg.position.idxoffs, 0, idxs);
-
-  // We copy into our own buffers to promote to the target type (uint32) that the
-  // shader expects. Most IBs will be 16-bit indices, most VBs will not be float4.
-
-  if(!idxs.empty())
-  {
-    // resize up on demand
-    if(m_MeshPickIBSize < cfg.position.numVerts * sizeof(uint32_t))
-    {
-      if(m_MeshPickIBSize > 0)
-      {
-        m_MeshPickIB.Destroy();
-        m_MeshPickIBUpload.Destroy();
-      }
-
-      m_MeshPickIBSize = cfg.position.numVerts * sizeof(uint32_t);
-
-      m_MeshPickIB.Create(m_pDriver, dev, m_MeshPickIBSize, 1,
-                          GPUBuffer::eGPUBufferGPULocal | GPUBuffer::eGPUBufferSSBO);
-      m_MeshPickIBUpload.Create(m_pDriver, dev, m_MeshPickIBSize, 1, 0);
-    }
-
-    uint32_t *outidxs = (uint32_t *)m_MeshPickIBUpload.Map();
-
-    memset(outidxs, 0, m_MeshPickIBSize);
-
-    uint16_t *idxs16 = (uint16_t *)&idxs[0];
-    uint32_t *idxs32 = (uint32_t *)&idxs[0];
-
-    // if indices are 16-bit, manually upcast them so the shader only
-    // has to deal with one type
-    if(cfg.position.idxByteWidth == 2)
-    {
-      size_t bufsize = idxs.size() / 2;
-
-      for(uint32_t i = 0; i < bufsize && i < cfg.position.numVerts; i++)
-        outidxs[i] = idxs16[i];
-    }
-    else
-    {
-      size_t bufsize = idxs.size() / 4;
-
-      memcpy(outidxs, idxs32, RDCMIN(bufsize, cfg.position.numVerts * sizeof(uint32_t)));
-    }
-
-    m_MeshPickIBUpload.Unmap();
-  }
-
-  if(m_MeshPickVBSize < cfg.position.numVerts * sizeof(FloatVector))
-  {
-    if(m_MeshPickVBSize > 0)
-    {
-      m_MeshPickVB.Destroy();
-      m_MeshPickVBUpload.Destroy();
-    }
-
-    m_MeshPickVBSize = cfg.position.numVerts * sizeof(FloatVector);
-
-    m_MeshPickVB.Create(m_pDriver, dev, m_MeshPickVBSize, 1,
-                        GPUBuffer::eGPUBufferGPULocal | GPUBuffer::eGPUBufferSSBO);
-    m_MeshPickVBUpload.Create(m_pDriver, dev, m_MeshPickVBSize, 1, 0);
-  }
-
-  // unpack and linearise the data
-  {
-    vector<byte> oldData;
-    GetBufferData(cfg.position.buf, cfg.position.offset, 0, oldData);
-
-    byte *data = &oldData[0];
-    byte *dataEnd = data + oldData.size();
-
-    bool valid = true;
-
-    FloatVector *vbData = (FloatVector *)m_MeshPickVBUpload.Map();
-
-    uint32_t idxclamp = 0;
-    if(cfg.position.baseVertex < 0)
-      idxclamp = uint32_t(-cfg.position.baseVertex);
-
-    for(uint32_t i = 0; i < cfg.position.numVerts; i++)
-    {
-      uint32_t idx = i;
-
-      // apply baseVertex but clamp to 0 (don't allow index to become negative)
-      if(idx < idxclamp)
-        idx = 0;
-      else if(cfg.position.baseVertex < 0)
-        idx -= idxclamp;
-      else if(cfg.position.baseVertex > 0)
-        idx += cfg.position.baseVertex;
-
-      vbData[i] = HighlightCache::InterpretVertex(data, idx, cfg, dataEnd, valid);
-    }
-
-    m_MeshPickVBUpload.Unmap();
-  }
-
-  VkDescriptorBufferInfo ibInfo = {};
-  VkDescriptorBufferInfo vbInfo = {};
-
-  m_MeshPickVB.FillDescriptor(vbInfo);
-  m_MeshPickIB.FillDescriptor(ibInfo);
-
-  VkWriteDescriptorSet writes[] = {
-      {VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET, NULL, Unwrap(m_MeshPickDescSet), 1, 0, 1,
-       VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, NULL, &vbInfo, NULL},
-      {VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET, NULL, Unwrap(m_MeshPickDescSet), 2, 0, 1,
-       VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, NULL, &ibInfo, NULL},
-  };
-
-  if(!idxs.empty())
-    vt->UpdateDescriptorSets(Unwrap(m_Device), 2, writes, 0, NULL);
-  else
-    vt->UpdateDescriptorSets(Unwrap(m_Device), 1, writes, 0, NULL);
-
-  VkCommandBuffer cmd = m_pDriver->GetNextCmd();
-
-  VkCommandBufferBeginInfo beginInfo = {VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO, NULL,
-                                        VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT};
-
-  VkBufferCopy bufCopy = {0, 0, 0};
-
-  vt->BeginCommandBuffer(Unwrap(cmd), &beginInfo);
-
-  // reset first uint (used as atomic counter) to 0
-  vt->CmdFillBuffer(Unwrap(cmd), Unwrap(m_MeshPickResult.buf), 0, sizeof(uint32_t) * 4, 0);
-
-  VkBufferMemoryBarrier bufBarrier = {
-      VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
-      NULL,
-      VK_ACCESS_TRANSFER_WRITE_BIT,
-      VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_READ_BIT,
-      VK_QUEUE_FAMILY_IGNORED,
-      VK_QUEUE_FAMILY_IGNORED,
-      Unwrap(m_MeshPickResult.buf),
-      0,
-      VK_WHOLE_SIZE,
-  };
-
-  // wait for zero to be written to atomic counter before using in shader
-  DoPipelineBarrier(cmd, 1, &bufBarrier);
-
-  // copy uploaded VB and if needed IB
-  if(!idxs.empty())
-  {
-    // wait for writes
-    bufBarrier.buffer = Unwrap(m_MeshPickIBUpload.buf);
-    bufBarrier.srcAccessMask = VK_ACCESS_HOST_WRITE_BIT;
-    bufBarrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
-    DoPipelineBarrier(cmd, 1, &bufBarrier);
-
-    // do copy
-    bufCopy.size = m_MeshPickIBSize;
-    vt->CmdCopyBuffer(Unwrap(cmd), Unwrap(m_MeshPickIBUpload.buf), Unwrap(m_MeshPickIB.buf), 1,
-                      &bufCopy);
-
-    // wait for copy
-    bufBarrier.buffer = Unwrap(m_MeshPickIB.buf);
-    bufBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-    bufBarrier.dstAccessMask = VK_ACCESS_UNIFORM_READ_BIT;
-    DoPipelineBarrier(cmd, 1, &bufBarrier);
-  }
-
-  // wait for writes
-  bufBarrier.buffer = Unwrap(m_MeshPickVBUpload.buf);
-  bufBarrier.srcAccessMask = VK_ACCESS_HOST_WRITE_BIT;
-  bufBarrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
-  DoPipelineBarrier(cmd, 1, &bufBarrier);
-
-  // do copy
-  bufCopy.size = m_MeshPickVBSize;
-  vt->CmdCopyBuffer(Unwrap(cmd), Unwrap(m_MeshPickVBUpload.buf), Unwrap(m_MeshPickVB.buf), 1,
-                    &bufCopy);
-
-  // wait for copy
-  bufBarrier.buffer = Unwrap(m_MeshPickVB.buf);
-  bufBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-  bufBarrier.dstAccessMask = VK_ACCESS_UNIFORM_READ_BIT;
-  DoPipelineBarrier(cmd, 1, &bufBarrier);
-
-  vt->CmdBindPipeline(Unwrap(cmd), VK_PIPELINE_BIND_POINT_COMPUTE, Unwrap(m_MeshPickPipeline));
-  vt->CmdBindDescriptorSets(Unwrap(cmd), VK_PIPELINE_BIND_POINT_COMPUTE, Unwrap(m_MeshPickLayout),
-                            0, 1, UnwrapPtr(m_MeshPickDescSet), 0, NULL);
-
-  uint32_t workgroupx = uint32_t(cfg.position.numVerts / 128 + 1);
-  vt->CmdDispatch(Unwrap(cmd), workgroupx, 1, 1);
-
-  // wait for shader to finish writing before transferring to readback buffer
-  bufBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
-  bufBarrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
-  bufBarrier.buffer = Unwrap(m_MeshPickResult.buf);
-  DoPipelineBarrier(cmd, 1, &bufBarrier);
-
-  bufCopy.size = m_MeshPickResult.totalsize;
-
-  // copy to readback buffer
-  vt->CmdCopyBuffer(Unwrap(cmd), Unwrap(m_MeshPickResult.buf), Unwrap(m_MeshPickResultReadback.buf),
-                    1, &bufCopy);
-
-  // wait for transfer to finish before reading on CPU
-  bufBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-  bufBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
-  bufBarrier.buffer = Unwrap(m_MeshPickResultReadback.buf);
-  DoPipelineBarrier(cmd, 1, &bufBarrier);
-
-  VkResult vkr = vt->EndCommandBuffer(Unwrap(cmd));
-  RDCASSERTEQUAL(vkr, VK_SUCCESS);
-
-#if ENABLED(SINGLE_FLUSH_VALIDATE)
-  m_pDriver->SubmitCmds();
-#endif
-
-  m_pDriver->SubmitCmds();
-  m_pDriver->FlushQ();
-
-  uint32_t *pickResultData = (uint32_t *)m_MeshPickResultReadback.Map();
-  uint32_t numResults = *pickResultData;
-
-  uint32_t ret = ~0U;
-
-  if(numResults > 0)
-  {
-    if(isTriangleMesh)
-    {
-      struct PickResult
-      {
-        uint32_t vertid;
-        vec3 intersectionPoint;
-      };
-
-      PickResult *pickResults = (PickResult *)(pickResultData + 4);
-
-      PickResult *closest = pickResults;
-      // distance from raycast hit to nearest worldspace position of the mouse
-      float closestPickDistance = (closest->intersectionPoint - rayPos).Length();
-
-      // min with size of results buffer to protect against overflows
-      for(uint32_t i = 1; i < RDCMIN((uint32_t)maxMeshPicks, numResults); i++)
-      {
-        float pickDistance = (pickResults[i].intersectionPoint - rayPos).Length();
-        if(pickDistance < closestPickDistance)
-        {
-          closest = pickResults + i;
-        }
-      }
-      ret = closest->vertid;
-    }
-    else
-    {
-      struct PickResult
-      {
-        uint32_t vertid;
-        uint32_t idx;
-        float len;
-        float depth;
-      };
-
-      PickResult *pickResults = (PickResult *)(pickResultData + 4);
-
-      PickResult *closest = pickResults;
-
-      // min with size of results buffer to protect against overflows
-      for(uint32_t i = 1; i < RDCMIN((uint32_t)maxMeshPicks, numResults); i++)
-      {
-        // We need to keep the picking order consistent in the face
-        // of random buffer appends, when multiple vertices have the
-        // identical position (e.g. if UVs or normals are different).
-        //
-        // We could do something to try and disambiguate, but it's
-        // never going to be intuitive, it's just going to flicker
-        // confusingly.
-        if(pickResults[i].len < closest->len ||
-           (pickResults[i].len == closest->len && pickResults[i].depth < closest->depth) ||
-           (pickResults[i].len == closest->len && pickResults[i].depth == closest->depth &&
-            pickResults[i].vertid < closest->vertid))
-          closest = pickResults + i;
-      }
-      ret = closest->vertid;
-    }
-  }
-
-  m_MeshPickResultReadback.Unmap();
-
-  return ret;
-}
-
 void VulkanDebugManager::EndText(const TextPrintState &textstate)
 {
   ObjDisp(textstate.cmd)->CmdEndRenderPass(Unwrap(textstate.cmd));
@@ -7858,10 +7344,10 @@ void VulkanDebugManager::InitPostVSBuffers(uint32_t eventID)
   if(pipeInfo.shaders[0].module == ResourceId())
     return;
 
-  const VulkanCreationInfo::ShaderModule &moduleInfo =
+  VulkanCreationInfo::ShaderModule &moduleInfo =
       creationInfo.m_ShaderModule[pipeInfo.shaders[0].module];
 
-  ShaderReflection *refl = pipeInfo.shaders[0].refl;
+  ShaderReflection *refl = pipeInfo.shaders[0].GetReflection();
 
   // no outputs from this shader? unexpected but theoretically possible (dummy VS before
   // tessellation maybe). Just fill out an empty data set
@@ -8128,7 +7614,7 @@ void VulkanDebugManager::InitPostVSBuffers(uint32_t eventID)
   }
 
   uint32_t bufStride = 0;
-  vector<uint32_t> modSpirv = moduleInfo.spirv.spirv;
+  vector<uint32_t> modSpirv = moduleInfo.GetCode();
 
   AddOutputDumping(*refl, pipeInfo.shaders[0].entryPoint.c_str(), descSet, vertexIndexOffset,
                    drawcall->instanceOffset, numVerts, modSpirv, bufStride);
@@ -120,9 +120,6 @@ public:
   MeshFormat GetPostVSBuffers(uint32_t eventID, uint32_t instID, MeshDataStage stage);
   void GetBufferData(ResourceId buff, uint64_t offset, uint64_t len, vector<byte> &ret);
 
-  uint32_t PickVertex(uint32_t eventID, const MeshDisplay &cfg, uint32_t x, uint32_t y, uint32_t w,
-                      uint32_t h);
-
   void CopyTex2DMSToArray(VkImage destArray, VkImage srcMS, VkExtent3D extent, uint32_t layers,
                           uint32_t samples, VkFormat fmt);
   void CopyArrayToTex2DMS(VkImage destMS, VkImage srcArray, VkExtent3D extent, uint32_t layers,
@@ -305,18 +302,6 @@ public:
   VkPipeline m_MinMaxTilePipe[eTexType_Max][3];    // float, uint, sint
   VkPipeline m_MinMaxResultPipe[3];                // float, uint, sint
 
-  static const int maxMeshPicks = 500;
-
-  GPUBuffer m_MeshPickUBO;
-  GPUBuffer m_MeshPickIB, m_MeshPickIBUpload;
-  GPUBuffer m_MeshPickVB, m_MeshPickVBUpload;
-  uint32_t m_MeshPickIBSize, m_MeshPickVBSize;
-  GPUBuffer m_MeshPickResult, m_MeshPickResultReadback;
-  VkDescriptorSetLayout m_MeshPickDescSetLayout;
-  VkDescriptorSet m_MeshPickDescSet;
-  VkPipelineLayout m_MeshPickLayout;
-  VkPipeline m_MeshPickPipeline;
-
   VkDescriptorSetLayout m_OutlineDescSetLayout;
   VkPipelineLayout m_OutlinePipeLayout;
   VkDescriptorSet m_OutlineDescSet;
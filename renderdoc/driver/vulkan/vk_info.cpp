@@ -24,6 +24,9 @@
 
 #include "vk_info.h"
 #include "3rdparty/glslang/SPIRV/spirv.hpp"
+#include "common/threading.h"
+#include "common/timing.h"
+#include "vk_shader_cache.h"
 
 void DescSetLayout::Init(VulkanResourceManager *resourceMan, VulkanCreationInfo &info,
                          const VkDescriptorSetLayoutCreateInfo *pCreateInfo)
@@ -105,15 +108,7 @@ void VulkanCreationInfo::Pipeline::Init(VulkanResourceManager *resourceMan, Vulk
     shad.module = id;
     shad.entryPoint = pCreateInfo->pStages[i].pName;
 
-    ShaderModule::Reflection &reflData = info.m_ShaderModule[id].m_Reflections[shad.entryPoint];
-
-    if(reflData.entryPoint.empty())
-    {
-      reflData.entryPoint = shad.entryPoint;
-      reflData.stage = stageIndex;
-      info.m_ShaderModule[id].spirv.MakeReflection(ShaderStage(reflData.stage), reflData.entryPoint,
-                                                   &reflData.refl, &reflData.mapping);
-    }
+    shad.reflData = &info.m_ShaderModule[id].GetReflection(shad.entryPoint, stageIndex);
 
     if(pCreateInfo->pStages[i].pSpecializationInfo)
     {
@@ -132,9 +127,6 @@ void VulkanCreationInfo::Pipeline::Init(VulkanResourceManager *resourceMan, Vulk
         shad.specialization.push_back(spec);
       }
     }
-
-    shad.refl = &reflData.refl;
-    shad.mapping = &reflData.mapping;
   }
 
   if(pCreateInfo->pVertexInputState)
@@ -320,14 +312,7 @@ void VulkanCreationInfo::Pipeline::Init(VulkanResourceManager *resourceMan, Vulk
     shad.module = id;
     shad.entryPoint = pCreateInfo->stage.pName;
 
-    ShaderModule::Reflection &reflData = info.m_ShaderModule[id].m_Reflections[shad.entryPoint];
-
-    if(reflData.entryPoint.empty())
-    {
-      reflData.entryPoint = shad.entryPoint;
-      info.m_ShaderModule[id].spirv.MakeReflection(ShaderStage::Compute, reflData.entryPoint,
-                                                   &reflData.refl, &reflData.mapping);
-    }
+    shad.reflData = &info.m_ShaderModule[id].GetReflection(shad.entryPoint, 5);
 
     if(pCreateInfo->stage.pSpecializationInfo)
     {
@@ -344,9 +329,6 @@ void VulkanCreationInfo::Pipeline::Init(VulkanResourceManager *resourceMan, Vulk
         shad.specialization.push_back(spec);
       }
     }
-
-    shad.refl = &reflData.refl;
-    shad.mapping = &reflData.mapping;
   }
 
   topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
@@ -560,10 +542,76 @@ void VulkanCreationInfo::ImageView::Init(VulkanResourceManager *resourceMan, Vul
   swizzle[3] = Convert(pCreateInfo->components.a, 3);
 }
 
+static const uint32_t MaxShaderParseThreads = 8;
+
+struct VulkanCreationInfo::ShaderParsePool
+{
+  ShaderParsePool() : next(0), finishing(0), parseTime(0.0), numParsed(0) {}
+
+  Threading::CriticalSection lock;
+
+  // modules are taken from the queue in order. A module may already have been parsed on the replay
+  // thread by the time a worker reaches it, in which case it's skipped
+  vector<ShaderModule *> queue;
+  size_t next;
+
+  vector<Threading::ThreadHandle> threads;
+
+  // set once the capture has loaded, workers exit when they see this and the queue is empty
+  volatile int32_t finishing;
+
+  // total time spent parsing on worker threads, protected by the lock
+  double parseTime;
+  uint32_t numParsed;
+
+  static void WorkerThread(void *p)
+  {
+    ShaderParsePool *pool = (ShaderParsePool *)p;
+
+    for(;;)
+    {
+      bool finished = Atomic::CmpExch32(&pool->finishing, 1, 1) == 1;
+
+      ShaderModule *mod = NULL;
+
+      {
+        SCOPED_LOCK(pool->lock);
+        if(pool->next < pool->queue.size())
+          mod = pool->queue[pool->next++];
+      }
+
+      if(mod == NULL)
+      {
+        if(finished)
+          break;
+
+        Threading::Sleep(1);
+        continue;
+      }
+
+      if(Atomic::CmpExch32(&mod->parseState, ShaderModule::ParseQueued, ShaderModule::Parsing) !=
+         ShaderModule::ParseQueued)
+        continue;
+
+      PerformanceTimer timer;
+
+      mod->Parse();
+
+      double time = timer.GetMilliseconds();
+
+      SCOPED_LOCK(pool->lock);
+      pool->parseTime += time;
+      pool->numParsed++;
+    }
+  }
+};
+
 void VulkanCreationInfo::ShaderModule::Init(VulkanResourceManager *resourceMan,
                                             VulkanCreationInfo &info,
                                             const VkShaderModuleCreateInfo *pCreateInfo)
 {
+  this->info = &info;
+
   const uint32_t SPIRVMagic = 0x07230203;
   if(pCreateInfo->codeSize < 4 || memcmp(pCreateInfo->pCode, &SPIRVMagic, sizeof(SPIRVMagic)))
   {
@@ -572,6 +620,237 @@ void VulkanCreationInfo::ShaderModule::Init(VulkanResourceManager *resourceMan,
   else
   {
     RDCASSERT(pCreateInfo->codeSize % sizeof(uint32_t) == 0);
-    ParseSPIRV((uint32_t *)pCreateInfo->pCode, pCreateInfo->codeSize / sizeof(uint32_t), spirv);
+
+    const uint32_t *code = pCreateInfo->pCode;
+    size_t numWords = pCreateInfo->codeSize / sizeof(uint32_t);
+
+    if(info.m_ReflectionCache)
+    {
+      codeHash = VulkanReflectionCache::HashCode(code, numWords);
+
+      vector<VulkanReflectionCache::EntryPoint> entries;
+      if(info.m_ReflectionCache->Find(codeHash, numWords, entries))
+      {
+        for(size_t i = 0; i < entries.size(); i++)
+        {
+          ShaderModuleReflection &reflData = GetReflection(entries[i].name, entries[i].stage);
+          reflData.refl = entries[i].refl;
+          reflData.mapping = entries[i].mapping;
+          reflData.populated = true;
+        }
+
+        // no worker will pick this up, it's only parsed on the replay thread if needed
+        pendingCode.assign(code, code + numWords);
+        parseState = ParseQueued;
+        cached = true;
+        info.m_NumCached++;
+        return;
+      }
+    }
+
+    if(info.m_ParsePool)
+    {
+      pendingCode.assign(code, code + numWords);
+      parseState = ParseQueued;
+
+      SCOPED_LOCK(info.m_ParsePool->lock);
+      info.m_ParsePool->queue.push_back(this);
+    }
+    else
+    {
+      ParseSPIRV((uint32_t *)code, numWords, spirv);
+    }
   }
 }
+
+void VulkanCreationInfo::ShaderModule::Parse()
+{
+  ParseSPIRV(&pendingCode[0], pendingCode.size(), spirv);
+
+  vector<uint32_t> empty;
+  pendingCode.swap(empty);
+
+  Atomic::CmpExch32(&parseState, Parsing, Parsed);
+}
+
+SPVModule &VulkanCreationInfo::ShaderModule::GetSPIRV()
+{
+  if(Atomic::CmpExch32(&parseState, Parsed, Parsed) == Parsed)
+    return spirv;
+
+  PerformanceTimer timer;
+
+  // if no worker has got to this module yet, parse it here rather than waiting for one
+  if(Atomic::CmpExch32(&parseState, ParseQueued, Parsing) == ParseQueued)
+  {
+    Parse();
+  }
+  else
+  {
+    while(Atomic::CmpExch32(&parseState, Parsed, Parsed) != Parsed)
+      Threading::Sleep(0);
+  }
+
+  info->m_ParseWaitTime += timer.GetMilliseconds();
+
+  return spirv;
+}
+
+const vector<uint32_t> &VulkanCreationInfo::ShaderModule::GetCode()
+{
+  // only the replay thread touches cached modules, so there's no race with a worker parsing it
+  if(cached && Atomic::CmpExch32(&parseState, ParseQueued, ParseQueued) == ParseQueued)
+    return pendingCode;
+
+  return GetSPIRV().spirv;
+}
+
+VulkanCreationInfo::ShaderModuleReflection &VulkanCreationInfo::ShaderModule::GetReflection(
+    const string &entryPoint, uint32_t stage)
+{
+  ShaderModuleReflection &ret = m_Reflections[entryPoint];
+
+  if(ret.module == NULL)
+  {
+    ret.module = this;
+    ret.entryPoint = entryPoint;
+    ret.stage = stage;
+  }
+
+  return ret;
+}
+
+void VulkanCreationInfo::ShaderModuleReflection::Populate()
+{
+  if(populated || module == NULL)
+    return;
+
+  populated = true;
+  module->cacheDirty = true;
+
+  SPVModule &spirv = module->GetSPIRV();
+
+  PerformanceTimer timer;
+
+  spirv.MakeReflection(ShaderStage(stage), entryPoint, &refl, &mapping);
+
+  module->info->m_ReflectTime += timer.GetMilliseconds();
+  module->info->m_NumReflected++;
+}
+
+ShaderReflection *VulkanCreationInfo::Pipeline::Shader::GetReflection() const
+{
+  if(reflData == NULL)
+    return NULL;
+
+  reflData->Populate();
+  return &reflData->refl;
+}
+
+ShaderBindpointMapping *VulkanCreationInfo::Pipeline::Shader::GetMapping() const
+{
+  if(reflData == NULL)
+    return NULL;
+
+  reflData->Populate();
+  return &reflData->mapping;
+}
+
+VulkanCreationInfo::VulkanCreationInfo()
+{
+  m_ParsePool = NULL;
+  m_ReflectionCache = NULL;
+  m_ParseWaitTime = m_ReflectTime = 0.0;
+  m_NumReflected = m_NumCached = 0;
+}
+
+VulkanCreationInfo::~VulkanCreationInfo()
+{
+  if(m_ParsePool)
+    EndShaderParsing();
+
+  if(m_ReflectionCache)
+  {
+    for(auto it = m_ShaderModule.begin(); it != m_ShaderModule.end(); ++it)
+    {
+      ShaderModule &mod = it->second;
+
+      if(!mod.cacheDirty || mod.codeHash == 0)
+        continue;
+
+      vector<VulkanReflectionCache::EntryPoint> entries;
+
+      for(auto r = mod.m_Reflections.begin(); r != mod.m_Reflections.end(); ++r)
+      {
+        if(!r->second.populated)
+          continue;
+
+        VulkanReflectionCache::EntryPoint e;
+        e.name = r->first;
+        e.stage = r->second.stage;
+        e.refl = r->second.refl;
+        e.mapping = r->second.mapping;
+
+        // the raw bytes are the module itself, which we have whenever we look the entry up
+        e.refl.RawBytes = rdctype::array<byte>();
+
+        entries.push_back(e);
+      }
+
+      size_t numWords = mod.cached ? mod.pendingCode.size() : mod.GetSPIRV().spirv.size();
+
+      if(!entries.empty())
+        m_ReflectionCache->Store(mod.codeHash, numWords, entries);
+    }
+
+    SAFE_DELETE(m_ReflectionCache);
+  }
+}
+
+void VulkanCreationInfo::BeginShaderParsing()
+{
+  if(m_ParsePool)
+    return;
+
+  m_ParsePool = new ShaderParsePool();
+
+  if(m_ReflectionCache == NULL)
+    m_ReflectionCache = new VulkanReflectionCache();
+
+  m_ParseWaitTime = m_ReflectTime = 0.0;
+  m_NumReflected = m_NumCached = 0;
+
+  // leave a core for the replay thread that's loading the capture
+  uint32_t numThreads = Threading::NumberOfCores();
+  numThreads = RDCCLAMP(numThreads, 2U, MaxShaderParseThreads + 1) - 1;
+
+  for(uint32_t i = 0; i < numThreads; i++)
+    m_ParsePool->threads.push_back(
+        Threading::CreateThread(&ShaderParsePool::WorkerThread, m_ParsePool));
+}
+
+void VulkanCreationInfo::EndShaderParsing()
+{
+  if(m_ParsePool == NULL)
+    return;
+
+  PerformanceTimer timer;
+
+  Atomic::CmpExch32(&m_ParsePool->finishing, 0, 1);
+
+  for(size_t i = 0; i < m_ParsePool->threads.size(); i++)
+  {
+    Threading::JoinThread(m_ParsePool->threads[i]);
+    Threading::CloseThread(m_ParsePool->threads[i]);
+  }
+
+  RDCLOG(
+      "Shader modules: %u found in reflection cache, %u queued, %u parsed on %u worker threads "
+      "taking %.3f ms, %.3f ms waiting for parses on replay thread, %.3f ms waiting for remaining "
+      "parses. %u entry points reflected taking %.3f ms",
+      m_NumCached, (uint32_t)m_ParsePool->queue.size(), m_ParsePool->numParsed,
+      (uint32_t)m_ParsePool->threads.size(), m_ParsePool->parseTime, m_ParseWaitTime,
+      timer.GetMilliseconds(), m_NumReflected, m_ReflectTime);
+
+  SAFE_DELETE(m_ParsePool);
+}
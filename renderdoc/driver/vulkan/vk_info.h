@@ -28,6 +28,8 @@
 #include "vk_common.h"
 #include "vk_manager.h"
 
+class VulkanReflectionCache;
+
 struct VulkanCreationInfo;
 
 struct DescSetLayout
@@ -62,6 +64,12 @@ struct DescSetLayout
 
 struct VulkanCreationInfo
 {
+  VulkanCreationInfo();
+  ~VulkanCreationInfo();
+
+  struct ShaderModule;
+  struct ShaderModuleReflection;
+
   struct Pipeline
   {
     void Init(VulkanResourceManager *resourceMan, VulkanCreationInfo &info,
@@ -79,11 +87,15 @@ struct VulkanCreationInfo
     // VkPipelineShaderStageCreateInfo
     struct Shader
     {
-      Shader() : refl(NULL), mapping(NULL) {}
+      Shader() : reflData(NULL) {}
       ResourceId module;
       string entryPoint;
-      ShaderReflection *refl;
-      ShaderBindpointMapping *mapping;
+
+      // reflection is generated the first time it's needed, so these return NULL only for unused
+      // stages
+      ShaderReflection *GetReflection() const;
+      ShaderBindpointMapping *GetMapping() const;
+      ShaderModuleReflection *reflData;
 
       vector<byte> specdata;
       struct SpecInfo
@@ -318,26 +330,81 @@ struct VulkanCreationInfo
   };
   map<ResourceId, ImageView> m_ImageView;
 
+  struct ShaderModuleReflection
+  {
+    ShaderModuleReflection() : module(NULL), stage(0), populated(false) {}
+    // generates refl and mapping from the module's SPIR-V, if it hasn't been done already
+    void Populate();
+
+    ShaderModule *module;
+    uint32_t stage;
+    string entryPoint;
+    bool populated;
+    ShaderReflection refl;
+    ShaderBindpointMapping mapping;
+  };
+
   struct ShaderModule
   {
+    enum ParseState
+    {
+      Parsed = 0,
+      ParseQueued,
+      Parsing,
+    };
+
+    ShaderModule() : info(NULL), codeHash(0), cached(false), cacheDirty(false), parseState(Parsed)
+    {
+    }
     void Init(VulkanResourceManager *resourceMan, VulkanCreationInfo &info,
               const VkShaderModuleCreateInfo *pCreateInfo);
 
-    SPVModule spirv;
+    // while a capture is loading, modules are parsed on worker threads. This returns the parsed
+    // module, waiting for a worker to finish it or parsing it immediately if none has started.
+    SPVModule &GetSPIRV();
+    void Parse();
+
+    // returns the module's SPIR-V words, without parsing it if possible
+    const vector<uint32_t> &GetCode();
+
+    // returns the reflection data for an entry point, which is populated lazily
+    ShaderModuleReflection &GetReflection(const string &entryPoint, uint32_t stage);
 
     string unstrippedPath;
 
-    struct Reflection
-    {
-      uint32_t stage;
-      string entryPoint;
-      ShaderReflection refl;
-      ShaderBindpointMapping mapping;
-    };
-    map<string, Reflection> m_Reflections;
+    map<string, ShaderModuleReflection> m_Reflections;
+
+    SPVModule spirv;
+    VulkanCreationInfo *info;
+
+    // modules found in the reflection cache aren't parsed until something needs the SPIR-V. If
+    // anything new is reflected or disassembled, the module is written back to the cache
+    uint64_t codeHash;
+    bool cached;
+    bool cacheDirty;
+
+    // a copy of the code while the module is waiting to be parsed, and the ParseState
+    vector<uint32_t> pendingCode;
+    volatile int32_t parseState;
   };
   map<ResourceId, ShaderModule> m_ShaderModule;
 
+  // shader modules created between these calls are parsed on a pool of worker threads. When
+  // parsing ends the load time spent on shaders is logged. The reflection cache is opened when
+  // parsing begins, and is kept until the creation info is destroyed.
+  void BeginShaderParsing();
+  void EndShaderParsing();
+
+  struct ShaderParsePool;
+  ShaderParsePool *m_ParsePool;
+  VulkanReflectionCache *m_ReflectionCache;
+  uint32_t m_NumCached;
+
+  // time spent on the replay thread waiting for modules to be parsed and generating reflection
+  double m_ParseWaitTime;
+  double m_ReflectTime;
+  uint32_t m_NumReflected;
+
   map<ResourceId, string> m_Names;
   map<ResourceId, SwapchainInfo> m_SwapChain;
   map<ResourceId, DescSetLayout> m_DescSetLayout;
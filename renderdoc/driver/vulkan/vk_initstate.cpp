@@ -1407,6 +1407,155 @@ bool WrappedVulkan::Prepare_InitialState(WrappedVkRes *res)
   return false;
 }
 
+// builds the VkWriteDescriptorSet array to write a flat list of descriptor slots, in layout order,
+// into set. Writes are per binding and any binding with missing resources is skipped, so validBinds
+// returns how many writes there are. The descriptor data lives in the same blob after the writes.
+byte *WrappedVulkan::MakeDescriptorSetWrites(VkDescriptorSet set, const DescSetLayout &layout,
+                                             const DescriptorSetSlot *slots, uint32_t numElems,
+                                             uint32_t &validBinds)
+{
+  uint32_t numBinds = (uint32_t)layout.bindings.size();
+
+  // allocate memory to keep the element structures around, as well as a WriteDescriptorSet
+  // array
+  byte *blob = Serialiser::AllocAlignedBuffer(sizeof(VkDescriptorBufferInfo) * numElems +
+                                              sizeof(VkWriteDescriptorSet) * numBinds);
+
+  RDCCOMPILE_ASSERT(sizeof(VkDescriptorBufferInfo) >= sizeof(VkDescriptorImageInfo),
+                    "Descriptor structs sizes are unexpected, ensure largest size is used");
+
+  VkWriteDescriptorSet *writes = (VkWriteDescriptorSet *)blob;
+  VkDescriptorBufferInfo *dstData = (VkDescriptorBufferInfo *)(writes + numBinds);
+  const DescriptorSetSlot *srcData = slots;
+
+  validBinds = numBinds;
+
+  // i is the writedescriptor that we're updating, could be
+  // lower than j if a writedescriptor ended up being no-op and
+  // was skipped. j is the actual index.
+  for(uint32_t i = 0, j = 0; j < numBinds; j++)
+  {
+    writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    writes[i].pNext = NULL;
+
+    // update whole element (array or single)
+    writes[i].dstSet = set;
+    writes[i].dstBinding = j;
+    writes[i].dstArrayElement = 0;
+    writes[i].descriptorCount = layout.bindings[j].descriptorCount;
+    writes[i].descriptorType = layout.bindings[j].descriptorType;
+
+    const DescriptorSetSlot *src = srcData;
+    srcData += layout.bindings[j].descriptorCount;
+
+    // will be cast to the appropriate type, we just need to increment
+    // the dstData pointer by worst case size
+    VkDescriptorBufferInfo *dstBuffer = dstData;
+    VkDescriptorImageInfo *dstImage = (VkDescriptorImageInfo *)dstData;
+    VkBufferView *dstTexelBuffer = (VkBufferView *)dstData;
+    dstData += layout.bindings[j].descriptorCount;
+
+    // the correct one will be set below
+    writes[i].pBufferInfo = NULL;
+    writes[i].pImageInfo = NULL;
+    writes[i].pTexelBufferView = NULL;
+
+    // check that the resources we need for this write are present,
+    // as some might have been skipped due to stale descriptor set
+    // slots or otherwise unreferenced objects (the descriptor set
+    // initial contents do not cause a frame reference for their
+    // resources
+    //
+    // While we go, we copy from the DescriptorSetSlot structures to
+    // the appropriate array in the VkWriteDescriptorSet for the
+    // descriptor type
+    bool valid = true;
+
+    // quick check for slots that were completely uninitialised
+    // and so don't have valid data
+    if(src->texelBufferView == VK_NULL_HANDLE && src->imageInfo.sampler == VK_NULL_HANDLE &&
+       src->imageInfo.imageView == VK_NULL_HANDLE && src->bufferInfo.buffer == VK_NULL_HANDLE)
+    {
+      valid = false;
+    }
+    else
+    {
+      switch(writes[i].descriptorType)
+      {
+        case VK_DESCRIPTOR_TYPE_SAMPLER:
+        {
+          for(uint32_t d = 0; d < writes[i].descriptorCount; d++)
+          {
+            dstImage[d] = src[d].imageInfo;
+            valid &= (src[d].imageInfo.sampler != VK_NULL_HANDLE);
+          }
+          writes[i].pImageInfo = dstImage;
+          break;
+        }
+        case VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER:
+        {
+          for(uint32_t d = 0; d < writes[i].descriptorCount; d++)
+          {
+            dstImage[d] = src[d].imageInfo;
+            valid &= (src[d].imageInfo.sampler != VK_NULL_HANDLE) ||
+                     (layout.bindings[j].immutableSampler &&
+                      layout.bindings[j].immutableSampler[d] != ResourceId());
+            valid &= (src[d].imageInfo.imageView != VK_NULL_HANDLE);
+          }
+          writes[i].pImageInfo = dstImage;
+          break;
+        }
+        case VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE:
+        case VK_DESCRIPTOR_TYPE_STORAGE_IMAGE:
+        case VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT:
+        {
+          for(uint32_t d = 0; d < writes[i].descriptorCount; d++)
+          {
+            dstImage[d] = src[d].imageInfo;
+            valid &= (src[d].imageInfo.imageView != VK_NULL_HANDLE);
+          }
+          writes[i].pImageInfo = dstImage;
+          break;
+        }
+        case VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER:
+        case VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER:
+        {
+          for(uint32_t d = 0; d < writes[i].descriptorCount; d++)
+          {
+            dstTexelBuffer[d] = src[d].texelBufferView;
+            valid &= (src[d].texelBufferView != VK_NULL_HANDLE);
+          }
+          writes[i].pTexelBufferView = dstTexelBuffer;
+          break;
+        }
+        case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER:
+        case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER:
+        case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC:
+        case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC:
+        {
+          for(uint32_t d = 0; d < writes[i].descriptorCount; d++)
+          {
+            dstBuffer[d] = src[d].bufferInfo;
+            valid &= (src[d].bufferInfo.buffer != VK_NULL_HANDLE);
+          }
+          writes[i].pBufferInfo = dstBuffer;
+          break;
+        }
+        default: RDCERR("Unexpected descriptor type %d", writes[i].descriptorType);
+      }
+    }
+
+    // if this write is not valid, skip it
+    // and start writing the next one in here
+    if(!valid)
+      validBinds--;
+    else
+      i++;
+  }
+
+  return blob;
+}
+
 // second parameter isn't used, as we might be serialising init state for a deleted resource
 bool WrappedVulkan::Serialise_InitialState(ResourceId resid, WrappedVkRes *)
 {
@@ -1493,144 +1642,9 @@ bool WrappedVulkan::Serialise_InitialState(ResourceId resid, WrappedVkRes *)
       const DescSetLayout &layout =
           m_CreationInfo.m_DescSetLayout[m_DescriptorSetState[liveid].layout];
 
-      uint32_t numBinds = (uint32_t)layout.bindings.size();
-
-      // allocate memory to keep the element structures around, as well as a WriteDescriptorSet
-      // array
-      byte *blob = Serialiser::AllocAlignedBuffer(sizeof(VkDescriptorBufferInfo) * numElems +
-                                                  sizeof(VkWriteDescriptorSet) * numBinds);
-
-      RDCCOMPILE_ASSERT(sizeof(VkDescriptorBufferInfo) >= sizeof(VkDescriptorImageInfo),
-                        "Descriptor structs sizes are unexpected, ensure largest size is used");
-
-      VkWriteDescriptorSet *writes = (VkWriteDescriptorSet *)blob;
-      VkDescriptorBufferInfo *dstData = (VkDescriptorBufferInfo *)(writes + numBinds);
-      DescriptorSetSlot *srcData = bindings;
-
-      uint32_t validBinds = numBinds;
-
-      // i is the writedescriptor that we're updating, could be
-      // lower than j if a writedescriptor ended up being no-op and
-      // was skipped. j is the actual index.
-      for(uint32_t i = 0, j = 0; j < numBinds; j++)
-      {
-        writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-        writes[i].pNext = NULL;
-
-        // update whole element (array or single)
-        writes[i].dstSet = ToHandle<VkDescriptorSet>(res);
-        writes[i].dstBinding = j;
-        writes[i].dstArrayElement = 0;
-        writes[i].descriptorCount = layout.bindings[j].descriptorCount;
-        writes[i].descriptorType = layout.bindings[j].descriptorType;
-
-        DescriptorSetSlot *src = srcData;
-        srcData += layout.bindings[j].descriptorCount;
-
-        // will be cast to the appropriate type, we just need to increment
-        // the dstData pointer by worst case size
-        VkDescriptorBufferInfo *dstBuffer = dstData;
-        VkDescriptorImageInfo *dstImage = (VkDescriptorImageInfo *)dstData;
-        VkBufferView *dstTexelBuffer = (VkBufferView *)dstData;
-        dstData += layout.bindings[j].descriptorCount;
-
-        // the correct one will be set below
-        writes[i].pBufferInfo = NULL;
-        writes[i].pImageInfo = NULL;
-        writes[i].pTexelBufferView = NULL;
-
-        // check that the resources we need for this write are present,
-        // as some might have been skipped due to stale descriptor set
-        // slots or otherwise unreferenced objects (the descriptor set
-        // initial contents do not cause a frame reference for their
-        // resources
-        //
-        // While we go, we copy from the DescriptorSetSlot structures to
-        // the appropriate array in the VkWriteDescriptorSet for the
-        // descriptor type
-        bool valid = true;
-
-        // quick check for slots that were completely uninitialised
-        // and so don't have valid data
-        if(src->texelBufferView == VK_NULL_HANDLE && src->imageInfo.sampler == VK_NULL_HANDLE &&
-           src->imageInfo.imageView == VK_NULL_HANDLE && src->bufferInfo.buffer == VK_NULL_HANDLE)
-        {
-          valid = false;
-        }
-        else
-        {
-          switch(writes[i].descriptorType)
-          {
-            case VK_DESCRIPTOR_TYPE_SAMPLER:
-            {
-              for(uint32_t d = 0; d < writes[i].descriptorCount; d++)
-              {
-                dstImage[d] = src[d].imageInfo;
-                valid &= (src[d].imageInfo.sampler != VK_NULL_HANDLE);
-              }
-              writes[i].pImageInfo = dstImage;
-              break;
-            }
-            case VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER:
-            {
-              for(uint32_t d = 0; d < writes[i].descriptorCount; d++)
-              {
-                dstImage[d] = src[d].imageInfo;
-                valid &= (src[d].imageInfo.sampler != VK_NULL_HANDLE) ||
-                         (layout.bindings[j].immutableSampler &&
-                          layout.bindings[j].immutableSampler[d] != ResourceId());
-                valid &= (src[d].imageInfo.imageView != VK_NULL_HANDLE);
-              }
-              writes[i].pImageInfo = dstImage;
-              break;
-            }
-            case VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE:
-            case VK_DESCRIPTOR_TYPE_STORAGE_IMAGE:
-            case VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT:
-            {
-              for(uint32_t d = 0; d < writes[i].descriptorCount; d++)
-              {
-                dstImage[d] = src[d].imageInfo;
-                valid &= (src[d].imageInfo.imageView != VK_NULL_HANDLE);
-              }
-              writes[i].pImageInfo = dstImage;
-              break;
-            }
-            case VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER:
-            case VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER:
-            {
-              for(uint32_t d = 0; d < writes[i].descriptorCount; d++)
-              {
-                dstTexelBuffer[d] = src[d].texelBufferView;
-                valid &= (src[d].texelBufferView != VK_NULL_HANDLE);
-              }
-              writes[i].pTexelBufferView = dstTexelBuffer;
-              break;
-            }
-            case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER:
-            case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER:
-            case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC:
-            case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC:
-            {
-              for(uint32_t d = 0; d < writes[i].descriptorCount; d++)
-              {
-                dstBuffer[d] = src[d].bufferInfo;
-                valid &= (src[d].bufferInfo.buffer != VK_NULL_HANDLE);
-              }
-              writes[i].pBufferInfo = dstBuffer;
-              break;
-            }
-            default: RDCERR("Unexpected descriptor type %d", writes[i].descriptorType);
-          }
-        }
-
-        // if this write is not valid, skip it
-        // and start writing the next one in here
-        if(!valid)
-          validBinds--;
-        else
-          i++;
-      }
+      uint32_t validBinds = 0;
+      byte *blob = MakeDescriptorSetWrites(ToHandle<VkDescriptorSet>(res), layout, bindings,
+                                           numElems, validBinds);
 
       SAFE_DELETE_ARRAY(bindings);
 
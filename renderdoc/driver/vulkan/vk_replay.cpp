@@ -24,8 +24,11 @@
 
 #include "vk_replay.h"
 #include <float.h>
+#include "driver/shaders/spirv/spirv_debug.h"
 #include "maths/camera.h"
+#include "maths/formatpacking.h"
 #include "maths/matrix.h"
+#include "replay/texture_stats.h"
 #include "serialise/string_utils.h"
 #include "vk_core.h"
 #include "vk_debug.h"
@@ -617,6 +620,7 @@ VulkanReplay::VulkanReplay()
   m_Proxy = false;
 
   m_HighlightCache.driver = this;
+  m_MeshPickCache.driver = this;
 
   m_OutputWinID = 1;
   m_ActiveWinID = 0;
@@ -914,20 +918,25 @@ ShaderReflection *VulkanReplay::GetShader(ResourceId shader, string entryPoint)
     return NULL;
   }
 
+  VulkanCreationInfo::ShaderModuleReflection &reflData = shad->second.m_Reflections[entryPoint];
+  reflData.Populate();
+
   // disassemble lazily on demand
-  if(shad->second.m_Reflections[entryPoint].refl.Disassembly.count == 0)
-    shad->second.m_Reflections[entryPoint].refl.Disassembly =
-        shad->second.spirv.Disassemble(entryPoint);
+  if(reflData.refl.Disassembly.count == 0)
+  {
+    reflData.refl.Disassembly = shad->second.GetSPIRV().Disassemble(entryPoint);
+    shad->second.cacheDirty = true;
+  }
 
-  if(shad->second.m_Reflections[entryPoint].refl.RawBytes.count == 0 &&
-     !shad->second.spirv.spirv.empty())
+  const vector<uint32_t> &spirv = shad->second.GetCode();
+
+  if(reflData.refl.RawBytes.count == 0 && !spirv.empty())
   {
-    rdctype::array<byte> &bytes = shad->second.m_Reflections[entryPoint].refl.RawBytes;
-    const vector<uint32_t> &spirv = shad->second.spirv.spirv;
+    rdctype::array<byte> &bytes = reflData.refl.RawBytes;
     create_array_init(bytes, spirv.size() * sizeof(uint32_t), (byte *)&spirv[0]);
   }
 
-  return &shad->second.m_Reflections[entryPoint].refl;
+  return &reflData.refl;
 }
 
 void VulkanReplay::PickPixel(ResourceId texture, uint32_t x, uint32_t y, uint32_t sliceFace,
@@ -1075,9 +1084,11 @@ void VulkanReplay::PickPixel(ResourceId texture, uint32_t x, uint32_t y, uint32_
   m_DebugHeight = oldH;
 }
 
-uint32_t VulkanReplay::PickVertex(uint32_t eventID, const MeshDisplay &cfg, uint32_t x, uint32_t y)
+uint32_t VulkanReplay::PickVertex(uint32_t eventID, const MeshDisplay &cfg, uint32_t x, uint32_t y,
+                                  uint32_t *primitive)
 {
-  return GetDebugManager()->PickVertex(eventID, cfg, x, y, m_DebugWidth, m_DebugHeight);
+  return m_MeshPickCache.PickVertex(eventID, cfg, x, y, float(m_DebugWidth), float(m_DebugHeight),
+                                   true, primitive);
 }
 
 bool VulkanReplay::RenderTexture(TextureDisplay cfg)
@@ -1674,7 +1685,13 @@ void VulkanReplay::RenderHighlightBox(float w, float h, float scale)
 ResourceId VulkanReplay::RenderOverlay(ResourceId texid, CompType typeHint, DebugOverlay overlay,
                                        uint32_t eventID, const vector<uint32_t> &passEvents)
 {
-  return GetDebugManager()->RenderOverlay(texid, overlay, eventID, passEvents);
+  ResourceId ret = GetDebugManager()->RenderOverlay(texid, overlay, eventID, passEvents);
+
+  // overlays replay draws with their own state and can clear the real targets, so whatever replay
+  // comes next has to start over
+  m_pDriver->MarkReplayStateDirty();
+
+  return ret;
 }
 
 void VulkanReplay::RenderMesh(uint32_t eventID, const vector<MeshFormat> &secondaryDraws,
@@ -2831,8 +2848,8 @@ void VulkanReplay::SavePipelineState()
         }
 
         stage.stage = ShaderStage::Compute;
-        if(p.shaders[i].mapping)
-          stage.BindpointMapping = *p.shaders[i].mapping;
+        if(p.shaders[i].GetMapping())
+          stage.BindpointMapping = *p.shaders[i].GetMapping();
 
         create_array_uninit(stage.specialization, p.shaders[i].specialization.size());
         for(size_t s = 0; s < p.shaders[i].specialization.size(); s++)
@@ -2901,8 +2918,8 @@ void VulkanReplay::SavePipelineState()
         }
 
         stages[i]->stage = StageFromIndex(i);
-        if(p.shaders[i].mapping)
-          stages[i]->BindpointMapping = *p.shaders[i].mapping;
+        if(p.shaders[i].GetMapping())
+          stages[i]->BindpointMapping = *p.shaders[i].GetMapping();
 
         create_array_uninit(stages[i]->specialization, p.shaders[i].specialization.size());
         for(size_t s = 0; s < p.shaders[i].specialization.size(); s++)
@@ -3584,8 +3601,11 @@ void VulkanReplay::FillCBufferVariables(ResourceId shader, string entryPoint, ui
     return;
   }
 
-  ShaderReflection &refl = it->second.m_Reflections[entryPoint].refl;
-  ShaderBindpointMapping &mapping = it->second.m_Reflections[entryPoint].mapping;
+  VulkanCreationInfo::ShaderModuleReflection &reflData = it->second.m_Reflections[entryPoint];
+  reflData.Populate();
+
+  ShaderReflection &refl = reflData.refl;
+  ShaderBindpointMapping &mapping = reflData.mapping;
 
   if(cbufSlot >= (uint32_t)refl.ConstantBlocks.count)
   {
@@ -3626,8 +3646,7 @@ void VulkanReplay::FillCBufferVariables(ResourceId shader, string entryPoint, ui
 
         if(pipeIt != m_pDriver->m_CreationInfo.m_Pipeline.end())
         {
-          auto specInfo =
-              pipeIt->second.shaders[it->second.m_Reflections[entryPoint].stage].specialization;
+          auto specInfo = pipeIt->second.shaders[reflData.stage].specialization;
 
           // find any actual values specified
           for(size_t i = 0; i < specInfo.size(); i++)
@@ -3718,6 +3737,10 @@ bool VulkanReplay::GetMinMax(ResourceId texid, uint32_t sliceFace, uint32_t mip,
 
   if(GetDebugManager()->m_MinMaxTilePipe[textype][intTypeIndex] == VK_NULL_HANDLE)
   {
+    // no compute pipeline for this texture type, calculate it on the CPU instead
+    if(GetSoftwareMinMax(this, texid, sliceFace, mip, sample, typeHint, minval, maxval))
+      return true;
+
     *minval = 0.0f;
     *maxval = 1.0f;
     return false;
@@ -3967,6 +3990,10 @@ bool VulkanReplay::GetHistogram(ResourceId texid, uint32_t sliceFace, uint32_t m
 
   if(GetDebugManager()->m_HistogramPipe[textype][intTypeIndex] == VK_NULL_HANDLE)
   {
+    if(GetSoftwareHistogram(this, texid, sliceFace, mip, sample, typeHint, minval, maxval,
+                            channels, histogram))
+      return true;
+
     histogram.resize(HGRAM_NUM_BUCKETS);
     for(size_t i = 0; i < HGRAM_NUM_BUCKETS; i++)
       histogram[i] = 1;
@@ -5136,11 +5163,21 @@ void VulkanReplay::BuildTargetShader(string source, string entry, const uint32_t
 void VulkanReplay::ReplaceResource(ResourceId from, ResourceId to)
 {
   GetDebugManager()->ReplaceResource(from, to);
+
+  // replacing a shader can change the post-transform data that was picked in, and the contents
+  // of resources at any checkpoint
+  m_MeshPickCache.Clear();
+  m_pDriver->ClearReplayCheckpoints();
+  m_pDriver->MarkReplayStateDirty();
 }
 
 void VulkanReplay::RemoveReplacement(ResourceId id)
 {
   GetDebugManager()->RemoveReplacement(id);
+
+  m_MeshPickCache.Clear();
+  m_pDriver->ClearReplayCheckpoints();
+  m_pDriver->MarkReplayStateDirty();
 }
 
 void VulkanReplay::FreeTargetResource(ResourceId id)
@@ -5160,25 +5197,630 @@ vector<PixelModification> VulkanReplay::PixelHistory(vector<EventUsage> events,
   return vector<PixelModification>();
 }
 
+// upper bound on the number of steps to trace, so that infinite loops don't hang the replay. Each
+// step keeps a full copy of the registers for the UI, so this is kept to the same order as the
+// point where D3D11 debugging asks whether to carry on
+static const uint32_t MaxShaderDebugSteps = 100000;
+
+bool VulkanReplay::PrepareShaderDebug(SPIRVDebug::Debugger &debugger, bool compute, uint32_t stage,
+                                      const VulkanCreationInfo::Pipeline::Shader *&shader)
+{
+  const VulkanRenderState &state = m_pDriver->m_RenderState;
+  VulkanCreationInfo &c = m_pDriver->m_CreationInfo;
+
+  const VulkanRenderState::Pipeline &pipe = compute ? state.compute : state.graphics;
+
+  if(pipe.pipeline == ResourceId())
+  {
+    RDCERR("No pipeline bound to debug");
+    return false;
+  }
+
+  shader = &c.m_Pipeline[pipe.pipeline].shaders[stage];
+
+  if(shader->module == ResourceId() || shader->GetReflection() == NULL)
+  {
+    RDCERR("No shader bound at stage %u to debug", stage);
+    return false;
+  }
+
+  string error;
+  if(!debugger.Init(c.m_ShaderModule[shader->module].GetSPIRV(), shader->entryPoint, error))
+  {
+    RDCERR("Can't debug shader: %s", error.c_str());
+    return false;
+  }
+
+  for(size_t i = 0; i < shader->specialization.size(); i++)
+    debugger.SetSpecConstant(shader->specialization[i].specID, shader->specialization[i].data,
+                             shader->specialization[i].size);
+
+  const vector<SPIRVDebug::InterfaceVariable> &buffers = debugger.GetBuffers();
+  for(size_t i = 0; i < buffers.size(); i++)
+  {
+    const SPIRVDebug::InterfaceVariable &buf = buffers[i];
+
+    if(buf.storage == spv::StorageClassPushConstant)
+    {
+      vector<byte> pushdata(state.pushconsts, state.pushconsts + sizeof(state.pushconsts));
+      debugger.SetBufferData(i, 0, pushdata);
+      continue;
+    }
+
+    if(buf.set >= pipe.descSets.size() || pipe.descSets[buf.set].descSet == ResourceId())
+      continue;
+
+    WrappedVulkan::DescriptorSetInfo &setInfo =
+        m_pDriver->m_DescriptorSetState[pipe.descSets[buf.set].descSet];
+
+    if(buf.binding >= setInfo.currentBindings.size())
+      continue;
+
+    const DescSetLayout::Binding &layoutBind =
+        c.m_DescSetLayout[setInfo.layout].bindings[buf.binding];
+    DescriptorSetSlot *slots = setInfo.currentBindings[buf.binding];
+
+    bool dynamicOffset = layoutBind.descriptorType == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC ||
+                         layoutBind.descriptorType == VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+
+    for(uint32_t a = 0; a < buf.arraySize && a < layoutBind.descriptorCount; a++)
+    {
+      const VkDescriptorBufferInfo &info = slots[a].bufferInfo;
+
+      if(info.buffer == VK_NULL_HANDLE)
+        continue;
+
+      VkDeviceSize offset = info.offset;
+
+      if(dynamicOffset)
+      {
+        union
+        {
+          VkImageLayout l;
+          uint32_t u;
+        } offs;
+
+        offs.l = slots[a].imageInfo.imageLayout;
+
+        offset += offs.u;
+      }
+
+      ResourceId id = m_pDriver->GetResourceManager()->GetNonDispWrapper(info.buffer)->id;
+
+      vector<byte> data;
+      GetDebugManager()->GetBufferData(id, offset, info.range == VK_WHOLE_SIZE ? 0 : info.range,
+                                       data);
+      debugger.SetBufferData(i, a, data);
+    }
+  }
+
+  return true;
+}
+
+void VulkanReplay::FillShaderDebugCBuffers(SPIRVDebug::Debugger &debugger,
+                                           const VulkanCreationInfo::Pipeline::Shader &shader,
+                                           ShaderDebugTrace &trace)
+{
+  const ShaderReflection &refl = *shader.GetReflection();
+  const ShaderBindpointMapping &mapping = *shader.GetMapping();
+  const vector<SPIRVDebug::InterfaceVariable> &buffers = debugger.GetBuffers();
+
+  // match up the debugger's view of the buffers with the constant blocks in the reflection
+  create_array_uninit(trace.cbuffers, refl.ConstantBlocks.count);
+  for(int32_t i = 0; i < refl.ConstantBlocks.count; i++)
+  {
+    const BindpointMap &bind = mapping.ConstantBlocks[refl.ConstantBlocks[i].bindPoint];
+    bool pushConst = !refl.ConstantBlocks[i].bufferBacked && bind.bindset == 10000;
+
+    for(size_t b = 0; b < buffers.size(); b++)
+    {
+      if(pushConst ? buffers[b].storage == spv::StorageClassPushConstant
+                   : (refl.ConstantBlocks[i].bufferBacked &&
+                      buffers[b].storage == spv::StorageClassUniform &&
+                      (int32_t)buffers[b].set == bind.bindset &&
+                      (int32_t)buffers[b].binding == bind.bind))
+      {
+        debugger.GetBufferVariables(b, trace.cbuffers[i]);
+        break;
+      }
+    }
+  }
+}
+
 ShaderDebugTrace VulkanReplay::DebugVertex(uint32_t eventID, uint32_t vertid, uint32_t instid,
                                            uint32_t idx, uint32_t instOffset, uint32_t vertOffset)
 {
-  VULKANNOTIMP("DebugVertex");
-  return ShaderDebugTrace();
+  SPIRVDebug::Debugger debugger;
+  const VulkanCreationInfo::Pipeline::Shader *shader = NULL;
+
+  if(!PrepareShaderDebug(debugger, false, 0, shader))
+    return ShaderDebugTrace();
+
+  const VulkanRenderState &state = m_pDriver->m_RenderState;
+  const VulkanCreationInfo::Pipeline &pipe =
+      m_pDriver->m_CreationInfo.m_Pipeline[state.graphics.pipeline];
+
+  const vector<SPIRVDebug::InterfaceVariable> &inputs = debugger.GetInputs();
+  for(size_t i = 0; i < inputs.size(); i++)
+  {
+    const SPIRVDebug::InterfaceVariable &in = inputs[i];
+
+    vector<uint32_t> words(RDCMAX(in.numWords, 1U), 0);
+
+    if(in.builtin == spv::BuiltInVertexIndex)
+    {
+      words[0] = vertOffset + idx;
+    }
+    else if(in.builtin == spv::BuiltInInstanceIndex)
+    {
+      words[0] = instOffset + instid;
+    }
+    else if(in.location != ~0U)
+    {
+      const VulkanCreationInfo::Pipeline::Attribute *attr = NULL;
+      for(size_t a = 0; a < pipe.vertexAttrs.size(); a++)
+        if(pipe.vertexAttrs[a].location == in.location)
+          attr = &pipe.vertexAttrs[a];
+
+      const VulkanCreationInfo::Pipeline::Binding *bind = NULL;
+      for(size_t b = 0; attr && b < pipe.vertexBindings.size(); b++)
+        if(pipe.vertexBindings[b].vbufferBinding == attr->binding)
+          bind = &pipe.vertexBindings[b];
+
+      if(attr == NULL || bind == NULL || bind->vbufferBinding >= state.vbuffers.size())
+      {
+        RDCWARN("No vertex attribute bound for location %u", in.location);
+      }
+      else
+      {
+        ResourceFormat fmt = MakeResourceFormat(attr->format);
+
+        if(fmt.special)
+        {
+          RDCWARN("Unsupported vertex format %s for location %u", ToStr::Get(attr->format).c_str(),
+                  in.location);
+        }
+        else
+        {
+          const VulkanRenderState::VertBuffer &vb = state.vbuffers[bind->vbufferBinding];
+          uint32_t vertex = bind->perInstance ? instOffset + instid : vertOffset + idx;
+
+          vector<byte> data;
+          GetDebugManager()->GetBufferData(vb.buf,
+                                           vb.offs + attr->byteoffset + bind->bytestride * vertex,
+                                           fmt.compCount * fmt.compByteWidth, data);
+
+          // missing components default to (0, 0, 0, 1)
+          if(words.size() == 4)
+            words[3] = in.type == VarType::Float ? 0x3f800000 : 1;
+
+          for(uint32_t comp = 0; comp < fmt.compCount && comp < words.size(); comp++)
+          {
+            if((comp + 1) * fmt.compByteWidth > data.size())
+              break;
+
+            byte *src = &data[comp * fmt.compByteWidth];
+
+            if(in.type == VarType::Float)
+            {
+              float f = ConvertComponent(fmt, src);
+              memcpy(&words[comp], &f, sizeof(float));
+            }
+            else if(fmt.compByteWidth == 4)
+            {
+              memcpy(&words[comp], src, sizeof(uint32_t));
+            }
+            else if(fmt.compByteWidth == 2)
+            {
+              words[comp] = fmt.compType == CompType::SInt ? uint32_t(*(int16_t *)src)
+                                                             : uint32_t(*(uint16_t *)src);
+            }
+            else
+            {
+              words[comp] = fmt.compType == CompType::SInt ? uint32_t(*(int8_t *)src)
+                                                             : uint32_t(*(uint8_t *)src);
+            }
+          }
+        }
+      }
+    }
+
+    debugger.SetInput(i, &words[0], words.size());
+  }
+
+  ShaderDebugTrace trace = debugger.Run(MaxShaderDebugSteps);
+
+  FillShaderDebugCBuffers(debugger, *shader, trace);
+
+  return trace;
 }
 
 ShaderDebugTrace VulkanReplay::DebugPixel(uint32_t eventID, uint32_t x, uint32_t y, uint32_t sample,
                                           uint32_t primitive)
 {
-  VULKANNOTIMP("DebugPixel");
-  return ShaderDebugTrace();
+  SPIRVDebug::Debugger debugger;
+  const VulkanCreationInfo::Pipeline::Shader *shader = NULL;
+
+  if(!PrepareShaderDebug(debugger, false, 4, shader))
+    return ShaderDebugTrace();
+
+  const VulkanRenderState &state = m_pDriver->m_RenderState;
+  const VulkanCreationInfo::Pipeline &pipe =
+      m_pDriver->m_CreationInfo.m_Pipeline[state.graphics.pipeline];
+  const DrawcallDescription *draw = m_pDriver->GetDrawcall(eventID);
+
+  // the inputs are interpolated from the vertex shader outputs, so any stages in between would need
+  // to be run first
+  if(pipe.shaders[1].module != ResourceId() || pipe.shaders[2].module != ResourceId() ||
+     pipe.shaders[3].module != ResourceId())
+  {
+    RDCWARN("Can't debug pixels with tessellation or geometry shaders bound");
+    return ShaderDebugTrace();
+  }
+
+  if(pipe.topology != VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST &&
+     pipe.topology != VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP &&
+     pipe.topology != VK_PRIMITIVE_TOPOLOGY_TRIANGLE_FAN)
+  {
+    RDCWARN("Can only debug pixels from triangles, not %s", ToStr::Get(pipe.topology).c_str());
+    return ShaderDebugTrace();
+  }
+
+  if(draw == NULL || state.views.empty())
+    return ShaderDebugTrace();
+
+  GetDebugManager()->InitPostVSBuffers(eventID);
+
+  MeshFormat postvs = GetDebugManager()->GetPostVSBuffers(eventID, 0, MeshDataStage::VSOut);
+
+  const ShaderReflection &vsRefl = *pipe.shaders[0].GetReflection();
+
+  if(postvs.buf == ResourceId() || vsRefl.OutputSig.count == 0 ||
+     vsRefl.OutputSig[0].systemValue != ShaderBuiltin::Position)
+  {
+    RDCWARN("No vertex shader output data to interpolate pixel inputs from");
+    return ShaderDebugTrace();
+  }
+
+  // offset of each output in the post-VS data, which is packed the same way as AddOutputDumping
+  // lays out its struct
+  vector<uint32_t> outOffsets(vsRefl.OutputSig.count);
+  {
+    uint32_t offs = 0;
+    for(int32_t o = 0; o < vsRefl.OutputSig.count; o++)
+    {
+      uint32_t elemSize = vsRefl.OutputSig[o].compType == CompType::Double ? 8 : 4;
+      uint32_t numComps = vsRefl.OutputSig[o].compCount;
+
+      if(numComps == 2)
+        offs = AlignUp(offs, 2U * elemSize);
+      else if(numComps > 2)
+        offs = AlignUp(offs, 4U * elemSize);
+
+      outOffsets[o] = offs;
+      offs += elemSize * numComps;
+    }
+  }
+
+  vector<byte> vertData, idxData;
+  GetDebugManager()->GetBufferData(postvs.buf, 0, 0, vertData);
+  if(postvs.idxbuf != ResourceId())
+    GetDebugManager()->GetBufferData(postvs.idxbuf, 0, 0, idxData);
+
+  // gather the vertices of each triangle in draw order, with the provoking vertex first
+  vector<uint32_t> tris;
+  {
+    bool restart = pipe.primitiveRestartEnable && postvs.idxByteWidth > 0 &&
+                   pipe.topology != VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+    uint32_t restartIdx = postvs.idxByteWidth == 2 ? 0xffff : 0xffffffff;
+
+    vector<uint32_t> run;
+
+    for(uint32_t i = 0; i < postvs.numVerts; i++)
+    {
+      uint32_t idx = i;
+
+      if(postvs.idxByteWidth == 2)
+      {
+        if((i + 1) * 2 > idxData.size())
+          break;
+        idx = ((uint16_t *)&idxData[0])[i];
+      }
+      else if(postvs.idxByteWidth == 4)
+      {
+        if((i + 1) * 4 > idxData.size())
+          break;
+        idx = ((uint32_t *)&idxData[0])[i];
+      }
+
+      if(restart && idx == restartIdx)
+      {
+        run.clear();
+        continue;
+      }
+
+      run.push_back(idx);
+
+      if(pipe.topology == VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST)
+      {
+        if(run.size() == 3)
+        {
+          tris.insert(tris.end(), run.begin(), run.end());
+          run.clear();
+        }
+      }
+      else if(run.size() >= 3)
+      {
+        size_t k = run.size() - 3;
+
+        if(pipe.topology == VK_PRIMITIVE_TOPOLOGY_TRIANGLE_FAN)
+        {
+          tris.push_back(run[k + 1]);
+          tris.push_back(run[k + 2]);
+          tris.push_back(run[0]);
+        }
+        else
+        {
+          // odd triangles in a strip swap their last two vertices to keep the same winding
+          tris.push_back(run[k]);
+          tris.push_back(run[k + 1 + (k % 2)]);
+          tris.push_back(run[k + 2 - (k % 2)]);
+        }
+      }
+    }
+  }
+
+  const VkViewport &vp = state.views[0];
+
+  float px = float(x) + 0.5f, py = float(y) + 0.5f;
+
+  struct Vert
+  {
+    const float *pos;
+    float wx, wy, depth;
+  } verts[3];
+
+  float bary[3] = {0.0f, 0.0f, 0.0f};
+  bool frontFacing = true;
+  uint32_t foundInst = ~0U, foundPrim = ~0U;
+
+  uint32_t numInstances = RDCMAX(1U, draw->numInstances);
+
+  // without knowing what was depth tested away, the last triangle drawn over the pixel is the one
+  // that wrote it, unless the caller knows which primitive they want
+  for(uint32_t inst = numInstances; inst > 0 && foundPrim == ~0U; inst--)
+  {
+    uint64_t instOffs =
+        GetDebugManager()->GetPostVSBuffers(eventID, inst - 1, MeshDataStage::VSOut).offset;
+
+    for(size_t t = tris.size() / 3; t > 0; t--)
+    {
+      uint32_t prim = uint32_t(t - 1);
+
+      if(primitive != ~0U && prim != primitive)
+        continue;
+
+      bool valid = true;
+
+      for(int v = 0; v < 3; v++)
+      {
+        uint64_t offs = instOffs + uint64_t(tris[prim * 3 + v]) * postvs.stride;
+
+        if(offs + sizeof(float) * 4 > vertData.size())
+        {
+          valid = false;
+          break;
+        }
+
+        const float *pos = (const float *)&vertData[(size_t)offs];
+
+        // triangles crossing the near plane would need clipping, so they're skipped
+        if(pos[3] <= 0.0f)
+        {
+          valid = false;
+          break;
+        }
+
+        verts[v].pos = pos;
+        verts[v].wx = vp.x + (pos[0] / pos[3] + 1.0f) * 0.5f * vp.width;
+        verts[v].wy = vp.y + (pos[1] / pos[3] + 1.0f) * 0.5f * vp.height;
+        verts[v].depth = vp.minDepth + (pos[2] / pos[3]) * (vp.maxDepth - vp.minDepth);
+      }
+
+      if(!valid)
+        continue;
+
+      float area = (verts[1].wx - verts[0].wx) * (verts[2].wy - verts[0].wy) -
+                   (verts[1].wy - verts[0].wy) * (verts[2].wx - verts[0].wx);
+
+      if(area == 0.0f)
+        continue;
+
+      // with y pointing down in framebuffer coordinates, a positive area here is clockwise
+      bool front = (area < 0.0f) == (pipe.frontFace == VK_FRONT_FACE_COUNTER_CLOCKWISE);
+
+      if((pipe.cullMode & VK_CULL_MODE_FRONT_BIT) && front)
+        continue;
+      if((pipe.cullMode & VK_CULL_MODE_BACK_BIT) && !front)
+        continue;
+
+      for(int v = 0; v < 3; v++)
+      {
+        const Vert &a = verts[(v + 1) % 3];
+        const Vert &b = verts[(v + 2) % 3];
+        bary[v] = ((b.wx - a.wx) * (py - a.wy) - (b.wy - a.wy) * (px - a.wx)) / area;
+      }
+
+      if(bary[0] < 0.0f || bary[1] < 0.0f || bary[2] < 0.0f)
+        continue;
+
+      frontFacing = front;
+      foundInst = inst - 1;
+      foundPrim = prim;
+      break;
+    }
+  }
+
+  if(foundPrim == ~0U)
+  {
+    RDCWARN("No triangle in the draw covers pixel %u,%u", x, y);
+    return ShaderDebugTrace();
+  }
+
+  // perspective-correct weights, and 1/w interpolated linearly in screen space for FragCoord
+  float perspBary[3];
+  float invW = 0.0f;
+  for(int v = 0; v < 3; v++)
+  {
+    perspBary[v] = bary[v] / verts[v].pos[3];
+    invW += perspBary[v];
+  }
+  for(int v = 0; v < 3; v++)
+    perspBary[v] /= invW;
+
+  const vector<SPIRVDebug::InterfaceVariable> &inputs = debugger.GetInputs();
+  for(size_t i = 0; i < inputs.size(); i++)
+  {
+    const SPIRVDebug::InterfaceVariable &in = inputs[i];
+
+    vector<uint32_t> words(RDCMAX(in.numWords, 1U), 0);
+
+    if(in.builtin != spv::BuiltInMax)
+    {
+      switch(in.builtin)
+      {
+        case spv::BuiltInFragCoord:
+        {
+          float depth =
+              bary[0] * verts[0].depth + bary[1] * verts[1].depth + bary[2] * verts[2].depth;
+          float coord[4] = {px, py, depth, invW};
+          memcpy(&words[0], coord, RDCMIN(sizeof(coord), words.size() * sizeof(uint32_t)));
+          break;
+        }
+        case spv::BuiltInFrontFacing: words[0] = frontFacing ? 1 : 0; break;
+        case spv::BuiltInSampleId: words[0] = sample == ~0U ? 0 : sample; break;
+        case spv::BuiltInSamplePosition:
+        {
+          float pos[2] = {0.5f, 0.5f};
+          memcpy(&words[0], pos, RDCMIN(sizeof(pos), words.size() * sizeof(uint32_t)));
+          break;
+        }
+        case spv::BuiltInPrimitiveId: words[0] = foundPrim; break;
+        case spv::BuiltInHelperInvocation:
+        case spv::BuiltInLayer:
+        case spv::BuiltInViewportIndex: break;
+        default: RDCWARN("Unsupported pixel shader input builtin %u", (uint32_t)in.builtin); break;
+      }
+    }
+    else if(in.location != ~0U)
+    {
+      uint64_t instOffs =
+          GetDebugManager()->GetPostVSBuffers(eventID, foundInst, MeshDataStage::VSOut).offset;
+
+      // arrays and matrices take consecutive locations
+      uint32_t location = in.location;
+      for(uint32_t w = 0; w < words.size(); location++)
+      {
+        int32_t o = 0;
+        for(; o < vsRefl.OutputSig.count; o++)
+          if(vsRefl.OutputSig[o].systemValue == ShaderBuiltin::Undefined &&
+             vsRefl.OutputSig[o].regIndex == location)
+            break;
+
+        if(o == vsRefl.OutputSig.count || vsRefl.OutputSig[o].compType == CompType::Double)
+        {
+          RDCWARN("No vertex shader output to interpolate for location %u", location);
+          break;
+        }
+
+        for(uint32_t comp = 0; comp < vsRefl.OutputSig[o].compCount && w < words.size();
+            comp++, w++)
+        {
+          uint32_t vals[3] = {0, 0, 0};
+
+          for(int v = 0; v < 3; v++)
+          {
+            uint64_t offs = instOffs + uint64_t(tris[foundPrim * 3 + v]) * postvs.stride +
+                            outOffsets[o] + comp * sizeof(uint32_t);
+            if(offs + sizeof(uint32_t) <= vertData.size())
+              memcpy(&vals[v], &vertData[(size_t)offs], sizeof(uint32_t));
+          }
+
+          // integers are always flat, and take the provoking vertex's value
+          if(in.flat || in.type != VarType::Float)
+          {
+            words[w] = vals[0];
+            continue;
+          }
+
+          const float *weights = in.noPerspective ? bary : perspBary;
+          float f[3];
+          memcpy(f, vals, sizeof(f));
+
+          float interp = weights[0] * f[0] + weights[1] * f[1] + weights[2] * f[2];
+          memcpy(&words[w], &interp, sizeof(float));
+        }
+      }
+    }
+    else
+    {
+      RDCWARN("Unsupported pixel shader input %s", in.name.c_str());
+    }
+
+    debugger.SetInput(i, &words[0], words.size());
+  }
+
+  ShaderDebugTrace trace = debugger.Run(MaxShaderDebugSteps);
+
+  FillShaderDebugCBuffers(debugger, *shader, trace);
+
+  return trace;
 }
 
 ShaderDebugTrace VulkanReplay::DebugThread(uint32_t eventID, uint32_t groupid[3],
                                            uint32_t threadid[3])
 {
-  VULKANNOTIMP("DebugThread");
-  return ShaderDebugTrace();
+  SPIRVDebug::Debugger debugger;
+  const VulkanCreationInfo::Pipeline::Shader *shader = NULL;
+
+  if(!PrepareShaderDebug(debugger, true, 5, shader))
+    return ShaderDebugTrace();
+
+  const DrawcallDescription *draw = m_pDriver->GetDrawcall(eventID);
+  const uint32_t *groupSize = shader->GetReflection()->DispatchThreadsDimension;
+
+  const vector<SPIRVDebug::InterfaceVariable> &inputs = debugger.GetInputs();
+  for(size_t i = 0; i < inputs.size(); i++)
+  {
+    const SPIRVDebug::InterfaceVariable &in = inputs[i];
+
+    uint32_t words[3] = {0, 0, 0};
+
+    for(int c = 0; c < 3; c++)
+    {
+      switch(in.builtin)
+      {
+        case spv::BuiltInGlobalInvocationId:
+          words[c] = groupid[c] * groupSize[c] + threadid[c];
+          break;
+        case spv::BuiltInLocalInvocationId: words[c] = threadid[c]; break;
+        case spv::BuiltInWorkgroupId: words[c] = groupid[c]; break;
+        case spv::BuiltInNumWorkgroups: words[c] = draw ? draw->dispatchDimension[c] : 0; break;
+        default: break;
+      }
+    }
+
+    if(in.builtin == spv::BuiltInLocalInvocationIndex)
+      words[0] = (threadid[2] * groupSize[1] + threadid[1]) * groupSize[0] + threadid[0];
+
+    debugger.SetInput(i, words, RDCMIN(in.numWords, 3U));
+  }
+
+  ShaderDebugTrace trace = debugger.Run(MaxShaderDebugSteps);
+
+  FillShaderDebugCBuffers(debugger, *shader, trace);
+
+  return trace;
 }
 
 ResourceId VulkanReplay::CreateProxyTexture(const TextureDescription &templateTex)
@@ -26,6 +26,7 @@
 
 #include "api/replay/renderdoc_replay.h"
 #include "core/core.h"
+#include "replay/mesh_pick.h"
 #include "replay/replay_driver.h"
 #include "vk_common.h"
 #include "vk_info.h"
@@ -124,6 +125,11 @@ class WrappedVulkan;
 class VulkanDebugManager;
 class VulkanResourceManager;
 
+namespace SPIRVDebug
+{
+class Debugger;
+}
+
 class VulkanReplay : public IReplayDriver
 {
 public:
@@ -224,7 +230,8 @@ public:
   ShaderDebugTrace DebugThread(uint32_t eventID, uint32_t groupid[3], uint32_t threadid[3]);
   void PickPixel(ResourceId texture, uint32_t x, uint32_t y, uint32_t sliceFace, uint32_t mip,
                  uint32_t sample, CompType typeHint, float pixel[4]);
-  uint32_t PickVertex(uint32_t eventID, const MeshDisplay &cfg, uint32_t x, uint32_t y);
+  uint32_t PickVertex(uint32_t eventID, const MeshDisplay &cfg, uint32_t x, uint32_t y,
+                      uint32_t *primitive);
 
   ResourceId RenderOverlay(ResourceId cfg, CompType typeHint, DebugOverlay overlay,
                            uint32_t eventID, const vector<uint32_t> &passEvents);
@@ -266,6 +273,12 @@ public:
   static void InstallVulkanLayer(bool systemLevel);
 
 private:
+  bool PrepareShaderDebug(SPIRVDebug::Debugger &debugger, bool compute, uint32_t stage,
+                          const VulkanCreationInfo::Pipeline::Shader *&shader);
+  void FillShaderDebugCBuffers(SPIRVDebug::Debugger &debugger,
+                               const VulkanCreationInfo::Pipeline::Shader &shader,
+                               ShaderDebugTrace &trace);
+
   struct OutputWindow
   {
     OutputWindow();
@@ -324,6 +337,7 @@ private:
   uint32_t m_DebugWidth, m_DebugHeight;
 
   HighlightCache m_HighlightCache;
+  MeshPickCache m_MeshPickCache;
 
   bool m_Proxy;
 
@@ -939,6 +939,7 @@ struct MemMapState
         needRefData(false),
         mapFlushed(false),
         mapCoherent(false),
+        writeTracked(false),
         mappedPtr(NULL),
         refData(NULL)
   {
@@ -947,6 +948,8 @@ struct MemMapState
   bool needRefData;
   bool mapFlushed;
   bool mapCoherent;
+  // if the mapped range is write-tracked, only written pages are flushed and refData is unused
+  bool writeTracked;
   byte *mappedPtr;
   byte *refData;
 };
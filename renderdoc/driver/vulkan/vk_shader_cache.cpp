@@ -0,0 +1,230 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015-2017 Baldur Karlsson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+
+#include "vk_shader_cache.h"
+#include <algorithm>
+#include "api/replay/version.h"
+#include "common/shader_cache.h"
+#include "core/replay_proxy.h"
+#include "serialise/serialiser.h"
+
+static uint64_t HashWords(const uint32_t *words, size_t numWords, uint64_t hash)
+{
+  for(size_t i = 0; i < numWords; i++)
+    hash = (hash ^ words[i]) * 1099511628211ULL;
+
+  return hash;
+}
+
+static uint64_t HashBytes(const byte *bytes, size_t numBytes)
+{
+  size_t numWords = numBytes / sizeof(uint32_t);
+
+  uint64_t hash = HashWords((const uint32_t *)bytes, numWords, 14695981039346656037ULL);
+
+  for(size_t i = numWords * sizeof(uint32_t); i < numBytes; i++)
+    hash = (hash ^ bytes[i]) * 1099511628211ULL;
+
+  return hash;
+}
+
+struct VulkanReflectionBlobCallbacks
+{
+  bool Create(uint32_t size, byte *data, vector<byte> **ret) const
+  {
+    RDCASSERT(ret);
+
+    *ret = new vector<byte>(data, data + size);
+
+    return true;
+  }
+
+  void Destroy(vector<byte> *blob) const { delete blob; }
+  uint32_t GetSize(vector<byte> *blob) const { return (uint32_t)blob->size(); }
+  byte *GetData(vector<byte> *blob) const { return &(*blob)[0]; }
+} ReflectionCacheCallbacks;
+
+VulkanReflectionCache::VulkanReflectionCache()
+{
+  bool success = LoadShaderCache("vkreflection.cache", m_CacheMagic, CacheVersion(), m_Blobs,
+                                 ReflectionCacheCallbacks);
+
+  // if the cache is invalid, make sure it gets overwritten
+  m_Dirty = !success;
+}
+
+VulkanReflectionCache::~VulkanReflectionCache()
+{
+  if(!m_Dirty)
+  {
+    for(auto it = m_Blobs.begin(); it != m_Blobs.end(); ++it)
+      ReflectionCacheCallbacks.Destroy(it->second);
+    return;
+  }
+
+  // keep the most recently used modules that fit within the size limit
+  vector<std::pair<uint64_t, uint64_t> > byAge;
+  byAge.reserve(m_Blobs.size());
+
+  for(auto it = m_Blobs.begin(); it != m_Blobs.end(); ++it)
+  {
+    BlobHeader header;
+    memcpy(&header, &(*it->second)[0], sizeof(header));
+    byAge.push_back(std::make_pair(header.lastUsed, it->first));
+  }
+
+  std::sort(byAge.begin(), byAge.end());
+
+  std::map<uint64_t, vector<byte> *> kept;
+  uint64_t size = 0;
+
+  for(size_t i = byAge.size(); i > 0; i--)
+  {
+    vector<byte> *blob = m_Blobs[byAge[i - 1].second];
+
+    if(size + blob->size() <= m_MaxCacheSize)
+    {
+      size += blob->size();
+      kept[byAge[i - 1].second] = blob;
+    }
+    else
+    {
+      ReflectionCacheCallbacks.Destroy(blob);
+    }
+  }
+
+  if(kept.size() < m_Blobs.size())
+    RDCDEBUG("Evicted %u shader modules from reflection cache",
+             uint32_t(m_Blobs.size() - kept.size()));
+
+  SaveShaderCache("vkreflection.cache", m_CacheMagic, CacheVersion(), kept,
+                  ReflectionCacheCallbacks);
+}
+
+uint32_t VulkanReflectionCache::CacheVersion()
+{
+  const char build[] = RENDERDOC_VERSION_STRING " " GIT_COMMIT_HASH;
+
+  uint64_t hash = HashBytes((const byte *)build, sizeof(build) - 1) ^ m_CacheFormat;
+
+  return uint32_t(hash ^ (hash >> 32));
+}
+
+uint64_t VulkanReflectionCache::HashCode(const uint32_t *code, size_t numWords)
+{
+  return HashWords(code, numWords, 14695981039346656037ULL);
+}
+
+bool VulkanReflectionCache::Find(uint64_t hash, size_t numWords, vector<EntryPoint> &entries)
+{
+  auto it = m_Blobs.find(hash);
+
+  if(it == m_Blobs.end())
+    return false;
+
+  vector<byte> &blob = *it->second;
+
+  if(blob.size() < sizeof(BlobHeader))
+    return false;
+
+  BlobHeader header;
+  memcpy(&header, &blob[0], sizeof(header));
+
+  // check the blob is really for this module, in case the file was tampered with or two modules
+  // collide on the hash
+  if(header.hash != hash || header.numWords != numWords)
+    return false;
+
+  const byte *payload = &blob[0] + sizeof(header);
+  size_t payloadSize = blob.size() - sizeof(header);
+
+  if(payloadSize == 0 || HashBytes(payload, payloadSize) != header.payloadHash)
+  {
+    RDCWARN("Corrupt reflection cache entry for module %llx", hash);
+    return false;
+  }
+
+  Serialiser ser(payloadSize, payload, false);
+
+  entries.resize(header.numEntries);
+  for(uint32_t i = 0; i < header.numEntries; i++)
+  {
+    ser.Serialise("", entries[i].name);
+    ser.Serialise("", entries[i].stage);
+    ser.Serialise("", entries[i].refl);
+    ser.Serialise("", entries[i].mapping);
+  }
+
+  if(ser.HasError())
+  {
+    entries.clear();
+    return false;
+  }
+
+  uint64_t now = Timing::GetUnixTimestamp();
+
+  if(now > header.lastUsed + m_LastUsedGranularity)
+  {
+    header.lastUsed = now;
+    memcpy(&blob[0], &header, sizeof(header));
+    m_Dirty = true;
+  }
+
+  return true;
+}
+
+void VulkanReflectionCache::Store(uint64_t hash, size_t numWords, vector<EntryPoint> &entries)
+{
+  Serialiser ser(NULL, Serialiser::WRITING, false);
+
+  for(size_t i = 0; i < entries.size(); i++)
+  {
+    ser.Serialise("", entries[i].name);
+    ser.Serialise("", entries[i].stage);
+    ser.Serialise("", entries[i].refl);
+    ser.Serialise("", entries[i].mapping);
+  }
+
+  BlobHeader header;
+  header.hash = hash;
+  header.lastUsed = Timing::GetUnixTimestamp();
+  header.numWords = (uint32_t)numWords;
+  header.numEntries = (uint32_t)entries.size();
+
+  size_t payloadSize = (size_t)ser.GetOffset();
+  const byte *payload = ser.GetRawPtr(0);
+  header.payloadHash = HashBytes(payload, payloadSize);
+
+  vector<byte> *blob = new vector<byte>(sizeof(header) + payloadSize);
+  memcpy(&(*blob)[0], &header, sizeof(header));
+  memcpy(&(*blob)[sizeof(header)], payload, payloadSize);
+
+  vector<byte> *&slot = m_Blobs[hash];
+  if(slot)
+    ReflectionCacheCallbacks.Destroy(slot);
+  slot = blob;
+
+  m_Dirty = true;
+}
@@ -0,0 +1,82 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015-2017 Baldur Karlsson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+
+#pragma once
+
+#include "api/replay/renderdoc_replay.h"
+#include "common/common.h"
+
+// A persistent cache of reflection and disassembly for shader modules, keyed by a hash of each
+// module's SPIR-V, so that reopening a capture with the same shaders doesn't need to analyse them
+// again. The cache is loaded when it's created and written back out when it's destroyed, evicting
+// the least recently used modules to keep it under a fixed size.
+class VulkanReflectionCache
+{
+public:
+  VulkanReflectionCache();
+  ~VulkanReflectionCache();
+
+  struct EntryPoint
+  {
+    string name;
+    uint32_t stage;
+    ShaderReflection refl;
+    ShaderBindpointMapping mapping;
+  };
+
+  static uint64_t HashCode(const uint32_t *code, size_t numWords);
+
+  // returns false if the module isn't in the cache. On success the module is marked as recently
+  // used
+  bool Find(uint64_t hash, size_t numWords, vector<EntryPoint> &entries);
+
+  // replaces everything cached for the module
+  void Store(uint64_t hash, size_t numWords, vector<EntryPoint> &entries);
+
+private:
+  // each blob starts with this header, followed by the serialised entry points
+  struct BlobHeader
+  {
+    uint64_t hash;
+    uint64_t lastUsed;
+    uint64_t payloadHash;
+    uint32_t numWords;
+    uint32_t numEntries;
+  };
+
+  static const uint32_t m_CacheMagic = 0xf00d00d7;
+  // bump if the blob layout changes. The stored version also includes the build version and commit
+  // hash, since the reflection and disassembly themselves change between builds
+  static const uint32_t m_CacheFormat = 2;
+  static const uint64_t m_MaxCacheSize = 64 * 1024 * 1024;
+  // a cache hit only updates the module's last used time if it's older than this, so that opening
+  // the same capture repeatedly doesn't rewrite the whole cache
+  static const uint64_t m_LastUsedGranularity = 24 * 60 * 60;
+
+  static uint32_t CacheVersion();
+
+  std::map<uint64_t, vector<byte> *> m_Blobs;
+  bool m_Dirty;
+};
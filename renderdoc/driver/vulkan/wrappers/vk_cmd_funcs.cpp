@@ -512,6 +512,9 @@ bool WrappedVulkan::Serialise_vkBeginCommandBuffer(Serialiser *localSerialiser,
 
           m_Partial[p].partialParent = cmdId;
           m_Partial[p].baseEvent = *it;
+          m_Partial[p].eventCount = length;
+          m_Partial[p].executesSecondaries =
+              !m_BakedCmdBufferInfo[bakeId].draw->executedCmds.empty();
           m_Partial[p].renderPassActive = false;
           m_Partial[p].partialDevice = device;
           m_Partial[p].resultPartialCmdPool =
@@ -601,6 +604,8 @@ bool WrappedVulkan::Serialise_vkBeginCommandBuffer(Serialiser *localSerialiser,
       cmd = GetResourceManager()->GetLiveHandle<VkCommandBuffer>(bakeId);
     }
 
+    m_BakedCmdBufferInfo[bakeId].recordOffset = m_CurChunkOffset;
+
     {
       VulkanDrawcallTreeNode *draw = new VulkanDrawcallTreeNode;
       m_BakedCmdBufferInfo[cmdId].draw = draw;
@@ -491,10 +491,13 @@ bool WrappedVulkan::Serialise_vkUpdateDescriptorSets(Serialiser *localSerialiser
       {
         ObjDisp(device)->UpdateDescriptorSets(Unwrap(device), 1, &writeDesc, 0, NULL);
 
+        ResourceId dstSetId = GetResourceManager()->GetNonDispWrapper(writeDesc.dstSet)->id;
+
+        if(m_State == READING)
+          m_CheckpointDescSets.insert(dstSetId);
+
         // update our local tracking
-        vector<DescriptorSetSlot *> &bindings =
-            m_DescriptorSetState[GetResourceManager()->GetNonDispWrapper(writeDesc.dstSet)->id]
-                .currentBindings;
+        vector<DescriptorSetSlot *> &bindings = m_DescriptorSetState[dstSetId].currentBindings;
 
         {
           RDCASSERT(writeDesc.dstBinding < bindings.size());
@@ -570,6 +573,9 @@ bool WrappedVulkan::Serialise_vkUpdateDescriptorSets(Serialiser *localSerialiser
       ResourceId dstSetId = GetResourceManager()->GetNonDispWrapper(copyDesc.dstSet)->id;
       ResourceId srcSetId = GetResourceManager()->GetNonDispWrapper(copyDesc.srcSet)->id;
 
+      if(m_State == READING)
+        m_CheckpointDescSets.insert(dstSetId);
+
       // update our local tracking
       vector<DescriptorSetSlot *> &dstbindings = m_DescriptorSetState[dstSetId].currentBindings;
       vector<DescriptorSetSlot *> &srcbindings = m_DescriptorSetState[srcSetId].currentBindings;
@@ -418,6 +418,9 @@ void WrappedVulkan::Shutdown()
   SubmitSemaphores();
   FlushQ();
 
+  // free replay checkpoints while the device is still around
+  ClearReplayCheckpoints();
+
   // since we didn't create proper registered resources for our command buffers,
   // they won't be taken down properly with the pool. So we release them (just our
   // data) here.
@@ -1453,6 +1456,9 @@ void WrappedVulkan::vkDestroyDevice(VkDevice device, const VkAllocationCallbacks
   SubmitSemaphores();
   FlushQ();
 
+  // a capture still being written may not have read back its thumbnail from this device yet
+  RenderDoc::Inst().WaitForCaptureWrites();
+
   // MULTIDEVICE this function will need to check if the device is the one we
   // used for debugmanager/cmd pool etc, and only remove child queues and
   // resources (instead of doing full resource manager shutdown).
@@ -258,6 +258,23 @@ bool WrappedVulkan::Serialise_vkQueueSubmit(Serialiser *localSerialiser, VkQueue
     // account for the outer loop thinking we've added one event and incrementing,
     // since we've done all the handling ourselves this will be off by one.
     m_RootEventID--;
+
+    // replay can't resume between a command buffer's recording and this submit, so note the
+    // earliest recording that's used here, including any executed secondaries.
+    uint64_t firstRecord = m_CurChunkOffset;
+
+    for(uint32_t c = 0; c < numCmds; c++)
+    {
+      BakedCmdBufferInfo &cmdBufInfo = m_BakedCmdBufferInfo[cmdIds[c]];
+
+      firstRecord = RDCMIN(firstRecord, cmdBufInfo.recordOffset);
+
+      for(size_t e = 0; e < cmdBufInfo.draw->executedCmds.size(); e++)
+        firstRecord =
+            RDCMIN(firstRecord, m_BakedCmdBufferInfo[cmdBufInfo.draw->executedCmds[e]].recordOffset);
+    }
+
+    m_CheckpointSubmitRecords.push_back(firstRecord);
   }
   else if(m_State == EXECUTING)
   {
@@ -732,40 +749,63 @@ VkResult WrappedVulkan::vkQueueSubmit(VkQueue queue, uint32_t submitCount,
           continue;
         }
 
-        size_t diffStart = 0, diffEnd = 0;
+        vector<DiffRange> ranges;
         bool found = true;
 
+        byte *mapBase = state.mappedPtr + (size_t)state.mapOffset;
+
+        if(state.writeTracked)
+        {
+          // only the pages written since the last submit need to be flushed
+          WriteTracking::GetWrittenRanges(mapBase, ranges);
+          found = !ranges.empty();
+        }
+        else if(WriteTracking::Enabled() && WriteTracking::Track(mapBase, (size_t)state.mapSize))
+        {
+          // writes are tracked from here on, so flush everything this time and from then on we
+          // don't need a reference copy to compare against
+          state.writeTracked = true;
+          state.needRefData = false;
+
+          DiffRange whole = {0, (size_t)state.mapSize};
+          ranges.push_back(whole);
+        }
+        else
+        {
 // enabled as this is necessary for programs with very large coherent mappings
 // (> 1GB) as otherwise more than a couple of vkQueueSubmit calls leads to vast
 // memory allocation. There might still be bugs lurking in here though
 #if 1
-        // this causes vkFlushMappedMemoryRanges call to allocate and copy to refData
-        // from serialised buffer. We want to copy *precisely* the serialised data,
-        // otherwise there is a gap in time between serialising out a snapshot of
-        // the buffer and whenever we then copy into the ref data, e.g. below.
-        // during this time, data could be written to the buffer and it won't have
-        // been caught in the serialised snapshot, and if it doesn't change then
-        // it *also* won't be caught in any future FindDiffRange() calls.
-        //
-        // Likewise once refData is allocated, the call below will also update it
-        // with the data serialised out for the same reason.
-        //
-        // Note: it's still possible that data is being written to by the
-        // application while it's being serialised out in the snapshot below. That
-        // is OK, since the application is responsible for ensuring it's not writing
-        // data that would be needed by the GPU in this submit. As long as the
-        // refdata we use for future use is identical to what was serialised, we
-        // shouldn't miss anything
-        state.needRefData = true;
-
-        // if we have a previous set of data, compare.
-        // otherwise just serialise it all
-        if(state.refData)
-          found = FindDiffRange((byte *)state.mappedPtr, state.refData, (size_t)state.mapSize,
-                                diffStart, diffEnd);
-        else
+          // this causes vkFlushMappedMemoryRanges call to allocate and copy to refData
+          // from serialised buffer. We want to copy *precisely* the serialised data,
+          // otherwise there is a gap in time between serialising out a snapshot of
+          // the buffer and whenever we then copy into the ref data, e.g. below.
+          // during this time, data could be written to the buffer and it won't have
+          // been caught in the serialised snapshot, and if it doesn't change then
+          // it *also* won't be caught in any future FindDiffRange() calls.
+          //
+          // Likewise once refData is allocated, the call below will also update it
+          // with the data serialised out for the same reason.
+          //
+          // Note: it's still possible that data is being written to by the
+          // application while it's being serialised out in the snapshot below. That
+          // is OK, since the application is responsible for ensuring it's not writing
+          // data that would be needed by the GPU in this submit. As long as the
+          // refdata we use for future use is identical to what was serialised, we
+          // shouldn't miss anything
+          state.needRefData = true;
+
+          // if we have a previous set of data, compare.
+          // otherwise just serialise it all
+          if(state.refData)
+            found = FindDiffRanges(mapBase, state.refData, (size_t)state.mapSize, ranges);
+          else
 #endif
-          diffEnd = (size_t)state.mapSize;
+          {
+            DiffRange whole = {0, (size_t)state.mapSize};
+            ranges.push_back(whole);
+          }
+        }
 
         if(found)
         {
@@ -774,12 +814,23 @@ VkResult WrappedVulkan::vkQueueSubmit(VkQueue queue, uint32_t submitCount,
           VkDevice dev = GetDev();
 
           {
-            RDCLOG("Persistent map flush forced for %llu (%llu -> %llu)", record->GetResourceID(),
-                   (uint64_t)diffStart, (uint64_t)diffEnd);
-            VkMappedMemoryRange range = {VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE, NULL,
-                                         (VkDeviceMemory)(uint64_t)record->Resource,
-                                         state.mapOffset + diffStart, diffEnd - diffStart};
-            vkFlushMappedMemoryRanges(dev, 1, &range);
+            RDCLOG("Persistent map flush forced for %llu (%llu -> %llu in %u ranges)",
+                   record->GetResourceID(), (uint64_t)ranges.front().start,
+                   (uint64_t)ranges.back().end, (uint32_t)ranges.size());
+
+            // flush each changed range separately, so the untouched memory between them isn't
+            // serialised
+            vector<VkMappedMemoryRange> flushRanges(ranges.size());
+            for(size_t r = 0; r < ranges.size(); r++)
+            {
+              VkMappedMemoryRange range = {VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE, NULL,
+                                           (VkDeviceMemory)(uint64_t)record->Resource,
+                                           state.mapOffset + ranges[r].start,
+                                           ranges[r].end - ranges[r].start};
+              flushRanges[r] = range;
+            }
+
+            vkFlushMappedMemoryRanges(dev, (uint32_t)flushRanges.size(), &flushRanges[0]);
             state.mapFlushed = false;
           }
 
@@ -484,8 +484,15 @@ void WrappedVulkan::vkFreeMemory(VkDevice device, VkDeviceMemory memory,
   if(m_State >= WRITING)
   {
     // there is an implicit unmap on free, so make sure to tidy up
-    if(wrapped->record->memMapState && wrapped->record->memMapState->refData)
-      Serialiser::FreeAlignedBuffer(wrapped->record->memMapState->refData);
+    MemMapState *state = wrapped->record->memMapState;
+    if(state && state->refData)
+      Serialiser::FreeAlignedBuffer(state->refData);
+
+    if(state && state->writeTracked)
+    {
+      WriteTracking::Untrack(state->mappedPtr + (size_t)state->mapOffset);
+      state->writeTracked = false;
+    }
 
     {
       SCOPED_LOCK(m_CoherentMapsLock);
@@ -565,7 +572,7 @@ bool WrappedVulkan::Serialise_vkUnmapMemory(Serialiser *localSerialiser, VkDevic
 
   SERIALISE_ELEMENT(uint64_t, memOffset, state->mapOffset);
   SERIALISE_ELEMENT(uint64_t, memSize, state->mapSize);
-  SERIALISE_ELEMENT_BUF(byte *, data, (byte *)state->mappedPtr + state->mapOffset, (size_t)memSize);
+  SERIALISE_ELEMENT_BUF_VIEW(data, (byte *)state->mappedPtr + state->mapOffset, (size_t)memSize);
 
   if(m_State < WRITING)
   {
@@ -586,8 +593,6 @@ bool WrappedVulkan::Serialise_vkUnmapMemory(Serialiser *localSerialiser, VkDevic
 
       ObjDisp(device)->UnmapMemory(Unwrap(device), Unwrap(mem));
     }
-
-    SAFE_DELETE_ARRAY(data);
   }
 
   return true;
@@ -648,6 +653,12 @@ void WrappedVulkan::vkUnmapMemory(VkDevice device, VkDeviceMemory mem)
         }
       }
 
+      if(state.writeTracked)
+      {
+        WriteTracking::Untrack(state.mappedPtr + (size_t)state.mapOffset);
+        state.writeTracked = false;
+      }
+
       state.mappedPtr = NULL;
     }
 
@@ -693,7 +704,7 @@ bool WrappedVulkan::Serialise_vkFlushMappedMemoryRanges(Serialiser *localSeriali
 
   SERIALISE_ELEMENT(uint64_t, memOffset, pMemRanges->offset);
   SERIALISE_ELEMENT(uint64_t, memSize, memRangeSize);
-  SERIALISE_ELEMENT_BUF(byte *, data, state->mappedPtr + (size_t)memOffset, (size_t)memSize);
+  SERIALISE_ELEMENT_BUF_VIEW(data, state->mappedPtr + (size_t)memOffset, (size_t)memSize);
 
   // if we need to save off this serialised buffer as reference for future comparison,
   // do so now. See the call to vkFlushMappedMemoryRanges in WrappedVulkan::vkQueueSubmit()
@@ -701,8 +712,8 @@ bool WrappedVulkan::Serialise_vkFlushMappedMemoryRanges(Serialiser *localSeriali
   {
     if(!state->refData)
     {
-      // if we're in this case, the range should be for the whole memory region.
-      RDCASSERT(memOffset == 0 && memSize == state->mapSize);
+      // if we're in this case, the range should be for the whole mapped region.
+      RDCASSERT(memOffset == state->mapOffset && memSize == state->mapSize);
 
       // allocate ref data so we can compare next time to minimise serialised data
       state->refData = Serialiser::AllocAlignedBuffer((size_t)state->mapSize);
@@ -715,7 +726,11 @@ bool WrappedVulkan::Serialise_vkFlushMappedMemoryRanges(Serialiser *localSeriali
 
     byte *serialisedData = localSerialiser->GetRawPtr(offs);
 
-    memcpy(state->refData, serialisedData + (size_t)memOffset, (size_t)memSize);
+    // refData only covers the mapped region, but memOffset is from the start of the memory
+    RDCASSERT(memOffset >= state->mapOffset &&
+              memOffset + memSize <= state->mapOffset + state->mapSize);
+
+    memcpy(state->refData + size_t(memOffset - state->mapOffset), serialisedData, (size_t)memSize);
   }
 
   if(m_State < WRITING)
@@ -737,8 +752,6 @@ bool WrappedVulkan::Serialise_vkFlushMappedMemoryRanges(Serialiser *localSeriali
 
       ObjDisp(device)->UnmapMemory(Unwrap(device), Unwrap(mem));
     }
-
-    SAFE_DELETE_ARRAY(data);
   }
 
   return true;
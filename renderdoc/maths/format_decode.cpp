@@ -0,0 +1,479 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2017 Baldur Karlsson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+#include "format_decode.h"
+#include <float.h>
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+#include "common/common.h"
+#include "formatpacking.h"
+
+#if ENABLED(RDOC_X86)
+#include <immintrin.h>
+#endif
+
+///////////////////////////////////////////////////////////////////////////////
+// generic conversions, one component at a time
+
+struct Lookup8
+{
+  static float Convert(const FormatDecoder &d, const byte *src, uint32_t c)
+  {
+    return d.lookup8[c][src[c]];
+  }
+};
+
+template <typename T>
+struct Integer
+{
+  static float Convert(const FormatDecoder &d, const byte *src, uint32_t c)
+  {
+    T val;
+    memcpy(&val, src + c * sizeof(T), sizeof(T));
+    return RDCMAX(float(val) / d.divisor, d.lowest);
+  }
+};
+
+struct Half
+{
+  static float Convert(const FormatDecoder &d, const byte *src, uint32_t c)
+  {
+    uint16_t val;
+    memcpy(&val, src + c * sizeof(uint16_t), sizeof(uint16_t));
+    return ConvertFromHalf(val);
+  }
+};
+
+template <typename T>
+struct Floating
+{
+  static float Convert(const FormatDecoder &d, const byte *src, uint32_t c)
+  {
+    T val;
+    memcpy(&val, src + c * sizeof(T), sizeof(T));
+    return float(val);
+  }
+};
+
+template <typename Converter, uint32_t compCount>
+static void Decode_Components(const FormatDecoder &d, const byte *src, uint32_t count,
+                              uint32_t stride, float *dst)
+{
+  const bool swap = d.format.bgraOrder && compCount >= 3;
+
+  for(uint32_t i = 0; i < count; i++, src += stride, dst += 4)
+  {
+    float r = Converter::Convert(d, src, 0);
+    float g = compCount >= 2 ? Converter::Convert(d, src, 1) : 0.0f;
+    float b = compCount >= 3 ? Converter::Convert(d, src, 2) : 0.0f;
+    float a = compCount >= 4 ? Converter::Convert(d, src, 3) : 1.0f;
+
+    dst[0] = swap ? b : r;
+    dst[1] = g;
+    dst[2] = swap ? r : b;
+    dst[3] = a;
+  }
+}
+
+// instantiated per component count so the inner loop is unrolled
+template <typename Converter>
+static FormatDecoder::DecodeFunc GetComponentDecode(uint32_t compCount)
+{
+  switch(compCount)
+  {
+    case 1: return &Decode_Components<Converter, 1>;
+    case 2: return &Decode_Components<Converter, 2>;
+    case 3: return &Decode_Components<Converter, 3>;
+    default: return &Decode_Components<Converter, 4>;
+  }
+}
+
+static FormatDecoder::DecodeFunc GetComponentDecode(const ResourceFormat &fmt)
+{
+  const bool sint = fmt.compType == CompType::SInt || fmt.compType == CompType::SScaled ||
+                    fmt.compType == CompType::SNorm;
+
+  switch(fmt.compByteWidth)
+  {
+    case 1: return GetComponentDecode<Lookup8>(fmt.compCount);
+    case 2:
+      if(fmt.compType == CompType::Float)
+        return GetComponentDecode<Half>(fmt.compCount);
+      return sint ? GetComponentDecode<Integer<int16_t> >(fmt.compCount)
+                  : GetComponentDecode<Integer<uint16_t> >(fmt.compCount);
+    case 4:
+      if(fmt.compType == CompType::Float)
+        return GetComponentDecode<Floating<float> >(fmt.compCount);
+      return sint ? GetComponentDecode<Integer<int32_t> >(fmt.compCount)
+                  : GetComponentDecode<Integer<uint32_t> >(fmt.compCount);
+    default: return GetComponentDecode<Floating<double> >(fmt.compCount);
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// packed formats
+
+static Vec3f ConvertFromR9G9B9E5(uint32_t data)
+{
+  // shared 5-bit exponent with a bias of 15, applied to 9-bit mantissas with no implicit 1
+  float scale = ldexpf(1.0f, int32_t(data >> 27) - 15 - 9);
+
+  return Vec3f(float((data >> 0) & 0x1ff) * scale, float((data >> 9) & 0x1ff) * scale,
+               float((data >> 18) & 0x1ff) * scale);
+}
+
+static Vec4f ConvertFromR10G10B10A2(const ResourceFormat &fmt, uint32_t data)
+{
+  if(fmt.compType == CompType::UInt || fmt.compType == CompType::UScaled)
+    return Vec4f(float((data >> 0) & 0x3ff), float((data >> 10) & 0x3ff),
+                 float((data >> 20) & 0x3ff), float((data >> 30) & 0x3));
+
+  if(fmt.compType == CompType::SInt || fmt.compType == CompType::SScaled ||
+     fmt.compType == CompType::SNorm)
+  {
+    // sign extend each component by shifting it to the top and back down
+    Vec4f ret(float(int32_t(data << 22) >> 22), float(int32_t(data << 12) >> 22),
+              float(int32_t(data << 2) >> 22), float(int32_t(data) >> 30));
+
+    if(fmt.compType == CompType::SNorm)
+      ret = Vec4f(RDCMAX(ret.x / 511.0f, -1.0f), RDCMAX(ret.y / 511.0f, -1.0f),
+                  RDCMAX(ret.z / 511.0f, -1.0f), RDCMAX(ret.w, -1.0f));
+
+    return ret;
+  }
+
+  return ConvertFromR10G10B10A2(data);
+}
+
+static void Decode_Special(const FormatDecoder &d, const byte *src, uint32_t count,
+                           uint32_t stride, float *dst)
+{
+  const ResourceFormat &fmt = d.format;
+
+  for(uint32_t i = 0; i < count; i++, src += stride, dst += 4)
+  {
+    Vec4f texel(0.0f, 0.0f, 0.0f, 1.0f);
+
+    uint32_t u32 = 0;
+    uint16_t u16 = 0;
+    if(d.elementSize >= 4)
+      memcpy(&u32, src, sizeof(u32));
+    else if(d.elementSize == 2)
+      memcpy(&u16, src, sizeof(u16));
+
+    switch(fmt.specialFormat)
+    {
+      case SpecialFormat::R10G10B10A2: texel = ConvertFromR10G10B10A2(fmt, u32); break;
+      case SpecialFormat::R11G11B10:
+      {
+        Vec3f v = ConvertFromR11G11B10(u32);
+        texel = Vec4f(v.x, v.y, v.z, 1.0f);
+        break;
+      }
+      case SpecialFormat::R9G9B9E5:
+      {
+        Vec3f v = ConvertFromR9G9B9E5(u32);
+        texel = Vec4f(v.x, v.y, v.z, 1.0f);
+        break;
+      }
+      case SpecialFormat::R5G6B5:
+      {
+        Vec3f v = ConvertFromB5G6R5(u16);
+        texel = Vec4f(v.x, v.y, v.z, 1.0f);
+        break;
+      }
+      case SpecialFormat::R5G5B5A1: texel = ConvertFromB5G5R5A1(u16); break;
+      case SpecialFormat::R4G4B4A4: texel = ConvertFromB4G4R4A4(u16); break;
+      case SpecialFormat::R4G4:
+        texel.x = float(src[0] >> 4) / 15.0f;
+        texel.y = float(src[0] & 0xf) / 15.0f;
+        break;
+      case SpecialFormat::S8: texel.x = float(src[0]); break;
+      // only depth is returned for depth-stencil formats, as when the depth aspect is sampled
+      case SpecialFormat::D16S8: texel.x = float(u32 & 0xffff) / 65535.0f; break;
+      case SpecialFormat::D24S8:
+        texel.x = float(d.depthInHighBits ? (u32 >> 8) : (u32 & 0xffffff)) / 16777215.0f;
+        break;
+      case SpecialFormat::D32S8: memcpy(&texel.x, src, sizeof(float)); break;
+      default: break;
+    }
+
+    if(fmt.bgraOrder)
+      std::swap(texel.x, texel.z);
+
+    memcpy(dst, &texel, sizeof(texel));
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// SIMD versions of the most common formats
+
+#if ENABLED(RDOC_X86)
+
+SIMD_TARGET("sse2")
+static void Decode_RGBA8_SSE2(const FormatDecoder &d, const byte *src, uint32_t count,
+                              uint32_t stride, float *dst)
+{
+  if(stride != 4)
+  {
+    Decode_Components<Lookup8, 4>(d, src, count, stride, dst);
+    return;
+  }
+
+  const __m128i zero = _mm_setzero_si128();
+  const __m128 divisor = _mm_set1_ps(255.0f);
+  const bool swap = d.format.bgraOrder != 0;
+
+  uint32_t x = 0;
+  for(; x + 4 <= count; x += 4)
+  {
+    __m128i texels = _mm_loadu_si128((const __m128i *)(src + x * 4));
+    __m128i lo = _mm_unpacklo_epi8(texels, zero);
+    __m128i hi = _mm_unpackhi_epi8(texels, zero);
+
+    __m128 f[4] = {
+        _mm_div_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(lo, zero)), divisor),
+        _mm_div_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(lo, zero)), divisor),
+        _mm_div_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(hi, zero)), divisor),
+        _mm_div_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(hi, zero)), divisor),
+    };
+
+    for(int i = 0; i < 4; i++)
+    {
+      if(swap)
+        f[i] = _mm_shuffle_ps(f[i], f[i], _MM_SHUFFLE(3, 0, 1, 2));
+      _mm_storeu_ps(dst + (x + i) * 4, f[i]);
+    }
+  }
+
+  if(x < count)
+    Decode_Components<Lookup8, 4>(d, src + x * 4, count - x, stride, dst + x * 4);
+}
+
+SIMD_TARGET("avx2")
+static void Decode_RGBA8_AVX2(const FormatDecoder &d, const byte *src, uint32_t count,
+                              uint32_t stride, float *dst)
+{
+  if(stride != 4)
+  {
+    Decode_Components<Lookup8, 4>(d, src, count, stride, dst);
+    return;
+  }
+
+  const __m256 divisor = _mm256_set1_ps(255.0f);
+  const bool swap = d.format.bgraOrder != 0;
+
+  uint32_t x = 0;
+  for(; x + 8 <= count; x += 8)
+  {
+    // two texels at a time, widened straight from bytes to dwords
+    for(uint32_t i = 0; i < 8; i += 2)
+    {
+      __m128i texels = _mm_loadl_epi64((const __m128i *)(src + (x + i) * 4));
+      __m256 f = _mm256_div_ps(_mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(texels)), divisor);
+      if(swap)
+        f = _mm256_permute_ps(f, _MM_SHUFFLE(3, 0, 1, 2));
+      _mm256_storeu_ps(dst + (x + i) * 4, f);
+    }
+  }
+
+  if(x < count)
+    Decode_Components<Lookup8, 4>(d, src + x * 4, count - x, stride, dst + x * 4);
+}
+
+SIMD_TARGET("avx,f16c")
+static void Decode_Half_F16C(const FormatDecoder &d, const byte *src, uint32_t count,
+                             uint32_t stride, float *dst)
+{
+  if(count == 0)
+    return;
+
+  const uint32_t compCount = d.format.compCount;
+  const bool swap = d.format.bgraOrder && compCount >= 3;
+
+  uint32_t x = 0;
+
+  // tightly packed RGBA is converted two texels at a time
+  if(compCount == 4 && stride == 8)
+  {
+    for(; x + 2 <= count; x += 2)
+    {
+      __m256 v = _mm256_cvtph_ps(_mm_loadu_si128((const __m128i *)(src + x * 8)));
+      if(swap)
+        v = _mm256_permute_ps(v, _MM_SHUFFLE(3, 0, 1, 2));
+      _mm256_storeu_ps(dst + x * 4, v);
+    }
+  }
+
+  // channels the format doesn't have are replaced with (0, 0, 0, 1)
+  const __m128 keep = _mm_castsi128_ps(_mm_setr_epi32(-1, compCount >= 2 ? -1 : 0,
+                                                      compCount >= 3 ? -1 : 0,
+                                                      compCount >= 4 ? -1 : 0));
+  const __m128 defaults = _mm_andnot_ps(keep, _mm_setr_ps(0.0f, 0.0f, 0.0f, 1.0f));
+
+  // each element is loaded as four halfs, so with fewer channels the last few elements are
+  // converted separately to avoid reading past the end of the data
+  const uint64_t end = uint64_t(count - 1) * stride + d.elementSize;
+  uint32_t simdCount = count;
+  while(simdCount > x && uint64_t(simdCount - 1) * stride + 8 > end)
+    simdCount--;
+
+  for(; x < simdCount; x++)
+  {
+    __m128 v = _mm_cvtph_ps(_mm_loadl_epi64((const __m128i *)(src + x * stride)));
+    v = _mm_or_ps(_mm_and_ps(v, keep), defaults);
+    if(swap)
+      v = _mm_permute_ps(v, _MM_SHUFFLE(3, 0, 1, 2));
+    _mm_storeu_ps(dst + x * 4, v);
+  }
+
+  if(x < count)
+    GetComponentDecode<Half>(compCount)(d, src + x * stride, count - x, stride, dst + x * 4);
+}
+
+#endif    // ENABLED(RDOC_X86)
+
+///////////////////////////////////////////////////////////////////////////////
+
+FormatDecoder::FormatDecoder()
+{
+  elementSize = 0;
+  divisor = 1.0f;
+  lowest = -FLT_MAX;
+  depthInHighBits = false;
+  decode = NULL;
+}
+
+bool FormatDecoder::Init(const ResourceFormat &fmt, CompType typeHint, bool glDepthLayout)
+{
+  format = fmt;
+  depthInHighBits = glDepthLayout;
+  decode = NULL;
+
+  if(format.compType == CompType::Typeless)
+    format.compType = typeHint;
+  if(format.compType == CompType::Typeless)
+    format.compType = format.compByteWidth == 4 ? CompType::Float : CompType::UNorm;
+
+  if(format.special)
+  {
+    switch(format.specialFormat)
+    {
+      case SpecialFormat::R4G4:
+      case SpecialFormat::S8: elementSize = 1; break;
+      case SpecialFormat::R5G6B5:
+      case SpecialFormat::R5G5B5A1:
+      case SpecialFormat::R4G4B4A4: elementSize = 2; break;
+      // depth and stencil are read back interleaved, with stencil padded to the depth's size
+      case SpecialFormat::D16S8:
+      case SpecialFormat::D24S8:
+      case SpecialFormat::R10G10B10A2:
+      case SpecialFormat::R11G11B10:
+      case SpecialFormat::R9G9B9E5: elementSize = 4; break;
+      case SpecialFormat::D32S8: elementSize = 8; break;
+      default: return false;
+    }
+
+    decode = &Decode_Special;
+    return true;
+  }
+
+  // depth formats are either float or normalised integer
+  if(format.compType == CompType::Depth)
+    format.compType = format.compByteWidth == 4 ? CompType::Float : CompType::UNorm;
+
+  if(format.compCount == 0 || format.compCount > 4)
+    return false;
+
+  elementSize = format.compCount * format.compByteWidth;
+
+  divisor = 1.0f;
+  lowest = -FLT_MAX;
+
+  const bool normalised = format.compType == CompType::UNorm || format.compType == CompType::SNorm;
+
+  if(format.compType == CompType::UNorm)
+  {
+    divisor = format.compByteWidth == 1 ? 255.0f : 65535.0f;
+  }
+  else if(format.compType == CompType::SNorm)
+  {
+    divisor = format.compByteWidth == 1 ? 127.0f : 32767.0f;
+    lowest = -1.0f;
+  }
+
+  switch(format.compByteWidth)
+  {
+    case 1:
+    {
+      const bool sint = format.compType == CompType::SInt ||
+                        format.compType == CompType::SScaled || format.compType == CompType::SNorm;
+
+      for(uint32_t i = 0; i < 256; i++)
+      {
+        float val = sint ? float(int8_t(i)) : float(i);
+        val = RDCMAX(val / divisor, lowest);
+
+        for(int c = 0; c < 4; c++)
+          lookup8[c][i] = val;
+
+        // alpha is never sRGB encoded
+        if(format.srgbCorrected && format.compType == CompType::UNorm)
+          lookup8[0][i] = lookup8[1][i] = lookup8[2][i] = SRGB8_lookuptable[i];
+      }
+
+      break;
+    }
+    case 2: break;
+    // there are no 32-bit normalised formats
+    case 4:
+      if(normalised)
+        return false;
+      break;
+    case 8:
+      if(format.compType != CompType::Double && format.compType != CompType::Float)
+        return false;
+      break;
+    default: return false;
+  }
+
+  decode = GetComponentDecode(format);
+
+#if ENABLED(RDOC_X86)
+  if(format.compByteWidth == 1 && format.compCount == 4 && format.compType == CompType::UNorm &&
+     !format.srgbCorrected)
+  {
+    if(CPUSupportsAVX2())
+      decode = &Decode_RGBA8_AVX2;
+    else if(CPUSupportsSSE2())
+      decode = &Decode_RGBA8_SSE2;
+  }
+
+  if(format.compByteWidth == 2 && format.compType == CompType::Float && CPUSupportsF16C())
+    decode = &Decode_Half_F16C;
+#endif
+
+  return true;
+}
@@ -0,0 +1,72 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2017 Baldur Karlsson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+#pragma once
+
+#include "api/replay/renderdoc_replay.h"
+
+// Bulk conversion of formatted data - texture rows or buffer elements - to floats. Every element is
+// decoded to RGBA, with channels the format doesn't have set to (0, 0, 0, 1) as when a shader reads
+// it and BGRA data swizzled to RGBA. Values are identical to ConvertComponent and the helpers in
+// formatpacking.h.
+//
+// Init() picks the conversion for a format once, using SSE2/AVX2/F16C versions where the CPU
+// supports them, so that Decode() is a single pass over the data.
+struct FormatDecoder
+{
+  FormatDecoder();
+
+  // returns false if the format can't be decoded on the CPU, e.g. block compressed or YUV formats.
+  // Typeless formats are decoded as typeHint, or as float/unorm if that is typeless too.
+  // glDepthLayout selects GL's packing of D24S8 with depth in the top 24 bits, rather than the
+  // bottom as in D3D and Vulkan.
+  bool Init(const ResourceFormat &fmt, CompType typeHint = CompType::Typeless,
+            bool glDepthLayout = false);
+
+  // decodes count elements starting at src into 4 floats each at dst. Elements are stride bytes
+  // apart, or tightly packed if stride is 0.
+  void Decode(const byte *src, uint32_t count, uint32_t stride, float *dst) const
+  {
+    decode(*this, src, count, stride ? stride : elementSize, dst);
+  }
+
+  // the format as decoded, with any typeless component type resolved
+  ResourceFormat format;
+
+  // size in bytes of one element
+  uint32_t elementSize;
+
+  // integer components are converted as RDCMAX(float(val) / divisor, lowest)
+  float divisor;
+  float lowest;
+
+  // 8-bit components only have 256 possible values each, so are looked up rather than converted
+  float lookup8[4][256];
+
+  bool depthInHighBits;
+
+  typedef void (*DecodeFunc)(const FormatDecoder &decoder, const byte *src, uint32_t count,
+                             uint32_t stride, float *dst);
+  DecodeFunc decode;
+};
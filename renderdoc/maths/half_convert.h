@@ -125,8 +125,14 @@ inline float ConvertFromHalf(uint16_t comp)
     {
       int i;
       float f;
-    } nan;
-    nan.i = 0x7F800001;
-    return nan.f;
+    } special;
+
+    // infinity keeps its sign, anything else is NaN
+    if(mantissa == 0)
+      special.i = (sign ? 0x80000000 : 0) | 0x7F800000;
+    else
+      special.i = 0x7F800001;
+
+    return special.f;
   }
 }
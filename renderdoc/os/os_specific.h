@@ -114,6 +114,7 @@ uint64_t GetCurrentID();
 void JoinThread(ThreadHandle handle);
 void CloseThread(ThreadHandle handle);
 void Sleep(uint32_t milliseconds);
+uint32_t NumberOfCores();
 
 // kind of windows specific, to handle this case:
 // http://blogs.msdn.com/b/oldnewthing/archive/2013/11/05/10463645.aspx
@@ -214,6 +215,14 @@ class StackResolver
 public:
   virtual ~StackResolver() {}
   virtual AddressDetails GetAddr(uint64_t addr) = 0;
+
+  // resolves a whole callstack at once, for resolvers that can do work for several addresses
+  // together
+  virtual void GetAddrs(const uint64_t *addrs, size_t num, AddressDetails *details)
+  {
+    for(size_t i = 0; i < num; i++)
+      details[i] = GetAddr(addrs[i]);
+  }
 };
 
 void Init();
@@ -244,6 +253,9 @@ void GetExecutableFilename(string &selfName);
 uint64_t GetModifiedTimestamp(const string &filename);
 
 void Copy(const char *from, const char *to, bool allowOverwrite);
+// renames a file, replacing any file at the destination in one step if allowOverwrite is set.
+// Both paths must be on the same volume
+bool Move(const char *from, const char *to, bool allowOverwrite);
 void Delete(const char *path);
 std::vector<PathEntry> GetFilesInDirectory(const char *path);
 
@@ -267,6 +279,12 @@ void *logfile_open(const char *filename);
 void logfile_append(void *handle, const char *msg, size_t length);
 void logfile_close(void *handle);
 
+// functions for mapping a read-only view of part of an open file into memory. Returns a handle
+// and sets data to point at the first byte at offset, or returns NULL if the view couldn't be
+// mapped. The view stays valid until mapview_close, even if the FILE is closed first.
+void *mapview_open(FILE *f, uint64_t offset, uint64_t length, byte *&data);
+void mapview_close(void *handle);
+
 // utility functions
 inline bool dump(const char *filename, const void *buffer, size_t size)
 {
@@ -388,6 +406,22 @@ inline uint64_t CountLeadingZeroes(uint64_t value);
 #endif
 };
 
+// Tracks which pages of a range of memory are written, by write-protecting the pages and catching
+// the fault on the first write to each. Only available on Linux, and must be opted into by setting
+// the RENDERDOC_WRITE_TRACKING environment variable, since the application passing tracked memory
+// directly to a syscall will fail with EFAULT instead of faulting.
+namespace WriteTracking
+{
+bool Enabled();
+// starts tracking writes to [base, base+size). Returns false if the range can't be tracked
+bool Track(void *base, size_t size);
+// stops tracking and makes the range writeable again
+void Untrack(void *base);
+// returns the ranges written since tracking started or since the last call, as page-granular
+// offsets from base, and write-protects them again
+void GetWrittenRanges(void *base, vector<DiffRange> &ranges);
+};
+
 // must #define:
 // __PRETTY_FUNCTION_SIGNATURE__ - undecorated function signature
 // GetEmbeddedResource(name_with_underscores_ext) - function/inline that returns the given file in a
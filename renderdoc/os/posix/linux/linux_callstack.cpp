@@ -25,9 +25,11 @@
 #include <execinfo.h>
 #include <stdio.h>
 #include <string.h>
+#include <algorithm>
 #include <map>
 #include <vector>
 #include "os/os_specific.h"
+#include "linux_symbols.h"
 
 void *renderdocBase = NULL;
 void *renderdocEnd = NULL;
@@ -151,82 +153,205 @@ struct LookupModule
 {
   uint64_t base;
   uint64_t end;
+  uint64_t offset;
+  uint32_t index;
   char path[2048];
 };
 
-class LinuxResolver : public Callstack::StackResolver
+// a batch of independent work items shared between several threads, each of which takes the next
+// unprocessed item until there are none left
+struct ResolveJob
 {
-public:
-  LinuxResolver(vector<LookupModule> modules) { m_Modules = modules; }
-  Callstack::AddressDetails GetAddr(uint64_t addr)
+  virtual ~ResolveJob() {}
+  virtual void Process(size_t i) = 0;
+
+  size_t count;
+  volatile int32_t next;
+};
+
+static void ResolveJobThread(void *data)
+{
+  ResolveJob *job = (ResolveJob *)data;
+
+  for(;;)
   {
-    EnsureCached(addr);
+    int32_t i = Atomic::Inc32(&job->next) - 1;
+    if(i < 0 || size_t(i) >= job->count)
+      break;
 
-    return m_Cache[addr];
+    job->Process(size_t(i));
   }
+}
 
-private:
-  void EnsureCached(uint64_t addr)
-  {
-    auto it = m_Cache.insert(
-        std::pair<uint64_t, Callstack::AddressDetails>(addr, Callstack::AddressDetails()));
-    if(!it.second)
-      return;
+static void RunResolveJob(ResolveJob &job, size_t count, size_t itemsPerThread)
+{
+  job.count = count;
+  job.next = 0;
+
+  size_t numThreads = (count + itemsPerThread - 1) / itemsPerThread;
+  numThreads = RDCMIN(numThreads, (size_t)Threading::NumberOfCores());
+
+  // this thread works on the job too
+  std::vector<Threading::ThreadHandle> threads;
+  for(size_t i = 1; i < numThreads; i++)
+    threads.push_back(Threading::CreateThread(&ResolveJobThread, &job));
 
-    Callstack::AddressDetails &ret = it.first->second;
+  ResolveJobThread(&job);
+
+  for(size_t i = 0; i < threads.size(); i++)
+  {
+    Threading::JoinThread(threads[i]);
+    Threading::CloseThread(threads[i]);
+  }
+}
 
-    ret.filename = "Unknown";
-    ret.line = 0;
-    ret.function = StringFormat::Fmt("0x%08llx", addr);
+class LinuxResolver : public Callstack::StackResolver
+{
+public:
+  LinuxResolver(vector<LookupModule> modules) : m_Modules(modules)
+  {
+    std::sort(m_Modules.begin(), m_Modules.end(), ModuleLess);
 
+    // a module can be mapped more than once, but only needs to be indexed once
+    std::map<std::string, uint32_t> paths;
     for(size_t i = 0; i < m_Modules.size(); i++)
     {
-      if(addr >= m_Modules[i].base && addr < m_Modules[i].end)
+      auto it = paths.find(m_Modules[i].path);
+      if(it == paths.end())
       {
-        uint64_t relative = addr - m_Modules[i].base;
-        string cmd =
-            StringFormat::Fmt("addr2line -j.text -fCe \"%s\" 0x%llx", m_Modules[i].path, relative);
+        it = paths.insert(std::make_pair(std::string(m_Modules[i].path), (uint32_t)m_Paths.size()))
+                 .first;
+        m_Paths.push_back(m_Modules[i].path);
+      }
 
-        FILE *f = ::popen(cmd.c_str(), "r");
+      m_Modules[i].index = it->second;
+    }
 
-        char result[2048] = {0};
-        fread(result, 1, 2047, f);
+    m_Indices.resize(m_Paths.size(), NULL);
+    m_Loaded.resize(m_Paths.size(), false);
+  }
 
-        fclose(f);
+  ~LinuxResolver()
+  {
+    for(size_t i = 0; i < m_Indices.size(); i++)
+      delete m_Indices[i];
+  }
 
-        char *line2 = strchr(result, '\n');
-        if(line2)
+  Callstack::AddressDetails GetAddr(uint64_t addr)
+  {
+    Callstack::AddressDetails ret;
+    GetAddrs(&addr, 1, &ret);
+    return ret;
+  }
+
+  void GetAddrs(const uint64_t *addrs, size_t num, Callstack::AddressDetails *details)
+  {
+    std::vector<uint64_t> pending;
+    for(size_t i = 0; i < num; i++)
+      if(m_Cache.find(addrs[i]) == m_Cache.end())
+        pending.push_back(addrs[i]);
+
+    std::sort(pending.begin(), pending.end());
+    pending.erase(std::unique(pending.begin(), pending.end()), pending.end());
+
+    if(!pending.empty())
+    {
+      // indexing a module's debug information is by far the slowest part, so load every module
+      // this batch needs at once
+      LoadJob load(*this);
+      for(size_t i = 0; i < pending.size(); i++)
+      {
+        const LookupModule *mod = FindModule(pending[i]);
+        if(mod && !m_Loaded[mod->index])
         {
-          *line2 = 0;
-          line2++;
+          m_Loaded[mod->index] = true;
+          load.indices.push_back(mod->index);
         }
+      }
 
-        ret.function = result;
+      if(!load.indices.empty())
+        RunResolveJob(load, load.indices.size(), 1);
 
-        if(line2)
-        {
-          char *last = line2 + strlen(line2) - 1;
-          uint32_t mul = 1;
-          ret.line = 0;
-          while(*last >= '0' && *last <= '9')
-          {
-            ret.line += mul * (uint32_t(*last) - uint32_t('0'));
-            *last = 0;
-            last--;
-            mul *= 10;
-          }
-          if(*last == ':')
-            *last = 0;
+      ResolveAddrJob resolve(*this, pending);
+      RunResolveJob(resolve, pending.size(), 64);
 
-          ret.filename = line2;
-        }
+      for(size_t i = 0; i < pending.size(); i++)
+        m_Cache[pending[i]] = resolve.results[i];
+    }
 
-        break;
-      }
+    for(size_t i = 0; i < num; i++)
+      details[i] = m_Cache[addrs[i]];
+  }
+
+private:
+  static bool ModuleLess(const LookupModule &a, const LookupModule &b) { return a.base < b.base; }
+  const LookupModule *FindModule(uint64_t addr) const
+  {
+    size_t lo = 0, hi = m_Modules.size();
+    while(lo < hi)
+    {
+      size_t mid = (lo + hi) / 2;
+      if(m_Modules[mid].base <= addr)
+        lo = mid + 1;
+      else
+        hi = mid;
     }
+
+    if(lo == 0 || addr >= m_Modules[lo - 1].end)
+      return NULL;
+
+    return &m_Modules[lo - 1];
   }
 
+  struct LoadJob : public ResolveJob
+  {
+    LoadJob(LinuxResolver &r) : resolver(r) {}
+    void Process(size_t i)
+    {
+      uint32_t idx = indices[i];
+      resolver.m_Indices[idx] = ElfSymbolIndex::Load(resolver.m_Paths[idx].c_str());
+    }
+
+    LinuxResolver &resolver;
+    std::vector<uint32_t> indices;
+  };
+
+  struct ResolveAddrJob : public ResolveJob
+  {
+    ResolveAddrJob(LinuxResolver &r, const std::vector<uint64_t> &a)
+        : resolver(r), addrs(a), results(a.size())
+    {
+    }
+    void Process(size_t i)
+    {
+      uint64_t addr = addrs[i];
+      Callstack::AddressDetails &ret = results[i];
+
+      ret.filename = "Unknown";
+      ret.line = 0;
+      ret.function = StringFormat::Fmt("0x%08llx", addr);
+
+      const LookupModule *mod = resolver.FindModule(addr);
+      if(mod == NULL || resolver.m_Indices[mod->index] == NULL)
+        return;
+
+      // maps list the file offset each mapping starts at, which the module's program headers
+      // translate into the addresses its symbols and line table use
+      const ElfSymbolIndex *index = resolver.m_Indices[mod->index];
+      uint64_t address = 0;
+      if(index->FileOffsetToAddress(addr - mod->base + mod->offset, address))
+        index->Resolve(address, ret);
+    }
+
+    LinuxResolver &resolver;
+    const std::vector<uint64_t> &addrs;
+    std::vector<Callstack::AddressDetails> results;
+  };
+
   std::vector<LookupModule> m_Modules;
+  std::vector<std::string> m_Paths;
+  std::vector<ElfSymbolIndex *> m_Indices;
+  std::vector<bool> m_Loaded;
   std::map<uint64_t, Callstack::AddressDetails> m_Cache;
 };
 
@@ -256,21 +381,23 @@ StackResolver *MakeResolver(char *moduleDB, size_t DBSize, string pdbSearchPaths
 
     // find .text segments
     {
-      long unsigned int base = 0, end = 0;
+      long unsigned int base = 0, end = 0, offset = 0;
 
       int inode = 0;
       int offs = 0;
       //                        base-end   perms offset devid   inode offs
-      int num = sscanf(search, "%lx-%lx  r-xp  %*x    %*x:%*x %d    %n", &base, &end, &inode, &offs);
+      int num = sscanf(search, "%lx-%lx  r-xp  %lx    %*x:%*x %d    %n", &base, &end, &offset,
+                       &inode, &offs);
 
       // we don't care about inode actually, we ust use it to verify that
-      // we read all 3 params (and so perms == r-xp)
-      if(num == 3 && offs > 0)
+      // we read all 4 params (and so perms == r-xp)
+      if(num == 4 && offs > 0)
       {
         LookupModule mod = {0};
 
         mod.base = (uint64_t)base;
         mod.end = (uint64_t)end;
+        mod.offset = (uint64_t)offset;
 
         search += offs;
         while(size_t(search - moduleDB) < DBSize && (*search == ' ' || *search == '\t'))
@@ -295,37 +422,7 @@ StackResolver *MakeResolver(char *moduleDB, size_t DBSize, string pdbSearchPaths
             mod.path[i] = search[i];
           }
 
-          // addr2line wants offsets relative to text section, have to find offset of .text section
-          // in this
-          // mmapped section
-
-          int textoffs = 0;
-          string cmd = StringFormat::Fmt("readelf -WS \"%s\"", mod.path);
-
-          FILE *f = ::popen(cmd.c_str(), "r");
-
-          char result[4096] = {0};
-          fread(result, 1, 4095, f);
-
-          fclose(f);
-
-          // find .text line
-          char *find = strstr(result, ".text");
-
-          if(find)
-          {
-            find += 5;
-
-            while(isalpha(*find) || isspace(*find))
-              find++;
-
-            // virtual address is listed first, we want the offset
-            sscanf(find, "%*x %x", &textoffs);
-
-            mod.base += textoffs;
-
-            modules.push_back(mod);
-          }
+          modules.push_back(mod);
         }
       }
     }
@@ -0,0 +1,1232 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016-2017 Baldur Karlsson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+#include "linux_symbols.h"
+#include <cxxabi.h>
+#include <elf.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <list>
+#include <map>
+#include "3rdparty/zstd/zstd.h"
+#include "common/common.h"
+#include "serialise/string_utils.h"
+
+// tinyexr's implementation includes miniz with C linkage, so use the inflate functions from there
+// rather than compiling in a second copy with the same names. Only the declarations are needed.
+#define MINIZ_HEADER_FILE_ONLY
+#define MINIZ_NO_ARCHIVE_APIS
+#define MINIZ_NO_ZLIB_APIS
+#include "miniz/miniz.c"
+
+#ifndef ELFCOMPRESS_ZSTD
+#define ELFCOMPRESS_ZSTD 2
+#endif
+
+// the DWARF constants we need from the line number program, so we don't depend on dwarf.h
+enum
+{
+  DW_LNS_copy = 0x01,
+  DW_LNS_advance_pc = 0x02,
+  DW_LNS_advance_line = 0x03,
+  DW_LNS_set_file = 0x04,
+  DW_LNS_const_add_pc = 0x08,
+  DW_LNS_fixed_advance_pc = 0x09,
+
+  DW_LNE_end_sequence = 0x01,
+  DW_LNE_set_address = 0x02,
+  DW_LNE_define_file = 0x03,
+
+  DW_LNCT_path = 0x1,
+  DW_LNCT_directory_index = 0x2,
+
+  DW_FORM_block2 = 0x03,
+  DW_FORM_block4 = 0x04,
+  DW_FORM_data2 = 0x05,
+  DW_FORM_data4 = 0x06,
+  DW_FORM_data8 = 0x07,
+  DW_FORM_string = 0x08,
+  DW_FORM_block = 0x09,
+  DW_FORM_block1 = 0x0a,
+  DW_FORM_data1 = 0x0b,
+  DW_FORM_sdata = 0x0d,
+  DW_FORM_strp = 0x0e,
+  DW_FORM_udata = 0x0f,
+  DW_FORM_data16 = 0x1e,
+  DW_FORM_line_strp = 0x1f,
+};
+
+static const uint32_t SymbolCacheMagic = 0x59534452;    // 'RDSY'
+static const uint32_t SymbolCacheVersion = 1;
+
+struct SymbolCacheHeader
+{
+  uint32_t magic;
+  uint32_t version;
+  uint64_t numSymbols;
+  uint64_t numLines;
+  uint64_t stringSize;
+};
+
+// bounds-checked reader over a DWARF section. Any read past the end returns 0 and marks the reader
+// as failed, so parsing loops only need to check ok.
+struct DwarfReader
+{
+  DwarfReader(const byte *start, const byte *finish) : cur(start), end(finish), ok(true) {}
+  bool Has(uint64_t bytes)
+  {
+    if(ok && uint64_t(end - cur) >= bytes)
+      return true;
+
+    ok = false;
+    cur = end;
+    return false;
+  }
+
+  template <typename T>
+  T Read()
+  {
+    T ret = T();
+    if(Has(sizeof(T)))
+    {
+      memcpy(&ret, cur, sizeof(T));
+      cur += sizeof(T);
+    }
+    return ret;
+  }
+
+  void Skip(uint64_t bytes)
+  {
+    if(Has(bytes))
+      cur += bytes;
+  }
+
+  uint64_t ULEB()
+  {
+    uint64_t ret = 0;
+    uint32_t shift = 0;
+    while(Has(1))
+    {
+      byte b = *cur++;
+      if(shift < 64)
+        ret |= uint64_t(b & 0x7f) << shift;
+      shift += 7;
+      if((b & 0x80) == 0)
+        break;
+    }
+    return ret;
+  }
+
+  int64_t SLEB()
+  {
+    int64_t ret = 0;
+    uint32_t shift = 0;
+    byte b = 0;
+    while(Has(1))
+    {
+      b = *cur++;
+      if(shift < 64)
+        ret |= int64_t(b & 0x7f) << shift;
+      shift += 7;
+      if((b & 0x80) == 0)
+        break;
+    }
+    if(shift < 64 && (b & 0x40))
+      ret |= -(int64_t(1) << shift);
+    return ret;
+  }
+
+  const char *String()
+  {
+    const byte *start = cur;
+    while(cur < end && *cur)
+      cur++;
+
+    if(cur >= end)
+    {
+      ok = false;
+      return "";
+    }
+
+    cur++;
+    return (const char *)start;
+  }
+
+  uint64_t Offset(bool dwarf64) { return dwarf64 ? Read<uint64_t>() : Read<uint32_t>(); }
+  uint64_t Address(uint64_t size)
+  {
+    switch(size)
+    {
+      case 1: return Read<uint8_t>();
+      case 2: return Read<uint16_t>();
+      case 4: return Read<uint32_t>();
+      case 8: return Read<uint64_t>();
+      default: ok = false; return 0;
+    }
+  }
+
+  const byte *cur;
+  const byte *end;
+  bool ok;
+};
+
+struct ElfSection
+{
+  std::string name;
+  uint32_t type;
+  uint64_t flags;
+  uint64_t offset;
+  uint64_t size;
+  uint32_t link;
+};
+
+// a read-only mapping of an ELF file, with its section and segment headers parsed out
+class ElfFile
+{
+public:
+  ElfFile() : is64(false), isARM(false), m_View(NULL), m_Data(NULL), m_Size(0) {}
+  ~ElfFile() { Close(); }
+  bool Open(const char *path);
+  void Close();
+
+  const ElfSection *FindSection(const char *name) const;
+  const ElfSection *FindSection(uint32_t type) const;
+
+  // returns the contents of a section, decompressing it first if necessary. Returns false if the
+  // section has no data in the file or it can't be decompressed.
+  bool GetContents(const ElfSection *sec, const byte *&data, size_t &size);
+
+  std::string BuildID();
+  std::string DebugLink();
+
+  std::vector<ElfSymbolIndex::Segment> segments;
+  std::vector<ElfSection> sections;
+  bool is64;
+  bool isARM;
+
+private:
+  template <typename Ehdr, typename Phdr, typename Shdr>
+  void ParseHeaders();
+
+  void *m_View;
+  const byte *m_Data;
+  uint64_t m_Size;
+
+  // decompressed section contents, kept alive as long as the file is open
+  std::list<std::vector<byte> > m_Decompressed;
+};
+
+bool ElfFile::Open(const char *path)
+{
+  Close();
+
+  FILE *f = FileIO::fopen(path, "rb");
+
+  if(f == NULL)
+    return false;
+
+  FileIO::fseek64(f, 0, SEEK_END);
+  m_Size = FileIO::ftell64(f);
+
+  byte *data = NULL;
+  if(m_Size >= sizeof(Elf32_Ehdr))
+    m_View = FileIO::mapview_open(f, 0, m_Size, data);
+
+  // the view stays valid once the file is closed
+  FileIO::fclose(f);
+
+  m_Data = data;
+
+  if(m_View == NULL)
+    return false;
+
+  // we only read files for the platform we're running on, which is always little-endian
+  if(memcmp(m_Data, ELFMAG, SELFMAG) != 0 || m_Data[EI_DATA] != ELFDATA2LSB)
+  {
+    Close();
+    return false;
+  }
+
+  if(m_Data[EI_CLASS] == ELFCLASS64 && m_Size >= sizeof(Elf64_Ehdr))
+  {
+    is64 = true;
+    ParseHeaders<Elf64_Ehdr, Elf64_Phdr, Elf64_Shdr>();
+  }
+  else if(m_Data[EI_CLASS] == ELFCLASS32)
+  {
+    is64 = false;
+    ParseHeaders<Elf32_Ehdr, Elf32_Phdr, Elf32_Shdr>();
+  }
+  else
+  {
+    Close();
+    return false;
+  }
+
+  return true;
+}
+
+void ElfFile::Close()
+{
+  if(m_View)
+    FileIO::mapview_close(m_View);
+
+  m_View = NULL;
+  m_Data = NULL;
+  m_Size = 0;
+  segments.clear();
+  sections.clear();
+  m_Decompressed.clear();
+}
+
+template <typename Ehdr, typename Phdr, typename Shdr>
+void ElfFile::ParseHeaders()
+{
+  Ehdr eh;
+  memcpy(&eh, m_Data, sizeof(eh));
+
+  isARM = (eh.e_machine == EM_ARM);
+
+  if(eh.e_phoff && eh.e_phentsize == sizeof(Phdr) && eh.e_phoff <= m_Size &&
+     uint64_t(eh.e_phnum) * sizeof(Phdr) <= m_Size - eh.e_phoff)
+  {
+    for(uint32_t i = 0; i < eh.e_phnum; i++)
+    {
+      Phdr ph;
+      memcpy(&ph, m_Data + eh.e_phoff + i * sizeof(Phdr), sizeof(ph));
+
+      if(ph.p_type != PT_LOAD)
+        continue;
+
+      ElfSymbolIndex::Segment seg = {ph.p_offset, ph.p_vaddr, ph.p_filesz};
+      segments.push_back(seg);
+    }
+  }
+
+  if(eh.e_shoff == 0 || eh.e_shentsize != sizeof(Shdr) || eh.e_shoff > m_Size ||
+     uint64_t(eh.e_shnum) * sizeof(Shdr) > m_Size - eh.e_shoff)
+    return;
+
+  std::vector<Shdr> shdrs(eh.e_shnum);
+  if(!shdrs.empty())
+    memcpy(&shdrs[0], m_Data + eh.e_shoff, shdrs.size() * sizeof(Shdr));
+
+  const char *names = NULL;
+  uint64_t namesSize = 0;
+
+  if(eh.e_shstrndx < shdrs.size())
+  {
+    const Shdr &strtab = shdrs[eh.e_shstrndx];
+    if(strtab.sh_type != SHT_NOBITS && strtab.sh_offset <= m_Size &&
+       strtab.sh_size <= m_Size - strtab.sh_offset)
+    {
+      names = (const char *)m_Data + strtab.sh_offset;
+      namesSize = strtab.sh_size;
+    }
+  }
+
+  sections.resize(shdrs.size());
+  for(size_t i = 0; i < shdrs.size(); i++)
+  {
+    ElfSection &sec = sections[i];
+    sec.type = shdrs[i].sh_type;
+    sec.flags = shdrs[i].sh_flags;
+    sec.offset = shdrs[i].sh_offset;
+    sec.size = shdrs[i].sh_size;
+    sec.link = shdrs[i].sh_link;
+
+    if(names && shdrs[i].sh_name < namesSize)
+    {
+      const char *name = names + shdrs[i].sh_name;
+      sec.name.assign(name, strnlen(name, size_t(namesSize - shdrs[i].sh_name)));
+    }
+  }
+}
+
+const ElfSection *ElfFile::FindSection(const char *name) const
+{
+  for(size_t i = 0; i < sections.size(); i++)
+    if(sections[i].name == name)
+      return &sections[i];
+
+  return NULL;
+}
+
+const ElfSection *ElfFile::FindSection(uint32_t type) const
+{
+  for(size_t i = 0; i < sections.size(); i++)
+    if(sections[i].type == type)
+      return &sections[i];
+
+  return NULL;
+}
+
+bool ElfFile::GetContents(const ElfSection *sec, const byte *&data, size_t &size)
+{
+  data = NULL;
+  size = 0;
+
+  if(sec == NULL || sec->type == SHT_NOBITS || sec->offset > m_Size ||
+     sec->size > m_Size - sec->offset)
+    return false;
+
+  const byte *raw = m_Data + sec->offset;
+
+  if((sec->flags & SHF_COMPRESSED) == 0)
+  {
+    data = raw;
+    size = (size_t)sec->size;
+    return true;
+  }
+
+  uint32_t compressType = 0;
+  uint64_t uncompressedSize = 0;
+  size_t headerSize = 0;
+
+  if(is64)
+  {
+    Elf64_Chdr ch;
+    if(sec->size < sizeof(ch))
+      return false;
+    memcpy(&ch, raw, sizeof(ch));
+    compressType = ch.ch_type;
+    uncompressedSize = ch.ch_size;
+    headerSize = sizeof(ch);
+  }
+  else
+  {
+    Elf32_Chdr ch;
+    if(sec->size < sizeof(ch))
+      return false;
+    memcpy(&ch, raw, sizeof(ch));
+    compressType = ch.ch_type;
+    uncompressedSize = ch.ch_size;
+    headerSize = sizeof(ch);
+  }
+
+  // guard against corrupt headers asking for absurd allocations
+  if(uncompressedSize == 0 || uncompressedSize > 0xffffffffULL)
+    return false;
+
+  m_Decompressed.push_back(std::vector<byte>());
+  std::vector<byte> &out = m_Decompressed.back();
+  out.resize((size_t)uncompressedSize);
+
+  const byte *src = raw + headerSize;
+  size_t srcSize = size_t(sec->size - headerSize);
+
+  bool success = false;
+
+  if(compressType == ELFCOMPRESS_ZLIB)
+  {
+    size_t written = tinfl_decompress_mem_to_mem(&out[0], out.size(), src, srcSize,
+                                                 TINFL_FLAG_PARSE_ZLIB_HEADER);
+    success = (written == out.size());
+  }
+  else if(compressType == ELFCOMPRESS_ZSTD)
+  {
+    size_t written = ZSTD_decompress(&out[0], out.size(), src, srcSize);
+    success = !ZSTD_isError(written) && written == out.size();
+  }
+
+  if(!success)
+  {
+    RDCWARN("Couldn't decompress section %s (type %u)", sec->name.c_str(), compressType);
+    m_Decompressed.pop_back();
+    return false;
+  }
+
+  data = &out[0];
+  size = out.size();
+  return true;
+}
+
+std::string ElfFile::BuildID()
+{
+  for(size_t s = 0; s < sections.size(); s++)
+  {
+    const byte *data = NULL;
+    size_t size = 0;
+    if(sections[s].type != SHT_NOTE || !GetContents(&sections[s], data, size))
+      continue;
+
+    // Elf32_Nhdr and Elf64_Nhdr are identical, and names and descriptors are 4-byte aligned in both
+    size_t offs = 0;
+    while(offs + sizeof(Elf64_Nhdr) <= size)
+    {
+      Elf64_Nhdr note;
+      memcpy(&note, data + offs, sizeof(note));
+      offs += sizeof(note);
+
+      size_t nameOffs = offs;
+      size_t descOffs = nameOffs + AlignUp4((size_t)note.n_namesz);
+      size_t next = descOffs + AlignUp4((size_t)note.n_descsz);
+
+      if(descOffs > size || next > size || next < offs)
+        break;
+
+      if(note.n_type == NT_GNU_BUILD_ID && note.n_namesz == 4 &&
+         memcmp(data + nameOffs, "GNU", 4) == 0)
+      {
+        std::string ret;
+        for(uint32_t i = 0; i < note.n_descsz; i++)
+          ret += StringFormat::Fmt("%02x", data[descOffs + i]);
+        return ret;
+      }
+
+      offs = next;
+    }
+  }
+
+  return "";
+}
+
+std::string ElfFile::DebugLink()
+{
+  const byte *data = NULL;
+  size_t size = 0;
+  if(!GetContents(FindSection(".gnu_debuglink"), data, size))
+    return "";
+
+  return std::string((const char *)data, strnlen((const char *)data, size));
+}
+
+static std::string JoinPath(const std::vector<std::string> &dirs, uint64_t dirIndex,
+                            const std::string &name)
+{
+  if(name.empty() || name[0] == '/' || dirIndex >= dirs.size() || dirs[dirIndex].empty())
+    return name;
+
+  std::string dir = dirs[dirIndex];
+
+  // other directories can be relative to directory 0, the compilation directory. That's only listed
+  // in the line table from DWARF 5 onwards, before then it's empty here
+  if(dir[0] != '/' && dirIndex != 0 && !dirs[0].empty())
+    dir = JoinPath(dirs, 0, dir);
+
+  if(dir[dir.size() - 1] == '/')
+    return dir + name;
+
+  return dir + "/" + name;
+}
+
+// builds up the arrays in an ElfSymbolIndex from one or more ELF files
+class ElfIndexBuilder
+{
+public:
+  ElfIndexBuilder(ElfSymbolIndex &index) : m_Index(index) {}
+  bool AddSymbols(ElfFile &elf, uint32_t symtabType);
+  bool AddLines(ElfFile &elf);
+  void Finish();
+
+private:
+  uint32_t AddString(const char *str, size_t len);
+  uint32_t AddPath(const std::string &path);
+
+  void ParseLineProgram(DwarfReader &unit, bool dwarf64, ElfFile &elf, const byte *lineStr,
+                        size_t lineStrSize, const byte *str, size_t strSize);
+  bool ReadEntryFormat(DwarfReader &reader, bool dwarf64,
+                       const std::vector<std::pair<uint64_t, uint64_t> > &format,
+                       const byte *lineStr, size_t lineStrSize, const byte *str, size_t strSize,
+                       std::string &path, uint64_t &dirIndex);
+  void EndSequence(std::vector<ElfSymbolIndex::LineRow> &seq, uint64_t endAddress,
+                   uint64_t tombstone);
+
+  ElfSymbolIndex &m_Index;
+
+  // file paths repeat across every compile unit that includes the same header, so only store them
+  // once
+  std::map<std::string, uint32_t> m_Paths;
+};
+
+uint32_t ElfIndexBuilder::AddString(const char *str, size_t len)
+{
+  uint32_t ret = (uint32_t)m_Index.m_Strings.size();
+  m_Index.m_Strings.insert(m_Index.m_Strings.end(), str, str + len);
+  m_Index.m_Strings.push_back(0);
+  return ret;
+}
+
+uint32_t ElfIndexBuilder::AddPath(const std::string &path)
+{
+  auto it = m_Paths.find(path);
+  if(it != m_Paths.end())
+    return it->second;
+
+  uint32_t ret = AddString(path.c_str(), path.size());
+  m_Paths[path] = ret;
+  return ret;
+}
+
+bool ElfIndexBuilder::AddSymbols(ElfFile &elf, uint32_t symtabType)
+{
+  const ElfSection *symtab = elf.FindSection(symtabType);
+
+  if(symtab == NULL || symtab->link >= elf.sections.size())
+    return false;
+
+  const byte *syms = NULL, *strs = NULL;
+  size_t symsSize = 0, strsSize = 0;
+
+  if(!elf.GetContents(symtab, syms, symsSize) ||
+     !elf.GetContents(&elf.sections[symtab->link], strs, strsSize))
+    return false;
+
+  size_t stride = elf.is64 ? sizeof(Elf64_Sym) : sizeof(Elf32_Sym);
+
+  size_t prevCount = m_Index.m_Symbols.size();
+
+  for(size_t offs = 0; offs + stride <= symsSize; offs += stride)
+  {
+    uint64_t value = 0, size = 0;
+    uint32_t name = 0;
+    uint8_t type = 0;
+    uint16_t shndx = SHN_UNDEF;
+
+    if(elf.is64)
+    {
+      Elf64_Sym sym;
+      memcpy(&sym, syms + offs, sizeof(sym));
+      value = sym.st_value;
+      size = sym.st_size;
+      name = sym.st_name;
+      type = ELF64_ST_TYPE(sym.st_info);
+      shndx = sym.st_shndx;
+    }
+    else
+    {
+      Elf32_Sym sym;
+      memcpy(&sym, syms + offs, sizeof(sym));
+      value = sym.st_value;
+      size = sym.st_size;
+      name = sym.st_name;
+      type = ELF32_ST_TYPE(sym.st_info);
+      shndx = sym.st_shndx;
+    }
+
+    if((type != STT_FUNC && type != STT_GNU_IFUNC) || shndx == SHN_UNDEF || value == 0 ||
+       name >= strsSize)
+      continue;
+
+    // the low bit of ARM function symbols marks thumb code, not part of the address
+    if(elf.isARM)
+      value &= ~1ULL;
+
+    const char *str = (const char *)strs + name;
+    size_t len = strnlen(str, strsSize - name);
+
+    if(len == 0 || len == strsSize - name)
+      continue;
+
+    ElfSymbolIndex::Symbol s = {value, (uint32_t)RDCMIN(size, (uint64_t)UINT32_MAX),
+                                AddString(str, len)};
+    m_Index.m_Symbols.push_back(s);
+  }
+
+  return m_Index.m_Symbols.size() > prevCount;
+}
+
+bool ElfIndexBuilder::AddLines(ElfFile &elf)
+{
+  const byte *lines = NULL;
+  size_t linesSize = 0;
+
+  if(!elf.GetContents(elf.FindSection(".debug_line"), lines, linesSize))
+    return false;
+
+  // DWARF 5 moves strings out into separate sections. Either may be missing
+  const byte *lineStr = NULL, *str = NULL;
+  size_t lineStrSize = 0, strSize = 0;
+  elf.GetContents(elf.FindSection(".debug_line_str"), lineStr, lineStrSize);
+  elf.GetContents(elf.FindSection(".debug_str"), str, strSize);
+
+  size_t prevCount = m_Index.m_Lines.size();
+
+  DwarfReader reader(lines, lines + linesSize);
+
+  while(reader.ok && reader.cur < reader.end)
+  {
+    uint64_t unitLength = reader.Read<uint32_t>();
+    bool dwarf64 = false;
+    if(unitLength == 0xffffffff)
+    {
+      dwarf64 = true;
+      unitLength = reader.Read<uint64_t>();
+    }
+
+    if(!reader.Has(unitLength))
+      break;
+
+    DwarfReader unit(reader.cur, reader.cur + unitLength);
+    reader.cur += unitLength;
+
+    ParseLineProgram(unit, dwarf64, elf, lineStr, lineStrSize, str, strSize);
+  }
+
+  return m_Index.m_Lines.size() > prevCount;
+}
+
+bool ElfIndexBuilder::ReadEntryFormat(DwarfReader &reader, bool dwarf64,
+                                      const std::vector<std::pair<uint64_t, uint64_t> > &format,
+                                      const byte *lineStr, size_t lineStrSize, const byte *str,
+                                      size_t strSize, std::string &path, uint64_t &dirIndex)
+{
+  for(size_t i = 0; i < format.size(); i++)
+  {
+    uint64_t content = format[i].first;
+    uint64_t form = format[i].second;
+
+    const char *string = NULL;
+    uint64_t value = 0;
+
+    switch(form)
+    {
+      case DW_FORM_string: string = reader.String(); break;
+      case DW_FORM_line_strp:
+      case DW_FORM_strp:
+      {
+        uint64_t offs = reader.Offset(dwarf64);
+        const byte *base = form == DW_FORM_line_strp ? lineStr : str;
+        size_t size = form == DW_FORM_line_strp ? lineStrSize : strSize;
+        if(base && offs < size && memchr(base + offs, 0, size_t(size - offs)))
+          string = (const char *)base + offs;
+        break;
+      }
+      case DW_FORM_udata: value = reader.ULEB(); break;
+      case DW_FORM_sdata: value = (uint64_t)reader.SLEB(); break;
+      case DW_FORM_data1: value = reader.Read<uint8_t>(); break;
+      case DW_FORM_data2: value = reader.Read<uint16_t>(); break;
+      case DW_FORM_data4: value = reader.Read<uint32_t>(); break;
+      case DW_FORM_data8: value = reader.Read<uint64_t>(); break;
+      case DW_FORM_data16: reader.Skip(16); break;
+      case DW_FORM_block: reader.Skip(reader.ULEB()); break;
+      case DW_FORM_block1: reader.Skip(reader.Read<uint8_t>()); break;
+      case DW_FORM_block2: reader.Skip(reader.Read<uint16_t>()); break;
+      case DW_FORM_block4: reader.Skip(reader.Read<uint32_t>()); break;
+      default:
+        // can't know how large an unknown form is, so nothing after it can be read
+        return false;
+    }
+
+    if(content == DW_LNCT_path && string)
+      path = string;
+    else if(content == DW_LNCT_directory_index)
+      dirIndex = value;
+  }
+
+  return reader.ok;
+}
+
+void ElfIndexBuilder::ParseLineProgram(DwarfReader &unit, bool dwarf64, ElfFile &elf,
+                                       const byte *lineStr, size_t lineStrSize, const byte *str,
+                                       size_t strSize)
+{
+  uint16_t version = unit.Read<uint16_t>();
+
+  if(version < 2 || version > 5)
+    return;
+
+  uint64_t addressSize = elf.is64 ? 8 : 4;
+
+  if(version >= 5)
+  {
+    addressSize = unit.Read<uint8_t>();
+    unit.Read<uint8_t>();    // segment_selector_size
+  }
+
+  uint64_t headerLength = unit.Offset(dwarf64);
+
+  if(!unit.Has(headerLength))
+    return;
+
+  // the program starts after the header regardless of any fields we don't understand
+  const byte *program = unit.cur + headerLength;
+
+  uint8_t minInstLength = unit.Read<uint8_t>();
+  if(version >= 4)
+    unit.Read<uint8_t>();    // maximum_operations_per_instruction, only used for VLIW
+  unit.Read<uint8_t>();    // default_is_stmt
+  int8_t lineBase = unit.Read<int8_t>();
+  uint8_t lineRange = unit.Read<uint8_t>();
+  uint8_t opcodeBase = unit.Read<uint8_t>();
+
+  if(lineRange == 0 || opcodeBase == 0)
+    return;
+
+  std::vector<uint8_t> opcodeLengths(opcodeBase - 1);
+  for(size_t i = 0; i < opcodeLengths.size(); i++)
+    opcodeLengths[i] = unit.Read<uint8_t>();
+
+  std::vector<std::string> dirs;
+  // indices into m_Strings, or ~0U for files we couldn't read
+  std::vector<uint32_t> files;
+
+  if(version >= 5)
+  {
+    std::vector<std::pair<uint64_t, uint64_t> > format;
+
+    format.resize(unit.Read<uint8_t>());
+    for(size_t i = 0; i < format.size(); i++)
+    {
+      format[i].first = unit.ULEB();
+      format[i].second = unit.ULEB();
+    }
+
+    uint64_t count = unit.ULEB();
+    for(uint64_t i = 0; unit.ok && i < count; i++)
+    {
+      std::string path;
+      uint64_t dirIndex = 0;
+      if(!ReadEntryFormat(unit, dwarf64, format, lineStr, lineStrSize, str, strSize, path,
+                          dirIndex))
+        return;
+      dirs.push_back(path);
+    }
+
+    format.resize(unit.Read<uint8_t>());
+    for(size_t i = 0; i < format.size(); i++)
+    {
+      format[i].first = unit.ULEB();
+      format[i].second = unit.ULEB();
+    }
+
+    count = unit.ULEB();
+    for(uint64_t i = 0; unit.ok && i < count; i++)
+    {
+      std::string path;
+      uint64_t dirIndex = 0;
+      if(!ReadEntryFormat(unit, dwarf64, format, lineStr, lineStrSize, str, strSize, path,
+                          dirIndex))
+        return;
+      files.push_back(AddPath(JoinPath(dirs, dirIndex, path)));
+    }
+  }
+  else
+  {
+    // before DWARF 5 directory and file 0 are implicitly the compilation directory and primary
+    // source file, which aren't listed here
+    dirs.push_back("");
+    files.push_back(~0U);
+
+    for(;;)
+    {
+      const char *dir = unit.String();
+      if(!unit.ok || dir[0] == 0)
+        break;
+      dirs.push_back(dir);
+    }
+
+    for(;;)
+    {
+      const char *name = unit.String();
+      if(!unit.ok || name[0] == 0)
+        break;
+      uint64_t dirIndex = unit.ULEB();
+      unit.ULEB();    // modification time
+      unit.ULEB();    // file length
+      files.push_back(AddPath(JoinPath(dirs, dirIndex, name)));
+    }
+  }
+
+  if(!unit.ok || program > unit.end)
+    return;
+
+  unit.cur = program;
+
+  // addresses at or past this are placeholders for code that was discarded at link time
+  uint64_t tombstone = addressSize == 4 ? 0xfffffffeULL : 0xfffffffffffffffeULL;
+
+  std::vector<ElfSymbolIndex::LineRow> seq;
+
+  uint64_t address = 0;
+  uint64_t file = 1;
+  int64_t line = 1;
+
+  while(unit.ok && unit.cur < unit.end)
+  {
+    uint8_t op = unit.Read<uint8_t>();
+
+    if(op >= opcodeBase)
+    {
+      // special opcodes advance both address and line, then append a row
+      uint8_t adjusted = op - opcodeBase;
+      address += (adjusted / lineRange) * minInstLength;
+      line += lineBase + (adjusted % lineRange);
+
+      ElfSymbolIndex::LineRow row = {address, file < files.size() ? files[file] : ~0U,
+                                     (uint32_t)RDCMAX(line, (int64_t)0)};
+      seq.push_back(row);
+    }
+    else if(op == 0)
+    {
+      uint64_t length = unit.ULEB();
+      if(length == 0 || !unit.Has(length))
+        break;
+
+      const byte *next = unit.cur + length;
+      uint8_t sub = unit.Read<uint8_t>();
+
+      if(sub == DW_LNE_end_sequence)
+      {
+        EndSequence(seq, address, tombstone);
+        address = 0;
+        file = 1;
+        line = 1;
+      }
+      else if(sub == DW_LNE_set_address)
+      {
+        address = unit.Address(length - 1);
+      }
+      else if(sub == DW_LNE_define_file && version < 5)
+      {
+        const char *name = unit.String();
+        uint64_t dirIndex = unit.ULEB();
+        files.push_back(AddPath(JoinPath(dirs, dirIndex, name)));
+      }
+
+      unit.cur = next;
+    }
+    else
+    {
+      switch(op)
+      {
+        case DW_LNS_copy:
+        {
+          ElfSymbolIndex::LineRow row = {address, file < files.size() ? files[file] : ~0U,
+                                         (uint32_t)RDCMAX(line, (int64_t)0)};
+          seq.push_back(row);
+          break;
+        }
+        case DW_LNS_advance_pc: address += unit.ULEB() * minInstLength; break;
+        case DW_LNS_advance_line: line += unit.SLEB(); break;
+        case DW_LNS_set_file: file = unit.ULEB(); break;
+        case DW_LNS_const_add_pc:
+          address += ((255 - opcodeBase) / lineRange) * minInstLength;
+          break;
+        case DW_LNS_fixed_advance_pc: address += unit.Read<uint16_t>(); break;
+        default:
+          // everything else only affects state we don't track, skip its operands
+          for(uint8_t i = 0; i < opcodeLengths[op - 1]; i++)
+            unit.ULEB();
+          break;
+      }
+    }
+  }
+}
+
+void ElfIndexBuilder::EndSequence(std::vector<ElfSymbolIndex::LineRow> &seq, uint64_t endAddress,
+                                  uint64_t tombstone)
+{
+  // sequences for functions that the linker discarded are left at address 0 or a tombstone value,
+  // and would overlap real code
+  if(!seq.empty() && seq[0].address != 0 && seq[0].address < tombstone)
+  {
+    m_Index.m_Lines.insert(m_Index.m_Lines.end(), seq.begin(), seq.end());
+
+    ElfSymbolIndex::LineRow end = {endAddress, ~0U, 0};
+    m_Index.m_Lines.push_back(end);
+  }
+
+  seq.clear();
+}
+
+static bool SymbolLess(const ElfSymbolIndex::Symbol &a, const ElfSymbolIndex::Symbol &b)
+{
+  return a.address < b.address;
+}
+
+static bool LineRowLess(const ElfSymbolIndex::LineRow &a, const ElfSymbolIndex::LineRow &b)
+{
+  // at the same address, end markers sort first so that a sequence starting where another ends
+  // takes precedence
+  if(a.address != b.address)
+    return a.address < b.address;
+  return (a.line != 0) < (b.line != 0);
+}
+
+void ElfIndexBuilder::Finish()
+{
+  std::stable_sort(m_Index.m_Symbols.begin(), m_Index.m_Symbols.end(), SymbolLess);
+  std::stable_sort(m_Index.m_Lines.begin(), m_Index.m_Lines.end(), LineRowLess);
+
+  // trim any excess capacity since the index may be alive for the rest of the session
+  std::vector<ElfSymbolIndex::Symbol>(m_Index.m_Symbols).swap(m_Index.m_Symbols);
+  std::vector<ElfSymbolIndex::LineRow>(m_Index.m_Lines).swap(m_Index.m_Lines);
+  std::vector<char>(m_Index.m_Strings).swap(m_Index.m_Strings);
+}
+
+// looks for separate debug information in the places gdb does by default, verifying it belongs to
+// the same build when we know the build-id
+static bool OpenDebugFile(const char *path, ElfFile &elf, const std::string &buildID,
+                          ElfFile &debug)
+{
+  std::vector<std::string> candidates;
+
+  if(buildID.size() > 2)
+    candidates.push_back("/usr/lib/debug/.build-id/" + buildID.substr(0, 2) + "/" +
+                         buildID.substr(2) + ".debug");
+
+  std::string link = elf.DebugLink();
+  if(!link.empty())
+  {
+    std::string dir = dirname(std::string(path));
+
+    candidates.push_back(dir + "/" + link);
+    candidates.push_back(dir + "/.debug/" + link);
+    candidates.push_back("/usr/lib/debug" + dir + "/" + link);
+  }
+
+  for(size_t i = 0; i < candidates.size(); i++)
+  {
+    if(candidates[i] == path || !debug.Open(candidates[i].c_str()))
+      continue;
+
+    if(buildID.empty() || debug.BuildID() == buildID)
+      return true;
+
+    debug.Close();
+  }
+
+  return false;
+}
+
+ElfSymbolIndex *ElfSymbolIndex::Load(const char *path)
+{
+  ElfFile elf;
+
+  if(!elf.Open(path))
+    return NULL;
+
+  ElfSymbolIndex *index = new ElfSymbolIndex();
+  index->m_Segments = elf.segments;
+
+  std::string buildID = elf.BuildID();
+
+  if(!buildID.empty() && index->LoadCache(buildID))
+    return index;
+
+  ElfIndexBuilder builder(*index);
+
+  bool hasSymtab = builder.AddSymbols(elf, SHT_SYMTAB);
+  bool hasLines = builder.AddLines(elf);
+
+  // distro packages strip the full symbol table and line information into separate debug files
+  if(!hasSymtab || !hasLines)
+  {
+    ElfFile debug;
+    if(OpenDebugFile(path, elf, buildID, debug))
+    {
+      if(!hasSymtab)
+        hasSymtab = builder.AddSymbols(debug, SHT_SYMTAB);
+      if(!hasLines)
+        hasLines = builder.AddLines(debug);
+    }
+  }
+
+  // exported symbols are better than nothing
+  if(!hasSymtab)
+    builder.AddSymbols(elf, SHT_DYNSYM);
+
+  builder.Finish();
+
+  RDCDEBUG("Indexed %s: %llu symbols, %llu line rows", path, (uint64_t)index->m_Symbols.size(),
+           (uint64_t)index->m_Lines.size());
+
+  // modules without line information are cheap to index again, and may get debug files installed
+  // later
+  if(!buildID.empty() && hasLines)
+    index->SaveCache(buildID);
+
+  return index;
+}
+
+bool ElfSymbolIndex::LoadCache(const std::string &buildID)
+{
+  std::string filename = FileIO::GetAppFolderFilename("symbolcache/" + buildID + ".idx");
+
+  std::vector<unsigned char> data;
+  if(!FileIO::slurp(filename.c_str(), data))
+    return false;
+
+  SymbolCacheHeader header;
+  if(data.size() < sizeof(header))
+    return false;
+
+  memcpy(&header, &data[0], sizeof(header));
+
+  if(header.magic != SymbolCacheMagic || header.version != SymbolCacheVersion)
+    return false;
+
+  uint64_t size = data.size();
+
+  if(header.numSymbols > size || header.numLines > size || header.stringSize > size ||
+     header.stringSize == 0 ||
+     sizeof(header) + header.numSymbols * sizeof(Symbol) + header.numLines * sizeof(LineRow) +
+             header.stringSize !=
+         size)
+  {
+    RDCWARN("Symbol cache %s is corrupt, ignoring", filename.c_str());
+    return false;
+  }
+
+  const byte *cur = &data[0] + sizeof(header);
+
+  m_Symbols.resize((size_t)header.numSymbols);
+  if(!m_Symbols.empty())
+    memcpy(&m_Symbols[0], cur, m_Symbols.size() * sizeof(Symbol));
+  cur += m_Symbols.size() * sizeof(Symbol);
+
+  m_Lines.resize((size_t)header.numLines);
+  if(!m_Lines.empty())
+    memcpy(&m_Lines[0], cur, m_Lines.size() * sizeof(LineRow));
+  cur += m_Lines.size() * sizeof(LineRow);
+
+  m_Strings.assign((const char *)cur, (const char *)cur + header.stringSize);
+
+  // every string reference must land inside the string data, which must be terminated
+  bool valid = (m_Strings.back() == 0);
+
+  for(size_t i = 0; valid && i < m_Symbols.size(); i++)
+    valid = m_Symbols[i].name < m_Strings.size();
+
+  for(size_t i = 0; valid && i < m_Lines.size(); i++)
+    valid = m_Lines[i].file == ~0U || m_Lines[i].file < m_Strings.size();
+
+  if(!valid)
+  {
+    RDCWARN("Symbol cache %s is corrupt, ignoring", filename.c_str());
+    m_Symbols.clear();
+    m_Lines.clear();
+    m_Strings.clear();
+    return false;
+  }
+
+  return true;
+}
+
+void ElfSymbolIndex::SaveCache(const std::string &buildID) const
+{
+  std::string filename = FileIO::GetAppFolderFilename("symbolcache/" + buildID + ".idx");
+
+  FileIO::CreateParentDirectory(filename);
+
+  // write to a temporary file and rename it into place, so another process resolving the same
+  // library never loads a partially written cache
+  std::string tempname = StringFormat::Fmt("%s.%u.tmp", filename.c_str(), Process::GetCurrentPID());
+
+  FILE *f = FileIO::fopen(tempname.c_str(), "wb");
+
+  if(f == NULL)
+  {
+    RDCWARN("Couldn't write symbol cache %s", filename.c_str());
+    return;
+  }
+
+  SymbolCacheHeader header;
+  header.magic = SymbolCacheMagic;
+  header.version = SymbolCacheVersion;
+  header.numSymbols = m_Symbols.size();
+  header.numLines = m_Lines.size();
+  header.stringSize = m_Strings.size();
+
+  FileIO::fwrite(&header, 1, sizeof(header), f);
+  if(!m_Symbols.empty())
+    FileIO::fwrite(&m_Symbols[0], 1, m_Symbols.size() * sizeof(Symbol), f);
+  if(!m_Lines.empty())
+    FileIO::fwrite(&m_Lines[0], 1, m_Lines.size() * sizeof(LineRow), f);
+  if(!m_Strings.empty())
+    FileIO::fwrite(&m_Strings[0], 1, m_Strings.size(), f);
+
+  FileIO::fclose(f);
+
+  if(!FileIO::Move(tempname.c_str(), filename.c_str(), true))
+    FileIO::Delete(tempname.c_str());
+}
+
+bool ElfSymbolIndex::FileOffsetToAddress(uint64_t offset, uint64_t &address) const
+{
+  for(size_t i = 0; i < m_Segments.size(); i++)
+  {
+    const Segment &seg = m_Segments[i];
+    if(offset >= seg.offset && offset < seg.offset + seg.size)
+    {
+      address = offset - seg.offset + seg.address;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+static bool SymbolAddressLess(uint64_t address, const ElfSymbolIndex::Symbol &sym)
+{
+  return address < sym.address;
+}
+
+static bool LineAddressLess(uint64_t address, const ElfSymbolIndex::LineRow &row)
+{
+  return address < row.address;
+}
+
+void ElfSymbolIndex::Resolve(uint64_t address, Callstack::AddressDetails &details) const
+{
+  auto sym = std::upper_bound(m_Symbols.begin(), m_Symbols.end(), address, SymbolAddressLess);
+
+  // symbols can nest (e.g. local labels inside a function), so look back a little way for one
+  // that covers the address before falling back to the nearest unsized symbol
+  for(int i = 0; i < 16 && sym != m_Symbols.begin(); i++)
+  {
+    --sym;
+
+    if(address < sym->address + sym->size || (sym->size == 0 && i == 0))
+    {
+      const char *name = &m_Strings[sym->name];
+
+      int status = 0;
+      char *demangled = abi::__cxa_demangle(name, NULL, NULL, &status);
+
+      if(demangled && status == 0)
+        details.function = demangled;
+      else
+        details.function = name;
+
+      free(demangled);
+      break;
+    }
+  }
+
+  auto row = std::upper_bound(m_Lines.begin(), m_Lines.end(), address, LineAddressLess);
+
+  if(row != m_Lines.begin())
+  {
+    --row;
+
+    if(row->line != 0 && row->file != ~0U)
+    {
+      details.filename = &m_Strings[row->file];
+      details.line = row->line;
+    }
+  }
+}
@@ -0,0 +1,87 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016-2017 Baldur Karlsson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include "os/os_specific.h"
+
+// An address index for one ELF module, built from its symbol table and DWARF line table (or the
+// ones in its separate debug file) so that callstacks can be resolved without running addr2line.
+// Indices for modules with line information are cached on disk, keyed by the module's build-id.
+class ElfSymbolIndex
+{
+public:
+  // returns NULL if the file can't be opened or isn't an ELF for this platform
+  static ElfSymbolIndex *Load(const char *path);
+
+  // converts an offset into the module's file, as it was mapped into the process, into a virtual
+  // address in the module. Returns false if the offset isn't in any loaded segment.
+  bool FileOffsetToAddress(uint64_t offset, uint64_t &address) const;
+
+  // fills in whatever is known about address, leaving details untouched otherwise. Safe to call
+  // from several threads at once.
+  void Resolve(uint64_t address, Callstack::AddressDetails &details) const;
+
+  size_t NumSymbols() const { return m_Symbols.size(); }
+  size_t NumLines() const { return m_Lines.size(); }
+
+  struct Segment
+  {
+    uint64_t offset;
+    uint64_t address;
+    uint64_t size;
+  };
+
+  struct Symbol
+  {
+    uint64_t address;
+    uint32_t size;
+    uint32_t name;
+  };
+
+  // a row of the line table. Rows with line 0 mark the end of a sequence, and addresses past them
+  // up to the next row have no line information.
+  struct LineRow
+  {
+    uint64_t address;
+    uint32_t file;
+    uint32_t line;
+  };
+
+private:
+  ElfSymbolIndex() {}
+  bool LoadCache(const std::string &buildID);
+  void SaveCache(const std::string &buildID) const;
+
+  std::vector<Segment> m_Segments;
+  std::vector<Symbol> m_Symbols;
+  std::vector<LineRow> m_Lines;
+
+  // NULL-terminated symbol names (still mangled) and source file paths, indexed by offset
+  std::vector<char> m_Strings;
+
+  friend class ElfIndexBuilder;
+};
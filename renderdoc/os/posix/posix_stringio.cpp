@@ -31,6 +31,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <time.h>
@@ -246,6 +247,26 @@ void Copy(const char *from, const char *to, bool allowOverwrite)
   ::fclose(tf);
 }
 
+bool Move(const char *from, const char *to, bool allowOverwrite)
+{
+  if(from[0] == 0 || to[0] == 0)
+    return false;
+
+  if(!allowOverwrite && ::access(to, F_OK) == 0)
+  {
+    RDCERR("Destination file for non-overwriting move '%s' already exists", to);
+    return false;
+  }
+
+  if(::rename(from, to) != 0)
+  {
+    RDCERR("Can't move '%s' to '%s': %d", from, to, errno);
+    return false;
+  }
+
+  return true;
+}
+
 void Delete(const char *path)
 {
   unlink(path);
@@ -396,6 +417,60 @@ void logfile_close(void *handle)
     close(fd);
   }
 }
+
+struct MappedView
+{
+  void *base;
+  size_t length;
+};
+
+void *mapview_open(FILE *f, uint64_t offset, uint64_t length, byte *&data)
+{
+  data = NULL;
+
+  if(f == NULL || length == 0)
+    return NULL;
+
+  // mmap offsets must be page aligned, so map from the page containing offset
+  uint64_t pageSize = (uint64_t)sysconf(_SC_PAGESIZE);
+  uint64_t alignedOffset = offset - (offset % pageSize);
+  uint64_t mapLength = length + (offset - alignedOffset);
+
+  // can't map more than the address space on 32-bit
+  if(mapLength != (uint64_t)(size_t)mapLength)
+    return NULL;
+
+  void *base =
+      mmap(NULL, (size_t)mapLength, PROT_READ, MAP_PRIVATE, fileno(f), (off_t)alignedOffset);
+
+  if(base == MAP_FAILED)
+  {
+    RDCWARN("Couldn't map %llu bytes at %llu - errno %d", length, offset, errno);
+    return NULL;
+  }
+
+  // we'll be reading sequentially through the view in most cases
+  madvise(base, (size_t)mapLength, MADV_SEQUENTIAL);
+
+  MappedView *view = new MappedView;
+  view->base = base;
+  view->length = (size_t)mapLength;
+
+  data = (byte *)base + (offset - alignedOffset);
+
+  return view;
+}
+
+void mapview_close(void *handle)
+{
+  MappedView *view = (MappedView *)handle;
+
+  if(view)
+  {
+    munmap(view->base, view->length);
+    delete view;
+  }
+}
 };
 
 namespace StringFormat
@@ -245,4 +245,10 @@ void Sleep(uint32_t milliseconds)
 {
   usleep(milliseconds * 1000);
 }
+
+uint32_t NumberOfCores()
+{
+  long ret = sysconf(_SC_NPROCESSORS_ONLN);
+  return ret > 0 ? (uint32_t)ret : 1;
+}
 };
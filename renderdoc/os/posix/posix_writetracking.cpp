@@ -0,0 +1,347 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015-2017 Baldur Karlsson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+#include "common/threading.h"
+#include "os/os_specific.h"
+
+#if ENABLED(RDOC_LINUX)
+
+namespace
+{
+struct TrackedRegion
+{
+  // the range that was asked for
+  byte *base;
+  size_t size;
+
+  // the page-aligned range that is protected, and a flag per page that is set when it's written.
+  // The fault handler reads these without locking, so pageBase is set last when adding a region
+  // and cleared first when removing one.
+  byte *volatile pageBase;
+  size_t numPages;
+  volatile byte *written;
+};
+
+// a range that was recently made writable again by Untrack. A thread can fault on a tracked page
+// and only reach the handler after the region is gone, in which case the write should just retry.
+struct ReleasedRegion
+{
+  byte *volatile pageBase;
+  size_t size;
+  volatile uint64_t releaseTime;
+};
+}
+
+static const int MaxTrackedRegions = 1024;
+static TrackedRegion trackedRegions[MaxTrackedRegions] = {};
+static Threading::CriticalSection trackedRegionLock;
+
+// a fault delayed longer than this past the region being released isn't treated as one of ours
+static const uint64_t ReleasedRegionRetryNS = 1000000000ULL;
+
+static const int MaxReleasedRegions = 64;
+static ReleasedRegion releasedRegions[MaxReleasedRegions] = {};
+static int nextReleasedRegion = 0;
+
+static volatile int32_t activeFaultHandlers = 0;
+static size_t systemPageSize = 0;
+static bool faultHandlerInstalled = false;
+static struct sigaction prevSegvAction;
+
+// clock_gettime is async-signal-safe, so this can be used in the fault handler
+static uint64_t MonotonicNS()
+{
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return uint64_t(ts.tv_sec) * 1000000000ULL + uint64_t(ts.tv_nsec);
+}
+
+static bool WasRecentlyReleased(byte *addr)
+{
+  uint64_t now = MonotonicNS();
+
+  for(int i = 0; i < MaxReleasedRegions; i++)
+  {
+    byte *pageBase = releasedRegions[i].pageBase;
+
+    if(pageBase && addr >= pageBase && addr < pageBase + releasedRegions[i].size &&
+       now - releasedRegions[i].releaseTime < ReleasedRegionRetryNS)
+      return true;
+  }
+
+  return false;
+}
+
+static void WriteFaultHandler(int sig, siginfo_t *info, void *context)
+{
+  Atomic::Inc32(&activeFaultHandlers);
+
+  byte *addr = (byte *)info->si_addr;
+  bool handled = false;
+
+  if(info->si_code == SEGV_ACCERR)
+  {
+    for(int i = 0; i < MaxTrackedRegions; i++)
+    {
+      byte *pageBase = trackedRegions[i].pageBase;
+
+      if(pageBase && addr >= pageBase &&
+         addr < pageBase + trackedRegions[i].numPages * systemPageSize)
+      {
+        size_t page = size_t(addr - pageBase) / systemPageSize;
+        trackedRegions[i].written[page] = 1;
+        mprotect(pageBase + page * systemPageSize, systemPageSize, PROT_READ | PROT_WRITE);
+        handled = true;
+        break;
+      }
+    }
+
+    // the page is already writable again, so returning retries the write
+    if(!handled)
+      handled = WasRecentlyReleased(addr);
+  }
+
+  Atomic::Dec32(&activeFaultHandlers);
+
+  if(handled)
+    return;
+
+  // not a write to tracked memory, pass it on to whoever was handling faults before us
+  if(prevSegvAction.sa_flags & SA_SIGINFO)
+  {
+    prevSegvAction.sa_sigaction(sig, info, context);
+  }
+  else if(prevSegvAction.sa_handler != SIG_DFL && prevSegvAction.sa_handler != SIG_IGN)
+  {
+    prevSegvAction.sa_handler(sig);
+  }
+  else
+  {
+    // restore the default action, so that returning re-runs the faulting instruction and it
+    // crashes as it would have without us
+    signal(sig, SIG_DFL);
+  }
+}
+
+static TrackedRegion *FindTrackedRegion(void *base)
+{
+  for(int i = 0; i < MaxTrackedRegions; i++)
+    if(trackedRegions[i].pageBase && trackedRegions[i].base == base)
+      return &trackedRegions[i];
+
+  return NULL;
+}
+
+bool WriteTracking::Enabled()
+{
+  static int enabled = -1;
+
+  if(enabled < 0)
+    enabled = getenv("RENDERDOC_WRITE_TRACKING") != NULL ? 1 : 0;
+
+  return enabled == 1;
+}
+
+bool WriteTracking::Track(void *base, size_t size)
+{
+  if(!Enabled() || base == NULL || size == 0)
+    return false;
+
+  SCOPED_LOCK(trackedRegionLock);
+
+  if(!faultHandlerInstalled)
+  {
+    systemPageSize = (size_t)sysconf(_SC_PAGESIZE);
+
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_sigaction = &WriteFaultHandler;
+    action.sa_flags = SA_SIGINFO | SA_RESTART;
+    sigemptyset(&action.sa_mask);
+
+    if(sigaction(SIGSEGV, &action, &prevSegvAction) != 0)
+    {
+      RDCERR("Couldn't install fault handler for write tracking");
+      return false;
+    }
+
+    faultHandlerInstalled = true;
+  }
+
+  if(FindTrackedRegion(base))
+    return true;
+
+  TrackedRegion *region = NULL;
+  for(int i = 0; i < MaxTrackedRegions; i++)
+  {
+    if(trackedRegions[i].pageBase == NULL)
+    {
+      region = &trackedRegions[i];
+      break;
+    }
+  }
+
+  if(region == NULL)
+  {
+    RDCWARN("Too many regions being write-tracked");
+    return false;
+  }
+
+  uintptr_t start = uintptr_t(base) & ~uintptr_t(systemPageSize - 1);
+  uintptr_t end = AlignUp(uintptr_t(base) + size, uintptr_t(systemPageSize));
+
+  region->base = (byte *)base;
+  region->size = size;
+  region->numPages = (end - start) / systemPageSize;
+
+  byte *written = new byte[region->numPages];
+  memset(written, 0, region->numPages);
+  region->written = written;
+
+  __sync_synchronize();
+
+  // the region must be visible to the handler before any page is protected
+  region->pageBase = (byte *)start;
+
+  __sync_synchronize();
+
+  if(mprotect((void *)start, end - start, PROT_READ) != 0)
+  {
+    RDCWARN("Couldn't write-protect %p for write tracking", base);
+    Untrack(base);
+    return false;
+  }
+
+  return true;
+}
+
+void WriteTracking::Untrack(void *base)
+{
+  SCOPED_LOCK(trackedRegionLock);
+
+  TrackedRegion *region = FindTrackedRegion(base);
+
+  if(region == NULL)
+    return;
+
+  byte *pageBase = region->pageBase;
+
+  mprotect(pageBase, region->numPages * systemPageSize, PROT_READ | PROT_WRITE);
+
+  // remember the range before it stops being found as tracked, so a fault that's still on its way
+  // to the handler isn't passed on
+  ReleasedRegion &released = releasedRegions[nextReleasedRegion];
+  nextReleasedRegion = (nextReleasedRegion + 1) % MaxReleasedRegions;
+
+  released.pageBase = NULL;
+  __sync_synchronize();
+  released.size = region->numPages * systemPageSize;
+  released.releaseTime = MonotonicNS();
+  __sync_synchronize();
+  released.pageBase = pageBase;
+
+  region->pageBase = NULL;
+
+  __sync_synchronize();
+
+  // a handler on another thread could still be looking at the region
+  while(Atomic::CmpExch32(&activeFaultHandlers, 0, 0) != 0)
+    Threading::Sleep(0);
+
+  delete[] region->written;
+  memset(region, 0, sizeof(TrackedRegion));
+}
+
+void WriteTracking::GetWrittenRanges(void *base, vector<DiffRange> &ranges)
+{
+  ranges.clear();
+
+  SCOPED_LOCK(trackedRegionLock);
+
+  TrackedRegion *region = FindTrackedRegion(base);
+
+  if(region == NULL)
+    return;
+
+  byte *pageBase = region->pageBase;
+  byte *regionEnd = region->base + region->size;
+
+  for(size_t p = 0; p < region->numPages;)
+  {
+    if(!region->written[p])
+    {
+      p++;
+      continue;
+    }
+
+    size_t first = p;
+
+    // clear the flags before protecting again. A write in between won't be flagged, but it will
+    // be seen by the caller reading the memory after we return
+    while(p < region->numPages && region->written[p])
+      region->written[p++] = 0;
+
+    byte *start = pageBase + first * systemPageSize;
+    byte *end = pageBase + p * systemPageSize;
+
+    mprotect(start, end - start, PROT_READ);
+
+    DiffRange range;
+    range.start = size_t(RDCMAX(start, region->base) - region->base);
+    range.end = size_t(RDCMIN(end, regionEnd) - region->base);
+
+    if(range.end > range.start)
+      ranges.push_back(range);
+  }
+}
+
+#else
+
+bool WriteTracking::Enabled()
+{
+  return false;
+}
+
+bool WriteTracking::Track(void *base, size_t size)
+{
+  return false;
+}
+
+void WriteTracking::Untrack(void *base)
+{
+}
+
+void WriteTracking::GetWrittenRanges(void *base, vector<DiffRange> &ranges)
+{
+  ranges.clear();
+}
+
+#endif
@@ -1093,3 +1093,24 @@ uint32_t Process::GetCurrentPID()
 {
   return (uint32_t)GetCurrentProcessId();
 }
+
+// write tracking isn't implemented on windows, GetWriteWatch only works on memory we allocate
+// ourselves and not on mapped memory returned from drivers.
+bool WriteTracking::Enabled()
+{
+  return false;
+}
+
+bool WriteTracking::Track(void *base, size_t size)
+{
+  return false;
+}
+
+void WriteTracking::Untrack(void *base)
+{
+}
+
+void WriteTracking::GetWrittenRanges(void *base, vector<DiffRange> &ranges)
+{
+  ranges.clear();
+}
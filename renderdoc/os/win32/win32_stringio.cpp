@@ -23,6 +23,7 @@
  * THE SOFTWARE.
  ******************************************************************************/
 
+#include <io.h>
 #include <shlobj.h>
 #include <stdio.h>
 #include <string.h>
@@ -341,6 +342,20 @@ void Copy(const char *from, const char *to, bool allowOverwrite)
   ::CopyFileW(wfrom.c_str(), wto.c_str(), allowOverwrite == false);
 }
 
+bool Move(const char *from, const char *to, bool allowOverwrite)
+{
+  wstring wfrom = StringFormat::UTF82Wide(string(from));
+  wstring wto = StringFormat::UTF82Wide(string(to));
+
+  if(!::MoveFileExW(wfrom.c_str(), wto.c_str(), allowOverwrite ? MOVEFILE_REPLACE_EXISTING : 0))
+  {
+    RDCERR("Can't move '%s' to '%s': %d", from, to, GetLastError());
+    return false;
+  }
+
+  return true;
+}
+
 void Delete(const char *path)
 {
   wstring wpath = StringFormat::UTF82Wide(string(path));
@@ -534,6 +549,75 @@ void logfile_close(void *handle)
 {
   CloseHandle((HANDLE)handle);
 }
+
+struct MappedView
+{
+  HANDLE mapping;
+  void *base;
+};
+
+void *mapview_open(FILE *f, uint64_t offset, uint64_t length, byte *&data)
+{
+  data = NULL;
+
+  if(f == NULL || length == 0)
+    return NULL;
+
+  HANDLE file = (HANDLE)_get_osfhandle(_fileno(f));
+
+  if(file == INVALID_HANDLE_VALUE)
+    return NULL;
+
+  // view offsets must be aligned to the allocation granularity
+  SYSTEM_INFO sysInfo = {};
+  GetSystemInfo(&sysInfo);
+
+  uint64_t granularity = sysInfo.dwAllocationGranularity;
+  uint64_t alignedOffset = offset - (offset % granularity);
+  uint64_t mapLength = length + (offset - alignedOffset);
+
+  // can't map more than the address space on 32-bit
+  if(mapLength != (uint64_t)(SIZE_T)mapLength)
+    return NULL;
+
+  HANDLE mapping = CreateFileMappingW(file, NULL, PAGE_READONLY, 0, 0, NULL);
+
+  if(mapping == NULL)
+  {
+    RDCWARN("Couldn't create file mapping - error %u", GetLastError());
+    return NULL;
+  }
+
+  void *base = MapViewOfFile(mapping, FILE_MAP_READ, DWORD(alignedOffset >> 32),
+                             DWORD(alignedOffset & 0xffffffff), (SIZE_T)mapLength);
+
+  if(base == NULL)
+  {
+    RDCWARN("Couldn't map %llu bytes at %llu - error %u", length, offset, GetLastError());
+    CloseHandle(mapping);
+    return NULL;
+  }
+
+  MappedView *view = new MappedView;
+  view->mapping = mapping;
+  view->base = base;
+
+  data = (byte *)base + (offset - alignedOffset);
+
+  return view;
+}
+
+void mapview_close(void *handle)
+{
+  MappedView *view = (MappedView *)handle;
+
+  if(view)
+  {
+    UnmapViewOfFile(view->base);
+    CloseHandle(view->mapping);
+    delete view;
+  }
+}
 };
 
 namespace StringFormat
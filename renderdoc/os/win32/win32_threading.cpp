@@ -253,4 +253,11 @@ void Sleep(uint32_t milliseconds)
 {
   ::Sleep((DWORD)milliseconds);
 }
+
+uint32_t NumberOfCores()
+{
+  SYSTEM_INFO sysInfo = {};
+  GetSystemInfo(&sysInfo);
+  return RDCMAX(1U, (uint32_t)sysInfo.dwNumberOfProcessors);
+}
 };
@@ -53,6 +53,7 @@ public:
   rdctype::pair<ReplayStatus, IReplayController *> OpenCapture(float *progress);
 
   rdctype::array<byte> GetThumbnail(FileType type, uint32_t maxsize);
+  ReplayStatus Convert(const char *filename, CaptureCompression compression, int level);
 
 private:
   std::string m_Filename, m_DriverName, m_Ident;
@@ -243,6 +244,26 @@ rdctype::array<byte> CaptureFile::GetThumbnail(FileType type, uint32_t maxsize)
   return buf;
 }
 
+ReplayStatus CaptureFile::Convert(const char *filename, CaptureCompression compression, int level)
+{
+  if(m_Status != ReplayStatus::Succeeded)
+    return m_Status;
+
+  Serialiser ser(Filename(), Serialiser::READING, false);
+
+  if(ser.HasError())
+    return ReplayStatus::FileCorrupted;
+
+  Serialiser::SectionFlags codec = compression == CaptureCompression::Zstd
+                                       ? Serialiser::eSectionFlag_ZstdCompressed
+                                       : Serialiser::eSectionFlag_LZ4Blocks;
+
+  if(!ser.WriteRecompressed(filename, codec, level))
+    return ReplayStatus::FileIOFailed;
+
+  return ReplayStatus::Succeeded;
+}
+
 extern "C" RENDERDOC_API ICaptureFile *RENDERDOC_CC RENDERDOC_OpenCaptureFile(const char *logfile)
 {
   return new CaptureFile(logfile);
@@ -29,6 +29,7 @@
 #include "common/common.h"
 #include "core/core.h"
 #include "maths/camera.h"
+#include "maths/format_decode.h"
 #include "maths/formatpacking.h"
 #include "replay/type_helpers.h"
 #include "serialise/string_utils.h"
@@ -165,6 +166,20 @@ extern "C" RENDERDOC_API uint16_t RENDERDOC_CC Maths_FloatToHalf(float f)
   return ConvertToHalf(f);
 }
 
+extern "C" RENDERDOC_API bool32 RENDERDOC_CC Maths_DecodeFormattedData(const ResourceFormat *fmt,
+                                                                      const void *data,
+                                                                      uint32_t count,
+                                                                      uint32_t stride,
+                                                                      FloatVector *output)
+{
+  FormatDecoder decoder;
+  if(!decoder.Init(*fmt))
+    return false;
+
+  decoder.Decode((const byte *)data, count, stride, &output[0].x);
+  return true;
+}
+
 extern "C" RENDERDOC_API Camera *RENDERDOC_CC Camera_InitArcball()
 {
   return new Camera(Camera::eType_Arcball);
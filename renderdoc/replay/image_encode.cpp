@@ -0,0 +1,480 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2017 Baldur Karlsson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+#include "image_encode.h"
+#include <stdlib.h>
+#include <string.h>
+#include "common/common.h"
+#include "os/os_specific.h"
+#include "tinyexr/tinyexr.h"
+
+// tinyexr's implementation includes miniz with C linkage, so use the deflate functions from there
+// rather than compiling in a second copy with the same names. Only the declarations are needed.
+#define MINIZ_HEADER_FILE_ONLY
+#define MINIZ_NO_ARCHIVE_APIS
+#define MINIZ_NO_ZLIB_APIS
+#include "miniz/miniz.c"
+
+// every band restarts the deflate dictionary and EXR's blocks are 16 rows, so don't split images
+// finer than this
+static const uint32_t minRowsPerBand = 64;
+static const uint32_t exrRowsPerBlock = 16;
+
+static uint32_t NumBands(uint32_t height, uint32_t numThreads)
+{
+  return RDCCLAMP(height / minRowsPerBand, 1U, RDCMAX(numThreads, 1U));
+}
+
+// runs func(band) for each band, with the first on this thread
+template <typename Band>
+static void RunBands(std::vector<Band> &bands, void (*func)(void *))
+{
+  std::vector<Threading::ThreadHandle> threads(bands.size());
+
+  for(size_t i = 1; i < bands.size(); i++)
+    threads[i] = Threading::CreateThread(func, &bands[i]);
+
+  func(&bands[0]);
+
+  for(size_t i = 1; i < bands.size(); i++)
+  {
+    Threading::JoinThread(threads[i]);
+    Threading::CloseThread(threads[i]);
+  }
+}
+
+static void WriteBE32(std::vector<byte> &out, uint32_t val)
+{
+  out.push_back(byte(val >> 24));
+  out.push_back(byte(val >> 16));
+  out.push_back(byte(val >> 8));
+  out.push_back(byte(val));
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////
+// PNG
+
+struct PNGBand
+{
+  const byte *data;
+  uint32_t width, numComps, rowPitch;
+  uint32_t rowBegin, rowEnd;
+  bool last;
+
+  uint32_t adler;
+  size_t filteredSize;
+  std::vector<byte> compressed;
+  bool success;
+};
+
+static int PaethPredictor(int a, int b, int c)
+{
+  int p = a + b - c;
+  int pa = abs(p - a);
+  int pb = abs(p - b);
+  int pc = abs(p - c);
+  if(pa <= pb && pa <= pc)
+    return a;
+  if(pb <= pc)
+    return b;
+  return c;
+}
+
+// filters a row with each of the five PNG filters and keeps the one with the smallest sum of
+// absolute (signed) values, the usual heuristic. prev is NULL for the first row of the image.
+static void FilterRow(const byte *row, const byte *prev, uint32_t rowBytes, uint32_t bpp,
+                      byte *dst, byte *scratch)
+{
+  uint32_t bestSum = ~0U;
+
+  for(int filter = 0; filter < 5; filter++)
+  {
+    byte *filtered = (filter == 0) ? dst + 1 : scratch;
+    uint32_t sum = 0;
+
+    for(uint32_t i = 0; i < rowBytes; i++)
+    {
+      int a = i >= bpp ? row[i - bpp] : 0;
+      int b = prev ? prev[i] : 0;
+      int c = prev && i >= bpp ? prev[i - bpp] : 0;
+
+      int pred = 0;
+      switch(filter)
+      {
+        case 0: pred = 0; break;
+        case 1: pred = a; break;
+        case 2: pred = b; break;
+        case 3: pred = (a + b) >> 1; break;
+        case 4: pred = PaethPredictor(a, b, c); break;
+      }
+
+      byte val = byte(row[i] - pred);
+      filtered[i] = val;
+      sum += abs((int)(signed char)val);
+    }
+
+    if(sum < bestSum)
+    {
+      bestSum = sum;
+      dst[0] = byte(filter);
+      if(filtered != dst + 1)
+        memcpy(dst + 1, filtered, rowBytes);
+    }
+  }
+}
+
+static mz_bool PNGBandPut(const void *buf, int len, void *user)
+{
+  std::vector<byte> &out = *(std::vector<byte> *)user;
+  out.insert(out.end(), (const byte *)buf, (const byte *)buf + len);
+  return MZ_TRUE;
+}
+
+static void PNGBandThread(void *b)
+{
+  PNGBand &band = *(PNGBand *)b;
+
+  uint32_t rowBytes = band.width * band.numComps;
+
+  // filter type byte + row
+  std::vector<byte> filtered((rowBytes + 1) * (band.rowEnd - band.rowBegin));
+  std::vector<byte> scratch(rowBytes);
+
+  for(uint32_t y = band.rowBegin; y < band.rowEnd; y++)
+  {
+    const byte *row = band.data + size_t(y) * band.rowPitch;
+    const byte *prev = y > 0 ? row - band.rowPitch : NULL;
+
+    FilterRow(row, prev, rowBytes, band.numComps,
+              &filtered[size_t(y - band.rowBegin) * (rowBytes + 1)], &scratch[0]);
+  }
+
+  band.filteredSize = filtered.size();
+  band.adler = (uint32_t)mz_adler32(MZ_ADLER32_INIT, &filtered[0], filtered.size());
+
+  band.compressed.reserve(filtered.size() / 2);
+
+  // raw deflate, the zlib header and checksum for the whole image are written when stitching
+  tdefl_compressor *comp = new tdefl_compressor;
+  int flags = TDEFL_DEFAULT_MAX_PROBES;
+
+  // a sync flush ends the band on a byte boundary with the stream still open, so the next band's
+  // output can be appended directly
+  band.success = tdefl_init(comp, &PNGBandPut, &band.compressed, flags) == TDEFL_STATUS_OKAY;
+  if(band.success)
+  {
+    tdefl_status status = tdefl_compress_buffer(comp, &filtered[0], filtered.size(),
+                                                band.last ? TDEFL_FINISH : TDEFL_SYNC_FLUSH);
+    band.success = status == (band.last ? TDEFL_STATUS_DONE : TDEFL_STATUS_OKAY);
+  }
+
+  delete comp;
+}
+
+// equivalent to the adler32 of the data for a followed by the data for b, given b's length
+static uint32_t CombineAdler32(uint32_t a, uint32_t b, size_t lenB)
+{
+  const uint32_t base = 65521;
+
+  uint32_t rem = uint32_t(lenB % base);
+  uint32_t sum1 = a & 0xffff;
+  uint32_t sum2 = uint32_t((uint64_t(rem) * sum1) % base);
+  sum1 += (b & 0xffff) + base - 1;
+  sum2 += (a >> 16) + (b >> 16) + base - rem;
+  if(sum1 >= base)
+    sum1 -= base;
+  if(sum1 >= base)
+    sum1 -= base;
+  if(sum2 >= (base << 1))
+    sum2 -= (base << 1);
+  if(sum2 >= base)
+    sum2 -= base;
+  return sum1 | (sum2 << 16);
+}
+
+static void WritePNGChunk(std::vector<byte> &out, const char *type, const byte *data, size_t len)
+{
+  WriteBE32(out, (uint32_t)len);
+
+  size_t start = out.size();
+  out.insert(out.end(), type, type + 4);
+  if(len > 0)
+    out.insert(out.end(), data, data + len);
+
+  WriteBE32(out, (uint32_t)mz_crc32(MZ_CRC32_INIT, &out[start], len + 4));
+}
+
+bool EncodePNG(const byte *data, uint32_t width, uint32_t height, uint32_t numComps,
+               uint32_t rowPitch, uint32_t numThreads, std::vector<byte> &out)
+{
+  if(width == 0 || height == 0 || numComps < 1 || numComps > 4)
+    return false;
+
+  std::vector<PNGBand> bands(NumBands(height, numThreads));
+
+  for(size_t i = 0; i < bands.size(); i++)
+  {
+    PNGBand &band = bands[i];
+    band.data = data;
+    band.width = width;
+    band.numComps = numComps;
+    band.rowPitch = rowPitch;
+    band.rowBegin = uint32_t(uint64_t(height) * i / bands.size());
+    band.rowEnd = uint32_t(uint64_t(height) * (i + 1) / bands.size());
+    band.last = (i + 1 == bands.size());
+    band.adler = MZ_ADLER32_INIT;
+    band.filteredSize = 0;
+    band.success = false;
+  }
+
+  RunBands(bands, &PNGBandThread);
+
+  std::vector<byte> idat;
+  uint32_t adler = MZ_ADLER32_INIT;
+
+  // zlib header for 32K window deflate at the default level
+  idat.push_back(0x78);
+  idat.push_back(0x9c);
+
+  for(size_t i = 0; i < bands.size(); i++)
+  {
+    if(!bands[i].success)
+    {
+      RDCERR("Failed to compress PNG rows %u-%u", bands[i].rowBegin, bands[i].rowEnd);
+      return false;
+    }
+
+    idat.insert(idat.end(), bands[i].compressed.begin(), bands[i].compressed.end());
+    adler = (i == 0) ? bands[i].adler
+                     : CombineAdler32(adler, bands[i].adler, bands[i].filteredSize);
+  }
+
+  WriteBE32(idat, adler);
+
+  static const byte signature[] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+  static const byte colourTypes[] = {0, 0, 4, 2, 6};
+
+  std::vector<byte> ihdr;
+  WriteBE32(ihdr, width);
+  WriteBE32(ihdr, height);
+  ihdr.push_back(8);    // bit depth
+  ihdr.push_back(colourTypes[numComps]);
+  ihdr.push_back(0);    // compression
+  ihdr.push_back(0);    // filter
+  ihdr.push_back(0);    // interlace
+
+  out.clear();
+  out.reserve(sizeof(signature) + idat.size() + 64);
+  out.insert(out.end(), signature, signature + sizeof(signature));
+  WritePNGChunk(out, "IHDR", &ihdr[0], ihdr.size());
+  WritePNGChunk(out, "IDAT", &idat[0], idat.size());
+  WritePNGChunk(out, "IEND", NULL, 0);
+
+  return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////
+// EXR
+
+struct EXRBand
+{
+  float *abgr[4];
+  uint32_t width;
+  uint32_t rowBegin, rowEnd;
+
+  unsigned char *mem;
+  size_t size;
+  const char *err;
+};
+
+static void EXRBandThread(void *b)
+{
+  EXRBand &band = *(EXRBand *)b;
+
+  EXRImage exrImage;
+  InitEXRImage(&exrImage);
+
+  int pixTypes[4] = {TINYEXR_PIXELTYPE_FLOAT, TINYEXR_PIXELTYPE_FLOAT, TINYEXR_PIXELTYPE_FLOAT,
+                     TINYEXR_PIXELTYPE_FLOAT};
+  int reqTypes[4] = {TINYEXR_PIXELTYPE_HALF, TINYEXR_PIXELTYPE_HALF, TINYEXR_PIXELTYPE_HALF,
+                     TINYEXR_PIXELTYPE_HALF};
+
+  // must be in this order as many viewers don't pay attention to channels and just assume
+  // they are in this order
+  const char *bgraNames[4] = {"A", "B", "G", "R"};
+
+  float *images[4];
+  for(int c = 0; c < 4; c++)
+    images[c] = band.abgr[c] + size_t(band.rowBegin) * band.width;
+
+  exrImage.num_channels = 4;
+  exrImage.channel_names = bgraNames;
+  exrImage.images = (unsigned char **)images;
+  exrImage.width = band.width;
+  exrImage.height = band.rowEnd - band.rowBegin;
+  exrImage.pixel_types = pixTypes;
+  exrImage.requested_pixel_types = reqTypes;
+
+  band.mem = NULL;
+  band.err = NULL;
+  band.size = SaveMultiChannelEXRToMemory(&exrImage, &band.mem, &band.err);
+}
+
+// walks the attribute list at the start of an EXR file, returning the size of the header and the
+// offset of the maximum y in the data and display windows, which are all that differ between bands
+static size_t ParseEXRHeader(const byte *mem, size_t size, std::vector<size_t> &windowYMax)
+{
+  // magic and version
+  size_t offs = 8;
+
+  while(offs < size)
+  {
+    const char *name = (const char *)mem + offs;
+    size_t nameLen = strnlen(name, size - offs);
+
+    // an empty name terminates the header
+    if(nameLen == 0)
+      return offs + 1;
+
+    offs += nameLen + 1;
+    if(offs >= size)
+      break;
+
+    const char *type = (const char *)mem + offs;
+    offs += strnlen(type, size - offs) + 1;
+    if(offs + sizeof(int32_t) > size)
+      break;
+
+    int32_t attrSize = 0;
+    memcpy(&attrSize, mem + offs, sizeof(attrSize));
+    offs += sizeof(attrSize);
+
+    if(attrSize < 0 || offs + attrSize > size)
+      break;
+
+    if(!strcmp(type, "box2i") && (!strcmp(name, "dataWindow") || !strcmp(name, "displayWindow")))
+      windowYMax.push_back(offs + 3 * sizeof(int32_t));
+
+    offs += attrSize;
+  }
+
+  return 0;
+}
+
+bool EncodeEXR(float *const abgr[4], uint32_t width, uint32_t height, uint32_t numThreads,
+               std::vector<byte> &out)
+{
+  if(width == 0 || height == 0)
+    return false;
+
+  // bands must be whole blocks, so that the blocks are the same as when encoding in one go
+  uint32_t numBlocks = (height + exrRowsPerBlock - 1) / exrRowsPerBlock;
+  std::vector<EXRBand> bands(NumBands(height, numThreads));
+
+  for(size_t i = 0; i < bands.size(); i++)
+  {
+    EXRBand &band = bands[i];
+    memcpy(band.abgr, abgr, sizeof(band.abgr));
+    band.width = width;
+    band.rowBegin = uint32_t(uint64_t(numBlocks) * i / bands.size()) * exrRowsPerBlock;
+    band.rowEnd = RDCMIN(height, uint32_t(uint64_t(numBlocks) * (i + 1) / bands.size()) *
+                                     exrRowsPerBlock);
+  }
+
+  RunBands(bands, &EXRBandThread);
+
+  bool success = true;
+  size_t headerSize = 0;
+  std::vector<size_t> windowYMax;
+
+  for(size_t i = 0; i < bands.size(); i++)
+  {
+    if(bands[i].size == 0)
+    {
+      RDCERR("Error saving EXR file: '%s'", bands[i].err ? bands[i].err : "");
+      success = false;
+    }
+  }
+
+  if(success)
+  {
+    headerSize = ParseEXRHeader(bands[0].mem, bands[0].size, windowYMax);
+
+    if(headerSize == 0 || windowYMax.size() != 2)
+    {
+      RDCERR("Unexpected EXR header layout");
+      success = false;
+    }
+  }
+
+  if(success)
+  {
+    // the header only differs in the window heights, so take the first band's and patch them
+    out.clear();
+    out.insert(out.end(), bands[0].mem, bands[0].mem + headerSize);
+
+    for(size_t i = 0; i < windowYMax.size(); i++)
+    {
+      int32_t ymax = int32_t(height) - 1;
+      memcpy(&out[windowYMax[i]], &ymax, sizeof(ymax));
+    }
+
+    size_t tableOffs = out.size();
+    out.resize(tableOffs + numBlocks * sizeof(uint64_t));
+
+    uint32_t block = 0;
+
+    for(size_t i = 0; i < bands.size(); i++)
+    {
+      const EXRBand &band = bands[i];
+      uint32_t bandBlocks = (band.rowEnd - band.rowBegin + exrRowsPerBlock - 1) / exrRowsPerBlock;
+
+      // each band's blocks follow its own header and offset table
+      size_t bandData = headerSize + bandBlocks * sizeof(uint64_t);
+      size_t dataOffs = out.size();
+
+      out.insert(out.end(), band.mem + bandData, band.mem + band.size);
+
+      for(uint32_t b = 0; b < bandBlocks; b++, block++)
+      {
+        uint64_t blockOffs = 0;
+        memcpy(&blockOffs, band.mem + headerSize + b * sizeof(uint64_t), sizeof(blockOffs));
+
+        blockOffs = blockOffs - bandData + dataOffs;
+        memcpy(&out[tableOffs + block * sizeof(uint64_t)], &blockOffs, sizeof(blockOffs));
+
+        // blocks start with their first row, which is relative to the band
+        int32_t y = 0;
+        memcpy(&y, &out[blockOffs], sizeof(y));
+        y += int32_t(band.rowBegin);
+        memcpy(&out[blockOffs], &y, sizeof(y));
+      }
+    }
+  }
+
+  for(size_t i = 0; i < bands.size(); i++)
+    free(bands[i].mem);
+
+  return success;
+}
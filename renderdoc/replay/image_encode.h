@@ -0,0 +1,44 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2017 Baldur Karlsson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+#pragma once
+
+#include <vector>
+#include "api/replay/renderdoc_replay.h"
+
+// Encoders for the compressed file formats textures can be saved to. Compression is the slow part
+// of saving a large texture, so the image is split into horizontal bands of rows that are
+// compressed on up to numThreads threads and then stitched together into one ordinary file.
+
+// Encodes 8-bit data with numComps (1 to 4) channels as a PNG. Rows start rowPitch bytes apart.
+// Each band is deflated separately and ends on a sync flush, so the bands join up into the single
+// zlib stream that PNG requires.
+bool EncodePNG(const byte *data, uint32_t width, uint32_t height, uint32_t numComps,
+               uint32_t rowPitch, uint32_t numThreads, std::vector<byte> &out);
+
+// Encodes four float planes in A, B, G, R order as a ZIP compressed EXR with half float channels.
+// EXR stores independently compressed blocks of 16 rows, so bands are encoded as separate images
+// and their blocks merged under one header. The result is identical to encoding in one go.
+bool EncodeEXR(float *const abgr[4], uint32_t width, uint32_t height, uint32_t numThreads,
+               std::vector<byte> &out);
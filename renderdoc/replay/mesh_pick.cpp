@@ -0,0 +1,753 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2017 Baldur Karlsson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+#include "mesh_pick.h"
+#include <float.h>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include "common/timing.h"
+#include "maths/camera.h"
+
+// primitives per leaf before a node is split
+static const uint32_t maxLeafPrims = 4;
+
+// how far from the cursor, in pixels, a point can be and still be picked
+static const float pointPickRadius = 35.0f;
+
+// memory the cached meshes for one event can use before the least recently used are dropped
+static const uint64_t cacheBudgetBytes = 256 * 1024 * 1024;
+
+static bool IsFinite(const Vec3f &v)
+{
+  return std::isfinite(v.x) && std::isfinite(v.y) && std::isfinite(v.z);
+}
+
+static Vec3f MinVec(const Vec3f &a, const Vec3f &b)
+{
+  return Vec3f(RDCMIN(a.x, b.x), RDCMIN(a.y, b.y), RDCMIN(a.z, b.z));
+}
+
+static Vec3f MaxVec(const Vec3f &a, const Vec3f &b)
+{
+  return Vec3f(RDCMAX(a.x, b.x), RDCMAX(a.y, b.y), RDCMAX(a.z, b.z));
+}
+
+static float Component(const Vec3f &v, int axis)
+{
+  return axis == 0 ? v.x : (axis == 1 ? v.y : v.z);
+}
+
+// transform to clip space, keeping w rather than dividing through by it like Matrix4f::Transform
+static Vec4f TransformToClip(const Matrix4f &m, const Vec3f &v)
+{
+  const float *f = m.Data();
+  return Vec4f(f[0] * v.x + f[4] * v.y + f[8] * v.z + f[12],
+               f[1] * v.x + f[5] * v.y + f[9] * v.z + f[13],
+               f[2] * v.x + f[6] * v.y + f[10] * v.z + f[14],
+               f[3] * v.x + f[7] * v.y + f[11] * v.z + f[15]);
+}
+
+static bool IsTriangleTopology(Topology topo)
+{
+  return topo == Topology::TriangleList || topo == Topology::TriangleStrip ||
+         topo == Topology::TriangleFan || topo == Topology::TriangleList_Adj ||
+         topo == Topology::TriangleStrip_Adj;
+}
+
+static uint32_t NumTriangles(Topology topo, uint32_t numVerts)
+{
+  switch(topo)
+  {
+    case Topology::TriangleList: return numVerts / 3;
+    case Topology::TriangleStrip:
+    case Topology::TriangleFan: return numVerts >= 3 ? numVerts - 2 : 0;
+    case Topology::TriangleList_Adj: return numVerts / 6;
+    case Topology::TriangleStrip_Adj: return numVerts >= 6 ? (numVerts - 4) / 2 : 0;
+    default: break;
+  }
+
+  return 0;
+}
+
+// the three mesh vertices making up a triangle, ignoring adjacency vertices
+static void GetTriangle(Topology topo, uint32_t prim, uint32_t verts[3])
+{
+  switch(topo)
+  {
+    case Topology::TriangleList:
+      verts[0] = prim * 3;
+      verts[1] = prim * 3 + 1;
+      verts[2] = prim * 3 + 2;
+      break;
+    case Topology::TriangleStrip:
+      verts[0] = prim;
+      verts[1] = prim + 1;
+      verts[2] = prim + 2;
+      break;
+    case Topology::TriangleFan:
+      verts[0] = 0;
+      verts[1] = prim + 1;
+      verts[2] = prim + 2;
+      break;
+    case Topology::TriangleList_Adj:
+      verts[0] = prim * 6;
+      verts[1] = prim * 6 + 2;
+      verts[2] = prim * 6 + 4;
+      break;
+    case Topology::TriangleStrip_Adj:
+      verts[0] = prim * 2;
+      verts[1] = prim * 2 + 2;
+      verts[2] = prim * 2 + 4;
+      break;
+    default: verts[0] = verts[1] = verts[2] = 0; break;
+  }
+}
+
+// double-sided ray/triangle test, returns the distance along the ray or a negative value on miss
+static float RayTriangleIntersect(const Vec3f &A, const Vec3f &B, const Vec3f &C,
+                                  const Vec3f &rayPos, const Vec3f &rayDir)
+{
+  Vec3f v0v1 = B - A;
+  Vec3f v0v2 = C - A;
+  Vec3f pvec = rayDir.Cross(v0v2);
+  float det = v0v1.Dot(pvec);
+
+  // backfacing triangles are still hits, only parallel rays miss
+  if(det == 0.0f)
+    return -1.0f;
+
+  float invDet = 1.0f / det;
+
+  Vec3f tvec = rayPos - A;
+  Vec3f qvec = tvec.Cross(v0v1);
+  float u = tvec.Dot(pvec) * invDet;
+  float v = rayDir.Dot(qvec) * invDet;
+
+  if(u < 0.0f || u > 1.0f || v < 0.0f || u + v > 1.0f)
+    return -1.0f;
+
+  float t = v0v2.Dot(qvec) * invDet;
+
+  return t > 0.0f ? t : -1.0f;
+}
+
+// slab test against a node's bounds, returns true if the ray enters them before maxT
+static bool RayBoxIntersect(const Vec3f &minBounds, const Vec3f &maxBounds, const Vec3f &rayPos,
+                            const Vec3f &invDir, float maxT)
+{
+  float tmin = 0.0f;
+  float tmax = maxT;
+
+  for(int axis = 0; axis < 3; axis++)
+  {
+    float o = Component(rayPos, axis);
+    float inv = Component(invDir, axis);
+    float t0 = (Component(minBounds, axis) - o) * inv;
+    float t1 = (Component(maxBounds, axis) - o) * inv;
+
+    if(t0 > t1)
+      std::swap(t0, t1);
+
+    // written so that NaNs (ray origin exactly on a slab with a zero direction) don't reject
+    tmin = t0 > tmin ? t0 : tmin;
+    tmax = t1 < tmax ? t1 : tmax;
+
+    if(tmin > tmax)
+      return false;
+  }
+
+  return true;
+}
+
+bool MeshPickCache::CachedMesh::Matches(uint32_t eid, const MeshDisplay &cfg, bool flipY) const
+{
+  const MeshFormat &o = cfg.position;
+
+  return eventID == eid && stage == cfg.type && flipClipY == flipY && fmt.buf == o.buf &&
+         fmt.offset == o.offset && fmt.stride == o.stride && fmt.idxbuf == o.idxbuf &&
+         fmt.idxoffs == o.idxoffs && fmt.idxByteWidth == o.idxByteWidth &&
+         fmt.baseVertex == o.baseVertex && fmt.compCount == o.compCount &&
+         fmt.compByteWidth == o.compByteWidth && fmt.compType == o.compType &&
+         fmt.bgraOrder == o.bgraOrder && fmt.specialFormat == o.specialFormat &&
+         fmt.topo == o.topo && fmt.numVerts == o.numVerts && fmt.unproject == o.unproject;
+}
+
+void MeshPickCache::Clear()
+{
+  for(size_t i = 0; i < m_Meshes.size(); i++)
+    delete m_Meshes[i];
+  m_Meshes.clear();
+}
+
+MeshPickCache::CachedMesh *MeshPickCache::GetMesh(uint32_t eventID, const MeshDisplay &cfg,
+                                                  bool flipClipY)
+{
+  if(eventID != m_EID)
+  {
+    Clear();
+    m_EID = eventID;
+  }
+
+  for(size_t i = 0; i < m_Meshes.size(); i++)
+  {
+    if(m_Meshes[i]->Matches(eventID, cfg, flipClipY))
+    {
+      // keep the most recently used mesh at the back
+      CachedMesh *mesh = m_Meshes[i];
+      m_Meshes.erase(m_Meshes.begin() + i);
+      m_Meshes.push_back(mesh);
+      return mesh;
+    }
+  }
+
+  CachedMesh *mesh = new CachedMesh;
+  mesh->eventID = eventID;
+  mesh->stage = cfg.type;
+  mesh->fmt = cfg.position;
+  mesh->flipClipY = flipClipY;
+
+  PerformanceTimer timer;
+
+  BuildMesh(*mesh, cfg);
+
+  RDCDEBUG("Built mesh picking BVH for %u vertices at event %u (%zu nodes) in %.2f ms",
+           cfg.position.numVerts, eventID, mesh->nodes.size(), timer.GetMilliseconds());
+
+  m_Meshes.push_back(mesh);
+
+  // evict the least recently used meshes, but always keep the one we just built
+  uint64_t totalBytes = 0;
+  for(size_t i = 0; i < m_Meshes.size(); i++)
+    totalBytes += m_Meshes[i]->GetByteSize();
+
+  while(totalBytes > cacheBudgetBytes && m_Meshes.size() > 1)
+  {
+    totalBytes -= m_Meshes[0]->GetByteSize();
+    delete m_Meshes[0];
+    m_Meshes.erase(m_Meshes.begin());
+  }
+
+  return mesh;
+}
+
+void MeshPickCache::BuildMesh(CachedMesh &mesh, const MeshDisplay &cfg)
+{
+  const MeshFormat &fmt = cfg.position;
+  const uint32_t numVerts = fmt.numVerts;
+
+  mesh.triangles = IsTriangleTopology(fmt.topo);
+
+  std::vector<uint32_t> indices;
+  bool useIndices = fmt.idxByteWidth != 0 && fmt.idxbuf != ResourceId();
+
+  if(useIndices)
+  {
+    vector<byte> idxData;
+    driver->GetBufferData(fmt.idxbuf, fmt.idxoffs, uint64_t(numVerts) * fmt.idxByteWidth, idxData);
+
+    uint32_t numIndices = RDCMIN(numVerts, uint32_t(idxData.size() / fmt.idxByteWidth));
+
+    indices.resize(numIndices);
+
+    if(numIndices > 0 && fmt.idxByteWidth == 1)
+    {
+      for(uint32_t i = 0; i < numIndices; i++)
+        indices[i] = uint32_t(idxData[i]);
+    }
+    else if(numIndices > 0 && fmt.idxByteWidth == 2)
+    {
+      uint16_t *idx16 = (uint16_t *)&idxData[0];
+      for(uint32_t i = 0; i < numIndices; i++)
+        indices[i] = uint32_t(idx16[i]);
+    }
+    else if(numIndices > 0 && fmt.idxByteWidth == 4)
+    {
+      memcpy(&indices[0], &idxData[0], numIndices * sizeof(uint32_t));
+    }
+  }
+
+  vector<byte> vertexData;
+  driver->GetBufferData(fmt.buf, fmt.offset, 0, vertexData);
+
+  const float nan = std::numeric_limits<float>::quiet_NaN();
+
+  mesh.positions.resize(numVerts, Vec3f(nan, nan, nan));
+
+  if(vertexData.empty())
+    return;
+
+  byte *data = &vertexData[0];
+  byte *dataEnd = data + vertexData.size();
+
+  for(uint32_t i = 0; i < numVerts; i++)
+  {
+    uint32_t idx = i;
+
+    if(useIndices)
+    {
+      // out of range reads (including strip restart indices past the end of the data) are
+      // left as NaN below, so they never form part of a pickable primitive
+      if(i >= indices.size())
+        continue;
+
+      idx = indices[i];
+    }
+
+    // apply baseVertex but clamp to 0 (don't allow index to become negative)
+    int64_t vert = int64_t(idx) + fmt.baseVertex;
+    if(vert < 0)
+      vert = 0;
+    if(vert > UINT32_MAX)
+      continue;
+
+    bool valid = true;
+    FloatVector v = HighlightCache::InterpretVertex(data, uint32_t(vert), cfg, dataEnd, valid);
+
+    if(!valid)
+      continue;
+
+    // post-projection data is picked in NDC, so the space doesn't depend on the camera either
+    if(fmt.unproject)
+    {
+      if(mesh.flipClipY)
+        v.y = -v.y;
+
+      mesh.positions[i] = Vec3f(v.x / v.w, v.y / v.w, v.z / v.w);
+    }
+    else
+    {
+      mesh.positions[i] = Vec3f(v.x, v.y, v.z);
+    }
+  }
+
+  Topology topo = fmt.topo;
+  bool triangles = mesh.triangles;
+  const std::vector<Vec3f> &positions = mesh.positions;
+
+  // bounds of a primitive, or false if any of its vertices are unusable
+  auto primBounds = [topo, triangles, &positions](uint32_t p, Vec3f &minBounds,
+                                                  Vec3f &maxBounds) -> bool {
+    if(!triangles)
+    {
+      minBounds = maxBounds = positions[p];
+      return IsFinite(positions[p]);
+    }
+
+    uint32_t verts[3];
+    GetTriangle(topo, p, verts);
+
+    const Vec3f &a = positions[verts[0]];
+    const Vec3f &b = positions[verts[1]];
+    const Vec3f &c = positions[verts[2]];
+
+    minBounds = MinVec(a, MinVec(b, c));
+    maxBounds = MaxVec(a, MaxVec(b, c));
+
+    return IsFinite(a) && IsFinite(b) && IsFinite(c);
+  };
+
+  // gather the centroid of each primitive that can be picked. The centroids are moved around
+  // with the primitive index while building so each pass over a node reads memory in order.
+  struct BuildPrim
+  {
+    Vec3f centroid;
+    uint32_t prim;
+  };
+
+  std::vector<BuildPrim> buildPrims;
+
+  uint32_t numPrims = triangles ? NumTriangles(topo, numVerts) : numVerts;
+
+  buildPrims.reserve(numPrims);
+
+  for(uint32_t p = 0; p < numPrims; p++)
+  {
+    Vec3f minBounds, maxBounds;
+    if(!primBounds(p, minBounds, maxBounds))
+      continue;
+
+    BuildPrim prim = {(minBounds + maxBounds) * 0.5f, p};
+    buildPrims.push_back(prim);
+  }
+
+  if(buildPrims.empty())
+    return;
+
+  // top-down build, splitting each node at the median centroid along its longest axis. Median
+  // splits keep the tree balanced even for degenerate inputs like every vertex at the origin.
+  struct BuildTask
+  {
+    uint32_t node;
+    uint32_t begin;
+    uint32_t end;
+  };
+
+  std::vector<BuildTask> tasks;
+
+  mesh.nodes.reserve(2 * (buildPrims.size() / maxLeafPrims) + 1);
+  mesh.nodes.push_back(BVHNode());
+
+  BuildTask root = {0, 0, (uint32_t)buildPrims.size()};
+  tasks.push_back(root);
+
+  while(!tasks.empty())
+  {
+    BuildTask task = tasks.back();
+    tasks.pop_back();
+
+    uint32_t count = task.end - task.begin;
+
+    if(count <= maxLeafPrims)
+    {
+      mesh.nodes[task.node].index = task.begin;
+      mesh.nodes[task.node].count = count;
+      continue;
+    }
+
+    Vec3f minCentroid(FLT_MAX, FLT_MAX, FLT_MAX);
+    Vec3f maxCentroid(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+
+    for(uint32_t i = task.begin; i < task.end; i++)
+    {
+      minCentroid = MinVec(minCentroid, buildPrims[i].centroid);
+      maxCentroid = MaxVec(maxCentroid, buildPrims[i].centroid);
+    }
+
+    Vec3f extent = maxCentroid - minCentroid;
+    int axis = 0;
+    if(extent.y > extent.x)
+      axis = 1;
+    if(extent.z > Component(extent, axis))
+      axis = 2;
+
+    uint32_t mid = task.begin + count / 2;
+
+    std::nth_element(buildPrims.begin() + task.begin, buildPrims.begin() + mid,
+                     buildPrims.begin() + task.end, [axis](const BuildPrim &a, const BuildPrim &b) {
+                       return Component(a.centroid, axis) < Component(b.centroid, axis);
+                     });
+
+    uint32_t left = (uint32_t)mesh.nodes.size();
+    mesh.nodes.push_back(BVHNode());
+    mesh.nodes.push_back(BVHNode());
+
+    mesh.nodes[task.node].index = left;
+    mesh.nodes[task.node].count = 0;
+
+    BuildTask leftTask = {left, task.begin, mid};
+    BuildTask rightTask = {left + 1, mid, task.end};
+    tasks.push_back(leftTask);
+    tasks.push_back(rightTask);
+  }
+
+  mesh.prims.resize(buildPrims.size());
+  for(size_t i = 0; i < buildPrims.size(); i++)
+    mesh.prims[i] = buildPrims[i].prim;
+
+  // fill in bounds bottom-up. Children are always allocated after their parent, so walking the
+  // nodes backwards sees both children before the node itself.
+  for(size_t n = mesh.nodes.size(); n-- > 0;)
+  {
+    BVHNode &node = mesh.nodes[n];
+
+    if(node.count == 0)
+    {
+      const BVHNode &left = mesh.nodes[node.index];
+      const BVHNode &right = mesh.nodes[node.index + 1];
+
+      node.minBounds = MinVec(left.minBounds, right.minBounds);
+      node.maxBounds = MaxVec(left.maxBounds, right.maxBounds);
+      continue;
+    }
+
+    node.minBounds = Vec3f(FLT_MAX, FLT_MAX, FLT_MAX);
+    node.maxBounds = Vec3f(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+
+    for(uint32_t i = node.index; i < node.index + node.count; i++)
+    {
+      Vec3f minBounds, maxBounds;
+      primBounds(mesh.prims[i], minBounds, maxBounds);
+
+      node.minBounds = MinVec(node.minBounds, minBounds);
+      node.maxBounds = MaxVec(node.maxBounds, maxBounds);
+    }
+  }
+}
+
+uint32_t MeshPickCache::PickTriangle(const CachedMesh &mesh, Vec3f rayPos, Vec3f rayDir,
+                                     uint32_t *primitive)
+{
+  Vec3f invDir(1.0f / rayDir.x, 1.0f / rayDir.y, 1.0f / rayDir.z);
+
+  float closestT = FLT_MAX;
+  uint32_t closestPrim = ~0U;
+
+  // median splits bound the depth to log2 of the primitive count, far below this
+  uint32_t stack[64];
+  int stackSize = 0;
+
+  stack[stackSize++] = 0;
+
+  while(stackSize > 0)
+  {
+    const BVHNode &node = mesh.nodes[stack[--stackSize]];
+
+    if(!RayBoxIntersect(node.minBounds, node.maxBounds, rayPos, invDir, closestT))
+      continue;
+
+    if(node.count == 0)
+    {
+      stack[stackSize++] = node.index;
+      stack[stackSize++] = node.index + 1;
+      continue;
+    }
+
+    for(uint32_t i = node.index; i < node.index + node.count; i++)
+    {
+      uint32_t verts[3];
+      GetTriangle(mesh.fmt.topo, mesh.prims[i], verts);
+
+      float t = RayTriangleIntersect(mesh.positions[verts[0]], mesh.positions[verts[1]],
+                                     mesh.positions[verts[2]], rayPos, rayDir);
+
+      // ties go to the lowest primitive so the result doesn't depend on tree order
+      if(t >= 0.0f && (t < closestT || (t == closestT && mesh.prims[i] < closestPrim)))
+      {
+        closestT = t;
+        closestPrim = mesh.prims[i];
+      }
+    }
+  }
+
+  if(closestPrim == ~0U)
+    return ~0U;
+
+  if(primitive)
+    *primitive = closestPrim;
+
+  // return the vertex of the hit triangle that is closest to the intersection point
+  Vec3f hitPosition = rayPos + rayDir * closestT;
+
+  uint32_t verts[3];
+  GetTriangle(mesh.fmt.topo, closestPrim, verts);
+
+  float dist0 = (mesh.positions[verts[0]] - hitPosition).Length();
+  float dist1 = (mesh.positions[verts[1]] - hitPosition).Length();
+  float dist2 = (mesh.positions[verts[2]] - hitPosition).Length();
+
+  if(dist1 < dist0 && dist1 < dist2)
+    return verts[1];
+  else if(dist2 < dist0 && dist2 < dist1)
+    return verts[2];
+
+  return verts[0];
+}
+
+uint32_t MeshPickCache::PickPoint(const CachedMesh &mesh, const Matrix4f &mvp, float x, float y,
+                                  float width, float height)
+{
+  uint32_t closestVert = ~0U;
+  float closestLen = FLT_MAX;
+  float closestDepth = FLT_MAX;
+
+  uint32_t stack[64];
+  int stackSize = 0;
+
+  stack[stackSize++] = 0;
+
+  while(stackSize > 0)
+  {
+    const BVHNode &node = mesh.nodes[stack[--stackSize]];
+
+    // project the node's corners to find its screen rect. If any corner is behind the camera
+    // the projection doesn't bound the contents, so just descend.
+    float minX = FLT_MAX, minY = FLT_MAX, maxX = -FLT_MAX, maxY = -FLT_MAX;
+    bool bounded = true;
+
+    for(int c = 0; c < 8 && bounded; c++)
+    {
+      Vec3f corner((c & 1) ? node.maxBounds.x : node.minBounds.x,
+                   (c & 2) ? node.maxBounds.y : node.minBounds.y,
+                   (c & 4) ? node.maxBounds.z : node.minBounds.z);
+
+      Vec4f clip = TransformToClip(mvp, corner);
+
+      if(clip.w <= 0.0f)
+      {
+        bounded = false;
+        break;
+      }
+
+      float sx = (clip.x / clip.w + 1.0f) * 0.5f * width;
+      float sy = (1.0f - clip.y / clip.w) * 0.5f * height;
+
+      minX = RDCMIN(minX, sx);
+      minY = RDCMIN(minY, sy);
+      maxX = RDCMAX(maxX, sx);
+      maxY = RDCMAX(maxY, sy);
+    }
+
+    if(bounded)
+    {
+      float dx = RDCMAX(0.0f, RDCMAX(minX - x, x - maxX));
+      float dy = RDCMAX(0.0f, RDCMAX(minY - y, y - maxY));
+
+      if(dx * dx + dy * dy > closestLen * closestLen ||
+         dx * dx + dy * dy >= pointPickRadius * pointPickRadius)
+        continue;
+    }
+
+    if(node.count == 0)
+    {
+      stack[stackSize++] = node.index;
+      stack[stackSize++] = node.index + 1;
+      continue;
+    }
+
+    for(uint32_t i = node.index; i < node.index + node.count; i++)
+    {
+      uint32_t vert = mesh.prims[i];
+
+      Vec4f clip = TransformToClip(mvp, mesh.positions[vert]);
+
+      if(clip.w <= 0.0f)
+        continue;
+
+      float sx = (clip.x / clip.w + 1.0f) * 0.5f * width;
+      float sy = (1.0f - clip.y / clip.w) * 0.5f * height;
+      float depth = clip.z / clip.w;
+
+      float len = sqrtf((sx - x) * (sx - x) + (sy - y) * (sy - y));
+
+      if(len >= pointPickRadius)
+        continue;
+
+      // We need to keep the picking order consistent when multiple vertices have the identical
+      // position (e.g. if UVs or normals are different), so ties fall back to depth then index.
+      if(len < closestLen || (len == closestLen && depth < closestDepth) ||
+         (len == closestLen && depth == closestDepth && vert < closestVert))
+      {
+        closestVert = vert;
+        closestLen = len;
+        closestDepth = depth;
+      }
+    }
+  }
+
+  return closestVert;
+}
+
+uint32_t MeshPickCache::PickVertex(uint32_t eventID, const MeshDisplay &cfg, uint32_t x, uint32_t y,
+                                   float width, float height, bool flipClipY, uint32_t *primitive)
+{
+  if(primitive)
+    *primitive = ~0U;
+
+  if(cfg.position.buf == ResourceId() || cfg.position.numVerts == 0 || width <= 0.0f ||
+     height <= 0.0f)
+    return ~0U;
+
+  CachedMesh *mesh = GetMesh(eventID, cfg, flipClipY);
+
+  if(mesh->nodes.empty())
+    return ~0U;
+
+  Matrix4f projMat = Matrix4f::Perspective(90.0f, 0.1f, 100000.0f, width / height);
+
+  Matrix4f camMat = cfg.cam ? cfg.cam->GetMatrix() : Matrix4f::Identity();
+  Matrix4f pickMVP = projMat.Mul(camMat);
+
+  Matrix4f pickMVPProj;
+  if(cfg.position.unproject)
+  {
+    // the derivation of the projection matrix might not be right (hell, it could be an
+    // orthographic projection). But it'll be close enough likely.
+    Matrix4f guessProj =
+        cfg.position.farPlane != FLT_MAX
+            ? Matrix4f::Perspective(cfg.fov, cfg.position.nearPlane, cfg.position.farPlane, cfg.aspect)
+            : Matrix4f::ReversePerspective(cfg.fov, cfg.position.nearPlane, cfg.aspect);
+
+    if(cfg.ortho)
+      guessProj = Matrix4f::Orthographic(cfg.position.nearPlane, cfg.position.farPlane);
+
+    pickMVPProj = projMat.Mul(camMat.Mul(guessProj.Inverse()));
+  }
+
+  if(!mesh->triangles)
+    return PickPoint(*mesh, cfg.position.unproject ? pickMVPProj : pickMVP, (float)x, (float)y,
+                     width, height);
+
+  Vec3f rayPos;
+  Vec3f rayDir;
+  // convert mouse pos to world space ray
+  {
+    Matrix4f inversePickMVP = pickMVP.Inverse();
+
+    float pickX = ((float)x) / width;
+    float pickXCanonical = RDCLERP(-1.0f, 1.0f, pickX);
+
+    float pickY = ((float)y) / height;
+    // flip the Y axis
+    float pickYCanonical = RDCLERP(1.0f, -1.0f, pickY);
+
+    Vec3f cameraToWorldNearPosition =
+        inversePickMVP.Transform(Vec3f(pickXCanonical, pickYCanonical, -1), 1);
+
+    Vec3f cameraToWorldFarPosition =
+        inversePickMVP.Transform(Vec3f(pickXCanonical, pickYCanonical, 1), 1);
+
+    Vec3f testDir = (cameraToWorldFarPosition - cameraToWorldNearPosition);
+    testDir.Normalise();
+
+    // Calculate the ray direction first in the regular way (above), so we can use the
+    // the output for testing if the ray we are picking is negative or not. This is similar
+    // to checking against the forward direction of the camera, but more robust
+    if(cfg.position.unproject)
+    {
+      Matrix4f inversePickMVPGuess = pickMVPProj.Inverse();
+
+      Vec3f nearPosProj =
+          inversePickMVPGuess.Transform(Vec3f(pickXCanonical, pickYCanonical, -1), 1);
+
+      Vec3f farPosProj = inversePickMVPGuess.Transform(Vec3f(pickXCanonical, pickYCanonical, 1), 1);
+
+      rayDir = (farPosProj - nearPosProj);
+      rayDir.Normalise();
+
+      if(testDir.z < 0)
+      {
+        rayDir = -rayDir;
+      }
+      rayPos = nearPosProj;
+    }
+    else
+    {
+      rayDir = testDir;
+      rayPos = cameraToWorldNearPosition;
+    }
+  }
+
+  return PickTriangle(*mesh, rayPos, rayDir, primitive);
+}
@@ -0,0 +1,108 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2017 Baldur Karlsson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+#pragma once
+
+#include <vector>
+#include "maths/matrix.h"
+#include "maths/vec.h"
+#include "replay_driver.h"
+
+// CPU mesh picking for the mesh viewer. The first pick on a mesh decodes its positions once and
+// builds a bounding volume hierarchy over its primitives, in the space that pick rays are cast in.
+// That space doesn't depend on the camera, so every later pick on the same event/instance is a
+// tree walk rather than a fetch and test of every vertex.
+//
+// Triangle topologies are picked by ray intersection against the triangles, returning the
+// closest vertex of the nearest triangle hit. Everything else (points, lines, patches) picks the
+// closest vertex within a fixed screen-space radius of the cursor.
+class MeshPickCache
+{
+public:
+  MeshPickCache() : driver(NULL), m_EID(0) {}
+  ~MeshPickCache() { Clear(); }
+  IRemoteDriver *driver;
+
+  // width/height are the dimensions of the output being picked in. flipClipY should be set if
+  // post-projection Y points down, as on Vulkan. Returns ~0U if nothing was picked, and if
+  // primitive is non-NULL it receives the index of the triangle that was hit (~0U for non-triangle
+  // topologies).
+  uint32_t PickVertex(uint32_t eventID, const MeshDisplay &cfg, uint32_t x, uint32_t y,
+                      float width, float height, bool flipClipY, uint32_t *primitive = NULL);
+
+  // discards every cached mesh. Must be called whenever buffer contents for an already-picked
+  // event could have changed, e.g. after a shader replacement alters the post-transform data.
+  void Clear();
+
+private:
+  struct BVHNode
+  {
+    Vec3f minBounds;
+    // for leaves the first entry in prims, for inner nodes the index of the first of two
+    // consecutive children
+    uint32_t index;
+    Vec3f maxBounds;
+    // number of primitives in a leaf, 0 for inner nodes
+    uint32_t count;
+  };
+
+  struct CachedMesh
+  {
+    uint32_t eventID;
+    MeshDataStage stage;
+    MeshFormat fmt;
+    bool flipClipY;
+
+    bool triangles;
+
+    // position per vertex in the mesh (i.e. after indexing), in pick space. Vertices that could
+    // not be read or can't be projected are NaN, and any primitive using them is left out of
+    // the tree.
+    std::vector<Vec3f> positions;
+
+    // primitive indices, ordered so that each leaf covers a contiguous range
+    std::vector<uint32_t> prims;
+
+    std::vector<BVHNode> nodes;
+
+    bool Matches(uint32_t eid, const MeshDisplay &cfg, bool flipY) const;
+    uint64_t GetByteSize() const
+    {
+      return positions.size() * sizeof(Vec3f) + prims.size() * sizeof(uint32_t) +
+             nodes.size() * sizeof(BVHNode);
+    }
+  };
+
+  CachedMesh *GetMesh(uint32_t eventID, const MeshDisplay &cfg, bool flipClipY);
+  void BuildMesh(CachedMesh &mesh, const MeshDisplay &cfg);
+
+  uint32_t PickTriangle(const CachedMesh &mesh, Vec3f rayPos, Vec3f rayDir, uint32_t *primitive);
+  uint32_t PickPoint(const CachedMesh &mesh, const Matrix4f &mvp, float x, float y, float width,
+                     float height);
+
+  // meshes built for the current event - one per instance that has been picked in, most recently
+  // used last. Cleared when picking moves to a different event.
+  uint32_t m_EID;
+  std::vector<CachedMesh *> m_Meshes;
+};
@@ -27,15 +27,17 @@
 #include <string.h>
 #include <time.h>
 #include "common/dds_readwrite.h"
+#include "common/timing.h"
 #include "jpeg-compressor/jpgd.h"
 #include "jpeg-compressor/jpge.h"
+#include "maths/format_decode.h"
 #include "maths/formatpacking.h"
 #include "os/os_specific.h"
+#include "replay/image_encode.h"
 #include "serialise/serialiser.h"
 #include "serialise/string_utils.h"
 #include "stb/stb_image.h"
 #include "stb/stb_image_write.h"
-#include "tinyexr/tinyexr.h"
 
 float ConvertComponent(const ResourceFormat &fmt, byte *data)
 {
@@ -285,12 +287,12 @@ rdctype::array<rdctype::str> ReplayController::GetResolve(const rdctype::array<u
   if(resolv == NULL)
     return ret;
 
+  std::vector<Callstack::AddressDetails> info((size_t)callstack.count);
+  resolv->GetAddrs(callstack.elems, info.size(), info.data());
+
   create_array_uninit(ret, (size_t)callstack.count);
   for(int32_t i = 0; i < callstack.count; i++)
-  {
-    Callstack::AddressDetails info = resolv->GetAddr(callstack[i]);
-    ret[i] = info.formattedString();
-  }
+    ret[i] = info[i].formattedString();
 
   return ret;
 }
@@ -368,13 +370,40 @@ rdctype::array<byte> ReplayController::GetTextureData(ResourceId tex, uint32_t a
   return ret;
 }
 
-bool ReplayController::SaveTexture(const TextureSave &saveData, const char *path)
+// a texture save with its data read back from the device. Converting it and writing the file is CPU
+// work that doesn't need the replay thread.
+struct TextureSaveJob
 {
-  TextureSave sd = saveData;    // mutable copy
+  TextureSaveJob() : rowPitch(0), numMips(0), numSlices(0) {}
+  ~TextureSaveJob()
+  {
+    for(size_t i = 0; i < subdata.size(); i++)
+      delete[] subdata[i];
+  }
+
+  // the save settings after clamping to what the texture and file type support, and the
+  // description of the data as fetched
+  TextureSave sd;
+  TextureDescription td;
+  string path;
+
+  vector<byte *> subdata;
+  uint32_t rowPitch;
+  uint32_t numMips;
+  uint32_t numSlices;
+};
+
+bool ReplayController::FetchTextureSave(const TextureSave &saveData, const char *path,
+                                        TextureSaveJob &job)
+{
+  job.sd = saveData;    // mutable copy
+  job.path = path;
+
+  TextureSave &sd = job.sd;
   ResourceId liveid = m_pDevice->GetLiveID(sd.id);
-  TextureDescription td = m_pDevice->GetTexture(liveid);
+  job.td = m_pDevice->GetTexture(liveid);
 
-  bool success = false;
+  TextureDescription &td = job.td;
 
   // clamp sample/mip/slice indices
   if(td.msSamp == 1)
@@ -455,10 +484,12 @@ bool ReplayController::SaveTexture(const TextureSave &saveData, const char *path
   // down a multisampled texture for writing as a single 'image' elsewhere)
   uint32_t sliceOffset = 0;
   uint32_t sliceStride = 1;
-  uint32_t numSlices = td.arraysize * td.depth;
+  uint32_t &numSlices = job.numSlices;
+  numSlices = td.arraysize * td.depth;
 
   uint32_t mipOffset = 0;
-  uint32_t numMips = td.mips;
+  uint32_t &numMips = job.numMips;
+  numMips = td.mips;
 
   bool singleSlice = (sd.slice.sliceIndex != -1);
 
@@ -522,7 +553,7 @@ bool ReplayController::SaveTexture(const TextureSave &saveData, const char *path
     // otherwise take all mips, as by default
   }
 
-  vector<byte *> subdata;
+  vector<byte *> &subdata = job.subdata;
 
   bool downcast = false;
 
@@ -559,7 +590,7 @@ bool ReplayController::SaveTexture(const TextureSave &saveData, const char *path
     td.format.specialFormat = SpecialFormat::Unknown;
   }
 
-  uint32_t rowPitch = 0;
+  uint32_t &rowPitch = job.rowPitch;
   uint32_t slicePitch = 0;
 
   bool blockformat = false;
@@ -631,10 +662,6 @@ bool ReplayController::SaveTexture(const TextureSave &saveData, const char *path
       if(bytes == NULL)
       {
         RDCERR("Couldn't get bytes for mip %u, slice %u", mip, slice);
-
-        for(size_t i = 0; i < subdata.size(); i++)
-          delete[] subdata[i];
-
         return false;
       }
 
@@ -694,6 +721,20 @@ bool ReplayController::SaveTexture(const TextureSave &saveData, const char *path
     }
   }
 
+  return true;
+}
+
+static bool WriteTextureSave(TextureSaveJob &job, uint32_t numThreads)
+{
+  TextureSave &sd = job.sd;
+  TextureDescription &td = job.td;
+  vector<byte *> &subdata = job.subdata;
+  uint32_t &rowPitch = job.rowPitch;
+  uint32_t numMips = job.numMips;
+  uint32_t numSlices = job.numSlices;
+
+  bool success = false;
+
   // should have been handled above, but verify incoming data is RGBA8
   if(sd.slice.slicesAsGrid && td.format.compByteWidth == 1 && td.format.compCount == 4)
   {
@@ -905,7 +946,7 @@ bool ReplayController::SaveTexture(const TextureSave &saveData, const char *path
     rowPitch = td.width * 3;
   }
 
-  FILE *f = FileIO::fopen(path, "wb");
+  FILE *f = FileIO::fopen(job.path.c_str(), "wb");
 
   if(!f)
   {
@@ -940,9 +981,10 @@ bool ReplayController::SaveTexture(const TextureSave &saveData, const char *path
       for(uint32_t p = 0; sd.alpha == AlphaMapping::Discard && p < td.width * td.height; p++)
         subdata[0][p * 4 + 3] = 255;
 
-      int ret = stbi_write_png_to_func(fileWriteFunc, (void *)f, td.width, td.height, numComps,
-                                       subdata[0], rowPitch);
-      success = (ret != 0);
+      vector<byte> png;
+      success = EncodePNG(subdata[0], td.width, td.height, numComps, rowPitch, numThreads, png);
+      if(success)
+        FileIO::fwrite(&png[0], 1, png.size(), f);
     }
     else if(sd.destType == FileType::TGA)
     {
@@ -993,63 +1035,26 @@ bool ReplayController::SaveTexture(const TextureSave &saveData, const char *path
 
       byte *srcData = subdata[0];
 
-      ResourceFormat saveFmt = td.format;
-      if(saveFmt.compType == CompType::Typeless)
-        saveFmt.compType = sd.typeHint;
-      if(saveFmt.compType == CompType::Typeless)
-        saveFmt.compType = saveFmt.compByteWidth == 4 ? CompType::Float : CompType::UNorm;
-
-      for(uint32_t y = 0; y < td.height; y++)
-      {
-        for(uint32_t x = 0; x < td.width; x++)
-        {
-          float r = 0.0f;
-          float g = 0.0f;
-          float b = 0.0f;
-          float a = 1.0f;
-
-          if(saveFmt.special && saveFmt.specialFormat == SpecialFormat::R10G10B10A2)
-          {
-            uint32_t *u32 = (uint32_t *)srcData;
+      FormatDecoder decoder;
+      bool decodable = decoder.Init(td.format, sd.typeHint);
 
-            Vec4f vec = ConvertFromR10G10B10A2(*u32);
+      if(!decodable)
+        RDCERR("Can't convert format %s to floats for saving", td.format.strname.c_str());
 
-            r = vec.x;
-            g = vec.y;
-            b = vec.z;
-            a = vec.w;
+      // each row is decoded in one go, then remapped per pixel
+      vector<float> row(td.width * 4);
 
-            srcData += 4;
-          }
-          else if(saveFmt.special && saveFmt.specialFormat == SpecialFormat::R11G11B10)
-          {
-            uint32_t *u32 = (uint32_t *)srcData;
-
-            Vec3f vec = ConvertFromR11G11B10(*u32);
-
-            r = vec.x;
-            g = vec.y;
-            b = vec.z;
-            a = 1.0f;
-
-            srcData += 4;
-          }
-          else
-          {
-            if(saveFmt.compCount >= 1)
-              r = ConvertComponent(saveFmt, srcData + saveFmt.compByteWidth * 0);
-            if(saveFmt.compCount >= 2)
-              g = ConvertComponent(saveFmt, srcData + saveFmt.compByteWidth * 1);
-            if(saveFmt.compCount >= 3)
-              b = ConvertComponent(saveFmt, srcData + saveFmt.compByteWidth * 2);
-            if(saveFmt.compCount >= 4)
-              a = ConvertComponent(saveFmt, srcData + saveFmt.compByteWidth * 3);
-
-            srcData += saveFmt.compCount * saveFmt.compByteWidth;
-          }
+      for(uint32_t y = 0; decodable && y < td.height; y++)
+      {
+        decoder.Decode(srcData, td.width, 0, &row[0]);
+        srcData += td.width * decoder.elementSize;
 
-          if(saveFmt.bgraOrder)
-            std::swap(r, b);
+        for(uint32_t x = 0; x < td.width; x++)
+        {
+          float r = row[x * 4 + 0];
+          float g = row[x * 4 + 1];
+          float b = row[x * 4 + 2];
+          float a = row[x * 4 + 3];
 
           // HDR can't represent negative values
           if(sd.destType == FileType::HDR)
@@ -1098,46 +1103,21 @@ bool ReplayController::SaveTexture(const TextureSave &saveData, const char *path
         }
       }
 
-      if(sd.destType == FileType::HDR)
+      if(!decodable)
+      {
+        success = false;
+      }
+      else if(sd.destType == FileType::HDR)
       {
         int ret = stbi_write_hdr_to_func(fileWriteFunc, (void *)f, td.width, td.height, 4, fldata);
         success = (ret != 0);
       }
       else if(sd.destType == FileType::EXR)
       {
-        const char *err = NULL;
-
-        EXRImage exrImage;
-        InitEXRImage(&exrImage);
-
-        int pixTypes[4] = {TINYEXR_PIXELTYPE_FLOAT, TINYEXR_PIXELTYPE_FLOAT,
-                           TINYEXR_PIXELTYPE_FLOAT, TINYEXR_PIXELTYPE_FLOAT};
-        int reqTypes[4] = {TINYEXR_PIXELTYPE_HALF, TINYEXR_PIXELTYPE_HALF, TINYEXR_PIXELTYPE_HALF,
-                           TINYEXR_PIXELTYPE_HALF};
-
-        // must be in this order as many viewers don't pay attention to channels and just assume
-        // they are in this order
-        const char *bgraNames[4] = {"A", "B", "G", "R"};
-
-        exrImage.num_channels = 4;
-        exrImage.channel_names = bgraNames;
-        exrImage.images = (unsigned char **)abgr;
-        exrImage.width = td.width;
-        exrImage.height = td.height;
-        exrImage.pixel_types = pixTypes;
-        exrImage.requested_pixel_types = reqTypes;
-
-        unsigned char *mem = NULL;
-
-        size_t ret = SaveMultiChannelEXRToMemory(&exrImage, &mem, &err);
-
-        success = (ret > 0);
+        vector<byte> exr;
+        success = EncodeEXR(abgr, td.width, td.height, numThreads, exr);
         if(success)
-          FileIO::fwrite(mem, 1, ret, f);
-        else
-          RDCERR("Error saving EXR file %d: '%s'", ret, err);
-
-        free(mem);
+          FileIO::fwrite(&exr[0], 1, exr.size(), f);
       }
 
       if(fldata)
@@ -1156,12 +1136,166 @@ bool ReplayController::SaveTexture(const TextureSave &saveData, const char *path
     FileIO::fclose(f);
   }
 
-  for(size_t i = 0; i < subdata.size(); i++)
-    delete[] subdata[i];
-
   return success;
 }
 
+bool ReplayController::SaveTexture(const TextureSave &saveData, const char *path)
+{
+  TextureSaveJob job;
+
+  if(!FetchTextureSave(saveData, path, job))
+    return false;
+
+  // nothing else is being saved, so the whole machine can go to encoding this one
+  return WriteTextureSave(job, Threading::NumberOfCores());
+}
+
+static const uint32_t MaxTextureSaveThreads = 8;
+
+// encodes fetched textures on worker threads while the replay thread reads back the next ones
+struct TextureSavePool
+{
+  TextureSavePool() : next(0), numWritten(0), numFailed(0), finishing(0), bandThreads(1) {}
+
+  Threading::CriticalSection lock;
+
+  // jobs are taken in order, and deleted by the worker once written
+  vector<TextureSaveJob *> queue;
+  size_t next;
+
+  // protected by the lock
+  uint32_t numWritten;
+  uint32_t numFailed;
+
+  vector<Threading::ThreadHandle> threads;
+
+  // set once every texture has been fetched, workers exit when they see this and the queue is empty
+  volatile int32_t finishing;
+
+  // threads each worker uses to compress bands of one image
+  uint32_t bandThreads;
+
+  static void WorkerThread(void *p)
+  {
+    TextureSavePool *pool = (TextureSavePool *)p;
+
+    for(;;)
+    {
+      bool finished = Atomic::CmpExch32(&pool->finishing, 1, 1) == 1;
+
+      TextureSaveJob *job = NULL;
+
+      {
+        SCOPED_LOCK(pool->lock);
+        if(pool->next < pool->queue.size())
+          job = pool->queue[pool->next++];
+      }
+
+      if(job == NULL)
+      {
+        if(finished)
+          break;
+
+        Threading::Sleep(1);
+        continue;
+      }
+
+      bool success = WriteTextureSave(*job, pool->bandThreads);
+
+      if(!success)
+        RDCERR("Failed to save texture to %s", job->path.c_str());
+
+      SAFE_DELETE(job);
+
+      SCOPED_LOCK(pool->lock);
+      pool->numWritten++;
+      if(!success)
+        pool->numFailed++;
+    }
+  }
+};
+
+bool ReplayController::SaveTextures(const rdctype::array<TextureSave> &saveData,
+                                    const rdctype::array<rdctype::str> &paths)
+{
+  if(saveData.count != paths.count)
+  {
+    RDCERR("Got %d textures to save but %d paths", saveData.count, paths.count);
+    return false;
+  }
+
+  if(saveData.empty())
+    return true;
+
+  PerformanceTimer timer;
+
+  uint32_t numCores = Threading::NumberOfCores();
+  uint32_t numWorkers =
+      RDCMIN(RDCCLAMP(numCores, 1U, MaxTextureSaveThreads), (uint32_t)saveData.count);
+
+  TextureSavePool pool;
+  pool.bandThreads = RDCMAX(1U, numCores / numWorkers);
+
+  // each fetched texture holds its whole readback until it's written, so don't let the replay
+  // thread get too far ahead of the workers
+  const uint32_t maxInFlight = numWorkers * 2;
+
+  for(uint32_t i = 0; i < numWorkers; i++)
+    pool.threads.push_back(Threading::CreateThread(&TextureSavePool::WorkerThread, &pool));
+
+  uint32_t numFetched = 0;
+  uint32_t fetchFailed = 0;
+
+  for(int32_t i = 0; i < saveData.count; i++)
+  {
+    for(;;)
+    {
+      uint32_t numWritten = 0;
+      {
+        SCOPED_LOCK(pool.lock);
+        numWritten = pool.numWritten;
+      }
+
+      if(numFetched - numWritten < maxInFlight)
+        break;
+
+      Threading::Sleep(1);
+    }
+
+    TextureSaveJob *job = new TextureSaveJob;
+
+    if(!FetchTextureSave(saveData[i], paths[i].c_str(), *job))
+    {
+      RDCERR("Failed to fetch texture to save to %s", paths[i].c_str());
+      SAFE_DELETE(job);
+      fetchFailed++;
+      continue;
+    }
+
+    {
+      SCOPED_LOCK(pool.lock);
+      pool.queue.push_back(job);
+    }
+
+    numFetched++;
+  }
+
+  Atomic::CmpExch32(&pool.finishing, 0, 1);
+
+  for(size_t i = 0; i < pool.threads.size(); i++)
+  {
+    Threading::JoinThread(pool.threads[i]);
+    Threading::CloseThread(pool.threads[i]);
+  }
+
+  uint32_t numFailed = fetchFailed + pool.numFailed;
+
+  RDCLOG("Saved %d textures on %u threads taking %.3f ms, %u failed", saveData.count, numWorkers,
+         timer.GetMilliseconds(), numFailed);
+
+  return numFailed == 0;
+}
+
 rdctype::array<PixelModification> ReplayController::PixelHistory(ResourceId target, uint32_t x,
                                                                  uint32_t y, uint32_t slice,
                                                                  uint32_t mip, uint32_t sampleIdx,
@@ -34,6 +34,7 @@
 #include "type_helpers.h"
 
 struct ReplayController;
+struct TextureSaveJob;
 
 struct ReplayOutput : public IReplayOutput
 {
@@ -58,6 +59,7 @@ public:
   PixelValue PickPixel(ResourceId texID, bool customShader, uint32_t x, uint32_t y,
                        uint32_t sliceFace, uint32_t mip, uint32_t sample);
   rdctype::pair<uint32_t, uint32_t> PickVertex(uint32_t eventID, uint32_t x, uint32_t y);
+  rdctype::pair<uint32_t, uint32_t> PickTriangle(uint32_t eventID, uint32_t x, uint32_t y);
 
 private:
   ReplayOutput(ReplayController *parent, WindowingSystem system, void *data, ReplayOutputType type);
@@ -65,6 +67,10 @@ private:
 
   void SetFrameEvent(int eventID);
 
+  // picks a vertex, returning it and its instance. primitive is as for IReplayDriver::PickVertex
+  rdctype::pair<uint32_t, uint32_t> PickMesh(uint32_t eventID, uint32_t x, uint32_t y,
+                                             uint32_t *primitive);
+
   void RefreshOverlay();
 
   void DisplayContext();
@@ -179,6 +185,8 @@ public:
   rdctype::array<byte> GetTextureData(ResourceId buff, uint32_t arrayIdx, uint32_t mip);
 
   bool SaveTexture(const TextureSave &saveData, const char *path);
+  bool SaveTextures(const rdctype::array<TextureSave> &saveData,
+                    const rdctype::array<rdctype::str> &paths);
 
   rdctype::array<ShaderVariable> GetCBufferVariableContents(ResourceId shader, const char *entryPoint,
                                                             uint32_t cbufslot, ResourceId buffer,
@@ -194,6 +202,8 @@ public:
 private:
   ReplayStatus PostCreateInit(IReplayDriver *device);
 
+  bool FetchTextureSave(const TextureSave &saveData, const char *path, TextureSaveJob &job);
+
   DrawcallDescription *GetDrawcallByEID(uint32_t eventID);
 
   IReplayDriver *GetDevice() { return m_pDevice; }
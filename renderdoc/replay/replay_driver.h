@@ -201,7 +201,10 @@ public:
 
   virtual void PickPixel(ResourceId texture, uint32_t x, uint32_t y, uint32_t sliceFace,
                          uint32_t mip, uint32_t sample, CompType typeHint, float pixel[4]) = 0;
-  virtual uint32_t PickVertex(uint32_t eventID, const MeshDisplay &cfg, uint32_t x, uint32_t y) = 0;
+  // if primitive is non-NULL it receives the index of the triangle that was hit, or ~0U if the
+  // topology isn't triangles or the driver can't tell
+  virtual uint32_t PickVertex(uint32_t eventID, const MeshDisplay &cfg, uint32_t x, uint32_t y,
+                              uint32_t *primitive) = 0;
 };
 
 // utility functions useful in any driver implementation
@@ -27,6 +27,7 @@
 #include "maths/matrix.h"
 #include "serialise/string_utils.h"
 #include "replay_controller.h"
+#include "texture_stats.h"
 
 static uint64_t GetHandle(WindowingSystem system, void *data)
 {
@@ -300,7 +301,16 @@ rdctype::pair<PixelValue, PixelValue> ReplayOutput::GetMinMax()
     sample = 0;
   }
 
-  m_pDevice->GetMinMax(tex, slice, mip, sample, typeHint, &minval.value_f[0], &maxval.value_f[0]);
+  bool success = m_pDevice->GetMinMax(tex, slice, mip, sample, typeHint, &minval.value_f[0],
+                                      &maxval.value_f[0]);
+
+#if ENABLED(VALIDATE_TEXTURE_STATS)
+  if(success)
+    ValidateMinMax(m_pDevice, tex, slice, mip, sample, typeHint, &minval.value_f[0],
+                   &maxval.value_f[0]);
+#else
+  (void)success;
+#endif
 
   return rdctype::make_pair(minval, maxval);
 }
@@ -324,7 +334,15 @@ rdctype::array<uint32_t> ReplayOutput::GetHistogram(float minval, float maxval,
     sample = 0;
   }
 
-  m_pDevice->GetHistogram(tex, slice, mip, sample, typeHint, minval, maxval, channels, hist);
+  bool success =
+      m_pDevice->GetHistogram(tex, slice, mip, sample, typeHint, minval, maxval, channels, hist);
+
+#if ENABLED(VALIDATE_TEXTURE_STATS)
+  if(success)
+    ValidateHistogram(m_pDevice, tex, slice, mip, sample, typeHint, minval, maxval, channels, hist);
+#else
+  (void)success;
+#endif
 
   return hist;
 }
@@ -399,6 +417,23 @@ PixelValue ReplayOutput::PickPixel(ResourceId tex, bool customShader, uint32_t x
 }
 
 rdctype::pair<uint32_t, uint32_t> ReplayOutput::PickVertex(uint32_t eventID, uint32_t x, uint32_t y)
+{
+  return PickMesh(eventID, x, y, NULL);
+}
+
+rdctype::pair<uint32_t, uint32_t> ReplayOutput::PickTriangle(uint32_t eventID, uint32_t x, uint32_t y)
+{
+  uint32_t primitive = ~0U;
+  rdctype::pair<uint32_t, uint32_t> ret = PickMesh(eventID, x, y, &primitive);
+
+  if(ret.first == ~0U || primitive == ~0U)
+    return rdctype::make_pair(~0U, ~0U);
+
+  return rdctype::make_pair(primitive, ret.second);
+}
+
+rdctype::pair<uint32_t, uint32_t> ReplayOutput::PickMesh(uint32_t eventID, uint32_t x, uint32_t y,
+                                                         uint32_t *primitive)
 {
   DrawcallDescription *draw = m_pRenderer->GetDrawcallByEID(eventID);
 
@@ -454,7 +489,7 @@ rdctype::pair<uint32_t, uint32_t> ReplayOutput::PickVertex(uint32_t eventID, uin
       if(fmt.buf != ResourceId())
         cfg.position.offset = fmt.offset + elemOffset;
 
-      uint32_t vert = m_pDevice->PickVertex(m_EventID, cfg, x, y);
+      uint32_t vert = m_pDevice->PickVertex(m_EventID, cfg, x, y, primitive);
       if(vert != ~0U)
       {
         return rdctype::make_pair(vert, inst);
@@ -465,7 +500,7 @@ rdctype::pair<uint32_t, uint32_t> ReplayOutput::PickVertex(uint32_t eventID, uin
   }
   else
   {
-    return rdctype::make_pair(m_pDevice->PickVertex(m_EventID, cfg, x, y), 0U);
+    return rdctype::make_pair(m_pDevice->PickVertex(m_EventID, cfg, x, y, primitive), 0U);
   }
 }
 
@@ -924,3 +959,13 @@ extern "C" RENDERDOC_API uint32_t RENDERDOC_CC ReplayOutput_PickVertex(IReplayOu
   *pickedInstance = ret.second;
   return ret.first;
 }
+
+extern "C" RENDERDOC_API uint32_t RENDERDOC_CC ReplayOutput_PickTriangle(IReplayOutput *output,
+                                                                         uint32_t eventID, uint32_t x,
+                                                                         uint32_t y,
+                                                                         uint32_t *pickedInstance)
+{
+  auto ret = output->PickTriangle(eventID, x, y);
+  *pickedInstance = ret.second;
+  return ret.first;
+}
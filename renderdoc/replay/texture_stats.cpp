@@ -0,0 +1,539 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2017 Baldur Karlsson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+
+#include "texture_stats.h"
+#include <math.h>
+#include <limits>
+#include "common/timing.h"
+#include "maths/format_decode.h"
+#include "os/os_specific.h"
+
+#if ENABLED(RDOC_X86)
+#include <immintrin.h>
+#endif
+
+// matches HGRAM_NUM_BUCKETS in the GPU implementations
+static const uint32_t histogramBuckets = 256;
+
+// subresources with at least this many texels are split by rows across several threads
+static const uint64_t parallelTexelThreshold = 256 * 256;
+static const uint32_t minRowsPerThread = 16;
+static const uint32_t maxThreads = 8;
+
+///////////////////////////////////////////////////////////////////////////////
+// min/max. NaNs are skipped, since they would otherwise poison the result.
+
+typedef void (*MinMaxRowFunc)(const float *texels, uint32_t width, float *minval, float *maxval);
+
+static void MinMaxRow_Scalar(const float *texels, uint32_t width, float *minval, float *maxval)
+{
+  for(uint32_t x = 0; x < width; x++, texels += 4)
+  {
+    for(int c = 0; c < 4; c++)
+    {
+      // comparisons with NaN are false, so NaNs never replace the current value
+      if(texels[c] < minval[c])
+        minval[c] = texels[c];
+      if(texels[c] > maxval[c])
+        maxval[c] = texels[c];
+    }
+  }
+}
+
+#if ENABLED(RDOC_X86)
+
+// _mm_min_ps and _mm_max_ps return the second operand if either is NaN, so the running value is
+// always passed second.
+
+SIMD_TARGET("sse2")
+static void MinMaxRow_SSE2(const float *texels, uint32_t width, float *minval, float *maxval)
+{
+  __m128 mn = _mm_loadu_ps(minval);
+  __m128 mx = _mm_loadu_ps(maxval);
+
+  for(uint32_t x = 0; x < width; x++)
+  {
+    __m128 v = _mm_loadu_ps(texels + x * 4);
+    mn = _mm_min_ps(v, mn);
+    mx = _mm_max_ps(v, mx);
+  }
+
+  _mm_storeu_ps(minval, mn);
+  _mm_storeu_ps(maxval, mx);
+}
+
+SIMD_TARGET("avx")
+static void MinMaxRow_AVX(const float *texels, uint32_t width, float *minval, float *maxval)
+{
+  __m128 mn4 = _mm_loadu_ps(minval);
+  __m128 mx4 = _mm_loadu_ps(maxval);
+
+  // two texels per register, and two registers to hide latency
+  __m256 mn[2] = {_mm256_broadcast_ps(&mn4), _mm256_broadcast_ps(&mn4)};
+  __m256 mx[2] = {_mm256_broadcast_ps(&mx4), _mm256_broadcast_ps(&mx4)};
+
+  uint32_t x = 0;
+  for(; x + 4 <= width; x += 4)
+  {
+    __m256 a = _mm256_loadu_ps(texels + x * 4);
+    __m256 b = _mm256_loadu_ps(texels + x * 4 + 8);
+    mn[0] = _mm256_min_ps(a, mn[0]);
+    mx[0] = _mm256_max_ps(a, mx[0]);
+    mn[1] = _mm256_min_ps(b, mn[1]);
+    mx[1] = _mm256_max_ps(b, mx[1]);
+  }
+
+  mn[0] = _mm256_min_ps(mn[1], mn[0]);
+  mx[0] = _mm256_max_ps(mx[1], mx[0]);
+
+  mn4 = _mm_min_ps(_mm256_extractf128_ps(mn[0], 1), _mm256_castps256_ps128(mn[0]));
+  mx4 = _mm_max_ps(_mm256_extractf128_ps(mx[0], 1), _mm256_castps256_ps128(mx[0]));
+
+  for(; x < width; x++)
+  {
+    __m128 v = _mm_loadu_ps(texels + x * 4);
+    mn4 = _mm_min_ps(v, mn4);
+    mx4 = _mm_max_ps(v, mx4);
+  }
+
+  _mm_storeu_ps(minval, mn4);
+  _mm_storeu_ps(maxval, mx4);
+}
+
+#endif    // ENABLED(RDOC_X86)
+
+static MinMaxRowFunc GetMinMaxRow()
+{
+#if ENABLED(RDOC_X86)
+  if(CPUSupportsAVX())
+    return &MinMaxRow_AVX;
+  if(CPUSupportsSSE2())
+    return &MinMaxRow_SSE2;
+#endif
+
+  return &MinMaxRow_Scalar;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// histogram. Each texel's selected channels are averaged and bucketed the same way as the
+// histogram compute shaders, so values at or above the maximum, below the minimum, or NaN are
+// not counted.
+
+struct HistogramParams
+{
+  bool channels[4];
+  float divisor;
+  float minval;
+  float range;
+};
+
+typedef void (*HistogramRowFunc)(const float *texels, uint32_t width, const HistogramParams &params,
+                                 uint32_t *buckets);
+
+static void HistogramRow_Scalar(const float *texels, uint32_t width, const HistogramParams &params,
+                                uint32_t *buckets)
+{
+  for(uint32_t x = 0; x < width; x++, texels += 4)
+  {
+    float sum = 0.0f;
+    for(int c = 0; c < 4; c++)
+      if(params.channels[c])
+        sum += texels[c];
+
+    float normalised = (sum / params.divisor - params.minval) / params.range;
+    float bucket = normalised * float(histogramBuckets);
+
+    if(bucket >= 0.0f && bucket < float(histogramBuckets))
+      buckets[uint32_t(bucket)]++;
+  }
+}
+
+#if ENABLED(RDOC_X86)
+
+SIMD_TARGET("sse2")
+static void HistogramRow_SSE2(const float *texels, uint32_t width, const HistogramParams &params,
+                              uint32_t *buckets)
+{
+  // masking off unselected channels rather than multiplying by 0 adds them in as exactly 0,
+  // even when they are infinite or NaN
+  __m128 masks[4];
+  for(int c = 0; c < 4; c++)
+    masks[c] = _mm_castsi128_ps(_mm_set1_epi32(params.channels[c] ? -1 : 0));
+
+  const __m128 divisor = _mm_set1_ps(params.divisor);
+  const __m128 minval = _mm_set1_ps(params.minval);
+  const __m128 range = _mm_set1_ps(params.range);
+  const __m128 numBuckets = _mm_set1_ps(float(histogramBuckets));
+  const __m128 zero = _mm_setzero_ps();
+
+  uint32_t x = 0;
+  for(; x + 4 <= width; x += 4)
+  {
+    __m128 r = _mm_loadu_ps(texels + x * 4 + 0);
+    __m128 g = _mm_loadu_ps(texels + x * 4 + 4);
+    __m128 b = _mm_loadu_ps(texels + x * 4 + 8);
+    __m128 a = _mm_loadu_ps(texels + x * 4 + 12);
+
+    // from one texel per register to one channel per register
+    _MM_TRANSPOSE4_PS(r, g, b, a);
+
+    // summed in the same order as the scalar version, so results are identical
+    __m128 sum = _mm_add_ps(zero, _mm_and_ps(r, masks[0]));
+    sum = _mm_add_ps(sum, _mm_and_ps(g, masks[1]));
+    sum = _mm_add_ps(sum, _mm_and_ps(b, masks[2]));
+    sum = _mm_add_ps(sum, _mm_and_ps(a, masks[3]));
+
+    __m128 normalised = _mm_div_ps(_mm_sub_ps(_mm_div_ps(sum, divisor), minval), range);
+    __m128 bucket = _mm_mul_ps(normalised, numBuckets);
+
+    int valid = _mm_movemask_ps(
+        _mm_and_ps(_mm_cmpge_ps(bucket, zero), _mm_cmplt_ps(bucket, numBuckets)));
+
+    if(valid == 0)
+      continue;
+
+    uint32_t idx[4];
+    _mm_storeu_si128((__m128i *)idx, _mm_cvttps_epi32(bucket));
+
+    for(int i = 0; i < 4; i++)
+      if(valid & (1 << i))
+        buckets[idx[i]]++;
+  }
+
+  if(x < width)
+    HistogramRow_Scalar(texels + x * 4, width - x, params, buckets);
+}
+
+#endif    // ENABLED(RDOC_X86)
+
+static HistogramRowFunc GetHistogramRow()
+{
+#if ENABLED(RDOC_X86)
+  if(CPUSupportsSSE2())
+    return &HistogramRow_SSE2;
+#endif
+
+  return &HistogramRow_Scalar;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// threading
+
+struct StatsJob
+{
+  const FormatDecoder *format;
+  const byte *data;
+  size_t rowPitch;
+  uint32_t width;
+  uint32_t rowBegin;
+  uint32_t rowEnd;
+
+  // if NULL, calculate min/max
+  const HistogramParams *histogram;
+
+  float minval[4];
+  float maxval[4];
+  std::vector<uint32_t> buckets;
+};
+
+static void StatsJobThread(void *j)
+{
+  StatsJob &job = *(StatsJob *)j;
+
+  std::vector<float> row(size_t(job.width) * 4);
+
+  if(job.histogram)
+  {
+    HistogramRowFunc hist = GetHistogramRow();
+
+    job.buckets.assign(histogramBuckets, 0);
+
+    for(uint32_t y = job.rowBegin; y < job.rowEnd; y++)
+    {
+      job.format->Decode(job.data + y * job.rowPitch, job.width, 0, &row[0]);
+      hist(&row[0], job.width, *job.histogram, &job.buckets[0]);
+    }
+  }
+  else
+  {
+    MinMaxRowFunc minmax = GetMinMaxRow();
+
+    // infinities are valid values, so start from them rather than the largest finite values
+    for(int c = 0; c < 4; c++)
+    {
+      job.minval[c] = std::numeric_limits<float>::infinity();
+      job.maxval[c] = -std::numeric_limits<float>::infinity();
+    }
+
+    for(uint32_t y = job.rowBegin; y < job.rowEnd; y++)
+    {
+      job.format->Decode(job.data + y * job.rowPitch, job.width, 0, &row[0]);
+      minmax(&row[0], job.width, job.minval, job.maxval);
+    }
+  }
+}
+
+// a subresource read back to the CPU. data points to the requested slice within the readback
+struct Subresource
+{
+  Subresource() : readback(NULL), data(NULL), rowPitch(0), width(0), height(0) {}
+  ~Subresource() { delete[] readback; }
+  byte *readback;
+  const byte *data;
+  size_t rowPitch;
+  uint32_t width;
+  uint32_t height;
+  FormatDecoder format;
+};
+
+static bool FetchSubresource(IRemoteDriver *driver, ResourceId texid, uint32_t sliceFace,
+                             uint32_t mip, uint32_t sample, CompType typeHint, Subresource &sub)
+{
+  TextureDescription tex = driver->GetTexture(texid);
+
+  bool glLayout = driver->GetAPIProperties().pipelineType == GraphicsAPI::OpenGL;
+
+  if(!sub.format.Init(tex.format, typeHint, glLayout))
+  {
+    RDCWARN("Can't calculate texture statistics in software for format %s",
+            tex.format.strname.c_str());
+    return false;
+  }
+
+  sub.width = RDCMAX(1U, tex.width >> mip);
+  sub.height = RDCMAX(1U, tex.height >> mip);
+  uint32_t depth = RDCMAX(1U, tex.depth >> mip);
+
+  sub.rowPitch = size_t(sub.width) * sub.format.elementSize;
+  size_t slicePitch = sub.rowPitch * sub.height;
+
+  // 3D textures are read back a whole mip at a time, and multisampled textures are read back as
+  // an array with each sample in its own slice
+  uint32_t arrayIdx = sliceFace;
+  size_t offset = 0;
+
+  if(tex.depth > 1)
+  {
+    arrayIdx = 0;
+    offset = RDCMIN(sliceFace, depth - 1) * slicePitch;
+  }
+  else if(tex.msSamp > 1)
+  {
+    arrayIdx = sliceFace * tex.msSamp + RDCMIN(sample, tex.msSamp - 1);
+  }
+
+  GetTextureDataParams params;
+  params.typeHint = typeHint;
+
+  size_t dataSize = 0;
+  sub.readback = driver->GetTextureData(texid, arrayIdx, mip, params, dataSize);
+
+  // some implementations only return the requested slice even for 3D textures
+  if(dataSize < offset + slicePitch)
+    offset = 0;
+
+  if(sub.readback == NULL || dataSize < slicePitch)
+  {
+    RDCERR("Texture data for software statistics is too small: %zu bytes, expected %zu",
+           dataSize, offset + slicePitch);
+    return false;
+  }
+
+  sub.data = sub.readback + offset;
+
+  return true;
+}
+
+static void RunStatsJobs(const Subresource &sub, const HistogramParams *histogram,
+                         std::vector<StatsJob> &jobs)
+{
+  uint32_t numThreads = 1;
+
+  if(uint64_t(sub.width) * sub.height >= parallelTexelThreshold)
+    numThreads = RDCMIN(RDCMIN(Threading::NumberOfCores(), maxThreads),
+                        RDCMAX(1U, sub.height / minRowsPerThread));
+
+  jobs.resize(numThreads);
+
+  for(uint32_t i = 0; i < numThreads; i++)
+  {
+    StatsJob &job = jobs[i];
+    job.format = &sub.format;
+    job.data = sub.data;
+    job.rowPitch = sub.rowPitch;
+    job.width = sub.width;
+    job.rowBegin = uint32_t(uint64_t(sub.height) * i / numThreads);
+    job.rowEnd = uint32_t(uint64_t(sub.height) * (i + 1) / numThreads);
+    job.histogram = histogram;
+  }
+
+  std::vector<Threading::ThreadHandle> threads(numThreads);
+
+  // the first rows are done on this thread
+  for(uint32_t i = 1; i < numThreads; i++)
+    threads[i] = Threading::CreateThread(&StatsJobThread, &jobs[i]);
+
+  StatsJobThread(&jobs[0]);
+
+  for(uint32_t i = 1; i < numThreads; i++)
+  {
+    Threading::JoinThread(threads[i]);
+    Threading::CloseThread(threads[i]);
+  }
+}
+
+bool GetSoftwareMinMax(IRemoteDriver *driver, ResourceId texid, uint32_t sliceFace, uint32_t mip,
+                       uint32_t sample, CompType typeHint, float *minval, float *maxval)
+{
+  PerformanceTimer timer;
+
+  Subresource sub;
+  if(!FetchSubresource(driver, texid, sliceFace, mip, sample, typeHint, sub))
+    return false;
+
+  double readbackTime = timer.GetMilliseconds();
+
+  std::vector<StatsJob> jobs;
+  RunStatsJobs(sub, NULL, jobs);
+
+  for(int c = 0; c < 4; c++)
+  {
+    minval[c] = jobs[0].minval[c];
+    maxval[c] = jobs[0].maxval[c];
+
+    for(size_t i = 1; i < jobs.size(); i++)
+    {
+      minval[c] = RDCMIN(minval[c], jobs[i].minval[c]);
+      maxval[c] = RDCMAX(maxval[c], jobs[i].maxval[c]);
+    }
+
+    // every value in this channel was NaN
+    if(minval[c] > maxval[c])
+      minval[c] = maxval[c] = 0.0f;
+  }
+
+  RDCDEBUG("Software min/max of %ux%u texels on %zu threads: %.2f ms readback, %.2f ms processing",
+           sub.width, sub.height, jobs.size(), readbackTime, timer.GetMilliseconds() - readbackTime);
+
+  return true;
+}
+
+bool GetSoftwareHistogram(IRemoteDriver *driver, ResourceId texid, uint32_t sliceFace,
+                          uint32_t mip, uint32_t sample, CompType typeHint, float minval,
+                          float maxval, bool channels[4], std::vector<uint32_t> &histogram)
+{
+  if(minval >= maxval)
+    return false;
+
+  HistogramParams params;
+  params.divisor = 0.0f;
+  params.minval = minval;
+  params.range = maxval - minval;
+
+  for(int c = 0; c < 4; c++)
+  {
+    params.channels[c] = channels[c];
+    if(channels[c])
+      params.divisor += 1.0f;
+  }
+
+  histogram.assign(histogramBuckets, 0);
+
+  // with no channels selected nothing is counted
+  if(params.divisor == 0.0f)
+    return true;
+
+  PerformanceTimer timer;
+
+  Subresource sub;
+  if(!FetchSubresource(driver, texid, sliceFace, mip, sample, typeHint, sub))
+    return false;
+
+  double readbackTime = timer.GetMilliseconds();
+
+  std::vector<StatsJob> jobs;
+  RunStatsJobs(sub, &params, jobs);
+
+  for(size_t i = 0; i < jobs.size(); i++)
+    for(uint32_t b = 0; b < histogramBuckets; b++)
+      histogram[b] += jobs[i].buckets[b];
+
+  RDCDEBUG("Software histogram of %ux%u texels on %zu threads: %.2f ms readback, %.2f ms processing",
+           sub.width, sub.height, jobs.size(), readbackTime, timer.GetMilliseconds() - readbackTime);
+
+  return true;
+}
+
+void ValidateMinMax(IRemoteDriver *driver, ResourceId texid, uint32_t sliceFace, uint32_t mip,
+                    uint32_t sample, CompType typeHint, const float *minval, const float *maxval)
+{
+  float refMin[4], refMax[4];
+  if(!GetSoftwareMinMax(driver, texid, sliceFace, mip, sample, typeHint, refMin, refMax))
+    return;
+
+  for(int c = 0; c < 4; c++)
+  {
+    float minTolerance = RDCMAX(1.0f, fabsf(refMin[c])) * 1.0e-5f;
+    float maxTolerance = RDCMAX(1.0f, fabsf(refMax[c])) * 1.0e-5f;
+
+    if(fabsf(minval[c] - refMin[c]) > minTolerance || fabsf(maxval[c] - refMax[c]) > maxTolerance)
+      RDCWARN("Min/max mismatch on %llu channel %d: GPU [%f, %f] software [%f, %f]", texid, c,
+              minval[c], maxval[c], refMin[c], refMax[c]);
+  }
+}
+
+void ValidateHistogram(IRemoteDriver *driver, ResourceId texid, uint32_t sliceFace, uint32_t mip,
+                       uint32_t sample, CompType typeHint, float minval, float maxval,
+                       bool channels[4], const std::vector<uint32_t> &histogram)
+{
+  std::vector<uint32_t> ref;
+  if(!GetSoftwareHistogram(driver, texid, sliceFace, mip, sample, typeHint, minval, maxval,
+                           channels, ref))
+    return;
+
+  if(histogram.size() != ref.size())
+  {
+    RDCWARN("Histogram mismatch on %llu: GPU has %zu buckets, software has %zu", texid,
+            histogram.size(), ref.size());
+    return;
+  }
+
+  // values right on a bucket boundary can land either side depending on rounding, so only
+  // differences in the total count are worth flagging loudly
+  uint64_t gpuTotal = 0, refTotal = 0, moved = 0;
+  for(size_t b = 0; b < ref.size(); b++)
+  {
+    gpuTotal += histogram[b];
+    refTotal += ref[b];
+    moved += histogram[b] > ref[b] ? histogram[b] - ref[b] : ref[b] - histogram[b];
+  }
+
+  if(gpuTotal != refTotal)
+    RDCWARN("Histogram mismatch on %llu: GPU counted %llu texels, software %llu", texid, gpuTotal,
+            refTotal);
+  else if(moved > 0)
+    RDCLOG("Histogram on %llu has %llu texels in different buckets to the software version", texid,
+           moved / 2);
+}
@@ -0,0 +1,50 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2017 Baldur Karlsson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+
+#pragma once
+
+#include <vector>
+#include "replay_driver.h"
+
+// Software implementations of IReplayDriver::GetMinMax and GetHistogram. The subresource is read
+// back with GetTextureData() and decoded and processed on the CPU, split by rows across several
+// threads for large textures. Results follow the GPU implementations, so these can be used where
+// the compute shaders those need aren't available, or as a reference to check them against.
+//
+// Formats that can't be decoded on the CPU, such as block compressed and YUV formats, return
+// false.
+bool GetSoftwareMinMax(IRemoteDriver *driver, ResourceId texid, uint32_t sliceFace, uint32_t mip,
+                       uint32_t sample, CompType typeHint, float *minval, float *maxval);
+bool GetSoftwareHistogram(IRemoteDriver *driver, ResourceId texid, uint32_t sliceFace,
+                          uint32_t mip, uint32_t sample, CompType typeHint, float minval,
+                          float maxval, bool channels[4], std::vector<uint32_t> &histogram);
+
+// recompute results that came from the GPU in software, and log any differences. See
+// VALIDATE_TEXTURE_STATS
+void ValidateMinMax(IRemoteDriver *driver, ResourceId texid, uint32_t sliceFace, uint32_t mip,
+                    uint32_t sample, CompType typeHint, const float *minval, const float *maxval);
+void ValidateHistogram(IRemoteDriver *driver, ResourceId texid, uint32_t sliceFace, uint32_t mip,
+                       uint32_t sample, CompType typeHint, float minval, float maxval,
+                       bool channels[4], const std::vector<uint32_t> &histogram);
@@ -0,0 +1,178 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015-2017 Baldur Karlsson
+ * Copyright (c) 2014 Crytek
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+#include "callstack_trie.h"
+
+CallstackTrie::CallstackTrie()
+{
+  Node root = {0, 0};
+  m_Nodes.push_back(root);
+}
+
+bool CallstackTrie::Matches(uint32_t stack, const uint64_t *addrs, size_t numLevels) const
+{
+  for(size_t i = 0; i < numLevels; i++)
+  {
+    if(stack == 0 || m_Nodes[stack].address != addrs[i])
+      return false;
+
+    stack = m_Nodes[stack].parent;
+  }
+
+  // the stack must end exactly at the root, not just start with the same frames
+  return stack == 0;
+}
+
+uint32_t CallstackTrie::Add(const uint64_t *addrs, size_t numLevels)
+{
+  if(numLevels == 0)
+    return 0;
+
+  // FNV-1a over the addresses
+  uint64_t hash = 14695981039346656037ULL;
+  for(size_t i = 0; i < numLevels; i++)
+    hash = (hash ^ addrs[i]) * 1099511628211ULL;
+
+  SCOPED_LOCK(m_Lock);
+
+  auto it = m_Stacks.find(hash);
+  if(it != m_Stacks.end() && Matches(it->second, addrs, numLevels))
+    return it->second;
+
+  // walk in from the outermost frame, adding nodes once we reach frames not seen before
+  uint32_t node = 0;
+  for(size_t i = numLevels; i > 0; i--)
+  {
+    Edge edge = {addrs[i - 1], node, 0};
+
+    uint32_t &child = m_Children[edge];
+    if(child == 0)
+    {
+      child = (uint32_t)m_Nodes.size();
+
+      Node n = {edge.address, node};
+      m_Nodes.push_back(n);
+    }
+
+    node = child;
+  }
+
+  m_Stacks[hash] = node;
+
+  return node;
+}
+
+size_t CallstackTrie::Get(uint32_t stack, uint64_t *addrs, size_t maxLevels) const
+{
+  if(stack >= m_Nodes.size())
+    return 0;
+
+  size_t numLevels = 0;
+  while(stack != 0 && numLevels < maxLevels)
+  {
+    addrs[numLevels++] = m_Nodes[stack].address;
+    stack = m_Nodes[stack].parent;
+  }
+
+  return numLevels;
+}
+
+uint32_t CallstackTrie::CopyTo(uint32_t stack, CallstackTrie &dst)
+{
+  uint64_t addrs[256];
+  size_t numLevels = 0;
+
+  {
+    SCOPED_LOCK(m_Lock);
+    numLevels = Get(stack, addrs, ARRAY_COUNT(addrs));
+  }
+
+  return dst.Add(addrs, numLevels);
+}
+
+// the packed form is a node count, followed by every node's address then every node's parent. The
+// root is implicit.
+void CallstackTrie::Save(std::vector<byte> &data)
+{
+  SCOPED_LOCK(m_Lock);
+
+  uint32_t numNodes = uint32_t(m_Nodes.size() - 1);
+
+  data.resize(sizeof(uint32_t) + numNodes * (sizeof(uint64_t) + sizeof(uint32_t)));
+
+  byte *dst = &data[0];
+
+  memcpy(dst, &numNodes, sizeof(numNodes));
+  dst += sizeof(numNodes);
+
+  for(size_t i = 1; i < m_Nodes.size(); i++)
+  {
+    memcpy(dst, &m_Nodes[i].address, sizeof(uint64_t));
+    dst += sizeof(uint64_t);
+  }
+
+  for(size_t i = 1; i < m_Nodes.size(); i++)
+  {
+    memcpy(dst, &m_Nodes[i].parent, sizeof(uint32_t));
+    dst += sizeof(uint32_t);
+  }
+}
+
+bool CallstackTrie::Load(const byte *data, size_t size)
+{
+  m_Nodes.resize(1);
+  m_Children.clear();
+  m_Stacks.clear();
+
+  uint32_t numNodes = 0;
+  if(size < sizeof(numNodes))
+    return false;
+
+  memcpy(&numNodes, data, sizeof(numNodes));
+  data += sizeof(numNodes);
+
+  if(size != sizeof(numNodes) + uint64_t(numNodes) * (sizeof(uint64_t) + sizeof(uint32_t)))
+    return false;
+
+  m_Nodes.resize(numNodes + 1);
+
+  const byte *parents = data + numNodes * sizeof(uint64_t);
+
+  for(uint32_t i = 1; i <= numNodes; i++)
+  {
+    memcpy(&m_Nodes[i].address, data + (i - 1) * sizeof(uint64_t), sizeof(uint64_t));
+    memcpy(&m_Nodes[i].parent, parents + (i - 1) * sizeof(uint32_t), sizeof(uint32_t));
+
+    // parents are always added before their children, which also guarantees every walk towards
+    // the root terminates
+    if(m_Nodes[i].parent >= i)
+    {
+      m_Nodes.resize(1);
+      return false;
+    }
+  }
+
+  return true;
+}
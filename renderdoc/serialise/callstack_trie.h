@@ -0,0 +1,86 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015-2017 Baldur Karlsson
+ * Copyright (c) 2014 Crytek
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+#include "common/flat_hash_map.h"
+#include "common/threading.h"
+
+// Stores callstacks as paths through a prefix tree rooted at the outermost frame, so stacks that
+// share their outer frames share storage and each stack is identified by the index of its
+// innermost node. Index 0 is the root, i.e. the empty callstack.
+class CallstackTrie
+{
+public:
+  CallstackTrie();
+
+  // returns the index for this callstack (innermost frame first), adding it if it's new. Safe to
+  // call from several threads at once.
+  uint32_t Add(const uint64_t *addrs, size_t numLevels);
+
+  // expands a stack index back into addresses, innermost frame first, and returns how many levels
+  // were written. Unknown indices are treated as the empty callstack. Not safe to call while
+  // another thread is adding.
+  size_t Get(uint32_t stack, uint64_t *addrs, size_t maxLevels) const;
+
+  // adds a stack from this tree to dst and returns its index there. Unlike Get() this is safe to
+  // call while other threads are adding to this tree.
+  uint32_t CopyTo(uint32_t stack, CallstackTrie &dst);
+
+  bool Empty() const { return m_Nodes.size() <= 1; }
+
+  // packs the tree for writing into a capture, and reads it back
+  void Save(std::vector<byte> &data);
+  bool Load(const byte *data, size_t size);
+
+private:
+  struct Node
+  {
+    uint64_t address;
+    uint32_t parent;
+  };
+
+  struct Edge
+  {
+    uint64_t address;
+    uint32_t parent;
+    uint32_t padding;    // always 0, so keys hash consistently
+
+    bool operator==(const Edge &o) const { return address == o.address && parent == o.parent; }
+  };
+
+  bool Matches(uint32_t stack, const uint64_t *addrs, size_t numLevels) const;
+
+  std::vector<Node> m_Nodes;
+  FlatHashMap<Edge, uint32_t> m_Children;
+
+  // most API calls are made from a handful of call sites, so remember whole stacks by their hash
+  // and skip walking down the tree for stacks that have been seen before
+  FlatHashMap<uint64_t, uint32_t> m_Stacks;
+
+  Threading::CriticalSection m_Lock;
+};
@@ -24,8 +24,11 @@
  ******************************************************************************/
 
 #include "serialiser.h"
+#include <algorithm>
+#include <deque>
 #include <errno.h>
 #include "3rdparty/lz4/lz4.h"
+#include "3rdparty/zstd/zstd.h"
 #include "common/timing.h"
 #include "core/core.h"
 #include "serialise/string_utils.h"
@@ -36,10 +39,11 @@
 #pragma warning(disable : 4422)
 #endif
 
-#if ENABLED(RDOC_DEVEL)
-
 int64_t Chunk::m_LiveChunks = 0;
 int64_t Chunk::m_TotalMem = 0;
+
+#if ENABLED(RDOC_DEVEL)
+
 int64_t Chunk::m_MaxChunks = 0;
 
 #endif
@@ -47,6 +51,15 @@ int64_t Chunk::m_MaxChunks = 0;
 const uint32_t Serialiser::MAGIC_HEADER = MAKE_FOURCC('R', 'D', 'O', 'C');
 const uint64_t Serialiser::BufferAlignment = 64;
 
+// callstacks collected while capturing, referenced from chunks by index. Chunks for resources can
+// be recorded long before the frame they end up in, so this is kept for the life of the process.
+// Each capture only stores the stacks its own chunks use, see CaptureFileWriter::RemapCallstack.
+static CallstackTrie &CapturedCallstacks()
+{
+  static CallstackTrie trie;
+  return trie;
+}
+
 // based on blockStreaming_doubleBuffer.c in lz4 examples
 struct CompressedFileIO
 {
@@ -194,48 +207,820 @@ struct CompressedFileIO
       RDCERR("Error decompressing: %i (%i / %i)", decompSize, int(numRead), compSize);
       return;
     }
-
-    m_PageOffset = 0;
-    m_PageData = decompSize;
+
+    m_PageOffset = 0;
+    m_PageData = decompSize;
+  }
+
+  static void Decompress(byte *destBuf, const byte *srcBuf, size_t len)
+  {
+    LZ4_streamDecode_t lz4;
+    LZ4_setStreamDecode(&lz4, NULL, 0);
+
+    const byte *srcBufEnd = srcBuf + len;
+
+    while(srcBuf + 4 < srcBufEnd)
+    {
+      const int32_t *compSize = (const int32_t *)srcBuf;
+      srcBuf = (const byte *)(compSize + 1);
+
+      if(srcBuf + *compSize > srcBufEnd)
+        break;
+
+      int32_t decompSize = LZ4_decompress_safe_continue(&lz4, (const char *)srcBuf, (char *)destBuf,
+                                                        *compSize, BlockSize);
+
+      if(decompSize < 0)
+        return;
+
+      srcBuf += *compSize;
+      destBuf += decompSize;
+    }
+  }
+
+  LZ4_stream_t m_LZ4Comp;
+  LZ4_streamDecode_t m_LZ4Decomp;
+  FILE *m_F;
+  uint32_t m_CompressedSize, m_UncompressedSize;
+
+  byte m_InPages[2][BlockSize];
+  size_t m_PageIdx, m_PageOffset, m_PageData;
+
+  byte *m_CompressBuf;
+  size_t m_CompressSize;
+};
+
+// sections stored in the indexed block layout below, with either codec
+static const uint32_t BlockCompressedFlags =
+    Serialiser::eSectionFlag_LZ4Blocks | Serialiser::eSectionFlag_ZstdCompressed;
+
+// Compression where every block is compressed independently with either LZ4 or zstd (chosen by
+// the section flag), followed by an index of where each block starts. All blocks except the last
+// decompress to exactly BlockSize bytes, so any uncompressed offset can be located without
+// decoding from the start, and runs of blocks can be compressed or decompressed in parallel.
+struct BlockCompressedFileIO
+{
+  // larger than the LZ4 window, so that restarting the dictionary each block costs little
+  static const size_t BlockSize = 1024 * 1024;
+
+  // only split decompression across threads when there are enough blocks to make it worthwhile,
+  // and cap how many are read at once so we don't hold too much compressed data in memory
+  static const size_t ParallelMinBlocks = 8;
+  static const size_t ParallelMaxBlocks = 256;
+
+  // how many blocks are batched up to compress in parallel when writing, at most
+  static const size_t MaxWriteBatch = 16;
+
+  // codec is the section flag (eSectionFlag_LZ4Blocks or eSectionFlag_ZstdCompressed). level is
+  // only used when writing zstd, where 0 selects zstd's default level
+  BlockCompressedFileIO(FILE *f, uint32_t codec, int level = 0)
+  {
+    m_F = f;
+    m_Codec = codec;
+    m_Level = RDCMIN(level, ZSTD_maxCLevel());
+    m_CompressedSize = 0;
+    m_UncompressedSize = 0;
+    m_TotalSize = 0;
+    m_DataOffset = 0;
+    m_BlockIdx = 0;
+    m_PageOffset = m_PageData = 0;
+
+    m_Page = NULL;
+    m_PageSize = 0;
+
+    m_CompressSize = RDCMAX((size_t)LZ4_COMPRESSBOUND(BlockSize), ZSTD_COMPRESSBOUND(BlockSize));
+    m_CompressBuf = NULL;
+  }
+
+  ~BlockCompressedFileIO()
+  {
+    SAFE_DELETE_ARRAY(m_Page);
+    SAFE_DELETE_ARRAY(m_CompressBuf);
+  }
+
+  uint64_t GetCompressedSize() { return m_CompressedSize; }
+  uint64_t GetUncompressedSize() { return m_UncompressedSize; }
+  // write out some data - accumulate into a batch of pages, then when it's full call Flush() to
+  // compress them and write them to disk
+  void Write(const void *data, size_t len)
+  {
+    if(data == NULL || len == 0)
+      return;
+
+    // the batch is sized to the number of cores so every page in it compresses at once
+    if(m_Page == NULL)
+      AllocBuffers(RDCMAX(1U, RDCMIN((uint32_t)MaxWriteBatch, Threading::NumberOfCores())));
+
+    m_UncompressedSize += len;
+
+    const byte *src = (const byte *)data;
+
+    while(len > 0)
+    {
+      size_t copy = RDCMIN(len, m_PageSize - m_PageOffset);
+
+      memcpy(m_Page + m_PageOffset, src, copy);
+      m_PageOffset += copy;
+
+      src += copy;
+      len -= copy;
+
+      if(m_PageOffset == m_PageSize)
+        Flush();
+    }
+  }
+
+  // compress and write out the current batch as blocks. Only the final block may be partial
+  void Flush()
+  {
+    if(m_PageOffset == 0)
+      return;
+
+    size_t numBlocks = NumBlocksFor(m_PageOffset);
+
+    vector<CompressJob> jobs(numBlocks);
+
+    for(size_t i = 0; i < numBlocks; i++)
+    {
+      jobs[i].codec = m_Codec;
+      jobs[i].level = m_Level;
+      jobs[i].src = m_Page + i * BlockSize;
+      jobs[i].srcSize = RDCMIN((size_t)BlockSize, m_PageOffset - i * BlockSize);
+      jobs[i].dst = m_CompressBuf + i * m_CompressSize;
+      jobs[i].dstSize = m_CompressSize;
+      jobs[i].compSize = 0;
+    }
+
+    RunJobs(&CompressThread, jobs);
+
+    // the blocks must land on disk in order, regardless of which finished first
+    for(size_t i = 0; i < numBlocks; i++)
+    {
+      int32_t compSize = jobs[i].compSize;
+
+      if(compSize <= 0)
+      {
+        RDCERR("Error compressing: %i", compSize);
+        return;
+      }
+
+      m_BlockOffsets.push_back(m_CompressedSize);
+
+      FileIO::fwrite(&compSize, sizeof(compSize), 1, m_F);
+      FileIO::fwrite(jobs[i].dst, 1, compSize, m_F);
+
+      m_CompressedSize += compSize + sizeof(int32_t);
+    }
+
+    m_PageOffset = 0;
+  }
+
+  // write the block index after the last block. Must be called after the final Flush()
+  void WriteIndex()
+  {
+    uint32_t numBlocks = (uint32_t)m_BlockOffsets.size();
+
+    if(numBlocks > 0)
+      FileIO::fwrite(&m_BlockOffsets[0], sizeof(uint64_t), numBlocks, m_F);
+    FileIO::fwrite(&numBlocks, sizeof(numBlocks), 1, m_F);
+
+    m_CompressedSize += numBlocks * sizeof(uint64_t) + sizeof(uint32_t);
+  }
+
+  // read the block index from the end of the section, where dataOffset is the file offset of
+  // the first block and sectionLength covers the blocks and the index. Leaves the file position
+  // where it was.
+  bool ReadIndex(uint64_t dataOffset, uint64_t sectionLength, uint64_t uncompressedSize)
+  {
+    m_DataOffset = dataOffset;
+    m_TotalSize = uncompressedSize;
+
+    if(sectionLength < sizeof(uint32_t))
+      return false;
+
+    if(m_Page == NULL)
+      AllocBuffers(1);
+
+    uint64_t prevOffs = FileIO::ftell64(m_F);
+
+    uint32_t numBlocks = 0;
+    FileIO::fseek64(m_F, dataOffset + sectionLength - sizeof(uint32_t), SEEK_SET);
+    FileIO::fread(&numBlocks, sizeof(numBlocks), 1, m_F);
+
+    uint64_t indexSize = numBlocks * sizeof(uint64_t) + sizeof(uint32_t);
+
+    bool ret = (indexSize <= sectionLength && numBlocks == NumBlocksFor(uncompressedSize));
+
+    if(ret)
+    {
+      m_BlockOffsets.resize(numBlocks);
+
+      FileIO::fseek64(m_F, dataOffset + sectionLength - indexSize, SEEK_SET);
+      if(numBlocks > 0)
+        FileIO::fread(&m_BlockOffsets[0], sizeof(uint64_t), numBlocks, m_F);
+
+      // add a sentinel for the end of the last block, so every block's extent is known
+      m_BlockOffsets.push_back(sectionLength - indexSize);
+    }
+
+    FileIO::fseek64(m_F, prevOffs, SEEK_SET);
+
+    return ret;
+  }
+
+  // position the reader at the given uncompressed offset, decoding only the block containing it
+  void Seek(uint64_t offset)
+  {
+    m_UncompressedSize = offset;
+    m_BlockIdx = size_t(offset / BlockSize);
+    m_PageOffset = m_PageData = 0;
+
+    if(m_BlockIdx >= NumBlocks())
+      return;
+
+    FileIO::fseek64(m_F, m_DataOffset + m_BlockOffsets[m_BlockIdx], SEEK_SET);
+
+    size_t skip = size_t(offset % BlockSize);
+
+    if(skip > 0)
+    {
+      FillBuffer();
+
+      skip = RDCMIN(skip, m_PageData);
+      m_PageOffset += skip;
+      m_PageData -= skip;
+    }
+  }
+
+  // read out some data. Whole blocks are decompressed straight into the destination, and
+  // anything else goes through the page one block at a time
+  void Read(byte *data, size_t len)
+  {
+    if(data == NULL || len == 0)
+      return;
+
+    while(len > 0)
+    {
+      if(m_PageData > 0)
+      {
+        size_t readamount = RDCMIN(len, m_PageData);
+
+        memcpy(data, m_Page + m_PageOffset, readamount);
+
+        m_PageOffset += readamount;
+        m_PageData -= readamount;
+        m_UncompressedSize += readamount;
+
+        data += readamount;
+        len -= readamount;
+
+        continue;
+      }
+
+      if(m_BlockIdx >= NumBlocks())
+      {
+        RDCERR("Reading %llu bytes past the end of compressed data", (uint64_t)len);
+        return;
+      }
+
+      // count how many whole blocks from here fit in the read
+      size_t numBlocks = 0;
+      while(numBlocks < ParallelMaxBlocks && m_BlockIdx + numBlocks < NumBlocks() &&
+            BlockEnd(m_BlockIdx + numBlocks) <= m_UncompressedSize + len)
+        numBlocks++;
+
+      if(numBlocks >= ParallelMinBlocks)
+      {
+        size_t readamount = ReadBlocks(data, numBlocks);
+
+        if(readamount == 0)
+          return;
+
+        m_UncompressedSize += readamount;
+
+        data += readamount;
+        len -= readamount;
+      }
+      else
+      {
+        FillBuffer();
+      }
+    }
+  }
+
+  // decompress a whole section written by this class from memory
+  static bool DecompressSection(uint32_t codec, byte *destBuf, uint64_t destSize,
+                                const byte *srcBuf, uint64_t srcLength)
+  {
+    if(srcLength < sizeof(uint32_t))
+      return false;
+
+    uint32_t numBlocks = 0;
+    memcpy(&numBlocks, srcBuf + srcLength - sizeof(uint32_t), sizeof(numBlocks));
+
+    uint64_t indexSize = numBlocks * sizeof(uint64_t) + sizeof(uint32_t);
+
+    if(indexSize > srcLength || numBlocks != NumBlocksFor(destSize))
+      return false;
+
+    vector<uint64_t> offsets(numBlocks);
+    if(numBlocks > 0)
+      memcpy(&offsets[0], srcBuf + srcLength - indexSize, numBlocks * sizeof(uint64_t));
+    offsets.push_back(srcLength - indexSize);
+
+    return DecompressBlocks(codec, destBuf, destSize, srcBuf, &offsets[0], numBlocks);
+  }
+
+private:
+  struct CompressJob
+  {
+    uint32_t codec;
+    int level;
+    const byte *src;
+    size_t srcSize;
+    byte *dst;
+    size_t dstSize;
+    int32_t compSize;
+  };
+
+  struct DecompressJob
+  {
+    uint32_t codec;
+    byte *destBuf;
+    uint64_t destSize;
+    const byte *srcBuf;
+    const uint64_t *offsets;
+    size_t first, count;
+    bool success;
+  };
+
+  // returns the compressed size, or 0 on failure
+  static int32_t CompressBlock(uint32_t codec, int level, const byte *src, size_t srcSize,
+                               byte *dst, size_t dstSize)
+  {
+    if(codec == Serialiser::eSectionFlag_ZstdCompressed)
+    {
+      size_t ret = ZSTD_compress(dst, dstSize, src, srcSize, level);
+
+      if(ZSTD_isError(ret))
+      {
+        RDCERR("zstd error compressing: %s", ZSTD_getErrorName(ret));
+        return 0;
+      }
+
+      return (int32_t)ret;
+    }
+
+    return LZ4_compress_fast((const char *)src, (char *)dst, (int)srcSize, (int)dstSize, 1);
+  }
+
+  // returns the decompressed size, or -1 on failure
+  static int32_t DecompressBlock(uint32_t codec, const byte *src, int32_t compSize, byte *dst,
+                                 int32_t dstSize)
+  {
+    if(codec == Serialiser::eSectionFlag_ZstdCompressed)
+    {
+      size_t ret = ZSTD_decompress(dst, dstSize, src, compSize);
+
+      if(ZSTD_isError(ret))
+      {
+        RDCERR("zstd error decompressing: %s", ZSTD_getErrorName(ret));
+        return -1;
+      }
+
+      return (int32_t)ret;
+    }
+
+    return LZ4_decompress_safe((const char *)src, (char *)dst, compSize, dstSize);
+  }
+
+  static void CompressThread(void *job)
+  {
+    CompressJob *j = (CompressJob *)job;
+
+    j->compSize = CompressBlock(j->codec, j->level, j->src, j->srcSize, j->dst, j->dstSize);
+  }
+
+  static void DecompressThread(void *job)
+  {
+    DecompressJob *j = (DecompressJob *)job;
+
+    j->success = true;
+
+    for(size_t i = j->first; i < j->first + j->count; i++)
+    {
+      uint64_t blockStart = j->offsets[i];
+      uint64_t blockEnd = j->offsets[i + 1];
+
+      int32_t compSize = 0;
+
+      if(blockEnd < blockStart + sizeof(int32_t))
+      {
+        j->success = false;
+        return;
+      }
+
+      memcpy(&compSize, j->srcBuf + blockStart, sizeof(compSize));
+
+      if(compSize < 0 || blockStart + sizeof(int32_t) + compSize > blockEnd)
+      {
+        j->success = false;
+        return;
+      }
+
+      uint64_t destOffs = uint64_t(i) * BlockSize;
+      int32_t expectedSize = (int32_t)RDCMIN((uint64_t)BlockSize, j->destSize - destOffs);
+
+      int32_t decompSize = DecompressBlock(j->codec, j->srcBuf + blockStart + sizeof(int32_t),
+                                           compSize, j->destBuf + destOffs, expectedSize);
+
+      if(decompSize != expectedSize)
+      {
+        RDCERR("Error decompressing block %llu: %i (expected %i)", (uint64_t)i, decompSize,
+               expectedSize);
+        j->success = false;
+        return;
+      }
+    }
+  }
+
+  // run each job through func, one job per thread. The first job runs on this thread, and any
+  // job we can't start a thread for runs here too
+  template <typename Job>
+  static void RunJobs(void (*func)(void *), vector<Job> &jobs)
+  {
+    vector<Threading::ThreadHandle> threads(jobs.size(), 0);
+
+    for(size_t i = 1; i < jobs.size(); i++)
+      threads[i] = Threading::CreateThread(func, &jobs[i]);
+
+    if(!jobs.empty())
+      func(&jobs[0]);
+
+    for(size_t i = 1; i < jobs.size(); i++)
+    {
+      if(threads[i])
+      {
+        Threading::JoinThread(threads[i]);
+        Threading::CloseThread(threads[i]);
+      }
+      else
+      {
+        func(&jobs[i]);
+      }
+    }
+  }
+
+  // decompress count blocks with offsets relative to srcBuf, where offsets[count] is the end of
+  // the last block. destBuf receives the blocks in order, and destSize is the uncompressed size
+  // of those blocks
+  static bool DecompressBlocks(uint32_t codec, byte *destBuf, uint64_t destSize,
+                               const byte *srcBuf, const uint64_t *offsets, size_t count)
+  {
+    if(count == 0)
+      return true;
+
+    size_t numJobs = RDCMIN((size_t)Threading::NumberOfCores(), count);
+
+    vector<DecompressJob> jobs(numJobs);
+
+    size_t first = 0;
+    for(size_t i = 0; i < numJobs; i++)
+    {
+      jobs[i].codec = codec;
+      jobs[i].destBuf = destBuf;
+      jobs[i].destSize = destSize;
+      jobs[i].srcBuf = srcBuf;
+      jobs[i].offsets = offsets;
+      jobs[i].first = first;
+      jobs[i].count = count / numJobs + (i < count % numJobs ? 1 : 0);
+      jobs[i].success = false;
+
+      first += jobs[i].count;
+    }
+
+    RunJobs(&DecompressThread, jobs);
+
+    bool success = true;
+
+    for(size_t i = 0; i < numJobs; i++)
+      success &= jobs[i].success;
+
+    return success;
+  }
+
+  static size_t NumBlocksFor(uint64_t size) { return size_t((size + BlockSize - 1) / BlockSize); }
+  size_t NumBlocks() { return m_BlockOffsets.empty() ? 0 : m_BlockOffsets.size() - 1; }
+  uint64_t BlockEnd(size_t block) { return RDCMIN(uint64_t(block + 1) * BlockSize, m_TotalSize); }
+  // allocate room for numBlocks pages, and a compressed buffer for each of them
+  void AllocBuffers(size_t numBlocks)
+  {
+    m_PageSize = numBlocks * BlockSize;
+    m_Page = new byte[m_PageSize];
+    m_CompressBuf = new byte[numBlocks * m_CompressSize];
+  }
+
+  // read the next block from disk and decompress it into the page
+  void FillBuffer()
+  {
+    int32_t compSize = 0;
+
+    FileIO::fread(&compSize, sizeof(compSize), 1, m_F);
+
+    if(compSize < 0 || (size_t)compSize > m_CompressSize)
+    {
+      RDCERR("Invalid compressed block size %i", compSize);
+      m_BlockIdx = NumBlocks();
+      return;
+    }
+
+    size_t numRead = FileIO::fread(m_CompressBuf, 1, compSize, m_F);
+
+    int32_t expectedSize = int32_t(BlockEnd(m_BlockIdx) - uint64_t(m_BlockIdx) * BlockSize);
+
+    int32_t decompSize = DecompressBlock(m_Codec, m_CompressBuf, compSize, m_Page, expectedSize);
+
+    m_BlockIdx++;
+
+    if(decompSize != expectedSize)
+    {
+      RDCERR("Error decompressing: %i (%i / %i)", decompSize, int(numRead), compSize);
+      m_BlockIdx = NumBlocks();
+      return;
+    }
+
+    m_PageOffset = 0;
+    m_PageData = decompSize;
+  }
+
+  // read and decompress numBlocks whole blocks starting at the current block into data.
+  // Returns the number of uncompressed bytes written
+  size_t ReadBlocks(byte *data, size_t numBlocks)
+  {
+    uint64_t compStart = m_BlockOffsets[m_BlockIdx];
+    uint64_t compEnd = m_BlockOffsets[m_BlockIdx + numBlocks];
+
+    vector<byte> compressed((size_t)(compEnd - compStart));
+    FileIO::fread(&compressed[0], 1, compressed.size(), m_F);
+
+    // rebase the offsets to the start of what we just read
+    vector<uint64_t> offsets(numBlocks + 1);
+    for(size_t i = 0; i <= numBlocks; i++)
+      offsets[i] = m_BlockOffsets[m_BlockIdx + i] - compStart;
+
+    uint64_t uncompSize = BlockEnd(m_BlockIdx + numBlocks - 1) - uint64_t(m_BlockIdx) * BlockSize;
+
+    if(!DecompressBlocks(m_Codec, data, uncompSize, &compressed[0], &offsets[0], numBlocks))
+    {
+      m_BlockIdx = NumBlocks();
+      return 0;
+    }
+
+    m_BlockIdx += numBlocks;
+
+    return (size_t)uncompSize;
+  }
+
+  FILE *m_F;
+  uint64_t m_CompressedSize;
+
+  // section flag selecting LZ4 or zstd, and the zstd level when writing
+  uint32_t m_Codec;
+  int m_Level;
+
+  // when writing this is the total written, when reading it's the current read position
+  uint64_t m_UncompressedSize;
+
+  // total uncompressed size of the section when reading
+  uint64_t m_TotalSize;
+
+  // file offset of the first block, and each block's offset from there
+  uint64_t m_DataOffset;
+  vector<uint64_t> m_BlockOffsets;
+
+  // when reading, the index of the next block to be read from disk
+  size_t m_BlockIdx;
+
+  // when writing this holds a batch of blocks, when reading just the current block
+  byte *m_Page;
+  size_t m_PageSize;
+  size_t m_PageOffset, m_PageData;
+
+  // one compressed buffer per block in the page, each m_CompressSize bytes
+  byte *m_CompressBuf;
+  size_t m_CompressSize;
+};
+
+// state for writing the frame capture section to disk, either all at once in FlushToDisk() or a
+// chunk at a time from a background thread after StartAsyncWrite()
+struct CaptureFileWriter
+{
+  // when writing in the background, inserting stalls once this much chunk data is waiting to be
+  // written, so memory use stays bounded if the app produces chunks faster than we write them
+  static const uint64_t MaxQueuedBytes = 256 * 1024 * 1024;
+
+  CaptureFileWriter(FILE *f, uint32_t codec, int level)
+      : file(f),
+        compressor(f, codec, level),
+        compressedSizeOffset(0),
+        uncompressedSizeOffset(0),
+        offs(0),
+        thread(0),
+        queuedBytes(0),
+        finished(false)
+  {
+  }
+
+  FILE *file;
+  BlockCompressedFileIO compressor;
+
+  // where the section's sizes need to be fixed up once everything is written
+  uint64_t compressedSizeOffset;
+  uint64_t uncompressedSizeOffset;
+
+  // track offset so we can add padding. The padding is relative
+  // to the start of the decompressed buffer, so we start it from 0
+  uint64_t offs;
+
+  vector<Serialiser::ChunkIndexEntry> chunkIndex;
+
+  // the stacks referenced by the chunks written so far, renumbered into a trie that's saved with
+  // the capture, and each process-wide index's number in it
+  CallstackTrie callstacks;
+  FlatHashMap<uint32_t, uint32_t> callstackRemap;
+
+  uint32_t RemapCallstack(uint32_t stack)
+  {
+    uint32_t &remapped = callstackRemap[stack];
+    if(remapped == 0)
+      remapped = CapturedCallstacks().CopyTo(stack, callstacks);
+    return remapped;
+  }
+
+  // an entry in the background queue, either a chunk ready to write or one still to be created
+  struct QueuedChunk
+  {
+    Chunk *chunk;
+    DeferredChunk *deferred;
+  };
+
+  // background writing. The queue owns its chunks, and finished is set once no more are coming
+  Threading::ThreadHandle thread;
+  Threading::CriticalSection lock;
+  std::deque<QueuedChunk> queue;
+  uint64_t queuedBytes;
+  bool finished;
+};
+
+// a block of memory that chunk data is bump-allocated from while capturing a frame. Each chunk
+// allocated from the page holds a reference, as does the serialiser currently allocating from it.
+// Chunks recorded during a frame are all deleted together once the capture is written, so their
+// pages are released together rather than freeing each chunk's data individually.
+struct ChunkPage
+{
+  static const size_t Size = 256 * 1024;
+
+  // larger chunks are allocated from the heap, so a single big chunk doesn't leave most of a page
+  // unusable. The memcpy of their contents costs far more than the allocation anyway
+  static const size_t MaxAlloc = 16 * 1024;
+
+  // released pages are kept up to this limit for reuse by the next allocation or frame
+  static const size_t MaxFreePages = 64;
+
+  volatile int32_t refs;
+  size_t used;
+  byte *data;
+};
+
+static volatile int32_t ArenaFrames = 0;
+static volatile int64_t ArenaPageMem = 0;
+
+static Threading::CriticalSection FreePagesLock;
+static vector<ChunkPage *> FreePages;
+
+// Chunk::Duplicate() has no serialiser to allocate from, so duplicates share a page
+static Threading::CriticalSection DuplicatePageLock;
+static ChunkPage *DuplicatePage = NULL;
+
+static ChunkPage *AcquireChunkPage()
+{
+  ChunkPage *page = NULL;
+
+  {
+    SCOPED_LOCK(FreePagesLock);
+    if(!FreePages.empty())
+    {
+      page = FreePages.back();
+      FreePages.pop_back();
+    }
+  }
+
+  if(page == NULL)
+  {
+    page = new ChunkPage;
+    page->data = Serialiser::AllocAlignedBuffer(ChunkPage::Size);
+    Atomic::ExchAdd64(&ArenaPageMem, ChunkPage::Size);
+  }
+
+  page->refs = 1;
+  page->used = 0;
+
+  return page;
+}
+
+static void ReleaseChunkPage(ChunkPage *page)
+{
+  if(page == NULL || Atomic::Dec32(&page->refs) > 0)
+    return;
+
+  {
+    SCOPED_LOCK(FreePagesLock);
+    if(FreePages.size() < ChunkPage::MaxFreePages)
+    {
+      FreePages.push_back(page);
+      return;
+    }
+  }
+
+  Serialiser::FreeAlignedBuffer(page->data);
+  delete page;
+  Atomic::ExchAdd64(&ArenaPageMem, -int64_t(ChunkPage::Size));
+}
+
+// allocates from the page in current, replacing it with a new page if it's full. Returns NULL if
+// the allocation should come from the heap instead
+static byte *AllocChunkData(ChunkPage *&current, size_t length, size_t align, ChunkPage *&page)
+{
+  if(length > ChunkPage::MaxAlloc)
+    return NULL;
+
+  size_t offs = current ? AlignUp(current->used, align) : 0;
+
+  if(current == NULL || offs + length > ChunkPage::Size)
+  {
+    // only we can add references to our current page, so if we hold the only one every chunk in
+    // it has been deleted and we can start again from the beginning
+    if(current && current->refs == 1)
+    {
+      offs = 0;
+    }
+    else
+    {
+      ReleaseChunkPage(current);
+      current = AcquireChunkPage();
+      offs = 0;
+    }
   }
 
-  static void Decompress(byte *destBuf, const byte *srcBuf, size_t len)
-  {
-    LZ4_streamDecode_t lz4;
-    LZ4_setStreamDecode(&lz4, NULL, 0);
+  current->used = offs + length;
+  Atomic::Inc32(&current->refs);
 
-    const byte *srcBufEnd = srcBuf + len;
+  page = current;
+  return current->data + offs;
+}
 
-    while(srcBuf + 4 < srcBufEnd)
-    {
-      const int32_t *compSize = (const int32_t *)srcBuf;
-      srcBuf = (const byte *)(compSize + 1);
+// chunk data allocated from the heap is preceded by its reference count. Padded so the data keeps
+// the buffer's alignment
+static const size_t HeapChunkHeader = 64;
 
-      if(srcBuf + *compSize > srcBufEnd)
-        break;
+static byte *AllocHeapChunkData(size_t length)
+{
+  byte *alloc = Serialiser::AllocAlignedBuffer(HeapChunkHeader + length);
+  *(volatile int32_t *)alloc = 1;
+  return alloc + HeapChunkHeader;
+}
 
-      int32_t decompSize = LZ4_decompress_safe_continue(&lz4, (const char *)srcBuf, (char *)destBuf,
-                                                        *compSize, BlockSize);
+static volatile int32_t *HeapChunkRefs(byte *data)
+{
+  return (volatile int32_t *)(data - HeapChunkHeader);
+}
 
-      if(decompSize < 0)
-        return;
+static void ReleaseHeapChunkData(byte *data)
+{
+  if(data && Atomic::Dec32(HeapChunkRefs(data)) == 0)
+    Serialiser::FreeAlignedBuffer(data - HeapChunkHeader);
+}
 
-      srcBuf += *compSize;
-      destBuf += decompSize;
-    }
-  }
+uint64_t Chunk::ArenaMem()
+{
+  return (uint64_t)ArenaPageMem;
+}
 
-  LZ4_stream_t m_LZ4Comp;
-  LZ4_streamDecode_t m_LZ4Decomp;
-  FILE *m_F;
-  uint32_t m_CompressedSize, m_UncompressedSize;
+void Chunk::BeginFrameArena()
+{
+  Atomic::Inc32(&ArenaFrames);
+}
 
-  byte m_InPages[2][BlockSize];
-  size_t m_PageIdx, m_PageOffset, m_PageData;
+void Chunk::EndFrameArena()
+{
+  Atomic::Dec32(&ArenaFrames);
 
-  byte *m_CompressBuf;
-  size_t m_CompressSize;
-};
+  // serialisers drop their page the next time they create a chunk, but duplicates might not be
+  // made again for a long time so release the page now
+  SCOPED_LOCK(DuplicatePageLock);
+  ReleaseChunkPage(DuplicatePage);
+  DuplicatePage = NULL;
+}
 
 Chunk::Chunk(Serialiser *ser, uint32_t chunkType, bool temporary)
 {
@@ -247,17 +1032,24 @@ Chunk::Chunk(Serialiser *ser, uint32_t chunkType, bool temporary)
 
   m_Temporary = temporary;
 
-  if(ser->HasAlignedData())
+  m_AlignedData = ser->HasAlignedData();
+
+  m_Data = NULL;
+  m_Page = NULL;
+
+  if(ArenaFrames > 0)
   {
-    m_Data = Serialiser::AllocAlignedBuffer(m_Length);
-    m_AlignedData = true;
+    m_Data = AllocChunkData(ser->m_ChunkPage, m_Length, m_AlignedData ? 64 : 16, m_Page);
   }
-  else
+  else if(ser->m_ChunkPage)
   {
-    m_Data = new byte[m_Length];
-    m_AlignedData = false;
+    ReleaseChunkPage(ser->m_ChunkPage);
+    ser->m_ChunkPage = NULL;
   }
 
+  if(m_Data == NULL)
+    m_Data = AllocHeapChunkData(m_Length);
+
   memcpy(m_Data, ser->GetRawPtr(0), m_Length);
 
   if(ser->GetDebugText())
@@ -265,10 +1057,10 @@ Chunk::Chunk(Serialiser *ser, uint32_t chunkType, bool temporary)
 
   ser->Rewind();
 
-#if ENABLED(RDOC_DEVEL)
   int64_t newval = Atomic::Inc64(&m_LiveChunks);
   Atomic::ExchAdd64(&m_TotalMem, m_Length);
 
+#if ENABLED(RDOC_DEVEL)
   if(newval > m_MaxChunks)
   {
     int breakpointme = 0;
@@ -276,6 +1068,8 @@ Chunk::Chunk(Serialiser *ser, uint32_t chunkType, bool temporary)
   }
 
   m_MaxChunks = RDCMAX(newval, m_MaxChunks);
+#else
+  (void)newval;
 #endif
 }
 
@@ -288,17 +1082,24 @@ Chunk *Chunk::Duplicate()
   ret->m_Temporary = m_Temporary;
   ret->m_AlignedData = m_AlignedData;
 
-  if(m_AlignedData)
-    ret->m_Data = Serialiser::AllocAlignedBuffer(m_Length);
-  else
-    ret->m_Data = new byte[m_Length];
+  ret->m_Data = NULL;
+  ret->m_Page = NULL;
+
+  if(ArenaFrames > 0)
+  {
+    SCOPED_LOCK(DuplicatePageLock);
+    ret->m_Data = AllocChunkData(DuplicatePage, m_Length, m_AlignedData ? 64 : 16, ret->m_Page);
+  }
+
+  if(ret->m_Data == NULL)
+    ret->m_Data = AllocHeapChunkData(m_Length);
 
   memcpy(ret->m_Data, m_Data, m_Length);
 
-#if ENABLED(RDOC_DEVEL)
   int64_t newval = Atomic::Inc64(&m_LiveChunks);
   Atomic::ExchAdd64(&m_TotalMem, m_Length);
 
+#if ENABLED(RDOC_DEVEL)
   if(newval > m_MaxChunks)
   {
     int breakpointme = 0;
@@ -306,29 +1107,64 @@ Chunk *Chunk::Duplicate()
   }
 
   m_MaxChunks = RDCMAX(newval, m_MaxChunks);
+#else
+  (void)newval;
 #endif
 
   return ret;
 }
 
+Chunk *Chunk::Share()
+{
+  Chunk *ret = new Chunk();
+  ret->m_DebugStr = m_DebugStr;
+  ret->m_Length = m_Length;
+  ret->m_ChunkType = m_ChunkType;
+  ret->m_Temporary = true;
+  ret->m_AlignedData = m_AlignedData;
+
+  ret->m_Data = m_Data;
+  ret->m_Page = m_Page;
+
+  if(m_Page)
+    Atomic::Inc32(&m_Page->refs);
+  else
+    Atomic::Inc32(HeapChunkRefs(m_Data));
+
+  Atomic::Inc64(&m_LiveChunks);
+  Atomic::ExchAdd64(&m_TotalMem, m_Length);
+
+  return ret;
+}
+
+bool Chunk::DetachFromArena()
+{
+  if(m_Page == NULL)
+    return false;
+
+  byte *data = AllocHeapChunkData(m_Length);
+  memcpy(data, m_Data, m_Length);
+
+  ReleaseChunkPage(m_Page);
+
+  m_Page = NULL;
+  m_Data = data;
+
+  return true;
+}
+
 Chunk::~Chunk()
 {
-#if ENABLED(RDOC_DEVEL)
   Atomic::Dec64(&m_LiveChunks);
   Atomic::ExchAdd64(&m_TotalMem, -int64_t(m_Length));
-#endif
-
-  if(m_AlignedData)
-  {
-    if(m_Data)
-      Serialiser::FreeAlignedBuffer(m_Data);
 
-    m_Data = NULL;
-  }
+  if(m_Page)
+    ReleaseChunkPage(m_Page);
   else
-  {
-    SAFE_DELETE_ARRAY(m_Data);
-  }
+    ReleaseHeapChunkData(m_Data);
+
+  m_Page = NULL;
+  m_Data = NULL;
 }
 
 /*
@@ -399,6 +1235,28 @@ Chunk::~Chunk()
  // binary form
  Section sections[];
 
+ -----------------------------
+ File format for version 0x33:
+
+ As 0x32, but binary sections can also be flagged as LZ4 or zstd compressed in independent
+ blocks. Both codecs use the same layout:
+
+ uint64_t uncompressedLength;
+ uint64_t compressedLength; // covers the blocks and the index
+
+ Block
+ {
+   int32_t compressedSize;
+   byte compressedData[compressedSize]; // decompresses to BlockSize, or less for the last block
+ };
+
+ Block blocks[];
+ uint64_t blockOffsets[numBlocks]; // offset of each block from the first block
+ uint32_t numBlocks;
+
+ // sectionLength is 0 and ignored, since a compressed frame capture can exceed 4GB.
+ // compressedLength is used instead
+
 */
 
 struct FileHeader
@@ -437,7 +1295,11 @@ struct BinarySectionHeader
   }
 
 Serialiser::Serialiser(size_t length, const byte *memoryBuf, bool fileheader)
-    : m_pCallstack(NULL), m_pResolver(NULL), m_Buffer(NULL)
+    : m_pCallstack(NULL),
+      m_pCallstackDB(NULL),
+      m_pResolver(NULL),
+      m_Buffer(NULL),
+      m_MappedView(NULL)
 {
   m_ResolverThread = 0;
 
@@ -457,6 +1319,8 @@ Serialiser::Serialiser(size_t length, const byte *memoryBuf, bool fileheader)
 
   if(!fileheader)
   {
+    m_SerVer = SERIALISE_VERSION;
+
     m_BufferSize = length;
     m_CurrentBufferSize = (size_t)m_BufferSize;
     m_BufferHead = m_Buffer = AllocAlignedBuffer(m_CurrentBufferSize);
@@ -492,6 +1356,9 @@ Serialiser::Serialiser(size_t length, const byte *memoryBuf, bool fileheader)
 
   m_SerVer = header->version;
 
+  // length of the stored (possibly compressed) frame capture data
+  uint64_t frameCapLength = 0;
+
   if(header->version == 0x00000031)    // backwards compatibility
   {
     memoryBuf += sizeof(FileHeader);
@@ -533,7 +1400,7 @@ Serialiser::Serialiser(size_t length, const byte *memoryBuf, bool fileheader)
     m_Sections.push_back(frameCap);
     m_KnownSections[eSectionType_FrameCapture] = frameCap;
   }
-  else if(header->version == SERIALISE_VERSION)
+  else if(header->version >= 0x00000032 && header->version <= SERIALISE_VERSION)
   {
     memoryBuf += sizeof(FileHeader);
 
@@ -605,6 +1472,25 @@ Serialiser::Serialiser(size_t length, const byte *memoryBuf, bool fileheader)
 
     frameCap->size = *uncompLength;
 
+    frameCapLength = sectionHeader->sectionLength;
+
+    if(frameCap->flags & BlockCompressedFlags)
+    {
+      if(memoryBuf + sizeof(uint64_t) >= memoryBufEnd)
+      {
+        RDCERR("Truncated binary section header");
+
+        m_ErrorCode = eSerError_Corrupt;
+        m_HasError = true;
+
+        SAFE_DELETE(frameCap);
+        return;
+      }
+
+      frameCapLength = *(uint64_t *)memoryBuf;
+      memoryBuf += sizeof(uint64_t);
+    }
+
     m_KnownSections[eSectionType_FrameCapture] = frameCap;
     m_Sections.push_back(frameCap);
   }
@@ -628,6 +1514,21 @@ Serialiser::Serialiser(size_t length, const byte *memoryBuf, bool fileheader)
   {
     CompressedFileIO::Decompress(m_Buffer, memoryBuf, memoryBufEnd - memoryBuf);
   }
+  else if(m_KnownSections[eSectionType_FrameCapture]->flags & BlockCompressedFlags)
+  {
+    uint32_t codec = m_KnownSections[eSectionType_FrameCapture]->flags & BlockCompressedFlags;
+
+    if(frameCapLength > uint64_t(memoryBufEnd - memoryBuf) ||
+       !BlockCompressedFileIO::DecompressSection(codec, m_Buffer, m_BufferSize, memoryBuf,
+                                                 frameCapLength))
+    {
+      RDCERR("Invalid block compressed frame capture in in-memory buffer");
+
+      m_ErrorCode = eSerError_Corrupt;
+      m_HasError = true;
+      return;
+    }
+  }
   else
   {
     memcpy(m_Buffer, memoryBuf, m_CurrentBufferSize);
@@ -635,7 +1536,11 @@ Serialiser::Serialiser(size_t length, const byte *memoryBuf, bool fileheader)
 }
 
 Serialiser::Serialiser(const char *path, Mode mode, bool debugMode, uint64_t sizeHint)
-    : m_pCallstack(NULL), m_pResolver(NULL), m_Buffer(NULL)
+    : m_pCallstack(NULL),
+      m_pCallstackDB(NULL),
+      m_pResolver(NULL),
+      m_Buffer(NULL),
+      m_MappedView(NULL)
 {
   m_ResolverThread = 0;
 
@@ -742,13 +1647,15 @@ Serialiser::Serialiser(const char *path, Mode mode, bool debugMode, uint64_t siz
       m_Sections.push_back(frameCap);
       m_KnownSections[eSectionType_FrameCapture] = frameCap;
     }
-    else if(header.version == SERIALISE_VERSION)
+    else if(header.version >= 0x00000032 && header.version <= SERIALISE_VERSION)
     {
       while(!FileIO::feof(m_ReadFileHandle))
       {
         BinarySectionHeader sectionHeader = {0};
         byte *reading = (byte *)&sectionHeader;
 
+        uint64_t sectionStart = FileIO::ftell64(m_ReadFileHandle);
+
         FileIO::fread(reading, 1, 1, m_ReadFileHandle);
         reading++;
 
@@ -838,6 +1745,9 @@ Serialiser::Serialiser(const char *path, Mode mode, bool debugMode, uint64_t siz
 
           FileIO::fread(&sect->data[0], 1, (size_t)length, m_ReadFileHandle);
 
+          sect->rawoffset = sectionStart;
+          sect->rawsize = FileIO::ftell64(m_ReadFileHandle) - sectionStart;
+
           if(sect->type != eSectionType_Unknown && sect->type < eSectionType_Num)
             m_KnownSections[sect->type] = sect;
           m_Sections.push_back(sect);
@@ -858,6 +1768,8 @@ Serialiser::Serialiser(const char *path, Mode mode, bool debugMode, uint64_t siz
 
           sect->fileoffset = FileIO::ftell64(m_ReadFileHandle);
 
+          uint64_t length = sectionHeader.sectionLength;
+
           if(sect->flags & eSectionFlag_LZ4Compressed)
           {
             sect->compressedReader = new CompressedFileIO(m_ReadFileHandle);
@@ -865,22 +1777,41 @@ Serialiser::Serialiser(const char *path, Mode mode, bool debugMode, uint64_t siz
 
             sect->fileoffset += sizeof(uint64_t);
           }
+          else if(sect->flags & BlockCompressedFlags)
+          {
+            sect->blockReader =
+                new BlockCompressedFileIO(m_ReadFileHandle, sect->flags & BlockCompressedFlags);
+            FileIO::fread(&sect->size, 1, sizeof(uint64_t), m_ReadFileHandle);
+            FileIO::fread(&length, 1, sizeof(uint64_t), m_ReadFileHandle);
+
+            sect->fileoffset += sizeof(uint64_t) * 2;
+          }
 
           if(sect->type != eSectionType_Unknown && sect->type < eSectionType_Num)
             m_KnownSections[sect->type] = sect;
           m_Sections.push_back(sect);
 
+          if(sect->blockReader &&
+             !sect->blockReader->ReadIndex(sect->fileoffset, length, sect->size))
+            RETURNCORRUPT("Invalid block index in section '%s'", sect->name.c_str());
+
           // if section isn't frame capture data and is small enough, read it all into memory now,
-          // otherwise skip
-          if(sect->type != eSectionType_FrameCapture && sectionHeader.sectionLength < 4 * 1024 * 1024)
+          // otherwise skip. The chunk index and callstacks are always needed, and are compact
+          // enough to load whole
+          if(sect->type != eSectionType_FrameCapture &&
+             (length < 4 * 1024 * 1024 || sect->type == eSectionType_ChunkIndex ||
+              sect->type == eSectionType_CallstackDatabase))
           {
-            sect->data.resize(sectionHeader.sectionLength);
-            FileIO::fread(&sect->data[0], 1, sectionHeader.sectionLength, m_ReadFileHandle);
+            sect->data.resize((size_t)length);
+            FileIO::fread(&sect->data[0], 1, (size_t)length, m_ReadFileHandle);
           }
           else
           {
-            FileIO::fseek64(m_ReadFileHandle, sectionHeader.sectionLength, SEEK_CUR);
+            FileIO::fseek64(m_ReadFileHandle, length, SEEK_CUR);
           }
+
+          sect->rawoffset = sectionStart;
+          sect->rawsize = FileIO::ftell64(m_ReadFileHandle) - sectionStart;
         }
         else
         {
@@ -914,9 +1845,14 @@ Serialiser::Serialiser(const char *path, Mode mode, bool debugMode, uint64_t siz
     }
 
     m_BufferSize = m_KnownSections[eSectionType_FrameCapture]->size;
+    m_ReadOffset = 0;
+
+    // if we can, map the whole section and read straight from the file view
+    if(MapFrameCapture())
+      return;
+
     m_CurrentBufferSize = (size_t)RDCMIN(m_BufferSize, (uint64_t)64 * 1024);
     m_BufferHead = m_Buffer = AllocAlignedBuffer(m_CurrentBufferSize);
-    m_ReadOffset = 0;
 
     FileIO::fseek64(m_ReadFileHandle, m_KnownSections[eSectionType_FrameCapture]->fileoffset,
                     SEEK_SET);
@@ -956,6 +1892,7 @@ void Serialiser::Reset()
 
   m_DebugText = "";
   m_DebugTextWriting = false;
+  m_CollectCallstacks = true;
 
   RDCEraseEl(m_KnownSections);
 
@@ -967,12 +1904,9 @@ void Serialiser::Reset()
   m_Indent = 0;
 
   SAFE_DELETE(m_pCallstack);
+  SAFE_DELETE(m_pCallstackDB);
   SAFE_DELETE(m_pResolver);
-  if(m_Buffer)
-  {
-    FreeAlignedBuffer(m_Buffer);
-    m_Buffer = NULL;
-  }
+  FreeBuffer();
 
   m_ChunkLookup = NULL;
 
@@ -985,6 +1919,16 @@ void Serialiser::Reset()
   m_BufferHead = m_Buffer = NULL;
   m_CurrentBufferSize = 0;
   m_BufferSize = 0;
+
+  m_ChunkIndex.clear();
+  m_ChunkIndexReady = false;
+
+  m_ChunkPage = NULL;
+
+  m_FileWriter = NULL;
+  m_WriteCodec = eSectionFlag_LZ4Blocks;
+  m_WriteLevel = 0;
+  m_AsyncBlockedTime = 0.0;
 }
 
 Serialiser::~Serialiser()
@@ -1006,6 +1950,7 @@ Serialiser::~Serialiser()
   for(size_t i = 0; i < m_Sections.size(); i++)
   {
     SAFE_DELETE(m_Sections[i]->compressedReader);
+    SAFE_DELETE(m_Sections[i]->blockReader);
     SAFE_DELETE(m_Sections[i]);
   }
 
@@ -1017,15 +1962,64 @@ Serialiser::~Serialiser()
 
   m_Chunks.clear();
 
+  ReleaseChunkPage(m_ChunkPage);
+  m_ChunkPage = NULL;
+
+  // a capture that was started but never flushed leaves a partial file behind, same as if the
+  // synchronous write had failed part way
+  if(m_FileWriter)
+  {
+    StopAsyncWrite();
+    FileIO::fclose(m_FileWriter->file);
+    SAFE_DELETE(m_FileWriter);
+  }
+
   SAFE_DELETE(m_pResolver);
   SAFE_DELETE(m_pCallstack);
-  if(m_Buffer)
+  FreeBuffer();
+  m_BufferHead = NULL;
+}
+
+void Serialiser::FreeBuffer()
+{
+  if(m_MappedView)
+  {
+    FileIO::mapview_close(m_MappedView);
+    m_MappedView = NULL;
+  }
+  else if(m_Buffer)
   {
     FreeAlignedBuffer(m_Buffer);
-    m_Buffer = NULL;
   }
+
   m_Buffer = NULL;
-  m_BufferHead = NULL;
+}
+
+bool Serialiser::MapFrameCapture()
+{
+  Section *s = m_KnownSections[eSectionType_FrameCapture];
+
+  // compressed sections have to be decompressed into the window as we go
+  if(s->flags & (eSectionFlag_LZ4Compressed | BlockCompressedFlags))
+    return false;
+
+  // don't map past the end of a truncated file, the OS would fault on access instead of failing
+  if(s->fileoffset + s->size > m_FileSize)
+    return false;
+
+  byte *data = NULL;
+  m_MappedView = FileIO::mapview_open(m_ReadFileHandle, s->fileoffset, s->size, data);
+
+  if(m_MappedView == NULL)
+    return false;
+
+  RDCDEBUG("Mapped %llu bytes of uncompressed frame capture data", s->size);
+
+  // the window is now the whole section, so it never needs to move or be refilled
+  m_CurrentBufferSize = (size_t)m_BufferSize;
+  m_BufferHead = m_Buffer = data;
+
+  return true;
 }
 
 void Serialiser::WriteBytes(const byte *buf, size_t nBytes)
@@ -1072,6 +2066,15 @@ void *Serialiser::ReadBytes(size_t nBytes)
   // if we would read off the end of our current window
   if(m_BufferHead + nBytes > m_Buffer + m_CurrentBufferSize)
   {
+    // a mapped window covers the whole section, so this would read past the end of it
+    if(m_MappedView)
+    {
+      RDCERR("Reading %llu bytes past the end of mapped capture data", (uint64_t)nBytes);
+      m_ErrorCode = eSerError_Corrupt;
+      m_HasError = true;
+      return NULL;
+    }
+
     // store old buffer and the read data, so we can move it into the new buffer
     byte *oldBuffer = m_Buffer;
 
@@ -1134,14 +2137,46 @@ void Serialiser::ReadFromFile(uint64_t bufferOffs, size_t length)
 
   RDCASSERT(s);
 
+  ReadSection(s, m_Buffer + bufferOffs, length);
+}
+
+void Serialiser::SeekSection(Section *s, uint64_t offs)
+{
+  // a streamed LZ4 section can only be rewound to the start, the rest can seek anywhere
+  RDCASSERT(offs == 0 || !(s->flags & eSectionFlag_LZ4Compressed));
+
+  if(s->flags & BlockCompressedFlags)
+  {
+    RDCASSERT(s->blockReader);
+    s->blockReader->Seek(offs);
+  }
+  else
+  {
+    FileIO::fseek64(m_ReadFileHandle, s->fileoffset + offs, SEEK_SET);
+
+    if(s->flags & eSectionFlag_LZ4Compressed)
+    {
+      RDCASSERT(s->compressedReader);
+      s->compressedReader->Reset();
+    }
+  }
+}
+
+void Serialiser::ReadSection(Section *s, byte *data, size_t length)
+{
   if(s->flags & eSectionFlag_LZ4Compressed)
   {
     RDCASSERT(s->compressedReader);
-    s->compressedReader->Read(m_Buffer + bufferOffs, length);
+    s->compressedReader->Read(data, length);
+  }
+  else if(s->flags & BlockCompressedFlags)
+  {
+    RDCASSERT(s->blockReader);
+    s->blockReader->Read(data, length);
   }
   else
   {
-    FileIO::fread(m_Buffer + bufferOffs, 1, length, m_ReadFileHandle);
+    FileIO::fread(data, 1, length, m_ReadFileHandle);
   }
 }
 
@@ -1200,6 +2235,14 @@ void Serialiser::SetPersistentBlock(uint64_t offs)
   // ensure sane offset
   RDCASSERT(offs < m_BufferSize);
 
+  // a mapped section is already entirely resident, and the view outlives the file handle
+  if(m_MappedView)
+  {
+    FileIO::fclose(m_ReadFileHandle);
+    m_ReadFileHandle = 0;
+    return;
+  }
+
   size_t persistentSize = (size_t)(m_BufferSize - offs);
 
   // allocate our persistent buffer
@@ -1245,38 +2288,149 @@ void Serialiser::SetOffset(uint64_t offs)
     return;
   }
 
-  // if we're jumping back before our in-memory window just reset the window
-  // and load it all in from scratch.
-  if(m_Mode == READING && offs < m_ReadOffset)
+  // if we're jumping back before our in-memory window, or forward past the end of it, just reset
+  // the window and load it all in from scratch.
+  if(m_Mode == READING &&
+     (offs < m_ReadOffset || (m_ReadFileHandle && offs > m_ReadOffset + m_CurrentBufferSize)))
+  {
+    if(m_ReadFileHandle)
+    {
+      Section *s = m_KnownSections[eSectionType_FrameCapture];
+      RDCASSERT(s);
+
+      SeekSection(s, offs);
+    }
+
+    FreeAlignedBuffer(m_Buffer);
+
+    m_CurrentBufferSize = (size_t)RDCMIN(m_BufferSize - offs, (uint64_t)64 * 1024);
+    m_BufferHead = m_Buffer = AllocAlignedBuffer(m_CurrentBufferSize);
+    m_ReadOffset = offs;
+
+    ReadFromFile(0, m_CurrentBufferSize);
+  }
+
+  RDCASSERT(m_BufferHead && m_Buffer && offs <= GetSize());
+  m_BufferHead = m_Buffer + offs - m_ReadOffset;
+  m_Indent = 0;
+}
+
+bool Serialiser::CanSeek()
+{
+  // without a file handle the whole frame is in memory. Otherwise only a streamed LZ4 section
+  // can't be jumped into part-way
+  if(m_Mode != READING || m_ReadFileHandle == NULL)
+    return true;
+
+  Section *s = m_KnownSections[eSectionType_FrameCapture];
+
+  return s && !(s->flags & eSectionFlag_LZ4Compressed);
+}
+
+static bool ChunkOffsetLess(const Serialiser::ChunkIndexEntry &entry, uint64_t offs)
+{
+  return entry.offset < offs;
+}
+
+void Serialiser::SkipToChunk(uint32_t chunkIdx, uint32_t *idx)
+{
+  // with an index in the file we can jump straight there, instead of walking every chunk
+  if(m_Mode == READING && m_KnownSections[eSectionType_ChunkIndex] && CanSeek())
+  {
+    const vector<ChunkIndexEntry> &index = GetChunkIndex();
+
+    if(!index.empty())
+    {
+      size_t i = std::lower_bound(index.begin(), index.end(), GetOffset(), &ChunkOffsetLess) -
+                 index.begin();
+
+      for(; i < index.size() && index[i].chunkType != chunkIdx; i++)
+      {
+        if(idx)
+          (*idx)++;
+      }
+
+      SetOffset(i < index.size() ? index[i].offset : GetSize());
+      return;
+    }
+  }
+
+  do
+  {
+    size_t offs = m_BufferHead - m_Buffer + (size_t)m_ReadOffset;
+
+    uint32_t c = PushContext(NULL, NULL, 1, false);
+
+    // found
+    if(c == chunkIdx)
+    {
+      m_Indent--;
+      m_BufferHead = (m_Buffer + offs) - (size_t)m_ReadOffset;
+      return;
+    }
+    else
+    {
+      SkipCurrentChunk();
+      PopContext(1);
+    }
+
+    if(idx)
+      (*idx)++;
+
+  } while(!AtEnd());
+}
+
+const vector<Serialiser::ChunkIndexEntry> &Serialiser::GetChunkIndex()
+{
+  if(m_ChunkIndexReady || m_Mode != READING || m_HasError)
+    return m_ChunkIndex;
+
+  m_ChunkIndexReady = true;
+
+  Section *s = m_KnownSections[eSectionType_ChunkIndex];
+
+  if(s && !s->data.empty() && s->data.size() % sizeof(ChunkIndexEntry) == 0)
+  {
+    m_ChunkIndex.resize(s->data.size() / sizeof(ChunkIndexEntry));
+    memcpy(&m_ChunkIndex[0], &s->data[0], s->data.size());
+    return m_ChunkIndex;
+  }
+
+  RDCLOG("No chunk index in capture, building one");
+
+  // scan with a separate serialiser so that our own read position and state are untouched.
+  // Anything not read from a file is entirely in memory already
+  if(!m_Filename.empty())
+  {
+    Serialiser scan(m_Filename.c_str(), READING, false);
+    scan.ScanChunks(m_ChunkIndex);
+  }
+  else
   {
-    // if we're reading from file, only support rewinding all the way to the start
-    RDCASSERT(m_ReadFileHandle == NULL || offs == 0);
+    RDCASSERT(m_ReadOffset == 0 && m_CurrentBufferSize == m_BufferSize);
 
-    if(m_ReadFileHandle)
-    {
-      Section *s = m_KnownSections[eSectionType_FrameCapture];
-      RDCASSERT(s);
-      FileIO::fseek64(m_ReadFileHandle, s->fileoffset, SEEK_SET);
+    Serialiser scan((size_t)m_BufferSize, m_Buffer, false);
+    scan.ScanChunks(m_ChunkIndex);
+  }
 
-      if(s->flags & eSectionFlag_LZ4Compressed)
-      {
-        RDCASSERT(s->compressedReader);
-        s->compressedReader->Reset();
-      }
-    }
+  return m_ChunkIndex;
+}
 
-    FreeAlignedBuffer(m_Buffer);
+void Serialiser::ScanChunks(vector<ChunkIndexEntry> &index)
+{
+  while(!m_HasError && !AtEnd())
+  {
+    ChunkIndexEntry entry;
+    entry.offset = GetOffset();
+    entry.chunkType = PushContext(NULL, NULL, 1, false);
 
-    m_CurrentBufferSize = (size_t)RDCMIN(m_BufferSize, (uint64_t)64 * 1024);
-    m_BufferHead = m_Buffer = AllocAlignedBuffer(m_CurrentBufferSize);
-    m_ReadOffset = offs;
+    SkipCurrentChunk();
+    PopContext(entry.chunkType);
 
-    ReadFromFile(0, m_CurrentBufferSize);
-  }
+    entry.length = uint32_t(GetOffset() - entry.offset);
 
-  RDCASSERT(m_BufferHead && m_Buffer && offs <= GetSize());
-  m_BufferHead = m_Buffer + offs - m_ReadOffset;
-  m_Indent = 0;
+    index.push_back(entry);
+  }
 }
 
 void Serialiser::InitCallstackResolver()
@@ -1297,6 +2451,21 @@ void Serialiser::SetCallstack(uint64_t *levels, size_t numLevels)
   m_pCallstack->Set(levels, numLevels);
 }
 
+CallstackTrie *Serialiser::GetCallstackDB()
+{
+  if(m_pCallstackDB == NULL)
+  {
+    m_pCallstackDB = new CallstackTrie();
+
+    Section *s = m_KnownSections[eSectionType_CallstackDatabase];
+
+    if(s && !s->data.empty() && !m_pCallstackDB->Load(&s->data[0], s->data.size()))
+      RDCWARN("Corrupt callstack database, callstacks will be unavailable");
+  }
+
+  return m_pCallstackDB;
+}
+
 void Serialiser::CreateResolver(void *ths)
 {
   Serialiser *ser = (Serialiser *)ths;
@@ -1346,184 +2515,505 @@ void Serialiser::FlushToDisk()
       }
     }
 
-    FILE *binFile = FileIO::fopen(m_Filename.c_str(), "w+b");
+    if(IsWritingAsync())
+    {
+      // let the writer thread drain whatever is still queued, then finish the file here
+      StopAsyncWrite();
 
-    if(!binFile)
+      RDCLOG("Inserting chunks was blocked on writing for %.2lf ms", m_AsyncBlockedTime);
+    }
+    else
     {
-      RDCERR("Can't open capture file '%s' for write, errno %d", m_Filename.c_str(), errno);
-      m_ErrorCode = eSerError_FileIO;
-      m_HasError = true;
-      return;
+      if(!m_FileWriter && !BeginFileWrite())
+        return;
+
+      // write frame capture contents
+      for(size_t i = 0; i < m_Chunks.size(); i++)
+      {
+        Chunk *chunk = m_Chunks[i];
+
+        WriteChunkToFile(chunk);
+
+        if(chunk->IsTemporary())
+          SAFE_DELETE(chunk);
+      }
+
+      m_Chunks.clear();
     }
 
-    RDCDEBUG("Opened capture file for write");
+    EndFileWrite();
+  }
+}
+
+void Serialiser::StartAsyncWrite()
+{
+  if(m_Filename == "" || m_HasError || m_Mode != WRITING || m_FileWriter)
+    return;
+
+  // if the file can't be opened now, chunks are kept until FlushToDisk as normal which will fail
+  // with the same error
+  if(!BeginFileWrite())
+    return;
+
+  m_FileWriter->thread = Threading::CreateThread(&Serialiser::AsyncWriteThread, (void *)this);
+
+  if(m_FileWriter->thread == 0)
+    RDCWARN("Couldn't start capture writing thread, capture will be written at the end");
+}
+
+void Serialiser::SetCompression(SectionFlags codec, int level)
+{
+  RDCASSERT(codec == eSectionFlag_LZ4Blocks || codec == eSectionFlag_ZstdCompressed);
+  RDCASSERT(m_FileWriter == NULL);
+
+  m_WriteCodec = codec;
+  m_WriteLevel = level;
+}
+
+bool Serialiser::IsWritingAsync()
+{
+  return m_FileWriter && m_FileWriter->thread;
+}
+
+void Serialiser::StopAsyncWrite()
+{
+  if(m_FileWriter->thread == 0)
+    return;
 
-    FileHeader header;    // automagically initialised with correct data
+  {
+    SCOPED_LOCK(m_FileWriter->lock);
+    m_FileWriter->finished = true;
+  }
 
-    // write header
-    FileIO::fwrite(&header, 1, sizeof(FileHeader), binFile);
+  Threading::JoinThread(m_FileWriter->thread);
+  Threading::CloseThread(m_FileWriter->thread);
+  m_FileWriter->thread = 0;
+}
 
-    static const byte padding[BufferAlignment] = {0};
+void Serialiser::AsyncWriteThread(void *ths)
+{
+  Serialiser *ser = (Serialiser *)ths;
+  CaptureFileWriter *writer = ser->m_FileWriter;
 
-    uint64_t compressedSizeOffset = 0;
-    uint64_t uncompressedSizeOffset = 0;
+  for(;;)
+  {
+    CaptureFileWriter::QueuedChunk queued = {NULL, NULL};
+    bool finished = false;
 
-    // write frame capture section header
     {
-      const char sectionName[] = "renderdoc/internal/framecapture";
+      SCOPED_LOCK(writer->lock);
 
-      BinarySectionHeader section = {0};
-      section.isASCII = 0;                                // redundant but explicit
-      section.sectionNameLength = sizeof(sectionName);    // includes null terminator
-      section.sectionType = eSectionType_FrameCapture;
-      section.sectionFlags = eSectionFlag_LZ4Compressed;
-      section.sectionLength =
-          0;    // will be fixed up later, to avoid having to compress everything into memory
+      if(writer->queue.empty())
+      {
+        finished = writer->finished;
+      }
+      else
+      {
+        queued = writer->queue.front();
+        writer->queue.pop_front();
+      }
+    }
 
-      compressedSizeOffset = FileIO::ftell64(binFile) + offsetof(BinarySectionHeader, sectionLength);
+    if(queued.chunk == NULL && queued.deferred == NULL)
+    {
+      if(finished)
+        break;
+
+      Threading::Sleep(1);
+      continue;
+    }
 
-      FileIO::fwrite(&section, 1, offsetof(BinarySectionHeader, name), binFile);
-      FileIO::fwrite(sectionName, 1, sizeof(sectionName), binFile);
+    Chunk *chunk = queued.chunk;
 
-      uint64_t len = 0;    // will be fixed up later
-      uncompressedSizeOffset = FileIO::ftell64(binFile);
-      FileIO::fwrite(&len, 1, sizeof(uint64_t), binFile);
+    // deferred chunks don't count towards the queued bytes since their size isn't known until now
+    uint64_t len = 0;
+
+    if(queued.deferred)
+    {
+      chunk = queued.deferred->Create();
+      SAFE_DELETE(queued.deferred);
+    }
+    else
+    {
+      len = chunk->GetLength();
     }
 
-    CompressedFileIO fwriter(binFile);
+    ser->WriteChunkToFile(chunk);
 
-    // track offset so we can add padding. The padding is relative
-    // to the start of the decompressed buffer, so we start it from 0
-    uint64_t offs = 0;
-    uint64_t alignedoffs = 0;
+    SAFE_DELETE(chunk);
 
-    // write frame capture contents
-    for(size_t i = 0; i < m_Chunks.size(); i++)
     {
-      Chunk *chunk = m_Chunks[i];
+      SCOPED_LOCK(writer->lock);
+      writer->queuedBytes -= len;
+    }
+  }
+}
 
-      alignedoffs = AlignUp(offs, BufferAlignment);
+bool Serialiser::BeginFileWrite()
+{
+  FILE *binFile = FileIO::fopen(m_Filename.c_str(), "w+b");
 
-      if(offs != alignedoffs && chunk->IsAligned())
-      {
-        uint16_t chunkIdx = 0;    // write a '0' chunk that indicates special behaviour
-        fwriter.Write(&chunkIdx, sizeof(chunkIdx));
-        offs += sizeof(chunkIdx);
+  if(!binFile)
+  {
+    RDCERR("Can't open capture file '%s' for write, errno %d", m_Filename.c_str(), errno);
+    m_ErrorCode = eSerError_FileIO;
+    m_HasError = true;
+    return false;
+  }
 
-        uint8_t controlByte = 0;    // control byte 0 indicates padding
-        fwriter.Write(&controlByte, sizeof(controlByte));
-        offs += sizeof(controlByte);
+  RDCDEBUG("Opened capture file for write");
 
-        offs++;    // we will have to write out a byte indicating how much padding exists, so add 1
-        alignedoffs = AlignUp(offs, BufferAlignment);
+  m_FileWriter = new CaptureFileWriter(binFile, m_WriteCodec, m_WriteLevel);
 
-        RDCCOMPILE_ASSERT(BufferAlignment < 0x100,
-                          "Buffer alignment must be less than 256");    // with a byte at most
-                                                                        // indicating how many bytes
-                                                                        // to pad,
-        // this is our maximal representable alignment
+  FileHeader header;    // automagically initialised with correct data
 
-        uint8_t padLength = (alignedoffs - offs) & 0xff;
-        fwriter.Write(&padLength, sizeof(padLength));
+  // write header
+  FileIO::fwrite(&header, 1, sizeof(FileHeader), binFile);
 
-        // we might have padded with the control bytes, so only write some bytes if we need to
-        if(padLength > 0)
-        {
-          fwriter.Write(padding, size_t(alignedoffs - offs));
-          offs += alignedoffs - offs;
-        }
-      }
+  // write frame capture section header
+  {
+    const char sectionName[] = "renderdoc/internal/framecapture";
+
+    BinarySectionHeader section = {0};
+    section.isASCII = 0;                                // redundant but explicit
+    section.sectionNameLength = sizeof(sectionName);    // includes null terminator
+    section.sectionType = eSectionType_FrameCapture;
+    section.sectionFlags = m_WriteCodec;
+    section.sectionLength = 0;    // the 64-bit compressed length below is used instead
+
+    FileIO::fwrite(&section, 1, offsetof(BinarySectionHeader, name), binFile);
+    FileIO::fwrite(sectionName, 1, sizeof(sectionName), binFile);
+
+    // both lengths will be fixed up later, to avoid having to compress everything into memory
+    uint64_t len = 0;
+    m_FileWriter->uncompressedSizeOffset = FileIO::ftell64(binFile);
+    FileIO::fwrite(&len, 1, sizeof(uint64_t), binFile);
+    m_FileWriter->compressedSizeOffset = FileIO::ftell64(binFile);
+    FileIO::fwrite(&len, 1, sizeof(uint64_t), binFile);
+  }
+
+  return true;
+}
 
-      fwriter.Write(chunk->GetData(), chunk->GetLength());
+void Serialiser::WriteChunkToFile(Chunk *chunk)
+{
+  static const byte padding[BufferAlignment] = {0};
 
-      offs += chunk->GetLength();
+  BlockCompressedFileIO &fwriter = m_FileWriter->compressor;
+  uint64_t &offs = m_FileWriter->offs;
 
-      if(chunk->IsTemporary())
-        SAFE_DELETE(chunk);
-    }
+  ChunkIndexEntry entry;
+  entry.chunkType = chunk->GetChunkType();
+  entry.offset = offs;
+
+  uint64_t alignedoffs = AlignUp(offs, BufferAlignment);
+
+  if(offs != alignedoffs && chunk->IsAligned())
+  {
+    uint16_t chunkIdx = 0;    // write a '0' chunk that indicates special behaviour
+    fwriter.Write(&chunkIdx, sizeof(chunkIdx));
+    offs += sizeof(chunkIdx);
+
+    uint8_t controlByte = 0;    // control byte 0 indicates padding
+    fwriter.Write(&controlByte, sizeof(controlByte));
+    offs += sizeof(controlByte);
 
-    fwriter.Flush();
+    offs++;    // we will have to write out a byte indicating how much padding exists, so add 1
+    alignedoffs = AlignUp(offs, BufferAlignment);
 
-    m_Chunks.clear();
+    RDCCOMPILE_ASSERT(BufferAlignment < 0x100,
+                      "Buffer alignment must be less than 256");    // with a byte at most
+                                                                    // indicating how many bytes
+                                                                    // to pad,
+    // this is our maximal representable alignment
 
-    // fixup section size
+    uint8_t padLength = (alignedoffs - offs) & 0xff;
+    fwriter.Write(&padLength, sizeof(padLength));
+
+    // we might have padded with the control bytes, so only write some bytes if we need to
+    if(padLength > 0)
     {
-      uint32_t compsize = 0;
-      uint64_t uncompsize = 0;
+      fwriter.Write(padding, size_t(alignedoffs - offs));
+      offs += alignedoffs - offs;
+    }
+  }
 
-      uint64_t curoffs = FileIO::ftell64(binFile);
+  const byte *data = chunk->GetData();
+  uint32_t length = chunk->GetLength();
 
-      FileIO::fseek64(binFile, compressedSizeOffset, SEEK_SET);
+  uint16_t header = 0;
+  if(length >= sizeof(uint16_t) + sizeof(uint32_t))
+    memcpy(&header, data, sizeof(header));
 
-      compsize = fwriter.GetCompressedSize();
-      FileIO::fwrite(&compsize, 1, sizeof(compsize), binFile);
+  // the chunk's callstack index refers to the process-wide trie, so write it renumbered for this
+  // capture. Chunks can be written into several captures so the data itself is left untouched
+  if(header & 0x8000)
+  {
+    uint32_t stack = 0;
+    memcpy(&stack, data + sizeof(header), sizeof(stack));
+    stack = m_FileWriter->RemapCallstack(stack);
+
+    fwriter.Write(data, sizeof(header));
+    fwriter.Write(&stack, sizeof(stack));
+    fwriter.Write(data + sizeof(header) + sizeof(stack),
+                  length - sizeof(header) - sizeof(stack));
+  }
+  else
+  {
+    fwriter.Write(data, length);
+  }
+
+  offs += length;
 
-      FileIO::fseek64(binFile, uncompressedSizeOffset, SEEK_SET);
+  entry.length = uint32_t(offs - entry.offset);
+  m_FileWriter->chunkIndex.push_back(entry);
+}
 
-      uncompsize = fwriter.GetUncompressedSize();
-      FileIO::fwrite(&uncompsize, 1, sizeof(uncompsize), binFile);
+void Serialiser::EndFileWrite()
+{
+  FILE *binFile = m_FileWriter->file;
+  BlockCompressedFileIO &fwriter = m_FileWriter->compressor;
+  const vector<ChunkIndexEntry> &chunkIndex = m_FileWriter->chunkIndex;
 
-      FileIO::fseek64(binFile, curoffs, SEEK_SET);
+  fwriter.Flush();
+  fwriter.WriteIndex();
 
-      RDCLOG("Compressed frame capture data from %u to %u", fwriter.GetUncompressedSize(),
-             fwriter.GetCompressedSize());
-    }
+  // fixup section size
+  {
+    uint64_t compsize = 0;
+    uint64_t uncompsize = 0;
 
-    char *symbolDB = NULL;
-    size_t symbolDBSize = 0;
+    uint64_t curoffs = FileIO::ftell64(binFile);
 
-    if(RenderDoc::Inst().GetCaptureOptions().CaptureCallstacks ||
-       RenderDoc::Inst().GetCaptureOptions().CaptureCallstacksOnlyDraws)
-    {
-      // get symbol database
-      Callstack::GetLoadedModules(symbolDB, symbolDBSize);
+    FileIO::fseek64(binFile, m_FileWriter->compressedSizeOffset, SEEK_SET);
 
-      symbolDB = new char[symbolDBSize];
-      symbolDBSize = 0;
+    compsize = fwriter.GetCompressedSize();
+    FileIO::fwrite(&compsize, 1, sizeof(compsize), binFile);
 
-      Callstack::GetLoadedModules(symbolDB, symbolDBSize);
-    }
+    FileIO::fseek64(binFile, m_FileWriter->uncompressedSizeOffset, SEEK_SET);
 
-    // write symbol database section
-    if(symbolDB)
-    {
-      const char sectionName[] = "renderdoc/internal/resolvedb";
+    uncompsize = fwriter.GetUncompressedSize();
+    FileIO::fwrite(&uncompsize, 1, sizeof(uncompsize), binFile);
+
+    FileIO::fseek64(binFile, curoffs, SEEK_SET);
 
+    RDCLOG("Compressed frame capture data from %llu to %llu", fwriter.GetUncompressedSize(),
+           fwriter.GetCompressedSize());
+  }
+
+  // write chunk index section
+  {
+    const char sectionName[] = "renderdoc/internal/chunkindex";
+
+    BinarySectionHeader section = {0};
+    section.isASCII = 0;                                // redundant but explicit
+    section.sectionNameLength = sizeof(sectionName);    // includes null terminator
+    section.sectionType = eSectionType_ChunkIndex;
+    section.sectionFlags = eSectionFlag_None;
+    section.sectionLength = uint32_t(chunkIndex.size() * sizeof(ChunkIndexEntry));
+
+    FileIO::fwrite(&section, 1, offsetof(BinarySectionHeader, name), binFile);
+    FileIO::fwrite(sectionName, 1, sizeof(sectionName), binFile);
+
+    if(!chunkIndex.empty())
+      FileIO::fwrite(&chunkIndex[0], sizeof(ChunkIndexEntry), chunkIndex.size(), binFile);
+  }
+
+  char *symbolDB = NULL;
+  size_t symbolDBSize = 0;
+
+  if(RenderDoc::Inst().GetCaptureOptions().CaptureCallstacks ||
+     RenderDoc::Inst().GetCaptureOptions().CaptureCallstacksOnlyDraws)
+  {
+    // get symbol database
+    Callstack::GetLoadedModules(symbolDB, symbolDBSize);
+
+    symbolDB = new char[symbolDBSize];
+    symbolDBSize = 0;
+
+    Callstack::GetLoadedModules(symbolDB, symbolDBSize);
+  }
+
+  // write symbol database section
+  if(symbolDB)
+  {
+    const char sectionName[] = "renderdoc/internal/resolvedb";
+
+    BinarySectionHeader section = {0};
+    section.isASCII = 0;                                // redundant but explicit
+    section.sectionNameLength = sizeof(sectionName);    // includes null terminator
+    section.sectionType = eSectionType_ResolveDatabase;
+    section.sectionLength = (uint32_t)symbolDBSize;
+
+    FileIO::fwrite(&section, 1, offsetof(BinarySectionHeader, name), binFile);
+    FileIO::fwrite(sectionName, 1, sizeof(sectionName), binFile);
+
+    // write actual data
+    FileIO::fwrite(symbolDB, 1, symbolDBSize, binFile);
+
+    SAFE_DELETE_ARRAY(symbolDB);
+  }
+
+  // write the callstacks that chunks refer to
+  if(!m_FileWriter->callstacks.Empty())
+  {
+    const char sectionName[] = "renderdoc/internal/callstackdb";
+
+    vector<byte> callstackDB;
+    m_FileWriter->callstacks.Save(callstackDB);
+
+    BinarySectionHeader section = {0};
+    section.isASCII = 0;                                // redundant but explicit
+    section.sectionNameLength = sizeof(sectionName);    // includes null terminator
+    section.sectionType = eSectionType_CallstackDatabase;
+    section.sectionFlags = eSectionFlag_None;
+    section.sectionLength = (uint32_t)callstackDB.size();
+
+    FileIO::fwrite(&section, 1, offsetof(BinarySectionHeader, name), binFile);
+    FileIO::fwrite(sectionName, 1, sizeof(sectionName), binFile);
+    FileIO::fwrite(&callstackDB[0], 1, callstackDB.size(), binFile);
+  }
+
+  // write the machine identifier as an ASCII section
+  {
+    const char sectionName[] = "renderdoc/internal/machineid";
+
+    uint64_t machineID = OSUtility::GetMachineIdent();
+
+    BinarySectionHeader section = {0};
+    section.isASCII = 0;                                // redundant but explicit
+    section.sectionNameLength = sizeof(sectionName);    // includes null terminator
+    section.sectionType = eSectionType_MachineID;
+    section.sectionFlags = eSectionFlag_None;
+    section.sectionLength = sizeof(machineID);
+
+    FileIO::fwrite(&section, 1, offsetof(BinarySectionHeader, name), binFile);
+    FileIO::fwrite(sectionName, 1, sizeof(sectionName), binFile);
+    FileIO::fwrite(&machineID, 1, sizeof(machineID), binFile);
+  }
+
+  FileIO::fclose(binFile);
+
+  SAFE_DELETE(m_FileWriter);
+}
+
+bool Serialiser::WriteRecompressed(const char *path, SectionFlags codec, int level)
+{
+  if(m_Mode != READING || m_HasError || m_ReadFileHandle == NULL)
+  {
+    RDCERR("Can't recompress capture without an open file to read from");
+    return false;
+  }
+
+  RDCASSERT(codec == eSectionFlag_LZ4Blocks || codec == eSectionFlag_ZstdCompressed);
+
+  FILE *dstFile = FileIO::fopen(path, "wb");
+
+  if(!dstFile)
+  {
+    RDCERR("Can't open capture file '%s' for write, errno %d", path, errno);
+    return false;
+  }
+
+  FileHeader header;    // automagically initialised with correct data
+
+  // the chunks are copied as-is, so they still need to be read as the source file's version
+  header.version = m_SerVer;
+
+  FileIO::fwrite(&header, 1, sizeof(FileHeader), dstFile);
+
+  // copy in large pieces rather than holding any whole section in memory
+  const size_t copySize = 16 * 1024 * 1024;
+  byte *copyBuf = new byte[copySize];
+
+  bool success = true;
+
+  for(size_t i = 0; success && i < m_Sections.size(); i++)
+  {
+    Section *s = m_Sections[i];
+
+    if(s->type == eSectionType_FrameCapture)
+    {
       BinarySectionHeader section = {0};
-      section.isASCII = 0;                                // redundant but explicit
-      section.sectionNameLength = sizeof(sectionName);    // includes null terminator
-      section.sectionType = eSectionType_ResolveDatabase;
-      section.sectionLength = (uint32_t)symbolDBSize;
+      section.isASCII = 0;                                           // redundant but explicit
+      section.sectionNameLength = uint32_t(s->name.length() + 1);    // includes null terminator
+      section.sectionType = eSectionType_FrameCapture;
+      section.sectionFlags = codec;
+      section.sectionLength = 0;    // the 64-bit compressed length below is used instead
 
-      FileIO::fwrite(&section, 1, offsetof(BinarySectionHeader, name), binFile);
-      FileIO::fwrite(sectionName, 1, sizeof(sectionName), binFile);
+      FileIO::fwrite(&section, 1, offsetof(BinarySectionHeader, name), dstFile);
+      FileIO::fwrite(s->name.c_str(), 1, section.sectionNameLength, dstFile);
+      FileIO::fwrite(&s->size, 1, sizeof(uint64_t), dstFile);
 
-      // write actual data
-      FileIO::fwrite(symbolDB, 1, symbolDBSize, binFile);
+      // will be fixed up once the compressed size is known
+      uint64_t compsize = 0;
+      uint64_t compressedSizeOffset = FileIO::ftell64(dstFile);
+      FileIO::fwrite(&compsize, 1, sizeof(uint64_t), dstFile);
 
-      SAFE_DELETE_ARRAY(symbolDB);
-    }
+      BlockCompressedFileIO fwriter(dstFile, codec, level);
+
+      SeekSection(s, 0);
+
+      for(uint64_t offs = 0; offs < s->size; offs += copySize)
+      {
+        size_t len = (size_t)RDCMIN((uint64_t)copySize, s->size - offs);
+
+        ReadSection(s, copyBuf, len);
+        fwriter.Write(copyBuf, len);
+      }
+
+      fwriter.Flush();
+      fwriter.WriteIndex();
+
+      uint64_t curoffs = FileIO::ftell64(dstFile);
+
+      compsize = fwriter.GetCompressedSize();
 
-    // write the machine identifier as an ASCII section
+      FileIO::fseek64(dstFile, compressedSizeOffset, SEEK_SET);
+      FileIO::fwrite(&compsize, 1, sizeof(compsize), dstFile);
+      FileIO::fseek64(dstFile, curoffs, SEEK_SET);
+
+      RDCLOG("Recompressed frame capture data from %llu to %llu", s->size, compsize);
+    }
+    else if(s->rawsize > 0)
     {
-      const char sectionName[] = "renderdoc/internal/machineid";
+      FileIO::fseek64(m_ReadFileHandle, s->rawoffset, SEEK_SET);
 
-      uint64_t machineID = OSUtility::GetMachineIdent();
+      for(uint64_t offs = 0; success && offs < s->rawsize; offs += copySize)
+      {
+        size_t len = (size_t)RDCMIN((uint64_t)copySize, s->rawsize - offs);
 
+        success = (FileIO::fread(copyBuf, 1, len, m_ReadFileHandle) == len);
+        FileIO::fwrite(copyBuf, 1, len, dstFile);
+      }
+    }
+    else if(s->data.size() == s->size)
+    {
+      // sections from old files have no header to copy, but are read entirely into memory
       BinarySectionHeader section = {0};
-      section.isASCII = 0;                                // redundant but explicit
-      section.sectionNameLength = sizeof(sectionName);    // includes null terminator
-      section.sectionType = eSectionType_MachineID;
+      section.isASCII = 0;                                           // redundant but explicit
+      section.sectionNameLength = uint32_t(s->name.length() + 1);    // includes null terminator
+      section.sectionType = s->type;
       section.sectionFlags = eSectionFlag_None;
-      section.sectionLength = sizeof(machineID);
+      section.sectionLength = (uint32_t)s->data.size();
 
-      FileIO::fwrite(&section, 1, offsetof(BinarySectionHeader, name), binFile);
-      FileIO::fwrite(sectionName, 1, sizeof(sectionName), binFile);
-      FileIO::fwrite(&machineID, 1, sizeof(machineID), binFile);
+      FileIO::fwrite(&section, 1, offsetof(BinarySectionHeader, name), dstFile);
+      FileIO::fwrite(s->name.c_str(), 1, section.sectionNameLength, dstFile);
+      if(!s->data.empty())
+        FileIO::fwrite(&s->data[0], 1, s->data.size(), dstFile);
+    }
+    else
+    {
+      RDCERR("Can't copy section '%s' when recompressing", s->name.c_str());
+      success = false;
     }
-
-    FileIO::fclose(binFile);
   }
+
+  SAFE_DELETE_ARRAY(copyBuf);
+
+  FileIO::fclose(dstFile);
+
+  return success;
 }
 
 void Serialiser::DebugPrint(const char *fmt, ...)
@@ -1568,7 +3058,7 @@ uint32_t Serialiser::PushContext(const char *name, const char *typeName, uint32_
 
       Callstack::Stackwalk *call = NULL;
 
-      if(m_Indent == 0)
+      if(m_Indent == 0 && m_CollectCallstacks)
       {
         if(RenderDoc::Inst().GetCaptureOptions().CaptureCallstacks &&
            !RenderDoc::Inst().GetCaptureOptions().CaptureCallstacksOnlyDraws)
@@ -1588,13 +3078,8 @@ uint32_t Serialiser::PushContext(const char *name, const char *typeName, uint32_
 
       if(call)
       {
-        uint8_t numLevels = call->NumLevels() & 0xff;
-        WriteFrom(numLevels);
-
-        if(call->NumLevels())
-        {
-          WriteBytes((byte *)call->GetAddrs(), sizeof(uint64_t) * numLevels);
-        }
+        uint32_t stack = CapturedCallstacks().Add(call->GetAddrs(), call->NumLevels());
+        WriteFrom(stack);
 
         SAFE_DELETE(call);
       }
@@ -1670,8 +3155,18 @@ uint32_t Serialiser::PushContext(const char *name, const char *typeName, uint32_
 
       if(m_Indent == 0)
       {
-        if(callstack)
+        if(callstack && m_SerVer >= 0x00000034)
+        {
+          uint32_t stack = 0;
+          ReadInto(stack);
+
+          uint64_t calls[256];
+          size_t callLen = GetCallstackDB()->Get(stack, calls, ARRAY_COUNT(calls));
+          SetCallstack(calls, callLen);
+        }
+        else if(callstack)
         {
+          // older captures stored the addresses inline
           uint8_t callLen = 0;
           ReadInto(callLen);
 
@@ -1816,9 +3311,72 @@ void Serialiser::SerialiseString(const char *name, string &el)
 
 void Serialiser::Insert(Chunk *chunk)
 {
-  m_Chunks.push_back(chunk);
-
   m_DebugText += chunk->GetDebugString();
+
+  if(!IsWritingAsync())
+  {
+    m_Chunks.push_back(chunk);
+    return;
+  }
+
+  // the writer thread frees chunks once they're written. The caller keeps ownership of
+  // non-temporary chunks, so give the writer its own reference to the data rather than a copy
+  if(!chunk->IsTemporary())
+    chunk = chunk->Share();
+
+  uint64_t len = chunk->GetLength();
+
+  m_FileWriter->lock.Lock();
+
+  // if the queue is full, wait for the writer to catch up. A single chunk larger than the limit is
+  // let through once the queue is empty
+  if(m_FileWriter->queuedBytes > 0 &&
+     m_FileWriter->queuedBytes + len > CaptureFileWriter::MaxQueuedBytes)
+  {
+    PerformanceTimer timer;
+
+    while(m_FileWriter->queuedBytes > 0 &&
+          m_FileWriter->queuedBytes + len > CaptureFileWriter::MaxQueuedBytes)
+    {
+      m_FileWriter->lock.Unlock();
+      Threading::Sleep(1);
+      m_FileWriter->lock.Lock();
+    }
+
+    m_AsyncBlockedTime += timer.GetMilliseconds();
+  }
+
+  CaptureFileWriter::QueuedChunk queued = {chunk, NULL};
+  m_FileWriter->queue.push_back(queued);
+  m_FileWriter->queuedBytes += len;
+
+  m_FileWriter->lock.Unlock();
+}
+
+void Serialiser::InsertSnapshot(Chunk *chunk)
+{
+  if(IsWritingAsync() && !chunk->IsTemporary())
+  {
+    chunk = chunk->Duplicate();
+    chunk->m_Temporary = true;
+  }
+
+  Insert(chunk);
+}
+
+void Serialiser::InsertDeferred(DeferredChunk *deferred)
+{
+  if(!IsWritingAsync())
+  {
+    Insert(deferred->Create());
+    SAFE_DELETE(deferred);
+    return;
+  }
+
+  SCOPED_LOCK(m_FileWriter->lock);
+
+  CaptureFileWriter::QueuedChunk queued = {NULL, deferred};
+  m_FileWriter->queue.push_back(queued);
 }
 
 void Serialiser::AlignNextBuffer(const size_t alignment)
@@ -1866,6 +3424,25 @@ void Serialiser::AlignNextBuffer(const size_t alignment)
 }
 
 void Serialiser::SerialiseBuffer(const char *name, byte *&buf, size_t &len)
+{
+  if(m_Mode >= WRITING)
+  {
+    const byte *view = buf;
+    SerialiseBufferView(name, view, len);
+  }
+  else
+  {
+    const byte *view = NULL;
+    SerialiseBufferView(name, view, len);
+
+    if(buf == NULL)
+      buf = new byte[len];
+    if(view)
+      memcpy(buf, view, len);
+  }
+}
+
+void Serialiser::SerialiseBufferView(const char *name, const byte *&buf, size_t &len)
 {
   uint32_t bufLen = (uint32_t)len;
 
@@ -1904,14 +3481,12 @@ void Serialiser::SerialiseBuffer(const char *name, byte *&buf, size_t &len)
       ReadBytes((size_t)(alignedoffs - offs));
     }
 
-    if(buf == NULL)
-      buf = new byte[bufLen];
-    memcpy(buf, ReadBytes(bufLen), bufLen);
+    buf = (const byte *)ReadBytes(bufLen);
   }
 
   len = (size_t)bufLen;
 
-  if(m_DebugTextWriting && name && name[0])
+  if(m_DebugTextWriting && name && name[0] && buf)
   {
     const char *ellipsis = "...";
 
@@ -36,6 +36,7 @@
 #include "common/common.h"
 #include "os/os_specific.h"
 #include "replay/type_helpers.h"
+#include "serialise/callstack_trie.h"
 
 using std::set;
 using std::string;
@@ -88,6 +89,9 @@ typedef const char *(*ChunkLookup)(uint32_t chunkType);
 class Serialiser;
 class ScopedContext;
 struct CompressedFileIO;
+struct BlockCompressedFileIO;
+struct CaptureFileWriter;
+struct ChunkPage;
 
 // holds the memory, length and type for a given chunk, so that it can be
 // passed around and moved between owners before being serialised out
@@ -102,18 +106,26 @@ public:
   uint32_t GetChunkType() { return m_ChunkType; }
   bool IsAligned() { return m_AlignedData; }
   bool IsTemporary() { return m_Temporary; }
-#if ENABLED(RDOC_DEVEL)
   static uint64_t NumLiveChunks() { return m_LiveChunks; }
   static uint64_t TotalMem() { return m_TotalMem; }
-#else
-  static uint64_t NumLiveChunks() { return 0; }
-  static uint64_t TotalMem() { return 0; }
-#endif
+  // memory held by arena pages, whether handed out to chunks, unused, or pooled for reuse
+  static uint64_t ArenaMem();
+
+  // while any frame is being captured, chunk data is allocated from per-serialiser arena pages
+  // rather than the heap. A page is freed in one go once every chunk in it has been deleted.
+  static void BeginFrameArena();
+  static void EndFrameArena();
 
   // grab current contents of the serialiser into this chunk
   Chunk(Serialiser *ser, uint32_t chunkType, bool temp);
 
   Chunk *Duplicate();
+  // returns a temporary chunk referencing the same data, which stays alive until both chunks are
+  // deleted. The data must not be modified while it's shared.
+  Chunk *Share();
+  // moves the data to its own heap allocation if it's in an arena page, so a chunk that outlives
+  // the frame doesn't keep the whole page alive. Returns true if the data moved.
+  bool DetachFromArena();
 
 private:
   Chunk() {}
@@ -122,6 +134,7 @@ private:
   Chunk &operator=(const Chunk &);
 
   friend class ScopedContext;
+  friend class Serialiser;
 
   bool m_AlignedData;
   bool m_Temporary;
@@ -132,11 +145,27 @@ private:
   byte *m_Data;
   string m_DebugStr;
 
+  // the arena page m_Data was allocated from, or NULL if it's a heap allocation. Heap allocations
+  // are preceded by a reference count, so that Share() works the same way for both
+  ChunkPage *m_Page;
+
+  static int64_t m_LiveChunks, m_TotalMem;
 #if ENABLED(RDOC_DEVEL)
-  static int64_t m_LiveChunks, m_MaxChunks, m_TotalMem;
+  static int64_t m_MaxChunks;
 #endif
 };
 
+// a chunk whose contents aren't known yet when it's inserted, e.g. because producing them is
+// expensive. When writing in the background, Create() is called on the writer thread once the
+// chunk reaches the front of the queue, so the work stays off the thread that inserted it.
+class DeferredChunk
+{
+public:
+  virtual ~DeferredChunk() {}
+  // returns a temporary chunk, which the serialiser takes ownership of
+  virtual Chunk *Create() = 0;
+};
+
 // this class has a few functions. It can be used to serialise chunks - on writing it enforces
 // that we only ever write a single chunk, then pull out the data into a Chunk class and erase
 // the contents of the serialiser ready to serialise the next (see the RDCASSERT at the start
@@ -176,23 +205,27 @@ public:
     eSectionFlag_None = 0x0,
     eSectionFlag_ASCIIStored = 0x1,
     eSectionFlag_LZ4Compressed = 0x2,
+    eSectionFlag_LZ4Blocks = 0x4,
+    eSectionFlag_ZstdCompressed = 0x8,
   };
 
   enum SectionType
   {
     eSectionType_Unknown = 0,
-    eSectionType_FrameCapture,       // renderdoc/internal/framecapture
-    eSectionType_ResolveDatabase,    // renderdoc/internal/resolvedb
-    eSectionType_MachineID,          // renderdoc/internal/machineid
-    eSectionType_FrameBookmarks,     // renderdoc/ui/bookmarks
-    eSectionType_Notes,              // renderdoc/ui/notes
+    eSectionType_FrameCapture,         // renderdoc/internal/framecapture
+    eSectionType_ResolveDatabase,      // renderdoc/internal/resolvedb
+    eSectionType_MachineID,            // renderdoc/internal/machineid
+    eSectionType_FrameBookmarks,       // renderdoc/ui/bookmarks
+    eSectionType_Notes,                // renderdoc/ui/notes
+    eSectionType_ChunkIndex,           // renderdoc/internal/chunkindex
+    eSectionType_CallstackDatabase,    // renderdoc/internal/callstackdb
     eSectionType_Num,
   };
 
   // version number of overall file format or chunk organisation. If the contents/meaning/order of
   // chunks have changed this does not need to be bumped, there are version numbers within each
   // API that interprets the stream that can be bumped.
-  static const uint64_t SERIALISE_VERSION = 0x00000032;
+  static const uint64_t SERIALISE_VERSION = 0x00000034;
   static const uint32_t MAGIC_HEADER;
 
   //////////////////////////////////////////
@@ -258,32 +291,18 @@ public:
   }
 
   // assumes buffer head is sitting before a chunk (ie. pushcontext will be valid)
-  void SkipToChunk(uint32_t chunkIdx, uint32_t *idx = NULL)
-  {
-    do
-    {
-      size_t offs = m_BufferHead - m_Buffer + (size_t)m_ReadOffset;
+  void SkipToChunk(uint32_t chunkIdx, uint32_t *idx = NULL);
 
-      uint32_t c = PushContext(NULL, NULL, 1, false);
-
-      // found
-      if(c == chunkIdx)
-      {
-        m_Indent--;
-        m_BufferHead = (m_Buffer + offs) - (size_t)m_ReadOffset;
-        return;
-      }
-      else
-      {
-        SkipCurrentChunk();
-        PopContext(1);
-      }
-
-      if(idx)
-        (*idx)++;
+  struct ChunkIndexEntry
+  {
+    uint32_t chunkType;
+    uint32_t length;    // includes any alignment padding before the chunk
+    uint64_t offset;    // where to SetOffset() to before calling PushContext()
+  };
 
-    } while(!AtEnd());
-  }
+  // the type, offset and length of every top-level chunk in the frame capture. Comes from the
+  // file's chunk index section if there is one, otherwise it's built by scanning the frame once.
+  const vector<ChunkIndexEntry> &GetChunkIndex();
 
   // assumes buffer head is sitting in a chunk (ie. immediately after a pushcontext)
   void SkipCurrentChunk() { ReadBytes(m_LastChunkLen); }
@@ -324,6 +343,14 @@ public:
 
   // Write a chunk to disk
   void Insert(Chunk *el);
+  // for chunks whose data the caller may still modify in place, e.g. a resource's CPU-side
+  // contents. When writing in the background the data is copied, so the capture gets the contents
+  // at the time of inserting.
+  void InsertSnapshot(Chunk *el);
+
+  // Write a chunk to disk that will be created later, in order with the other inserted chunks.
+  // The serialiser takes ownership of the deferred chunk.
+  void InsertDeferred(DeferredChunk *deferred);
 
   // serialise a fixed-size array.
   template <int Num, class T>
@@ -556,6 +583,12 @@ public:
   // If serialising in, buf must either be NULL in which case allocated
   // memory will be returned, or it must be already large enough.
   void SerialiseBuffer(const char *name, byte *&buf, size_t &len);
+
+  // serialise a buffer without copying it out when reading. buf is pointed directly at the
+  // serialiser's storage, which for a persistent block or a mapped capture stays valid as long
+  // as the serialiser. Otherwise it is only valid until the next read.
+  void SerialiseBufferView(const char *name, const byte *&buf, size_t &len);
+
   void AlignNextBuffer(const size_t alignment);
 
   // NOT recommended interface. Useful for specific situations if e.g. you have
@@ -572,13 +605,38 @@ public:
 
   void FlushToDisk();
 
+  // start writing the file now, with inserted chunks handed to a background thread that compresses
+  // and writes them as they arrive. FlushToDisk() then only needs to wait for the queue to drain
+  // and write the trailing sections. Does nothing if the file can't be opened.
+  void StartAsyncWrite();
+  bool IsWritingAsync();
+
+  // set the compression for the frame capture when writing (eSectionFlag_LZ4Blocks or
+  // eSectionFlag_ZstdCompressed), with level as for WriteRecompressed. Must be called before
+  // StartAsyncWrite() or FlushToDisk()
+  void SetCompression(SectionFlags codec, int level);
+
+  // milliseconds Insert() spent waiting for the background writer to catch up
+  double GetAsyncBlockedTime() { return m_AsyncBlockedTime; }
+  // write a copy of the file being read to path, with the frame capture recompressed using codec
+  // (eSectionFlag_LZ4Blocks or eSectionFlag_ZstdCompressed). level is only used for zstd, where 0
+  // selects the default. Other sections are copied unchanged. This moves the file read position,
+  // so nothing else should be read from this serialiser afterwards.
+  bool WriteRecompressed(const char *path, SectionFlags codec, int level);
+
   // set a function used when serialising a text representation
   // of the chunks
   void SetChunkNameLookup(ChunkLookup lookup) { m_ChunkLookup = lookup; }
   void SetDebugText(bool enabled) { m_DebugTextWriting = enabled; }
   bool GetDebugText() { return m_DebugTextWriting; }
+  // chunks written when the CaptureCallstacks option is enabled normally record the callstack of
+  // the thread writing them. Disable it for chunks that aren't written on an application thread
+  void SetCollectCallstacks(bool enabled) { m_CollectCallstacks = enabled; }
   string GetDebugStr() { return m_DebugText; }
 private:
+  struct Section;
+  friend class Chunk;
+
   //////////////////////////////////////////
   // Raw memory buffer read/write
 
@@ -586,6 +644,18 @@ private:
   void *ReadBytes(size_t nBytes);
 
   void ReadFromFile(uint64_t bufferOffs, size_t length);
+  void SeekSection(Section *s, uint64_t offs);
+  bool CanSeek();
+  void ScanChunks(vector<ChunkIndexEntry> &index);
+  void ReadSection(Section *s, byte *data, size_t length);
+  bool MapFrameCapture();
+  void FreeBuffer();
+
+  bool BeginFileWrite();
+  void WriteChunkToFile(Chunk *chunk);
+  void EndFileWrite();
+  void StopAsyncWrite();
+  static void AsyncWriteThread(void *ser);
 
   template <class T>
   void WriteFrom(const T &f)
@@ -616,6 +686,9 @@ private:
 
   static void CreateResolver(void *ths);
 
+  // the callstacks referenced by chunks in the capture being read, loaded on first use
+  CallstackTrie *GetCallstackDB();
+
   // clean out for before constructor and after destructor (and other times probably)
   void Reset();
 
@@ -646,6 +719,7 @@ private:
   int m_Indent;
 
   Callstack::Stackwalk *m_pCallstack;
+  CallstackTrie *m_pCallstackDB;
   Callstack::StackResolver *m_pResolver;
   Threading::ThreadHandle m_ResolverThread;
   volatile bool m_ResolverThreadKillSignal;
@@ -665,7 +739,13 @@ private:
   struct Section
   {
     Section()
-        : type(eSectionType_Unknown), flags(eSectionFlag_None), fileoffset(0), compressedReader(NULL)
+        : type(eSectionType_Unknown),
+          flags(eSectionFlag_None),
+          fileoffset(0),
+          rawoffset(0),
+          rawsize(0),
+          compressedReader(NULL),
+          blockReader(NULL)
     {
     }
     string name;
@@ -674,8 +754,14 @@ private:
 
     uint64_t fileoffset;
     uint64_t size;
+
+    // the whole section as stored in the file including its header, so it can be copied as-is.
+    // Sections from old files without headers have a rawsize of 0
+    uint64_t rawoffset;
+    uint64_t rawsize;
     vector<byte> data;    // some sections can be loaded entirely into memory
     CompressedFileIO *compressedReader;
+    BlockCompressedFileIO *blockReader;
   };
 
   // this lists all sections in file order
@@ -696,13 +782,32 @@ private:
   // the file pointer to read from
   FILE *m_ReadFileHandle;
 
+  // if the frame capture section is uncompressed it is mapped directly from the file, and
+  // m_Buffer points into this view rather than being allocated
+  void *m_MappedView;
+
+  // built on first use, see GetChunkIndex()
+  vector<ChunkIndexEntry> m_ChunkIndex;
+  bool m_ChunkIndexReady;
+
   // writing to file
   vector<Chunk *> m_Chunks;
 
+  // the arena page that chunks created from this serialiser are allocated from, see Chunk
+  ChunkPage *m_ChunkPage;
+
+  // the file being written, opened early by StartAsyncWrite() or in FlushToDisk()
+  CaptureFileWriter *m_FileWriter;
+  double m_AsyncBlockedTime;
+  SectionFlags m_WriteCodec;
+  int m_WriteLevel;
+
   // a database of strings read from the file, useful when serialised structures
   // expect a char* to return and point to static memory
   set<string> m_StringDB;
 
+  bool m_CollectCallstacks;
+
   // debug buffer
   bool m_DebugTextWriting;
   string m_DebugText;
@@ -827,6 +932,12 @@ struct ScopedDeserialise
     name = (type)(inBuf);                             \
   size_t CONCAT(buflen, __LINE__) = Len;              \
   GET_SERIALISER->SerialiseBuffer(#name, name, CONCAT(buflen, __LINE__));
+#define SERIALISE_ELEMENT_BUF_VIEW(name, inBuf, Len) \
+  const byte *name = NULL;                           \
+  if(m_State >= WRITING)                             \
+    name = (const byte *)(inBuf);                    \
+  size_t CONCAT(buflen, __LINE__) = Len;             \
+  GET_SERIALISER->SerialiseBufferView(#name, name, CONCAT(buflen, __LINE__));
 #define SERIALISE_ELEMENT_BUF_OPT(type, name, inBuf, Len, Condition)        \
   type name = (type)NULL;                                                   \
   if(Condition)                                                             \
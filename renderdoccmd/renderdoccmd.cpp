@@ -289,6 +289,64 @@ struct ThumbCommand : public Command
   }
 };
 
+struct ConvertCommand : public Command
+{
+  virtual void AddOptions(cmdline::parser &parser)
+  {
+    parser.set_footer("<filename.rdc>");
+    parser.add<string>("out", 'o', "The output filename to save the converted capture to", true,
+                       "filename.rdc");
+    parser.add<string>("compression", 'c', "The compression to use for the frame data", false,
+                       "zstd", cmdline::oneof<string>("lz4", "zstd"));
+    parser.add<int>(
+        "level", 'l',
+        "The zstd compression level. Default is 0, which uses zstd's default level.", false, 0);
+  }
+  virtual const char *Description()
+  {
+    return "Writes a copy of a capture with its frame data recompressed.";
+  }
+  virtual bool IsInternalOnly() { return false; }
+  virtual bool IsCaptureCommand() { return false; }
+  virtual int Execute(cmdline::parser &parser, const CaptureOptions &)
+  {
+    if(parser.rest().empty())
+    {
+      std::cerr << "Error: convert command requires a capture filename." << std::endl
+                << std::endl
+                << parser.usage();
+      return 0;
+    }
+
+    string filename = parser.rest()[0];
+
+    string outfile = parser.get<string>("out");
+
+    CaptureCompression compression = CaptureCompression::Zstd;
+
+    if(parser.get<string>("compression") == "lz4")
+      compression = CaptureCompression::LZ4;
+
+    ReplayStatus status = ReplayStatus::InternalError;
+
+    ICaptureFile *file = RENDERDOC_OpenCaptureFile(filename.c_str());
+    status = file->OpenStatus();
+    if(status == ReplayStatus::Succeeded)
+      status = file->Convert(outfile.c_str(), compression, parser.get<int>("level"));
+    file->Shutdown();
+
+    if(status != ReplayStatus::Succeeded)
+    {
+      std::cerr << "Couldn't convert '" << filename << "' to '" << outfile << "'" << std::endl;
+      return 1;
+    }
+
+    std::cout << "Converted '" << filename << "' to '" << outfile << "'." << std::endl;
+
+    return 0;
+  }
+};
+
 struct CaptureCommand : public Command
 {
   virtual void AddOptions(cmdline::parser &parser)
@@ -691,6 +749,7 @@ int renderdoccmd(std::vector<std::string> &argv)
 
     // add platform agnostic commands
     add_command("thumb", new ThumbCommand());
+    add_command("convert", new ConvertCommand());
     add_command("capture", new CaptureCommand());
     add_command("inject", new InjectCommand());
     add_command("remoteserver", new RemoteServerCommand());
@@ -771,6 +830,9 @@ int renderdoccmd(std::vector<std::string> &argv)
               "Capturing Option: Save all initial resource contents at frame start.");
       cmd.add("opt-capture-all-cmd-lists", 0,
               "Capturing Option: In D3D11, record all command lists from application start.");
+      cmd.add<int>("opt-zstd-level", 0,
+                   "Capturing Option: Compress captures with zstd at this level instead of LZ4.",
+                   false, 0, cmdline::range(0, 22));
     }
 
     cmd.parse_check(argv, true);
@@ -804,6 +866,7 @@ int renderdoccmd(std::vector<std::string> &argv)
         opts.CaptureAllCmdLists = true;
 
       opts.DelayForDebugger = (uint32_t)cmd.get<int>("opt-delay-for-debugger");
+      opts.ZstdCompressionLevel = (uint32_t)cmd.get<int>("opt-zstd-level");
     }
 
     if(cmd.exist("help"))
@@ -151,6 +151,8 @@ public class ReplayOutput
                                                                 UInt32 x, UInt32 y, UInt32 sliceFace, UInt32 mip, UInt32 sample, IntPtr outval);
         [DllImport("renderdoc.dll", CharSet = CharSet.Unicode, CallingConvention = CallingConvention.Cdecl)]
         private static extern UInt32 ReplayOutput_PickVertex(IntPtr real, UInt32 eventID, UInt32 x, UInt32 y, IntPtr outPickedInstance);
+        [DllImport("renderdoc.dll", CharSet = CharSet.Unicode, CallingConvention = CallingConvention.Cdecl)]
+        private static extern UInt32 ReplayOutput_PickTriangle(IntPtr real, UInt32 eventID, UInt32 x, UInt32 y, IntPtr outPickedInstance);
 
         private IntPtr m_Real = IntPtr.Zero;
 
@@ -257,6 +259,18 @@ public UInt32 PickVertex(UInt32 eventID, UInt32 x, UInt32 y, out UInt32 pickedIn
             return pickedVertex;
         }
 
+        public UInt32 PickTriangle(UInt32 eventID, UInt32 x, UInt32 y, out UInt32 pickedInstance)
+        {
+            IntPtr mem = CustomMarshal.Alloc(typeof(UInt32));
+
+            UInt32 pickedTriangle = ReplayOutput_PickTriangle(m_Real, eventID, x, y, mem);
+            pickedInstance = (UInt32)CustomMarshal.PtrToStructure(mem, typeof(UInt32), true);
+
+            CustomMarshal.Free(mem);
+
+            return pickedTriangle;
+        }
+
     };
 
     public class ReplayRenderer
@@ -387,37 +387,47 @@ void ToggleBreakpoint(ScintillaNET.Scintilla sc, int position)
 
             while (line != null && line.StartPosition >= 0)
             {
-                var trimmed = line.Text.Trim();
+                int lineNum = InstructionForLine(line);
 
-                int colon = trimmed.IndexOf(":");
-
-                if (colon >= 0)
+                if (lineNum >= 0)
                 {
-                    string start = trimmed.Substring(0, colon);
-
-                    int lineNum = -1;
-
-                    if (int.TryParse(start, out lineNum))
+                    if (line.GetMarkers().Contains(sc.Markers[BREAKPOINT_MARKER]))
                     {
-                        if (line.GetMarkers().Contains(sc.Markers[BREAKPOINT_MARKER]))
-                        {
-                            line.DeleteMarkerSet(BreakpointMarkers);
-                            m_Breakpoints.Remove(lineNum);
-                        }
-                        else
-                        {
-                            line.AddMarkerSet(BreakpointMarkers);
-                            m_Breakpoints.Add(lineNum);
-                        }
-
-                        sc.Invalidate();
-                        return;
+                        line.DeleteMarkerSet(BreakpointMarkers);
+                        m_Breakpoints.Remove(lineNum);
+                    }
+                    else
+                    {
+                        line.AddMarkerSet(BreakpointMarkers);
+                        m_Breakpoints.Add(lineNum);
                     }
+
+                    sc.Invalidate();
+                    return;
                 }
 
                 line = line.Next;
             }
         }
+
+        // returns the instruction that a disassembly line is for, or -1 if it's not an instruction
+        private int InstructionForLine(ScintillaNET.Line line)
+        {
+            // SPIR-V debugging refers to disassembly lines directly
+            if (m_Core.APIProps.pipelineType == GraphicsAPI.Vulkan)
+                return line.Number;
+
+            var trimmed = line.Text.Trim();
+
+            int colon = trimmed.IndexOf(":");
+
+            int inst = -1;
+
+            if (colon > 0 && int.TryParse(trimmed.Substring(0, colon), out inst) && inst >= 0)
+                return inst;
+
+            return -1;
+        }
             
         void scintilla1_DebuggingKeyDown(object sender, KeyEventArgs e)
         {
@@ -1441,7 +1451,7 @@ public void UpdateDebugging()
                 m_DisassemblyView.Lines[i].DeleteMarkerSet(CurrentLineMarkers);
                 m_DisassemblyView.Lines[i].DeleteMarkerSet(FinishedMarkers);
 
-                if (m_DisassemblyView.Lines[i].Text.Trim().StartsWith(nextInst.ToString() + ":"))
+                if (InstructionForLine(m_DisassemblyView.Lines[i]) == nextInst)
                 {
                     m_DisassemblyView.Lines[i].AddMarkerSet(done ? FinishedMarkers : CurrentLineMarkers);
                     m_DisassemblyView.Caret.LineNumber = i;
@@ -1958,24 +1968,12 @@ private void RunToCursor()
 
             while (i < m_DisassemblyView.Lines.Count)
             {
-                var trimmed = m_DisassemblyView.Lines[i].Text.Trim();
-
-                int colon = trimmed.IndexOf(":");
+                int runTo = InstructionForLine(m_DisassemblyView.Lines[i]);
 
-                if (colon > 0)
+                if (runTo >= 0)
                 {
-                    string start = trimmed.Substring(0, colon);
-
-                    int runTo = -1;
-
-                    if (int.TryParse(start, out runTo))
-                    {
-                        if (runTo >= 0)
-                        {
-                            RunTo(runTo, true);
-                            break;
-                        }
-                    }
+                    RunTo(runTo, true);
+                    break;
                 }
 
                 i++;